@@ -17,10 +17,71 @@
 
 #include "qgsgridfilewriter.h"
 #include "qgsinterpolator.h"
+#include "qgslogger.h"
 #include "qgsvectorlayer.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QProgressDialog>
+#include <QtConcurrentMap>
+
+#include <cpl_string.h>
+#include <gdal.h>
+
+#if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
+#define TO8F(x)  (x).toUtf8().constData()
+#else
+#define TO8F(x)  QFile::encodeName( x ).constData()
+#endif
+
+///@cond PRIVATE
+
+//! number of cells interpolated before they are written
+static const int BAND_CELLS = 1 << 20;
+
+static const double NODATA_VALUE = -9999;
+
+/** Interpolates one row of a band */
+class QgsGridFileRowProcessor
+{
+  public:
+    typedef void result_type;
+
+    QgsGridFileRowProcessor( QgsInterpolator* interpolator, double* values, int firstRow, int nColumns, double xMin, double yMax, double cellSizeX, double cellSizeY )
+        : mInterpolator( interpolator )
+        , mValues( values )
+        , mFirstRow( firstRow )
+        , mNumColumns( nColumns )
+        , mXMin( xMin )
+        , mYMax( yMax )
+        , mCellSizeX( cellSizeX )
+        , mCellSizeY( cellSizeY )
+    {}
+
+    void operator()( const int& row )
+    {
+      //values in the center of the cells
+      const double y = mYMax - mCellSizeY / 2.0 - row * mCellSizeY;
+      double* values = mValues + ( row - mFirstRow ) * mNumColumns;
+      double interpolatedValue;
+      for ( int j = 0; j < mNumColumns; ++j )
+      {
+        const double x = mXMin + mCellSizeX / 2.0 + j * mCellSizeX;
+        values[j] = mInterpolator->interpolatePoint( x, y, interpolatedValue ) == 0 ? interpolatedValue : NODATA_VALUE;
+      }
+    }
+
+  private:
+    QgsInterpolator* mInterpolator;
+    double* mValues;
+    int mFirstRow;
+    int mNumColumns;
+    double mXMin;
+    double mYMax;
+    double mCellSizeX;
+    double mCellSizeY;
+};
+
+///@endcond
 
 QgsGridFileWriter::QgsGridFileWriter( QgsInterpolator* i, const QString& outputPath, const QgsRectangle& extent, int nCols, int nRows, double cellSizeX, double cellSizeY )
     : mInterpolator( i )
@@ -46,26 +107,60 @@ QgsGridFileWriter::QgsGridFileWriter()
 
 int QgsGridFileWriter::writeFile( bool showProgressDialog )
 {
+  const bool asciiGrid = mOutputFormat.isEmpty();
   QFile outputFile( mOutputFilePath );
+  QTextStream outStream;
+  GDALDriverH outputDriver = nullptr;
+  GDALDatasetH outputDataset = nullptr;
+  GDALRasterBandH outputRasterBand = nullptr;
 
-  if ( !outputFile.open( QFile::WriteOnly ) )
+  if ( asciiGrid )
   {
-    return 1;
-  }
+    if ( !outputFile.open( QFile::WriteOnly ) )
+    {
+      return 1;
+    }
 
-  if ( !mInterpolator )
-  {
-    outputFile.remove();
-    return 2;
+    if ( !mInterpolator )
+    {
+      outputFile.remove();
+      return 2;
+    }
+
+    outStream.setDevice( &outputFile );
+    outStream.setRealNumberPrecision( 8 );
+    writeHeader( outStream );
   }
+  else
+  {
+    if ( !mInterpolator )
+    {
+      return 2;
+    }
+
+    GDALAllRegister();
+    outputDriver = GDALGetDriverByName( mOutputFormat.toLocal8Bit().data() );
+    if ( !outputDriver || !CSLFetchBoolean( GDALGetMetadata( outputDriver, nullptr ), GDAL_DCAP_CREATE, false ) )
+    {
+      return 1;
+    }
 
-  QTextStream outStream( &outputFile );
-  outStream.setRealNumberPrecision( 8 );
-  writeHeader( outStream );
+    outputDataset = GDALCreate( outputDriver, TO8F( mOutputFilePath ), mNumColumns, mNumRows, 1, GDT_Float32, nullptr );
+    if ( !outputDataset )
+    {
+      return 1;
+    }
 
-  double currentYValue = mInterpolationExtent.yMaximum() - mCellSizeY / 2.0; //calculate value in the center of the cell
-  double currentXValue;
-  double interpolatedValue;
+    double geotransform[6] = { mInterpolationExtent.xMinimum(), mCellSizeX, 0, mInterpolationExtent.yMaximum(), 0, -mCellSizeY };
+    GDALSetGeoTransform( outputDataset, geotransform );
+    QgsVectorLayer* vl = mInterpolator->layerData().first().vectorLayer;
+    if ( vl )
+    {
+      GDALSetProjection( outputDataset, vl->crs().toWkt().toLocal8Bit().data() );
+    }
+    outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
+    GDALSetRasterNoDataValue( outputRasterBand, NODATA_VALUE );
+  }
 
   QProgressDialog* progressDialog = nullptr;
   if ( showProgressDialog )
@@ -74,35 +169,69 @@ int QgsGridFileWriter::writeFile( bool showProgressDialog )
     progressDialog->setWindowModality( Qt::WindowModal );
   }
 
-  for ( int i = 0; i < mNumRows; ++i )
+  //the rows are interpolated by several threads once the interpolator has cached its data
+  const bool parallel = mNumColumns > 0 && mInterpolator->isThreadSafe() && mInterpolator->prepare() == 0;
+
+  //interpolate bands of full rows, then write them
+  const int bandHeight = qBound( 1, BAND_CELLS / qMax( mNumColumns, 1 ), qMax( mNumRows, 1 ) );
+  QVector<double> values( bandHeight * mNumColumns );
+  for ( int y = 0; y < mNumRows; y += bandHeight )
   {
-    currentXValue = mInterpolationExtent.xMinimum() + mCellSizeX / 2.0; //calculate value in the center of the cell
-    for ( int j = 0; j < mNumColumns; ++j )
+    const int height = qMin( bandHeight, mNumRows - y );
+    interpolateBand( y, height, values.data(), parallel );
+
+    if ( asciiGrid )
     {
-      if ( mInterpolator->interpolatePoint( currentXValue, currentYValue, interpolatedValue ) == 0 )
+      const double* value = values.constData();
+      for ( int i = 0; i < height; ++i )
       {
-        outStream << interpolatedValue << ' ';
+        for ( int j = 0; j < mNumColumns; ++j, ++value )
+        {
+          if ( *value == NODATA_VALUE )
+          {
+            outStream << "-9999 ";
+          }
+          else
+          {
+            outStream << *value << ' ';
+          }
+        }
+        outStream << endl;
       }
-      else
-      {
-        outStream << "-9999 ";
-      }
-      currentXValue += mCellSizeX;
     }
-    outStream << endl;
-    currentYValue -= mCellSizeY;
+    else if ( GDALRasterIO( outputRasterBand, GF_Write, 0, y, mNumColumns, height, values.data(), mNumColumns, height, GDT_Float64, 0, 0 ) != CE_None )
+    {
+      QgsDebugMsg( "RasterIO error!" );
+    }
 
     if ( showProgressDialog )
     {
       if ( progressDialog->wasCanceled() )
       {
-        outputFile.remove();
+        delete progressDialog;
+        if ( asciiGrid )
+        {
+          outputFile.remove();
+        }
+        else
+        {
+          //delete the dataset without closing (because it is faster)
+          GDALDeleteDataset( outputDriver, TO8F( mOutputFilePath ) );
+        }
         return 3;
       }
-      progressDialog->setValue( i );
+      progressDialog->setValue( y + height );
     }
   }
 
+  delete progressDialog;
+
+  if ( !asciiGrid )
+  {
+    GDALClose( outputDataset );
+    return 0;
+  }
+
   // create prj file
   QgsInterpolator::LayerData ld;
   ld = mInterpolator->layerData().first();
@@ -120,10 +249,31 @@ int QgsGridFileWriter::writeFile( bool showProgressDialog )
   prjStream << endl;
   prjFile.close();
 
-  delete progressDialog;
   return 0;
 }
 
+void QgsGridFileWriter::interpolateBand( int y, int height, double* values, bool parallel )
+{
+  QgsGridFileRowProcessor processor( mInterpolator, values, y, mNumColumns, mInterpolationExtent.xMinimum(), mInterpolationExtent.yMaximum(), mCellSizeX, mCellSizeY );
+
+  QVector<int> rows( height );
+  for ( int i = 0; i < height; ++i )
+  {
+    rows[i] = y + i;
+  }
+
+  if ( !parallel )
+  {
+    Q_FOREACH ( int row, rows )
+    {
+      processor( row );
+    }
+    return;
+  }
+
+  QtConcurrent::blockingMap( rows, processor );
+}
+
 int QgsGridFileWriter::writeHeader( QTextStream& outStream )
 {
   outStream << "NCOLS " << mNumColumns << endl;
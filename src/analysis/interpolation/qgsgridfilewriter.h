@@ -25,8 +25,9 @@
 class QgsInterpolator;
 
 /** \ingroup analysis
- * A class that does interpolation to a grid and writes the results to an ascii grid*/
-//todo: extend such that writing to other file types is possible
+ * A class that does interpolation to a grid and writes the results to an ascii grid or a GDAL raster.
+ * The grid is interpolated by bands of rows, the rows of a band are interpolated in parallel if
+ * the interpolator is thread safe.*/
 class ANALYSIS_EXPORT QgsGridFileWriter
 {
   public:
@@ -38,13 +39,30 @@ class ANALYSIS_EXPORT QgsGridFileWriter
 
     int writeFile( bool showProgressDialog = false );
 
+    /** Sets the GDAL driver used to write the grid, for example "GTiff". The default, an empty string,
+     * writes an ascii grid with a .prj file.
+     * @see outputFormat()
+     * @note added in QGIS 2.99
+     */
+    void setOutputFormat( const QString& format ) { mOutputFormat = format; }
+
+    /** Returns the GDAL driver used to write the grid, an empty string for an ascii grid.
+     * @see setOutputFormat()
+     * @note added in QGIS 2.99
+     */
+    QString outputFormat() const { return mOutputFormat; }
+
   private:
 
     QgsGridFileWriter(); //forbidden
     int writeHeader( QTextStream& outStream );
 
+    //! Interpolates the rows of a band, starting at row y, in parallel if the interpolator has been prepared for it
+    void interpolateBand( int y, int height, double* values, bool parallel );
+
     QgsInterpolator* mInterpolator;
     QString mOutputFilePath;
+    QString mOutputFormat;
     QgsRectangle mInterpolationExtent;
     int mNumColumns;
     int mNumRows;
@@ -16,15 +16,123 @@
  ***************************************************************************/
 
 #include "qgsidwinterpolator.h"
+#include <QVarLengthArray>
+#include <algorithm>
 #include <cmath>
 #include <limits>
 
-QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData>& layerData ): QgsInterpolator( layerData ), mDistanceCoefficient( 2.0 )
+///@cond PRIVATE
+
+//! Orders points by x or y
+struct QgsIDWAxisCompare
+{
+  explicit QgsIDWAxisCompare( int axis ) : mAxis( axis ) {}
+
+  bool operator()( const vertexData& a, const vertexData& b ) const
+  {
+    return mAxis == 0 ? a.x < b.x : a.y < b.y;
+  }
+
+  int mAxis;
+};
+
+//! Point found by a search, the heap of the nearest points has the farthest point on top
+struct QgsIDWNeighbor
+{
+  double sqrDist;
+  double z;
+
+  bool operator<( const QgsIDWNeighbor& other ) const { return sqrDist < other.sqrDist; }
+};
+
+typedef QVarLengthArray< QgsIDWNeighbor, 64 > QgsIDWNeighbors;
+
+/** Finds the points of a kd-tree built by QgsIDWInterpolator::buildTree
+ * @param points points of the tree
+ * @param begin first point of the subtree
+ * @param end end of the points of the subtree
+ * @param axis split axis of the subtree
+ * @param x x-coordinate of the location
+ * @param y y-coordinate of the location
+ * @param maxPoints number of nearest points to keep, 0 to keep all the points
+ * @param maxSqrDist squared distance of the points to keep, reduced to the farthest of the
+ * nearest points once maxPoints points are found
+ * @param neighbors found points, as a heap if maxPoints is not 0
+ */
+static void searchTree( const vertexData* points, int begin, int end, int axis, double x, double y,
+                        int maxPoints, double& maxSqrDist, QgsIDWNeighbors& neighbors )
 {
+  while ( begin < end )
+  {
+    int mid = begin + ( end - begin ) / 2;
+    const vertexData& point = points[mid];
+    double dx = point.x - x;
+    double dy = point.y - y;
+    double sqrDist = dx * dx + dy * dy;
 
+    if ( sqrDist <= maxSqrDist )
+    {
+      QgsIDWNeighbor neighbor;
+      neighbor.sqrDist = sqrDist;
+      neighbor.z = point.z;
+      if ( maxPoints <= 0 )
+      {
+        neighbors.append( neighbor );
+      }
+      else if ( neighbors.size() < maxPoints )
+      {
+        neighbors.append( neighbor );
+        std::push_heap( neighbors.begin(), neighbors.end() );
+        if ( neighbors.size() == maxPoints )
+          maxSqrDist = neighbors[0].sqrDist;
+      }
+      else
+      {
+        std::pop_heap( neighbors.begin(), neighbors.end() );
+        neighbors[ neighbors.size() - 1 ] = neighbor;
+        std::push_heap( neighbors.begin(), neighbors.end() );
+        maxSqrDist = neighbors[0].sqrDist;
+      }
+    }
+
+    // search the side of the location first, then the other side if it is near enough
+    double diff = axis == 0 ? x - point.x : y - point.y;
+    if ( diff < 0 )
+    {
+      searchTree( points, begin, mid, 1 - axis, x, y, maxPoints, maxSqrDist, neighbors );
+      if ( diff * diff > maxSqrDist )
+        return;
+      begin = mid + 1;
+    }
+    else
+    {
+      searchTree( points, mid + 1, end, 1 - axis, x, y, maxPoints, maxSqrDist, neighbors );
+      if ( diff * diff > maxSqrDist )
+        return;
+      end = mid;
+    }
+    axis = 1 - axis;
+  }
 }
 
-QgsIDWInterpolator::QgsIDWInterpolator(): QgsInterpolator( QList<LayerData>() ), mDistanceCoefficient( 2.0 )
+///@endcond
+
+QgsIDWInterpolator::QgsIDWInterpolator( const QList<LayerData>& layerData )
+    : QgsInterpolator( layerData )
+    , mDistanceCoefficient( 2.0 )
+    , mMaxPoints( 0 )
+    , mSearchRadius( 0.0 )
+    , mTreeBuilt( false )
+{
+
+}
+
+QgsIDWInterpolator::QgsIDWInterpolator()
+    : QgsInterpolator( QList<LayerData>() )
+    , mDistanceCoefficient( 2.0 )
+    , mMaxPoints( 0 )
+    , mSearchRadius( 0.0 )
+    , mTreeBuilt( false )
 {
 
 }
@@ -34,30 +142,92 @@ QgsIDWInterpolator::~QgsIDWInterpolator()
 
 }
 
+void QgsIDWInterpolator::buildTree( int begin, int end, int axis )
+{
+  // the median of each subtree is in its middle, with the smaller points before it
+  while ( end - begin > 1 )
+  {
+    int mid = begin + ( end - begin ) / 2;
+    vertexData* points = mCachedBaseData.data();
+    std::nth_element( points + begin, points + mid, points + end, QgsIDWAxisCompare( axis ) );
+    buildTree( begin, mid, 1 - axis );
+    begin = mid + 1;
+    axis = 1 - axis;
+  }
+}
+
+int QgsIDWInterpolator::prepare()
+{
+  bool cached = mDataIsCached;
+  int res = QgsInterpolator::prepare();
+  if ( res != 0 )
+    return res;
+
+  if ( !cached )
+    mTreeBuilt = false;
+  if ( ( mMaxPoints > 0 || mSearchRadius > 0 ) && !mTreeBuilt )
+  {
+    buildTree( 0, mCachedBaseData.size(), 0 );
+    mTreeBuilt = true;
+  }
+  return 0;
+}
+
 int QgsIDWInterpolator::interpolatePoint( double x, double y, double& result )
 {
   if ( !mDataIsCached )
   {
     cacheBaseData();
+    mTreeBuilt = false;
   }
 
-  double currentWeight;
-  double distance;
+  // squared distances are weighted with half the coefficient, which avoids a square root
+  double halfCoefficient = mDistanceCoefficient / 2.0;
+  // locations on a point get its value
+  double minSqrDist = std::numeric_limits<double>::min();
 
   double sumCounter = 0;
   double sumDenominator = 0;
 
-  Q_FOREACH ( const vertexData& vertex_it, mCachedBaseData )
+  if ( mMaxPoints <= 0 && mSearchRadius <= 0 )
   {
-    distance = sqrt(( vertex_it.x - x ) * ( vertex_it.x - x ) + ( vertex_it.y - y ) * ( vertex_it.y - y ) );
-    if (( distance - 0 ) < std::numeric_limits<double>::min() )
+    Q_FOREACH ( const vertexData& vertex_it, mCachedBaseData )
+    {
+      double sqrDist = ( vertex_it.x - x ) * ( vertex_it.x - x ) + ( vertex_it.y - y ) * ( vertex_it.y - y );
+      if ( sqrDist < minSqrDist )
+      {
+        result = vertex_it.z;
+        return 0;
+      }
+      double currentWeight = halfCoefficient == 1.0 ? 1 / sqrDist : 1 / pow( sqrDist, halfCoefficient );
+      sumCounter += ( currentWeight * vertex_it.z );
+      sumDenominator += currentWeight;
+    }
+  }
+  else
+  {
+    if ( !mTreeBuilt )
+    {
+      buildTree( 0, mCachedBaseData.size(), 0 );
+      mTreeBuilt = true;
+    }
+
+    double maxSqrDist = mSearchRadius > 0 ? mSearchRadius * mSearchRadius : std::numeric_limits<double>::infinity();
+    QgsIDWNeighbors neighbors;
+    searchTree( mCachedBaseData.constData(), 0, mCachedBaseData.size(), 0, x, y, mMaxPoints, maxSqrDist, neighbors );
+
+    for ( int i = 0; i < neighbors.size(); ++i )
     {
-      result = vertex_it.z;
-      return 0;
+      const QgsIDWNeighbor& neighbor = neighbors.at( i );
+      if ( neighbor.sqrDist < minSqrDist )
+      {
+        result = neighbor.z;
+        return 0;
+      }
+      double currentWeight = halfCoefficient == 1.0 ? 1 / neighbor.sqrDist : 1 / pow( neighbor.sqrDist, halfCoefficient );
+      sumCounter += ( currentWeight * neighbor.z );
+      sumDenominator += currentWeight;
     }
-    currentWeight = 1 / ( pow( distance, mDistanceCoefficient ) );
-    sumCounter += ( currentWeight * vertex_it.z );
-    sumDenominator += currentWeight;
   }
 
   if ( sumDenominator == 0.0 )
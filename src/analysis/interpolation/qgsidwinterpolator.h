@@ -38,14 +38,56 @@ class ANALYSIS_EXPORT QgsIDWInterpolator: public QgsInterpolator
 
     void setDistanceCoefficient( double p ) {mDistanceCoefficient = p;}
 
+    /** Sets the number of nearest points used to interpolate a value, 0 to use all the points (the default).
+     * The nearest points are found with a kd-tree of the base data.
+     * @see maxPoints()
+     * @see setSearchRadius()
+     * @note added in QGIS 2.99
+     */
+    void setMaxPoints( int maxPoints ) { mMaxPoints = maxPoints; }
+
+    /** Returns the number of nearest points used to interpolate a value, 0 if all the points are used.
+     * @see setMaxPoints()
+     * @note added in QGIS 2.99
+     */
+    int maxPoints() const { return mMaxPoints; }
+
+    /** Sets the distance from the interpolated location of the points used, 0 for no limit (the default).
+     * Locations without any point in the radius have no value.
+     * @see searchRadius()
+     * @see setMaxPoints()
+     * @note added in QGIS 2.99
+     */
+    void setSearchRadius( double radius ) { mSearchRadius = radius; }
+
+    /** Returns the distance from the interpolated location of the points used, 0 if there is no limit.
+     * @see setSearchRadius()
+     * @note added in QGIS 2.99
+     */
+    double searchRadius() const { return mSearchRadius; }
+
+    //! Caches the base data and builds the kd-tree if a number of points or a search radius is set
+    int prepare() override;
+
+    bool isThreadSafe() const override { return true; }
+
   private:
 
     QgsIDWInterpolator(); //forbidden
 
+    //! Sorts the base data between begin and end as a kd-tree, splitting by x if axis is 0 and by y if it is 1
+    void buildTree( int begin, int end, int axis );
+
     /** The parameter that sets how the values are weighted with distance.
        Smaller values mean sharper peaks at the data points. The default is a
        value of 2*/
     double mDistanceCoefficient;
+
+    int mMaxPoints;
+    double mSearchRadius;
+
+    //! True if the base data is sorted as a kd-tree
+    bool mTreeBuilt;
 };
 
 #endif
@@ -40,6 +40,19 @@ QgsInterpolator::~QgsInterpolator()
 
 }
 
+int QgsInterpolator::prepare()
+{
+  if ( !mDataIsCached )
+  {
+    int res = cacheBaseData();
+    if ( res != 0 )
+      return res;
+  }
+
+  // nothing is cached without layer data, each interpolatePoint() call would try again
+  return mDataIsCached ? 0 : 1;
+}
+
 int QgsInterpolator::cacheBaseData()
 {
   if ( mLayerData.size() < 1 )
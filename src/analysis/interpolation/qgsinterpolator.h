@@ -65,6 +65,20 @@ class ANALYSIS_EXPORT QgsInterpolator
        @return 0 in case of success*/
     virtual int interpolatePoint( double x, double y, double& result ) = 0;
 
+    /** Caches the base data and builds the structures used by interpolatePoint(), which otherwise
+     * does it on its first call. Must be called before interpolatePoint() is called by several threads.
+     * @return 0 in case of success, the base data cannot be shared by threads otherwise
+     * @note added in QGIS 2.99
+     */
+    virtual int prepare();
+
+    /** Returns true if interpolatePoint() can be called by several threads at the same time, once
+     * prepare() has succeeded. The default implementation returns false.
+     * @see prepare()
+     * @note added in QGIS 2.99
+     */
+    virtual bool isThreadSafe() const { return false; }
+
     //! @note not available in Python bindings
     const QList<LayerData>& layerData() const { return mLayerData; }
 
@@ -0,0 +1,87 @@
+/***************************************************************************
+  qgscompactgraph.cpp
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgscompactgraph.h"
+#include "qgsgraph.h"
+
+#include <limits>
+#include <math.h>
+
+QgsCompactGraph::QgsCompactGraph( const QgsGraph* graph, int criterionNum )
+    : mCostPerDistance( 0.0 )
+{
+  int vertexCount = graph->vertexCount();
+  int arcCount = graph->arcCount();
+
+  mPoints.resize( vertexCount );
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mPoints[ i ] = graph->vertex( i ).point();
+  }
+
+  // counting sort of the arcs by outgoing and incoming vertex
+  mOutOffsets.fill( 0, vertexCount + 1 );
+  mInOffsets.fill( 0, vertexCount + 1 );
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    const QgsGraphArc& arc = graph->arc( i );
+    ++mOutOffsets[ arc.outVertex() + 1 ];
+    ++mInOffsets[ arc.inVertex() + 1 ];
+  }
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mOutOffsets[ i + 1 ] += mOutOffsets[ i ];
+    mInOffsets[ i + 1 ] += mInOffsets[ i ];
+  }
+
+  mArcTail.resize( arcCount );
+  mArcHead.resize( arcCount );
+  mArcCost.resize( arcCount );
+  mArcId.resize( arcCount );
+  mInSlots.resize( arcCount );
+
+  QVector<int> outFill = mOutOffsets;
+  QVector<int> inFill = mInOffsets;
+  double costPerDistance = std::numeric_limits<double>::infinity();
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    const QgsGraphArc& arc = graph->arc( i );
+    int slot = outFill[ arc.outVertex()]++;
+    mArcTail[ slot ] = arc.outVertex();
+    mArcHead[ slot ] = arc.inVertex();
+    mArcCost[ slot ] = arc.property( criterionNum ).toDouble();
+    mArcId[ slot ] = i;
+    mInSlots[ inFill[ arc.inVertex()]++ ] = slot;
+
+    double length = sqrt( mPoints.at( arc.outVertex() ).sqrDist( mPoints.at( arc.inVertex() ) ) );
+    if ( length > 0.0 )
+    {
+      costPerDistance = qMin( costPerDistance, mArcCost.at( slot ) / length );
+    }
+  }
+
+  // negative costs or a graph without any arc of non null length: no usable bound
+  if ( costPerDistance > 0.0 && costPerDistance != std::numeric_limits<double>::infinity() )
+  {
+    mCostPerDistance = costPerDistance;
+  }
+}
+
+double QgsCompactGraph::costLowerBound( int fromVertexIdx, int toVertexIdx ) const
+{
+  if ( mCostPerDistance == 0.0 )
+    return 0.0;
+
+  return mCostPerDistance * sqrt( mPoints.at( fromVertexIdx ).sqrDist( mPoints.at( toVertexIdx ) ) );
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+  qgscompactgraph.h
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCOMPACTGRAPHH
+#define QGSCOMPACTGRAPHH
+
+// QT includes
+#include <QVector>
+
+// QGIS includes
+#include "qgspoint.h"
+
+class QgsGraph;
+
+/**
+ * \ingroup networkanalysis
+ * \class QgsCompactGraph
+ * \brief Read only graph stored in compressed sparse row form.
+ *
+ * The arcs of a QgsGraph are sorted by outgoing vertex and stored in flat arrays,
+ * together with the value of a single optimization criterion converted to double.
+ * The arcs leaving a vertex are the arc slots in range [outArcBegin(), outArcEnd()).
+ * A second index lists the arcs entering each vertex for backward searches.
+ *
+ * This is the representation used by the shortest path functions of QgsGraphAnalyzer,
+ * it needs a fraction of the memory of QgsGraph and no QVariant conversion while searching.
+ * Arc slots are not the arc indexes of the source graph, use arcId() to get them back.
+ *
+ * @note added in QGIS 2.99
+ */
+class ANALYSIS_EXPORT QgsCompactGraph
+{
+  public:
+
+    /**
+     * Builds the compact form of a graph
+     * @param graph source graph
+     * @param criterionNum index of arc property used as arc cost
+     */
+    QgsCompactGraph( const QgsGraph* graph, int criterionNum );
+
+    //! Returns the number of vertices
+    int vertexCount() const { return mPoints.size(); }
+
+    //! Returns the number of arcs
+    int arcCount() const { return mArcHead.size(); }
+
+    //! Returns the point of a vertex
+    QgsPoint vertexPoint( int vertexIdx ) const { return mPoints.at( vertexIdx ); }
+
+    //! Returns the first arc slot of the arcs leaving a vertex
+    int outArcBegin( int vertexIdx ) const { return mOutOffsets.at( vertexIdx ); }
+
+    //! Returns the arc slot following the last arc leaving a vertex
+    int outArcEnd( int vertexIdx ) const { return mOutOffsets.at( vertexIdx + 1 ); }
+
+    //! Returns the first position of the arcs entering a vertex, see inArcSlot()
+    int inArcBegin( int vertexIdx ) const { return mInOffsets.at( vertexIdx ); }
+
+    //! Returns the position following the last arc entering a vertex, see inArcSlot()
+    int inArcEnd( int vertexIdx ) const { return mInOffsets.at( vertexIdx + 1 ); }
+
+    //! Returns the arc slot of an arc entering a vertex, from its position in range [inArcBegin(), inArcEnd())
+    int inArcSlot( int position ) const { return mInSlots.at( position ); }
+
+    //! Returns the vertex an arc leaves from
+    int arcTail( int arcSlot ) const { return mArcTail.at( arcSlot ); }
+
+    //! Returns the vertex an arc goes to
+    int arcHead( int arcSlot ) const { return mArcHead.at( arcSlot ); }
+
+    //! Returns the cost of an arc
+    double arcCost( int arcSlot ) const { return mArcCost.at( arcSlot ); }
+
+    //! Returns the index of an arc in the source graph
+    int arcId( int arcSlot ) const { return mArcId.at( arcSlot ); }
+
+    /**
+     * Returns a lower bound of the cost of any path between two vertices.
+     * The bound is the straight line distance between the vertices multiplied by the
+     * smallest ratio of arc cost to arc length of the graph, it is used as A* heuristic.
+     */
+    double costLowerBound( int fromVertexIdx, int toVertexIdx ) const;
+
+  private:
+
+    QVector<QgsPoint> mPoints;
+
+    QVector<int> mOutOffsets;
+    QVector<int> mArcTail;
+    QVector<int> mArcHead;
+    QVector<double> mArcCost;
+    QVector<int> mArcId;
+
+    QVector<int> mInOffsets;
+    QVector<int> mInSlots;
+
+    //! Smallest arc cost per unit of straight line length
+    double mCostPerDistance;
+};
+
+#endif // QGSCOMPACTGRAPHH
@@ -0,0 +1,616 @@
+/***************************************************************************
+  qgscontractionhierarchy.cpp
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#include "qgscontractionhierarchy.h"
+#include "qgscompactgraph.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+///@cond PRIVATE
+
+static const quint32 HIERARCHY_MAGIC = 0x51434831; // "QCH1"
+static const quint32 HIERARCHY_VERSION = 1;
+
+// number of vertices a witness search may settle before giving up and adding the shortcut
+static const int WITNESS_SETTLE_LIMIT = 500;
+
+typedef QPair< double, int > QgsHierarchyQueueItem;
+typedef std::priority_queue< QgsHierarchyQueueItem, std::vector< QgsHierarchyQueueItem >, std::greater< QgsHierarchyQueueItem > > QgsHierarchyQueue;
+
+static void removeArc( QVector<int>& arcs, int arcIdx )
+{
+  int i = arcs.indexOf( arcIdx );
+  if ( i >= 0 )
+    arcs.remove( i );
+}
+
+/**
+ * Contracts the vertices of a graph, from the least to the most important
+ */
+class QgsHierarchyBuilder
+{
+  public:
+    explicit QgsHierarchyBuilder( const QgsCompactGraph* graph );
+
+    //! Contracts every vertex and returns the contraction order of each vertex
+    QVector<int> contract();
+
+    // arcs of the hierarchy
+    QVector<int> arcTail;
+    QVector<int> arcHead;
+    QVector<double> arcCost;
+    QVector<int> arcSourceId;
+    QVector<int> arcFirst;
+    QVector<int> arcSecond;
+
+  private:
+    //! Adds an arc, or lowers the cost of the existing arc between the same vertices
+    void addArc( int from, int to, double cost, int sourceId, int first, int second );
+
+    /**
+     * Finds the shortcuts needed to contract a vertex and adds them unless simulating
+     * @returns number of shortcuts
+     */
+    int contractVertex( int vertex, bool simulate );
+
+    //! Contraction priority of a vertex, lowest first
+    int priority( int vertex );
+
+    //! Shortest path costs from a vertex not going through an excluded vertex, up to maxCost
+    void witnessSearch( int from, int excluded, double maxCost, QHash<int, double>& cost ) const;
+
+    //! Arcs leaving and entering each vertex not contracted yet
+    QVector< QVector<int> > mOut;
+    QVector< QVector<int> > mIn;
+    QVector<int> mContractedNeighbours;
+};
+
+QgsHierarchyBuilder::QgsHierarchyBuilder( const QgsCompactGraph* graph )
+    : mOut( graph->vertexCount() )
+    , mIn( graph->vertexCount() )
+    , mContractedNeighbours( graph->vertexCount(), 0 )
+{
+  for ( int slot = 0; slot < graph->arcCount(); ++slot )
+  {
+    int tail = graph->arcTail( slot );
+    int head = graph->arcHead( slot );
+    if ( tail == head )
+      continue;
+
+    addArc( tail, head, graph->arcCost( slot ), graph->arcId( slot ), -1, -1 );
+  }
+}
+
+void QgsHierarchyBuilder::addArc( int from, int to, double cost, int sourceId, int first, int second )
+{
+  const QVector<int>& out = mOut.at( from );
+  for ( int i = 0; i < out.size(); ++i )
+  {
+    int arcIdx = out.at( i );
+    if ( arcHead.at( arcIdx ) != to )
+      continue;
+
+    if ( cost < arcCost.at( arcIdx ) )
+    {
+      arcCost[ arcIdx ] = cost;
+      arcSourceId[ arcIdx ] = sourceId;
+      arcFirst[ arcIdx ] = first;
+      arcSecond[ arcIdx ] = second;
+    }
+    return;
+  }
+
+  int arcIdx = arcTail.size();
+  arcTail.append( from );
+  arcHead.append( to );
+  arcCost.append( cost );
+  arcSourceId.append( sourceId );
+  arcFirst.append( first );
+  arcSecond.append( second );
+  mOut[ from ].append( arcIdx );
+  mIn[ to ].append( arcIdx );
+}
+
+void QgsHierarchyBuilder::witnessSearch( int from, int excluded, double maxCost, QHash<int, double>& cost ) const
+{
+  cost.clear();
+  cost.insert( from, 0.0 );
+
+  QgsHierarchyQueue queue;
+  queue.push( QgsHierarchyQueueItem( 0.0, from ) );
+
+  int settled = 0;
+  while ( !queue.empty() )
+  {
+    QgsHierarchyQueueItem item = queue.top();
+    queue.pop();
+
+    if ( item.first > cost.value( item.second ) )
+      continue; // ignore previously added cost which is actually higher
+    if ( item.first > maxCost || ++settled > WITNESS_SETTLE_LIMIT )
+      break;
+
+    const QVector<int>& out = mOut.at( item.second );
+    for ( int i = 0; i < out.size(); ++i )
+    {
+      int arcIdx = out.at( i );
+      int to = arcHead.at( arcIdx );
+      if ( to == excluded )
+        continue;
+
+      double newCost = item.first + arcCost.at( arcIdx );
+      QHash<int, double>::iterator it = cost.find( to );
+      if ( it == cost.end() )
+      {
+        cost.insert( to, newCost );
+        queue.push( QgsHierarchyQueueItem( newCost, to ) );
+      }
+      else if ( newCost < it.value() )
+      {
+        it.value() = newCost;
+        queue.push( QgsHierarchyQueueItem( newCost, to ) );
+      }
+    }
+  }
+}
+
+int QgsHierarchyBuilder::contractVertex( int vertex, bool simulate )
+{
+  const QVector<int> in = mIn.at( vertex );
+  const QVector<int> out = mOut.at( vertex );
+
+  double maxOutCost = 0.0;
+  Q_FOREACH ( int outArc, out )
+    maxOutCost = qMax( maxOutCost, arcCost.at( outArc ) );
+
+  int shortcuts = 0;
+  QHash<int, double> witnessCost;
+  Q_FOREACH ( int inArc, in )
+  {
+    int from = arcTail.at( inArc );
+    double inCost = arcCost.at( inArc );
+    witnessSearch( from, vertex, inCost + maxOutCost, witnessCost );
+
+    Q_FOREACH ( int outArc, out )
+    {
+      int to = arcHead.at( outArc );
+      if ( to == from )
+        continue;
+
+      // a path avoiding the vertex is as good as going through it
+      double viaCost = inCost + arcCost.at( outArc );
+      QHash<int, double>::const_iterator it = witnessCost.constFind( to );
+      if ( it != witnessCost.constEnd() && it.value() <= viaCost )
+        continue;
+
+      ++shortcuts;
+      if ( !simulate )
+        addArc( from, to, viaCost, -1, inArc, outArc );
+    }
+  }
+
+  if ( !simulate )
+  {
+    Q_FOREACH ( int inArc, in )
+    {
+      removeArc( mOut[ arcTail.at( inArc )], inArc );
+      ++mContractedNeighbours[ arcTail.at( inArc )];
+    }
+    Q_FOREACH ( int outArc, out )
+    {
+      removeArc( mIn[ arcHead.at( outArc )], outArc );
+      ++mContractedNeighbours[ arcHead.at( outArc )];
+    }
+    mIn[ vertex ].clear();
+    mOut[ vertex ].clear();
+  }
+
+  return shortcuts;
+}
+
+int QgsHierarchyBuilder::priority( int vertex )
+{
+  // edge difference, plus contracted neighbours to spread contractions over the graph
+  return contractVertex( vertex, true ) - mIn.at( vertex ).size() - mOut.at( vertex ).size() + mContractedNeighbours.at( vertex );
+}
+
+QVector<int> QgsHierarchyBuilder::contract()
+{
+  typedef QPair< int, int > PriorityItem;
+  std::priority_queue< PriorityItem, std::vector< PriorityItem >, std::greater< PriorityItem > > queue;
+
+  int vertexCount = mOut.size();
+  for ( int vertex = 0; vertex < vertexCount; ++vertex )
+  {
+    queue.push( PriorityItem( priority( vertex ), vertex ) );
+  }
+
+  QVector<int> rank( vertexCount, -1 );
+  int order = 0;
+  while ( !queue.empty() )
+  {
+    int vertex = queue.top().second;
+    queue.pop();
+
+    // priorities change as neighbours get contracted, update them lazily
+    int newPriority = priority( vertex );
+    if ( !queue.empty() && newPriority > queue.top().first )
+    {
+      queue.push( PriorityItem( newPriority, vertex ) );
+      continue;
+    }
+
+    contractVertex( vertex, false );
+    rank[ vertex ] = order++;
+  }
+  return rank;
+}
+
+/**
+ * Exhaustive search following the arcs of one of the search graphs of the hierarchy
+ * @param offsets offsets of the search graph arcs of each vertex
+ * @param arcs search graph arcs
+ * @param next vertex reached by each arc (head for upward arcs, tail for downward arcs)
+ * @param arcCost cost of each arc
+ * @param cost receives the cost of the reached vertices
+ * @param tree if not null, receives the arc leading to each reached vertex but the first one
+ */
+static void hierarchySearch( int vertex, const QVector<int>& offsets, const QVector<int>& arcs, const QVector<int>& next,
+                             const QVector<double>& arcCost, QHash<int, double>& cost, QHash<int, int>* tree )
+{
+  cost.clear();
+  cost.insert( vertex, 0.0 );
+
+  QgsHierarchyQueue queue;
+  queue.push( QgsHierarchyQueueItem( 0.0, vertex ) );
+
+  while ( !queue.empty() )
+  {
+    QgsHierarchyQueueItem item = queue.top();
+    queue.pop();
+
+    if ( item.first > cost.value( item.second ) )
+      continue; // ignore previously added cost which is actually higher
+
+    int end = offsets.at( item.second + 1 );
+    for ( int i = offsets.at( item.second ); i < end; ++i )
+    {
+      int arcIdx = arcs.at( i );
+      int to = next.at( arcIdx );
+      double newCost = item.first + arcCost.at( arcIdx );
+
+      QHash<int, double>::iterator it = cost.find( to );
+      if ( it == cost.end() || newCost < it.value() )
+      {
+        cost.insert( to, newCost );
+        if ( tree )
+          tree->insert( to, arcIdx );
+        queue.push( QgsHierarchyQueueItem( newCost, to ) );
+      }
+    }
+  }
+}
+
+///@endcond
+
+
+QgsContractionHierarchy::QgsContractionHierarchy()
+    : mValid( false )
+    , mSourceArcCount( 0 )
+{
+}
+
+QgsContractionHierarchy::QgsContractionHierarchy( const QgsGraph* graph, int criterionNum )
+    : mValid( false )
+    , mSourceArcCount( 0 )
+{
+  QgsCompactGraph compactGraph( graph, criterionNum );
+  build( &compactGraph );
+}
+
+QgsContractionHierarchy::QgsContractionHierarchy( const QgsCompactGraph* graph )
+    : mValid( false )
+    , mSourceArcCount( 0 )
+{
+  build( graph );
+}
+
+void QgsContractionHierarchy::build( const QgsCompactGraph* graph )
+{
+  QgsHierarchyBuilder builder( graph );
+  mRank = builder.contract();
+
+  mArcTail = builder.arcTail;
+  mArcHead = builder.arcHead;
+  mArcCost = builder.arcCost;
+  mArcSourceId = builder.arcSourceId;
+  mArcFirst = builder.arcFirst;
+  mArcSecond = builder.arcSecond;
+  mSourceArcCount = graph->arcCount();
+
+  // arcs to a higher rank are followed from their tail by forward searches,
+  // arcs from a higher rank from their head by backward searches
+  int vertexCount = mRank.size();
+  int arcCount = mArcTail.size();
+  mUpOffsets.fill( 0, vertexCount + 1 );
+  mDownOffsets.fill( 0, vertexCount + 1 );
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    if ( mRank.at( mArcTail.at( i ) ) < mRank.at( mArcHead.at( i ) ) )
+      ++mUpOffsets[ mArcTail.at( i ) + 1 ];
+    else
+      ++mDownOffsets[ mArcHead.at( i ) + 1 ];
+  }
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    mUpOffsets[ i + 1 ] += mUpOffsets[ i ];
+    mDownOffsets[ i + 1 ] += mDownOffsets[ i ];
+  }
+
+  mUpArcs.resize( mUpOffsets.last() );
+  mDownArcs.resize( mDownOffsets.last() );
+  QVector<int> upFill = mUpOffsets;
+  QVector<int> downFill = mDownOffsets;
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    if ( mRank.at( mArcTail.at( i ) ) < mRank.at( mArcHead.at( i ) ) )
+      mUpArcs[ upFill[ mArcTail.at( i )]++ ] = i;
+    else
+      mDownArcs[ downFill[ mArcHead.at( i )]++ ] = i;
+  }
+
+  mValid = true;
+}
+
+bool QgsContractionHierarchy::writeToFile( const QString& path ) const
+{
+  if ( !mValid )
+    return false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::WriteOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_4_8 );
+  stream << HIERARCHY_MAGIC << HIERARCHY_VERSION << static_cast< qint32 >( mSourceArcCount );
+  stream << mRank << mArcTail << mArcHead << mArcCost << mArcSourceId << mArcFirst << mArcSecond;
+  stream << mUpOffsets << mUpArcs << mDownOffsets << mDownArcs;
+
+  return stream.status() == QDataStream::Ok && file.error() == QFile::NoError;
+}
+
+bool QgsContractionHierarchy::readFromFile( const QString& path )
+{
+  mValid = false;
+
+  QFile file( path );
+  if ( !file.open( QIODevice::ReadOnly ) )
+    return false;
+
+  QDataStream stream( &file );
+  stream.setVersion( QDataStream::Qt_4_8 );
+
+  quint32 magic, version;
+  qint32 sourceArcCount;
+  stream >> magic >> version >> sourceArcCount;
+  if ( stream.status() != QDataStream::Ok || magic != HIERARCHY_MAGIC || version != HIERARCHY_VERSION )
+    return false;
+
+  stream >> mRank >> mArcTail >> mArcHead >> mArcCost >> mArcSourceId >> mArcFirst >> mArcSecond;
+  stream >> mUpOffsets >> mUpArcs >> mDownOffsets >> mDownArcs;
+  if ( stream.status() != QDataStream::Ok )
+    return false;
+
+  // reject truncated or inconsistent files
+  mSourceArcCount = sourceArcCount;
+  if ( !isConsistent() )
+    return false;
+
+  mValid = true;
+  return true;
+}
+
+bool QgsContractionHierarchy::isConsistent() const
+{
+  int vertexCount = mRank.size();
+  int arcCount = mArcTail.size();
+  if ( mSourceArcCount < 0
+       || mArcHead.size() != arcCount || mArcCost.size() != arcCount || mArcSourceId.size() != arcCount
+       || mArcFirst.size() != arcCount || mArcSecond.size() != arcCount
+       || mUpOffsets.size() != vertexCount + 1 || mDownOffsets.size() != vertexCount + 1
+       || mUpOffsets.first() != 0 || mDownOffsets.first() != 0
+       || mUpOffsets.last() != mUpArcs.size() || mDownOffsets.last() != mDownArcs.size() )
+    return false;
+
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    if ( mRank.at( i ) < 0 || mRank.at( i ) >= vertexCount )
+      return false;
+  }
+
+  for ( int i = 0; i < arcCount; ++i )
+  {
+    int tail = mArcTail.at( i );
+    int head = mArcHead.at( i );
+    if ( tail < 0 || tail >= vertexCount || head < 0 || head >= vertexCount || tail == head )
+      return false;
+
+    int first = mArcFirst.at( i );
+    int second = mArcSecond.at( i );
+    if ( first < 0 && second < 0 )
+    {
+      if ( mArcSourceId.at( i ) < 0 || mArcSourceId.at( i ) >= mSourceArcCount )
+        return false;
+      continue;
+    }
+
+    // the halves of a shortcut meet at a vertex contracted before both ends of the shortcut,
+    // which makes unpacking shortcuts end
+    if ( first < 0 || first >= arcCount || second < 0 || second >= arcCount
+         || mArcTail.at( first ) != tail || mArcHead.at( second ) != head
+         || mArcHead.at( first ) != mArcTail.at( second )
+         || mRank.at( mArcHead.at( first ) ) >= qMin( mRank.at( tail ), mRank.at( head ) ) )
+      return false;
+  }
+
+  // searches only climb the hierarchy, which makes building their paths back end
+  for ( int i = 0; i < vertexCount; ++i )
+  {
+    if ( mUpOffsets.at( i ) > mUpOffsets.at( i + 1 ) || mDownOffsets.at( i ) > mDownOffsets.at( i + 1 ) )
+      return false;
+
+    for ( int j = mUpOffsets.at( i ); j < mUpOffsets.at( i + 1 ); ++j )
+    {
+      int arc = mUpArcs.at( j );
+      if ( arc < 0 || arc >= arcCount || mArcTail.at( arc ) != i || mRank.at( mArcHead.at( arc ) ) <= mRank.at( i ) )
+        return false;
+    }
+    for ( int j = mDownOffsets.at( i ); j < mDownOffsets.at( i + 1 ); ++j )
+    {
+      int arc = mDownArcs.at( j );
+      if ( arc < 0 || arc >= arcCount || mArcHead.at( arc ) != i || mRank.at( mArcTail.at( arc ) ) <= mRank.at( i ) )
+        return false;
+    }
+  }
+
+  return true;
+}
+
+void QgsContractionHierarchy::unpackArc( int arcIdx, QgsGraphArcIdList& path ) const
+{
+  QVector<int> stack;
+  stack << arcIdx;
+  while ( !stack.isEmpty() )
+  {
+    int arc = stack.last();
+    stack.pop_back();
+    if ( mArcFirst.at( arc ) < 0 )
+    {
+      path << mArcSourceId.at( arc );
+    }
+    else
+    {
+      stack << mArcSecond.at( arc ) << mArcFirst.at( arc );
+    }
+  }
+}
+
+QgsGraphArcIdList QgsContractionHierarchy::shortestPath( int startVertexIdx, int endVertexIdx, double* resultCost ) const
+{
+  QgsGraphArcIdList path;
+  double best = std::numeric_limits<double>::infinity();
+
+  if ( mValid && startVertexIdx >= 0 && startVertexIdx < vertexCount() && endVertexIdx >= 0 && endVertexIdx < vertexCount() )
+  {
+    QHash<int, double> forwardCost, backwardCost;
+    QHash<int, int> forwardTree, backwardTree;
+    hierarchySearch( startVertexIdx, mUpOffsets, mUpArcs, mArcHead, mArcCost, forwardCost, &forwardTree );
+    hierarchySearch( endVertexIdx, mDownOffsets, mDownArcs, mArcTail, mArcCost, backwardCost, &backwardTree );
+
+    // both searches climb to the highest vertex of the shortest path
+    int meetVertex = -1;
+    QHash<int, double>::const_iterator it = forwardCost.constBegin();
+    for ( ; it != forwardCost.constEnd(); ++it )
+    {
+      QHash<int, double>::const_iterator backwardIt = backwardCost.constFind( it.key() );
+      if ( backwardIt != backwardCost.constEnd() && it.value() + backwardIt.value() < best )
+      {
+        best = it.value() + backwardIt.value();
+        meetVertex = it.key();
+      }
+    }
+
+    if ( meetVertex >= 0 )
+    {
+      QgsGraphArcIdList upArcs;
+      for ( int vertex = meetVertex; vertex != startVertexIdx; vertex = mArcTail.at( upArcs.first() ) )
+        upArcs.prepend( forwardTree.value( vertex ) );
+      Q_FOREACH ( int arcIdx, upArcs )
+        unpackArc( arcIdx, path );
+
+      for ( int vertex = meetVertex; vertex != endVertexIdx; )
+      {
+        int arcIdx = backwardTree.value( vertex );
+        unpackArc( arcIdx, path );
+        vertex = mArcHead.at( arcIdx );
+      }
+    }
+  }
+
+  if ( resultCost )
+    *resultCost = best;
+  return path;
+}
+
+QVector<double> QgsContractionHierarchy::costs( int startVertexIdx, const QVector<int>& endVertexIdxs ) const
+{
+  return costMatrix( QVector<int>() << startVertexIdx, endVertexIdxs ).first();
+}
+
+QVector< QVector<double> > QgsContractionHierarchy::costMatrix( const QVector<int>& startVertexIdxs, const QVector<int>& endVertexIdxs ) const
+{
+  QVector< QVector<double> > matrix( startVertexIdxs.size(), QVector<double>( endVertexIdxs.size(), std::numeric_limits<double>::infinity() ) );
+  if ( !mValid )
+    return matrix;
+
+  // each end vertex leaves its cost in a bucket of every vertex its backward search reaches
+  QHash< int, QVector< QPair<int, double> > > buckets;
+  QHash<int, double> cost;
+  for ( int j = 0; j < endVertexIdxs.size(); ++j )
+  {
+    int endVertexIdx = endVertexIdxs.at( j );
+    if ( endVertexIdx < 0 || endVertexIdx >= vertexCount() )
+      continue;
+
+    hierarchySearch( endVertexIdx, mDownOffsets, mDownArcs, mArcTail, mArcCost, cost, nullptr );
+    for ( QHash<int, double>::const_iterator it = cost.constBegin(); it != cost.constEnd(); ++it )
+      buckets[ it.key()].append( qMakePair( j, it.value() ) );
+  }
+
+  // forward searches collect the buckets they meet
+  for ( int i = 0; i < startVertexIdxs.size(); ++i )
+  {
+    int startVertexIdx = startVertexIdxs.at( i );
+    if ( startVertexIdx < 0 || startVertexIdx >= vertexCount() )
+      continue;
+
+    hierarchySearch( startVertexIdx, mUpOffsets, mUpArcs, mArcHead, mArcCost, cost, nullptr );
+    QVector<double>& row = matrix[ i ];
+    for ( QHash<int, double>::const_iterator it = cost.constBegin(); it != cost.constEnd(); ++it )
+    {
+      QHash< int, QVector< QPair<int, double> > >::const_iterator bucketIt = buckets.constFind( it.key() );
+      if ( bucketIt == buckets.constEnd() )
+        continue;
+
+      const QVector< QPair<int, double> >& bucket = bucketIt.value();
+      for ( int k = 0; k < bucket.size(); ++k )
+      {
+        double pathCost = it.value() + bucket.at( k ).second;
+        if ( pathCost < row.at( bucket.at( k ).first ) )
+          row[ bucket.at( k ).first ] = pathCost;
+      }
+    }
+  }
+
+  return matrix;
+}
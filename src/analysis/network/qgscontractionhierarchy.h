@@ -0,0 +1,151 @@
+/***************************************************************************
+  qgscontractionhierarchy.h
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+****************************************************************************
+*                                                                          *
+*   This program is free software; you can redistribute it and/or modify   *
+*   it under the terms of the GNU General Public License as published by   *
+*   the Free Software Foundation; either version 2 of the License, or      *
+*   (at your option) any later version.                                    *
+*                                                                          *
+***************************************************************************/
+
+#ifndef QGSCONTRACTIONHIERARCHYH
+#define QGSCONTRACTIONHIERARCHYH
+
+// QT includes
+#include <QString>
+#include <QVector>
+
+// QGIS includes
+#include "qgsgraph.h"
+
+class QgsCompactGraph;
+
+/**
+ * \ingroup networkanalysis
+ * \class QgsContractionHierarchy
+ * \brief Shortest path index for repeated queries on the same graph.
+ *
+ * Building the hierarchy contracts the vertices of the graph one at a time, from the least
+ * to the most important, adding shortcut arcs which preserve the shortest path costs between
+ * the remaining vertices. A query then only runs two small searches climbing the hierarchy,
+ * from the start and from the end vertices, which settle a few hundred vertices even on large
+ * road networks.
+ *
+ * The hierarchy is built for a single criterion (the arc property set by a QgsArcProperter)
+ * and can be written to a file and read back, so the preprocessing is only done once per
+ * network. Returned arc indexes refer to the QgsGraph the hierarchy was built from.
+ *
+ * @note added in QGIS 2.99
+ */
+class ANALYSIS_EXPORT QgsContractionHierarchy
+{
+  public:
+
+    //! Constructor for an empty hierarchy, see readFromFile()
+    QgsContractionHierarchy();
+
+    /**
+     * Builds the hierarchy of a graph
+     * @param graph source graph
+     * @param criterionNum index of arc property used as arc cost
+     */
+    QgsContractionHierarchy( const QgsGraph* graph, int criterionNum );
+
+    /**
+     * Builds the hierarchy of a compact graph, using the arc costs of the compact graph
+     * @param graph source graph
+     */
+    explicit QgsContractionHierarchy( const QgsCompactGraph* graph );
+
+    //! Returns true if the hierarchy has been built or read
+    bool isValid() const { return mValid; }
+
+    //! Returns the number of vertices of the source graph
+    int vertexCount() const { return mRank.size(); }
+
+    //! Returns the number of arcs of the source graph
+    int sourceArcCount() const { return mSourceArcCount; }
+
+    /**
+     * Writes the hierarchy to a file
+     * @returns true in case of success
+     * @see readFromFile()
+     */
+    bool writeToFile( const QString& path ) const;
+
+    /**
+     * Reads a hierarchy written by writeToFile(). The caller should make sure it belongs
+     * to the current graph, e.g. by comparing vertexCount() and sourceArcCount().
+     * @returns true in case of success
+     */
+    bool readFromFile( const QString& path );
+
+    /**
+     * Returns the shortest path between two vertices
+     * @param startVertexIdx index of start vertex
+     * @param endVertexIdx index of end vertex
+     * @param resultCost if not null, receives the cost of the path, infinity if there is no path
+     * @returns indexes of the path arcs in the source graph, from start to end
+     */
+    QgsGraphArcIdList shortestPath( int startVertexIdx, int endVertexIdx, double* resultCost = nullptr ) const;
+
+    /**
+     * Returns the costs of the shortest paths from a vertex to several vertices
+     * @param startVertexIdx index of start vertex
+     * @param endVertexIdxs indexes of end vertices
+     * @returns path costs in the order of endVertexIdxs, infinity for unreachable vertices
+     */
+    QVector<double> costs( int startVertexIdx, const QVector<int>& endVertexIdxs ) const;
+
+    /**
+     * Returns the origin-destination cost matrix of two sets of vertices
+     * @param startVertexIdxs indexes of start vertices
+     * @param endVertexIdxs indexes of end vertices
+     * @returns one row of path costs per start vertex, in the order of endVertexIdxs,
+     * infinity for unreachable pairs
+     * @note not available in Python bindings
+     */
+    QVector< QVector<double> > costMatrix( const QVector<int>& startVertexIdxs, const QVector<int>& endVertexIdxs ) const;
+
+  private:
+
+    //! Contracts the vertices of a graph and fills the search graphs
+    void build( const QgsCompactGraph* graph );
+
+    /** Checks that the arrays read from a file have matching sizes and hold indexes of existing
+     * vertices and arcs, and that shortcuts and searches follow the order of the hierarchy */
+    bool isConsistent() const;
+
+    //! Appends the source graph arcs of an arc of the hierarchy, shortcuts included, to path
+    void unpackArc( int arcIdx, QgsGraphArcIdList& path ) const;
+
+    bool mValid;
+    int mSourceArcCount;
+
+    //! Contraction order of each vertex
+    QVector<int> mRank;
+
+    // arcs of the hierarchy, source graph arcs and shortcuts
+    QVector<int> mArcTail;
+    QVector<int> mArcHead;
+    QVector<double> mArcCost;
+    //! Source graph arc index, -1 for shortcuts
+    QVector<int> mArcSourceId;
+    //! First and second halves of shortcuts, -1 for source graph arcs
+    QVector<int> mArcFirst;
+    QVector<int> mArcSecond;
+
+    //! Arcs going from each vertex to a vertex of higher rank, in compressed sparse row form
+    QVector<int> mUpOffsets;
+    QVector<int> mUpArcs;
+
+    //! Arcs coming to each vertex from a vertex of higher rank, in compressed sparse row form
+    QVector<int> mDownOffsets;
+    QVector<int> mDownArcs;
+};
+
+#endif // QGSCONTRACTIONHIERARCHYH
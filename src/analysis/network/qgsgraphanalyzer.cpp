@@ -18,14 +18,257 @@
 #include <limits>
 
 // QT includes
-#include <QMap>
 #include <QVector>
-#include <QPair>
 
 //QGIS-uncludes
 #include "qgsgraph.h"
+#include "qgscompactgraph.h"
 #include "qgsgraphanalyzer.h"
 
+///@cond PRIVATE
+
+/**
+ * Binary min heap of vertices supporting decrease key
+ */
+class QgsGraphHeap
+{
+  public:
+    explicit QgsGraphHeap( int vertexCount )
+        : mPosition( vertexCount, -1 )
+    {}
+
+    bool isEmpty() const { return mHeap.isEmpty(); }
+
+    //! Returns the smallest key of the heap
+    double topKey() const { return mHeap.first().key; }
+
+    //! Removes the vertex with the smallest key and returns it
+    int pop()
+    {
+      int vertex = mHeap.first().vertex;
+      mPosition[ vertex ] = -1;
+      Entry last = mHeap.last();
+      mHeap.pop_back();
+      if ( !mHeap.isEmpty() )
+      {
+        mHeap[ 0 ] = last;
+        mPosition[ last.vertex ] = 0;
+        siftDown( 0 );
+      }
+      return vertex;
+    }
+
+    //! Inserts a vertex, or lowers its key if it is already in the heap
+    void push( int vertex, double key )
+    {
+      int i = mPosition.at( vertex );
+      if ( i < 0 )
+      {
+        Entry entry;
+        entry.key = key;
+        entry.vertex = vertex;
+        i = mHeap.size();
+        mHeap.append( entry );
+        mPosition[ vertex ] = i;
+      }
+      else if ( key < mHeap.at( i ).key )
+      {
+        mHeap[ i ].key = key;
+      }
+      else
+      {
+        return;
+      }
+      siftUp( i );
+    }
+
+  private:
+    struct Entry
+    {
+      double key;
+      int vertex;
+    };
+
+    void siftUp( int i )
+    {
+      Entry entry = mHeap.at( i );
+      while ( i > 0 )
+      {
+        int parent = ( i - 1 ) / 2;
+        if ( !( entry.key < mHeap.at( parent ).key ) )
+          break;
+        mHeap[ i ] = mHeap.at( parent );
+        mPosition[ mHeap.at( i ).vertex ] = i;
+        i = parent;
+      }
+      mHeap[ i ] = entry;
+      mPosition[ entry.vertex ] = i;
+    }
+
+    void siftDown( int i )
+    {
+      Entry entry = mHeap.at( i );
+      int count = mHeap.size();
+      Q_FOREVER
+      {
+        int child = 2 * i + 1;
+        if ( child >= count )
+          break;
+        if ( child + 1 < count && mHeap.at( child + 1 ).key < mHeap.at( child ).key )
+          ++child;
+        if ( !( mHeap.at( child ).key < entry.key ) )
+          break;
+        mHeap[ i ] = mHeap.at( child );
+        mPosition[ mHeap.at( i ).vertex ] = i;
+        i = child;
+      }
+      mHeap[ i ] = entry;
+      mPosition[ entry.vertex ] = i;
+    }
+
+    QVector<Entry> mHeap;
+    QVector<int> mPosition;
+};
+
+/**
+ * Single direction search on a compact graph. Settles vertices by increasing cost
+ * plus lower bound to the end vertex, stops when the end vertex is settled.
+ * @param endVertexIdx end vertex, -1 to compute the full shortest path tree
+ * @param useBound guide the search with the cost lower bound of the graph (A*)
+ * @param cost receives the cost of the reached vertices
+ * @param tree receives the slot of the arc entering each reached vertex, -1 for others
+ */
+static void searchCompactGraph( const QgsCompactGraph* source, int startVertexIdx, int endVertexIdx, bool useBound,
+                                QVector<double>& cost, QVector<int>& tree )
+{
+  int vertexCount = source->vertexCount();
+  cost.fill( std::numeric_limits<double>::infinity(), vertexCount );
+  tree.fill( -1, vertexCount );
+  cost[ startVertexIdx ] = 0.0;
+
+  QgsGraphHeap heap( vertexCount );
+  heap.push( startVertexIdx, useBound ? source->costLowerBound( startVertexIdx, endVertexIdx ) : 0.0 );
+
+  while ( !heap.isEmpty() )
+  {
+    int curVertex = heap.pop();
+    if ( curVertex == endVertexIdx )
+      break;
+
+    double curCost = cost.at( curVertex );
+    int arcEnd = source->outArcEnd( curVertex );
+    for ( int slot = source->outArcBegin( curVertex ); slot < arcEnd; ++slot )
+    {
+      int head = source->arcHead( slot );
+      double newCost = curCost + source->arcCost( slot );
+      if ( newCost < cost.at( head ) )
+      {
+        cost[ head ] = newCost;
+        tree[ head ] = slot;
+        heap.push( head, useBound ? newCost + source->costLowerBound( head, endVertexIdx ) : newCost );
+      }
+    }
+  }
+}
+
+/**
+ * Bidirectional search on a compact graph
+ * @returns cost of the shortest path, infinity if there is none
+ */
+static double bidirectionalSearch( const QgsCompactGraph* source, int startVertexIdx, int endVertexIdx, QgsGraphArcIdList& path )
+{
+  int vertexCount = source->vertexCount();
+  double infinity = std::numeric_limits<double>::infinity();
+
+  // forward search from the start, backward search from the end
+  QVector<double> costForward( vertexCount, infinity );
+  QVector<double> costBackward( vertexCount, infinity );
+  QVector<int> treeForward( vertexCount, -1 );
+  QVector<int> treeBackward( vertexCount, -1 );
+  QgsGraphHeap heapForward( vertexCount );
+  QgsGraphHeap heapBackward( vertexCount );
+
+  costForward[ startVertexIdx ] = 0.0;
+  costBackward[ endVertexIdx ] = 0.0;
+  heapForward.push( startVertexIdx, 0.0 );
+  heapBackward.push( endVertexIdx, 0.0 );
+
+  double best = infinity;
+  int meetVertex = -1;
+
+  while ( !heapForward.isEmpty() && !heapBackward.isEmpty() )
+  {
+    // no path through unsettled vertices can beat the best one found
+    if ( heapForward.topKey() + heapBackward.topKey() >= best )
+      break;
+
+    if ( heapForward.topKey() <= heapBackward.topKey() )
+    {
+      int curVertex = heapForward.pop();
+      double curCost = costForward.at( curVertex );
+      int arcEnd = source->outArcEnd( curVertex );
+      for ( int slot = source->outArcBegin( curVertex ); slot < arcEnd; ++slot )
+      {
+        int head = source->arcHead( slot );
+        double newCost = curCost + source->arcCost( slot );
+        if ( newCost < costForward.at( head ) )
+        {
+          costForward[ head ] = newCost;
+          treeForward[ head ] = slot;
+          heapForward.push( head, newCost );
+          if ( newCost + costBackward.at( head ) < best )
+          {
+            best = newCost + costBackward.at( head );
+            meetVertex = head;
+          }
+        }
+      }
+    }
+    else
+    {
+      int curVertex = heapBackward.pop();
+      double curCost = costBackward.at( curVertex );
+      int arcEnd = source->inArcEnd( curVertex );
+      for ( int i = source->inArcBegin( curVertex ); i < arcEnd; ++i )
+      {
+        int slot = source->inArcSlot( i );
+        int tail = source->arcTail( slot );
+        double newCost = curCost + source->arcCost( slot );
+        if ( newCost < costBackward.at( tail ) )
+        {
+          costBackward[ tail ] = newCost;
+          treeBackward[ tail ] = slot;
+          heapBackward.push( tail, newCost );
+          if ( newCost + costForward.at( tail ) < best )
+          {
+            best = newCost + costForward.at( tail );
+            meetVertex = tail;
+          }
+        }
+      }
+    }
+  }
+
+  if ( meetVertex < 0 )
+    return infinity;
+
+  for ( int vertex = meetVertex; vertex != startVertexIdx; )
+  {
+    int slot = treeForward.at( vertex );
+    path.prepend( source->arcId( slot ) );
+    vertex = source->arcTail( slot );
+  }
+  for ( int vertex = meetVertex; vertex != endVertexIdx; )
+  {
+    int slot = treeBackward.at( vertex );
+    path.append( source->arcId( slot ) );
+    vertex = source->arcHead( slot );
+  }
+  return best;
+}
+
+///@endcond
+
 void QgsGraphAnalyzer::dijkstra( const QgsGraph* source, int startPointIdx, int criterionNum, QVector<int>* resultTree, QVector<double>* resultCost )
 {
   QVector< double > * result = nullptr;
@@ -48,26 +291,20 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph* source, int startPointIdx, int
     resultTree->insert( resultTree->begin(), source->vertexCount(), -1 );
   }
 
-  // QMultiMap< cost, vertexIdx > not_begin
-  // I use it and not create any struct or class.
-  QMultiMap< double, int > not_begin;
-  QMultiMap< double, int >::iterator it;
-
-  not_begin.insert( 0.0, startPointIdx );
+  QgsGraphHeap not_begin( source->vertexCount() );
+  not_begin.push( startPointIdx, 0.0 );
 
-  while ( !not_begin.empty() )
+  while ( !not_begin.isEmpty() )
   {
-    it = not_begin.begin();
-    double curCost = it.key();
-    int curVertex = it.value();
-    not_begin.erase( it );
+    double curCost = not_begin.topKey();
+    int curVertex = not_begin.pop();
 
     // edge index list
-    QgsGraphArcIdList l = source->vertex( curVertex ).outArc();
-    QgsGraphArcIdList::iterator arcIt;
-    for ( arcIt = l.begin(); arcIt != l.end(); ++arcIt )
+    const QgsGraphArcIdList l = source->vertex( curVertex ).outArc();
+    QgsGraphArcIdList::const_iterator arcIt;
+    for ( arcIt = l.constBegin(); arcIt != l.constEnd(); ++arcIt )
     {
-      const QgsGraphArc arc = source->arc( *arcIt );
+      const QgsGraphArc& arc = source->arc( *arcIt );
       double cost = arc.property( criterionNum ).toDouble() + curCost;
 
       if ( cost < ( *result )[ arc.inVertex()] )
@@ -77,7 +314,7 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph* source, int startPointIdx, int
         {
           ( *resultTree )[ arc.inVertex()] = *arcIt;
         }
-        not_begin.insert( cost, arc.inVertex() );
+        not_begin.push( arc.inVertex(), cost );
       }
     }
   }
@@ -87,6 +324,68 @@ void QgsGraphAnalyzer::dijkstra( const QgsGraph* source, int startPointIdx, int
   }
 }
 
+void QgsGraphAnalyzer::dijkstra( const QgsCompactGraph* source, int startVertexIdx, QVector<int>* resultTree, QVector<double>* resultCost )
+{
+  QVector<double> cost;
+  QVector<int> tree;
+  searchCompactGraph( source, startVertexIdx, -1, false, cost, tree );
+
+  if ( resultTree )
+  {
+    // arc slots to source graph arc indexes
+    for ( int i = 0; i < tree.size(); ++i )
+    {
+      if ( tree.at( i ) != -1 )
+        tree[ i ] = source->arcId( tree.at( i ) );
+    }
+    *resultTree = tree;
+  }
+  if ( resultCost )
+  {
+    *resultCost = cost;
+  }
+}
+
+QgsGraphArcIdList QgsGraphAnalyzer::shortestPath( const QgsCompactGraph* source, int startVertexIdx, int endVertexIdx, PathAlgorithm algorithm, double* resultCost )
+{
+  QgsGraphArcIdList path;
+  double cost = std::numeric_limits<double>::infinity();
+
+  if ( startVertexIdx < 0 || startVertexIdx >= source->vertexCount() || endVertexIdx < 0 || endVertexIdx >= source->vertexCount() )
+  {
+    // invalid vertex, no path
+  }
+  else if ( startVertexIdx == endVertexIdx )
+  {
+    cost = 0.0;
+  }
+  else if ( algorithm == BidirectionalDijkstra )
+  {
+    cost = bidirectionalSearch( source, startVertexIdx, endVertexIdx, path );
+  }
+  else
+  {
+    QVector<double> costs;
+    QVector<int> tree;
+    searchCompactGraph( source, startVertexIdx, endVertexIdx, algorithm == AStar, costs, tree );
+
+    if ( tree.at( endVertexIdx ) != -1 )
+    {
+      cost = costs.at( endVertexIdx );
+      for ( int vertex = endVertexIdx; vertex != startVertexIdx; )
+      {
+        int slot = tree.at( vertex );
+        path.prepend( source->arcId( slot ) );
+        vertex = source->arcTail( slot );
+      }
+    }
+  }
+
+  if ( resultCost )
+    *resultCost = cost;
+  return path;
+}
+
 QgsGraph* QgsGraphAnalyzer::shortestTree( const QgsGraph* source, int startVertexIdx, int criterionNum )
 {
   QgsGraph *treeResult = new QgsGraph();
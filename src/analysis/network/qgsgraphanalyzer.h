@@ -21,8 +21,11 @@
 //QT-includes
 #include <QVector>
 
+//QGIS-includes
+#include "qgsgraph.h"
+
 // forward-declaration
-class QgsGraph;
+class QgsCompactGraph;
 
 /** \ingroup networkanalysis
  * The QGis class provides graph analysis functions
@@ -31,6 +34,18 @@ class QgsGraph;
 class ANALYSIS_EXPORT QgsGraphAnalyzer
 {
   public:
+
+    /**
+     * Algorithms available for point to point shortest path queries
+     * @note added in QGIS 2.99
+     */
+    enum PathAlgorithm
+    {
+      Dijkstra, //!< Dijkstra algorithm, stopped once the end vertex is reached
+      AStar, //!< A* algorithm, guided by the straight line distance to the end vertex
+      BidirectionalDijkstra //!< Dijkstra algorithm run from both ends until the searches meet
+    };
+
     /**
      * solve shortest path problem using dijkstra algorithm
      * @param source The source graph
@@ -48,5 +63,29 @@ class ANALYSIS_EXPORT QgsGraphAnalyzer
      * @param criterionNum index of edge property as optimization criterion
      */
     static QgsGraph* shortestTree( const QgsGraph* source, int startVertexIdx, int criterionNum );
+
+    /**
+     * solve shortest path problem on a compact graph using dijkstra algorithm
+     * @param source The source graph
+     * @param startVertexIdx index of start vertex
+     * @param resultTree array represents the shortest path tree. resultTree[ vertexIndex ] == inboundingArcIndex if vertex reacheble and resultTree[ vertexIndex ] == -1 others.
+     * Arc indexes are the ones of the graph the compact graph was built from.
+     * @param resultCost array of cost paths
+     * @note added in QGIS 2.99
+     */
+    static void dijkstra( const QgsCompactGraph* source, int startVertexIdx, QVector<int>* resultTree = nullptr, QVector<double>* resultCost = nullptr );
+
+    /**
+     * return the shortest path between two vertices of a compact graph
+     * @param source The source graph
+     * @param startVertexIdx index of start vertex
+     * @param endVertexIdx index of end vertex
+     * @param algorithm search algorithm
+     * @param resultCost if not null, receives the cost of the path, infinity if there is no path
+     * @returns indexes of the path arcs in the graph the compact graph was built from, from start to end.
+     * The list is empty if there is no path or if start and end are the same vertex.
+     * @note added in QGIS 2.99
+     */
+    static QgsGraphArcIdList shortestPath( const QgsCompactGraph* source, int startVertexIdx, int endVertexIdx, PathAlgorithm algorithm = AStar, double* resultCost = nullptr );
 };
 #endif //QGSGRAPHANALYZERH
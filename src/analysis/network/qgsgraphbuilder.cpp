@@ -16,6 +16,7 @@
 
 #include "qgsgraphbuilder.h"
 #include "qgsgraph.h"
+#include "qgscompactgraph.h"
 
 // Qgis includes
 #include <qgsfeature.h>
@@ -48,3 +49,11 @@ QgsGraph* QgsGraphBuilder::graph()
   mGraph = nullptr;
   return res;
 }
+
+QgsCompactGraph* QgsGraphBuilder::compactGraph( int criterionNum ) const
+{
+  if ( !mGraph )
+    return nullptr;
+
+  return new QgsCompactGraph( mGraph, criterionNum );
+}
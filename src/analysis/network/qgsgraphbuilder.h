@@ -26,6 +26,7 @@
 class QgsDistanceArea;
 class QgsCoordinateTransform;
 class QgsGraph;
+class QgsCompactGraph;
 
 /**
 * \ingroup networkanalysis
@@ -55,6 +56,15 @@ class ANALYSIS_EXPORT QgsGraphBuilder : public QgsGraphBuilderInterface
      */
     QgsGraph* graph();
 
+    /**
+     * Returns the built graph in compact form, see QgsCompactGraph. Unlike graph(),
+     * the builder keeps its graph so both forms can be retrieved.
+     * @param criterionNum index of arc property used as arc cost
+     * @returns new compact graph, or nullptr if graph() was already called
+     * @note added in QGIS 2.99
+     */
+    QgsCompactGraph* compactGraph( int criterionNum ) const;
+
   private:
 
     QgsGraph *mGraph;
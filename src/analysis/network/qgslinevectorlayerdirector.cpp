@@ -26,63 +26,91 @@
 #include <qgsdistancearea.h>
 #include <qgswkbtypes.h>
 
+#include <qgsspatialindex.h>
+
 // QT includes
+#include <QHash>
 #include <QString>
 #include <QtAlgorithms>
 
+#include <algorithm>
+#include <string.h>
+
 /** \ingroup analysis
- * \class QgsPointCompare
+ * \class QgsVertexKey
+ * Cell of the topology tolerance grid, or coordinates of a point if there is no tolerance
  */
-class QgsPointCompare
+struct QgsVertexKey
 {
-  public:
-    explicit QgsPointCompare( double tolerance )
-        : mTolerance( tolerance )
-    {  }
-
-    bool operator()( const QgsPoint& p1, const QgsPoint& p2 ) const
+  QgsVertexKey( const QgsPoint& pt, double tolerance )
+  {
+    // adding 0.0 turns -0.0 into 0.0, which has another hash
+    if ( tolerance <= 0 )
     {
-      if ( mTolerance <= 0 )
-        return p1.x() == p2.x() ? p1.y() < p2.y() : p1.x() < p2.x();
-
-      double tx1 = ceil( p1.x() / mTolerance );
-      double tx2 = ceil( p2.x() / mTolerance );
-      if ( tx1 == tx2 )
-        return ceil( p1.y() / mTolerance ) < ceil( p2.y() / mTolerance );
-      return tx1 < tx2;
+      x = pt.x() + 0.0;
+      y = pt.y() + 0.0;
     }
+    else
+    {
+      x = ceil( pt.x() / tolerance ) + 0.0;
+      y = ceil( pt.y() / tolerance ) + 0.0;
+    }
+  }
 
-  private:
-    double mTolerance;
+  bool operator==( const QgsVertexKey& other ) const
+  {
+    return x == other.x && y == other.y;
+  }
+
+  double x;
+  double y;
 };
 
-template <typename RandIter, typename Type, typename CompareOp > RandIter my_binary_search( RandIter begin, RandIter end, Type val, CompareOp comp )
+inline uint qHash( const QgsVertexKey& key )
 {
-  // result if not found
-  RandIter not_found = end;
+  quint64 x, y;
+  memcpy( &x, &key.x, sizeof( x ) );
+  memcpy( &y, &key.y, sizeof( y ) );
+  return qHash( x ) ^ ( qHash( y ) * 31 );
+}
 
-  while ( true )
-  {
-    RandIter avg = begin + ( end - begin ) / 2;
-    if ( begin == avg || end == avg )
-    {
-      if ( !comp( *begin, val ) && !comp( val, *begin ) )
-        return begin;
-      if ( !comp( *end, val ) && !comp( val, *end ) )
-        return end;
+/** \ingroup analysis
+ * \class QgsVertexIdMap
+ * Adds the vertices of the graph while the features are read. Points in the same cell of
+ * the topology tolerance grid share a vertex, which has the coordinates of the first of them.
+ */
+class QgsVertexIdMap
+{
+  public:
+    explicit QgsVertexIdMap( QgsGraphBuilderInterface* builder )
+        : mBuilder( builder )
+        , mTolerance( builder->topologyTolerance() )
+    {  }
 
-      return not_found;
+    //! Returns the id of the vertex of a point, adding the vertex to the graph if needed
+    int id( const QgsPoint& pt )
+    {
+      QgsVertexKey key( pt, mTolerance );
+      QHash< QgsVertexKey, int >::const_iterator it = mIds.constFind( key );
+      if ( it != mIds.constEnd() )
+        return it.value();
+
+      int id = mVertices.size();
+      mIds.insert( key, id );
+      mVertices.append( pt );
+      mBuilder->addVertex( id, pt );
+      return id;
     }
-    if ( comp( val, *avg ) )
-      end = avg;
-    else if ( comp( *avg, val ) )
-      begin = avg;
-    else
-      return avg;
-  }
 
-  return not_found;
-}
+    //! Returns the coordinates of a vertex
+    const QgsPoint& vertex( int id ) const { return mVertices.at( id ); }
+
+  private:
+    QgsGraphBuilderInterface* mBuilder;
+    double mTolerance;
+    QHash< QgsVertexKey, int > mIds;
+    QVector< QgsPoint > mVertices;
+};
 
 struct TiePointInfo
 {
@@ -100,6 +128,39 @@ bool TiePointInfoCompare( const TiePointInfo& a, const TiePointInfo& b )
   return a.mFirstPoint.x() == b.mFirstPoint.x() ? a.mFirstPoint.y() < b.mFirstPoint.y() : a.mFirstPoint.x() < b.mFirstPoint.x();
 }
 
+typedef QPair< double, QgsPoint > PointOnArc;
+
+static bool pointOnArcCompare( const PointOnArc& a, const PointOnArc& b )
+{
+  return a.first < b.first;
+}
+
+//! Returns the lines of a feature, which are empty if it is not a line string or multi line string
+static QgsMultiPolyline featurePolylines( const QgsFeature& feature )
+{
+  QgsMultiPolyline mpl;
+  const QgsGeometry* geom = feature.constGeometry();
+  if ( !geom || !geom->geometry() )
+    return mpl;
+
+  if ( QgsWKBTypes::flatType( geom->geometry()->wkbType() ) == QgsWKBTypes::MultiLineString )
+    mpl = geom->asMultiPolyline();
+  else if ( QgsWKBTypes::flatType( geom->geometry()->wkbType() ) == QgsWKBTypes::LineString )
+    mpl.push_back( geom->asPolyline() );
+  return mpl;
+}
+
+//! Returns the squared distance from a point to a segment and the nearest point of the segment
+static double sqrDistToSegment( const QgsPoint& point, const QgsPoint& pt1, const QgsPoint& pt2, QgsPoint& tiedPoint )
+{
+  if ( pt1 == pt2 )
+  {
+    tiedPoint = pt1;
+    return point.sqrDist( pt1 );
+  }
+  return point.sqrDistToSegment( pt1.x(), pt1.y(), pt2.x(), pt2.y(), tiedPoint );
+}
+
 QgsLineVectorLayerDirector::QgsLineVectorLayerDirector( QgsVectorLayer *myLayer,
     int directionFieldId,
     const QString& directDirectionValue,
@@ -154,95 +215,96 @@ void QgsLineVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, c
   tmpInfo.mLength = std::numeric_limits<double>::infinity();
 
   QVector< TiePointInfo > pointLengthMap( additionalPoints.size(), tmpInfo );
-  QVector< TiePointInfo >::iterator pointLengthIt;
-
-  //Graph's points;
-  QVector< QgsPoint > points;
 
-  QgsFeatureIterator fit = vl->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
+  QgsFeature feature;
 
   // begin: tie points to the graph
-  QgsAttributeList la;
-  QgsFeature feature;
-  while ( fit.nextFeature( feature ) )
+  if ( additionalPoints.isEmpty() )
   {
-    QgsMultiPolyline mpl;
-    if ( QgsWKBTypes::flatType( feature.constGeometry()->geometry()->wkbType() ) == QgsWKBTypes::MultiLineString )
-      mpl = feature.constGeometry()->asMultiPolyline();
-    else if ( QgsWKBTypes::flatType( feature.constGeometry()->geometry()->wkbType() ) == QgsWKBTypes::LineString )
-      mpl.push_back( feature.constGeometry()->asPolyline() );
+    step = featureCount / 2;
+  }
+  else
+  {
+    // the segments are indexed by their position in the segments array, which holds their
+    // first and last points
+    QgsSpatialIndex segmentIndex;
+    QVector< QgsPoint > segments;
 
-    QgsMultiPolyline::iterator mplIt;
-    for ( mplIt = mpl.begin(); mplIt != mpl.end(); ++mplIt )
+    QgsFeatureIterator fit = vl->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) );
+    while ( fit.nextFeature( feature ) )
     {
-      QgsPoint pt1, pt2;
-      bool isFirstPoint = true;
-      QgsPolyline::iterator pointIt;
-      for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
+      QgsMultiPolyline mpl = featurePolylines( feature );
+      QgsMultiPolyline::iterator mplIt;
+      for ( mplIt = mpl.begin(); mplIt != mpl.end(); ++mplIt )
       {
-        pt2 = ct.transform( *pointIt );
-        points.push_back( pt2 );
-
-        if ( !isFirstPoint )
+        QgsPoint pt1, pt2;
+        bool isFirstPoint = true;
+        QgsPolyline::iterator pointIt;
+        for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
         {
-          int i = 0;
-          for ( i = 0; i != additionalPoints.size(); ++i )
+          pt2 = ct.transform( *pointIt );
+          if ( !isFirstPoint )
           {
-            TiePointInfo info;
-            if ( pt1 == pt2 )
-            {
-              info.mLength = additionalPoints[ i ].sqrDist( pt1 );
-              info.mTiedPoint = pt1;
-            }
-            else
-            {
-              info.mLength = additionalPoints[ i ].sqrDistToSegment( pt1.x(), pt1.y(),
-                             pt2.x(), pt2.y(), info.mTiedPoint );
-            }
+            segmentIndex.insertFeature( segments.size() / 2, QgsRectangle( pt1, pt2 ) );
+            segments << pt1 << pt2;
+          }
+          pt1 = pt2;
+          isFirstPoint = false;
+        }
+      }
+      emit buildProgress( ++step, featureCount );
+    }
 
-            if ( pointLengthMap[ i ].mLength > info.mLength )
-            {
-              Q_UNUSED( info.mTiedPoint );
-              info.mFirstPoint = pt1;
-              info.mLastPoint = pt2;
+    for ( int i = 0; i < additionalPoints.size(); ++i )
+    {
+      const QgsPoint& point = additionalPoints.at( i );
 
-              pointLengthMap[ i ] = info;
-              tiedPoint[ i ] = info.mTiedPoint;
-            }
-          }
+      // the distance to the segment with the nearest bounding box is an upper bound of the
+      // distance to the nearest segment, whose bounding box is in the square of that radius
+      QList< QgsFeatureId > candidates = segmentIndex.nearestNeighbor( point, 1 );
+      if ( candidates.isEmpty() )
+        continue;
+
+      QgsPoint tmpPoint;
+      int segment = static_cast< int >( candidates.at( 0 ) );
+      double radius = sqrt( sqrDistToSegment( point, segments.at( 2 * segment ), segments.at( 2 * segment + 1 ), tmpPoint ) );
+      candidates = segmentIndex.intersects( QgsRectangle( point.x() - radius, point.y() - radius, point.x() + radius, point.y() + radius ) );
+
+      // the first segment of the layer is kept if several segments are at the same distance
+      qSort( candidates.begin(), candidates.end() );
+      Q_FOREACH ( QgsFeatureId id, candidates )
+      {
+        segment = static_cast< int >( id );
+        TiePointInfo info;
+        info.mFirstPoint = segments.at( 2 * segment );
+        info.mLastPoint = segments.at( 2 * segment + 1 );
+        info.mLength = sqrDistToSegment( point, info.mFirstPoint, info.mLastPoint, info.mTiedPoint );
+
+        if ( pointLengthMap[ i ].mLength > info.mLength )
+        {
+          pointLengthMap[ i ] = info;
+          tiedPoint[ i ] = info.mTiedPoint;
         }
-        pt1 = pt2;
-        isFirstPoint = false;
       }
     }
-    emit buildProgress( ++step, featureCount );
   }
   // end: tie points to graph
 
-  // add tied point to graph
+  // the vertices are added to the graph as they are met, the tied points first so that they
+  // keep their coordinates
+  QgsVertexIdMap vertices( builder );
   int i = 0;
   for ( i = 0; i < tiedPoint.size(); ++i )
   {
     if ( tiedPoint[ i ] != QgsPoint( 0.0, 0.0 ) )
     {
-      points.push_back( tiedPoint [ i ] );
+      tiedPoint[ i ] = vertices.vertex( vertices.id( tiedPoint[ i ] ) );
     }
   }
 
-  QgsPointCompare pointCompare( builder->topologyTolerance() );
-
-  qSort( points.begin(), points.end(), pointCompare );
-  QVector< QgsPoint >::iterator tmp = std::unique( points.begin(), points.end() );
-  points.resize( tmp - points.begin() );
-
-  for ( i = 0;i < points.size();++i )
-    builder->addVertex( i, points[ i ] );
-
-  for ( i = 0; i < tiedPoint.size() ; ++i )
-    tiedPoint[ i ] = *( my_binary_search( points.begin(), points.end(), tiedPoint[ i ], pointCompare ) );
-
   qSort( pointLengthMap.begin(), pointLengthMap.end(), TiePointInfoCompare );
 
+  QgsAttributeList la;
   {
     // fill attribute list 'la'
     QgsAttributeList tmpAttr;
@@ -279,7 +341,7 @@ void QgsLineVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, c
   } // end fill attribute list 'la'
 
   // begin graph construction
-  fit = vl->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( la ) );
+  QgsFeatureIterator fit = vl->getFeatures( QgsFeatureRequest().setSubsetOfAttributes( la ) );
   while ( fit.nextFeature( feature ) )
   {
     int directionType = mDefaultDirection;
@@ -300,12 +362,7 @@ void QgsLineVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, c
     }
 
     // begin features segments and add arc to the Graph;
-    QgsMultiPolyline mpl;
-    if ( QgsWKBTypes::flatType( feature.constGeometry()->geometry()->wkbType() ) == QgsWKBTypes::MultiLineString )
-      mpl = feature.constGeometry()->asMultiPolyline();
-    else if ( QgsWKBTypes::flatType( feature.constGeometry()->geometry()->wkbType() ) == QgsWKBTypes::LineString )
-      mpl.push_back( feature.constGeometry()->asPolyline() );
-
+    QgsMultiPolyline mpl = featurePolylines( feature );
     QgsMultiPolyline::iterator mplIt;
     for ( mplIt = mpl.begin(); mplIt != mpl.end(); ++mplIt )
     {
@@ -316,53 +373,44 @@ void QgsLineVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, c
       for ( pointIt = mplIt->begin(); pointIt != mplIt->end(); ++pointIt )
       {
         pt2 = ct.transform( *pointIt );
+        vertices.id( pt2 );
 
         if ( !isFirstPoint )
         {
-          QMap< double, QgsPoint > pointsOnArc;
-          pointsOnArc[ 0.0 ] = pt1;
-          pointsOnArc[ pt1.sqrDist( pt2 )] = pt2;
+          // the arc is split at the points tied to it, sorted by distance from its first point
+          QVector< PointOnArc > pointsOnArc;
+          pointsOnArc << PointOnArc( 0.0, pt1 ) << PointOnArc( pt1.sqrDist( pt2 ), pt2 );
 
           TiePointInfo t;
           t.mFirstPoint = pt1;
           t.mLastPoint  = pt2;
           t.mLength = 0.0;
-          pointLengthIt = my_binary_search( pointLengthMap.begin(), pointLengthMap.end(), t, TiePointInfoCompare );
-
-          if ( pointLengthIt != pointLengthMap.end() )
+          std::pair< QVector< TiePointInfo >::const_iterator, QVector< TiePointInfo >::const_iterator > tied =
+            std::equal_range( pointLengthMap.constBegin(), pointLengthMap.constEnd(), t, TiePointInfoCompare );
+          QVector< TiePointInfo >::const_iterator it;
+          for ( it = tied.first; it != tied.second; ++it )
           {
-            QVector< TiePointInfo >::iterator it;
-            for ( it = pointLengthIt; it - pointLengthMap.begin() >= 0; --it )
-            {
-              if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
-              {
-                pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
-              }
-            }
-            for ( it = pointLengthIt + 1; it != pointLengthMap.end(); ++it )
+            if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
             {
-              if ( it->mFirstPoint == pt1 && it->mLastPoint == pt2 )
-              {
-                pointsOnArc[ pt1.sqrDist( it->mTiedPoint )] = it->mTiedPoint;
-              }
+              pointsOnArc << PointOnArc( pt1.sqrDist( it->mTiedPoint ), it->mTiedPoint );
             }
           }
+          if ( pointsOnArc.size() > 2 )
+          {
+            qStableSort( pointsOnArc.begin(), pointsOnArc.end(), pointOnArcCompare );
+          }
 
-          QMap< double, QgsPoint >::iterator pointsIt;
-          QgsPoint pt1;
-          QgsPoint pt2;
+          QVector< PointOnArc >::const_iterator pointsIt;
           int pt1idx = -1, pt2idx = -1;
-          bool isFirstPoint = true;
-          for ( pointsIt = pointsOnArc.begin(); pointsIt != pointsOnArc.end(); ++pointsIt )
+          for ( pointsIt = pointsOnArc.constBegin(); pointsIt != pointsOnArc.constEnd(); ++pointsIt )
           {
-            pt2 = *pointsIt;
-            tmp = my_binary_search( points.begin(), points.end(), pt2, pointCompare );
-            pt2 = *tmp;
-            pt2idx = tmp - points.begin();
+            pt2idx = vertices.id( pointsIt->second );
 
-            if ( !isFirstPoint && pt1 != pt2 )
+            if ( pt1idx != -1 && pt1idx != pt2idx )
             {
-              double distance = builder->distanceArea()->measureLine( pt1, pt2 );
+              const QgsPoint& arcPt1 = vertices.vertex( pt1idx );
+              const QgsPoint& arcPt2 = vertices.vertex( pt2idx );
+              double distance = builder->distanceArea()->measureLine( arcPt1, arcPt2 );
               QVector< QVariant > prop;
               QList< QgsArcProperter* >::const_iterator it;
               for ( it = mProperterList.begin(); it != mProperterList.end(); ++it )
@@ -373,17 +421,15 @@ void QgsLineVectorLayerDirector::makeGraph( QgsGraphBuilderInterface *builder, c
               if ( directionType == 1 ||
                    directionType == 3 )
               {
-                builder->addArc( pt1idx, pt1, pt2idx, pt2, prop );
+                builder->addArc( pt1idx, arcPt1, pt2idx, arcPt2, prop );
               }
               if ( directionType == 2 ||
                    directionType == 3 )
               {
-                builder->addArc( pt2idx, pt2, pt1idx, pt1, prop );
+                builder->addArc( pt2idx, arcPt2, pt1idx, arcPt1, prop );
               }
             }
             pt1idx = pt2idx;
-            pt1 = pt2;
-            isFirstPoint = false;
           }
         } // if ( !isFirstPoint )
         pt1 = pt2;
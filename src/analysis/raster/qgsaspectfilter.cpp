@@ -17,6 +17,8 @@
 
 #include "qgsaspectfilter.h"
 
+#include <QVector>
+
 QgsAspectFilter::QgsAspectFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -48,3 +50,26 @@ float QgsAspectFilter::processNineCellWindow(
   }
 }
 
+void QgsAspectFilter::processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count )
+{
+  QVector<float> derX( count );
+  QVector<float> derY( count );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), count );
+
+  const float outputNodata = mOutputNodataValue;
+  const float* dx = derX.constData();
+  const float* dy = derY.constData();
+  for ( int j = 0; j < count; ++j )
+  {
+    if ( dx[j] == outputNodata ||
+         dy[j] == outputNodata ||
+         ( dx[j] == 0.0 && dy[j] == 0.0 ) )
+    {
+      result[j] = outputNodata;
+    }
+    else
+    {
+      result[j] = 180.0 + atan2( dx[j], dy[j] ) * 180.0 / M_PI;
+    }
+  }
+}
@@ -17,152 +17,184 @@
 
 #include "qgsderivativefilter.h"
 
-QgsDerivativeFilter::QgsDerivativeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
-    : QgsNineCellFilter( inputFile, outputFile, outputFormat )
-{
-
-}
+///@cond PRIVATE
 
-QgsDerivativeFilter::~QgsDerivativeFilter()
-{
-
-}
-
-float QgsDerivativeFilter::calcFirstDerX( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
+//! First order derivative in x-direction according to Horn (1981)
+static inline float firstDerX( float x11, float x21, float x31, float x12, float x22, float x32, float x13, float x23, float x33,
+                                float inputNodata, float outputNodata, double cellSize, double zFactor )
 {
   //the basic formula would be simple, but we need to test for nodata values...
-  //return (( (*x31 - *x11) + 2 * (*x32 - *x12) + (*x33 - *x13) ) / (8 * mCellSizeX));
+  //return (( (x31 - x11) + 2 * (x32 - x12) + (x33 - x13) ) / (8 * cellSize));
 
   int weight = 0;
   double sum = 0;
 
   //first row
-  if ( *x31 != mInputNodataValue && *x11 != mInputNodataValue ) //the normal case
+  if ( x31 != inputNodata && x11 != inputNodata ) //the normal case
   {
-    sum += ( *x31 - *x11 );
+    sum += ( x31 - x11 );
     weight += 2;
   }
-  else if ( *x31 == mInputNodataValue && *x11 != mInputNodataValue && *x21 != mInputNodataValue ) //probably 3x3 window is at the border
+  else if ( x31 == inputNodata && x11 != inputNodata && x21 != inputNodata ) //probably 3x3 window is at the border
   {
-    sum += ( *x21 - *x11 );
+    sum += ( x21 - x11 );
     weight += 1;
   }
-  else if ( *x11 == mInputNodataValue && *x31 != mInputNodataValue && *x21 != mInputNodataValue ) //probably 3x3 window is at the border
+  else if ( x11 == inputNodata && x31 != inputNodata && x21 != inputNodata ) //probably 3x3 window is at the border
   {
-    sum += ( *x31 - *x21 );
+    sum += ( x31 - x21 );
     weight += 1;
   }
 
   //second row
-  if ( *x32 != mInputNodataValue && *x12 != mInputNodataValue ) //the normal case
+  if ( x32 != inputNodata && x12 != inputNodata ) //the normal case
   {
-    sum += 2 * ( *x32 - *x12 );
+    sum += 2 * ( x32 - x12 );
     weight += 4;
   }
-  else if ( *x32 == mInputNodataValue && *x12 != mInputNodataValue && *x22 != mInputNodataValue )
+  else if ( x32 == inputNodata && x12 != inputNodata && x22 != inputNodata )
   {
-    sum += 2 * ( *x22 - *x12 );
+    sum += 2 * ( x22 - x12 );
     weight += 2;
   }
-  else if ( *x12 == mInputNodataValue && *x32 != mInputNodataValue && *x22 != mInputNodataValue )
+  else if ( x12 == inputNodata && x32 != inputNodata && x22 != inputNodata )
   {
-    sum += 2 * ( *x32 - *x22 );
+    sum += 2 * ( x32 - x22 );
     weight += 2;
   }
 
   //third row
-  if ( *x33 != mInputNodataValue && *x13 != mInputNodataValue ) //the normal case
+  if ( x33 != inputNodata && x13 != inputNodata ) //the normal case
   {
-    sum += ( *x33 - *x13 );
+    sum += ( x33 - x13 );
     weight += 2;
   }
-  else if ( *x33 == mInputNodataValue && *x13 != mInputNodataValue && *x23 != mInputNodataValue )
+  else if ( x33 == inputNodata && x13 != inputNodata && x23 != inputNodata )
   {
-    sum += ( *x23 - *x13 );
+    sum += ( x23 - x13 );
     weight += 1;
   }
-  else if ( *x13 == mInputNodataValue && *x33 != mInputNodataValue && *x23 != mInputNodataValue )
+  else if ( x13 == inputNodata && x33 != inputNodata && x23 != inputNodata )
   {
-    sum += ( *x33 - *x23 );
+    sum += ( x33 - x23 );
     weight += 1;
   }
 
   if ( weight == 0 )
   {
-    return mOutputNodataValue;
+    return outputNodata;
   }
 
-  return sum / ( weight * mCellSizeX * mZFactor );
+  return sum / ( weight * cellSize * zFactor );
 }
 
-float QgsDerivativeFilter::calcFirstDerY( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
+//! First order derivative in y-direction according to Horn (1981)
+static inline float firstDerY( float x11, float x21, float x31, float x12, float x22, float x32, float x13, float x23, float x33,
+                                float inputNodata, float outputNodata, double cellSize, double zFactor )
 {
   //the basic formula would be simple, but we need to test for nodata values...
-  //return (((*x11 - *x13) + 2 * (*x21 - *x23) + (*x31 - *x33)) / ( 8 * mCellSizeY));
+  //return (((x11 - x13) + 2 * (x21 - x23) + (x31 - x33)) / ( 8 * cellSize));
 
   double sum = 0;
   int weight = 0;
 
   //first row
-  if ( *x11 != mInputNodataValue && *x13 != mInputNodataValue ) //normal case
+  if ( x11 != inputNodata && x13 != inputNodata ) //normal case
   {
-    sum += ( *x11 - *x13 );
+    sum += ( x11 - x13 );
     weight += 2;
   }
-  else if ( *x11 == mInputNodataValue && *x13 != mInputNodataValue && *x12 != mInputNodataValue )
+  else if ( x11 == inputNodata && x13 != inputNodata && x12 != inputNodata )
   {
-    sum += ( *x12 - *x13 );
+    sum += ( x12 - x13 );
     weight += 1;
   }
-  else if ( *x31 == mInputNodataValue && *x11 != mInputNodataValue && *x12 != mInputNodataValue )
+  else if ( x31 == inputNodata && x11 != inputNodata && x12 != inputNodata )
   {
-    sum += ( *x11 - *x12 );
+    sum += ( x11 - x12 );
     weight += 1;
   }
 
   //second row
-  if ( *x21 != mInputNodataValue && *x23 != mInputNodataValue )
+  if ( x21 != inputNodata && x23 != inputNodata )
   {
-    sum += 2 * ( *x21 - *x23 );
+    sum += 2 * ( x21 - x23 );
     weight += 4;
   }
-  else if ( *x21 == mInputNodataValue && *x23 != mInputNodataValue && *x22 != mInputNodataValue )
+  else if ( x21 == inputNodata && x23 != inputNodata && x22 != inputNodata )
   {
-    sum += 2 * ( *x22 - *x23 );
+    sum += 2 * ( x22 - x23 );
     weight += 2;
   }
-  else if ( *x23 == mInputNodataValue && *x21 != mInputNodataValue && *x22 != mInputNodataValue )
+  else if ( x23 == inputNodata && x21 != inputNodata && x22 != inputNodata )
   {
-    sum += 2 * ( *x21 - *x22 );
+    sum += 2 * ( x21 - x22 );
     weight += 2;
   }
 
   //third row
-  if ( *x31 != mInputNodataValue && *x33 != mInputNodataValue )
+  if ( x31 != inputNodata && x33 != inputNodata )
   {
-    sum += ( *x31 - *x33 );
+    sum += ( x31 - x33 );
     weight += 2;
   }
-  else if ( *x31 == mInputNodataValue && *x33 != mInputNodataValue && *x32 != mInputNodataValue )
+  else if ( x31 == inputNodata && x33 != inputNodata && x32 != inputNodata )
   {
-    sum += ( *x32 - *x33 );
+    sum += ( x32 - x33 );
     weight += 1;
   }
-  else if ( *x33 == mInputNodataValue && *x31 != mInputNodataValue && *x32 != mInputNodataValue )
+  else if ( x33 == inputNodata && x31 != inputNodata && x32 != inputNodata )
   {
-    sum += ( *x31 - *x32 );
+    sum += ( x31 - x32 );
     weight += 1;
   }
 
   if ( weight == 0 )
   {
-    return mOutputNodataValue;
+    return outputNodata;
   }
 
-  return sum / ( weight * mCellSizeY * mZFactor );
+  return sum / ( weight * cellSize * zFactor );
+}
+
+///@endcond
+
+QgsDerivativeFilter::QgsDerivativeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
+    : QgsNineCellFilter( inputFile, outputFile, outputFormat )
+{
+
 }
 
+QgsDerivativeFilter::~QgsDerivativeFilter()
+{
 
+}
 
+float QgsDerivativeFilter::calcFirstDerX( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
+{
+  return firstDerX( *x11, *x21, *x31, *x12, *x22, *x32, *x13, *x23, *x33, mInputNodataValue, mOutputNodataValue, mCellSizeX, mZFactor );
+}
 
+float QgsDerivativeFilter::calcFirstDerY( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 )
+{
+  return firstDerY( *x11, *x21, *x31, *x12, *x22, *x32, *x13, *x23, *x33, mInputNodataValue, mOutputNodataValue, mCellSizeY, mZFactor );
+}
+
+void QgsDerivativeFilter::calcFirstDerRow( const float* rowAbove, const float* row, const float* rowBelow, float* derX, float* derY, int count ) const
+{
+  //local copies, the compiler can not know that the members are not modified through the output rows
+  const float inputNodata = mInputNodataValue;
+  const float outputNodata = mOutputNodataValue;
+  const double cellSizeX = mCellSizeX;
+  const double cellSizeY = mCellSizeY;
+  const double zFactor = mZFactor;
+
+  for ( int j = 0; j < count; ++j )
+  {
+    derX[j] = firstDerX( rowAbove[j], rowAbove[j+1], rowAbove[j+2], row[j], row[j+1], row[j+2], rowBelow[j], rowBelow[j+1], rowBelow[j+2],
+                         inputNodata, outputNodata, cellSizeX, zFactor );
+    derY[j] = firstDerY( rowAbove[j], rowAbove[j+1], rowAbove[j+2], row[j], row[j+1], row[j+2], rowBelow[j], rowBelow[j+1], rowBelow[j+2],
+                         inputNodata, outputNodata, cellSizeY, zFactor );
+  }
+}
 
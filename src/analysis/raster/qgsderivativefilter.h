@@ -37,6 +37,12 @@ class ANALYSIS_EXPORT QgsDerivativeFilter : public QgsNineCellFilter
     float calcFirstDerX( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 );
     /** Calculates the first order derivative in y-direction according to Horn (1981)*/
     float calcFirstDerY( float* x11, float* x21, float* x31, float* x12, float* x22, float* x32, float* x13, float* x23, float* x33 );
+    /** Calculates the first order derivatives in x- and y-direction of a row of cells (see processNineCellRow() for the
+     * layout of the input rows). Derivatives which can not be calculated are set to the output nodata value.
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    void calcFirstDerRow( const float* rowAbove, const float* row, const float* rowBelow, float* derX, float* derY, int count ) const;
 };
 
 #endif // QGSDERIVATIVEFILTER_H
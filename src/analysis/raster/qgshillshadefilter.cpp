@@ -17,6 +17,8 @@
 
 #include "qgshillshadefilter.h"
 
+#include <QVector>
+
 QgsHillshadeFilter::QgsHillshadeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat, double lightAzimuth,
                                         double lightAngle )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
@@ -55,3 +57,36 @@ float QgsHillshadeFilter::processNineCellWindow( float* x11, float* x21, float*
   }
   return qMax( 0.0, 255.0 * (( cos( zenith_rad ) * cos( slope_rad ) ) + ( sin( zenith_rad ) * sin( slope_rad ) * cos( azimuth_rad - aspect_rad ) ) ) );
 }
+
+void QgsHillshadeFilter::processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count )
+{
+  QVector<float> derX( count );
+  QVector<float> derY( count );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), count );
+
+  const float outputNodata = mOutputNodataValue;
+  const float zenith_rad = mLightAngle * M_PI / 180.0;
+  const float azimuth_rad = mLightAzimuth * M_PI / 180.0;
+  const float* dx = derX.constData();
+  const float* dy = derY.constData();
+  for ( int j = 0; j < count; ++j )
+  {
+    if ( dx[j] == outputNodata || dy[j] == outputNodata )
+    {
+      result[j] = outputNodata;
+      continue;
+    }
+
+    float slope_rad = atan( sqrt( dx[j] * dx[j] + dy[j] * dy[j] ) );
+    float aspect_rad = 0;
+    if ( dx[j] == 0 && dy[j] == 0 ) //aspect undefined, take a neutral value
+    {
+      aspect_rad = azimuth_rad / 2.0;
+    }
+    else
+    {
+      aspect_rad = M_PI + atan2( dx[j], dy[j] );
+    }
+    result[j] = qMax( 0.0, 255.0 * (( cos( zenith_rad ) * cos( slope_rad ) ) + ( sin( zenith_rad ) * sin( slope_rad ) * cos( azimuth_rad - aspect_rad ) ) ) );
+  }
+}
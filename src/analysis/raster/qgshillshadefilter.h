@@ -36,6 +36,10 @@ class ANALYSIS_EXPORT QgsHillshadeFilter: public QgsDerivativeFilter
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 ) override;
 
+    /** Calculates the hillshade of a row of cells, see QgsNineCellFilter::processNineCellRow()
+      @note added in QGIS 2.99*/
+    void processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count ) override;
+
     float lightAzimuth() const { return mLightAzimuth; }
     void setLightAzimuth( float azimuth ) { mLightAzimuth = azimuth; }
     float lightAngle() const { return mLightAngle; }
@@ -20,6 +20,9 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QFuture>
+#include <QVector>
+#include <QtConcurrentMap>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8F(x) (x).toUtf8().constData()
@@ -27,6 +30,73 @@
 #define TO8F(x) QFile::encodeName( x ).constData()
 #endif
 
+///@cond PRIVATE
+
+//! number of cells read and processed at once
+static const int BAND_CELLS = 1 << 22;
+
+/** A band of full raster rows, stored with one cell on each side of the rows and one row above
+ * and below the band. Cells outside of the raster hold the input nodata value.
+ */
+struct QgsNineCellBand
+{
+  QgsNineCellBand()
+      : y( 0 )
+      , height( 0 )
+  {}
+
+  int y;
+  int height;
+  QVector<float> input;
+  QVector<float> output;
+};
+
+/** Processes one row of a band */
+class QgsNineCellRowProcessor
+{
+  public:
+    typedef void result_type;
+
+    QgsNineCellRowProcessor( QgsNineCellFilter* filter, QgsNineCellBand* band, int xSize )
+        : mFilter( filter )
+        , mBand( band )
+        , mXSize( xSize )
+    {}
+
+    void operator()( const int& row )
+    {
+      const int stride = mXSize + 2;
+      const float* rowAbove = mBand->input.constData() + row * stride;
+      mFilter->processNineCellRow( rowAbove, rowAbove + stride, rowAbove + 2 * stride, mBand->output.data() + row * mXSize, mXSize );
+    }
+
+  private:
+    QgsNineCellFilter* mFilter;
+    QgsNineCellBand* mBand;
+    int mXSize;
+};
+
+static void readBand( GDALRasterBandH rasterBand, int xSize, int ySize, float nodata, int y, int height, QgsNineCellBand& band )
+{
+  const int stride = xSize + 2;
+  band.y = y;
+  band.height = height;
+  band.input.fill( nodata, stride * ( height + 2 ) );
+  band.output.resize( xSize * height );
+
+  //rows above the first and below the last raster row stay nodata
+  const int firstRow = qMax( 0, y - 1 );
+  const int lastRow = qMin( ySize - 1, y + height );
+  float* first = band.input.data() + ( firstRow - ( y - 1 ) ) * stride + 1;
+  if ( GDALRasterIO( rasterBand, GF_Read, 0, firstRow, xSize, lastRow - firstRow + 1, first, xSize, lastRow - firstRow + 1,
+                     GDT_Float32, sizeof( float ), stride * sizeof( float ) ) != CE_None )
+  {
+    QgsDebugMsg( "Raster IO Error" );
+  }
+}
+
+///@endcond
+
 QgsNineCellFilter::QgsNineCellFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : mInputFile( inputFile )
     , mOutputFile( outputFile )
@@ -107,24 +177,22 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     return 6;
   }
 
-  //keep only three scanlines in memory at a time
-  float* scanLine1 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine2 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-  float* scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-
-  float* resultLine = ( float * ) CPLMalloc( sizeof( float ) * xSize );
+  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
+  const int bandHeight = qBound( 1, BAND_CELLS / xSize, ySize );
+  QgsNineCellBand bands[2];
+  int current = 0;
+  readBand( rasterBand, xSize, ySize, mInputNodataValue, 0, bandHeight, bands[current] );
 
   if ( p )
   {
     p->setMaximum( ySize );
   }
 
-  //values outside the layer extent (if the 3x3 window is on the border) are sent to the processing method as (input) nodata values
-  for ( int i = 0; i < ySize; ++i )
+  for ( int y = 0; y < ySize; y += bandHeight )
   {
     if ( p )
     {
-      p->setValue( i );
+      p->setValue( y );
     }
 
     if ( p && p->wasCanceled() )
@@ -132,65 +200,27 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
       break;
     }
 
-    if ( i == 0 )
-    {
-      //fill scanline 1 with (input) nodata for the values above the first row and feed scanline2 with the first row
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine1[a] = mInputNodataValue;
-      }
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, 0, xSize, 1, scanLine2, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
-    }
-    else
-    {
-      //normally fetch only scanLine3 and release scanline 1 if we move forward one row
-      CPLFree( scanLine1 );
-      scanLine1 = scanLine2;
-      scanLine2 = scanLine3;
-      scanLine3 = ( float * ) CPLMalloc( sizeof( float ) * xSize );
-    }
-
-    if ( i == ySize - 1 ) //fill the row below the bottom with nodata values
-    {
-      for ( int a = 0; a < xSize; ++a )
-      {
-        scanLine3[a] = mInputNodataValue;
-      }
-    }
-    else
+    QgsNineCellBand& band = bands[current];
+    QVector<int> rows( band.height );
+    for ( int i = 0; i < band.height; ++i )
     {
-      if ( GDALRasterIO( rasterBand, GF_Read, 0, i + 1, xSize, 1, scanLine3, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "Raster IO Error" );
-      }
+      rows[i] = i;
     }
 
-    for ( int j = 0; j < xSize; ++j )
+    //process the rows of the band in parallel while the next band is read
+    QFuture<void> future = QtConcurrent::map( rows, QgsNineCellRowProcessor( this, &band, xSize ) );
+    if ( y + bandHeight < ySize )
     {
-      if ( j == 0 )
-      {
-        resultLine[j] = processNineCellWindow( &mInputNodataValue, &scanLine1[j], &scanLine1[j+1], &mInputNodataValue, &scanLine2[j],
-                                               &scanLine2[j+1], &mInputNodataValue, &scanLine3[j], &scanLine3[j+1] );
-      }
-      else if ( j == xSize - 1 )
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &mInputNodataValue, &scanLine2[j-1], &scanLine2[j],
-                                               &mInputNodataValue, &scanLine3[j-1], &scanLine3[j], &mInputNodataValue );
-      }
-      else
-      {
-        resultLine[j] = processNineCellWindow( &scanLine1[j-1], &scanLine1[j], &scanLine1[j+1], &scanLine2[j-1], &scanLine2[j],
-                                               &scanLine2[j+1], &scanLine3[j-1], &scanLine3[j], &scanLine3[j+1] );
-      }
+      readBand( rasterBand, xSize, ySize, mInputNodataValue, y + bandHeight, qMin( bandHeight, ySize - y - bandHeight ), bands[1 - current] );
     }
+    future.waitForFinished();
 
-    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, xSize, 1, resultLine, xSize, 1, GDT_Float32, 0, 0 ) != CE_None )
+    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, band.y, xSize, band.height, band.output.data(), xSize, band.height, GDT_Float32, 0, 0 ) != CE_None )
     {
       QgsDebugMsg( "Raster IO Error" );
     }
+
+    current = 1 - current;
   }
 
   if ( p )
@@ -198,11 +228,6 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
     p->setValue( ySize );
   }
 
-  CPLFree( resultLine );
-  CPLFree( scanLine1 );
-  CPLFree( scanLine2 );
-  CPLFree( scanLine3 );
-
   GDALClose( inputDataset );
 
   if ( p && p->wasCanceled() )
@@ -216,6 +241,19 @@ int QgsNineCellFilter::processRaster( QProgressDialog* p )
   return 0;
 }
 
+void QgsNineCellFilter::processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count )
+{
+  //processNineCellWindow does not modify the values
+  float* x1 = const_cast< float* >( rowAbove );
+  float* x2 = const_cast< float* >( row );
+  float* x3 = const_cast< float* >( rowBelow );
+
+  for ( int j = 0; j < count; ++j )
+  {
+    result[j] = processNineCellWindow( &x1[j], &x1[j+1], &x1[j+2], &x2[j], &x2[j+1], &x2[j+2], &x3[j], &x3[j+1], &x3[j+2] );
+  }
+}
+
 GDALDatasetH QgsNineCellFilter::openInputFile( int& nCellsX, int& nCellsY )
 {
   GDALDatasetH inputDataset = GDALOpen( TO8F( mInputFile ), GA_ReadOnly );
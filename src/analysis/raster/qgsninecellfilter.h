@@ -53,11 +53,27 @@ class ANALYSIS_EXPORT QgsNineCellFilter
     void setOutputNodataValue( double value ) { mOutputNodataValue = value; }
 
     /** Calculates output value from nine input values. The input values and the output value can be equal to the
-      nodata value if not present or outside of the border. Must be implemented by subclasses*/
+      nodata value if not present or outside of the border. Must be implemented by subclasses
+      @note processRaster() calls this method from several threads. The calls of a Python subclass are serialized
+      by the GIL but interleaved, so the method must not depend on the order of the cells or keep state between calls*/
     virtual float processNineCellWindow( float* x11, float* x21, float* x31,
                                          float* x12, float* x22, float* x32,
                                          float* x13, float* x23, float* x33 ) = 0;
 
+    /** Calculates the output values of a row of cells. Each input row holds count + 2 values: one value
+      on the left of the first cell, the values of the cells and one value on the right of the last cell. Values
+      outside of the raster are set to the input nodata value. The default implementation calls processNineCellWindow()
+      for every cell, subclasses may implement it with a loop without virtual calls that the compiler can vectorize.
+      Rows are processed in parallel, this method may be called concurrently from several threads.
+      @param rowAbove values of the row above
+      @param row values of the row
+      @param rowBelow values of the row below
+      @param result receives the count output values
+      @param count number of cells of the row
+      @note added in QGIS 2.99
+      @note not available in Python bindings*/
+    virtual void processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count );
+
   private:
     //default constructor forbidden. We need input file, output file and format obligatory
     QgsNineCellFilter();
@@ -0,0 +1,242 @@
+/***************************************************************************
+  qgsrastercalckernel.cpp
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsrastercalckernel.h"
+#include "qgsrastercalcnode.h"
+
+#include <string.h>
+
+const int QgsRasterCalcKernel::RUN_LENGTH;
+
+QgsRasterCalcKernel::QgsRasterCalcKernel( const QgsRasterCalcNode* node, const QStringList& rasterRefs, double nodataValue )
+    : mStackDepth( 0 )
+    , mNodataValue( nodataValue )
+    , mValid( false )
+{
+  mValid = node && compile( node, rasterRefs, 0 );
+  if ( !mValid )
+  {
+    mInstructions.clear();
+    mStackDepth = 0;
+  }
+}
+
+bool QgsRasterCalcKernel::compile( const QgsRasterCalcNode* node, const QStringList& rasterRefs, int depth )
+{
+  Instruction instruction;
+  instruction.oneArgOperator = QgsRasterMatrix::opSQRT;
+  instruction.twoArgOperator = QgsRasterMatrix::opPLUS;
+  instruction.number = 0;
+  instruction.raster = -1;
+
+  mStackDepth = qMax( mStackDepth, depth + 1 );
+
+  switch ( node->mType )
+  {
+    case QgsRasterCalcNode::tNumber:
+      instruction.type = PushNumber;
+      instruction.number = node->mNumber;
+      mInstructions << instruction;
+      return true;
+
+    case QgsRasterCalcNode::tRasterRef:
+      instruction.type = PushRaster;
+      instruction.raster = rasterRefs.indexOf( node->mRasterName );
+      if ( instruction.raster < 0 )
+        return false;
+      mInstructions << instruction;
+      return true;
+
+    case QgsRasterCalcNode::tMatrix:
+      // matrix nodes are not created by the parser
+      return false;
+
+    case QgsRasterCalcNode::tOperator:
+      break;
+  }
+
+  bool oneArgument = true;
+  switch ( node->mOperator )
+  {
+    case QgsRasterCalcNode::opPLUS:
+      instruction.twoArgOperator = QgsRasterMatrix::opPLUS;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opMINUS:
+      instruction.twoArgOperator = QgsRasterMatrix::opMINUS;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opMUL:
+      instruction.twoArgOperator = QgsRasterMatrix::opMUL;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opDIV:
+      instruction.twoArgOperator = QgsRasterMatrix::opDIV;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opPOW:
+      instruction.twoArgOperator = QgsRasterMatrix::opPOW;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opEQ:
+      instruction.twoArgOperator = QgsRasterMatrix::opEQ;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opNE:
+      instruction.twoArgOperator = QgsRasterMatrix::opNE;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opGT:
+      instruction.twoArgOperator = QgsRasterMatrix::opGT;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opLT:
+      instruction.twoArgOperator = QgsRasterMatrix::opLT;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opGE:
+      instruction.twoArgOperator = QgsRasterMatrix::opGE;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opLE:
+      instruction.twoArgOperator = QgsRasterMatrix::opLE;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opAND:
+      instruction.twoArgOperator = QgsRasterMatrix::opAND;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opOR:
+      instruction.twoArgOperator = QgsRasterMatrix::opOR;
+      oneArgument = false;
+      break;
+    case QgsRasterCalcNode::opSQRT:
+      instruction.oneArgOperator = QgsRasterMatrix::opSQRT;
+      break;
+    case QgsRasterCalcNode::opSIN:
+      instruction.oneArgOperator = QgsRasterMatrix::opSIN;
+      break;
+    case QgsRasterCalcNode::opCOS:
+      instruction.oneArgOperator = QgsRasterMatrix::opCOS;
+      break;
+    case QgsRasterCalcNode::opTAN:
+      instruction.oneArgOperator = QgsRasterMatrix::opTAN;
+      break;
+    case QgsRasterCalcNode::opASIN:
+      instruction.oneArgOperator = QgsRasterMatrix::opASIN;
+      break;
+    case QgsRasterCalcNode::opACOS:
+      instruction.oneArgOperator = QgsRasterMatrix::opACOS;
+      break;
+    case QgsRasterCalcNode::opATAN:
+      instruction.oneArgOperator = QgsRasterMatrix::opATAN;
+      break;
+    case QgsRasterCalcNode::opSIGN:
+      instruction.oneArgOperator = QgsRasterMatrix::opSIGN;
+      break;
+    case QgsRasterCalcNode::opLOG:
+      instruction.oneArgOperator = QgsRasterMatrix::opLOG;
+      break;
+    case QgsRasterCalcNode::opLOG10:
+      instruction.oneArgOperator = QgsRasterMatrix::opLOG10;
+      break;
+    default:
+      return false;
+  }
+
+  if ( !node->mLeft || !compile( node->mLeft, rasterRefs, depth ) )
+    return false;
+
+  if ( oneArgument )
+  {
+    instruction.type = OneArgument;
+    mInstructions << instruction;
+    return true;
+  }
+
+  if ( !node->mRight )
+    return false;
+
+  // numbers and rasters are used in place instead of being copied to the stack
+  if ( node->mRight->mType == QgsRasterCalcNode::tNumber )
+  {
+    instruction.type = NumberArgument;
+    instruction.number = node->mRight->mNumber;
+  }
+  else if ( node->mRight->mType == QgsRasterCalcNode::tRasterRef )
+  {
+    instruction.type = RasterArgument;
+    instruction.raster = rasterRefs.indexOf( node->mRight->mRasterName );
+    if ( instruction.raster < 0 )
+      return false;
+  }
+  else
+  {
+    if ( !compile( node->mRight, rasterRefs, depth + 1 ) )
+      return false;
+    instruction.type = TwoArguments;
+  }
+  mInstructions << instruction;
+  return true;
+}
+
+const double* QgsRasterCalcKernel::evaluate( const double* const* inputs, int count, double* scratch ) const
+{
+  // the stack is made of consecutive arrays of RUN_LENGTH values in the scratch buffer
+  double* top = scratch;
+  bool empty = true;
+
+  QVector<Instruction>::const_iterator it = mInstructions.constBegin();
+  for ( ; it != mInstructions.constEnd(); ++it )
+  {
+    switch ( it->type )
+    {
+      case PushNumber:
+        if ( !empty )
+          top += RUN_LENGTH;
+        empty = false;
+        for ( int i = 0; i < count; ++i )
+        {
+          top[i] = it->number;
+        }
+        break;
+
+      case PushRaster:
+        if ( !empty )
+          top += RUN_LENGTH;
+        empty = false;
+        memcpy( top, inputs[ it->raster ], sizeof( double ) * count );
+        break;
+
+      case OneArgument:
+        QgsRasterMatrix::applyOneArgumentOperator( it->oneArgOperator, top, count, mNodataValue );
+        break;
+
+      case TwoArguments:
+        top -= RUN_LENGTH;
+        QgsRasterMatrix::applyTwoArgumentOperator( it->twoArgOperator, top, top + RUN_LENGTH, count, mNodataValue );
+        break;
+
+      case NumberArgument:
+        QgsRasterMatrix::applyTwoArgumentOperator( it->twoArgOperator, top, it->number, count, mNodataValue );
+        break;
+
+      case RasterArgument:
+        QgsRasterMatrix::applyTwoArgumentOperator( it->twoArgOperator, top, inputs[ it->raster ], count, mNodataValue );
+        break;
+    }
+  }
+
+  return scratch;
+}
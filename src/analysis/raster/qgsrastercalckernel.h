@@ -0,0 +1,98 @@
+/***************************************************************************
+  qgsrastercalckernel.h
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSRASTERCALCKERNEL_H
+#define QGSRASTERCALCKERNEL_H
+
+#include <QStringList>
+#include <QVector>
+
+#include "qgsrastermatrix.h"
+
+class QgsRasterCalcNode;
+
+/** \ingroup analysis
+ * \class QgsRasterCalcKernel
+ * \brief Raster calculator expression compiled for the evaluation of runs of cells.
+ *
+ * The tree of QgsRasterCalcNode is turned into a list of instructions working on a stack of
+ * arrays of cell values. The arrays are taken from a scratch buffer provided by the caller,
+ * so evaluating a run of cells does not allocate any memory and the buffer can be reused for
+ * all the runs processed by a thread. The arithmetic is done by the array operators of
+ * QgsRasterMatrix. A compiled kernel is not modified by evaluate() and can be shared by threads.
+ *
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class ANALYSIS_EXPORT QgsRasterCalcKernel
+{
+  public:
+
+    //! Maximum number of cells evaluated by a call to evaluate()
+    static const int RUN_LENGTH = 256;
+
+    /**
+     * Compiles an expression
+     * @param node root node of the expression
+     * @param rasterRefs names of the input rasters, in the order of the inputs given to evaluate()
+     * @param nodataValue value of the nodata cells, for the inputs and the results
+     */
+    QgsRasterCalcKernel( const QgsRasterCalcNode* node, const QStringList& rasterRefs, double nodataValue );
+
+    //! Returns false if the expression could not be compiled, e.g. if it references an unknown raster
+    bool isValid() const { return mValid; }
+
+    //! Returns the number of values of the scratch buffer needed by evaluate()
+    int scratchSize() const { return mStackDepth * RUN_LENGTH; }
+
+    /**
+     * Evaluates the expression for a run of cells
+     * @param inputs values of the input rasters for the cells, nodata cells must hold the nodata value
+     * @param count number of cells, at most RUN_LENGTH
+     * @param scratch buffer of scratchSize() values
+     * @returns the results, stored in the scratch buffer
+     */
+    const double* evaluate( const double* const* inputs, int count, double* scratch ) const;
+
+  private:
+
+    enum InstructionType
+    {
+      PushNumber,     //!< pushes a number
+      PushRaster,     //!< pushes the values of an input raster
+      OneArgument,    //!< applies a one argument operator to the top of the stack
+      TwoArguments,   //!< applies a two argument operator to the two top arrays of the stack
+      NumberArgument, //!< applies a two argument operator to the top of the stack and a number
+      RasterArgument, //!< applies a two argument operator to the top of the stack and an input raster
+    };
+
+    struct Instruction
+    {
+      InstructionType type;
+      QgsRasterMatrix::OneArgOperator oneArgOperator;
+      QgsRasterMatrix::TwoArgOperator twoArgOperator;
+      double number;
+      int raster;
+    };
+
+    //! Appends the instructions of a node leaving its value at position depth of the stack
+    bool compile( const QgsRasterCalcNode* node, const QStringList& rasterRefs, int depth );
+
+    QVector<Instruction> mInstructions;
+    int mStackDepth;
+    double mNodataValue;
+    bool mValid;
+};
+
+#endif // QGSRASTERCALCKERNEL_H
@@ -99,6 +99,8 @@ class ANALYSIS_EXPORT QgsRasterCalcNode
     static QgsRasterCalcNode* parseRasterCalcString( const QString& str, QString& parserErrorMsg );
 
   private:
+    friend class QgsRasterCalcKernel;
+
     Type mType;
     QgsRasterCalcNode* mLeft;
     QgsRasterCalcNode* mRight;
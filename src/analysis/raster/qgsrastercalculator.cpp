@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgsrastercalculator.h"
+#include "qgsrastercalckernel.h"
 #include "qgsrastercalcnode.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterinterface.h"
@@ -25,6 +26,9 @@
 
 #include <QProgressDialog>
 #include <QFile>
+#include <QFuture>
+#include <QThreadStorage>
+#include <QtConcurrentMap>
 
 #include <cpl_string.h>
 #include <gdalwarper.h>
@@ -37,6 +41,97 @@
 #define TO8F(x)  QFile::encodeName( x ).constData()
 #endif
 
+///@cond PRIVATE
+
+//! number of cells read and processed at once
+static const int BAND_CELLS = 1 << 20;
+
+/** A band of full output rows, with the blocks of the input rasters for the rows */
+struct QgsRasterCalcBand
+{
+  QgsRasterCalcBand()
+      : y( 0 )
+      , height( 0 )
+  {}
+
+  int y;
+  int height;
+  QVector<QgsRasterBlock*> inputs;
+  QVector<float> output;
+};
+
+//! scratch buffer of the threads calculating rows, kept between rows and bands
+static QThreadStorage< QVector<double>* > sScratchBuffers;
+
+/** Calculates one row of a band */
+class QgsRasterCalcRowProcessor
+{
+  public:
+    typedef void result_type;
+
+    QgsRasterCalcRowProcessor( const QgsRasterCalcKernel* kernel, QgsRasterCalcBand* band, int nColumns, double nodataValue )
+        : mKernel( kernel )
+        , mBand( band )
+        , mNumColumns( nColumns )
+        , mNodataValue( nodataValue )
+    {}
+
+    void operator()( const int& row )
+    {
+      const int runLength = QgsRasterCalcKernel::RUN_LENGTH;
+      const int nInputs = mBand->inputs.size();
+
+      //scratch buffer of the kernel followed by the input values, reused for all the runs
+      if ( !sScratchBuffers.hasLocalData() )
+      {
+        sScratchBuffers.setLocalData( new QVector<double>() );
+      }
+      QVector<double>& scratch = *sScratchBuffers.localData();
+      const int scratchSize = mKernel->scratchSize() + nInputs * runLength;
+      if ( scratch.size() < scratchSize )
+      {
+        scratch.resize( scratchSize );
+      }
+      double* inputValues = scratch.data() + mKernel->scratchSize();
+      QVector<const double*> inputs( nInputs );
+      for ( int i = 0; i < nInputs; ++i )
+      {
+        inputs[i] = inputValues + i * runLength;
+      }
+
+      float* output = mBand->output.data() + row * mNumColumns;
+      for ( int col = 0; col < mNumColumns; col += runLength )
+      {
+        const int count = qMin( runLength, mNumColumns - col );
+
+        //convert input raster values to double, also convert input no data to result no data
+        for ( int i = 0; i < nInputs; ++i )
+        {
+          QgsRasterBlock* block = mBand->inputs.at( i );
+          double* values = inputValues + i * runLength;
+          for ( int j = 0; j < count; ++j )
+          {
+            values[j] = block->isNoData( row, col + j ) ? mNodataValue : block->value( row, col + j );
+          }
+        }
+
+        const double* result = mKernel->evaluate( inputs.constData(), count, scratch.data() );
+        for ( int j = 0; j < count; ++j )
+        {
+          output[col + j] = static_cast< float >( result[j] );
+        }
+      }
+    }
+
+  private:
+    const QgsRasterCalcKernel* mKernel;
+    QgsRasterCalcBand* mBand;
+    int mNumColumns;
+    double mNodataValue;
+};
+
+///@endcond
+
 QgsRasterCalculator::QgsRasterCalculator( const QString& formulaString, const QString& outputFile, const QString& outputFormat,
     const QgsRectangle& outputExtent, int nOutputColumns, int nOutputRows, const QVector<QgsRasterCalculatorEntry>& rasterEntries )
     : mFormulaString( formulaString )
@@ -75,40 +170,26 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     return static_cast<int>( ParserError );
   }
 
-  QMap< QString, QgsRasterBlock* > inputBlocks;
+  QStringList rasterRefs;
   QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
   for ( ; it != mRasterEntries.constEnd(); ++it )
   {
     if ( !it->raster ) // no raster layer in entry
     {
       delete calcNode;
-      qDeleteAll( inputBlocks );
       return static_cast< int >( InputLayerError );
     }
+    rasterRefs << it->ref;
+  }
 
-    QgsRasterBlock* block = nullptr;
-    // if crs transform needed
-    if ( it->raster->crs() != mOutputCrs )
-    {
-      QgsRasterProjector proj;
-      proj.setCrs( it->raster->crs(), mOutputCrs );
-      proj.setInput( it->raster->dataProvider() );
-      proj.setPrecision( QgsRasterProjector::Exact );
+  float outputNodataValue = -FLT_MAX;
 
-      block = proj.block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    else
-    {
-      block = it->raster->dataProvider()->block( it->bandNumber, mOutputRectangle, mNumOutputColumns, mNumOutputRows );
-    }
-    if ( block->isEmpty() )
-    {
-      delete block;
-      delete calcNode;
-      qDeleteAll( inputBlocks );
-      return static_cast<int>( MemoryError );
-    }
-    inputBlocks.insert( it->ref, block );
+  //the expression is compiled once and evaluated by all the threads
+  QgsRasterCalcKernel kernel( calcNode, rasterRefs, outputNodataValue );
+  delete calcNode;
+  if ( !kernel.isValid() )
+  {
+    return static_cast<int>( ParserError );
   }
 
   //open output dataset for writing
@@ -119,10 +200,13 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
   }
 
   GDALDatasetH outputDataset = openOutputFile( outputDriver );
+  if ( !outputDataset )
+  {
+    return static_cast< int >( CreateOutputError );
+  }
   GDALSetProjection( outputDataset, mOutputCrs.toWkt().toLocal8Bit().data() );
   GDALRasterBandH outputRasterBand = GDALGetRasterBand( outputDataset, 1 );
 
-  float outputNodataValue = -FLT_MAX;
   GDALSetRasterNoDataValue( outputRasterBand, outputNodataValue );
 
   if ( p )
@@ -130,15 +214,17 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
     p->setMaximum( mNumOutputRows );
   }
 
-  QgsRasterMatrix resultMatrix;
-  resultMatrix.setNodataValue( outputNodataValue );
+  //the raster is processed by bands of full rows: the rows of a band are calculated in parallel while the next band is read
+  const int bandHeight = qBound( 1, BAND_CELLS / qMax( 1, mNumOutputColumns ), qMax( 1, mNumOutputRows ) );
+  QgsRasterCalcBand bands[2];
+  int current = 0;
+  bool readOk = readBand( 0, qMin( bandHeight, mNumOutputRows ), bands[current] );
 
-  //read / write line by line
-  for ( int i = 0; i < mNumOutputRows; ++i )
+  for ( int y = 0; readOk && y < mNumOutputRows; y += bandHeight )
   {
     if ( p )
     {
-      p->setValue( i );
+      p->setValue( y );
     }
 
     if ( p && p->wasCanceled() )
@@ -146,48 +232,95 @@ int QgsRasterCalculator::processCalculation( QProgressDialog* p )
       break;
     }
 
-    if ( calcNode->calculate( inputBlocks, resultMatrix, i ) )
+    QgsRasterCalcBand& band = bands[current];
+    QVector<int> rows( band.height );
+    for ( int i = 0; i < band.height; ++i )
     {
-      bool resultIsNumber = resultMatrix.isNumber();
-      float* calcData = new float[mNumOutputColumns];
-
-      for ( int j = 0; j < mNumOutputColumns; ++j )
-      {
-        calcData[j] = ( float )( resultIsNumber ? resultMatrix.number() : resultMatrix.data()[j] );
-      }
+      rows[i] = i;
+    }
 
-      //write scanline to the dataset
-      if ( GDALRasterIO( outputRasterBand, GF_Write, 0, i, mNumOutputColumns, 1, calcData, mNumOutputColumns, 1, GDT_Float32, 0, 0 ) != CE_None )
-      {
-        QgsDebugMsg( "RasterIO error!" );
-      }
+    QFuture<void> future = QtConcurrent::map( rows, QgsRasterCalcRowProcessor( &kernel, &band, mNumOutputColumns, outputNodataValue ) );
+    if ( y + bandHeight < mNumOutputRows )
+    {
+      readOk = readBand( y + bandHeight, qMin( bandHeight, mNumOutputRows - y - bandHeight ), bands[1 - current] );
+    }
+    future.waitForFinished();
 
-      delete[] calcData;
+    //write the band to the dataset
+    if ( GDALRasterIO( outputRasterBand, GF_Write, 0, band.y, mNumOutputColumns, band.height, band.output.data(), mNumOutputColumns, band.height, GDT_Float32, 0, 0 ) != CE_None )
+    {
+      QgsDebugMsg( "RasterIO error!" );
     }
 
+    qDeleteAll( band.inputs );
+    band.inputs.clear();
+    current = 1 - current;
   }
 
-  if ( p )
+  //release memory
+  for ( int i = 0; i < 2; ++i )
   {
-    p->setValue( mNumOutputRows );
+    qDeleteAll( bands[i].inputs );
   }
 
-  //close datasets and release memory
-  delete calcNode;
-  qDeleteAll( inputBlocks );
-  inputBlocks.clear();
-
-  if ( p && p->wasCanceled() )
+  if ( !readOk || ( p && p->wasCanceled() ) )
   {
     //delete the dataset without closing (because it is faster)
     GDALDeleteDataset( outputDriver, TO8F( mOutputFile ) );
-    return static_cast< int >( Cancelled );
+    return static_cast< int >( readOk ? Cancelled : MemoryError );
   }
+
+  if ( p )
+  {
+    p->setValue( mNumOutputRows );
+  }
+
   GDALClose( outputDataset );
 
   return static_cast< int >( Success );
 }
 
+bool QgsRasterCalculator::readBand( int y, int height, QgsRasterCalcBand& band ) const
+{
+  band.y = y;
+  band.height = height;
+  band.output.resize( mNumOutputColumns * height );
+  qDeleteAll( band.inputs );
+  band.inputs.clear();
+
+  //extent of the rows of the band
+  double rowHeight = mOutputRectangle.height() / mNumOutputRows;
+  double yMax = mOutputRectangle.yMaximum() - y * rowHeight;
+  double yMin = y + height == mNumOutputRows ? mOutputRectangle.yMinimum() : yMax - height * rowHeight;
+  QgsRectangle extent( mOutputRectangle.xMinimum(), yMin, mOutputRectangle.xMaximum(), yMax );
+
+  QVector<QgsRasterCalculatorEntry>::const_iterator it = mRasterEntries.constBegin();
+  for ( ; it != mRasterEntries.constEnd(); ++it )
+  {
+    QgsRasterBlock* block = nullptr;
+    // if crs transform needed
+    if ( it->raster->crs() != mOutputCrs )
+    {
+      QgsRasterProjector proj;
+      proj.setCrs( it->raster->crs(), mOutputCrs );
+      proj.setInput( it->raster->dataProvider() );
+      proj.setPrecision( QgsRasterProjector::Exact );
+
+      block = proj.block( it->bandNumber, extent, mNumOutputColumns, height );
+    }
+    else
+    {
+      block = it->raster->dataProvider()->block( it->bandNumber, extent, mNumOutputColumns, height );
+    }
+    band.inputs << block;
+    if ( block->isEmpty() )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
 QgsRasterCalculator::QgsRasterCalculator()
     : mNumOutputColumns( 0 )
     , mNumOutputRows( 0 )
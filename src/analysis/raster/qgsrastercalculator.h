@@ -26,6 +26,7 @@
 
 class QgsRasterLayer;
 class QProgressDialog;
+struct QgsRasterCalcBand;
 
 
 struct ANALYSIS_EXPORT QgsRasterCalculatorEntry
@@ -78,7 +79,8 @@ class ANALYSIS_EXPORT QgsRasterCalculator
     QgsRasterCalculator( const QString& formulaString, const QString& outputFile, const QString& outputFormat,
                          const QgsRectangle& outputExtent, const QgsCoordinateReferenceSystem& outputCrs, int nOutputColumns, int nOutputRows, const QVector<QgsRasterCalculatorEntry>& rasterEntries );
 
-    /** Starts the calculation and writes new raster
+    /** Starts the calculation and writes new raster. The raster is calculated by bands of rows,
+      the rows of a band are calculated in parallel while the input rasters are read for the next band.
       @param p progress bar (or 0 if called from non-gui code)
       @return 0 in case of success*/
     //TODO QGIS 3.0 - return QgsRasterCalculator::Result
@@ -100,6 +102,10 @@ class ANALYSIS_EXPORT QgsRasterCalculator
       @param transform double[6] array that receives the GDAL parameters*/
     void outputGeoTransform( double* transform ) const;
 
+    /** Reads the blocks of the input rasters for a band of output rows
+      @return false if a block could not be read*/
+    bool readBand( int y, int height, QgsRasterCalcBand& band ) const;
+
     QString mFormulaString;
     QString mOutputFile;
     QString mOutputFormat;
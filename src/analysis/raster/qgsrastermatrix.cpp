@@ -19,6 +19,133 @@
 #include <string.h>
 #include <qmath.h>
 
+///@cond PRIVATE
+
+// Operators are applied by loops specialized for each of them, without any branch on the operator
+// within the loops, so that the compiler can vectorize them. The nodata argument is the value
+// returned for invalid operations.
+
+struct QgsRasterPlusOp { static inline double apply( double a, double b, double ) { return a + b; } };
+struct QgsRasterMinusOp { static inline double apply( double a, double b, double ) { return a - b; } };
+struct QgsRasterMulOp { static inline double apply( double a, double b, double ) { return a * b; } };
+struct QgsRasterDivOp { static inline double apply( double a, double b, double nodata ) { return b == 0 ? nodata : a / b; } };
+struct QgsRasterPowOp
+{
+  static inline double apply( double a, double b, double nodata )
+  {
+    // no complex numbers
+    if (( a == 0 && b < 0 ) || ( a < 0 && ( b - floor( b ) ) > 0 ) )
+      return nodata;
+    return qPow( a, b );
+  }
+};
+struct QgsRasterEqOp { static inline double apply( double a, double b, double ) { return a == b ? 1.0 : 0.0; } };
+struct QgsRasterNeOp { static inline double apply( double a, double b, double ) { return a == b ? 0.0 : 1.0; } };
+struct QgsRasterGtOp { static inline double apply( double a, double b, double ) { return a > b ? 1.0 : 0.0; } };
+struct QgsRasterLtOp { static inline double apply( double a, double b, double ) { return a < b ? 1.0 : 0.0; } };
+struct QgsRasterGeOp { static inline double apply( double a, double b, double ) { return a >= b ? 1.0 : 0.0; } };
+struct QgsRasterLeOp { static inline double apply( double a, double b, double ) { return a <= b ? 1.0 : 0.0; } };
+struct QgsRasterAndOp { static inline double apply( double a, double b, double ) { return a && b ? 1.0 : 0.0; } };
+struct QgsRasterOrOp { static inline double apply( double a, double b, double ) { return a || b ? 1.0 : 0.0; } };
+
+struct QgsRasterSqrtOp { static inline double apply( double a, double nodata ) { return a < 0 ? nodata : sqrt( a ); } };
+struct QgsRasterSinOp { static inline double apply( double a, double ) { return sin( a ); } };
+struct QgsRasterCosOp { static inline double apply( double a, double ) { return cos( a ); } };
+struct QgsRasterTanOp { static inline double apply( double a, double ) { return tan( a ); } };
+struct QgsRasterAsinOp { static inline double apply( double a, double ) { return asin( a ); } };
+struct QgsRasterAcosOp { static inline double apply( double a, double ) { return acos( a ); } };
+struct QgsRasterAtanOp { static inline double apply( double a, double ) { return atan( a ); } };
+struct QgsRasterSignOp { static inline double apply( double a, double ) { return -a; } };
+struct QgsRasterLogOp { static inline double apply( double a, double nodata ) { return a <= 0 ? nodata : ::log( a ); } };
+struct QgsRasterLog10Op { static inline double apply( double a, double nodata ) { return a <= 0 ? nodata : ::log10( a ); } };
+
+//! Operand made of an array of values
+struct QgsRasterArrayOperand
+{
+  explicit QgsRasterArrayOperand( const double* data ) : values( data ) {}
+  inline double operator[]( int i ) const { return values[i]; }
+  const double* values;
+};
+
+//! Operand made of a single value for all the elements
+struct QgsRasterNumberOperand
+{
+  explicit QgsRasterNumberOperand( double number ) : value( number ) {}
+  inline double operator[]( int ) const { return value; }
+  double value;
+};
+
+template <class Op, class A, class B>
+static void twoArgumentLoop( double* result, A a, B b, int count, double nodataA, double nodataB, double nodataResult )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    double x = a[i];
+    double y = b[i];
+    //operations with nodata values always generate nodata
+    result[i] = ( x == nodataA || y == nodataB ) ? nodataResult : Op::apply( x, y, nodataResult );
+  }
+}
+
+template <class A, class B>
+static void twoArgumentDispatch( QgsRasterMatrix::TwoArgOperator op, double* result, A a, B b, int count, double nodataA, double nodataB, double nodataResult )
+{
+  switch ( op )
+  {
+    case QgsRasterMatrix::opPLUS:
+      twoArgumentLoop<QgsRasterPlusOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opMINUS:
+      twoArgumentLoop<QgsRasterMinusOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opMUL:
+      twoArgumentLoop<QgsRasterMulOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opDIV:
+      twoArgumentLoop<QgsRasterDivOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opPOW:
+      twoArgumentLoop<QgsRasterPowOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opEQ:
+      twoArgumentLoop<QgsRasterEqOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opNE:
+      twoArgumentLoop<QgsRasterNeOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opGT:
+      twoArgumentLoop<QgsRasterGtOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opLT:
+      twoArgumentLoop<QgsRasterLtOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opGE:
+      twoArgumentLoop<QgsRasterGeOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opLE:
+      twoArgumentLoop<QgsRasterLeOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opAND:
+      twoArgumentLoop<QgsRasterAndOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+    case QgsRasterMatrix::opOR:
+      twoArgumentLoop<QgsRasterOrOp>( result, a, b, count, nodataA, nodataB, nodataResult );
+      break;
+  }
+}
+
+template <class Op>
+static void oneArgumentLoop( double* values, int count, double nodata )
+{
+  for ( int i = 0; i < count; ++i )
+  {
+    double value = values[i];
+    values[i] = value == nodata ? nodata : Op::apply( value, nodata );
+  }
+}
+
+///@endcond
+
 QgsRasterMatrix::QgsRasterMatrix()
     : mColumns( 0 )
     , mRows( 0 )
@@ -200,163 +327,28 @@ bool QgsRasterMatrix::oneArgumentOperation( OneArgOperator op )
     return false;
   }
 
-  int nEntries = mColumns * mRows;
-  double value;
-  for ( int i = 0; i < nEntries; ++i )
-  {
-    value = mData[i];
-    if ( value != mNodataValue )
-    {
-      switch ( op )
-      {
-        case opSQRT:
-          if ( value < 0 ) //no complex numbers
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = sqrt( value );
-          }
-          break;
-        case opSIN:
-          mData[i] = sin( value );
-          break;
-        case opCOS:
-          mData[i] = cos( value );
-          break;
-        case opTAN:
-          mData[i] = tan( value );
-          break;
-        case opASIN:
-          mData[i] = asin( value );
-          break;
-        case opACOS:
-          mData[i] = acos( value );
-          break;
-        case opATAN:
-          mData[i] = atan( value );
-          break;
-        case opSIGN:
-          mData[i] = -value;
-          break;
-        case opLOG:
-          if ( value <= 0 )
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = ::log( value );
-          }
-          break;
-        case opLOG10:
-          if ( value <= 0 )
-          {
-            mData[i] = mNodataValue;
-          }
-          else
-          {
-            mData[i] = ::log10( value );
-          }
-          break;
-      }
-    }
-  }
+  applyOneArgumentOperator( op, mData, mColumns * mRows, mNodataValue );
   return true;
 }
 
-double QgsRasterMatrix::calculateTwoArgumentOp( TwoArgOperator op, double arg1, double arg2 ) const
-{
-  switch ( op )
-  {
-    case opPLUS:
-      return arg1 + arg2;
-    case opMINUS:
-      return arg1 - arg2;
-    case opMUL:
-      return arg1 * arg2;
-    case opDIV:
-      if ( arg2 == 0 )
-      {
-        return mNodataValue;
-      }
-      else
-      {
-        return arg1 / arg2;
-      }
-    case opPOW:
-      if ( !testPowerValidity( arg1, arg2 ) )
-      {
-        return mNodataValue;
-      }
-      else
-      {
-        return qPow( arg1, arg2 );
-      }
-    case opEQ:
-      return ( arg1 == arg2 ? 1.0 : 0.0 );
-    case opNE:
-      return ( arg1 == arg2 ? 0.0 : 1.0 );
-    case opGT:
-      return ( arg1 > arg2 ? 1.0 : 0.0 );
-    case opLT:
-      return ( arg1 < arg2 ? 1.0 : 0.0 );
-    case opGE:
-      return ( arg1 >= arg2 ? 1.0 : 0.0 );
-    case opLE:
-      return ( arg1 <= arg2 ? 1.0 : 0.0 );
-    case opAND:
-      return ( arg1 && arg2 ? 1.0 : 0.0 );
-    case opOR:
-      return ( arg1 || arg2 ? 1.0 : 0.0 );
-  }
-  return mNodataValue;
-}
-
 bool QgsRasterMatrix::twoArgumentOperation( TwoArgOperator op, const QgsRasterMatrix& other )
 {
   if ( isNumber() && other.isNumber() ) //operation on two 1x1 matrices
   {
-    //operations with nodata values always generate nodata
-    if ( mData[0] == mNodataValue || other.number() == other.nodataValue() )
-    {
-      mData[0] = mNodataValue;
-    }
-    else
-    {
-      mData[0] = calculateTwoArgumentOp( op, mData[0], other.number() );
-    }
+    twoArgumentDispatch( op, mData, QgsRasterArrayOperand( mData ), QgsRasterNumberOperand( other.number() ), 1, mNodataValue, other.nodataValue(), mNodataValue );
     return true;
   }
 
   //two matrices
   if ( !isNumber() && !other.isNumber() )
   {
-    double* matrix = other.mData;
-    int nEntries = mColumns * mRows;
-    double value1, value2;
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      value1 = mData[i];
-      value2 = matrix[i];
-      if ( value1 == mNodataValue || value2 == other.mNodataValue )
-      {
-        mData[i] = mNodataValue;
-      }
-      else
-      {
-        mData[i] = calculateTwoArgumentOp( op, value1, value2 );
-      }
-    }
+    twoArgumentDispatch( op, mData, QgsRasterArrayOperand( mData ), QgsRasterArrayOperand( other.mData ), mColumns * mRows, mNodataValue, other.mNodataValue, mNodataValue );
     return true;
   }
 
   //this matrix is a single number and the other one a real matrix
   if ( isNumber() )
   {
-    double* matrix = other.mData;
     int nEntries = other.nColumns() * other.nRows();
     double value = mData[0];
     delete[] mData;
@@ -365,59 +357,59 @@ bool QgsRasterMatrix::twoArgumentOperation( TwoArgOperator op, const QgsRasterMa
     mRows = other.nRows();
     mNodataValue = other.nodataValue();
 
-    if ( value == mNodataValue )
-    {
-      for ( int i = 0; i < nEntries; ++i )
-      {
-        mData[i] = mNodataValue;
-      }
-      return true;
-    }
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      if ( matrix[i] == other.mNodataValue )
-      {
-        mData[i] = mNodataValue;
-        continue;
-      }
-
-      mData[i] = calculateTwoArgumentOp( op, value, matrix[i] );
-    }
+    twoArgumentDispatch( op, mData, QgsRasterNumberOperand( value ), QgsRasterArrayOperand( other.mData ), nEntries, mNodataValue, other.mNodataValue, mNodataValue );
     return true;
   }
   else //this matrix is a real matrix and the other a number
   {
-    double value = other.number();
-    int nEntries = mColumns * mRows;
-
-    if ( other.number() == other.mNodataValue )
-    {
-      for ( int i = 0; i < nEntries; ++i )
-      {
-        mData[i] = mNodataValue;
-      }
-      return true;
-    }
-
-    for ( int i = 0; i < nEntries; ++i )
-    {
-      if ( mData[i] == mNodataValue )
-      {
-        continue;
-      }
-
-      mData[i] = calculateTwoArgumentOp( op, mData[i], value );
-    }
+    twoArgumentDispatch( op, mData, QgsRasterArrayOperand( mData ), QgsRasterNumberOperand( other.number() ), mColumns * mRows, mNodataValue, other.mNodataValue, mNodataValue );
     return true;
   }
 }
 
-bool QgsRasterMatrix::testPowerValidity( double base, double power ) const
+void QgsRasterMatrix::applyTwoArgumentOperator( TwoArgOperator op, double* values, const double* otherValues, int count, double nodataValue )
+{
+  twoArgumentDispatch( op, values, QgsRasterArrayOperand( values ), QgsRasterArrayOperand( otherValues ), count, nodataValue, nodataValue, nodataValue );
+}
+
+void QgsRasterMatrix::applyTwoArgumentOperator( TwoArgOperator op, double* values, double otherValue, int count, double nodataValue )
 {
-  if (( base == 0 && power < 0 ) || ( base < 0 && ( power - floor( power ) ) > 0 ) )
+  twoArgumentDispatch( op, values, QgsRasterArrayOperand( values ), QgsRasterNumberOperand( otherValue ), count, nodataValue, nodataValue, nodataValue );
+}
+
+void QgsRasterMatrix::applyOneArgumentOperator( OneArgOperator op, double* values, int count, double nodataValue )
+{
+  switch ( op )
   {
-    return false;
+    case opSQRT:
+      oneArgumentLoop<QgsRasterSqrtOp>( values, count, nodataValue );
+      break;
+    case opSIN:
+      oneArgumentLoop<QgsRasterSinOp>( values, count, nodataValue );
+      break;
+    case opCOS:
+      oneArgumentLoop<QgsRasterCosOp>( values, count, nodataValue );
+      break;
+    case opTAN:
+      oneArgumentLoop<QgsRasterTanOp>( values, count, nodataValue );
+      break;
+    case opASIN:
+      oneArgumentLoop<QgsRasterAsinOp>( values, count, nodataValue );
+      break;
+    case opACOS:
+      oneArgumentLoop<QgsRasterAcosOp>( values, count, nodataValue );
+      break;
+    case opATAN:
+      oneArgumentLoop<QgsRasterAtanOp>( values, count, nodataValue );
+      break;
+    case opSIGN:
+      oneArgumentLoop<QgsRasterSignOp>( values, count, nodataValue );
+      break;
+    case opLOG:
+      oneArgumentLoop<QgsRasterLogOp>( values, count, nodataValue );
+      break;
+    case opLOG10:
+      oneArgumentLoop<QgsRasterLog10Op>( values, count, nodataValue );
+      break;
   }
-  return true;
 }
@@ -110,6 +110,34 @@ class ANALYSIS_EXPORT QgsRasterMatrix
     bool log();
     bool log10();
 
+    /** Applies a two argument operator to arrays of values, element by element. The results replace
+     * the first operands, elements with a nodata operand give nodata like with the matrix operations.
+     * @param op operator
+     * @param values first operands, receive the results
+     * @param otherValues second operands
+     * @param count number of elements
+     * @param nodataValue nodata value of the operands and results
+     * @note added in QGIS 2.99
+     * @note not available in python bindings
+     */
+    static void applyTwoArgumentOperator( TwoArgOperator op, double* values, const double* otherValues, int count, double nodataValue );
+
+    /** Applies a two argument operator to an array of values and a number, see applyTwoArgumentOperator()
+     * @note added in QGIS 2.99
+     * @note not available in python bindings
+     */
+    static void applyTwoArgumentOperator( TwoArgOperator op, double* values, double otherValue, int count, double nodataValue );
+
+    /** Applies a one argument operator to an array of values, nodata elements are left unchanged
+     * @param op operator
+     * @param values operands, receive the results
+     * @param count number of elements
+     * @param nodataValue nodata value of the operands and results
+     * @note added in QGIS 2.99
+     * @note not available in python bindings
+     */
+    static void applyOneArgumentOperator( OneArgOperator op, double* values, int count, double nodataValue );
+
   private:
     int mColumns;
     int mRows;
@@ -118,11 +146,9 @@ class ANALYSIS_EXPORT QgsRasterMatrix
 
     /** +,-,*,/,^,<,>,<=,>=,=,!=, and, or*/
     bool twoArgumentOperation( TwoArgOperator op, const QgsRasterMatrix& other );
-    double calculateTwoArgumentOp( TwoArgOperator op, double arg1, double arg2 ) const;
 
     /*sqrt, sin, cos, tan, asin, acos, atan*/
     bool oneArgumentOperation( OneArgOperator op );
-    bool testPowerValidity( double base, double power ) const;
 };
 
 #endif // QGSRASTERMATRIX_H
@@ -92,3 +92,30 @@ float QgsRuggednessFilter::processNineCellWindow( float* x11, float* x21, float*
   return sqrt( sum );
 }
 
+void QgsRuggednessFilter::processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count )
+{
+  const float inputNodata = mInputNodataValue;
+  const float outputNodata = mOutputNodataValue;
+
+  for ( int j = 0; j < count; ++j )
+  {
+    const float x22 = row[j+1];
+    if ( x22 == inputNodata )
+    {
+      result[j] = outputNodata;
+      continue;
+    }
+
+    //same order as in processNineCellWindow
+    const float neighbours[8] = { rowAbove[j], rowAbove[j+1], rowAbove[j+2], row[j], row[j+2], rowBelow[j], rowBelow[j+1], rowBelow[j+2] };
+    double sum = 0;
+    for ( int k = 0; k < 8; ++k )
+    {
+      if ( neighbours[k] != inputNodata )
+      {
+        sum += ( neighbours[k] - x22 ) * ( neighbours[k] - x22 );
+      }
+    }
+    result[j] = sqrt( sum );
+  }
+}
@@ -36,6 +36,10 @@ class ANALYSIS_EXPORT QgsRuggednessFilter: public QgsNineCellFilter
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 ) override;
 
+    /** Calculates the ruggedness index of a row of cells, see QgsNineCellFilter::processNineCellRow()
+      @note added in QGIS 2.99*/
+    void processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count ) override;
+
   private:
     QgsRuggednessFilter();
 };
@@ -17,6 +17,8 @@
 
 #include "qgsslopefilter.h"
 
+#include <QVector>
+
 QgsSlopeFilter::QgsSlopeFilter( const QString& inputFile, const QString& outputFile, const QString& outputFormat )
     : QgsDerivativeFilter( inputFile, outputFile, outputFormat )
 {
@@ -42,3 +44,24 @@ float QgsSlopeFilter::processNineCellWindow( float* x11, float* x21, float* x31,
   return atan( sqrt( derX * derX + derY * derY ) ) * 180.0 / M_PI;
 }
 
+void QgsSlopeFilter::processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count )
+{
+  QVector<float> derX( count );
+  QVector<float> derY( count );
+  calcFirstDerRow( rowAbove, row, rowBelow, derX.data(), derY.data(), count );
+
+  const float outputNodata = mOutputNodataValue;
+  const float* dx = derX.constData();
+  const float* dy = derY.constData();
+  for ( int j = 0; j < count; ++j )
+  {
+    if ( dx[j] == outputNodata || dy[j] == outputNodata )
+    {
+      result[j] = outputNodata;
+    }
+    else
+    {
+      result[j] = atan( sqrt( dx[j] * dx[j] + dy[j] * dy[j] ) ) * 180.0 / M_PI;
+    }
+  }
+}
@@ -46,3 +46,35 @@ float QgsTotalCurvatureFilter::processNineCellWindow( float* x11, float* x21, fl
 
   return dxx*dxx + 2*dxy*dxy + dyy*dyy;
 }
+
+void QgsTotalCurvatureFilter::processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count )
+{
+  const float inputNodata = mInputNodataValue;
+  const float outputNodata = mOutputNodataValue;
+  const double cellSizeAvg = ( mCellSizeX + mCellSizeY ) / 2.0;
+  const double dxxDenominator = mCellSizeX * mCellSizeX;
+  const double dxyDenominator = 4 * cellSizeAvg * cellSizeAvg;
+  const double dyyDenominator = mCellSizeY * mCellSizeY;
+
+  for ( int j = 0; j < count; ++j )
+  {
+    const float x11 = rowAbove[j], x21 = rowAbove[j+1], x31 = rowAbove[j+2];
+    const float x12 = row[j], x22 = row[j+1], x32 = row[j+2];
+    const float x13 = rowBelow[j], x23 = rowBelow[j+1], x33 = rowBelow[j+2];
+
+    //return nodata if one value is the nodata value
+    if ( x11 == inputNodata || x21 == inputNodata || x31 == inputNodata || x12 == inputNodata
+         || x22 == inputNodata || x32 == inputNodata || x13 == inputNodata || x23 == inputNodata
+         || x33 == inputNodata )
+    {
+      result[j] = outputNodata;
+      continue;
+    }
+
+    double dxx = ( x32 - 2 * x22 + x12 ) / dxxDenominator;
+    double dxy = ( -x11 + x31 + x13 - x33 ) / dxyDenominator;
+    double dyy = ( x21 - 2 * x22 + x23 ) / dyyDenominator;
+
+    result[j] = dxx * dxx + 2 * dxy * dxy + dyy * dyy;
+  }
+}
@@ -34,6 +34,10 @@ class ANALYSIS_EXPORT QgsTotalCurvatureFilter: public QgsNineCellFilter
     float processNineCellWindow( float* x11, float* x21, float* x31,
                                  float* x12, float* x22, float* x32,
                                  float* x13, float* x23, float* x33 ) override;
+
+    /** Calculates the total curvature of a row of cells, see QgsNineCellFilter::processNineCellRow()
+      @note added in QGIS 2.99*/
+    void processNineCellRow( const float* rowAbove, const float* row, const float* rowBelow, float* result, int count ) override;
 };
 
 #endif // QGSTOTALCURVATUREFILTER_H
@@ -30,6 +30,10 @@
 #include "qgsvectorlayer.h"
 
 #include <QProgressDialog>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cmath>
 
 bool QgsGeometryAnalyzer::simplify( QgsVectorLayer* layer,
                                     const QString& shapefileName,
@@ -600,134 +604,261 @@ bool QgsGeometryAnalyzer::dissolve( QgsVectorLayer* layer, const QString& shapef
   QgsCoordinateReferenceSystem crs = layer->crs();
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, crs );
-  QgsFeature currentFeature;
-  QMultiMap<QString, QgsFeatureId> map;
 
+  QgsFeatureRequest request;
+  int featureCount = layer->featureCount();
   if ( onlySelectedFeatures )
   {
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selection = layer->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selection.constBegin();
-    for ( ; it != selection.constEnd(); ++it )
+    request.setFilterFids( layer->selectedFeaturesIds() );
+    featureCount = layer->selectedFeatureCount();
+  }
+  if ( p )
+  {
+    p->setMaximum( featureCount );
+  }
+
+  //collect the geometries of each key, the output feature of a key gets the attributes of its first feature
+  QMap<QString, QList<QgsGeometry*> > keyGeometries;
+  QMap<QString, QgsAttributes> keyAttributes;
+  QgsFeatureIterator fit = layer->getFeatures( request );
+  QgsFeature currentFeature;
+  int processedFeatures = 0;
+  while ( fit.nextFeature( currentFeature ) )
+  {
+    if ( p )
     {
-      if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
+      p->setValue( processedFeatures );
     }
+    if ( p && p->wasCanceled() )
+    {
+      break;
+    }
+
+    QString key = useField ? currentFeature.attribute( uniqueIdField ).toString() : QString();
+    if ( !keyAttributes.contains( key ) )
+    {
+      keyAttributes.insert( key, currentFeature.attributes() );
+    }
+    QList<QgsGeometry*>& geometries = keyGeometries[key];
+    if ( currentFeature.constGeometry() )
+    {
+      geometries.append( new QgsGeometry( *currentFeature.constGeometry() ) );
+    }
+    ++processedFeatures;
   }
-  else
+
+  if ( p && p->wasCanceled() )
   {
-    QgsFeatureIterator fit = layer->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
+    Q_FOREACH ( const QList<QgsGeometry*>& geometries, keyGeometries )
     {
-      map.insert( currentFeature.attribute( uniqueIdField ).toString(), currentFeature.id() );
+      qDeleteAll( geometries );
     }
+    return true;
   }
 
-  QgsGeometry *dissolveGeometry = nullptr; //dissolve geometry
-  QMultiMap<QString, QgsFeatureId>::const_iterator jt = map.constBegin();
-  QgsFeature outputFeature;
-  while ( jt != map.constEnd() )
+  QMap<QString, QgsAttributes>::const_iterator jt = keyAttributes.constBegin();
+  for ( ; jt != keyAttributes.constEnd(); ++jt )
   {
-    QString currentKey = jt.key();
-    int processedFeatures = 0;
-    bool first = true;
-    //take only selection
-    if ( onlySelectedFeatures )
+    QgsFeature outputFeature;
+    outputFeature.setAttributes( jt.value() );
+    bool ok;
+    outputFeature.setGeometry( cascadedUnion( keyGeometries.value( jt.key() ), &ok ) );
+    if ( !ok )
     {
-      //use QgsVectorLayer::featureAtId
-      const QgsFeatureIds selection = layer->selectedFeaturesIds();
-      if ( p )
+      //the geometries of the other keys are still owned by the map
+      for ( ++jt; jt != keyAttributes.constEnd(); ++jt )
       {
-        p->setMaximum( selection.size() );
+        qDeleteAll( keyGeometries.value( jt.key() ) );
       }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
+      return false;
+    }
+    vWriter.addFeature( outputFeature );
+  }
+  if ( p )
+  {
+    p->setValue( featureCount );
+  }
+  return true;
+}
+
+///@cond PRIVATE
+
+//! number of geometries merged at once by the first level of a cascaded union
+static const int UNION_BATCH_SIZE = 512;
+
+class QgsGeometryAnalyzer::UnionJob
+{
+  public:
+    UnionJob()
+        : result( nullptr )
+        , failed( false )
+    {}
+
+    QList<QgsGeometry*> geometries;
+    QgsGeometry* result;
+    bool failed;
+};
+
+//! Geometry with the center of its bounding box, to order geometries spatially
+struct QgsUnionItem
+{
+  double x;
+  double y;
+  QgsGeometry* geometry;
+};
+
+static bool unionItemXLessThan( const QgsUnionItem& a, const QgsUnionItem& b )
+{
+  return a.x < b.x;
+}
+
+static bool unionItemYLessThan( const QgsUnionItem& a, const QgsUnionItem& b )
+{
+  return a.y < b.y;
+}
+
+static bool unionItemYGreaterThan( const QgsUnionItem& a, const QgsUnionItem& b )
+{
+  return a.y > b.y;
+}
+
+///@endcond
+
+QgsGeometry* QgsGeometryAnalyzer::cascadedUnion( const QList<QgsGeometry*>& geometries, bool* ok )
+{
+  if ( ok )
+  {
+    *ok = true;
+  }
+  if ( geometries.isEmpty() )
+  {
+    return nullptr;
+  }
+
+  //order the geometries in vertical slices sorted by x, each slice sorted by y in alternate directions,
+  //so that the geometries of a batch and consecutive batches are near to each other
+  QVector<QgsUnionItem> items;
+  items.reserve( geometries.size() );
+  Q_FOREACH ( QgsGeometry* geometry, geometries )
+  {
+    QgsRectangle bbox = geometry->boundingBox();
+    QgsUnionItem item;
+    item.x = ( bbox.xMinimum() + bbox.xMaximum() ) / 2.0;
+    item.y = ( bbox.yMinimum() + bbox.yMaximum() ) / 2.0;
+    item.geometry = geometry;
+    items.append( item );
+  }
+
+  const int nBatches = ( items.size() + UNION_BATCH_SIZE - 1 ) / UNION_BATCH_SIZE;
+  const int nSlices = static_cast< int >( std::ceil( std::sqrt( static_cast< double >( nBatches ) ) ) );
+  const int sliceSize = (( nBatches + nSlices - 1 ) / nSlices ) * UNION_BATCH_SIZE;
+  std::sort( items.begin(), items.end(), unionItemXLessThan );
+  for ( int slice = 0; slice * sliceSize < items.size(); ++slice )
+  {
+    QVector<QgsUnionItem>::iterator sliceBegin = items.begin() + slice * sliceSize;
+    QVector<QgsUnionItem>::iterator sliceEnd = items.begin() + qMin(( slice + 1 ) * sliceSize, items.size() );
+    std::sort( sliceBegin, sliceEnd, slice % 2 == 0 ? unionItemYLessThan : unionItemYGreaterThan );
+  }
+
+  QList<UnionJob> jobs;
+  for ( int i = 0; i < items.size(); i += UNION_BATCH_SIZE )
+  {
+    UnionJob job;
+    for ( int j = i; j < qMin( i + UNION_BATCH_SIZE, items.size() ); ++j )
+    {
+      job.geometries.append( items.at( j ).geometry );
+    }
+    jobs.append( job );
+  }
+
+  //merge the batches, then the results by pairs
+  while ( true )
+  {
+    QtConcurrent::blockingMap( jobs, &QgsGeometryAnalyzer::processUnionJob );
+
+    QList<QgsGeometry*> results;
+    bool failed = false;
+    Q_FOREACH ( const UnionJob& job, jobs )
+    {
+      failed = failed || job.failed;
+      if ( job.result )
       {
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( selection.contains( jt.value() ) )
-        {
-          if ( p )
-          {
-            p->setValue( processedFeatures );
-          }
-          if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-          {
-            continue;
-          }
-          if ( first )
-          {
-            outputFeature.setAttributes( currentFeature.attributes() );
-            first = false;
-          }
-          dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-          ++processedFeatures;
-        }
-        ++jt;
+        results.append( job.result );
       }
     }
-    //take all features
-    else
+
+    //a partial union would silently drop the geometries of the failed jobs
+    if ( failed )
     {
-      int featureCount = layer->featureCount();
-      if ( p )
+      qDeleteAll( results );
+      if ( ok )
       {
-        p->setMaximum( featureCount );
+        *ok = false;
       }
-      while ( jt != map.constEnd() && ( jt.key() == currentKey || !useField ) )
-      {
-        if ( p )
-        {
-          p->setValue( processedFeatures );
-        }
+      return nullptr;
+    }
 
-        if ( p && p->wasCanceled() )
-        {
-          break;
-        }
-        if ( !layer->getFeatures( QgsFeatureRequest().setFilterFid( jt.value() ) ).nextFeature( currentFeature ) )
-        {
-          continue;
-        }
-        {
-          outputFeature.setAttributes( currentFeature.attributes() );
-          first = false;
-        }
-        dissolveFeature( currentFeature, processedFeatures, &dissolveGeometry );
-        ++processedFeatures;
-        ++jt;
+    if ( results.size() <= 1 )
+    {
+      return results.isEmpty() ? nullptr : results.first();
+    }
+
+    jobs.clear();
+    for ( int i = 0; i < results.size(); i += 2 )
+    {
+      UnionJob job;
+      job.geometries.append( results.at( i ) );
+      if ( i + 1 < results.size() )
+      {
+        job.geometries.append( results.at( i + 1 ) );
       }
+      jobs.append( job );
     }
-    outputFeature.setGeometry( dissolveGeometry );
-    vWriter.addFeature( outputFeature );
   }
-  return true;
 }
 
-void QgsGeometryAnalyzer::dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry )
+void QgsGeometryAnalyzer::processUnionJob( UnionJob& job )
 {
-  if ( !f.constGeometry() )
+  if ( job.geometries.size() == 1 )
   {
+    job.result = job.geometries.first();
+    job.geometries.clear();
     return;
   }
 
-  const QgsGeometry* featureGeometry = f.constGeometry();
+  bool allEmpty = true;
+  Q_FOREACH ( QgsGeometry* geometry, job.geometries )
+  {
+    allEmpty = allEmpty && geometry->isEmpty();
+  }
 
-  if ( nProcessedFeatures == 0 )
+  //GEOS merges the geometries of a batch with its own cascaded union
+  job.result = QgsGeometry::unaryUnion( job.geometries );
+  if ( !allEmpty && ( !job.result || job.result->isEmpty() ) )
   {
-    int geomSize = featureGeometry->wkbSize();
-    *dissolveGeometry = new QgsGeometry();
-    unsigned char* wkb = new unsigned char[geomSize];
-    memcpy( wkb, featureGeometry->asWkb(), geomSize );
-    ( *dissolveGeometry )->fromWkb( wkb, geomSize );
+    //retry by merging the kept inputs one at a time
+    QgsDebugMsg( "union of geometries failed, merging them one by one" );
+    delete job.result;
+    job.result = new QgsGeometry( *job.geometries.first() );
+    for ( int i = 1; job.result && i < job.geometries.size(); ++i )
+    {
+      QgsGeometry* combined = job.result->combine( job.geometries.at( i ) );
+      delete job.result;
+      job.result = combined;
+    }
+    if ( !job.result || job.result->isEmpty() )
+    {
+      QgsDebugMsg( "union of geometries failed" );
+      job.failed = true;
+    }
   }
-  else
+  qDeleteAll( job.geometries );
+  job.geometries.clear();
+
+  if ( job.failed || ( job.result && job.result->isEmpty() ) )
   {
-    *dissolveGeometry = ( *dissolveGeometry )->combine( featureGeometry );
+    delete job.result;
+    job.result = nullptr;
   }
 }
 
@@ -754,7 +885,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
 
   QgsVectorFileWriter vWriter( shapefileName, dp->encoding(), layer->fields(), outputType, crs );
   QgsFeature currentFeature;
-  QgsGeometry *dissolveGeometry = nullptr; //dissolve geometry (if dissolve enabled)
+  QList<QgsGeometry*> dissolveGeometries; //buffers to dissolve (if dissolve enabled)
 
   //take only selection
   if ( onlySelectedFeatures )
@@ -783,7 +914,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
       {
         continue;
       }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
+      bufferFeature( currentFeature, &vWriter, dissolve, dissolveGeometries, bufferDistance, bufferDistanceField );
       ++processedFeatures;
     }
 
@@ -814,7 +945,7 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
       {
         break;
       }
-      bufferFeature( currentFeature, processedFeatures, &vWriter, dissolve, &dissolveGeometry, bufferDistance, bufferDistanceField );
+      bufferFeature( currentFeature, &vWriter, dissolve, dissolveGeometries, bufferDistance, bufferDistanceField );
       ++processedFeatures;
     }
     if ( p )
@@ -826,6 +957,13 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   if ( dissolve )
   {
     QgsFeature dissolveFeature;
+    bool ok;
+    QgsGeometry* dissolveGeometry = cascadedUnion( dissolveGeometries, &ok );
+    if ( !ok )
+    {
+      QgsDebugMsg( "union of the buffers failed" );
+      return false;
+    }
     if ( !dissolveGeometry )
     {
       QgsDebugMsg( "no dissolved geometry - should not happen" );
@@ -837,8 +975,8 @@ bool QgsGeometryAnalyzer::buffer( QgsVectorLayer* layer, const QString& shapefil
   return true;
 }
 
-void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve,
-    QgsGeometry** dissolveGeometry, double bufferDistance, int bufferDistanceField )
+void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, QgsVectorFileWriter* vfw, bool dissolve,
+    QList<QgsGeometry*>& dissolveGeometries, double bufferDistance, int bufferDistanceField )
 {
   if ( !f.constGeometry() )
   {
@@ -847,7 +985,6 @@ void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures,
 
   double currentBufferDistance;
   const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* tmpGeometry = nullptr;
   QgsGeometry* bufferGeometry = nullptr;
 
   //create buffer
@@ -863,16 +1000,9 @@ void QgsGeometryAnalyzer::bufferFeature( QgsFeature& f, int nProcessedFeatures,
 
   if ( dissolve )
   {
-    if ( nProcessedFeatures == 0 )
-    {
-      *dissolveGeometry = bufferGeometry;
-    }
-    else
+    if ( bufferGeometry )
     {
-      tmpGeometry = *dissolveGeometry;
-      *dissolveGeometry = ( *dissolveGeometry )->combine( bufferGeometry );
-      delete tmpGeometry;
-      delete bufferGeometry;
+      dissolveGeometries.append( bufferGeometry );
     }
   }
   else //dissolve
@@ -133,13 +133,26 @@ class ANALYSIS_EXPORT QgsGeometryAnalyzer
     void simplifyFeature( QgsFeature& f, QgsVectorFileWriter* vfw, double tolerance );
     /** Helper function to get the cetroid of an individual feature*/
     void centroidFeature( QgsFeature& f, QgsVectorFileWriter* vfw );
-    /** Helper function to buffer an individual feature*/
-    void bufferFeature( QgsFeature& f, int nProcessedFeatures, QgsVectorFileWriter* vfw, bool dissolve, QgsGeometry** dissolveGeometry,
+    /** Helper function to buffer an individual feature, the buffers to dissolve are appended to dissolveGeometries*/
+    void bufferFeature( QgsFeature& f, QgsVectorFileWriter* vfw, bool dissolve, QList<QgsGeometry*>& dissolveGeometries,
                         double bufferDistance, int bufferDistanceField );
     /** Helper function to get the convex hull of feature(s)*/
     void convexFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
-    /** Helper function to dissolve feature(s)*/
-    void dissolveFeature( QgsFeature& f, int nProcessedFeatures, QgsGeometry** dissolveGeometry );
+
+    /** Geometries merged by one step of a cascaded union */
+    class UnionJob;
+
+    /** Merges geometries with a cascaded union. The geometries are ordered spatially and merged by
+     * batches of neighbouring geometries, then the results are merged by pairs until a single
+     * geometry is left. The batches and pairs of each level are merged in parallel.
+     * @param geometries geometries to merge, deleted by the union
+     * @param ok set to false if GEOS failed to merge the geometries
+     * @returns the union, nullptr if there is no geometry to merge or if the union failed
+     */
+    static QgsGeometry* cascadedUnion( const QList<QgsGeometry*>& geometries, bool* ok = nullptr );
+
+    /** Merges the geometries of a job, called from worker threads */
+    static void processUnionJob( UnionJob& job );
 
     //helper functions for event layer
     void addEventLayerFeature( QgsFeature& feature, QgsGeometry* geom, QgsGeometry* lineGeom, QgsVectorFileWriter* fileWriter, QgsFeatureList& memoryFeatures, int offsetField = -1, double offsetScale = 1.0,
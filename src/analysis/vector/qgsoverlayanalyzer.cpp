@@ -28,7 +28,26 @@
 #include "qgsvectorfilewriter.h"
 #include "qgsvectordataprovider.h"
 #include "qgsdistancearea.h"
+#include "qgsgeometryengine.h"
 #include <QProgressDialog>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
+///@cond PRIVATE
+
+//! number of features of the first layer read and intersected at once
+static const int BATCH_FEATURES = 1000;
+
+class QgsOverlayAnalyzer::IntersectionJob
+{
+  public:
+    QgsFeature feature;
+    QVector<const QgsFeature*> candidates;
+    QgsFeatureList results;
+};
+
+///@endcond
 
 bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
                                        const QString& shapefileName, bool onlySelectedFeatures,
@@ -53,134 +72,147 @@ bool QgsOverlayAnalyzer::intersection( QgsVectorLayer* layerA, QgsVectorLayer* l
   combineFieldLists( fieldsA, fieldsB );
 
   QgsVectorFileWriter vWriter( shapefileName, dpA->encoding(), fieldsA, outputType, crs );
-  QgsFeature currentFeature;
-  QgsSpatialIndex index;
 
-  //take only selection
+  QgsFeatureRequest requestA;
+  QgsFeatureRequest requestB;
+  int featureCount = layerA->featureCount();
   if ( onlySelectedFeatures )
   {
-    const QgsFeatureIds selectionB = layerB->selectedFeaturesIds();
-    QgsFeatureIds::const_iterator it = selectionB.constBegin();
-    for ( ; it != selectionB.constEnd(); ++it )
-    {
-      if ( !layerB->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
-      {
-        continue;
-      }
-      index.insertFeature( currentFeature );
-    }
-    //use QgsVectorLayer::featureAtId
-    const QgsFeatureIds selectionA = layerA->selectedFeaturesIds();
-    if ( p )
+    requestA.setFilterFids( layerA->selectedFeaturesIds() );
+    requestB.setFilterFids( layerB->selectedFeaturesIds() );
+    featureCount = layerA->selectedFeatureCount();
+  }
+
+  //keep the features of layer B in memory, the ids of the index are their positions
+  QVector<QgsFeature> featuresB;
+  QgsSpatialIndex index;
+  QgsFeature currentFeature;
+  QgsFeatureIterator fit = layerB->getFeatures( requestB );
+  while ( fit.nextFeature( currentFeature ) )
+  {
+    const QgsGeometry* geometry = currentFeature.constGeometry();
+    if ( !geometry || !geometry->geometry() )
     {
-      p->setMaximum( selectionA.size() );
+      continue;
     }
-    QgsFeature currentFeature;
-    int processedFeatures = 0;
-    it = selectionA.constBegin();
-    for ( ; it != selectionA.constEnd(); ++it )
-    {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
+    index.insertFeature( featuresB.size(), geometry->boundingBox() );
+    featuresB.append( currentFeature );
+  }
 
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      if ( !layerA->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( currentFeature ) )
+  if ( p )
+  {
+    p->setMaximum( featureCount );
+  }
+
+  //the workers intersect a batch while this thread writes the results of the previous batch
+  //and reads the next one, so the features are written in order by a single thread
+  fit = layerA->getFeatures( requestA );
+  QList<IntersectionJob> batches[2];
+  int batchFeatures[2] = { 0, 0 };
+  int current = 0;
+  int processedFeatures = 0;
+  batchFeatures[current] = readIntersectionJobs( fit, index, featuresB, batches[current] );
+  while ( batchFeatures[current] > 0 )
+  {
+    QFuture<void> future = QtConcurrent::map( batches[current], &QgsOverlayAnalyzer::processIntersectionJob );
+
+    QList<IntersectionJob>& previous = batches[1 - current];
+    for ( QList<IntersectionJob>::iterator jobIt = previous.begin(); jobIt != previous.end(); ++jobIt )
+    {
+      for ( QgsFeatureList::iterator featureIt = jobIt->results.begin(); featureIt != jobIt->results.end(); ++featureIt )
       {
-        continue;
+        vWriter.addFeature( *featureIt );
       }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
     }
+    previous.clear();
+    batchFeatures[1 - current] = readIntersectionJobs( fit, index, featuresB, previous );
 
+    future.waitForFinished();
+    processedFeatures += batchFeatures[current];
     if ( p )
     {
-      p->setValue( selectionA.size() );
+      p->setValue( processedFeatures );
     }
+    if ( p && p->wasCanceled() )
+    {
+      return true;
+    }
+    current = 1 - current;
   }
-  //take all features
-  else
+
+  //results of the last batch
+  QList<IntersectionJob>& last = batches[1 - current];
+  for ( QList<IntersectionJob>::iterator jobIt = last.begin(); jobIt != last.end(); ++jobIt )
   {
-    QgsFeatureIterator fit = layerB->getFeatures();
-    while ( fit.nextFeature( currentFeature ) )
+    for ( QgsFeatureList::iterator featureIt = jobIt->results.begin(); featureIt != jobIt->results.end(); ++featureIt )
     {
-      index.insertFeature( currentFeature );
+      vWriter.addFeature( *featureIt );
     }
+  }
 
-    int featureCount = layerA->featureCount();
-    if ( p )
+  if ( p )
+  {
+    p->setValue( featureCount );
+  }
+  return true;
+}
+
+int QgsOverlayAnalyzer::readIntersectionJobs( QgsFeatureIterator& fit, const QgsSpatialIndex& index, const QVector<QgsFeature>& featuresB,
+    QList<IntersectionJob>& jobs )
+{
+  int nFeatures = 0;
+  QgsFeature feature;
+  while ( nFeatures < BATCH_FEATURES && fit.nextFeature( feature ) )
+  {
+    ++nFeatures;
+    const QgsGeometry* geometry = feature.constGeometry();
+    if ( !geometry || !geometry->geometry() )
     {
-      p->setMaximum( featureCount );
+      continue;
     }
-    int processedFeatures = 0;
-
-    fit = layerA->getFeatures();
 
-    QgsFeature currentFeature;
-    while ( fit.nextFeature( currentFeature ) )
+    QList<QgsFeatureId> intersects = index.intersects( geometry->boundingBox() );
+    if ( intersects.isEmpty() )
     {
-      if ( p )
-      {
-        p->setValue( processedFeatures );
-      }
-      if ( p && p->wasCanceled() )
-      {
-        break;
-      }
-      intersectFeature( currentFeature, &vWriter, layerB, &index );
-      ++processedFeatures;
+      continue;
     }
-    if ( p )
+    //candidates in the order of layer B
+    std::sort( intersects.begin(), intersects.end() );
+
+    jobs.append( IntersectionJob() );
+    IntersectionJob& job = jobs.last();
+    job.feature = feature;
+    job.candidates.reserve( intersects.size() );
+    Q_FOREACH ( QgsFeatureId id, intersects )
     {
-      p->setValue( featureCount );
+      job.candidates.append( &featuresB.at( static_cast< int >( id ) ) );
     }
   }
-  return true;
+  return nFeatures;
 }
 
-void QgsOverlayAnalyzer::intersectFeature( QgsFeature& f, QgsVectorFileWriter* vfw,
-    QgsVectorLayer* vl, QgsSpatialIndex* index )
+void QgsOverlayAnalyzer::processIntersectionJob( IntersectionJob& job )
 {
-  if ( !f.constGeometry() )
-  {
-    return;
-  }
+  const QgsAbstractGeometryV2* geometryA = job.feature.constGeometry()->geometry();
+  //the engine uses the GEOS context of the worker thread
+  QScopedPointer<QgsGeometryEngine> engine( QgsGeometry::createGeometryEngine( geometryA ) );
+  //the prepared geometry speeds up the intersects tests with the candidates
+  engine->prepareGeometry();
 
-  const QgsGeometry* featureGeometry = f.constGeometry();
-  QgsGeometry* intersectGeometry = nullptr;
-  QgsFeature overlayFeature;
-
-  QList<QgsFeatureId> intersects;
-  intersects = index->intersects( featureGeometry->boundingBox() );
-  QList<QgsFeatureId>::const_iterator it = intersects.constBegin();
-  QgsFeature outFeature;
-  for ( ; it != intersects.constEnd(); ++it )
+  Q_FOREACH ( const QgsFeature* featureB, job.candidates )
   {
-    if ( !vl->getFeatures( QgsFeatureRequest().setFilterFid( *it ) ).nextFeature( overlayFeature ) )
+    const QgsAbstractGeometryV2* geometryB = featureB->constGeometry()->geometry();
+    if ( !engine->intersects( *geometryB ) )
     {
       continue;
     }
 
-    if ( featureGeometry->intersects( overlayFeature.constGeometry() ) )
-    {
-      intersectGeometry = featureGeometry->intersection( overlayFeature.constGeometry() );
-
-      outFeature.setGeometry( intersectGeometry );
-      QgsAttributes attributesA = f.attributes();
-      QgsAttributes attributesB = overlayFeature.attributes();
-      combineAttributeMaps( attributesA, attributesB );
-      outFeature.setAttributes( attributesA );
-
-      //add it to vector file writer
-      if ( vfw )
-      {
-        vfw->addFeature( outFeature );
-      }
-    }
+    QgsFeature outFeature;
+    outFeature.setGeometry( new QgsGeometry( engine->intersection( *geometryB ) ) );
+    QgsAttributes attributes = job.feature.attributes();
+    combineAttributeMaps( attributes, featureB->attributes() );
+    outFeature.setAttributes( attributes );
+    job.results.append( outFeature );
   }
 }
 
@@ -38,6 +38,7 @@ class ANALYSIS_EXPORT QgsOverlayAnalyzer
       @param shapefileName path to the output shp
       @param onlySelectedFeatures if true, only selected features are considered, else all the features
       @param p progress dialog (or 0 if no progress dialog is to be shown)
+      @note the features are intersected in parallel, the output features are written in the order of the first layer
       */
     bool intersection( QgsVectorLayer* layerA, QgsVectorLayer* layerB,
                        const QString& shapefileName, bool onlySelectedFeatures = false,
@@ -45,9 +46,26 @@ class ANALYSIS_EXPORT QgsOverlayAnalyzer
 
   private:
 
+    /** A feature of the first layer with the features of the second layer its bounding box intersects,
+     * and the intersections computed from them.
+     */
+    class IntersectionJob;
+
     void combineFieldLists( QgsFields& fieldListA, const QgsFields& fieldListB );
-    void intersectFeature( QgsFeature& f, QgsVectorFileWriter* vfw, QgsVectorLayer* dp, QgsSpatialIndex* index );
-    void combineAttributeMaps( QgsAttributes& attributesA, const QgsAttributes& attributesB );
+    static void combineAttributeMaps( QgsAttributes& attributesA, const QgsAttributes& attributesB );
+
+    /** Reads a batch of features of the first layer and creates the jobs of the features with candidates
+     * @param fit iterator over the features of the first layer
+     * @param index bounding boxes of the features of the second layer, with their positions as ids
+     * @param featuresB features of the second layer
+     * @param jobs receives the jobs
+     * @returns number of features read
+     */
+    static int readIntersectionJobs( QgsFeatureIterator& fit, const QgsSpatialIndex& index, const QVector<QgsFeature>& featuresB,
+                                     QList<IntersectionJob>& jobs );
+
+    /** Intersects the feature of a job with its candidates, called from worker threads */
+    static void processIntersectionJob( IntersectionJob& job );
 };
 
 #endif //QGSVECTORANALYZER
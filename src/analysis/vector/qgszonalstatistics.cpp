@@ -25,6 +25,9 @@
 #include "cpl_string.h"
 #include <QProgressDialog>
 #include <QFile>
+#include <QtConcurrentMap>
+
+#include <math.h>
 
 #if defined(GDAL_VERSION_NUM) && GDAL_VERSION_NUM >= 1800
 #define TO8F(x) (x).toUtf8().constData()
@@ -32,6 +35,118 @@
 #define TO8F(x) QFile::encodeName( x ).constData()
 #endif
 
+///@cond PRIVATE
+
+// number of raster cells read and processed per batch of features
+static const int BATCH_CELLS = 1 << 22;
+// maximum number of features per batch, so progress gets updated
+static const int BATCH_FEATURES = 1000;
+
+class QgsZonalStatistics::FeatureJob
+{
+  public:
+    FeatureJob( bool storeValues = false, bool storeValueCounts = false )
+        : featureId( 0 )
+        , offsetX( 0 )
+        , offsetY( 0 )
+        , nCellsX( 0 )
+        , nCellsY( 0 )
+        , cellSizeX( 0 )
+        , cellSizeY( 0 )
+        , nodataValue( 0 )
+        , precise( false )
+        , valid( false )
+        , stats( storeValues, storeValueCounts )
+    {}
+
+    QgsFeatureId featureId;
+    //! Polygon rings of the feature
+    QgsMultiPolygon polygons;
+    //! Raster cells covered by the job
+    int offsetX;
+    int offsetY;
+    int nCellsX;
+    int nCellsY;
+    QVector<float> block;
+    //! Raster geometry
+    double cellSizeX;
+    double cellSizeY;
+    QgsRectangle rasterBBox;
+    float nodataValue;
+    //! Use the precise pixel - polygon intersection instead of the middle point test
+    bool precise;
+    //! The block has been read
+    bool valid;
+    FeatureStats stats;
+};
+
+/**
+ * Polygon edge crossing the centers of a range of rows of a job
+ */
+struct QgsZonalEdge
+{
+  double x1, y1, x2, y2;
+  int lastRow;
+};
+
+/**
+ * Clips a ring to a half plane (one step of Sutherland-Hodgman clipping)
+ * @param boundary 0: x >= value, 1: x <= value, 2: y >= value, 3: y <= value
+ */
+static void clipRing( const QVector<QgsPoint>& ring, QVector<QgsPoint>& result, int boundary, double value )
+{
+  result.clear();
+  int n = ring.size();
+  if ( n == 0 )
+    return;
+
+  const QgsPoint* prev = &ring.at( n - 1 );
+  for ( int i = 0; i < n; ++i )
+  {
+    const QgsPoint* cur = &ring.at( i );
+    double prevCoord = boundary < 2 ? prev->x() : prev->y();
+    double curCoord = boundary < 2 ? cur->x() : cur->y();
+    bool prevInside = boundary % 2 == 0 ? prevCoord >= value : prevCoord <= value;
+    bool curInside = boundary % 2 == 0 ? curCoord >= value : curCoord <= value;
+
+    if ( curInside != prevInside )
+    {
+      double t = ( value - prevCoord ) / ( curCoord - prevCoord );
+      if ( boundary < 2 )
+        result << QgsPoint( value, prev->y() + t * ( cur->y() - prev->y() ) );
+      else
+        result << QgsPoint( prev->x() + t * ( cur->x() - prev->x() ), value );
+    }
+    if ( curInside )
+      result << *cur;
+    prev = cur;
+  }
+}
+
+//! Returns the absolute area of a ring, relative to an origin close to it for precision
+static double ringArea( const QVector<QgsPoint>& ring, double originX, double originY )
+{
+  int n = ring.size();
+  if ( n < 3 )
+    return 0.0;
+
+  double area = 0.0;
+  double prevX = ring.at( n - 1 ).x() - originX;
+  double prevY = ring.at( n - 1 ).y() - originY;
+  for ( int i = 0; i < n; ++i )
+  {
+    double x = ring.at( i ).x() - originX;
+    double y = ring.at( i ).y() - originY;
+    area += prevX * y - x * prevY;
+    prevX = x;
+    prevY = y;
+  }
+  return qAbs( area ) / 2.0;
+}
+
+///@endcond
+
+
 QgsZonalStatistics::QgsZonalStatistics( QgsVectorLayer* polygonLayer, const QString& rasterFile, const QString& attributePrefix, int rasterBand, const Statistics& stats )
     : mRasterFilePath( rasterFile )
     , mRasterBand( rasterBand )
@@ -239,128 +354,162 @@ int QgsZonalStatistics::calculateStatistics( QProgressDialog* p )
   bool statsStoreValueCount = ( mStatistics & QgsZonalStatistics::Minority ) ||
                               ( mStatistics & QgsZonalStatistics::Majority );
 
-  FeatureStats featureStats( statsStoreValues, statsStoreValueCount );
   int featureCounter = 0;
+  bool featuresLeft = true;
 
   QgsChangedAttributesMap changeMap;
-  while ( fi.nextFeature( f ) )
+  while ( featuresLeft )
   {
-    if ( p )
+    //collect a batch of features with the raster cells they cover, features larger than a batch are split by rows
+    QList<FeatureJob> jobs;
+    int batchCells = 0;
+    int batchFeatures = 0;
+    while ( batchCells < BATCH_CELLS && batchFeatures < BATCH_FEATURES )
     {
-      p->setValue( featureCounter );
-    }
+      if ( !fi.nextFeature( f ) )
+      {
+        featuresLeft = false;
+        break;
+      }
 
-    if ( p && p->wasCanceled() )
-    {
-      break;
-    }
+      if ( p )
+      {
+        p->setValue( featureCounter );
+      }
 
-    if ( !f.constGeometry() )
-    {
-      ++featureCounter;
-      continue;
-    }
-    const QgsGeometry* featureGeometry = f.constGeometry();
+      if ( p && p->wasCanceled() )
+      {
+        featuresLeft = false;
+        break;
+      }
 
-    QgsRectangle featureRect = featureGeometry->boundingBox().intersect( &rasterBBox );
-    if ( featureRect.isEmpty() )
-    {
       ++featureCounter;
-      continue;
-    }
+      if ( !f.constGeometry() )
+      {
+        continue;
+      }
+      const QgsGeometry* featureGeometry = f.constGeometry();
 
-    int offsetX, offsetY, nCellsX, nCellsY;
-    if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
-    {
-      ++featureCounter;
-      continue;
-    }
+      QgsRectangle featureRect = featureGeometry->boundingBox().intersect( &rasterBBox );
+      if ( featureRect.isEmpty() )
+      {
+        continue;
+      }
 
-    //avoid access to cells outside of the raster (may occur because of rounding)
-    if (( offsetX + nCellsX ) > nCellsXGDAL )
-    {
-      nCellsX = nCellsXGDAL - offsetX;
-    }
-    if (( offsetY + nCellsY ) > nCellsYGDAL )
-    {
-      nCellsY = nCellsYGDAL - offsetY;
-    }
+      int offsetX, offsetY, nCellsX, nCellsY;
+      if ( cellInfoForBBox( rasterBBox, featureRect, cellsizeX, cellsizeY, offsetX, offsetY, nCellsX, nCellsY ) != 0 )
+      {
+        continue;
+      }
 
-    statisticsFromMiddlePointTest( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                   rasterBBox, featureStats );
+      //avoid access to cells outside of the raster (may occur because of rounding)
+      if (( offsetX + nCellsX ) > nCellsXGDAL )
+      {
+        nCellsX = nCellsXGDAL - offsetX;
+      }
+      if (( offsetY + nCellsY ) > nCellsYGDAL )
+      {
+        nCellsY = nCellsYGDAL - offsetY;
+      }
+      if ( nCellsX <= 0 || nCellsY <= 0 )
+      {
+        continue;
+      }
 
-    if ( featureStats.count <= 1 )
-    {
-      //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
-      statisticsFromPreciseIntersection( rasterBand, featureGeometry, offsetX, offsetY, nCellsX, nCellsY, cellsizeX, cellsizeY,
-                                         rasterBBox, featureStats );
+      FeatureJob job( statsStoreValues, statsStoreValueCount );
+      job.featureId = f.id();
+      if ( featureGeometry->isMultipart() )
+        job.polygons = featureGeometry->asMultiPolygon();
+      else
+        job.polygons << featureGeometry->asPolygon();
+      job.offsetX = offsetX;
+      job.nCellsX = nCellsX;
+      job.cellSizeX = cellsizeX;
+      job.cellSizeY = cellsizeY;
+      job.rasterBBox = rasterBBox;
+      job.nodataValue = mInputNodataValue;
+
+      int bandRows = qBound( 1, BATCH_CELLS / nCellsX, nCellsY );
+      for ( int row = 0; row < nCellsY; row += bandRows )
+      {
+        job.offsetY = offsetY + row;
+        job.nCellsY = qMin( bandRows, nCellsY - row );
+        jobs << job;
+      }
+      batchCells += nCellsX * qMin( bandRows, nCellsY );
+      ++batchFeatures;
     }
 
-    //write the statistics value to the vector data provider
-    QgsAttributeMap changeAttributeMap;
-    if ( mStatistics & QgsZonalStatistics::Count )
-      changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
-    if ( mStatistics & QgsZonalStatistics::Sum )
-      changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
-    if ( featureStats.count > 0 )
+    QList< QPair<QgsFeatureId, FeatureStats> > batchStats = processJobs( rasterBand, jobs );
+    for ( int featureIdx = 0; featureIdx < batchStats.size(); ++featureIdx )
     {
-      double mean = featureStats.sum / featureStats.count;
-      if ( mStatistics & QgsZonalStatistics::Mean )
-        changeAttributeMap.insert( meanIndex, QVariant( mean ) );
-      if ( mStatistics & QgsZonalStatistics::Median )
-      {
-        qSort( featureStats.values.begin(), featureStats.values.end() );
-        int size =  featureStats.values.count();
-        bool even = ( size % 2 ) < 1;
-        double medianValue;
-        if ( even )
-        {
-          medianValue = ( featureStats.values.at( size / 2 - 1 ) + featureStats.values.at( size / 2 ) ) / 2;
-        }
-        else //odd
-        {
-          medianValue = featureStats.values.at(( size + 1 ) / 2 - 1 );
-        }
-        changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
-      }
-      if ( mStatistics & QgsZonalStatistics::StDev )
+      FeatureStats& featureStats = batchStats[ featureIdx ].second;
+
+      //write the statistics value to the vector data provider
+      QgsAttributeMap changeAttributeMap;
+      if ( mStatistics & QgsZonalStatistics::Count )
+        changeAttributeMap.insert( countIndex, QVariant( featureStats.count ) );
+      if ( mStatistics & QgsZonalStatistics::Sum )
+        changeAttributeMap.insert( sumIndex, QVariant( featureStats.sum ) );
+      if ( featureStats.count > 0 )
       {
-        double sumSquared = 0;
-        for ( int i = 0; i < featureStats.values.count(); ++i )
+        double mean = featureStats.sum / featureStats.count;
+        if ( mStatistics & QgsZonalStatistics::Mean )
+          changeAttributeMap.insert( meanIndex, QVariant( mean ) );
+        if ( mStatistics & QgsZonalStatistics::Median )
         {
-          double diff = featureStats.values.at( i ) - mean;
-          sumSquared += diff * diff;
+          qSort( featureStats.values.begin(), featureStats.values.end() );
+          int size =  featureStats.values.count();
+          bool even = ( size % 2 ) < 1;
+          double medianValue;
+          if ( even )
+          {
+            medianValue = ( featureStats.values.at( size / 2 - 1 ) + featureStats.values.at( size / 2 ) ) / 2;
+          }
+          else //odd
+          {
+            medianValue = featureStats.values.at(( size + 1 ) / 2 - 1 );
+          }
+          changeAttributeMap.insert( medianIndex, QVariant( medianValue ) );
         }
-        double stdev = qPow( sumSquared / featureStats.values.count(), 0.5 );
-        changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
-      }
-      if ( mStatistics & QgsZonalStatistics::Min )
-        changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Max )
-        changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
-      if ( mStatistics & QgsZonalStatistics::Range )
-        changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
-      if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
-      {
-        QList<int> vals = featureStats.valueCount.values();
-        qSort( vals.begin(), vals.end() );
-        if ( mStatistics & QgsZonalStatistics::Minority )
+        if ( mStatistics & QgsZonalStatistics::StDev )
         {
-          float minorityKey = featureStats.valueCount.key( vals.first() );
-          changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
+          double sumSquared = 0;
+          for ( int i = 0; i < featureStats.values.count(); ++i )
+          {
+            double diff = featureStats.values.at( i ) - mean;
+            sumSquared += diff * diff;
+          }
+          double stdev = qPow( sumSquared / featureStats.values.count(), 0.5 );
+          changeAttributeMap.insert( stdevIndex, QVariant( stdev ) );
         }
-        if ( mStatistics & QgsZonalStatistics::Majority )
+        if ( mStatistics & QgsZonalStatistics::Min )
+          changeAttributeMap.insert( minIndex, QVariant( featureStats.min ) );
+        if ( mStatistics & QgsZonalStatistics::Max )
+          changeAttributeMap.insert( maxIndex, QVariant( featureStats.max ) );
+        if ( mStatistics & QgsZonalStatistics::Range )
+          changeAttributeMap.insert( rangeIndex, QVariant( featureStats.max - featureStats.min ) );
+        if ( mStatistics & QgsZonalStatistics::Minority || mStatistics & QgsZonalStatistics::Majority )
         {
-          float majKey = featureStats.valueCount.key( vals.last() );
-          changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
+          QList<int> vals = featureStats.valueCount.values();
+          qSort( vals.begin(), vals.end() );
+          if ( mStatistics & QgsZonalStatistics::Minority )
+          {
+            float minorityKey = featureStats.valueCount.key( vals.first() );
+            changeAttributeMap.insert( minorityIndex, QVariant( minorityKey ) );
+          }
+          if ( mStatistics & QgsZonalStatistics::Majority )
+          {
+            float majKey = featureStats.valueCount.key( vals.last() );
+            changeAttributeMap.insert( majorityIndex, QVariant( majKey ) );
+          }
         }
+        if ( mStatistics & QgsZonalStatistics::Variety )
+          changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
       }
-      if ( mStatistics & QgsZonalStatistics::Variety )
-        changeAttributeMap.insert( varietyIndex, QVariant( featureStats.valueCount.count() ) );
-    }
 
-    changeMap.insert( f.id(), changeAttributeMap );
-    ++featureCounter;
+      changeMap.insert( batchStats.at( featureIdx ).first, changeAttributeMap );
+    }
   }
 
   vectorProvider->changeAttributeValues( changeMap );
@@ -408,117 +557,235 @@ int QgsZonalStatistics::cellInfoForBBox( const QgsRectangle& rasterBBox, const Q
   return 0;
 }
 
-void QgsZonalStatistics::statisticsFromMiddlePointTest( void* band, const QgsGeometry* poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats &stats )
+QList< QPair<QgsFeatureId, QgsZonalStatistics::FeatureStats> > QgsZonalStatistics::processJobs( void* band, QList<FeatureJob>& jobs ) const
 {
-  double cellCenterX, cellCenterY;
+  //GDAL handles may not be shared between threads: blocks are read here and processed in parallel,
+  //by groups of jobs holding at most BATCH_CELLS cells
+  int groupStart = 0;
+  while ( groupStart < jobs.size() )
+  {
+    int groupEnd = groupStart;
+    int groupCells = 0;
+    while ( groupEnd < jobs.size() && ( groupEnd == groupStart || groupCells + jobs.at( groupEnd ).nCellsX * jobs.at( groupEnd ).nCellsY <= BATCH_CELLS ) )
+    {
+      groupCells += jobs.at( groupEnd ).nCellsX * jobs.at( groupEnd ).nCellsY;
+      ++groupEnd;
+    }
+
+    for ( int i = groupStart; i < groupEnd; ++i )
+    {
+      FeatureJob& job = jobs[i];
+      job.block.resize( job.nCellsX * job.nCellsY );
+      job.valid = GDALRasterIO( band, GF_Read, job.offsetX, job.offsetY, job.nCellsX, job.nCellsY, job.block.data(),
+                                job.nCellsX, job.nCellsY, GDT_Float32, 0, 0 ) == CE_None;
+      if ( !job.valid )
+      {
+        QgsDebugMsg( "Raster IO Error" );
+      }
+    }
 
-  float* scanLine = ( float * ) CPLMalloc( sizeof( float ) * nCellsX );
-  cellCenterY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  stats.reset();
+    QList<FeatureJob>::iterator groupBegin = jobs.begin() + groupStart;
+    QtConcurrent::blockingMap( groupBegin, groupBegin + ( groupEnd - groupStart ), &QgsZonalStatistics::processJob );
 
-  const GEOSGeometry* polyGeos = poly->asGeos();
-  if ( !polyGeos )
+    for ( int i = groupStart; i < groupEnd; ++i )
+    {
+      jobs[i].block = QVector<float>();
+    }
+    groupStart = groupEnd;
+  }
+
+  //merge the jobs of each feature
+  QList< QPair<QgsFeatureId, FeatureStats> > results;
+  QVector<int> jobResult( jobs.size() );
+  for ( int i = 0; i < jobs.size(); ++i )
   {
-    return;
+    if ( results.isEmpty() || results.last().first != jobs.at( i ).featureId )
+      results << qMakePair( jobs.at( i ).featureId, jobs.at( i ).stats );
+    else
+      results.last().second.merge( jobs.at( i ).stats );
+    jobResult[i] = results.size() - 1;
   }
 
-  GEOSContextHandle_t geosctxt = QgsGeometry::getGEOSHandler();
-  const GEOSPreparedGeometry* polyGeosPrepared = GEOSPrepare_r( geosctxt, poly->asGeos() );
-  if ( !polyGeosPrepared )
+  //the cell resolution is probably larger than the polygon area. We switch to precise pixel - polygon intersection in this case
+  QList<FeatureJob> preciseJobs;
+  QList<int> preciseResults;
+  for ( int i = 0; i < jobs.size(); ++i )
   {
-    return;
+    if ( !jobs.at( i ).precise && results.at( jobResult.at( i ) ).second.count <= 1 )
+    {
+      preciseJobs << jobs.at( i );
+      preciseJobs.last().precise = true;
+      preciseResults << jobResult.at( i );
+    }
+  }
+  if ( !preciseJobs.isEmpty() )
+  {
+    processJobs( band, preciseJobs );
+    for ( int i = 0; i < preciseJobs.size(); ++i )
+    {
+      FeatureStats& featureStats = results[ preciseResults.at( i )].second;
+      if ( i == 0 || preciseResults.at( i - 1 ) != preciseResults.at( i ) )
+        featureStats = preciseJobs.at( i ).stats;
+      else
+        featureStats.merge( preciseJobs.at( i ).stats );
+    }
   }
 
-  GEOSCoordSequence* cellCenterCoords = nullptr;
-  GEOSGeometry* currentCellCenter = nullptr;
+  return results;
+}
 
-  for ( int i = 0; i < nCellsY; ++i )
+void QgsZonalStatistics::processJob( FeatureJob& job )
+{
+  job.stats.reset();
+  if ( !job.valid )
+    return;
+
+  if ( job.precise )
+    statisticsFromPreciseIntersection( job, job.stats );
+  else
+    statisticsFromMiddlePointTest( job, job.stats );
+}
+
+void QgsZonalStatistics::statisticsFromMiddlePointTest( const FeatureJob& job, FeatureStats &stats )
+{
+  //scanline rasterization: the cells of a row whose center lies between two crossings of the
+  //row center line with the polygon rings are inside the polygon (even-odd rule)
+  double originX = job.rasterBBox.xMinimum() + job.offsetX * job.cellSizeX;
+  double originY = job.rasterBBox.yMaximum() - job.offsetY * job.cellSizeY;
+
+  //edge table, by first crossed row
+  QVector< QVector<QgsZonalEdge> > edgeTable( job.nCellsY );
+  for ( int i = 0; i < job.polygons.size(); ++i )
   {
-    if ( GDALRasterIO( band, GF_Read, pixelOffsetX, pixelOffsetY + i, nCellsX, 1, scanLine, nCellsX, 1, GDT_Float32, 0, 0 )
-         != CPLE_None )
+    const QgsPolygon& polygon = job.polygons.at( i );
+    for ( int j = 0; j < polygon.size(); ++j )
     {
-      continue;
+      const QgsPolyline& ring = polygon.at( j );
+      for ( int k = 1; k < ring.size(); ++k )
+      {
+        QgsZonalEdge edge;
+        edge.x1 = ring.at( k - 1 ).x();
+        edge.y1 = ring.at( k - 1 ).y();
+        edge.x2 = ring.at( k ).x();
+        edge.y2 = ring.at( k ).y();
+        if ( edge.y1 == edge.y2 )
+          continue;
+
+        //rows whose center y satisfies min(y1, y2) <= y < max(y1, y2), widened by one row against rounding
+        int firstRow = static_cast< int >( floor(( originY - qMax( edge.y1, edge.y2 ) ) / job.cellSizeY - 0.5 ) );
+        edge.lastRow = static_cast< int >( floor(( originY - qMin( edge.y1, edge.y2 ) ) / job.cellSizeY - 0.5 ) ) + 1;
+        if ( edge.lastRow < 0 || firstRow >= job.nCellsY )
+          continue;
+        edgeTable[ qMax( firstRow, 0 )] << edge;
+      }
     }
-    cellCenterX = rasterBBox.xMinimum() + pixelOffsetX * cellSizeX + cellSizeX / 2;
-    for ( int j = 0; j < nCellsX; ++j )
+  }
+
+  QVector<QgsZonalEdge> activeEdges;
+  QVector<double> crossings;
+  for ( int row = 0; row < job.nCellsY; ++row )
+  {
+    activeEdges << edgeTable.at( row );
+    edgeTable[ row ].clear();
+
+    double cellCenterY = originY - ( row + 0.5 ) * job.cellSizeY;
+    crossings.clear();
+    for ( int i = activeEdges.size() - 1; i >= 0; --i )
     {
-      if ( validPixel( scanLine[j] ) )
+      const QgsZonalEdge& edge = activeEdges.at( i );
+      if ( edge.lastRow < row )
       {
-        GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-        cellCenterCoords = GEOSCoordSeq_create_r( geosctxt, 1, 2 );
-        GEOSCoordSeq_setX_r( geosctxt, cellCenterCoords, 0, cellCenterX );
-        GEOSCoordSeq_setY_r( geosctxt, cellCenterCoords, 0, cellCenterY );
-        currentCellCenter = GEOSGeom_createPoint_r( geosctxt, cellCenterCoords );
-        if ( GEOSPreparedContains_r( geosctxt, polyGeosPrepared, currentCellCenter ) )
+        activeEdges.remove( i );
+        continue;
+      }
+      if (( edge.y1 > cellCenterY ) != ( edge.y2 > cellCenterY ) )
+      {
+        crossings << edge.x1 + ( cellCenterY - edge.y1 ) * ( edge.x2 - edge.x1 ) / ( edge.y2 - edge.y1 );
+      }
+    }
+    qSort( crossings.begin(), crossings.end() );
+
+    const float* scanLine = job.block.constData() + row * job.nCellsX;
+    for ( int i = 0; i + 1 < crossings.size(); i += 2 )
+    {
+      //columns whose center x lies in [crossings[i], crossings[i + 1])
+      int firstColumn = qMax( 0, static_cast< int >( ceil(( crossings.at( i ) - originX ) / job.cellSizeX - 0.5 ) ) );
+      int lastColumn = qMin( job.nCellsX - 1, static_cast< int >( ceil(( crossings.at( i + 1 ) - originX ) / job.cellSizeX - 0.5 ) ) - 1 );
+      for ( int j = firstColumn; j <= lastColumn; ++j )
+      {
+        if ( validPixel( scanLine[j], job.nodataValue ) )
         {
           stats.addValue( scanLine[j] );
         }
       }
-      cellCenterX += cellSizeX;
     }
-    cellCenterY -= cellSizeY;
   }
-  GEOSGeom_destroy_r( geosctxt, currentCellCenter );
-  CPLFree( scanLine );
-  GEOSPreparedGeom_destroy_r( geosctxt, polyGeosPrepared );
 }
 
-void QgsZonalStatistics::statisticsFromPreciseIntersection( void* band, const QgsGeometry* poly, int pixelOffsetX,
-    int pixelOffsetY, int nCellsX, int nCellsY, double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats &stats )
+void QgsZonalStatistics::statisticsFromPreciseIntersection( const FeatureJob& job, FeatureStats &stats )
 {
-  stats.reset();
-
-  double currentY = rasterBBox.yMaximum() - pixelOffsetY * cellSizeY - cellSizeY / 2;
-  float* pixelData = ( float * ) CPLMalloc( sizeof( float ) );
-  QgsGeometry* pixelRectGeometry = nullptr;
-
-  double hCellSizeX = cellSizeX / 2.0;
-  double hCellSizeY = cellSizeY / 2.0;
-  double pixelArea = cellSizeX * cellSizeY;
-  double weight = 0;
-
-  for ( int row = 0; row < nCellsY; ++row )
-  {
-    double currentX = rasterBBox.xMinimum() + cellSizeX / 2.0 + pixelOffsetX * cellSizeX;
-    for ( int col = 0; col < nCellsX; ++col )
+  //the polygon rings are clipped to each row, then the row parts to each cell of the row
+  double originX = job.rasterBBox.xMinimum() + job.offsetX * job.cellSizeX;
+  double originY = job.rasterBBox.yMaximum() - job.offsetY * job.cellSizeY;
+  double pixelArea = job.cellSizeX * job.cellSizeY;
+
+  QVector< QVector<QgsPoint> > rowRings;
+  QVector<bool> rowRingIsHole;
+  QVector<QgsPoint> clipped;
+  QVector<QgsPoint> cellRing;
+  for ( int row = 0; row < job.nCellsY; ++row )
+  {
+    double rowMaxY = originY - row * job.cellSizeY;
+    double rowMinY = rowMaxY - job.cellSizeY;
+
+    rowRings.clear();
+    rowRingIsHole.clear();
+    for ( int i = 0; i < job.polygons.size(); ++i )
     {
-      if ( GDALRasterIO( band, GF_Read, pixelOffsetX + col, pixelOffsetY + row, nCellsX, 1, pixelData, 1, 1, GDT_Float32, 0, 0 ) != CE_None )
+      const QgsPolygon& polygon = job.polygons.at( i );
+      for ( int j = 0; j < polygon.size(); ++j )
       {
-        QgsDebugMsg( "Raster IO Error" );
+        clipRing( polygon.at( j ), clipped, 3, rowMaxY );
+        QVector<QgsPoint> rowRing;
+        clipRing( clipped, rowRing, 2, rowMinY );
+        if ( rowRing.size() < 3 )
+          continue;
+        rowRings << rowRing;
+        rowRingIsHole << ( j > 0 );
       }
+    }
+    if ( rowRings.isEmpty() )
+      continue;
 
-      if ( !validPixel( *pixelData ) )
+    const float* scanLine = job.block.constData() + row * job.nCellsX;
+    for ( int col = 0; col < job.nCellsX; ++col )
+    {
+      if ( !validPixel( scanLine[col], job.nodataValue ) )
         continue;
 
-      pixelRectGeometry = QgsGeometry::fromRect( QgsRectangle( currentX - hCellSizeX, currentY - hCellSizeY, currentX + hCellSizeX, currentY + hCellSizeY ) );
-      if ( pixelRectGeometry )
+      double cellMinX = originX + col * job.cellSizeX;
+      double cellMaxX = cellMinX + job.cellSizeX;
+      double intersectionArea = 0.0;
+      for ( int i = 0; i < rowRings.size(); ++i )
       {
-        //intersection
-        QgsGeometry *intersectGeometry = pixelRectGeometry->intersection( poly );
-        if ( intersectGeometry )
-        {
-          double intersectionArea = intersectGeometry->area();
-          if ( intersectionArea >= 0.0 )
-          {
-            weight = intersectionArea / pixelArea;
-            stats.addValue( *pixelData, weight );
-          }
-          delete intersectGeometry;
-        }
-        delete pixelRectGeometry;
-        pixelRectGeometry = nullptr;
+        clipRing( rowRings.at( i ), clipped, 0, cellMinX );
+        clipRing( clipped, cellRing, 1, cellMaxX );
+        double area = ringArea( cellRing, cellMinX, rowMinY );
+        intersectionArea += rowRingIsHole.at( i ) ? -area : area;
+      }
+
+      if ( intersectionArea > 0.0 )
+      {
+        double weight = qMin( intersectionArea / pixelArea, 1.0 );
+        stats.addValue( scanLine[col], weight );
       }
-      currentX += cellSizeX;
     }
-    currentY -= cellSizeY;
   }
-  CPLFree( pixelData );
 }
 
-bool QgsZonalStatistics::validPixel( float value ) const
+bool QgsZonalStatistics::validPixel( float value, float nodataValue )
 {
-  if ( value == mInputNodataValue || qIsNaN( value ) )
+  if ( value == nodataValue || qIsNaN( value ) )
   {
     return false;
   }
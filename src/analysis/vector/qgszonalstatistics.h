@@ -19,10 +19,14 @@
 #define QGSZONALSTATISTICS_H
 
 #include <QString>
+#include <QList>
 #include <QMap>
+#include <QPair>
 #include <limits>
 #include <cfloat>
 
+#include "qgsfeature.h"
+
 class QgsGeometry;
 class QgsVectorLayer;
 class QProgressDialog;
@@ -91,6 +95,17 @@ class ANALYSIS_EXPORT QgsZonalStatistics
           if ( mStoreValues )
             values.append( value );
         }
+        //! Adds the values of statistics computed over another part of the same feature
+        void merge( const FeatureStats& other )
+        {
+          sum += other.sum;
+          count += other.count;
+          min = qMin( min, other.min );
+          max = qMax( max, other.max );
+          for ( QMap< float, int >::const_iterator it = other.valueCount.constBegin(); it != other.valueCount.constEnd(); ++it )
+            valueCount.insert( it.key(), valueCount.value( it.key(), 0 ) + it.value() );
+          values.append( other.values );
+        }
         double sum;
         double count;
         float max;
@@ -108,16 +123,27 @@ class ANALYSIS_EXPORT QgsZonalStatistics
     int cellInfoForBBox( const QgsRectangle& rasterBBox, const QgsRectangle& featureBBox, double cellSizeX, double cellSizeY,
                          int& offsetX, int& offsetY, int& nCellsX, int& nCellsY ) const;
 
+    /** Raster cells covering (part of) a feature and the statistics computed from them.
+     * Features larger than a block are split into several jobs of full rows.
+     */
+    class FeatureJob;
+
+    /** Reads the raster blocks of jobs and computes their statistics in parallel
+     * @returns statistics of each feature, in the order of the jobs
+     */
+    QList< QPair<QgsFeatureId, FeatureStats> > processJobs( void* band, QList<FeatureJob>& jobs ) const;
+
+    /** Computes the statistics of a job from its raster block, called from worker threads */
+    static void processJob( FeatureJob& job );
+
     /** Returns statistics by considering the pixels where the center point is within the polygon (fast)*/
-    void statisticsFromMiddlePointTest( void* band, const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                        double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats& stats );
+    static void statisticsFromMiddlePointTest( const FeatureJob& job, FeatureStats& stats );
 
     /** Returns statistics with precise pixel - polygon intersection test (slow) */
-    void statisticsFromPreciseIntersection( void* band, const QgsGeometry* poly, int pixelOffsetX, int pixelOffsetY, int nCellsX, int nCellsY,
-                                            double cellSizeX, double cellSizeY, const QgsRectangle& rasterBBox, FeatureStats& stats );
+    static void statisticsFromPreciseIntersection( const FeatureJob& job, FeatureStats& stats );
 
     /** Tests whether a pixel's value should be included in the result*/
-    bool validPixel( float value ) const;
+    static bool validPixel( float value, float nodataValue );
 
     QString getUniqueFieldName( const QString& fieldName );
 
@@ -0,0 +1,96 @@
+/***************************************************************************
+    qgscoordinatearray.cpp
+    ---------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgscoordinatearray.h"
+
+#include <string.h>
+
+QgsCoordinateArray::QgsCoordinateArray()
+    : mOffset( 0 )
+    , mSize( 0 )
+{
+}
+
+void QgsCoordinateArray::detach()
+{
+  if ( !isView() )
+    return;
+
+  mValues.resize( mSize );
+  if ( mSize > 0 )
+    memcpy( mValues.data(), mArena->constData() + mOffset, mSize * sizeof( double ) );
+  mArena.clear();
+  mOffset = 0;
+  mSize = 0;
+}
+
+void QgsCoordinateArray::clear()
+{
+  mValues.clear();
+  mArena.clear();
+  mOffset = 0;
+  mSize = 0;
+}
+
+QgsCoordinateArray& QgsCoordinateArray::operator+=( const QgsCoordinateArray& other )
+{
+  // other may be this array
+  const int otherSize = other.size();
+  if ( otherSize == 0 )
+    return *this;
+
+  detach();
+  const int oldSize = mValues.size();
+  mValues.resize( oldSize + otherSize );
+  memcpy( mValues.data() + oldSize, &other == this ? mValues.constData() : other.constData(), otherSize * sizeof( double ) );
+  return *this;
+}
+
+QVector<double> QgsCoordinateArray::toVector() const
+{
+  if ( !isView() )
+    return mValues;
+
+  QVector<double> values( mSize );
+  if ( mSize > 0 )
+    memcpy( values.data(), constData(), mSize * sizeof( double ) );
+  return values;
+}
+
+
+QgsCoordinateArena::QgsCoordinateArena( int capacity )
+    : mBlock( new QVector<double>( qMax( capacity, 0 ) ) )
+    , mUsed( 0 )
+{
+}
+
+double* QgsCoordinateArena::allocate( int size, QgsCoordinateArray& array )
+{
+  array.clear();
+  if ( size <= 0 )
+    return nullptr;
+
+  if ( mUsed + size > mBlock->size() )
+  {
+    array.mValues.resize( size );
+    return array.mValues.data();
+  }
+
+  array.mArena = mBlock;
+  array.mOffset = mUsed;
+  array.mSize = size;
+  mUsed += size;
+  // the block is only referenced through QSharedPointer, so writing to it does not copy it
+  return mBlock->data() + array.mOffset;
+}
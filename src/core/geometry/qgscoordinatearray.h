@@ -0,0 +1,144 @@
+/***************************************************************************
+    qgscoordinatearray.h
+    ---------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSCOORDINATEARRAY_H
+#define QGSCOORDINATEARRAY_H
+
+#include <QSharedPointer>
+#include <QVector>
+
+class QgsCoordinateArena;
+
+/** \ingroup core
+ * \class QgsCoordinateArray
+ * \brief Array of coordinate values of a geometry, either owning its values or viewing values
+ * stored in a QgsCoordinateArena.
+ *
+ * The array has the subset of the QVector<double> API used by the geometry classes. Reading
+ * a view reads the arena directly, any modification first detaches the view by copying its
+ * values to an array of its own, so the arena is never written through a view. Copying an
+ * array is cheap in both cases: owned values are implicitly shared and views share the arena.
+ *
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsCoordinateArray
+{
+  public:
+    typedef double* iterator;
+    typedef const double* const_iterator;
+    typedef double value_type;
+
+    //! Creates an empty array
+    QgsCoordinateArray();
+
+    //! Returns true if the values are stored in an arena
+    bool isView() const { return !mArena.isNull(); }
+
+    /** Copies the values of a view to an array of its own, which releases the reference to the arena.
+     * Called by all the non-const methods, does nothing if the array is not a view.
+     */
+    void detach();
+
+    int size() const { return isView() ? mSize : mValues.size(); }
+    int count() const { return size(); }
+    bool isEmpty() const { return size() == 0; }
+
+    const double* constData() const { return isView() ? mArena->constData() + mOffset : mValues.constData(); }
+    const double* data() const { return constData(); }
+    double* data() { detach(); return mValues.data(); }
+
+    double at( int i ) const { Q_ASSERT( i >= 0 && i < size() ); return constData()[i]; }
+    double operator[]( int i ) const { return at( i ); }
+    double& operator[]( int i ) { detach(); return mValues[i]; }
+
+    const_iterator begin() const { return constData(); }
+    const_iterator end() const { return constData() + size(); }
+    const_iterator constBegin() const { return begin(); }
+    const_iterator constEnd() const { return end(); }
+    iterator begin() { detach(); return mValues.begin(); }
+    iterator end() { detach(); return mValues.end(); }
+
+    void clear();
+    void resize( int size ) { detach(); mValues.resize( size ); }
+    void reserve( int size ) { detach(); mValues.reserve( size ); }
+    void append( double value ) { detach(); mValues.append( value ); }
+    void insert( int i, double value ) { detach(); mValues.insert( i, value ); }
+    void insert( int i, int count, double value ) { detach(); mValues.insert( i, count, value ); }
+    void remove( int i ) { detach(); mValues.remove( i ); }
+    void pop_back() { detach(); mValues.pop_back(); }
+
+    QgsCoordinateArray& operator<<( double value ) { append( value ); return *this; }
+    QgsCoordinateArray& operator+=( const QgsCoordinateArray& other );
+
+    //! Returns a copy of the values
+    QVector<double> toVector() const;
+
+  private:
+
+    //! Values, when the array is not a view
+    QVector<double> mValues;
+
+    //! Values of the arena, when the array is a view
+    QSharedPointer< QVector<double> > mArena;
+    int mOffset;
+    int mSize;
+
+    friend class QgsCoordinateArena;
+};
+
+/** \ingroup core
+ * \class QgsCoordinateArena
+ * \brief A single allocation holding the coordinates of several line strings.
+ *
+ * Decoding a geometry with many parts and rings normally allocates one array per ring and
+ * dimension. When an arena is given to the WKB readers of the geometries, the coordinates of
+ * all the line strings are copied into the arena instead, and the line strings only hold views
+ * of it. The arena is released when the last view is destroyed or detached, so a geometry
+ * which is modified or which only keeps a small part of the arena should be detached.
+ *
+ * The capacity of an arena is fixed, coordinates allocated once it is full are stored in
+ * arrays of their own. An arena can be shared by the geometries of several features, but
+ * not by several threads.
+ *
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsCoordinateArena
+{
+  public:
+
+    //! Creates an arena able to hold capacity values
+    explicit QgsCoordinateArena( int capacity );
+
+    //! Returns the number of values the arena can hold
+    int capacity() const { return mBlock->size(); }
+
+    //! Returns the number of values already allocated
+    int used() const { return mUsed; }
+
+    /** Allocates values in the arena
+     * @param size number of values
+     * @param array receives a view of the values, or an array of its own if the arena is full
+     * @returns pointer to the values, which must be filled before using the array
+     */
+    double* allocate( int size, QgsCoordinateArray& array );
+
+  private:
+
+    QSharedPointer< QVector<double> > mBlock;
+    int mUsed;
+};
+
+#endif // QGSCOORDINATEARRAY_H
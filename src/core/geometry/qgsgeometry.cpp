@@ -17,6 +17,7 @@ email                : morb at ozemail dot com dot au
 #include <cstdarg>
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 
 #include "qgis.h"
 #include "qgsgeometry.h"
@@ -46,6 +47,8 @@ email                : morb at ozemail dot com dot au
 #include "qgspolygonv2.h"
 #include "qgslinestringv2.h"
 
+#include <QMutex>
+
 #ifndef Q_WS_WIN
 #include <netinet/in.h>
 #else
@@ -54,15 +57,43 @@ email                : morb at ozemail dot com dot au
 
 struct QgsGeometryPrivate
 {
-  QgsGeometryPrivate(): ref( 1 ), geometry( nullptr ), mWkb( nullptr ), mWkbSize( 0 ), mGeos( nullptr ) {}
-  ~QgsGeometryPrivate() { delete geometry; delete[] mWkb; GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), mGeos ); }
+  QgsGeometryPrivate(): ref( 1 ), mGeometry( nullptr ), mWkb( nullptr ), mWkbSize( 0 ), mWkbPending( 0 ), mGeos( nullptr ) {}
+  ~QgsGeometryPrivate() { delete mGeometry; delete[] mWkb; GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), mGeos ); }
+
+  //! Returns the geometry, decoding the WKB set by QgsGeometry::fromWkb() on first use
+  QgsAbstractGeometryV2* geometry()
+  {
+    if ( mWkbPending.loadAcquire() )
+      decodeWkb();
+    return mGeometry;
+  }
+
+  void decodeWkb()
+  {
+    // the data can be shared by geometries used in different threads, only one of them decodes it
+    QMutexLocker locker( &sDecodeMutexes[ ( reinterpret_cast< quintptr >( this ) / sizeof( void* ) ) % DECODE_MUTEX_COUNT ] );
+    if ( !mWkbPending.loadAcquire() )
+      return;
+
+    // the buffer is kept if it is not valid, asWkb() may have returned it already
+    mGeometry = QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr( mWkb, mWkbSize ) );
+    mWkbPending.storeRelease( 0 );
+  }
+
+  static const int DECODE_MUTEX_COUNT = 16;
+  static QMutex sDecodeMutexes[ DECODE_MUTEX_COUNT ];
+
   QAtomicInt ref;
-  QgsAbstractGeometryV2* geometry;
+  QgsAbstractGeometryV2* mGeometry;
   mutable const unsigned char* mWkb; //store wkb pointer for backward compatibility
   mutable int mWkbSize;
+  //! Non zero if mWkb has not been decoded to mGeometry yet
+  QAtomicInt mWkbPending;
   mutable GEOSGeometry* mGeos;
 };
 
+QMutex QgsGeometryPrivate::sDecodeMutexes[ QgsGeometryPrivate::DECODE_MUTEX_COUNT ];
+
 QgsGeometry::QgsGeometry(): d( new QgsGeometryPrivate() )
 {
 }
@@ -75,7 +106,7 @@ QgsGeometry::~QgsGeometry()
 
 QgsGeometry::QgsGeometry( QgsAbstractGeometryV2* geom ): d( new QgsGeometryPrivate() )
 {
-  d->geometry = geom;
+  d->mGeometry = geom;
   d->ref = QAtomicInt( 1 );
 }
 
@@ -102,15 +133,30 @@ void QgsGeometry::detach( bool cloneGeom )
   if ( d->ref > 1 )
   {
     ( void )d->ref.deref();
+
+    if ( d->mWkbPending.loadAcquire() && cloneGeom )
+    {
+      // copy the WKB instead of decoding it for the shared data
+      unsigned char* wkb = new unsigned char[ d->mWkbSize ];
+      memcpy( wkb, d->mWkb, d->mWkbSize );
+      int wkbSize = d->mWkbSize;
+
+      d = new QgsGeometryPrivate();
+      d->mWkb = wkb;
+      d->mWkbSize = wkbSize;
+      d->mWkbPending.storeRelease( 1 );
+      return;
+    }
+
     QgsAbstractGeometryV2* cGeom = nullptr;
 
-    if ( d->geometry && cloneGeom )
+    if ( d->geometry() && cloneGeom )
     {
-      cGeom = d->geometry->clone();
+      cGeom = d->geometry()->clone();
     }
 
     d = new QgsGeometryPrivate();
-    d->geometry = cGeom;
+    d->mGeometry = cGeom;
   }
 }
 
@@ -119,6 +165,7 @@ void QgsGeometry::removeWkbGeos()
   delete[] d->mWkb;
   d->mWkb = nullptr;
   d->mWkbSize = 0;
+  d->mWkbPending.storeRelease( 0 );
   if ( d->mGeos )
   {
     GEOSGeom_destroy_r( QgsGeos::getGEOSHandler(), d->mGeos );
@@ -128,30 +175,27 @@ void QgsGeometry::removeWkbGeos()
 
 QgsAbstractGeometryV2* QgsGeometry::geometry() const
 {
-  return d->geometry;
+  return d->geometry();
 }
 
 void QgsGeometry::setGeometry( QgsAbstractGeometryV2* geometry )
 {
-  if ( d->geometry == geometry )
+  if ( !d->mWkbPending.loadAcquire() && d->mGeometry == geometry )
   {
     return;
   }
 
   detach( false );
-  if ( d->geometry )
-  {
-    delete d->geometry;
-    d->geometry = nullptr;
-  }
+  delete d->mGeometry;
+  d->mGeometry = nullptr;
   removeWkbGeos();
 
-  d->geometry = geometry;
+  d->mGeometry = geometry;
 }
 
 bool QgsGeometry::isEmpty() const
 {
-  return !d->geometry;
+  return !d->geometry();
 }
 
 QgsGeometry* QgsGeometry::fromWkt( const QString& wkt )
@@ -243,63 +287,64 @@ void QgsGeometry::fromWkb( unsigned char *wkb, int length )
 {
   detach( false );
 
-  if ( d->geometry )
-  {
-    delete d->geometry;
-    removeWkbGeos();
-  }
-  d->geometry = QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr( wkb, length ) );
-  if ( d->geometry )
-  {
-    d->mWkb = wkb;
-    d->mWkbSize = length;
-  }
-  else
-  {
-    delete [] wkb;
-    d->mWkb = nullptr;
-    d->mWkbSize = 0;
-  }
+  delete d->mGeometry;
+  d->mGeometry = nullptr;
+  removeWkbGeos();
+
+  // the WKB is only decoded when the geometry is used, rendering reads it directly
+  d->mWkb = wkb;
+  d->mWkbSize = length;
+  d->mWkbPending.storeRelease( 1 );
 }
 
 const unsigned char *QgsGeometry::asWkb() const
 {
-  if ( !d->geometry )
+  if ( d->mWkbPending.loadAcquire() )
+  {
+    return d->mWkb;
+  }
+
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
   if ( !d->mWkb )
   {
-    d->mWkb = d->geometry->asWkb( d->mWkbSize );
+    d->mWkb = d->geometry()->asWkb( d->mWkbSize );
   }
   return d->mWkb;
 }
 
 int QgsGeometry::wkbSize() const
 {
-  if ( !d->geometry )
+  if ( d->mWkbPending.loadAcquire() )
+  {
+    return d->mWkbSize;
+  }
+
+  if ( !d->geometry() )
   {
     return 0;
   }
 
   if ( !d->mWkb )
   {
-    d->mWkb = d->geometry->asWkb( d->mWkbSize );
+    d->mWkb = d->geometry()->asWkb( d->mWkbSize );
   }
   return d->mWkbSize;
 }
 
 const GEOSGeometry* QgsGeometry::asGeos( double precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
   if ( !d->mGeos )
   {
-    d->mGeos = QgsGeos::asGeos( d->geometry, precision );
+    d->mGeos = QgsGeos::asGeos( d->geometry(), precision );
   }
   return d->mGeos;
 }
@@ -307,46 +352,47 @@ const GEOSGeometry* QgsGeometry::asGeos( double precision ) const
 
 Qgis::WkbType QgsGeometry::wkbType() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return Qgis::WKBUnknown;
   }
   else
   {
-    return Qgis::fromNewWkbType( d->geometry->wkbType() );
+    return Qgis::fromNewWkbType( d->geometry()->wkbType() );
   }
 }
 
 
 Qgis::GeometryType QgsGeometry::type() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return Qgis::UnknownGeometry;
   }
-  return static_cast< Qgis::GeometryType >( QgsWKBTypes::geometryType( d->geometry->wkbType() ) );
+  return static_cast< Qgis::GeometryType >( QgsWKBTypes::geometryType( d->geometry()->wkbType() ) );
 }
 
 bool QgsGeometry::isMultipart() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
-  return QgsWKBTypes::isMultiType( d->geometry->wkbType() );
+  return QgsWKBTypes::isMultiType( d->geometry()->wkbType() );
 }
 
 void QgsGeometry::fromGeos( GEOSGeometry *geos )
 {
   detach( false );
-  delete d->geometry;
-  d->geometry = QgsGeos::fromGeos( geos );
+  delete d->mGeometry;
+  removeWkbGeos();
+  d->mGeometry = QgsGeos::fromGeos( geos );
   d->mGeos = geos;
 }
 
 QgsPoint QgsGeometry::closestVertex( const QgsPoint& point, int& atVertex, int& beforeVertex, int& afterVertex, double& sqrDist ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsPoint( 0, 0 );
   }
@@ -354,7 +400,7 @@ QgsPoint QgsGeometry::closestVertex( const QgsPoint& point, int& atVertex, int&
   QgsPointV2 pt( point.x(), point.y() );
   QgsVertexId id;
 
-  QgsPointV2 vp = QgsGeometryUtils::closestVertex( *( d->geometry ), pt, id );
+  QgsPointV2 vp = QgsGeometryUtils::closestVertex( *( d->geometry() ), pt, id );
   if ( !id.isValid() )
   {
     sqrDist = -1;
@@ -369,7 +415,7 @@ QgsPoint QgsGeometry::closestVertex( const QgsPoint& point, int& atVertex, int&
 
 double QgsGeometry::distanceToVertex( int vertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
@@ -380,12 +426,12 @@ double QgsGeometry::distanceToVertex( int vertex ) const
     return -1;
   }
 
-  return QgsGeometryUtils::distanceToVertex( *( d->geometry ), id );
+  return QgsGeometryUtils::distanceToVertex( *( d->geometry() ), id );
 }
 
 void QgsGeometry::adjacentVertices( int atVertex, int& beforeVertex, int& afterVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return;
   }
@@ -399,14 +445,14 @@ void QgsGeometry::adjacentVertices( int atVertex, int& beforeVertex, int& afterV
   }
 
   QgsVertexId beforeVertexId, afterVertexId;
-  QgsGeometryUtils::adjacentVertices( *( d->geometry ), id, beforeVertexId, afterVertexId );
+  QgsGeometryUtils::adjacentVertices( *( d->geometry() ), id, beforeVertexId, afterVertexId );
   beforeVertex = vertexNrFromVertexId( beforeVertexId );
   afterVertex = vertexNrFromVertexId( afterVertexId );
 }
 
 bool QgsGeometry::moveVertex( double x, double y, int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -420,12 +466,12 @@ bool QgsGeometry::moveVertex( double x, double y, int atVertex )
   detach( true );
 
   removeWkbGeos();
-  return d->geometry->moveVertex( id, QgsPointV2( x, y ) );
+  return d->geometry()->moveVertex( id, QgsPointV2( x, y ) );
 }
 
 bool QgsGeometry::moveVertex( const QgsPointV2& p, int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -439,32 +485,32 @@ bool QgsGeometry::moveVertex( const QgsPointV2& p, int atVertex )
   detach( true );
 
   removeWkbGeos();
-  return d->geometry->moveVertex( id, p );
+  return d->geometry()->moveVertex( id, p );
 }
 
 bool QgsGeometry::deleteVertex( int atVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWKBTypes::flatType( d->geometry->wkbType() ) == QgsWKBTypes::MultiPoint )
+  if ( QgsWKBTypes::flatType( d->geometry()->wkbType() ) == QgsWKBTypes::MultiPoint )
   {
     detach( true );
     removeWkbGeos();
     //delete geometry instead of point
-    return static_cast< QgsGeometryCollectionV2* >( d->geometry )->removeGeometry( atVertex );
+    return static_cast< QgsGeometryCollectionV2* >( d->geometry() )->removeGeometry( atVertex );
   }
 
   //if it is a point, set the geometry to nullptr
-  if ( QgsWKBTypes::flatType( d->geometry->wkbType() ) == QgsWKBTypes::Point )
+  if ( QgsWKBTypes::flatType( d->geometry()->wkbType() ) == QgsWKBTypes::Point )
   {
     detach( false );
-    delete d->geometry;
+    delete d->mGeometry;
     removeWkbGeos();
-    d->geometry = nullptr;
+    d->mGeometry = nullptr;
     return true;
   }
 
@@ -477,23 +523,23 @@ bool QgsGeometry::deleteVertex( int atVertex )
   detach( true );
 
   removeWkbGeos();
-  return d->geometry->deleteVertex( id );
+  return d->geometry()->deleteVertex( id );
 }
 
 bool QgsGeometry::insertVertex( double x, double y, int beforeVertex )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   //maintain compatibility with < 2.10 API
-  if ( QgsWKBTypes::flatType( d->geometry->wkbType() ) == QgsWKBTypes::MultiPoint )
+  if ( QgsWKBTypes::flatType( d->geometry()->wkbType() ) == QgsWKBTypes::MultiPoint )
   {
     detach( true );
     removeWkbGeos();
     //insert geometry instead of point
-    return static_cast< QgsGeometryCollectionV2* >( d->geometry )->insertGeometry( new QgsPointV2( x, y ), beforeVertex );
+    return static_cast< QgsGeometryCollectionV2* >( d->geometry() )->insertGeometry( new QgsPointV2( x, y ), beforeVertex );
   }
 
   QgsVertexId id;
@@ -506,12 +552,12 @@ bool QgsGeometry::insertVertex( double x, double y, int beforeVertex )
 
   removeWkbGeos();
 
-  return d->geometry->insertVertex( id, QgsPointV2( x, y ) );
+  return d->geometry()->insertVertex( id, QgsPointV2( x, y ) );
 }
 
 QgsPoint QgsGeometry::vertexAt( int atVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsPoint( 0, 0 );
   }
@@ -522,7 +568,7 @@ QgsPoint QgsGeometry::vertexAt( int atVertex ) const
   {
     return QgsPoint( 0, 0 );
   }
-  QgsPointV2 pt = d->geometry->vertexAt( vId );
+  QgsPointV2 pt = d->geometry()->vertexAt( vId );
   return QgsPoint( pt.x(), pt.y() );
 }
 
@@ -534,26 +580,26 @@ double QgsGeometry::sqrDistToVertexAt( QgsPoint& point, int atVertex ) const
 
 QgsGeometry QgsGeometry::nearestPoint( const QgsGeometry& other ) const
 {
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.closestPoint( other );
 }
 
 QgsGeometry QgsGeometry::shortestLine( const QgsGeometry& other ) const
 {
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.shortestLine( other );
 }
 
 double QgsGeometry::closestVertexWithContext( const QgsPoint& point, int& atVertex ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0.0;
   }
 
   QgsVertexId vId;
   QgsPointV2 pt( point.x(), point.y() );
-  QgsPointV2 closestPoint = QgsGeometryUtils::closestVertex( *( d->geometry ), pt, vId );
+  QgsPointV2 closestPoint = QgsGeometryUtils::closestVertex( *( d->geometry() ), pt, vId );
   atVertex = vertexNrFromVertexId( vId );
   return QgsGeometryUtils::sqrDistance2D( closestPoint, pt );
 }
@@ -565,7 +611,7 @@ double QgsGeometry::closestSegmentWithContext(
   double *leftOf,
   double epsilon ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -574,7 +620,7 @@ double QgsGeometry::closestSegmentWithContext(
   QgsVertexId vertexAfter;
   bool leftOfBool;
 
-  double sqrDist = d->geometry->closestSegment( QgsPointV2( point.x(), point.y() ), segmentPt,  vertexAfter, &leftOfBool, epsilon );
+  double sqrDist = d->geometry()->closestSegment( QgsPointV2( point.x(), point.y() ), segmentPt,  vertexAfter, &leftOfBool, epsilon );
 
   minDistPoint.setX( segmentPt.x() );
   minDistPoint.setY( segmentPt.y() );
@@ -588,9 +634,7 @@ double QgsGeometry::closestSegmentWithContext(
 
 int QgsGeometry::addRing( const QList<QgsPoint> &ring )
 {
-  detach( true );
-
-  removeWkbGeos();
+  // addRing( QgsCurveV2* ) decodes a geometry set from WKB before changing it
   QgsLineStringV2* ringLine = new QgsLineStringV2();
   QgsPointSequenceV2 ringPoints;
   convertPointList( ring, ringPoints );
@@ -600,7 +644,7 @@ int QgsGeometry::addRing( const QList<QgsPoint> &ring )
 
 int QgsGeometry::addRing( QgsCurveV2* ring )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     delete ring;
     return 1;
@@ -609,7 +653,7 @@ int QgsGeometry::addRing( QgsCurveV2* ring )
   detach( true );
 
   removeWkbGeos();
-  return QgsGeometryEditUtils::addRing( d->geometry, ring );
+  return QgsGeometryEditUtils::addRing( d->geometry(), ring );
 }
 
 int QgsGeometry::addPart( const QList<QgsPoint> &points, Qgis::GeometryType geomType )
@@ -637,19 +681,19 @@ int QgsGeometry::addPart( const QgsPointSequenceV2 &points, Qgis::GeometryType g
 
 int QgsGeometry::addPart( QgsAbstractGeometryV2* part, Qgis::GeometryType geomType )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     detach( false );
     switch ( geomType )
     {
       case Qgis::Point:
-        d->geometry = new QgsMultiPointV2();
+        d->mGeometry = new QgsMultiPointV2();
         break;
       case Qgis::Line:
-        d->geometry = new QgsMultiLineStringV2();
+        d->mGeometry = new QgsMultiLineStringV2();
         break;
       case Qgis::Polygon:
-        d->geometry = new QgsMultiPolygonV2();
+        d->mGeometry = new QgsMultiPolygonV2();
         break;
       default:
         return 1;
@@ -662,22 +706,22 @@ int QgsGeometry::addPart( QgsAbstractGeometryV2* part, Qgis::GeometryType geomTy
   }
 
   convertToMultiType();
-  return QgsGeometryEditUtils::addPart( d->geometry, part );
+  return QgsGeometryEditUtils::addPart( d->geometry(), part );
 }
 
 int QgsGeometry::addPart( const QgsGeometry *newPart )
 {
-  if ( !d->geometry || !newPart || !newPart->d || !newPart->d->geometry )
+  if ( !d->geometry() || !newPart || !newPart->d || !newPart->d->geometry() )
   {
     return 1;
   }
 
-  return addPart( newPart->d->geometry->clone() );
+  return addPart( newPart->d->geometry()->clone() );
 }
 
 int QgsGeometry::addPart( GEOSGeometry *newPart )
 {
-  if ( !d->geometry || !newPart )
+  if ( !d->geometry() || !newPart )
   {
     return 1;
   }
@@ -686,26 +730,26 @@ int QgsGeometry::addPart( GEOSGeometry *newPart )
 
   QgsAbstractGeometryV2* geom = QgsGeos::fromGeos( newPart );
   removeWkbGeos();
-  return QgsGeometryEditUtils::addPart( d->geometry, geom );
+  return QgsGeometryEditUtils::addPart( d->geometry(), geom );
 }
 
 int QgsGeometry::translate( double dx, double dy )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
   detach( true );
 
-  d->geometry->transform( QTransform::fromTranslate( dx, dy ) );
+  d->geometry()->transform( QTransform::fromTranslate( dx, dy ) );
   removeWkbGeos();
   return 0;
 }
 
 int QgsGeometry::rotate( double rotation, const QgsPoint& center )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
@@ -715,14 +759,14 @@ int QgsGeometry::rotate( double rotation, const QgsPoint& center )
   QTransform t = QTransform::fromTranslate( center.x(), center.y() );
   t.rotate( -rotation );
   t.translate( -center.x(), -center.y() );
-  d->geometry->transform( t );
+  d->geometry()->transform( t );
   removeWkbGeos();
   return 0;
 }
 
 int QgsGeometry::splitGeometry( const QList<QgsPoint>& splitLine, QList<QgsGeometry*>& newGeometries, bool topological, QList<QgsPoint> &topologyTestPoints )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -734,13 +778,13 @@ int QgsGeometry::splitGeometry( const QList<QgsPoint>& splitLine, QList<QgsGeome
   splitLineString.setPoints( splitLinePointsV2 );
   QgsPointSequenceV2 tp;
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   int result = geos.splitGeometry( splitLineString, newGeoms, topological, tp );
 
   if ( result == 0 )
   {
     detach( false );
-    d->geometry = newGeoms.at( 0 );
+    d->mGeometry = newGeoms.at( 0 );
 
     newGeometries.clear();
     for ( int i = 1; i < newGeoms.size(); ++i )
@@ -757,7 +801,7 @@ int QgsGeometry::splitGeometry( const QList<QgsPoint>& splitLine, QList<QgsGeome
 /** Replaces a part of this geometry with another line*/
 int QgsGeometry::reshapeGeometry( const QList<QgsPoint>& reshapeWithLine )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 0;
   }
@@ -767,14 +811,14 @@ int QgsGeometry::reshapeGeometry( const QList<QgsPoint>& reshapeWithLine )
   QgsLineStringV2 reshapeLineString;
   reshapeLineString.setPoints( reshapeLine );
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   int errorCode = 0;
   QgsAbstractGeometryV2* geom = geos.reshapeGeometry( reshapeLineString, &errorCode );
   if ( errorCode == 0 && geom )
   {
     detach( false );
-    delete d->geometry;
-    d->geometry = geom;
+    delete d->mGeometry;
+    d->mGeometry = geom;
     removeWkbGeos();
     return 0;
   }
@@ -783,12 +827,12 @@ int QgsGeometry::reshapeGeometry( const QList<QgsPoint>& reshapeWithLine )
 
 int QgsGeometry::makeDifference( const QgsGeometry* other )
 {
-  if ( !d->geometry || !other->d->geometry )
+  if ( !d->geometry() || !other->d->geometry() )
   {
     return 0;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
   QgsAbstractGeometryV2* diffGeom = geos.intersection( *( other->geometry() ) );
   if ( !diffGeom )
@@ -798,17 +842,17 @@ int QgsGeometry::makeDifference( const QgsGeometry* other )
 
   detach( false );
 
-  delete d->geometry;
-  d->geometry = diffGeom;
+  delete d->mGeometry;
+  d->mGeometry = diffGeom;
   removeWkbGeos();
   return 0;
 }
 
 QgsRectangle QgsGeometry::boundingBox() const
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
-    return d->geometry->boundingBox();
+    return d->geometry()->boundingBox();
   }
   return QgsRectangle();
 }
@@ -823,120 +867,120 @@ bool QgsGeometry::intersects( const QgsRectangle& r ) const
 
 bool QgsGeometry::intersects( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.intersects( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.intersects( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::contains( const QgsPoint* p ) const
 {
-  if ( !d->geometry || !p )
+  if ( !d->geometry() || !p )
   {
     return false;
   }
 
   QgsPointV2 pt( p->x(), p->y() );
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.contains( pt );
 }
 
 bool QgsGeometry::contains( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.contains( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.contains( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::disjoint( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.disjoint( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.disjoint( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::equals( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.isEqual( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.isEqual( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::touches( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.touches( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.touches( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::overlaps( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.overlaps( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.overlaps( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::within( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.within( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.within( *( geometry->d->geometry() ) );
 }
 
 bool QgsGeometry::crosses( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry || !geometry->d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.crosses( *( geometry->d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.crosses( *( geometry->d->geometry() ) );
 }
 
 QString QgsGeometry::exportToWkt( int precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QString();
   }
-  return d->geometry->asWkt( precision );
+  return d->geometry()->asWkt( precision );
 }
 
 QString QgsGeometry::exportToGeoJSON( int precision ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QString( "null" );
   }
-  return d->geometry->asJSON( precision );
+  return d->geometry()->asJSON( precision );
 }
 
 QgsGeometry* QgsGeometry::convertToType( Qgis::GeometryType destType, bool destMultipart ) const
@@ -959,7 +1003,7 @@ QgsGeometry* QgsGeometry::convertToType( Qgis::GeometryType destType, bool destM
 
 bool QgsGeometry::convertToMultiType()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -970,22 +1014,22 @@ bool QgsGeometry::convertToMultiType()
   }
 
   QgsGeometryCollectionV2* multiGeom = dynamic_cast<QgsGeometryCollectionV2*>
-                                       ( QgsGeometryFactory::geomFromWkbType( QgsWKBTypes::multiType( d->geometry->wkbType() ) ) );
+                                       ( QgsGeometryFactory::geomFromWkbType( QgsWKBTypes::multiType( d->geometry()->wkbType() ) ) );
   if ( !multiGeom )
   {
     return false;
   }
 
   detach( true );
-  multiGeom->addGeometry( d->geometry );
-  d->geometry = multiGeom;
+  multiGeom->addGeometry( d->geometry() );
+  d->mGeometry = multiGeom;
   removeWkbGeos();
   return true;
 }
 
 bool QgsGeometry::convertToSingleType()
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -995,25 +1039,25 @@ bool QgsGeometry::convertToSingleType()
     return true;
   }
 
-  QgsGeometryCollectionV2* multiGeom = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry );
+  QgsGeometryCollectionV2* multiGeom = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry() );
   if ( !multiGeom || multiGeom->partCount() < 1 )
     return false;
 
   QgsAbstractGeometryV2* firstPart = multiGeom->geometryN( 0 )->clone();
   detach( false );
 
-  d->geometry = firstPart;
+  d->mGeometry = firstPart;
   removeWkbGeos();
   return true;
 }
 
 QgsPoint QgsGeometry::asPoint() const
 {
-  if ( !d->geometry || QgsWKBTypes::flatType( d->geometry->wkbType() ) != QgsWKBTypes::Point )
+  if ( !d->geometry() || QgsWKBTypes::flatType( d->geometry()->wkbType() ) != QgsWKBTypes::Point )
   {
     return QgsPoint();
   }
-  QgsPointV2* pt = dynamic_cast<QgsPointV2*>( d->geometry );
+  QgsPointV2* pt = dynamic_cast<QgsPointV2*>( d->geometry() );
   if ( !pt )
   {
     return QgsPoint();
@@ -1025,17 +1069,17 @@ QgsPoint QgsGeometry::asPoint() const
 QgsPolyline QgsGeometry::asPolyline() const
 {
   QgsPolyline polyLine;
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return polyLine;
   }
 
-  bool doSegmentation = ( QgsWKBTypes::flatType( d->geometry->wkbType() ) == QgsWKBTypes::CompoundCurve
-                          || QgsWKBTypes::flatType( d->geometry->wkbType() ) == QgsWKBTypes::CircularString );
+  bool doSegmentation = ( QgsWKBTypes::flatType( d->geometry()->wkbType() ) == QgsWKBTypes::CompoundCurve
+                          || QgsWKBTypes::flatType( d->geometry()->wkbType() ) == QgsWKBTypes::CircularString );
   QgsLineStringV2* line = nullptr;
   if ( doSegmentation )
   {
-    QgsCurveV2* curve = dynamic_cast<QgsCurveV2*>( d->geometry );
+    QgsCurveV2* curve = dynamic_cast<QgsCurveV2*>( d->geometry() );
     if ( !curve )
     {
       return polyLine;
@@ -1044,7 +1088,7 @@ QgsPolyline QgsGeometry::asPolyline() const
   }
   else
   {
-    line = dynamic_cast<QgsLineStringV2*>( d->geometry );
+    line = dynamic_cast<QgsLineStringV2*>( d->geometry() );
     if ( !line )
     {
       return polyLine;
@@ -1070,15 +1114,15 @@ QgsPolyline QgsGeometry::asPolyline() const
 
 QgsPolygon QgsGeometry::asPolygon() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
     return QgsPolygon();
 
-  bool doSegmentation = ( QgsWKBTypes::flatType( d->geometry->wkbType() ) == QgsWKBTypes::CurvePolygon );
+  bool doSegmentation = ( QgsWKBTypes::flatType( d->geometry()->wkbType() ) == QgsWKBTypes::CurvePolygon );
 
   QgsPolygonV2* p = nullptr;
   if ( doSegmentation )
   {
-    QgsCurvePolygonV2* curvePoly = dynamic_cast<QgsCurvePolygonV2*>( d->geometry );
+    QgsCurvePolygonV2* curvePoly = dynamic_cast<QgsCurvePolygonV2*>( d->geometry() );
     if ( !curvePoly )
     {
       return QgsPolygon();
@@ -1087,7 +1131,7 @@ QgsPolygon QgsGeometry::asPolygon() const
   }
   else
   {
-    p = dynamic_cast<QgsPolygonV2*>( d->geometry );
+    p = dynamic_cast<QgsPolygonV2*>( d->geometry() );
   }
 
   if ( !p )
@@ -1107,12 +1151,12 @@ QgsPolygon QgsGeometry::asPolygon() const
 
 QgsMultiPoint QgsGeometry::asMultiPoint() const
 {
-  if ( !d->geometry || QgsWKBTypes::flatType( d->geometry->wkbType() ) != QgsWKBTypes::MultiPoint )
+  if ( !d->geometry() || QgsWKBTypes::flatType( d->geometry()->wkbType() ) != QgsWKBTypes::MultiPoint )
   {
     return QgsMultiPoint();
   }
 
-  const QgsMultiPointV2* mp = dynamic_cast<QgsMultiPointV2*>( d->geometry );
+  const QgsMultiPointV2* mp = dynamic_cast<QgsMultiPointV2*>( d->geometry() );
   if ( !mp )
   {
     return QgsMultiPoint();
@@ -1131,12 +1175,12 @@ QgsMultiPoint QgsGeometry::asMultiPoint() const
 
 QgsMultiPolyline QgsGeometry::asMultiPolyline() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsMultiPolyline();
   }
 
-  QgsGeometryCollectionV2* geomCollection = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry );
+  QgsGeometryCollectionV2* geomCollection = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry() );
   if ( !geomCollection )
   {
     return QgsMultiPolyline();
@@ -1180,12 +1224,12 @@ QgsMultiPolyline QgsGeometry::asMultiPolyline() const
 
 QgsMultiPolygon QgsGeometry::asMultiPolygon() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return QgsMultiPolygon();
   }
 
-  QgsGeometryCollectionV2* geomCollection = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry );
+  QgsGeometryCollectionV2* geomCollection = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry() );
   if ( !geomCollection )
   {
     return QgsMultiPolygon();
@@ -1223,17 +1267,17 @@ QgsMultiPolygon QgsGeometry::asMultiPolygon() const
 
 double QgsGeometry::area() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1.0;
   }
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
 
 #if 0
   //debug: compare geos area with calculation in QGIS
   double geosArea = g.area();
   double qgisArea = 0;
-  QgsSurfaceV2* surface = dynamic_cast<QgsSurfaceV2*>( d->geometry );
+  QgsSurfaceV2* surface = dynamic_cast<QgsSurfaceV2*>( d->geometry() );
   if ( surface )
   {
     qgisArea = surface->area();
@@ -1245,33 +1289,33 @@ double QgsGeometry::area() const
 
 double QgsGeometry::length() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1.0;
   }
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   return g.length();
 }
 
 double QgsGeometry::distance( const QgsGeometry& geom ) const
 {
-  if ( !d->geometry || !geom.d->geometry )
+  if ( !d->geometry() || !geom.d->geometry() )
   {
     return -1.0;
   }
 
-  QgsGeos g( d->geometry );
-  return g.distance( *( geom.d->geometry ) );
+  QgsGeos g( d->geometry() );
+  return g.distance( *( geom.d->geometry() ) );
 }
 
 QgsGeometry* QgsGeometry::buffer( double distance, int segments ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   QgsAbstractGeometryV2* geom = g.buffer( distance, segments );
   if ( !geom )
   {
@@ -1282,12 +1326,12 @@ QgsGeometry* QgsGeometry::buffer( double distance, int segments ) const
 
 QgsGeometry* QgsGeometry::buffer( double distance, int segments, int endCapStyle, int joinStyle, double mitreLimit ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos g( d->geometry );
+  QgsGeos g( d->geometry() );
   QgsAbstractGeometryV2* geom = g.buffer( distance, segments, endCapStyle, joinStyle, mitreLimit );
   if ( !geom )
   {
@@ -1298,12 +1342,12 @@ QgsGeometry* QgsGeometry::buffer( double distance, int segments, int endCapStyle
 
 QgsGeometry* QgsGeometry::offsetCurve( double distance, int segments, int joinStyle, double mitreLimit ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsAbstractGeometryV2* offsetGeom = geos.offsetCurve( distance, segments, joinStyle, mitreLimit );
   if ( !offsetGeom )
   {
@@ -1314,12 +1358,12 @@ QgsGeometry* QgsGeometry::offsetCurve( double distance, int segments, int joinSt
 
 QgsGeometry* QgsGeometry::simplify( double tolerance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsAbstractGeometryV2* simplifiedGeom = geos.simplify( tolerance );
   if ( !simplifiedGeom )
   {
@@ -1330,12 +1374,12 @@ QgsGeometry* QgsGeometry::simplify( double tolerance ) const
 
 QgsGeometry* QgsGeometry::centroid() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsPointV2 centroid;
   bool ok = geos.centroid( centroid );
   if ( !ok )
@@ -1347,12 +1391,12 @@ QgsGeometry* QgsGeometry::centroid() const
 
 QgsGeometry* QgsGeometry::pointOnSurface() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsPointV2 pt;
   bool ok = geos.pointOnSurface( pt );
   if ( !ok )
@@ -1364,11 +1408,11 @@ QgsGeometry* QgsGeometry::pointOnSurface() const
 
 QgsGeometry* QgsGeometry::convexHull() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsAbstractGeometryV2* cHull = geos.convexHull();
   if ( !cHull )
   {
@@ -1379,11 +1423,11 @@ QgsGeometry* QgsGeometry::convexHull() const
 
 QgsGeometry* QgsGeometry::interpolate( double distance ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return nullptr;
   }
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   QgsAbstractGeometryV2* result = geos.interpolate( distance );
   if ( !result )
   {
@@ -1394,27 +1438,27 @@ QgsGeometry* QgsGeometry::interpolate( double distance ) const
 
 QgsGeometry* QgsGeometry::intersection( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry->d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometryV2* resultGeom = geos.intersection( *( geometry->d->geometry ) );
+  QgsAbstractGeometryV2* resultGeom = geos.intersection( *( geometry->d->geometry() ) );
   return new QgsGeometry( resultGeom );
 }
 
 QgsGeometry* QgsGeometry::combine( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry->d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometryV2* resultGeom = geos.combine( *( geometry->d->geometry ) );
+  QgsAbstractGeometryV2* resultGeom = geos.combine( *( geometry->d->geometry() ) );
   if ( !resultGeom )
   {
     return nullptr;
@@ -1424,14 +1468,14 @@ QgsGeometry* QgsGeometry::combine( const QgsGeometry* geometry ) const
 
 QgsGeometry* QgsGeometry::difference( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry->d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometryV2* resultGeom = geos.difference( *( geometry->d->geometry ) );
+  QgsAbstractGeometryV2* resultGeom = geos.difference( *( geometry->d->geometry() ) );
   if ( !resultGeom )
   {
     return nullptr;
@@ -1441,14 +1485,14 @@ QgsGeometry* QgsGeometry::difference( const QgsGeometry* geometry ) const
 
 QgsGeometry* QgsGeometry::symDifference( const QgsGeometry* geometry ) const
 {
-  if ( !d->geometry || !geometry->d->geometry )
+  if ( !d->geometry() || !geometry->d->geometry() )
   {
     return nullptr;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
 
-  QgsAbstractGeometryV2* resultGeom = geos.symDifference( *( geometry->d->geometry ) );
+  QgsAbstractGeometryV2* resultGeom = geos.symDifference( *( geometry->d->geometry() ) );
   if ( !resultGeom )
   {
     return nullptr;
@@ -1466,12 +1510,12 @@ QgsGeometry QgsGeometry::extrude( double x, double y )
 QList<QgsGeometry*> QgsGeometry::asGeometryCollection() const
 {
   QList<QgsGeometry*> geometryList;
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return geometryList;
   }
 
-  QgsGeometryCollectionV2* gc = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry );
+  QgsGeometryCollectionV2* gc = dynamic_cast<QgsGeometryCollectionV2*>( d->geometry() );
   if ( gc )
   {
     int numGeom = gc->numGeometries();
@@ -1483,7 +1527,7 @@ QList<QgsGeometry*> QgsGeometry::asGeometryCollection() const
   }
   else //a singlepart geometry
   {
-    geometryList.append( new QgsGeometry( d->geometry->clone() ) );
+    geometryList.append( new QgsGeometry( d->geometry()->clone() ) );
   }
 
   return geometryList;
@@ -1526,20 +1570,20 @@ QPolygonF QgsGeometry::asQPolygonF() const
 
 bool QgsGeometry::deleteRing( int ringNum, int partNum )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
   detach( true );
-  bool ok = QgsGeometryEditUtils::deleteRing( d->geometry, ringNum, partNum );
+  bool ok = QgsGeometryEditUtils::deleteRing( d->geometry(), ringNum, partNum );
   removeWkbGeos();
   return ok;
 }
 
 bool QgsGeometry::deletePart( int partNum )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
@@ -1551,23 +1595,23 @@ bool QgsGeometry::deletePart( int partNum )
   }
 
   detach( true );
-  bool ok = QgsGeometryEditUtils::deletePart( d->geometry, partNum );
+  bool ok = QgsGeometryEditUtils::deletePart( d->geometry(), partNum );
   removeWkbGeos();
   return ok;
 }
 
 int QgsGeometry::avoidIntersections( const QMap<QgsVectorLayer*, QSet< QgsFeatureId > >& ignoreFeatures )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
-  QgsAbstractGeometryV2* diffGeom = QgsGeometryEditUtils::avoidIntersections( *( d->geometry ), ignoreFeatures );
+  QgsAbstractGeometryV2* diffGeom = QgsGeometryEditUtils::avoidIntersections( *( d->geometry() ), ignoreFeatures );
   if ( diffGeom )
   {
     detach( false );
-    d->geometry = diffGeom;
+    d->mGeometry = diffGeom;
     removeWkbGeos();
   }
   return 0;
@@ -1580,34 +1624,34 @@ void QgsGeometry::validateGeometry( QList<Error> &errors )
 
 bool QgsGeometry::isGeosValid() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.isValid();
 }
 
 bool QgsGeometry::isGeosEqual( const QgsGeometry& g ) const
 {
-  if ( !d->geometry || !g.d->geometry )
+  if ( !d->geometry() || !g.d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
-  return geos.isEqual( *( g.d->geometry ) );
+  QgsGeos geos( d->geometry() );
+  return geos.isEqual( *( g.d->geometry() ) );
 }
 
 bool QgsGeometry::isGeosEmpty() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  QgsGeos geos( d->geometry );
+  QgsGeos geos( d->geometry() );
   return geos.isEmpty();
 }
 
@@ -1631,60 +1675,60 @@ QgsGeometry *QgsGeometry::unaryUnion( const QList<QgsGeometry*> &geometryList )
 
 void QgsGeometry::convertToStraightSegment()
 {
-  if ( !d->geometry || !requiresConversionToStraightSegments() )
+  if ( !d->geometry() || !requiresConversionToStraightSegments() )
   {
     return;
   }
 
-  QgsAbstractGeometryV2* straightGeom = d->geometry->segmentize();
+  QgsAbstractGeometryV2* straightGeom = d->geometry()->segmentize();
   detach( false );
 
-  d->geometry = straightGeom;
+  d->mGeometry = straightGeom;
   removeWkbGeos();
 }
 
 bool QgsGeometry::requiresConversionToStraightSegments() const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  return d->geometry->hasCurvedSegments();
+  return d->geometry()->hasCurvedSegments();
 }
 
 int QgsGeometry::transform( const QgsCoordinateTransform& ct )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
   detach();
-  d->geometry->transform( ct );
+  d->geometry()->transform( ct );
   removeWkbGeos();
   return 0;
 }
 
 int QgsGeometry::transform( const QTransform& ct )
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return 1;
   }
 
   detach();
-  d->geometry->transform( ct );
+  d->geometry()->transform( ct );
   removeWkbGeos();
   return 0;
 }
 
 void QgsGeometry::mapToPixel( const QgsMapToPixel& mtp )
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
     detach();
-    d->geometry->transform( mtp.transform() );
+    d->geometry()->transform( mtp.transform() );
     removeWkbGeos();
   }
 }
@@ -1692,10 +1736,10 @@ void QgsGeometry::mapToPixel( const QgsMapToPixel& mtp )
 #if 0
 void QgsGeometry::clip( const QgsRectangle& rect )
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
     detach();
-    d->geometry->clip( rect );
+    d->geometry()->clip( rect );
     removeWkbGeos();
   }
 }
@@ -1703,20 +1747,20 @@ void QgsGeometry::clip( const QgsRectangle& rect )
 
 void QgsGeometry::draw( QPainter& p ) const
 {
-  if ( d->geometry )
+  if ( d->geometry() )
   {
-    d->geometry->draw( p );
+    d->geometry()->draw( p );
   }
 }
 
 bool QgsGeometry::vertexIdFromVertexNr( int nr, QgsVertexId& id ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return false;
   }
 
-  QgsCoordinateSequenceV2 coords = d->geometry->coordinateSequence();
+  QgsCoordinateSequenceV2 coords = d->geometry()->coordinateSequence();
 
   int vertexCount = 0;
   for ( int part = 0; part < coords.size(); ++part )
@@ -1743,12 +1787,12 @@ bool QgsGeometry::vertexIdFromVertexNr( int nr, QgsVertexId& id ) const
 
 int QgsGeometry::vertexNrFromVertexId( QgsVertexId id ) const
 {
-  if ( !d->geometry )
+  if ( !d->geometry() )
   {
     return -1;
   }
 
-  QgsCoordinateSequenceV2 coords = d->geometry->coordinateSequence();
+  QgsCoordinateSequenceV2 coords = d->geometry()->coordinateSequence();
 
   int vertexCount = 0;
   for ( int part = 0; part < coords.size(); ++part )
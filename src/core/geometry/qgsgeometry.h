@@ -142,7 +142,8 @@ class CORE_EXPORT QgsGeometry
 
     /**
       Set the geometry, feeding in the buffer containing OGC Well-Known Binary and the buffer's length.
-      This class will take ownership of the buffer.
+      This class will take ownership of the buffer. The buffer is only decoded when the geometry is
+      used, asWkb() and wkbSize() return it without decoding it, even if it is not valid.
      */
     void fromWkb( unsigned char *wkb, int length );
 
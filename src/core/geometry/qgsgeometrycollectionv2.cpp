@@ -181,6 +181,11 @@ void QgsGeometryCollectionV2::draw( QPainter& p ) const
 }
 
 bool QgsGeometryCollectionV2::fromWkb( QgsConstWkbPtr wkbPtr )
+{
+  return fromWkb( wkbPtr, nullptr );
+}
+
+bool QgsGeometryCollectionV2::fromWkb( QgsConstWkbPtr wkbPtr, QgsCoordinateArena* arena )
 {
   if ( !wkbPtr )
   {
@@ -196,7 +201,7 @@ bool QgsGeometryCollectionV2::fromWkb( QgsConstWkbPtr wkbPtr )
   mGeometries.clear();
   for ( int i = 0; i < nGeometries; ++i )
   {
-    QgsAbstractGeometryV2* geom = QgsGeometryFactory::geomFromWkb( wkbPtr );
+    QgsAbstractGeometryV2* geom = QgsGeometryFactory::geomFromWkb( wkbPtr, arena );
     if ( geom )
     {
       if ( !addGeometry( geom ) )
@@ -20,6 +20,8 @@ email                : marco.hugentobler at sourcepole dot com
 #include "qgspointv2.h"
 #include <QVector>
 
+class QgsCoordinateArena;
+
 /** \ingroup core
  * \class QgsGeometryCollectionV2
  * \brief Geometry collection
@@ -79,6 +81,14 @@ class CORE_EXPORT QgsGeometryCollectionV2: public QgsAbstractGeometryV2
     virtual void draw( QPainter& p ) const override;
 
     bool fromWkb( QgsConstWkbPtr wkb ) override;
+
+    /** Sets the collection from its WKB representation, storing the coordinates of the line strings in an arena.
+     * @param wkb WKB representation of the collection
+     * @param arena arena receiving the coordinates, or nullptr to store them in the line strings
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    bool fromWkb( QgsConstWkbPtr wkb, QgsCoordinateArena* arena );
     virtual bool fromWkt( const QString& wkt ) override;
     int wkbSize() const override;
     unsigned char* asWkb( int& binarySize ) const override;
@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgsgeometryfactory.h"
+#include "qgscoordinatearray.h"
 #include "qgscircularstringv2.h"
 #include "qgscompoundcurvev2.h"
 #include "qgscurvepolygonv2.h"
@@ -30,7 +31,109 @@
 #include "qgswkbtypes.h"
 #include "qgslogger.h"
 
+//! Reads the WKB of a geometry, storing the coordinates in the arena if the geometry type supports it
+static void readWkb( QgsAbstractGeometryV2* geom, QgsConstWkbPtr wkbPtr, QgsCoordinateArena* arena )
+{
+  if ( arena )
+  {
+    if ( QgsLineStringV2* line = dynamic_cast< QgsLineStringV2* >( geom ) )
+    {
+      line->fromWkb( wkbPtr, arena );
+      return;
+    }
+    if ( QgsPolygonV2* polygon = dynamic_cast< QgsPolygonV2* >( geom ) )
+    {
+      polygon->fromWkb( wkbPtr, arena );
+      return;
+    }
+    if ( QgsGeometryCollectionV2* collection = dynamic_cast< QgsGeometryCollectionV2* >( geom ) )
+    {
+      collection->fromWkb( wkbPtr, arena );
+      return;
+    }
+  }
+  geom->fromWkb( wkbPtr );
+}
+
+/** Returns the number of coordinate values stored in an arena by the line strings and rings
+ * of a WKB geometry, and moves the pointer to the end of the geometry
+ * @param wkbPtr WKB of the geometry
+ * @param inArena false for the parts of curves and curve polygons, which are not read to an arena
+ */
+static int arenaValueCount( QgsConstWkbPtr& wkbPtr, bool inArena )
+{
+  QgsWKBTypes::Type type = wkbPtr.readHeader();
+  int pointSize = QgsWKBTypes::coordDimensions( type ) * sizeof( double );
+  int count = 0;
+
+  switch ( QgsWKBTypes::flatType( type ) )
+  {
+    case QgsWKBTypes::Point:
+      wkbPtr += pointSize;
+      break;
+
+    case QgsWKBTypes::LineString:
+    case QgsWKBTypes::CircularString:
+    {
+      int nPoints;
+      wkbPtr >> nPoints;
+      if ( nPoints < 0 || nPoints > wkbPtr.remaining() / pointSize )
+        throw QgsWkbException( "point count exceeds wkb length" );
+      wkbPtr += nPoints * pointSize;
+      if ( inArena && QgsWKBTypes::flatType( type ) == QgsWKBTypes::LineString )
+        count = nPoints * QgsWKBTypes::coordDimensions( type );
+      break;
+    }
+
+    case QgsWKBTypes::Polygon:
+    {
+      int nRings;
+      wkbPtr >> nRings;
+      for ( int i = 0; i < nRings; ++i )
+      {
+        int nPoints;
+        wkbPtr >> nPoints;
+        if ( nPoints < 0 || nPoints > wkbPtr.remaining() / pointSize )
+          throw QgsWkbException( "point count exceeds wkb length" );
+        wkbPtr += nPoints * pointSize;
+        if ( inArena )
+          count += nPoints * QgsWKBTypes::coordDimensions( type );
+      }
+      break;
+    }
+
+    case QgsWKBTypes::CompoundCurve:
+    case QgsWKBTypes::CurvePolygon:
+    case QgsWKBTypes::MultiPoint:
+    case QgsWKBTypes::MultiLineString:
+    case QgsWKBTypes::MultiPolygon:
+    case QgsWKBTypes::MultiCurve:
+    case QgsWKBTypes::MultiSurface:
+    case QgsWKBTypes::GeometryCollection:
+    {
+      bool partsInArena = inArena && QgsWKBTypes::flatType( type ) != QgsWKBTypes::CompoundCurve && QgsWKBTypes::flatType( type ) != QgsWKBTypes::CurvePolygon;
+      int nParts;
+      wkbPtr >> nParts;
+      for ( int i = 0; i < nParts; ++i )
+      {
+        count += arenaValueCount( wkbPtr, partsInArena );
+      }
+      break;
+    }
+
+    default:
+      throw QgsWkbException( "unsupported wkb type" );
+  }
+
+  return count;
+}
+
 QgsAbstractGeometryV2* QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr wkbPtr )
+{
+  return geomFromWkb( wkbPtr, nullptr );
+}
+
+QgsAbstractGeometryV2* QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr wkbPtr, QgsCoordinateArena* arena )
 {
   if ( !wkbPtr )
     return nullptr;
@@ -57,7 +160,31 @@ QgsAbstractGeometryV2* QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr wkbPtr )
   {
     try
     {
-      geom->fromWkb( wkbPtr );
+      // a single allocation for all the line strings and rings of the geometry, its parts
+      // included, sized from their point counts
+      int valueCount = 0;
+      if ( !arena )
+      {
+        try
+        {
+          QgsConstWkbPtr countPtr( wkbPtr );
+          valueCount = arenaValueCount( countPtr, true );
+        }
+        catch ( const QgsWkbException & )
+        {
+          // the errors are reported by the reader of the geometry
+          valueCount = 0;
+        }
+      }
+      if ( valueCount > 0 )
+      {
+        QgsCoordinateArena geometryArena( valueCount );
+        readWkb( geom, wkbPtr, &geometryArena );
+      }
+      else
+      {
+        readWkb( geom, wkbPtr, arena );
+      }
     }
     catch ( const QgsWkbException &e )
     {
@@ -23,6 +23,7 @@
 class QgsAbstractGeometryV2;
 class QgsLineStringV2;
 class QgsConstWkbPtr;
+class QgsCoordinateArena;
 class QgsRectangle;
 
 //compatibility with old classes
@@ -43,10 +44,19 @@ typedef QVector<QgsPolygon> QgsMultiPolygon;
 class CORE_EXPORT QgsGeometryFactory
 {
   public:
-    /** Construct geometry from a WKB string.
+    /** Construct geometry from a WKB string. The coordinates of all the line strings and rings of
+     * the geometry and of its parts are stored in a single QgsCoordinateArena.
      */
     static QgsAbstractGeometryV2* geomFromWkb( QgsConstWkbPtr wkb );
 
+    /** Construct geometry from a WKB string, storing the coordinates of its line strings and rings
+     * in an arena, which can be shared by a batch of geometries.
+     * @param wkb WKB string
+     * @param arena arena receiving the coordinates, or nullptr to store them in the line strings
+     * @note added in QGIS 2.99
+     */
+    static QgsAbstractGeometryV2* geomFromWkb( QgsConstWkbPtr wkb, QgsCoordinateArena* arena );
+
     /** Construct geometry from a WKT string.
      */
     static QgsAbstractGeometryV2* geomFromWkt( const QString& text );
@@ -107,6 +107,7 @@ class CORE_EXPORT QgsGeos: public QgsGeometryEngine
     static GEOSGeometry* asGeos( const QgsAbstractGeometryV2* geom , double precision = 0 );
     static QgsPointV2 coordSeqPoint( const GEOSCoordSequence* cs, int i, bool hasZ, bool hasM );
 
+    //! Returns the GEOS context of the calling thread, contexts are not shared by threads
     static GEOSContextHandle_t getGEOSHandler();
 
   private:
@@ -92,6 +92,11 @@ void QgsLineStringV2::clear()
 }
 
 bool QgsLineStringV2::fromWkb( QgsConstWkbPtr wkbPtr )
+{
+  return fromWkb( wkbPtr, nullptr );
+}
+
+bool QgsLineStringV2::fromWkb( QgsConstWkbPtr wkbPtr, QgsCoordinateArena* arena )
 {
   if ( !wkbPtr )
   {
@@ -104,14 +109,22 @@ bool QgsLineStringV2::fromWkb( QgsConstWkbPtr wkbPtr )
     return false;
   }
   mWkbType = type;
-  importVerticesFromWkb( wkbPtr );
+  importVerticesFromWkb( wkbPtr, arena );
   return true;
 }
 
-void QgsLineStringV2::fromWkbPoints( QgsWKBTypes::Type type, const QgsConstWkbPtr& wkb )
+void QgsLineStringV2::fromWkbPoints( QgsWKBTypes::Type type, const QgsConstWkbPtr& wkb, QgsCoordinateArena* arena )
 {
   mWkbType = type;
-  importVerticesFromWkb( wkb );
+  importVerticesFromWkb( wkb, arena );
+}
+
+void QgsLineStringV2::detach()
+{
+  mX.detach();
+  mY.detach();
+  mZ.detach();
+  mM.detach();
 }
 
 QgsRectangle QgsLineStringV2::calculateBoundingBox() const
@@ -855,27 +868,59 @@ void QgsLineStringV2::sumUpArea( double& sum ) const
   }
 }
 
-void QgsLineStringV2::importVerticesFromWkb( const QgsConstWkbPtr& wkb )
+void QgsLineStringV2::importVerticesFromWkb( const QgsConstWkbPtr& wkb, QgsCoordinateArena* arena )
 {
   bool hasZ = is3D();
   bool hasM = isMeasure();
   int nVertices = 0;
   wkb >> nVertices;
-  mX.resize( nVertices );
-  mY.resize( nVertices );
-  hasZ ? mZ.resize( nVertices ) : mZ.clear();
-  hasM ? mM.resize( nVertices ) : mM.clear();
+
+  mX.clear();
+  mY.clear();
+  mZ.clear();
+  mM.clear();
+  double* x = nullptr;
+  double* y = nullptr;
+  double* z = nullptr;
+  double* m = nullptr;
+  if ( arena )
+  {
+    x = arena->allocate( nVertices, mX );
+    y = arena->allocate( nVertices, mY );
+    if ( hasZ )
+      z = arena->allocate( nVertices, mZ );
+    if ( hasM )
+      m = arena->allocate( nVertices, mM );
+  }
+  else
+  {
+    mX.resize( nVertices );
+    mY.resize( nVertices );
+    x = mX.data();
+    y = mY.data();
+    if ( hasZ )
+    {
+      mZ.resize( nVertices );
+      z = mZ.data();
+    }
+    if ( hasM )
+    {
+      mM.resize( nVertices );
+      m = mM.data();
+    }
+  }
+
   for ( int i = 0; i < nVertices; ++i )
   {
-    wkb >> mX[i];
-    wkb >> mY[i];
+    wkb >> x[i];
+    wkb >> y[i];
     if ( hasZ )
     {
-      wkb >> mZ[i];
+      wkb >> z[i];
     }
     if ( hasM )
     {
-      wkb >> mM[i];
+      wkb >> m[i];
     }
   }
   clearCache(); //set bounding box invalid
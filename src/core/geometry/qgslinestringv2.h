@@ -19,6 +19,7 @@
 #define QGSLINESTRINGV2_H
 
 #include "qgscurvev2.h"
+#include "qgscoordinatearray.h"
 #include <QPolygonF>
 
 /***************************************************************************
@@ -145,6 +146,27 @@ class CORE_EXPORT QgsLineStringV2: public QgsCurveV2
     virtual bool fromWkb( QgsConstWkbPtr wkb ) override;
     virtual bool fromWkt( const QString& wkt ) override;
 
+    /** Sets the line string from its WKB representation, storing the coordinates in an arena.
+     * @param wkb WKB representation of the line string
+     * @param arena arena receiving the coordinates, or nullptr to store them in the line string
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    bool fromWkb( QgsConstWkbPtr wkb, QgsCoordinateArena* arena );
+
+    /** Returns true if the coordinates of the line string are stored in a QgsCoordinateArena.
+     * @see detach()
+     * @note added in QGIS 2.99
+     */
+    bool isArenaBacked() const { return mX.isView(); }
+
+    /** Copies the coordinates stored in a QgsCoordinateArena to arrays of the line string, releasing
+     * its reference to the arena. Modifying the line string detaches the modified coordinates implicitly.
+     * @see isArenaBacked()
+     * @note added in QGIS 2.99
+     */
+    void detach();
+
     int wkbSize() const override;
     unsigned char* asWkb( int& binarySize ) const override;
     QString asWkt( int precision = 17 ) const override;
@@ -201,18 +223,19 @@ class CORE_EXPORT QgsLineStringV2: public QgsCurveV2
     virtual QgsRectangle calculateBoundingBox() const override;
 
   private:
-    QVector<double> mX;
-    QVector<double> mY;
-    QVector<double> mZ;
-    QVector<double> mM;
+    QgsCoordinateArray mX;
+    QgsCoordinateArray mY;
+    QgsCoordinateArray mZ;
+    QgsCoordinateArray mM;
 
-    void importVerticesFromWkb( const QgsConstWkbPtr& wkb );
+    void importVerticesFromWkb( const QgsConstWkbPtr& wkb, QgsCoordinateArena* arena = nullptr );
 
     /** Resets the line string to match the line string in a WKB geometry.
      * @param type WKB type
      * @param wkb WKB representation of line geometry
+     * @param arena arena receiving the coordinates, or nullptr to store them in the line string
      */
-    void fromWkbPoints( QgsWKBTypes::Type type, const QgsConstWkbPtr& wkb );
+    void fromWkbPoints( QgsWKBTypes::Type type, const QgsConstWkbPtr& wkb, QgsCoordinateArena* arena = nullptr );
 
     friend class QgsPolygonV2;
 
@@ -77,6 +77,11 @@ void QgsPolygonV2::clear()
 }
 
 bool QgsPolygonV2::fromWkb( QgsConstWkbPtr wkbPtr )
+{
+  return fromWkb( wkbPtr, nullptr );
+}
+
+bool QgsPolygonV2::fromWkb( QgsConstWkbPtr wkbPtr, QgsCoordinateArena* arena )
 {
   clear();
   if ( !wkbPtr )
@@ -116,7 +121,7 @@ bool QgsPolygonV2::fromWkb( QgsConstWkbPtr wkbPtr )
   for ( int i = 0; i < nRings; ++i )
   {
     QgsLineStringV2* line = new QgsLineStringV2();
-    line->fromWkbPoints( ringType, wkbPtr );
+    line->fromWkbPoints( ringType, wkbPtr, arena );
     /*if ( !line->isRing() )
     {
       delete line; continue;
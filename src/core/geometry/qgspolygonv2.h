@@ -20,6 +20,8 @@
 
 #include "qgscurvepolygonv2.h"
 
+class QgsCoordinateArena;
+
 /** \ingroup core
  * \class QgsPolygonV2
  * \brief Polygon geometry type.
@@ -40,6 +42,14 @@ class CORE_EXPORT QgsPolygonV2: public QgsCurvePolygonV2
 
     virtual bool fromWkb( QgsConstWkbPtr wkb ) override;
 
+    /** Sets the polygon from its WKB representation, storing the coordinates of the rings in an arena.
+     * @param wkb WKB representation of the polygon
+     * @param arena arena receiving the coordinates, or nullptr to store them in the rings
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    bool fromWkb( QgsConstWkbPtr wkb, QgsCoordinateArena* arena );
+
     // inherited: bool fromWkt( const QString &wkt );
 
     int wkbSize() const override;
@@ -1288,7 +1288,7 @@ int FeaturePart::createCandidatesForPolygon( QList< LabelPosition*>& lPos, Point
 
 int FeaturePart::createCandidates( QList< LabelPosition*>& lPos,
                                    double bboxMin[2], double bboxMax[2],
-                                   PointSet *mapShape, RTree<LabelPosition*, double, 2, double>* candidates )
+                                   PointSet *mapShape )
 {
   double bbox[4];
 
@@ -1360,10 +1360,6 @@ int FeaturePart::createCandidates( QList< LabelPosition*>& lPos,
       i.remove();
       delete pos;
     }
-    else   // this one is OK
-    {
-      pos->insertIntoIndex( candidates );
-    }
   }
 
   qSort( lPos.begin(), lPos.end(), CostCalculator::candidateSortGrow );
@@ -120,10 +120,11 @@ namespace pal
        * \param bboxMin min values of the map extent
        * \param bboxMax max values of the map extent
        * \param mapShape generate candidates for this spatial entity
-       * \param candidates index for candidates
        * \return the number of candidates generated in lPos
+       * \note the candidates of different features can be generated concurrently, they are not
+       * added to the candidates index of the problem
        */
-      int createCandidates( QList<LabelPosition *> &lPos, double bboxMin[2], double bboxMax[2], PointSet *mapShape, RTree<LabelPosition*, double, 2, double>* candidates );
+      int createCandidates( QList<LabelPosition *> &lPos, double bboxMin[2], double bboxMax[2], PointSet *mapShape );
 
       /** Generate candidates for point feature, located around a specified point.
        * @param x x coordinate of the point
@@ -245,6 +245,23 @@ bool LabelPosition::isInConflict( LabelPosition *lp )
     return isInConflictMultiPart( lp );
 }
 
+void LabelPosition::prepareGeos()
+{
+  GEOSContextHandle_t geosctxt = geosContext();
+  for ( LabelPosition* part = this; part; part = part->nextPart )
+  {
+    try
+    {
+      // the test also computes the envelope GEOS caches on the geometry
+      GEOSPreparedIntersects_r( geosctxt, part->preparedGeom(), part->mGeos );
+    }
+    catch ( GEOSException &e )
+    {
+      QgsMessageLog::logMessage( QObject::tr( "Exception: %1" ).arg( e.what() ), QObject::tr( "GEOS" ) );
+    }
+  }
+}
+
 bool LabelPosition::isInConflictSinglePart( LabelPosition* lp )
 {
   if ( !mGeos )
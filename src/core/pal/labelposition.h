@@ -124,6 +124,13 @@ namespace pal
        */
       bool isInConflict( LabelPosition *ls );
 
+      /**
+       * \brief Creates the GEOS geometries of all the parts and their prepared geometries,
+       * so that conflicts with this position can then be checked from several threads
+       * @note added in QGIS 2.99
+       */
+      void prepareGeos();
+
       /** Return bounding box - amin: xmin,ymin - amax: xmax,ymax */
       void getBoundingBox( double amin[2], double amax[2] ) const;
 
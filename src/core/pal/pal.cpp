@@ -43,6 +43,8 @@
 #include "util.h"
 #include <cfloat>
 
+#include <QtConcurrentMap>
+
 using namespace pal;
 
 GEOSContextHandle_t pal::geosContext()
@@ -57,6 +59,8 @@ Pal::Pal()
 
   fnIsCancelled = nullptr;
   fnIsCancelledContext = nullptr;
+  fnIsFixedCandidate = nullptr;
+  fnIsFixedCandidateContext = nullptr;
 
   ejChainDeg = 50;
   tenure = 10;
@@ -76,6 +80,8 @@ Pal::Pal()
   poly_p = 8;
 
   showPartial = true;
+
+  mParallel = true;
 }
 
 void Pal::removeLayer( Layer *layer )
@@ -121,11 +127,8 @@ Layer* Pal::addLayer( QgsAbstractLabelProvider* provider, const QString& layerNa
 typedef struct _featCbackCtx
 {
   Layer *layer;
-  QLinkedList<Feats*>* fFeats;
+  QList<FeaturePart*>* featureParts;
   RTree<FeaturePart*, double, 2, double> *obstacles;
-  RTree<LabelPosition*, double, 2, double> *candidates;
-  double bbox_min[2];
-  double bbox_max[2];
 } FeatCallBackCtx;
 
 
@@ -152,27 +155,65 @@ bool extractFeatCallback( FeaturePart *ft_ptr, void *ctx )
     }
   }
 
-  // generate candidates for the feature part
-  QList< LabelPosition* > lPos;
-  if ( ft_ptr->createCandidates( lPos, context->bbox_min, context->bbox_max, ft_ptr, context->candidates ) )
-  {
-    // valid features are added to fFeats
-    Feats *ft = new Feats();
-    ft->feature = ft_ptr;
-    ft->shape = nullptr;
-    ft->lPos = lPos;
-    ft->priority = ft_ptr->calculatePriority();
-    context->fFeats->append( ft );
-  }
-  else
-  {
-    // Others are deleted
-    qDeleteAll( lPos );
-  }
+  // candidates are generated afterwards, for all the feature parts at once
+  context->featureParts->append( ft_ptr );
 
   return true;
 }
 
+//! Label candidates of a feature part
+typedef struct _featCandidates
+{
+  FeaturePart *feature;
+  QList< LabelPosition* > lPos;
+} FeatCandidates;
+
+//! Generates the label candidates of feature parts, in parallel
+class CandidatesGenerator
+{
+  public:
+    typedef void result_type;
+
+    CandidatesGenerator( double bboxMin[2], double bboxMax[2], Pal::FnIsFixedCandidate fnFixedCandidate, void* fixedCandidateContext )
+        : mFnIsFixedCandidate( fnFixedCandidate )
+        , mFixedCandidateContext( fixedCandidateContext )
+    {
+      mBboxMin[0] = bboxMin[0];
+      mBboxMin[1] = bboxMin[1];
+      mBboxMax[0] = bboxMax[0];
+      mBboxMax[1] = bboxMax[1];
+    }
+
+    void operator()( FeatCandidates &candidates )
+    {
+      double bboxMin[2] = { mBboxMin[0], mBboxMin[1] };
+      double bboxMax[2] = { mBboxMax[0], mBboxMax[1] };
+      candidates.feature->createCandidates( candidates.lPos, bboxMin, bboxMax, candidates.feature );
+
+      if ( !mFnIsFixedCandidate )
+        return;
+
+      // a fixed candidate (e.g. the position of the previous solution) replaces all the others
+      for ( int i = 0; i < candidates.lPos.count(); i++ )
+      {
+        if ( mFnIsFixedCandidate( candidates.lPos.at( i ), mFixedCandidateContext ) )
+        {
+          LabelPosition* fixed = candidates.lPos.takeAt( i );
+          qDeleteAll( candidates.lPos );
+          candidates.lPos.clear();
+          candidates.lPos << fixed;
+          break;
+        }
+      }
+    }
+
+  private:
+    double mBboxMin[2];
+    double mBboxMax[2];
+    Pal::FnIsFixedCandidate mFnIsFixedCandidate;
+    void* mFixedCandidateContext;
+};
+
 typedef struct _obstaclebackCtx
 {
   RTree<FeaturePart*, double, 2, double> *obstacles;
@@ -250,14 +291,11 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
   QLinkedList<Feats*> *fFeats = new QLinkedList<Feats*>;
 
+  QList<FeaturePart*> featureParts;
+
   FeatCallBackCtx context;
-  context.fFeats = fFeats;
+  context.featureParts = &featureParts;
   context.obstacles = obstacles;
-  context.candidates = prob->candidates;
-  context.bbox_min[0] = amin[0];
-  context.bbox_min[1] = amin[1];
-  context.bbox_max[0] = amax[0];
-  context.bbox_max[1] = amax[1];
 
   ObstacleCallBackCtx obstacleContext;
   obstacleContext.obstacles = obstacles;
@@ -265,10 +303,12 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
   // first step : extract features from layers
 
-  int previousFeatureCount = 0;
   int previousObstacleCount = 0;
 
-  QStringList layersWithFeaturesInBBox;
+  // layers with feature parts or obstacles in the extent, and the end of their parts in featureParts
+  QList<Layer*> extractedLayers;
+  QList<int> extractedLayersPartsEnd;
+  QList<bool> extractedLayersObstacles;
 
   mMutex.lock();
   Q_FOREACH ( Layer* layer, mLayers )
@@ -299,12 +339,59 @@ Problem* Pal::extract( double lambda_min, double phi_min, double lambda_max, dou
 
     layer->mMutex.unlock();
 
-    if ( context.fFeats->size() - previousFeatureCount > 0 || obstacleContext.obstacleCount > previousObstacleCount )
+    extractedLayers << layer;
+    extractedLayersPartsEnd << featureParts.size();
+    extractedLayersObstacles << ( obstacleContext.obstacleCount > previousObstacleCount );
+    previousObstacleCount = obstacleContext.obstacleCount;
+  }
+
+  // generate candidates lists, features are independent and processed concurrently
+  QVector<FeatCandidates> featCandidates( featureParts.size() );
+  for ( i = 0; i < featureParts.size(); i++ )
+  {
+    featCandidates[i].feature = featureParts.at( i );
+  }
+  CandidatesGenerator generator( amin, amax, fnIsFixedCandidate, fnIsFixedCandidateContext );
+  if ( mParallel )
+  {
+    QtConcurrent::blockingMap( featCandidates, generator );
+  }
+  else
+  {
+    for ( i = 0; i < featCandidates.size(); i++ )
+      generator( featCandidates[i] );
+  }
+
+  QStringList layersWithFeaturesInBBox;
+  int part = 0;
+  for ( i = 0; i < extractedLayers.size(); i++ )
+  {
+    bool hasFeatures = false;
+    for ( ; part < extractedLayersPartsEnd.at( i ); part++ )
+    {
+      FeatCandidates &candidates = featCandidates[part];
+      if ( candidates.lPos.isEmpty() )
+        continue;
+
+      // valid features are added to fFeats, in the order of extraction
+      Q_FOREACH ( LabelPosition* pos, candidates.lPos )
+      {
+        pos->insertIntoIndex( prob->candidates );
+      }
+
+      Feats *ft = new Feats();
+      ft->feature = candidates.feature;
+      ft->shape = nullptr;
+      ft->lPos = candidates.lPos;
+      ft->priority = candidates.feature->calculatePriority();
+      fFeats->append( ft );
+      hasFeatures = true;
+    }
+
+    if ( hasFeatures || extractedLayersObstacles.at( i ) )
     {
-      layersWithFeaturesInBBox << layer->name();
+      layersWithFeaturesInBBox << extractedLayers.at( i )->name();
     }
-    previousFeatureCount = context.fFeats->size();
-    previousObstacleCount = obstacleContext.obstacleCount;
   }
   mMutex.unlock();
 
@@ -509,6 +596,12 @@ void Pal::registerCancellationCallback( Pal::FnIsCancelled fnCancelled, void *co
   fnIsCancelledContext = context;
 }
 
+void Pal::registerFixedCandidateCallback( Pal::FnIsFixedCandidate fnFixedCandidate, void* context )
+{
+  fnIsFixedCandidate = fnFixedCandidate;
+  fnIsFixedCandidateContext = context;
+}
+
 Problem* Pal::extractProblem( double bbox[4] )
 {
   return extract( bbox[0], bbox[1], bbox[2], bbox[3] );
@@ -626,6 +719,16 @@ bool Pal::getShowPartial()
   return showPartial;
 }
 
+void Pal::setParallel( bool parallel )
+{
+  mParallel = parallel;
+}
+
+bool Pal::isParallel() const
+{
+  return mParallel;
+}
+
 SearchMethod Pal::getSearch()
 {
   return searchMethod;
@@ -143,6 +143,15 @@ namespace pal
       /** Check whether the job has been cancelled */
       inline bool isCancelled() { return fnIsCancelled ? fnIsCancelled( fnIsCancelledContext ) : false; }
 
+      typedef bool ( *FnIsFixedCandidate )( LabelPosition* lp, void* ctx );
+
+      /** Register a function that returns whether a label candidate is the fixed position of its feature part.
+       * When a candidate is fixed, the other candidates of the feature part are discarded before solving.
+       * The function is called concurrently for several feature parts.
+       * @note added in QGIS 2.99
+       */
+      void registerFixedCandidateCallback( FnIsFixedCandidate fnFixedCandidate, void* context );
+
       Problem* extractProblem( double bbox[4] );
 
       QList<LabelPosition*>* solveProblem( Problem* prob, bool displayAll );
@@ -161,6 +170,21 @@ namespace pal
        */
       bool getShowPartial();
 
+      /**
+       * \brief Sets whether the candidates are generated and the problem is solved in parallel
+       * threads. The placement is the same either way.
+       * @note added in QGIS 2.99
+       * @see isParallel()
+       */
+      void setParallel( bool parallel );
+
+      /**
+       * \brief Returns whether the candidates are generated and the problem is solved in parallel
+       * @note added in QGIS 2.99
+       * @see setParallel()
+       */
+      bool isParallel() const;
+
       /**
        * \brief set # candidates to generate for points features
        * Higher the value is, longer Pal::labeller will spend time
@@ -257,11 +281,19 @@ namespace pal
        */
       bool showPartial;
 
+      //! generate the candidates and solve the problem in parallel threads
+      bool mParallel;
+
       /** Callback that may be called from PAL to check whether the job has not been cancelled in meanwhile */
       FnIsCancelled fnIsCancelled;
       /** Application-specific context for the cancellation check function */
       void* fnIsCancelledContext;
 
+      /** Callback that may be called from PAL to check whether a candidate is the fixed position of its feature part */
+      FnIsFixedCandidate fnIsFixedCandidate;
+      /** Application-specific context for the fixed candidate check function */
+      void* fnIsFixedCandidateContext;
+
       /**
        * \brief Problem factory
        * Extract features to label and generates candidates for them,
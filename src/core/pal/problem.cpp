@@ -43,6 +43,8 @@
 
 #include "qgslabelingenginev2.h"
 
+#include <QtConcurrentMap>
+
 using namespace pal;
 
 inline void delete_chain( Chain *chain )
@@ -78,7 +80,6 @@ Problem::Problem()
   featWrap = nullptr;
   candidates = new RTree<LabelPosition*, double, 2, double>();
   candidates_sol = new RTree<LabelPosition*, double, 2, double>();
-  candidates_subsol = nullptr;
 }
 
 Problem::~Problem()
@@ -105,11 +106,6 @@ Problem::~Problem()
 
   delete candidates;
   delete candidates_sol;
-
-  if ( candidates_subsol )
-  {
-    delete candidates_subsol;
-  }
 }
 
 typedef struct
@@ -119,6 +115,29 @@ typedef struct
   double nbOverlap;
 } Ft;
 
+//! Solves the sub parts of a connected component of the conflict graph
+class PopmusicComponentSolver
+{
+  public:
+    typedef void result_type;
+
+    PopmusicComponentSolver( Problem *problem, SubPart **parts, bool *ok )
+        : mProblem( problem )
+        , mParts( parts )
+        , mOk( ok )
+    {}
+
+    void operator()( const QVector<int> &positions )
+    {
+      mProblem->popmusicComponent( mParts, positions, mOk );
+    }
+
+  private:
+    Problem *mProblem;
+    SubPart **mParts;
+    bool *mOk;
+};
+
 inline bool borderSizeInc( void *l, void *r )
 {
   return ( reinterpret_cast< SubPart* >( l ) )->borderSize > ( reinterpret_cast< SubPart* >( r ) )->borderSize;
@@ -397,21 +416,10 @@ void Problem::popmusic()
     return;
 
   int i;
-  int seed;
   bool *ok = new bool[nbft];
 
   int r = pal->popmusic_r;
 
-  SearchMethod searchMethod = pal->searchMethod;
-
-  candidates_subsol = new RTree<LabelPosition*, double, 2, double>();
-
-  double delta = 0.0;
-
-  int it = 0;
-
-  SubPart *current = nullptr;
-
   labelPositionCost = new double[all_nblp];
   nbOlap = new int[all_nblp];
 
@@ -437,36 +445,94 @@ void Problem::popmusic()
 
   solution_cost();
 
-  int popit = 0;
+  // sub parts never span several connected components of the conflict graph: the components
+  // share no feature nor candidate and are solved concurrently. Each component is solved on
+  // its own in the order of its sub parts, so the result does not depend on the threads.
+  QVector< QVector<int> > components = conflictComponents( parts );
+  PopmusicComponentSolver solver( this, parts, ok );
+  if ( pal->isParallel() )
+  {
+    // the candidates index is shared: a thread also tests the conflicts of its candidates with
+    // candidates of the other components, whose GEOS geometries must not be created lazily then
+    for ( i = 0; i < all_nblp; i++ )
+      mLabelPositions.at( i )->prepareGeos();
+
+    QtConcurrent::blockingMap( components, solver );
+  }
+  else
+  {
+    for ( i = 0; i < components.size(); i++ )
+      solver( components.at( i ) );
+  }
+
+  // the threads only update the solution, index its candidates again
+  candidates_sol->RemoveAll();
+  for ( i = 0; i < nbft; i++ )
+  {
+    if ( sol->s[i] != -1 )
+      mLabelPositions.at( sol->s[i] )->insertIntoIndex( candidates_sol );
+  }
+
+  solution_cost();
+
+  delete[] labelPositionCost;
+  delete[] nbOlap;
+
+  for ( i = 0; i < nbft; i++ )
+  {
+    delete[] parts[i]->sub;
+    delete[] parts[i]->sol;
+    delete parts[i];
+  }
+  delete[] parts;
+
+  delete[] ok;
+
+  return;
+}
+
+void Problem::popmusicComponent( SubPart **parts, const QVector<int> &positions, bool *ok )
+{
+  int i;
+  int seed;
+  int n = positions.size();
+
+  SearchMethod searchMethod = pal->searchMethod;
+
+  double delta = 0.0;
+
+  SubPart *current = nullptr;
+
+  // sub solution index of this thread
+  RTree<LabelPosition*, double, 2, double> candidatesSubsol;
 
   seed = 0;
   while ( true )
   {
-    it++;
     /* find the next seed not ok */
-    for ( i = ( seed + 1 ) % nbft; ok[i] && i != seed; i = ( i + 1 ) % nbft )
+    for ( i = ( seed + 1 ) % n; ok[parts[positions.at( i )]->seed] && i != seed; i = ( i + 1 ) % n )
       ;
 
-    if ( i == seed && ok[seed] )
+    if ( i == seed && ok[parts[positions.at( seed )]->seed] )
     {
-      current = nullptr; // everything is OK :-)
-      break;
+      break; // everything is OK :-)
     }
     else
     {
       seed = i;
-      current = parts[seed];
+      current = parts[positions.at( seed )];
     }
 
     // update sub part solution
-    candidates_subsol->RemoveAll();
+    candidatesSubsol.RemoveAll();
+    current->candidates_subsol = &candidatesSubsol;
 
     for ( i = 0; i < current->subSize; i++ )
     {
       current->sol[i] = sol->s[current->sub[i]];
       if ( current->sol[i] != -1 )
       {
-        mLabelPositions.at( current->sol[i] )->insertIntoIndex( candidates_subsol );
+        mLabelPositions.at( current->sol[i] )->insertIntoIndex( &candidatesSubsol );
       }
     }
 
@@ -486,12 +552,11 @@ void Problem::popmusic()
         delta = popmusic_chain( current );
         break;
       default:
-        delete[] ok;
-        delete[] parts;
+        current->candidates_subsol = nullptr;
         return;
     }
 
-    popit++;
+    current->candidates_subsol = nullptr;
 
     if ( delta > EPSILON )
     {
@@ -503,44 +568,88 @@ void Problem::popmusic()
 
       for ( i = current->borderSize; i < current->subSize; i++ )
       {
-
-        if ( sol->s[current->sub[i]] != -1 )
-        {
-          mLabelPositions.at( sol->s[current->sub[i]] )->removeFromIndex( candidates_sol );
-        }
-
         sol->s[current->sub[i]] = current->sol[i];
-
-        if ( current->sol[i] != -1 )
-        {
-          mLabelPositions.at( current->sol[i] )->insertIntoIndex( candidates_sol );
-        }
-
         ok[current->sub[i]] = false;
       }
     }
     else  // not improved
     {
-      ok[seed] = true;
+      ok[current->seed] = true;
     }
   }
+}
 
-  solution_cost();
+typedef struct
+{
+  int *component;
+  LabelPosition *lp;
+} ComponentContext;
 
-  delete[] labelPositionCost;
-  delete[] nbOlap;
+static int componentRoot( int *component, int featureId )
+{
+  while ( component[featureId] != featureId )
+  {
+    component[featureId] = component[component[featureId]];
+    featureId = component[featureId];
+  }
+  return featureId;
+}
 
-  for ( i = 0; i < nbft; i++ )
+bool componentCallback( LabelPosition *lp, void *ctx )
+{
+  ComponentContext* context = reinterpret_cast< ComponentContext* >( ctx );
+
+  // both tests create the GEOS geometries of the candidates, before the threads
+  // which test them again
+  bool conflict = lp->isInConflict( context->lp );
+  if ( context->lp->isInConflict( lp ) || conflict )
   {
-    delete[] parts[i]->sub;
-    delete[] parts[i]->sol;
-    delete parts[i];
+    int root1 = componentRoot( context->component, lp->getProblemFeatureId() );
+    int root2 = componentRoot( context->component, context->lp->getProblemFeatureId() );
+    context->component[qMax( root1, root2 )] = qMin( root1, root2 );
   }
-  delete[] parts;
 
-  delete[] ok;
+  return true;
+}
 
-  return;
+QVector< QVector<int> > Problem::conflictComponents( SubPart **parts )
+{
+  int *component = new int[nbft];
+  for ( int i = 0; i < nbft; i++ )
+    component[i] = i;
+
+  double amin[2];
+  double amax[2];
+
+  ComponentContext context;
+  context.component = component;
+
+  for ( int i = 0; i < nbft; i++ )
+  {
+    for ( int j = featStartId[i]; j < featStartId[i] + featNbLp[i]; j++ )
+    {
+      LabelPosition *lp = mLabelPositions.at( j );
+      lp->getBoundingBox( amin, amax );
+      context.lp = lp;
+      candidates->Search( amin, amax, componentCallback, reinterpret_cast< void* >( &context ) );
+    }
+  }
+
+  QVector< QVector<int> > components;
+  QVector<int> componentIndex( nbft, -1 );
+  for ( int position = 0; position < nbft; position++ )
+  {
+    int root = componentRoot( component, parts[position]->seed );
+    if ( componentIndex.at( root ) == -1 )
+    {
+      componentIndex[root] = components.size();
+      components.append( QVector<int>() );
+    }
+    components[componentIndex.at( root )].append( position );
+  }
+
+  delete[] component;
+  return components;
 }
 
 typedef struct
@@ -646,6 +755,7 @@ SubPart * Problem::subPart( int r, int featseed, int *isIn )
   subPart->sub = sub;
   subPart->sol = new int [subPart->subSize];
   subPart->seed = featseed;
+  subPart->candidates_subsol = nullptr;
   return subPart;
 }
 
@@ -672,7 +782,7 @@ double Problem::compute_feature_cost( SubPart *part, int feat_id, int label_id,
     lp->getBoundingBox( amin, amax );
 
     context.lp = lp;
-    candidates_subsol->Search( amin, amax, LabelPosition::countFullOverlapCallback, reinterpret_cast< void* >( &context ) );
+    part->candidates_subsol->Search( amin, amax, LabelPosition::countFullOverlapCallback, reinterpret_cast< void* >( &context ) );
 
     cost += lp->cost();
   }
@@ -1010,7 +1120,7 @@ double Problem::popmusic_tabu( SubPart *part )
       candidateList[candidateId]->label_id = choosed_label;
 
       if ( old_label != -1 )
-        mLabelPositions.at( old_label )->removeFromIndex( candidates_subsol );
+        mLabelPositions.at( old_label )->removeFromIndex( part->candidates_subsol );
 
       /* re-compute all labelpositioncost that overlap with old an new label */
       double local_inactive = inactiveCost[sub[choosed_feat]];
@@ -1065,7 +1175,7 @@ double Problem::popmusic_tabu( SubPart *part )
 
         candidates->Search( amin, amax, updateCandidatesCost, &context );
 
-        lp->insertIntoIndex( candidates_subsol );
+        lp->insertIntoIndex( part->candidates_subsol );
       }
 
       Util::sort( reinterpret_cast< void** >( candidateList ), probSize, decreaseCost );
@@ -1253,7 +1363,7 @@ inline Chain *Problem::chain( SubPart *part, int seed )
             context.lp = lp;
 
             // search ative conflicts and count them
-            candidates_subsol->Search( amin, amax, chainCallback, reinterpret_cast< void* >( &context ) );
+            part->candidates_subsol->Search( amin, amax, chainCallback, reinterpret_cast< void* >( &context ) );
 
             // no conflict -> end of chain
             if ( conflicts->isEmpty() )
@@ -1416,12 +1526,12 @@ inline Chain *Problem::chain( SubPart *part, int seed )
 
       if ( et->old_label != -1 )
       {
-        mLabelPositions.at( et->old_label )->removeFromIndex( candidates_subsol );
+        mLabelPositions.at( et->old_label )->removeFromIndex( part->candidates_subsol );
       }
 
       if ( et->new_label != -1 )
       {
-        mLabelPositions.at( et->new_label )->insertIntoIndex( candidates_subsol );
+        mLabelPositions.at( et->new_label )->insertIntoIndex( part->candidates_subsol );
       }
 
       tmpsol[seed] = retainedLabel;
@@ -1436,12 +1546,12 @@ inline Chain *Problem::chain( SubPart *part, int seed )
 
     if ( et->new_label != -1 )
     {
-      mLabelPositions.at( et->new_label )->removeFromIndex( candidates_subsol );
+      mLabelPositions.at( et->new_label )->removeFromIndex( part->candidates_subsol );
     }
 
     if ( et->old_label != -1 )
     {
-      mLabelPositions.at( et->old_label )->insertIntoIndex( candidates_subsol );
+      mLabelPositions.at( et->old_label )->insertIntoIndex( part->candidates_subsol );
     }
 
     delete et;
@@ -1827,13 +1937,13 @@ double Problem::popmusic_chain( SubPart *part )
 
           if ( sol[fid] >= 0 )
           {
-            mLabelPositions.at( sol[fid] )->removeFromIndex( candidates_subsol );
+            mLabelPositions.at( sol[fid] )->removeFromIndex( part->candidates_subsol );
           }
           sol[fid] = lid;
 
           if ( sol[fid] >= 0 )
           {
-            mLabelPositions.at( lid )->insertIntoIndex( candidates_subsol );
+            mLabelPositions.at( lid )->insertIntoIndex( part->candidates_subsol );
           }
 
           tabu_list[fid] = it + tenure;
@@ -2018,12 +2128,12 @@ double Problem::popmusic_tabu_chain( SubPart *part )
         lid = retainedChain->label[i];
 
         if ( sol[fid] >= 0 )
-          mLabelPositions.at( sol[fid] )->removeFromIndex( candidates_subsol );
+          mLabelPositions.at( sol[fid] )->removeFromIndex( part->candidates_subsol );
 
         sol[fid] = lid;
 
         if ( lid >= 0 )
-          mLabelPositions.at( lid )->insertIntoIndex( candidates_subsol );
+          mLabelPositions.at( lid )->insertIntoIndex( part->candidates_subsol );
 
         tabu_list[fid] = it + tenure;
         candidatesUnsorted[fid-borderSize]->cost = ( lid == -1 ? inactiveCost[sub[fid]] : mLabelPositions.at( lid )->cost() );
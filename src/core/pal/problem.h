@@ -32,6 +32,7 @@
 
 #include <list>
 #include <QList>
+#include <QVector>
 #include "rtree.hpp"
 
 namespace pal
@@ -81,6 +82,10 @@ namespace pal
      * first feat in sub part
      */
     int seed;
+    /**
+     * index of the candidates of the sub solution, not shared with the sub parts solved in other threads
+     */
+    RTree<LabelPosition*, double, 2, double> *candidates_subsol;
   } SubPart;
 
   typedef struct _chain
@@ -129,9 +134,20 @@ namespace pal
 
       /**
        * \brief popmusic framework
+       *
+       * The connected components of the conflict graph are solved in parallel.
        */
       void popmusic();
 
+      /**
+       * \brief popmusic framework, restricted to the sub parts seeded in a connected component of the conflict graph
+       * @param parts sub parts of all the features, in solving order
+       * @param positions positions in parts of the sub parts of the component
+       * @param ok per feature flags, set once the sub part of the feature cannot be improved
+       * @note added in QGIS 2.99
+       */
+      void popmusicComponent( SubPart **parts, const QVector<int> &positions, bool *ok );
+
       /**
        * \brief Test with very-large scale neighborhood
        */
@@ -217,7 +233,6 @@ namespace pal
 
       RTree<LabelPosition*, double, 2, double> *candidates;  // index all candidates
       RTree<LabelPosition*, double, 2, double> *candidates_sol; // index active candidates
-      RTree<LabelPosition*, double, 2, double> *candidates_subsol; // idem for subparts
 
       //int *feat;        // [nblp]
       int *featStartId; // [nbft]
@@ -237,6 +252,13 @@ namespace pal
 
       Pal *pal;
 
+      /**
+       * Groups the sub parts by connected component of the conflict graph, two features being
+       * connected if any of their candidates are in conflict
+       * @returns positions in parts of the sub parts of each component
+       */
+      QVector< QVector<int> > conflictComponents( SubPart **parts );
+
       void solution_cost();
       void check_solution();
   };
@@ -33,6 +33,39 @@ QgsCoordinateTransformCache::~QgsCoordinateTransformCache()
 {}
 
 QgsCoordinateTransform QgsCoordinateTransformCache::transform( const QString& srcAuthId, const QString& destAuthId, int srcDatumTransform, int destDatumTransform )
+{
+  mLock.lockForRead();
+  QgsCoordinateTransform cached = cachedTransform( srcAuthId, destAuthId, srcDatumTransform, destDatumTransform );
+  mLock.unlock();
+  if ( cached.isValid() )
+  {
+    return cached;
+  }
+
+  //not found, insert new value
+  QgsCoordinateReferenceSystem srcCrs = QgsCoordinateReferenceSystem::fromOgcWmsCrs( srcAuthId );
+  QgsCoordinateReferenceSystem destCrs = QgsCoordinateReferenceSystem::fromOgcWmsCrs( destAuthId );
+  QgsCoordinateTransform ct = QgsCoordinateTransform( srcCrs, destCrs );
+  ct.setSourceDatumTransform( srcDatumTransform );
+  ct.setDestinationDatumTransform( destDatumTransform );
+  ct.initialise();
+
+  mLock.lockForWrite();
+  // another thread may have inserted the same transform in the meantime
+  cached = cachedTransform( srcAuthId, destAuthId, srcDatumTransform, destDatumTransform );
+  if ( cached.isValid() )
+  {
+    ct = cached;
+  }
+  else
+  {
+    mTransforms.insertMulti( qMakePair( srcAuthId, destAuthId ), ct );
+  }
+  mLock.unlock();
+  return ct;
+}
+
+QgsCoordinateTransform QgsCoordinateTransformCache::cachedTransform( const QString& srcAuthId, const QString& destAuthId, int srcDatumTransform, int destDatumTransform ) const
 {
   QList< QgsCoordinateTransform > values =
     mTransforms.values( qMakePair( srcAuthId, destAuthId ) );
@@ -47,20 +80,13 @@ QgsCoordinateTransform QgsCoordinateTransformCache::transform( const QString& sr
       return *valIt;
     }
   }
-
-  //not found, insert new value
-  QgsCoordinateReferenceSystem srcCrs = QgsCoordinateReferenceSystem::fromOgcWmsCrs( srcAuthId );
-  QgsCoordinateReferenceSystem destCrs = QgsCoordinateReferenceSystem::fromOgcWmsCrs( destAuthId );
-  QgsCoordinateTransform ct = QgsCoordinateTransform( srcCrs, destCrs );
-  ct.setSourceDatumTransform( srcDatumTransform );
-  ct.setDestinationDatumTransform( destDatumTransform );
-  ct.initialise();
-  mTransforms.insertMulti( qMakePair( srcAuthId, destAuthId ), ct );
-  return ct;
+  return QgsCoordinateTransform();
 }
 
 void QgsCoordinateTransformCache::invalidateCrs( const QString& crsAuthId )
 {
+  QWriteLocker locker( &mLock );
+
   //get keys to remove first
   QHash< QPair< QString, QString >, QgsCoordinateTransform >::const_iterator it = mTransforms.constBegin();
   QVector< QPair< QString, QString > > updateList;
@@ -48,6 +48,11 @@ class CORE_EXPORT QgsCoordinateTransformCache
 
   private:
     QMultiHash< QPair< QString, QString >, QgsCoordinateTransform > mTransforms; //same auth_id pairs might have different datum transformations
+    //! Protects mTransforms, the cache is used by the rendering and server threads
+    QReadWriteLock mLock;
+
+    //! Returns the cached transform, or an invalid transform if there is none (mLock must be held)
+    QgsCoordinateTransform cachedTransform( const QString& srcAuthId, const QString& destAuthId, int srcDatumTransform, int destDatumTransform ) const;
 
     QgsCoordinateTransformCache();
     QgsCoordinateTransformCache( const QgsCoordinateTransformCache& rh );
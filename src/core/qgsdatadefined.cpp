@@ -18,6 +18,7 @@
 
 #include "qgslogger.h"
 #include "qgsexpression.h"
+#include "qgsfeature.h"
 #include "qgsfield.h"
 #include "qgsvectorlayer.h"
 
@@ -229,6 +230,25 @@ QgsExpression *QgsDataDefined::expression()
   return d->expression;
 }
 
+QVector<QVariant> QgsDataDefined::evaluateBatch( const QList<QgsFeature>& features, QgsExpressionContext& context )
+{
+  if ( d->useExpression )
+  {
+    if ( !d->expression || !d->expressionPrepared )
+      return QVector<QVariant>( features.count() );
+
+    return d->expression->evaluateBatch( features, &context );
+  }
+
+  QVector<QVariant> values;
+  values.reserve( features.count() );
+  Q_FOREACH ( const QgsFeature& feature, features )
+  {
+    values << ( d->field.isEmpty() ? QVariant() : feature.attribute( d->field ) );
+  }
+  return values;
+}
+
 QStringList QgsDataDefined::referencedColumns( QgsVectorLayer* layer )
 {
   if ( layer )
@@ -171,6 +171,16 @@ class CORE_EXPORT QgsDataDefined
 
     QgsExpression* expression();
 
+    /** Evaluates the data defined value for a block of features, using the batch
+     * evaluation of the expression when in expression mode or the field values otherwise.
+     * @param features features to evaluate
+     * @param context expression context, its feature is replaced while evaluating the block
+     * @returns one value per feature, NULL values if the expression is not prepared
+     * @note prepareExpression() should be called before calling this method.
+     * @note added in QGIS 2.99
+     */
+    QVector<QVariant> evaluateBatch( const QList<QgsFeature>& features, QgsExpressionContext& context );
+
     /** Returns the columns referenced by the QgsDataDefined
      * @param layer vector layer, used for preparing the expression if required
      * @deprecated use QgsExpressionContext variant instead
@@ -3193,6 +3193,79 @@ const QStringList& QgsExpression::BuiltinFunctions()
 QList<QgsExpression::Function*> QgsExpression::gmFunctions;
 QList<QgsExpression::Function*> QgsExpression::gmOwnedFunctions;
 
+///////////////////////////////////////////////
+// typed numeric implementations, used by compiled expressions
+// these must return the same results as their QVariant counterparts above
+
+static bool dblSqrt( const double* v, double& r ) { r = sqrt( v[0] ); return true; }
+static bool dblAbs( const double* v, double& r ) { r = fabs( v[0] ); return true; }
+static bool dblRadians( const double* v, double& r ) { r = ( v[0] * M_PI ) / 180; return true; }
+static bool dblDegrees( const double* v, double& r ) { r = ( 180 * v[0] ) / M_PI; return true; }
+static bool dblSin( const double* v, double& r ) { r = sin( v[0] ); return true; }
+static bool dblCos( const double* v, double& r ) { r = cos( v[0] ); return true; }
+static bool dblTan( const double* v, double& r ) { r = tan( v[0] ); return true; }
+static bool dblAsin( const double* v, double& r ) { r = asin( v[0] ); return true; }
+static bool dblAcos( const double* v, double& r ) { r = acos( v[0] ); return true; }
+static bool dblAtan( const double* v, double& r ) { r = atan( v[0] ); return true; }
+static bool dblAtan2( const double* v, double& r ) { r = atan2( v[0], v[1] ); return true; }
+static bool dblExp( const double* v, double& r ) { r = exp( v[0] ); return true; }
+static bool dblFloor( const double* v, double& r ) { r = floor( v[0] ); return true; }
+static bool dblCeil( const double* v, double& r ) { r = ceil( v[0] ); return true; }
+static bool dblPi( const double*, double& r ) { r = M_PI; return true; }
+
+static bool dblLn( const double* v, double& r )
+{
+  if ( v[0] <= 0 )
+    return false;
+  r = log( v[0] );
+  return true;
+}
+
+static bool dblLog10( const double* v, double& r )
+{
+  if ( v[0] <= 0 )
+    return false;
+  r = log10( v[0] );
+  return true;
+}
+
+static bool dblLog( const double* v, double& r )
+{
+  if ( v[1] <= 0 || v[0] <= 0 )
+    return false;
+  r = log( v[1] ) / log( v[0] );
+  return true;
+}
+
+static void registerDoubleFunctions( const QList<QgsExpression::Function*>& functions )
+{
+  QHash<QString, QgsExpression::FcnEvalDouble> typed;
+  typed.insert( "sqrt", dblSqrt );
+  typed.insert( "abs", dblAbs );
+  typed.insert( "radians", dblRadians );
+  typed.insert( "degrees", dblDegrees );
+  typed.insert( "sin", dblSin );
+  typed.insert( "cos", dblCos );
+  typed.insert( "tan", dblTan );
+  typed.insert( "asin", dblAsin );
+  typed.insert( "acos", dblAcos );
+  typed.insert( "atan", dblAtan );
+  typed.insert( "atan2", dblAtan2 );
+  typed.insert( "exp", dblExp );
+  typed.insert( "ln", dblLn );
+  typed.insert( "log10", dblLog10 );
+  typed.insert( "log", dblLog );
+  typed.insert( "floor", dblFloor );
+  typed.insert( "ceil", dblCeil );
+  typed.insert( "pi", dblPi );
+
+  Q_FOREACH ( QgsExpression::Function* func, functions )
+  {
+    if ( typed.contains( func->name() ) )
+      func->setDoubleFunction( typed.value( func->name() ) );
+  }
+}
+
 const QList<QgsExpression::Function*>& QgsExpression::Functions()
 {
   // The construction of the list isn't thread-safe, and without the mutex,
@@ -3412,6 +3485,8 @@ const QList<QgsExpression::Function*>& QgsExpression::Functions()
     << new StaticFunction( "_specialcol_", 1, fcnSpecialColumn, "Special" )
     ;
 
+    registerDoubleFunctions( gmFunctions );
+
     QgsExpressionContextUtils::registerContextFunctions();
 
     //QgsExpression has ownership of all built-in functions
@@ -3695,7 +3770,19 @@ bool QgsExpression::prepare( const QgsExpressionContext *context )
     return false;
   }
 
-  return d->mRootNode->prepare( this, context );
+  delete d->mProgram;
+  d->mProgram = nullptr;
+
+  if ( !d->mRootNode->prepare( this, context ) )
+    return false;
+
+  d->mProgram = QgsExpressionProgram::compile( this, d->mRootNode, context );
+  return true;
+}
+
+bool QgsExpression::isCompiled() const
+{
+  return d->mProgram != nullptr;
 }
 
 QVariant QgsExpression::evaluate( const QgsFeature* f )
@@ -3746,6 +3833,9 @@ QVariant QgsExpression::evaluate()
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->evaluate( this, static_cast<const QgsExpressionContext*>( nullptr ) );
+
   return d->mRootNode->eval( this, static_cast<const QgsExpressionContext*>( nullptr ) );
 }
 
@@ -3758,9 +3848,48 @@ QVariant QgsExpression::evaluate( const QgsExpressionContext *context )
     return QVariant();
   }
 
+  if ( d->mProgram )
+    return d->mProgram->evaluate( this, context );
+
   return d->mRootNode->eval( this, context );
 }
 
+QVector<QVariant> QgsExpression::evaluateBatch( const QList<QgsFeature>& features, QgsExpressionContext* context )
+{
+  d->mEvalErrorString = QString();
+  if ( !d->mRootNode )
+  {
+    d->mEvalErrorString = tr( "No root node! Parsing failed?" );
+    return QVector<QVariant>( features.count() );
+  }
+
+  QgsExpressionContext localContext;
+  if ( !context )
+    context = &localContext;
+
+  if ( d->mProgram )
+    return d->mProgram->evaluateBatch( this, context, features );
+
+  // not compiled, walk the tree for each feature
+  QVector<QVariant> results;
+  results.reserve( features.count() );
+  QString firstError;
+  Q_FOREACH ( const QgsFeature& feature, features )
+  {
+    context->setFeature( feature );
+    results << d->mRootNode->eval( this, context );
+    if ( hasEvalError() )
+    {
+      results.last() = QVariant();
+      if ( firstError.isNull() )
+        firstError = d->mEvalErrorString;
+      d->mEvalErrorString = QString();
+    }
+  }
+  d->mEvalErrorString = firstError;
+  return results;
+}
+
 bool QgsExpression::hasEvalError() const
 {
   return !d->mEvalErrorString.isNull();
@@ -3968,6 +4097,11 @@ QVariant QgsExpression::NodeUnaryOperator::eval( QgsExpression *parent, const Qg
   QVariant val = mOperand->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalValue( parent, val );
+}
+
+QVariant QgsExpression::NodeUnaryOperator::evalValue( QgsExpression *parent, const QVariant& val )
+{
   switch ( mOp )
   {
     case uoNot:
@@ -4014,6 +4148,11 @@ QVariant QgsExpression::NodeBinaryOperator::eval( QgsExpression *parent, const Q
   QVariant vR = mOpRight->eval( parent, context );
   ENSURE_NO_EVAL_ERROR;
 
+  return evalValues( parent, vL, vR );
+}
+
+QVariant QgsExpression::NodeBinaryOperator::evalValues( QgsExpression *parent, const QVariant& vL, const QVariant& vR )
+{
   switch ( mOp )
   {
     case boPlus:
@@ -20,6 +20,7 @@
 #include <QStringList>
 #include <QVariant>
 #include <QList>
+#include <QVector>
 #include <QDomDocument>
 #include <QCoreApplication>
 #include <QSet>
@@ -165,6 +166,12 @@ class CORE_EXPORT QgsExpression
     //! Returns true if the expression uses feature geometry for some computation
     bool needsGeometry() const;
 
+    /** Returns true if prepare() lowered the expression to a compiled instruction stream
+     * which is used by evaluate() instead of walking the node tree.
+     * @note added in QGIS 2.99
+     */
+    bool isCompiled() const;
+
     // evaluation
 
     //! Evaluate the feature and return the result
@@ -202,6 +209,19 @@ class CORE_EXPORT QgsExpression
      */
     QVariant evaluate( const QgsExpressionContext* context );
 
+    /** Evaluates the expression for a block of features. Compiled expressions run each
+     * instruction over the whole block at once, which is considerably faster than calling
+     * evaluate() for each feature.
+     * @param features features to evaluate the expression against
+     * @param context context for evaluating expression. The feature set in the context
+     * is replaced while evaluating the block.
+     * @returns one result per feature. Features which failed to evaluate get a NULL result
+     * and the first error is available through evalErrorString().
+     * @note prepare() should be called before calling this method.
+     * @note added in QGIS 2.99
+     */
+    QVector<QVariant> evaluateBatch( const QList<QgsFeature>& features, QgsExpressionContext* context );
+
     //! Returns true if an error occurred when evaluating last input
     bool hasEvalError() const;
     //! Returns evaluation error
@@ -477,6 +497,13 @@ class CORE_EXPORT QgsExpression
      */
     typedef QVariant( *FcnEvalContext )( const QVariantList& values, const QgsExpressionContext* context, QgsExpression* parent );
 
+    /** Typed numeric implementation of a function, used by compiled expressions. The function receives
+     * its arguments already converted to doubles and returns false if the result is NULL.
+     * @note not available in Python bindings
+     * @note added in QGIS 2.99
+     */
+    typedef bool ( *FcnEvalDouble )( const double* values, double& result );
+
     /** \ingroup core
       * A abstract base class for defining QgsExpression functions.
       */
@@ -503,6 +530,7 @@ class CORE_EXPORT QgsExpression
             , mLazyEval( lazyEval )
             , mHandlesNull( handlesNull )
             , mIsContextual( isContextual )
+            , mDoubleFnc( nullptr )
         {
         }
 
@@ -528,6 +556,7 @@ class CORE_EXPORT QgsExpression
             , mLazyEval( lazyEval )
             , mHandlesNull( handlesNull )
             , mIsContextual( isContextual )
+            , mDoubleFnc( nullptr )
         {}
 
         virtual ~Function() {}
@@ -610,6 +639,22 @@ class CORE_EXPORT QgsExpression
 
         virtual bool handlesNull() const { return mHandlesNull; }
 
+        /** Returns the typed numeric implementation of the function, or nullptr if the function
+         * does not declare one. Compiled expressions call this directly instead of func().
+         * @see setDoubleFunction()
+         * @note not available in Python bindings
+         * @note added in QGIS 2.99
+         */
+        FcnEvalDouble doubleFunction() const { return mDoubleFnc; }
+
+        /** Sets the typed numeric implementation of the function. The implementation must
+         * return the same result as func() for numeric arguments.
+         * @see doubleFunction()
+         * @note not available in Python bindings
+         * @note added in QGIS 2.99
+         */
+        void setDoubleFunction( FcnEvalDouble fcn ) { mDoubleFnc = fcn; }
+
       private:
         QString mName;
         int mParams;
@@ -621,6 +666,7 @@ class CORE_EXPORT QgsExpression
         bool mLazyEval;
         bool mHandlesNull;
         bool mIsContextual; //if true function is only available through an expression context
+        FcnEvalDouble mDoubleFnc;
     };
 
     /** \ingroup core
@@ -994,6 +1040,11 @@ class CORE_EXPORT QgsExpression
         virtual void accept( Visitor& v ) const override { v.visit( *this ); }
         virtual Node* clone() const override;
 
+        /** Applies the operator to an already evaluated operand value.
+         * @note added in QGIS 2.99
+         */
+        QVariant evalValue( QgsExpression* parent, const QVariant& val );
+
       protected:
         UnaryOperator mOp;
         Node* mOperand;
@@ -1028,6 +1079,11 @@ class CORE_EXPORT QgsExpression
         int precedence() const;
         bool leftAssociative() const;
 
+        /** Applies the operator to already evaluated operand values.
+         * @note added in QGIS 2.99
+         */
+        QVariant evalValues( QgsExpression* parent, const QVariant& vL, const QVariant& vR );
+
       protected:
         bool compare( double diff );
         int computeInt( int x, int y );
@@ -1306,6 +1362,18 @@ class CORE_EXPORT QgsExpression
         {}
         ~NodeCondition() { delete mElseExp; qDeleteAll( mConditions ); }
 
+        /** The list of WHEN/THEN pairs of the condition.
+         * @note added in QGIS 2.99
+         * @note not available in Python bindings
+         */
+        const WhenThenList& conditions() const { return mConditions; }
+
+        /** The ELSE expression of the condition, or nullptr if not set.
+         * @note added in QGIS 2.99
+         * @note not available in Python bindings
+         */
+        Node* elseExp() const { return mElseExp; }
+
         virtual NodeType nodeType() const override { return ntCondition; }
         virtual QVariant eval( QgsExpression* parent, const QgsExpressionContext* context ) override;
         virtual bool prepare( QgsExpression* parent, const QgsExpressionContext* context ) override;
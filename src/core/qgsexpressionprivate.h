@@ -21,6 +21,7 @@
 #include <QSharedPointer>
 
 #include "qgsexpression.h"
+#include "qgsexpressionprogram.h"
 #include "qgsdistancearea.h"
 #include "qgsunittypes.h"
 
@@ -36,6 +37,7 @@ class QgsExpressionPrivate
     QgsExpressionPrivate()
         : ref( 1 )
         , mRootNode( nullptr )
+        , mProgram( nullptr )
         , mRowNumber( 0 )
         , mScale( 0 )
         , mCalc( nullptr )
@@ -46,6 +48,7 @@ class QgsExpressionPrivate
     QgsExpressionPrivate( const QgsExpressionPrivate& other )
         : ref( 1 )
         , mRootNode( other.mRootNode ? other.mRootNode->clone() : nullptr )
+        , mProgram( nullptr ) // references the nodes of other, requires a new prepare()
         , mParserErrorString( other.mParserErrorString )
         , mEvalErrorString( other.mEvalErrorString )
         , mRowNumber( 0 )
@@ -58,6 +61,7 @@ class QgsExpressionPrivate
 
     ~QgsExpressionPrivate()
     {
+      delete mProgram;
       delete mRootNode;
     }
 
@@ -65,6 +69,9 @@ class QgsExpressionPrivate
 
     QgsExpression::Node* mRootNode;
 
+    //! Compiled form of mRootNode, created by QgsExpression::prepare()
+    QgsExpressionProgram* mProgram;
+
     QString mParserErrorString;
     QString mEvalErrorString;
 
@@ -0,0 +1,1380 @@
+/***************************************************************************
+                             qgsexpressionprogram.cpp
+                             ------------------------
+    begin                : October 2016
+    copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsexpressionprogram.h"
+#include "qgsexpressioncontext.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+
+#include <QVarLengthArray>
+#include <qmath.h>
+
+#include <math.h>
+#include <limits>
+
+///@cond PRIVATE
+
+// three-value logic, mirrors the tables in qgsexpression.cpp
+
+enum TruthValue
+{
+  tvFalse,
+  tvTrue,
+  tvUnknown
+};
+
+static const TruthValue AND_TABLE[3][3] =
+{
+  // false     true       unknown
+  { tvFalse, tvFalse,   tvFalse },   // false
+  { tvFalse, tvTrue,    tvUnknown }, // true
+  { tvFalse, tvUnknown, tvUnknown }  // unknown
+};
+
+static const TruthValue OR_TABLE[3][3] =
+{
+  { tvFalse,   tvTrue, tvUnknown },  // false
+  { tvTrue,    tvTrue, tvTrue },     // true
+  { tvUnknown, tvTrue, tvUnknown }   // unknown
+};
+
+static const TruthValue NOT_TABLE[3] = { tvTrue, tvFalse, tvUnknown };
+
+// same conversion as getTVLValue() in qgsexpression.cpp
+static TruthValue truthValue( const QgsExpressionProgram::Register& reg, QgsExpression* parent )
+{
+  switch ( reg.kind )
+  {
+    case QgsExpressionProgram::Register::Null:
+      return tvUnknown;
+    case QgsExpressionProgram::Register::Int:
+      return reg.i != 0 ? tvTrue : tvFalse;
+    case QgsExpressionProgram::Register::Double:
+      if ( qIsFinite( reg.d ) )
+        return !qgsDoubleNear( reg.d, 0.0 ) ? tvTrue : tvFalse;
+      break;
+    default:
+      break;
+  }
+
+  QVariant value = reg.toVariant();
+  if ( value.canConvert<QgsGeometry>() )
+  {
+    //geom is false if empty
+    QgsGeometry geom = value.value<QgsGeometry>();
+    return geom.isEmpty() ? tvFalse : tvTrue;
+  }
+  else if ( value.canConvert<QgsFeature>() )
+  {
+    //feat is false if non-valid
+    QgsFeature feat = value.value<QgsFeature>();
+    return feat.isValid() ? tvTrue : tvFalse;
+  }
+
+  if ( value.type() == QVariant::Int )
+    return value.toInt() != 0 ? tvTrue : tvFalse;
+
+  bool ok;
+  double x = value.toDouble( &ok );
+  if ( !ok )
+  {
+    parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to boolean" ).arg( value.toString() ) );
+    return tvUnknown;
+  }
+  return !qgsDoubleNear( x, 0.0 ) ? tvTrue : tvFalse;
+}
+
+static void setTruthValue( QgsExpressionProgram::Register& reg, TruthValue value )
+{
+  switch ( value )
+  {
+    case tvFalse:
+      reg.setInt( 0 );
+      break;
+    case tvTrue:
+      reg.setInt( 1 );
+      break;
+    case tvUnknown:
+      reg.setNull();
+      break;
+  }
+}
+
+static bool compareNumbers( QgsExpression::BinaryOperator op, double diff )
+{
+  switch ( op )
+  {
+    case QgsExpression::boEQ:
+      return qgsDoubleNear( diff, 0.0 );
+    case QgsExpression::boNE:
+      return !qgsDoubleNear( diff, 0.0 );
+    case QgsExpression::boLT:
+      return diff < 0;
+    case QgsExpression::boGT:
+      return diff > 0;
+    case QgsExpression::boLE:
+      return diff <= 0;
+    case QgsExpression::boGE:
+      return diff >= 0;
+    default:
+      Q_ASSERT( false );
+      return false;
+  }
+}
+
+static int computeInt( QgsExpression::BinaryOperator op, int x, int y )
+{
+  switch ( op )
+  {
+    case QgsExpression::boPlus:
+      return x + y;
+    case QgsExpression::boMinus:
+      return x - y;
+    case QgsExpression::boMul:
+      return x * y;
+    case QgsExpression::boMod:
+      return x % y;
+    default:
+      Q_ASSERT( false );
+      return 0;
+  }
+}
+
+static double computeDouble( QgsExpression::BinaryOperator op, double x, double y )
+{
+  switch ( op )
+  {
+    case QgsExpression::boPlus:
+      return x + y;
+    case QgsExpression::boMinus:
+      return x - y;
+    case QgsExpression::boMul:
+      return x * y;
+    case QgsExpression::boDiv:
+      return x / y;
+    case QgsExpression::boMod:
+      return fmod( x, y );
+    default:
+      Q_ASSERT( false );
+      return 0;
+  }
+}
+
+// same rules as isDoubleSafe() in qgsexpression.cpp
+static bool isDoubleSafe( const QVariant& value, double& number )
+{
+  switch ( value.type() )
+  {
+    case QVariant::Double:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+      number = value.toDouble();
+      return true;
+    case QVariant::String:
+    {
+      bool ok;
+      number = value.toString().toDouble( &ok );
+      return ok && qIsFinite( number ) && !qIsNaN( number );
+    }
+    default:
+      return false;
+  }
+}
+
+//
+// QgsExpressionProgram::Register
+//
+
+void QgsExpressionProgram::Register::setVariant( const QVariant& value )
+{
+  v = value;
+  hasVariant = true;
+
+  if ( value.isNull() )
+  {
+    kind = Null;
+    return;
+  }
+
+  switch ( value.type() )
+  {
+    case QVariant::Int:
+      kind = Int;
+      i = value.toInt();
+      d = i;
+      return;
+
+    // the node tree treats all integer types as int, and fails on values out of the int range:
+    // only values in that range take the int path, the others are left to the node tree.
+    // Unsigned values are checked unsigned, as converting them to qint64 wraps large values.
+    case QVariant::UInt:
+      if ( value.toUInt() <= static_cast< uint >( std::numeric_limits<int>::max() ) )
+      {
+        kind = Int;
+        i = static_cast< int >( value.toUInt() );
+        d = i;
+        return;
+      }
+      break;
+
+    case QVariant::LongLong:
+    {
+      qint64 x = value.toLongLong();
+      if ( x >= std::numeric_limits<int>::min() && x <= std::numeric_limits<int>::max() )
+      {
+        kind = Int;
+        i = static_cast< int >( x );
+        d = i;
+        return;
+      }
+      break;
+    }
+
+    case QVariant::ULongLong:
+      if ( value.toULongLong() <= static_cast< quint64 >( std::numeric_limits<int>::max() ) )
+      {
+        kind = Int;
+        i = static_cast< int >( value.toULongLong() );
+        d = i;
+        return;
+      }
+      break;
+
+    case QVariant::Double:
+      d = value.toDouble();
+      if ( qIsFinite( d ) )
+      {
+        kind = Double;
+        return;
+      }
+      break;
+
+    case QVariant::String:
+      kind = String;
+      return;
+
+    default:
+      break;
+  }
+
+  kind = Variant;
+}
+
+QVariant QgsExpressionProgram::Register::toVariant() const
+{
+  if ( hasVariant )
+    return v;
+
+  switch ( kind )
+  {
+    case Int:
+      return QVariant( i );
+    case Double:
+      return QVariant( d );
+    default:
+      return QVariant();
+  }
+}
+
+//
+// QgsExpressionProgram::Column
+//
+
+QgsExpressionProgram::Register QgsExpressionProgram::Column::row( int i ) const
+{
+  if ( !dense )
+    return values.at( i );
+
+  Register reg;
+  if ( allInt )
+    reg.setInt( static_cast< int >( numbers.at( i ) ) );
+  else
+    reg.setDouble( numbers.at( i ) );
+  return reg;
+}
+
+void QgsExpressionProgram::Column::detachRows( int count )
+{
+  if ( dense )
+  {
+    QVector<Register> rows( count );
+    for ( int i = 0; i < count; ++i )
+      rows[i] = row( i );
+    values = rows;
+    numbers.clear();
+    dense = false;
+    allInt = false;
+  }
+  else if ( values.count() != count )
+  {
+    values.resize( count );
+  }
+}
+
+void QgsExpressionProgram::Column::compact()
+{
+  if ( dense || values.isEmpty() )
+    return;
+
+  const Register::Kind kind = values.at( 0 ).kind;
+  if ( kind != Register::Int && kind != Register::Double )
+    return;
+
+  // only keep values which are reproduced exactly by row(), i.e. plain ints and finite doubles
+  const QVariant::Type type = kind == Register::Int ? QVariant::Int : QVariant::Double;
+  QVector<double> rows( values.count() );
+  for ( int i = 0; i < values.count(); ++i )
+  {
+    const Register& reg = values.at( i );
+    if ( reg.kind != kind || ( reg.hasVariant && reg.v.type() != type ) )
+      return;
+    if ( kind == Register::Int )
+    {
+      rows[i] = reg.i;
+    }
+    else
+    {
+      if ( !qIsFinite( reg.d ) )
+        return;
+      rows[i] = reg.d;
+    }
+  }
+
+  numbers = rows;
+  values.clear();
+  dense = true;
+  allInt = kind == Register::Int;
+}
+
+void QgsExpressionProgram::Column::fill( const Register& value, int count )
+{
+  values = QVector<Register>( count, value );
+  numbers.clear();
+  dense = false;
+  allInt = false;
+  compact();
+}
+
+void QgsExpressionProgram::Column::setNumbers( const QVector<double>& result, bool isInt )
+{
+  numbers = result;
+  values.clear();
+  dense = true;
+  allInt = isInt;
+
+  if ( isInt )
+    return;
+
+  const double* x = numbers.constData();
+  const int count = numbers.count();
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( !qIsFinite( x[i] ) )
+    {
+      detachRows( count );
+      return;
+    }
+  }
+}
+
+//
+// QgsExpressionProgram
+//
+
+QgsExpressionProgram::QgsExpressionProgram()
+    : mRegisterCount( 0 )
+    , mUsesFeature( false )
+{
+}
+
+int QgsExpressionProgram::addConstant( const QVariant& value )
+{
+  Register reg;
+  reg.setVariant( value );
+  mConstants.append( reg );
+  return mConstants.count() - 1;
+}
+
+QgsExpressionProgram* QgsExpressionProgram::compile( QgsExpression* parent, QgsExpression::Node* root, const QgsExpressionContext* context )
+{
+  if ( !root )
+    return nullptr;
+
+  QgsExpressionProgram* program = new QgsExpressionProgram();
+  int dest = program->allocateRegister();
+  if ( !program->compileNode( parent, root, dest, context )
+       || ( program->mInstructions.count() == 1 && program->mInstructions.at( 0 ).op == EvalNode ) )
+  {
+    // nothing to gain over the tree walker
+    delete program;
+    return nullptr;
+  }
+
+  return program;
+}
+
+QgsExpression::FcnEvalDouble QgsExpressionProgram::typedFunction( const QgsExpression::NodeFunction* node, const QgsExpressionContext* context ) const
+{
+  QgsExpression::Function* fd = QgsExpression::Functions()[node->fnIndex()];
+  if ( !fd->doubleFunction() || fd->lazyEval() || fd->handlesNull() || fd->isContextual() )
+    return nullptr;
+
+  // the context may override the function with its own implementation
+  if ( context && context->hasFunction( fd->name() ) )
+    return nullptr;
+
+  int argCount = node->args() ? node->args()->count() : 0;
+  if ( argCount != fd->params() )
+    return nullptr;
+
+  return fd->doubleFunction();
+}
+
+bool QgsExpressionProgram::isConstant( const QgsExpression::Node* node, const QgsExpressionContext* context ) const
+{
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+      return true;
+
+    case QgsExpression::ntUnaryOperator:
+      return isConstant( static_cast<const QgsExpression::NodeUnaryOperator*>( node )->operand(), context );
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      const QgsExpression::NodeBinaryOperator* n = static_cast<const QgsExpression::NodeBinaryOperator*>( node );
+      return isConstant( n->opLeft(), context ) && isConstant( n->opRight(), context );
+    }
+
+    case QgsExpression::ntInOperator:
+    {
+      const QgsExpression::NodeInOperator* n = static_cast<const QgsExpression::NodeInOperator*>( node );
+      if ( !isConstant( n->node(), context ) )
+        return false;
+      Q_FOREACH ( const QgsExpression::Node* item, n->list()->list() )
+      {
+        if ( !isConstant( item, context ) )
+          return false;
+      }
+      return true;
+    }
+
+    case QgsExpression::ntFunction:
+    {
+      // only typed functions are known to be free of side effects
+      const QgsExpression::NodeFunction* n = static_cast<const QgsExpression::NodeFunction*>( node );
+      if ( !typedFunction( n, context ) )
+        return false;
+      if ( n->args() )
+      {
+        Q_FOREACH ( const QgsExpression::Node* arg, n->args()->list() )
+        {
+          if ( !isConstant( arg, context ) )
+            return false;
+        }
+      }
+      return true;
+    }
+
+    case QgsExpression::ntCondition:
+    {
+      const QgsExpression::NodeCondition* n = static_cast<const QgsExpression::NodeCondition*>( node );
+      Q_FOREACH ( const QgsExpression::WhenThen* cond, n->conditions() )
+      {
+        if ( !isConstant( cond->mWhenExp, context ) || !isConstant( cond->mThenExp, context ) )
+          return false;
+      }
+      return !n->elseExp() || isConstant( n->elseExp(), context );
+    }
+
+    case QgsExpression::ntColumnRef:
+      return false;
+  }
+  return false;
+}
+
+bool QgsExpressionProgram::compileNode( QgsExpression* parent, QgsExpression::Node* node, int dest, const QgsExpressionContext* context )
+{
+  if ( node->nodeType() != QgsExpression::ntLiteral && isConstant( node, context ) )
+  {
+    // constant folding. Subtrees which fail to evaluate are left in the program
+    // so that the error is reported at evaluation time
+    QVariant value = node->eval( parent, static_cast<const QgsExpressionContext*>( nullptr ) );
+    if ( !parent->hasEvalError() )
+    {
+      addInstruction( Instruction( LoadConstant, dest, addConstant( value ) ) );
+      return true;
+    }
+    parent->setEvalErrorString( QString() );
+  }
+
+  switch ( node->nodeType() )
+  {
+    case QgsExpression::ntLiteral:
+      addInstruction( Instruction( LoadConstant, dest, addConstant( static_cast<QgsExpression::NodeLiteral*>( node )->value() ) ) );
+      return true;
+
+    case QgsExpression::ntColumnRef:
+    {
+      QgsExpression::NodeColumnRef* n = static_cast<QgsExpression::NodeColumnRef*>( node );
+      int index = -1;
+      if ( context && context->hasVariable( QgsExpressionContext::EXPR_FIELDS ) )
+      {
+        QgsFields fields = qvariant_cast<QgsFields>( context->variable( QgsExpressionContext::EXPR_FIELDS ) );
+        index = fields.fieldNameIndex( n->name() );
+      }
+      if ( index < 0 )
+        break;
+
+      mUsesFeature = true;
+      mNames << n->name();
+      addInstruction( Instruction( LoadField, dest, index, mNames.count() - 1 ) );
+      return true;
+    }
+
+    case QgsExpression::ntUnaryOperator:
+    {
+      QgsExpression::NodeUnaryOperator* n = static_cast<QgsExpression::NodeUnaryOperator*>( node );
+      int operand = allocateRegister();
+      if ( !compileNode( parent, n->operand(), operand, context ) )
+        return false;
+      addInstruction( Instruction( UnaryOp, dest, operand, -1, node ) );
+      return true;
+    }
+
+    case QgsExpression::ntBinaryOperator:
+    {
+      QgsExpression::NodeBinaryOperator* n = static_cast<QgsExpression::NodeBinaryOperator*>( node );
+      int left = allocateRegister();
+      int right = allocateRegister();
+      if ( !compileNode( parent, n->opLeft(), left, context ) || !compileNode( parent, n->opRight(), right, context ) )
+        return false;
+      addInstruction( Instruction( BinaryOp, dest, left, right, node ) );
+      return true;
+    }
+
+    case QgsExpression::ntInOperator:
+      return compileIn( parent, static_cast<QgsExpression::NodeInOperator*>( node ), dest, context );
+
+    case QgsExpression::ntFunction:
+      return compileFunction( parent, static_cast<QgsExpression::NodeFunction*>( node ), dest, context );
+
+    case QgsExpression::ntCondition:
+      return compileCondition( parent, static_cast<QgsExpression::NodeCondition*>( node ), dest, context );
+  }
+
+  // fall back to the tree walker for this subtree
+  addInstruction( Instruction( EvalNode, dest, -1, -1, node ) );
+  return true;
+}
+
+bool QgsExpressionProgram::compileFunction( QgsExpression* parent, QgsExpression::NodeFunction* node, int dest, const QgsExpressionContext* context )
+{
+  QgsExpression::FcnEvalDouble fnc = typedFunction( node, context );
+  if ( !fnc )
+  {
+    addInstruction( Instruction( EvalNode, dest, -1, -1, node ) );
+    return true;
+  }
+
+  // arguments live in consecutive registers
+  int argCount = node->args() ? node->args()->count() : 0;
+  int base = mRegisterCount;
+  mRegisterCount += argCount;
+
+  // like the tree walker, the function returns NULL as soon as an argument is NULL
+  QList<int> nullJumps;
+  for ( int i = 0; i < argCount; ++i )
+  {
+    if ( !compileNode( parent, node->args()->list().at( i ), base + i, context ) )
+      return false;
+
+    const Instruction& last = mInstructions.last();
+    if ( last.op != LoadConstant || mConstants.at( last.a ).kind == Register::Null )
+      nullJumps << addInstruction( Instruction( JumpIfNull, -1, base + i ) );
+  }
+
+  Instruction call( CallDouble, dest, base, argCount, node );
+  call.fnc = fnc;
+  addInstruction( call );
+
+  if ( !nullJumps.isEmpty() )
+  {
+    int jumpEnd = addInstruction( Instruction( Jump ) );
+    int nullLabel = mInstructions.count();
+    addInstruction( Instruction( LoadConstant, dest, addConstant( QVariant() ) ) );
+    Q_FOREACH ( int jump, nullJumps )
+      mInstructions[jump].b = nullLabel;
+    mInstructions[jumpEnd].b = mInstructions.count();
+  }
+  return true;
+}
+
+bool QgsExpressionProgram::compileCondition( QgsExpression* parent, QgsExpression::NodeCondition* node, int dest, const QgsExpressionContext* context )
+{
+  QList<int> endJumps;
+  Q_FOREACH ( QgsExpression::WhenThen* cond, node->conditions() )
+  {
+    int when = allocateRegister();
+    if ( !compileNode( parent, cond->mWhenExp, when, context ) )
+      return false;
+    int skip = addInstruction( Instruction( JumpIfNotTrue, -1, when ) );
+    if ( !compileNode( parent, cond->mThenExp, dest, context ) )
+      return false;
+    endJumps << addInstruction( Instruction( Jump ) );
+    mInstructions[skip].b = mInstructions.count();
+  }
+
+  if ( node->elseExp() )
+  {
+    if ( !compileNode( parent, node->elseExp(), dest, context ) )
+      return false;
+  }
+  else
+  {
+    // NULL if no condition is matching
+    addInstruction( Instruction( LoadConstant, dest, addConstant( QVariant() ) ) );
+  }
+
+  Q_FOREACH ( int jump, endJumps )
+    mInstructions[jump].b = mInstructions.count();
+  return true;
+}
+
+bool QgsExpressionProgram::compileIn( QgsExpression* parent, QgsExpression::NodeInOperator* node, int dest, const QgsExpressionContext* context )
+{
+  // only lists of literals are lowered, other lists keep the lazy item evaluation of the tree
+  bool literalList = node->list()->count() > 0;
+  Q_FOREACH ( QgsExpression::Node* item, node->list()->list() )
+  {
+    if ( item->nodeType() != QgsExpression::ntLiteral )
+    {
+      literalList = false;
+      break;
+    }
+  }
+
+  if ( !literalList )
+  {
+    addInstruction( Instruction( EvalNode, dest, -1, -1, node ) );
+    return true;
+  }
+
+  QVector<ListConstant> constants;
+  constants.reserve( node->list()->count() );
+  Q_FOREACH ( QgsExpression::Node* item, node->list()->list() )
+  {
+    QVariant value = static_cast<QgsExpression::NodeLiteral*>( item )->value();
+    ListConstant c;
+    c.isNull = value.isNull();
+    c.number = 0;
+    c.doubleSafe = !c.isNull && isDoubleSafe( value, c.number );
+    c.string = value.toString();
+    constants << c;
+  }
+  mConstantLists << constants;
+
+  int value = allocateRegister();
+  if ( !compileNode( parent, node->node(), value, context ) )
+    return false;
+
+  addInstruction( Instruction( InConstants, dest, value, mConstantLists.count() - 1, node ) );
+  return true;
+}
+
+QVariant QgsExpressionProgram::evaluate( QgsExpression* parent, const QgsExpressionContext* context ) const
+{
+  QVarLengthArray<Register, 32> regs( mRegisterCount );
+
+  // fetch the feature once instead of once per column reference
+  QgsFeature feature;
+  bool hasFeature = false;
+  if ( mUsesFeature && context && context->hasVariable( QgsExpressionContext::EXPR_FEATURE ) )
+  {
+    feature = qvariant_cast<QgsFeature>( context->variable( QgsExpressionContext::EXPR_FEATURE ) );
+    hasFeature = true;
+  }
+
+  const Instruction* code = mInstructions.constData();
+  const int count = mInstructions.count();
+  int pc = 0;
+  while ( pc < count )
+  {
+    const Instruction& ins = code[pc++];
+    switch ( ins.op )
+    {
+      case LoadConstant:
+        regs[ins.dest] = mConstants.at( ins.a );
+        break;
+
+      case LoadField:
+        if ( hasFeature )
+          regs[ins.dest].setVariant( feature.attribute( ins.a ) );
+        else
+          regs[ins.dest].setString( '[' + mNames.at( ins.b ) + ']' );
+        break;
+
+      case UnaryOp:
+        if ( !evalUnary( parent, ins, regs.data() ) )
+          return QVariant();
+        break;
+
+      case BinaryOp:
+        if ( !evalBinary( parent, ins, regs.data() ) )
+          return QVariant();
+        break;
+
+      case InConstants:
+        if ( !evalIn( parent, ins, regs.data(), context ) )
+          return QVariant();
+        break;
+
+      case CallDouble:
+        if ( !evalCall( parent, ins, regs.data() ) )
+          return QVariant();
+        break;
+
+      case EvalNode:
+        regs[ins.dest].setVariant( ins.node->eval( parent, context ) );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        break;
+
+      case JumpIfNull:
+        if ( regs[ins.a].kind == Register::Null )
+          pc = ins.b;
+        break;
+
+      case JumpIfNotTrue:
+      {
+        TruthValue tvl = truthValue( regs[ins.a], parent );
+        if ( parent->hasEvalError() )
+          return QVariant();
+        if ( tvl != tvTrue )
+          pc = ins.b;
+        break;
+      }
+
+      case Jump:
+        pc = ins.b;
+        break;
+    }
+  }
+
+  return regs[0].toVariant();
+}
+
+bool QgsExpressionProgram::evalUnary( QgsExpression* parent, const Instruction& ins, Register* regs ) const
+{
+  QgsExpression::NodeUnaryOperator* node = static_cast<QgsExpression::NodeUnaryOperator*>( ins.node );
+  const Register& val = regs[ins.a];
+  Register& out = regs[ins.dest];
+
+  switch ( node->op() )
+  {
+    case QgsExpression::uoNot:
+    {
+      TruthValue tvl = truthValue( val, parent );
+      if ( parent->hasEvalError() )
+        return false;
+      setTruthValue( out, NOT_TABLE[tvl] );
+      return true;
+    }
+
+    case QgsExpression::uoMinus:
+      if ( val.kind == Register::Int )
+      {
+        out.setInt( -val.i );
+        return true;
+      }
+      else if ( val.isNumeric() )
+      {
+        out.setDouble( -val.d );
+        return true;
+      }
+      break;
+  }
+
+  out.setVariant( node->evalValue( parent, val.toVariant() ) );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalBinary( QgsExpression* parent, const Instruction& ins, Register* regs ) const
+{
+  QgsExpression::NodeBinaryOperator* node = static_cast<QgsExpression::NodeBinaryOperator*>( ins.node );
+  const QgsExpression::BinaryOperator op = node->op();
+  const Register& l = regs[ins.a];
+  const Register& r = regs[ins.b];
+  Register& out = regs[ins.dest];
+
+  if ( op == QgsExpression::boAnd || op == QgsExpression::boOr )
+  {
+    TruthValue tvlL = truthValue( l, parent );
+    TruthValue tvlR = truthValue( r, parent );
+    if ( parent->hasEvalError() )
+      return false;
+    setTruthValue( out, op == QgsExpression::boAnd ? AND_TABLE[tvlL][tvlR] : OR_TABLE[tvlL][tvlR] );
+    return true;
+  }
+
+  if ( l.isNumeric() && r.isNumeric() )
+  {
+    switch ( op )
+    {
+      case QgsExpression::boPlus:
+      case QgsExpression::boMinus:
+      case QgsExpression::boMul:
+      case QgsExpression::boDiv:
+      case QgsExpression::boMod:
+        if ( op != QgsExpression::boDiv && l.kind == Register::Int && r.kind == Register::Int )
+        {
+          // both are integers - let's use integer arithmetics
+          if ( op == QgsExpression::boMod && r.i == 0 )
+            out.setNull();
+          else
+            out.setInt( computeInt( op, l.i, r.i ) );
+        }
+        else if (( op == QgsExpression::boDiv || op == QgsExpression::boMod ) && r.d == 0. )
+          out.setNull(); // silently handle division by zero and return NULL
+        else
+          out.setDouble( computeDouble( op, l.d, r.d ) );
+        return true;
+
+      case QgsExpression::boIntDiv:
+        if ( r.d == 0. )
+          out.setNull();
+        else
+          out.setInt( qFloor( l.d / r.d ) );
+        return true;
+
+      case QgsExpression::boPow:
+        out.setDouble( pow( l.d, r.d ) );
+        return true;
+
+      case QgsExpression::boEQ:
+      case QgsExpression::boNE:
+      case QgsExpression::boLT:
+      case QgsExpression::boGT:
+      case QgsExpression::boLE:
+      case QgsExpression::boGE:
+        setTruthValue( out, compareNumbers( op, l.d - r.d ) ? tvTrue : tvFalse );
+        return true;
+
+      case QgsExpression::boIs:
+      case QgsExpression::boIsNot:
+      {
+        bool equal = qgsDoubleNear( l.d, r.d );
+        setTruthValue( out, equal == ( op == QgsExpression::boIs ) ? tvTrue : tvFalse );
+        return true;
+      }
+
+      default:
+        break;
+    }
+  }
+  else if ( l.kind == Register::String && r.kind == Register::String )
+  {
+    switch ( op )
+    {
+      case QgsExpression::boPlus:
+      case QgsExpression::boConcat:
+        out.setString( l.v.toString() + r.v.toString() );
+        return true;
+
+      case QgsExpression::boEQ:
+      case QgsExpression::boNE:
+      case QgsExpression::boLT:
+      case QgsExpression::boGT:
+      case QgsExpression::boLE:
+      case QgsExpression::boGE:
+        setTruthValue( out, compareNumbers( op, QString::compare( l.v.toString(), r.v.toString() ) ) ? tvTrue : tvFalse );
+        return true;
+
+      case QgsExpression::boIs:
+      case QgsExpression::boIsNot:
+      {
+        bool equal = QString::compare( l.v.toString(), r.v.toString() ) == 0;
+        setTruthValue( out, equal == ( op == QgsExpression::boIs ) ? tvTrue : tvFalse );
+        return true;
+      }
+
+      default:
+        break;
+    }
+  }
+
+  // NULLs, dates, intervals, regular expressions... are handled by the tree operator
+  QVariant result = node->evalValues( parent, l.toVariant(), r.toVariant() );
+  out.setVariant( result );
+  return !parent->hasEvalError();
+}
+
+bool QgsExpressionProgram::evalIn( QgsExpression* parent, const Instruction& ins, Register* regs, const QgsExpressionContext* context ) const
+{
+  QgsExpression::NodeInOperator* node = static_cast<QgsExpression::NodeInOperator*>( ins.node );
+  const Register& value = regs[ins.a];
+  Register& out = regs[ins.dest];
+
+  double number = 0;
+  bool valueDoubleSafe = false;
+  switch ( value.kind )
+  {
+    case Register::Null:
+      out.setNull();
+      return true;
+
+    case Register::Int:
+      number = value.d;
+      valueDoubleSafe = true;
+      break;
+
+    case Register::Double:
+      if ( !value.isNumeric() )
+      {
+        out.setVariant( node->eval( parent, context ) );
+        return !parent->hasEvalError();
+      }
+      number = value.d;
+      valueDoubleSafe = true;
+      break;
+
+    case Register::String:
+      valueDoubleSafe = isDoubleSafe( value.v, number );
+      break;
+
+    case Register::Variant:
+      // rare value types keep the exact conversion rules of the tree
+      out.setVariant( node->eval( parent, context ) );
+      return !parent->hasEvalError();
+  }
+
+  QString valueString;
+  bool hasValueString = false;
+  bool listHasNull = false;
+  Q_FOREACH ( const ListConstant& c, mConstantLists.at( ins.b ) )
+  {
+    if ( c.isNull )
+    {
+      listHasNull = true;
+      continue;
+    }
+
+    bool equal;
+    if ( valueDoubleSafe && c.doubleSafe )
+    {
+      equal = qgsDoubleNear( number, c.number );
+    }
+    else
+    {
+      if ( !hasValueString )
+      {
+        valueString = value.toVariant().toString();
+        hasValueString = true;
+      }
+      equal = QString::compare( valueString, c.string ) == 0;
+    }
+
+    if ( equal ) // we know the result
+    {
+      setTruthValue( out, node->isNotIn() ? tvFalse : tvTrue );
+      return true;
+    }
+  }
+
+  // item not found
+  if ( listHasNull )
+    out.setNull();
+  else
+    setTruthValue( out, node->isNotIn() ? tvTrue : tvFalse );
+  return true;
+}
+
+bool QgsExpressionProgram::evalCall( QgsExpression* parent, const Instruction& ins, Register* regs ) const
+{
+  QVarLengthArray<double, 8> args( qMax( ins.b, 1 ) );
+  for ( int i = 0; i < ins.b; ++i )
+  {
+    const Register& arg = regs[ins.a + i];
+    if ( arg.isNumeric() )
+    {
+      args[i] = arg.d;
+      continue;
+    }
+
+    // same conversion and error as getDoubleValue() in qgsexpression.cpp
+    QVariant value = arg.toVariant();
+    bool ok;
+    double x = value.toDouble( &ok );
+    if ( !ok || qIsNaN( x ) || !qIsFinite( x ) )
+    {
+      parent->setEvalErrorString( QObject::tr( "Cannot convert '%1' to double" ).arg( value.toString() ) );
+      x = 0;
+    }
+    args[i] = x;
+  }
+
+  if ( parent->hasEvalError() )
+    return false;
+
+  double result;
+  if ( ins.fnc( args.constData(), result ) )
+    regs[ins.dest].setDouble( result );
+  else
+    regs[ins.dest].setNull();
+  return true;
+}
+
+QVector<QVariant> QgsExpressionProgram::evaluateBatch( QgsExpression* parent, QgsExpressionContext* context, const QgsFeatureList& features ) const
+{
+  const int count = features.count();
+  QVector<QVariant> results( count );
+  if ( count == 0 )
+    return results;
+
+  QVector<Column> columns( mRegisterCount );
+
+  // jumps only go forward: a row takes part in an instruction once the instruction
+  // index reaches the row's resume index
+  QVector<int> resume( count, 0 );
+  QVector<bool> failed( count, false );
+  QString firstError;
+
+  const int instructionCount = mInstructions.count();
+  for ( int pc = 0; pc < instructionCount; ++pc )
+  {
+    const Instruction& ins = mInstructions.at( pc );
+
+    bool allActive = true;
+    for ( int i = 0; i < count && allActive; ++i )
+      allActive = !failed.at( i ) && resume.at( i ) <= pc;
+
+    if ( allActive && evalDense( ins, columns, count ) )
+      continue;
+
+    if ( ins.dest >= 0 )
+      columns[ins.dest].detachRows( count );
+
+    for ( int i = 0; i < count; ++i )
+    {
+      if ( failed.at( i ) || resume.at( i ) > pc )
+        continue;
+
+      switch ( ins.op )
+      {
+        case JumpIfNull:
+          if ( columns.at( ins.a ).row( i ).kind == Register::Null )
+            resume[i] = ins.b;
+          break;
+
+        case JumpIfNotTrue:
+        {
+          TruthValue tvl = truthValue( columns.at( ins.a ).row( i ), parent );
+          if ( !parent->hasEvalError() && tvl != tvTrue )
+            resume[i] = ins.b;
+          break;
+        }
+
+        case Jump:
+          resume[i] = ins.b;
+          break;
+
+        default:
+          evalRow( parent, ins, columns, i, context, features.at( i ) );
+          break;
+      }
+
+      if ( parent->hasEvalError() )
+      {
+        // keep going with the other rows, the first error is reported
+        if ( firstError.isNull() )
+          firstError = parent->evalErrorString();
+        parent->setEvalErrorString( QString() );
+        failed[i] = true;
+      }
+    }
+
+    if ( ins.dest >= 0 )
+      columns[ins.dest].compact();
+  }
+
+  const Column& result = columns.at( 0 );
+  for ( int i = 0; i < count; ++i )
+  {
+    if ( !failed.at( i ) )
+      results[i] = result.row( i ).toVariant();
+  }
+
+  if ( !firstError.isNull() )
+    parent->setEvalErrorString( firstError );
+  return results;
+}
+
+bool QgsExpressionProgram::evalDense( const Instruction& ins, QVector<Column>& columns, int count ) const
+{
+  switch ( ins.op )
+  {
+    case LoadConstant:
+      columns[ins.dest].fill( mConstants.at( ins.a ), count );
+      return true;
+
+    case UnaryOp:
+    {
+      const Column& val = columns.at( ins.a );
+      if ( !val.dense )
+        return false;
+
+      const double* x = val.numbers.constData();
+      QVector<double> result( count );
+      double* z = result.data();
+      if ( static_cast<QgsExpression::NodeUnaryOperator*>( ins.node )->op() == QgsExpression::uoMinus )
+      {
+        for ( int i = 0; i < count; ++i )
+          z[i] = -x[i];
+        columns[ins.dest].setNumbers( result, val.allInt );
+      }
+      else
+      {
+        for ( int i = 0; i < count; ++i )
+          z[i] = qgsDoubleNear( x[i], 0.0 ) ? 1 : 0;
+        columns[ins.dest].setNumbers( result, true );
+      }
+      return true;
+    }
+
+    case BinaryOp:
+    {
+      const Column& l = columns.at( ins.a );
+      const Column& r = columns.at( ins.b );
+      if ( !l.dense || !r.dense )
+        return false;
+
+      const QgsExpression::BinaryOperator op = static_cast<QgsExpression::NodeBinaryOperator*>( ins.node )->op();
+      const bool ints = l.allInt && r.allInt;
+      const double* x = l.numbers.constData();
+      const double* y = r.numbers.constData();
+
+      if ( op == QgsExpression::boDiv || op == QgsExpression::boMod || op == QgsExpression::boIntDiv )
+      {
+        // division by zero gives NULL, leave these blocks to the scalar path
+        for ( int i = 0; i < count; ++i )
+        {
+          if ( y[i] == 0. )
+            return false;
+        }
+      }
+
+      QVector<double> result( count );
+      double* z = result.data();
+      bool isInt = true;
+      switch ( op )
+      {
+        case QgsExpression::boPlus:
+        case QgsExpression::boMinus:
+        case QgsExpression::boMul:
+        case QgsExpression::boMod:
+          if ( ints )
+          {
+            // integer arithmetics, same as the scalar path
+            for ( int i = 0; i < count; ++i )
+              z[i] = computeInt( op, static_cast< int >( x[i] ), static_cast< int >( y[i] ) );
+          }
+          else if ( op == QgsExpression::boPlus )
+          {
+            for ( int i = 0; i < count; ++i )
+              z[i] = x[i] + y[i];
+            isInt = false;
+          }
+          else if ( op == QgsExpression::boMinus )
+          {
+            for ( int i = 0; i < count; ++i )
+              z[i] = x[i] - y[i];
+            isInt = false;
+          }
+          else if ( op == QgsExpression::boMul )
+          {
+            for ( int i = 0; i < count; ++i )
+              z[i] = x[i] * y[i];
+            isInt = false;
+          }
+          else
+          {
+            for ( int i = 0; i < count; ++i )
+              z[i] = fmod( x[i], y[i] );
+            isInt = false;
+          }
+          break;
+
+        case QgsExpression::boDiv:
+          for ( int i = 0; i < count; ++i )
+            z[i] = x[i] / y[i];
+          isInt = false;
+          break;
+
+        case QgsExpression::boIntDiv:
+          for ( int i = 0; i < count; ++i )
+            z[i] = qFloor( x[i] / y[i] );
+          break;
+
+        case QgsExpression::boPow:
+          for ( int i = 0; i < count; ++i )
+            z[i] = pow( x[i], y[i] );
+          isInt = false;
+          break;
+
+        case QgsExpression::boEQ:
+        case QgsExpression::boNE:
+        case QgsExpression::boLT:
+        case QgsExpression::boGT:
+        case QgsExpression::boLE:
+        case QgsExpression::boGE:
+          for ( int i = 0; i < count; ++i )
+            z[i] = compareNumbers( op, x[i] - y[i] ) ? 1 : 0;
+          break;
+
+        case QgsExpression::boIs:
+        case QgsExpression::boIsNot:
+        {
+          const double match = op == QgsExpression::boIs ? 1 : 0;
+          for ( int i = 0; i < count; ++i )
+            z[i] = qgsDoubleNear( x[i], y[i] ) ? match : 1 - match;
+          break;
+        }
+
+        case QgsExpression::boAnd:
+          for ( int i = 0; i < count; ++i )
+            z[i] = !qgsDoubleNear( x[i], 0.0 ) && !qgsDoubleNear( y[i], 0.0 ) ? 1 : 0;
+          break;
+
+        case QgsExpression::boOr:
+          for ( int i = 0; i < count; ++i )
+            z[i] = !qgsDoubleNear( x[i], 0.0 ) || !qgsDoubleNear( y[i], 0.0 ) ? 1 : 0;
+          break;
+
+        default:
+          return false;
+      }
+
+      columns[ins.dest].setNumbers( result, isInt );
+      return true;
+    }
+
+    case CallDouble:
+    {
+      QVarLengthArray<const double*, 8> args( qMax( ins.b, 1 ) );
+      for ( int k = 0; k < ins.b; ++k )
+      {
+        const Column& arg = columns.at( ins.a + k );
+        if ( !arg.dense )
+          return false;
+        args[k] = arg.numbers.constData();
+      }
+
+      QVarLengthArray<double, 8> rowArgs( qMax( ins.b, 1 ) );
+      QVector<double> result( count );
+      double* z = result.data();
+      for ( int i = 0; i < count; ++i )
+      {
+        for ( int k = 0; k < ins.b; ++k )
+          rowArgs[k] = args[k][i];
+        // NULL results are left to the scalar path
+        if ( !ins.fnc( rowArgs.constData(), z[i] ) )
+          return false;
+      }
+      columns[ins.dest].setNumbers( result, false );
+      return true;
+    }
+
+    default:
+      return false;
+  }
+}
+
+bool QgsExpressionProgram::evalRow( QgsExpression* parent, const Instruction& ins, QVector<Column>& columns, int row, QgsExpressionContext* context, const QgsFeature& feature ) const
+{
+  // the scalar evaluators work on a small local register file: inputs first, result last
+  Register& out = columns[ins.dest].values[row];
+  Instruction local( ins );
+
+  switch ( ins.op )
+  {
+    case LoadConstant:
+      out = mConstants.at( ins.a );
+      return true;
+
+    case LoadField:
+      out.setVariant( feature.attribute( ins.a ) );
+      return true;
+
+    case UnaryOp:
+    {
+      Register regs[2];
+      regs[0] = columns.at( ins.a ).row( row );
+      local.a = 0;
+      local.dest = 1;
+      bool ok = evalUnary( parent, local, regs );
+      out = regs[1];
+      return ok;
+    }
+
+    case BinaryOp:
+    {
+      Register regs[3];
+      regs[0] = columns.at( ins.a ).row( row );
+      regs[1] = columns.at( ins.b ).row( row );
+      local.a = 0;
+      local.b = 1;
+      local.dest = 2;
+      bool ok = evalBinary( parent, local, regs );
+      out = regs[2];
+      return ok;
+    }
+
+    case InConstants:
+    {
+      Register regs[2];
+      regs[0] = columns.at( ins.a ).row( row );
+      if ( regs[0].kind == Register::Variant || ( regs[0].kind == Register::Double && !regs[0].isNumeric() ) )
+        context->setFeature( feature ); // evaluated by the node tree
+      local.a = 0;
+      local.dest = 1;
+      bool ok = evalIn( parent, local, regs, context );
+      out = regs[1];
+      return ok;
+    }
+
+    case CallDouble:
+    {
+      QVarLengthArray<Register, 8> regs( ins.b + 1 );
+      for ( int k = 0; k < ins.b; ++k )
+        regs[k] = columns.at( ins.a + k ).row( row );
+      local.a = 0;
+      local.dest = ins.b;
+      bool ok = evalCall( parent, local, regs.data() );
+      out = regs[ins.b];
+      return ok;
+    }
+
+    case EvalNode:
+      context->setFeature( feature );
+      out.setVariant( ins.node->eval( parent, context ) );
+      return !parent->hasEvalError();
+
+    default:
+      return true;
+  }
+}
+
+///@endcond
@@ -0,0 +1,231 @@
+/***************************************************************************
+                             qgsexpressionprogram.h
+                             ----------------------
+    begin                : October 2016
+    copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSEXPRESSIONPROGRAM_H
+#define QGSEXPRESSIONPROGRAM_H
+
+///@cond PRIVATE
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the QGIS API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#include "qgsexpression.h"
+#include "qgsfeature.h"
+
+class QgsExpressionContext;
+
+/** \ingroup core
+ * \class QgsExpressionProgram
+ * \brief A prepared expression lowered to a flat instruction stream.
+ *
+ * The program is created by QgsExpression::prepare() and evaluates the expression
+ * without walking the node tree. Instructions operate on a register file of typed values
+ * (NULL, int, double, string or generic variant), literals and constant subexpressions are
+ * folded at compile time and field indexes are resolved once. Nodes which can not be lowered
+ * (lazy or non typed functions, aggregates...) are evaluated through the node tree.
+ *
+ * The program only references nodes of the tree it was compiled from and is immutable after
+ * compilation, so a single program may be shared between implicitly shared expressions.
+ *
+ * \note Added in version 2.99
+ * \note Not available in Python bindings
+ */
+class QgsExpressionProgram
+{
+  public:
+
+    //! A typed value held by the register file
+    struct Register
+    {
+      enum Kind
+      {
+        Null,
+        Int,
+        Double,
+        String,
+        Variant,  //!< any other value, handled by the node tree operators
+      };
+
+      Register()
+          : kind( Null )
+          , i( 0 )
+          , d( 0 )
+          , hasVariant( false )
+      {}
+
+      void setVariant( const QVariant& value );
+      void setInt( int value ) { kind = Int; i = value; d = value; hasVariant = false; }
+      void setDouble( double value ) { kind = Double; d = value; hasVariant = false; }
+      void setString( const QString& value ) { kind = String; v = value; hasVariant = true; }
+      void setNull() { kind = Null; v = QVariant(); hasVariant = true; }
+
+      //! Returns true for int and finite double values, which may use the typed fast paths
+      bool isNumeric() const { return kind == Int || ( kind == Double && qIsFinite( d ) ); }
+
+      QVariant toVariant() const;
+
+      Kind kind;
+      int i;
+      double d;
+      QVariant v;
+      bool hasVariant;
+    };
+
+    /** Lowers a prepared node tree to a program.
+     * @param parent expression the tree belongs to, used for constant folding
+     * @param root root node of the prepared tree
+     * @param context context the tree has been prepared against
+     * @returns new program, or nullptr if the tree can not be compiled
+     */
+    static QgsExpressionProgram* compile( QgsExpression* parent, QgsExpression::Node* root, const QgsExpressionContext* context );
+
+    /** Evaluates the program. Errors are reported through parent in the same way as with
+     * QgsExpression::Node::eval().
+     */
+    QVariant evaluate( QgsExpression* parent, const QgsExpressionContext* context ) const;
+
+    /** Evaluates the program for a block of features. Each instruction is run over whole
+     * columns of values, numeric columns use tight loops over plain double arrays.
+     * Rows follow their own path through jumps, the instructions are only run for the rows
+     * which are active at that point.
+     * @param parent expression, receives the first evaluation error
+     * @param context context used by nodes evaluated through the tree, its feature is
+     * replaced by the feature of the row being evaluated
+     * @param features features to evaluate
+     * @returns one result per feature, NULL for rows which failed to evaluate
+     */
+    QVector<QVariant> evaluateBatch( QgsExpression* parent, QgsExpressionContext* context, const QgsFeatureList& features ) const;
+
+    //! Returns the number of instructions in the program
+    int instructionCount() const { return mInstructions.count(); }
+
+    //! Returns the number of registers required to evaluate the program
+    int registerCount() const { return mRegisterCount; }
+
+  private:
+
+    enum OpCode
+    {
+      LoadConstant,   //!< dest = constants[a], classified at compile time
+      LoadField,      //!< dest = feature attribute a (name in names[b])
+      UnaryOp,        //!< dest = op( reg a )
+      BinaryOp,       //!< dest = op( reg a, reg b )
+      InConstants,    //!< dest = reg a [NOT] IN constantLists[b]
+      CallDouble,     //!< dest = fnc( regs a .. a + b - 1 )
+      EvalNode,       //!< dest = node->eval(), tree walker fallback
+      JumpIfNull,     //!< if reg a is NULL goto b
+      JumpIfNotTrue,  //!< if reg a is not TRUE goto b
+      Jump,           //!< goto b
+    };
+
+    struct Instruction
+    {
+      Instruction( OpCode op = Jump, int dest = -1, int a = -1, int b = -1, QgsExpression::Node* node = nullptr )
+          : op( op )
+          , dest( dest )
+          , a( a )
+          , b( b )
+          , node( node )
+          , fnc( nullptr )
+      {}
+
+      OpCode op;
+      int dest;
+      int a;
+      int b;
+      QgsExpression::Node* node;
+      QgsExpression::FcnEvalDouble fnc;
+    };
+
+    //! Values of a register for a block of rows
+    struct Column
+    {
+      Column()
+          : dense( false )
+          , allInt( false )
+      {}
+
+      //! Returns the value of a row as a register
+      Register row( int i ) const;
+      //! Switches to the per row layout, keeping the current values
+      void detachRows( int count );
+      //! Switches to the dense layout if every row is a finite number of the same kind
+      void compact();
+      //! Fills all rows with the same value
+      void fill( const Register& value, int count );
+      //! Stores the result of a column loop, non finite doubles are moved to the per row layout
+      void setNumbers( const QVector<double>& result, bool isInt );
+
+      bool dense;         //!< all rows are stored in numbers
+      bool allInt;        //!< dense column of int values
+      QVector<double> numbers;
+      QVector<Register> values;
+    };
+
+    struct ListConstant
+    {
+      bool isNull;
+      bool doubleSafe;
+      double number;
+      QString string;
+    };
+
+    QgsExpressionProgram();
+
+    int allocateRegister() { return mRegisterCount++; }
+    int addInstruction( const Instruction& instruction ) { mInstructions.append( instruction ); return mInstructions.count() - 1; }
+    int addConstant( const QVariant& value );
+
+    bool compileNode( QgsExpression* parent, QgsExpression::Node* node, int dest, const QgsExpressionContext* context );
+    bool compileFunction( QgsExpression* parent, QgsExpression::NodeFunction* node, int dest, const QgsExpressionContext* context );
+    bool compileCondition( QgsExpression* parent, QgsExpression::NodeCondition* node, int dest, const QgsExpressionContext* context );
+    bool compileIn( QgsExpression* parent, QgsExpression::NodeInOperator* node, int dest, const QgsExpressionContext* context );
+
+    //! Returns true if the node result does not depend on the evaluation context
+    bool isConstant( const QgsExpression::Node* node, const QgsExpressionContext* context ) const;
+    //! Returns the typed numeric implementation to use for a function node, or nullptr
+    QgsExpression::FcnEvalDouble typedFunction( const QgsExpression::NodeFunction* node, const QgsExpressionContext* context ) const;
+
+    bool evalUnary( QgsExpression* parent, const Instruction& ins, Register* regs ) const;
+    bool evalBinary( QgsExpression* parent, const Instruction& ins, Register* regs ) const;
+    bool evalIn( QgsExpression* parent, const Instruction& ins, Register* regs, const QgsExpressionContext* context ) const;
+    bool evalCall( QgsExpression* parent, const Instruction& ins, Register* regs ) const;
+
+    //! Runs an instruction over a block when all rows are active, returns false if the block can not be handled by the column loops
+    bool evalDense( const Instruction& ins, QVector<Column>& columns, int count ) const;
+    //! Runs an instruction for a single row through the scalar code path
+    bool evalRow( QgsExpression* parent, const Instruction& ins, QVector<Column>& columns, int row, QgsExpressionContext* context, const QgsFeature& feature ) const;
+
+    QVector<Instruction> mInstructions;
+    QVector<Register> mConstants;
+    QVector< QVector<ListConstant> > mConstantLists;
+    QStringList mNames;
+    int mRegisterCount;
+    bool mUsesFeature;
+};
+
+///@endcond
+
+#endif // QGSEXPRESSIONPROGRAM_H
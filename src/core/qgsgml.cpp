@@ -30,6 +30,7 @@
 #include <QSet>
 #include <QSettings>
 #include <QUrl>
+#include <QtConcurrentRun>
 
 #include "ogr_api.h"
 
@@ -39,6 +40,134 @@ static const char NS_SEPARATOR = '?';
 static const char* GML_NAMESPACE = "http://www.opengis.net/gml";
 static const char* GML32_NAMESPACE = "http://www.opengis.net/gml/3.2";
 
+//! Approximate size of the top level elements parsed together by a thread
+static const int BATCH_SIZE = 256 * 1024;
+
+///@cond PRIVATE
+struct QgsGmlStreamingParser::Batch
+{
+  QgsGmlStreamingParser* parser;
+  QByteArray data;
+  QFuture<void> future;
+  bool ok;
+  QString errorMsg;
+};
+///@endcond
+
+static inline bool isXmlSpace( char c )
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+//! Exact powers of ten representable by a double
+static const double POWERS_OF_TEN[] =
+{
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/** Converts the text between begin and end to a double, ignoring leading and trailing spaces.
+ * Decimal numbers with at most 15 significant digits and a power of ten within the exact powers
+ * of a double are converted with a single multiplication or division of exact values, which is
+ * correctly rounded. Other numbers (long mantissas, large exponents, inf, nan...) are converted by Qt.
+ */
+static bool parseDouble( const char* begin, const char* end, double& value )
+{
+  while ( begin < end && isXmlSpace( *begin ) )
+    ++begin;
+  while ( end > begin && isXmlSpace( *( end - 1 ) ) )
+    --end;
+
+  const char* p = begin;
+  bool negative = false;
+  if ( p < end && ( *p == '-' || *p == '+' ) )
+  {
+    negative = *p == '-';
+    ++p;
+  }
+
+  quint64 mantissa = 0;
+  int significantDigits = 0;
+  int exponent = 0;
+  bool hasDigits = false;
+  for ( ; p < end && *p >= '0' && *p <= '9'; ++p )
+  {
+    hasDigits = true;
+    if ( mantissa > 0 || *p != '0' )
+    {
+      if ( ++significantDigits > 15 )
+        break;
+      mantissa = mantissa * 10 + ( *p - '0' );
+    }
+  }
+  if ( p < end && *p == '.' && significantDigits <= 15 )
+  {
+    for ( ++p; p < end && *p >= '0' && *p <= '9'; ++p )
+    {
+      hasDigits = true;
+      if ( mantissa > 0 || *p != '0' )
+      {
+        if ( ++significantDigits > 15 )
+          break;
+        mantissa = mantissa * 10 + ( *p - '0' );
+      }
+      --exponent;
+    }
+  }
+  if ( hasDigits && p < end && ( *p == 'e' || *p == 'E' ) && significantDigits <= 15 )
+  {
+    ++p;
+    bool negativeExponent = false;
+    if ( p < end && ( *p == '-' || *p == '+' ) )
+    {
+      negativeExponent = *p == '-';
+      ++p;
+    }
+    int explicitExponent = 0;
+    const char* exponentBegin = p;
+    for ( ; p < end && *p >= '0' && *p <= '9' && explicitExponent < 1000; ++p )
+    {
+      explicitExponent = explicitExponent * 10 + ( *p - '0' );
+    }
+    if ( p == exponentBegin )
+      hasDigits = false;
+    exponent += negativeExponent ? -explicitExponent : explicitExponent;
+  }
+
+  if ( hasDigits && p == end && significantDigits <= 15 && exponent >= -22 && exponent <= 22 )
+  {
+    value = static_cast< double >( mantissa );
+    if ( exponent < 0 )
+      value /= POWERS_OF_TEN[ -exponent ];
+    else
+      value *= POWERS_OF_TEN[ exponent ];
+    if ( negative )
+      value = -value;
+    return true;
+  }
+
+  bool ok;
+  value = QByteArray( begin, end - begin ).toDouble( &ok );
+  return ok;
+}
+
+//! Returns the first occurrence of separator between begin and end, end if there is none
+static const char* findSeparator( const char* begin, const char* end, const QByteArray& separator )
+{
+  if ( separator.size() == 1 )
+  {
+    const void* found = memchr( begin, separator.at( 0 ), end - begin );
+    return found ? static_cast< const char* >( found ) : end;
+  }
+
+  for ( const char* p = begin; p + separator.size() <= end; ++p )
+  {
+    if ( memcmp( p, separator.constData(), separator.size() ) == 0 )
+      return p;
+  }
+  return end;
+}
+
 QgsGml::QgsGml(
   const QString& typeName,
   const QString& geometryAttribute,
@@ -280,6 +409,8 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QString& typeName,
     , mFeatureCount( 0 )
     , mCurrentWKB( nullptr, 0 )
     , mBoundedByNullFound( false )
+    , mCoordinateSeparator( "," )
+    , mTupleSeparator( " " )
     , mDimension( 0 )
     , mCoorMode( coordinate )
     , mEpsg( 0 )
@@ -290,6 +421,10 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QString& typeName,
     , mNumberReturned( -1 )
     , mNumberMatched( -1 )
     , mFoundUnhandledGeometryElement( false )
+    , mMaxThreads( 1 )
+    , mSplitState( SplitHeader )
+    , mScanPos( 0 )
+    , mScanDepth( 0 )
 {
   mThematicAttributes.clear();
   for ( int i = 0; i < fields.size(); i++ )
@@ -341,6 +476,8 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QList<LayerProperties>& laye
     , mFeatureCount( 0 )
     , mCurrentWKB( nullptr, 0 )
     , mBoundedByNullFound( false )
+    , mCoordinateSeparator( "," )
+    , mTupleSeparator( " " )
     , mDimension( 0 )
     , mCoorMode( coordinate )
     , mEpsg( 0 )
@@ -351,6 +488,10 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QList<LayerProperties>& laye
     , mNumberReturned( -1 )
     , mNumberMatched( -1 )
     , mFoundUnhandledGeometryElement( false )
+    , mMaxThreads( 1 )
+    , mSplitState( SplitHeader )
+    , mScanPos( 0 )
+    , mScanDepth( 0 )
 {
   mThematicAttributes.clear();
   for ( int i = 0; i < fields.size(); i++ )
@@ -405,8 +546,61 @@ QgsGmlStreamingParser::QgsGmlStreamingParser( const QList<LayerProperties>& laye
 }
 
 
+QgsGmlStreamingParser::QgsGmlStreamingParser( const QgsGmlStreamingParser* documentParser )
+    : mLayerProperties( documentParser->mLayerProperties )
+    , mMapTypeNameToProperties( documentParser->mMapTypeNameToProperties )
+    , mTypeName( documentParser->mTypeName )
+    , mTypeNameBA( documentParser->mTypeNameBA )
+    , mTypeNamePtr( documentParser->mTypeNamePtr ? mTypeNameBA.constData() : nullptr )
+    , mWkbType( Qgis::WKBUnknown )
+    , mGeometryAttribute( documentParser->mGeometryAttribute )
+    , mGeometryAttributeBA( documentParser->mGeometryAttributeBA )
+    , mGeometryAttributePtr( documentParser->mGeometryAttributePtr ? mGeometryAttributeBA.constData() : nullptr )
+    , mFields( documentParser->mFields )
+    , mThematicAttributes( documentParser->mThematicAttributes )
+    , mIsException( false )
+    , mTruncatedResponse( false )
+    , mParseDepth( 0 )
+    , mFeatureTupleDepth( 0 )
+    , mCurrentFeature( nullptr )
+    , mFeatureCount( 0 )
+    , mCurrentWKB( nullptr, 0 )
+    , mBoundedByNullFound( false )
+    , mEndian( documentParser->mEndian )
+    , mCoordinateSeparator( "," )
+    , mTupleSeparator( " " )
+    , mDimension( documentParser->mDimension )
+    , mCoorMode( coordinate )
+    , mEpsg( documentParser->mEpsg )
+    , mSrsName( documentParser->mSrsName )
+    , mGMLNameSpaceURI( documentParser->mGMLNameSpaceURI )
+    , mGMLNameSpaceURIPtr( documentParser->mGMLNameSpaceURIPtr )
+    , mAxisOrientationLogic( documentParser->mAxisOrientationLogic )
+    , mInvertAxisOrientationRequest( documentParser->mInvertAxisOrientationRequest )
+    , mInvertAxisOrientation( documentParser->mInvertAxisOrientation )
+    , mNumberReturned( -1 )
+    , mNumberMatched( -1 )
+    , mFoundUnhandledGeometryElement( false )
+    , mMaxThreads( 1 )
+    , mSplitState( SplitDisabled )
+    , mScanPos( 0 )
+    , mScanDepth( 0 )
+{
+  mParser = XML_ParserCreateNS( nullptr, NS_SEPARATOR );
+  XML_SetUserData( mParser, this );
+  XML_SetElementHandler( mParser, QgsGmlStreamingParser::start, QgsGmlStreamingParser::end );
+  XML_SetCharacterDataHandler( mParser, QgsGmlStreamingParser::chars );
+}
+
 QgsGmlStreamingParser::~QgsGmlStreamingParser()
 {
+  Q_FOREACH ( Batch* batch, mBatches )
+  {
+    batch->future.waitForFinished();
+    delete batch->parser;
+    delete batch;
+  }
+
   XML_ParserFree( mParser );
 
   // Normally a sane user of this class should have consumed everything...
@@ -431,7 +625,16 @@ bool QgsGmlStreamingParser::processData( const QByteArray& data, bool atEnd )
 
 bool QgsGmlStreamingParser::processData( const QByteArray& data, bool atEnd, QString& errorMsg )
 {
-  if ( XML_Parse( mParser, data.data(), data.size(), atEnd ) == 0 )
+  if ( mMaxThreads > 1 && mSplitState != SplitDisabled )
+  {
+    return processDataInBatches( data, atEnd, errorMsg );
+  }
+  return parse( data.constData(), data.size(), atEnd, errorMsg );
+}
+
+bool QgsGmlStreamingParser::parse( const char* data, int len, bool atEnd, QString& errorMsg )
+{
+  if ( XML_Parse( mParser, data, len, atEnd ) == 0 )
   {
     XML_Error errorCode = XML_GetErrorCode( mParser );
     errorMsg = QObject::tr( "Error: %1 on line %2, column %3" )
@@ -445,8 +648,361 @@ bool QgsGmlStreamingParser::processData( const QByteArray& data, bool atEnd, QSt
   return true;
 }
 
+bool QgsGmlStreamingParser::processDataInBatches( const QByteArray& data, bool atEnd, QString& errorMsg )
+{
+  mPendingData.append( data );
+
+  if ( mSplitState == SplitHeader )
+  {
+    QByteArray rootName;
+    int headerSize = scanHeader( atEnd, rootName );
+    if ( headerSize == 0 )
+    {
+      return true;
+    }
+    if ( headerSize < 0 )
+    {
+      mSplitState = SplitDisabled;
+      QByteArray pendingData = mPendingData;
+      mPendingData.clear();
+      return parse( pendingData.constData(), pendingData.size(), atEnd, errorMsg );
+    }
+
+    // the header and the footer surround the top level elements parsed by the batches
+    mDocumentHeader = mPendingData.left( headerSize );
+    mDocumentFooter = "</" + rootName + ">";
+    mPendingData.remove( 0, headerSize );
+    mSplitState = SplitSequential;
+    if ( !parse( mDocumentHeader.constData(), mDocumentHeader.size(), false, errorMsg ) )
+    {
+      return false;
+    }
+  }
+
+  const QVector<int> elementEnds = scanTopLevelElements();
+  int consumed = 0;
+  Q_FOREACH ( int elementEnd, elementEnds )
+  {
+    if ( mSplitState == SplitSequential )
+    {
+      // the elements preceding the first feature, and the first feature itself, set the properties
+      // of the document (namespace, srsName, axis order...) given to the parsers of the batches
+      if ( !parse( mPendingData.constData() + consumed, elementEnd - consumed, false, errorMsg ) )
+      {
+        return false;
+      }
+      consumed = elementEnd;
+      if ( mFeatureCount > 0 )
+      {
+        mSplitState = SplitBatches;
+      }
+    }
+    else if ( elementEnd - consumed >= BATCH_SIZE )
+    {
+      startBatch( mPendingData.mid( consumed, elementEnd - consumed ) );
+      consumed = elementEnd;
+    }
+  }
+
+  if ( atEnd )
+  {
+    // the top level elements preceding the end tag of the root element
+    if ( mSplitState == SplitBatches && mScanDepth < 0 && mScanPos > consumed )
+    {
+      startBatch( mPendingData.mid( consumed, mScanPos - consumed ) );
+      consumed = mScanPos;
+    }
+
+    // the features of the batches precede the ones of the rest of the document
+    if ( !collectBatches( true, errorMsg ) )
+    {
+      return false;
+    }
+    // the end tag of the root element, or what could not be split in a document which is not well-formed
+    bool ok = parse( mPendingData.constData() + consumed, mPendingData.size() - consumed, true, errorMsg );
+    mPendingData.clear();
+    return ok;
+  }
+
+  if ( consumed > 0 )
+  {
+    mPendingData.remove( 0, consumed );
+    mScanPos -= consumed;
+  }
+  return collectBatches( false, errorMsg );
+}
+
+int QgsGmlStreamingParser::scanHeader( bool atEnd, QByteArray& rootName ) const
+{
+  const char* begin = mPendingData.constData();
+  const char* end = begin + mPendingData.size();
+  const char* p = begin;
+
+  // UTF-8 byte order mark
+  if ( end - p >= 3 && memcmp( p, "\xEF\xBB\xBF", 3 ) == 0 )
+    p += 3;
+
+  while ( p < end )
+  {
+    if ( isXmlSpace( *p ) )
+    {
+      ++p;
+      continue;
+    }
+    // UTF-16 and other encodings which are not a superset of ASCII are not split
+    if ( *p != '<' )
+      return -1;
+    if ( end - p < 4 )
+      break;
+
+    const char* constructEnd = nullptr;
+    if ( p[1] == '?' )
+    {
+      constructEnd = findSeparator( p, end, "?>" );
+      if ( constructEnd == end )
+        break;
+      p = constructEnd + 2;
+    }
+    else if ( memcmp( p, "<!--", 4 ) == 0 )
+    {
+      constructEnd = findSeparator( p, end, "-->" );
+      if ( constructEnd == end )
+        break;
+      p = constructEnd + 3;
+    }
+    else if ( p[1] == '!' )
+    {
+      // a DOCTYPE could declare entities expanding to top level elements
+      return -1;
+    }
+    else
+    {
+      // start tag of the root element
+      const char* nameEnd = p + 1;
+      while ( nameEnd < end && !isXmlSpace( *nameEnd ) && *nameEnd != '/' && *nameEnd != '>' )
+        ++nameEnd;
+      char quote = 0;
+      for ( const char* tagEnd = nameEnd; tagEnd < end; ++tagEnd )
+      {
+        if ( quote )
+        {
+          if ( *tagEnd == quote )
+            quote = 0;
+        }
+        else if ( *tagEnd == '"' || *tagEnd == '\'' )
+        {
+          quote = *tagEnd;
+        }
+        else if ( *tagEnd == '>' )
+        {
+          if ( *( tagEnd - 1 ) == '/' )
+            return -1; // empty document
+          rootName = QByteArray( p + 1, nameEnd - p - 1 );
+          return tagEnd + 1 - begin;
+        }
+      }
+      break;
+    }
+  }
+
+  return atEnd ? -1 : 0;
+}
+
+QVector<int> QgsGmlStreamingParser::scanTopLevelElements()
+{
+  QVector<int> elementEnds;
+  const char* begin = mPendingData.constData();
+  const char* end = begin + mPendingData.size();
+  const char* p = begin + mScanPos;
+
+  // mScanDepth is -1 once the end tag of the root element is found
+  while ( mScanDepth >= 0 )
+  {
+    const char* markup = static_cast< const char* >( memchr( p, '<', end - p ) );
+    if ( !markup || end - markup < 2 )
+    {
+      p = markup ? markup : end;
+      break;
+    }
+
+    const char* markupEnd = nullptr;
+    if ( markup[1] == '?' )
+    {
+      markupEnd = findSeparator( markup, end, "?>" );
+      if ( markupEnd != end )
+        markupEnd += 2;
+    }
+    else if ( markup[1] == '!' )
+    {
+      if ( end - markup < 9 )
+      {
+        p = markup;
+        break;
+      }
+      if ( memcmp( markup, "<!--", 4 ) == 0 )
+      {
+        markupEnd = findSeparator( markup, end, "-->" );
+        if ( markupEnd != end )
+          markupEnd += 3;
+      }
+      else if ( memcmp( markup, "<![CDATA[", 9 ) == 0 )
+      {
+        markupEnd = findSeparator( markup, end, "]]>" );
+        if ( markupEnd != end )
+          markupEnd += 3;
+      }
+      else
+      {
+        // not well-formed, left to the parser of a batch to report
+        markupEnd = findSeparator( markup, end, ">" );
+        if ( markupEnd != end )
+          markupEnd += 1;
+      }
+    }
+    else
+    {
+      // start, end or empty element tag, attribute values may contain '>'
+      char quote = 0;
+      for ( const char* c = markup + 1; c < end; ++c )
+      {
+        if ( quote )
+        {
+          if ( *c == quote )
+            quote = 0;
+        }
+        else if ( *c == '"' || *c == '\'' )
+        {
+          quote = *c;
+        }
+        else if ( *c == '>' )
+        {
+          markupEnd = c + 1;
+          break;
+        }
+      }
+      if ( !markupEnd )
+        markupEnd = end;
+    }
+
+    if ( markupEnd == end )
+    {
+      // incomplete markup, scanned again with the next data
+      p = markup;
+      break;
+    }
+    p = markupEnd;
+
+    if ( markup[1] == '/' )
+    {
+      --mScanDepth;
+      if ( mScanDepth == 0 )
+        elementEnds << ( p - begin );
+      else if ( mScanDepth < 0 )
+        p = markup; // the end tag of the root element is left to this parser
+    }
+    else if ( markup[1] != '?' && markup[1] != '!' )
+    {
+      if ( *( markupEnd - 2 ) != '/' )
+        ++mScanDepth;
+      else if ( mScanDepth == 0 )
+        elementEnds << ( p - begin );
+    }
+  }
+
+  mScanPos = p - begin;
+  return elementEnds;
+}
+
+void QgsGmlStreamingParser::startBatch( const QByteArray& elements )
+{
+  // limit the number of batches being parsed, and thus the memory used by the pending data
+  int running = 0;
+  Q_FOREACH ( Batch* batch, mBatches )
+  {
+    if ( !batch->future.isFinished() )
+      ++running;
+  }
+  for ( int i = 0; running >= mMaxThreads && i < mBatches.size(); ++i )
+  {
+    if ( !mBatches[i]->future.isFinished() )
+    {
+      mBatches[i]->future.waitForFinished();
+      --running;
+    }
+  }
+
+  Batch* batch = new Batch;
+  batch->parser = new QgsGmlStreamingParser( this );
+  batch->data.reserve( mDocumentHeader.size() + elements.size() + mDocumentFooter.size() );
+  batch->data.append( mDocumentHeader );
+  batch->data.append( elements );
+  batch->data.append( mDocumentFooter );
+  batch->ok = false;
+  batch->future = QtConcurrent::run( &QgsGmlStreamingParser::parseBatch, batch );
+  mBatches.append( batch );
+}
+
+void QgsGmlStreamingParser::parseBatch( Batch* batch )
+{
+  batch->ok = batch->parser->parse( batch->data.constData(), batch->data.size(), true, batch->errorMsg );
+  batch->data.clear();
+}
+
+bool QgsGmlStreamingParser::collectBatches( bool wait, QString& errorMsg )
+{
+  while ( !mBatches.isEmpty() )
+  {
+    Batch* batch = mBatches.first();
+    if ( wait )
+      batch->future.waitForFinished();
+    else if ( !batch->future.isFinished() )
+      break;
+
+    if ( !batch->ok )
+    {
+      // the batch is kept, so that the error is reported again
+      errorMsg = batch->errorMsg;
+      return false;
+    }
+
+    // the features are numbered in the order of the document
+    QVector<QgsGmlFeaturePtrGmlIdPair> features = batch->parser->getAndStealReadyFeatures();
+    for ( int i = 0; i < features.size(); ++i )
+    {
+      features[i].first->setFeatureId( mFeatureCount );
+      ++mFeatureCount;
+    }
+    mFeatureList += features;
+
+    const Qgis::WkbType batchWkbType = batch->parser->wkbType();
+    if ( batchWkbType != Qgis::WKBUnknown &&
+         !( mWkbType == Qgis::WKBMultiPoint && batchWkbType == Qgis::WKBPoint ) &&
+         !( mWkbType == Qgis::WKBMultiLineString && batchWkbType == Qgis::WKBLineString ) &&
+         !( mWkbType == Qgis::WKBMultiPolygon && batchWkbType == Qgis::WKBPolygon ) ) //keep multitype in case of geometry type mix
+    {
+      mWkbType = batchWkbType;
+    }
+    if ( batch->parser->isTruncatedResponse() )
+    {
+      mTruncatedResponse = true;
+    }
+
+    mBatches.removeFirst();
+    delete batch->parser;
+    delete batch;
+  }
+  return true;
+}
+
 QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> QgsGmlStreamingParser::getAndStealReadyFeatures()
 {
+  if ( !mBatches.isEmpty() )
+  {
+    // an error is reported by the next call to processData()
+    QString errorMsg;
+    collectBatches( false, errorMsg );
+  }
+
   QVector<QgsGmlFeaturePtrGmlIdPair> ret = mFeatureList;
   mFeatureList.clear();
   return ret;
@@ -503,13 +1059,13 @@ void QgsGmlStreamingParser::startElement( const XML_Char* el, const XML_Char** a
   {
     mParseModeStack.push( coordinate );
     mCoorMode = QgsGmlStreamingParser::coordinate;
-    mStringCash.clear();
-    mCoordinateSeparator = readAttribute( "cs", attr );
+    mCoordinateCash.clear();
+    mCoordinateSeparator = readAttribute( "cs", attr ).toUtf8();
     if ( mCoordinateSeparator.isEmpty() )
     {
       mCoordinateSeparator = ',';
     }
-    mTupleSeparator = readAttribute( "ts", attr );
+    mTupleSeparator = readAttribute( "ts", attr ).toUtf8();
     if ( mTupleSeparator.isEmpty() )
     {
       mTupleSeparator = ' ';
@@ -520,7 +1076,7 @@ void QgsGmlStreamingParser::startElement( const XML_Char* el, const XML_Char** a
   {
     mParseModeStack.push( QgsGmlStreamingParser::posList );
     mCoorMode = QgsGmlStreamingParser::posList;
-    mStringCash.clear();
+    mCoordinateCash.clear();
     if ( mDimension == 0 )
     {
       QString srsDimension = readAttribute( "srsDimension", attr );
@@ -562,13 +1118,13 @@ void QgsGmlStreamingParser::startElement( const XML_Char* el, const XML_Char** a
             isGMLNS && LOCALNAME_EQUALS( "lowerCorner" ) )
   {
     mParseModeStack.push( QgsGmlStreamingParser::lowerCorner );
-    mStringCash.clear();
+    mCoordinateCash.clear();
   }
   else if ( theParseMode == envelope &&
             isGMLNS && LOCALNAME_EQUALS( "upperCorner" ) )
   {
     mParseModeStack.push( QgsGmlStreamingParser::upperCorner );
-    mStringCash.clear();
+    mCoordinateCash.clear();
   }
   else if ( theParseMode == none && !mTypeNamePtr &&
             LOCALNAME_EQUALS( "Tuple" ) )
@@ -877,10 +1433,10 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
   }
   else if ( theParseMode == boundingBox && isGMLNS && LOCALNAME_EQUALS( "boundedBy" ) )
   {
-    //create bounding box from mStringCash
+    //create bounding box from mCoordinateCash
     if ( mCurrentExtent.isNull() &&
          !mBoundedByNullFound &&
-         !createBBoxFromCoordinateString( mCurrentExtent, mStringCash ) )
+         !createBBoxFromCoordinateString( mCurrentExtent, mCoordinateCash ) )
     {
       QgsDebugMsg( "creation of bounding box failed" );
     }
@@ -902,23 +1458,23 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
   }
   else if ( theParseMode == lowerCorner && isGMLNS && LOCALNAME_EQUALS( "lowerCorner" ) )
   {
-    QList<QgsPoint> points;
-    pointsFromPosListString( points, mStringCash, 2 );
-    if ( points.size() == 1 )
+    QVector<double> coordinates;
+    pointsFromPosListString( coordinates, mCoordinateCash, 2 );
+    if ( coordinates.size() == 2 )
     {
-      mCurrentExtent.setXMinimum( points[0].x() );
-      mCurrentExtent.setYMinimum( points[0].y() );
+      mCurrentExtent.setXMinimum( coordinates[0] );
+      mCurrentExtent.setYMinimum( coordinates[1] );
     }
     mParseModeStack.pop();
   }
   else if ( theParseMode == upperCorner && isGMLNS && LOCALNAME_EQUALS( "upperCorner" ) )
   {
-    QList<QgsPoint> points;
-    pointsFromPosListString( points, mStringCash, 2 );
-    if ( points.size() == 1 )
+    QVector<double> coordinates;
+    pointsFromPosListString( coordinates, mCoordinateCash, 2 );
+    if ( coordinates.size() == 2 )
     {
-      mCurrentExtent.setXMaximum( points[0].x() );
-      mCurrentExtent.setYMaximum( points[0].y() );
+      mCurrentExtent.setXMaximum( coordinates[0] );
+      mCurrentExtent.setYMaximum( coordinates[1] );
     }
     mParseModeStack.pop();
   }
@@ -957,19 +1513,19 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
   }
   else if ( isGMLNS && LOCALNAME_EQUALS( "Point" ) )
   {
-    QList<QgsPoint> pointList;
-    if ( pointsFromString( pointList, mStringCash ) != 0 )
+    QVector<double> coordinates;
+    if ( pointsFromString( coordinates, mCoordinateCash ) != 0 )
     {
       //error
     }
 
-    if ( pointList.isEmpty() )
+    if ( coordinates.isEmpty() )
       return;  // error
 
     if ( theParseMode == QgsGmlStreamingParser::geometry )
     {
       //directly add WKB point to the feature
-      if ( getPointWKB( mCurrentWKB, *( pointList.constBegin() ) ) != 0 )
+      if ( getPointWKB( mCurrentWKB, coordinates[0], coordinates[1] ) != 0 )
       {
         //error
       }
@@ -982,7 +1538,7 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
     else //multipoint, add WKB as fragment
     {
       QgsWkbPtr wkbPtr( nullptr, 0 );
-      if ( getPointWKB( wkbPtr, *( pointList.constBegin() ) ) != 0 )
+      if ( getPointWKB( wkbPtr, coordinates[0], coordinates[1] ) != 0 )
       {
         //error
       }
@@ -1001,14 +1557,14 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
   {
     //add WKB point to the feature
 
-    QList<QgsPoint> pointList;
-    if ( pointsFromString( pointList, mStringCash ) != 0 )
+    QVector<double> coordinates;
+    if ( pointsFromString( coordinates, mCoordinateCash ) != 0 )
     {
       //error
     }
     if ( theParseMode == QgsGmlStreamingParser::geometry )
     {
-      if ( getLineWKB( mCurrentWKB, pointList ) != 0 )
+      if ( getLineWKB( mCurrentWKB, coordinates ) != 0 )
       {
         //error
       }
@@ -1021,7 +1577,7 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
     else //multiline, add WKB as fragment
     {
       QgsWkbPtr wkbPtr( nullptr, 0 );
-      if ( getLineWKB( wkbPtr, pointList ) != 0 )
+      if ( getLineWKB( wkbPtr, coordinates ) != 0 )
       {
         //error
       }
@@ -1039,14 +1595,14 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
   else if (( theParseMode == geometry || theParseMode == multiPolygon ) &&
            isGMLNS && LOCALNAME_EQUALS( "LinearRing" ) )
   {
-    QList<QgsPoint> pointList;
-    if ( pointsFromString( pointList, mStringCash ) != 0 )
+    QVector<double> coordinates;
+    if ( pointsFromString( coordinates, mCoordinateCash ) != 0 )
     {
       //error
     }
 
     QgsWkbPtr wkbPtr( nullptr, 0 );
-    if ( getRingWKB( wkbPtr, pointList ) != 0 )
+    if ( getRingWKB( wkbPtr, coordinates ) != 0 )
     {
       //error
     }
@@ -1116,7 +1672,7 @@ void QgsGmlStreamingParser::endElement( const XML_Char* el )
 
 void QgsGmlStreamingParser::characters( const XML_Char* chars, int len )
 {
-  //save chars in mStringCash attribute mode or coordinate mode
+  //save chars in mStringCash in attribute mode or in mCoordinateCash in coordinate mode
   if ( mParseModeStack.isEmpty() )
   {
     return;
@@ -1128,13 +1684,16 @@ void QgsGmlStreamingParser::characters( const XML_Char* chars, int len )
   }
 
   QgsGmlStreamingParser::ParseMode theParseMode = mParseModeStack.top();
-  if ( theParseMode == QgsGmlStreamingParser::attribute ||
-       theParseMode == QgsGmlStreamingParser::attributeTuple ||
-       theParseMode == QgsGmlStreamingParser::coordinate ||
+  if ( theParseMode == QgsGmlStreamingParser::coordinate ||
        theParseMode == QgsGmlStreamingParser::posList ||
        theParseMode == QgsGmlStreamingParser::lowerCorner ||
-       theParseMode == QgsGmlStreamingParser::upperCorner ||
-       theParseMode == QgsGmlStreamingParser::ExceptionText )
+       theParseMode == QgsGmlStreamingParser::upperCorner )
+  {
+    mCoordinateCash.append( chars, len );
+  }
+  else if ( theParseMode == QgsGmlStreamingParser::attribute ||
+            theParseMode == QgsGmlStreamingParser::attributeTuple ||
+            theParseMode == QgsGmlStreamingParser::ExceptionText )
   {
     mStringCash.append( QString::fromUtf8( chars, len ) );
   }
@@ -1235,140 +1794,157 @@ QString QgsGmlStreamingParser::readAttribute( const QString& attributeName, cons
   return QString();
 }
 
-bool QgsGmlStreamingParser::createBBoxFromCoordinateString( QgsRectangle &r, const QString& coordString ) const
+bool QgsGmlStreamingParser::createBBoxFromCoordinateString( QgsRectangle &r, const QByteArray& coordString ) const
 {
-  QList<QgsPoint> points;
-  if ( pointsFromCoordinateString( points, coordString ) != 0 )
+  QVector<double> coordinates;
+  if ( pointsFromCoordinateString( coordinates, coordString ) != 0 )
   {
     return false;
   }
 
-  if ( points.size() < 2 )
+  if ( coordinates.size() < 4 )
   {
     return false;
   }
 
-  r.set( points[0], points[1] );
+  r.set( QgsPoint( coordinates[0], coordinates[1] ), QgsPoint( coordinates[2], coordinates[3] ) );
 
   return true;
 }
 
-int QgsGmlStreamingParser::pointsFromCoordinateString( QList<QgsPoint>& points, const QString& coordString ) const
+int QgsGmlStreamingParser::pointsFromCoordinateString( QVector<double>& coordinates, const QByteArray& coordString ) const
 {
   //tuples are separated by space, x/y by ','
-  QStringList tuples = coordString.split( mTupleSeparator, QString::SkipEmptyParts );
-  QStringList tuples_coordinates;
-  double x, y;
-  bool conversionSuccess;
-
-  QStringList::const_iterator tupleIterator;
-  for ( tupleIterator = tuples.constBegin(); tupleIterator != tuples.constEnd(); ++tupleIterator )
+  const char* p = coordString.constData();
+  const char* end = p + coordString.size();
+  while ( p < end )
   {
-    tuples_coordinates = tupleIterator->split( mCoordinateSeparator, QString::SkipEmptyParts );
-    if ( tuples_coordinates.size() < 2 )
-    {
-      continue;
-    }
-    x = tuples_coordinates.at( 0 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+    const char* tupleEnd = findSeparator( p, end, mTupleSeparator );
+
+    // the first two non empty parts of the tuple are x and y
+    const char* parts[2][2];
+    int nParts = 0;
+    const char* partBegin = p;
+    while ( nParts < 2 && partBegin < tupleEnd )
     {
-      continue;
+      const char* partEnd = findSeparator( partBegin, tupleEnd, mCoordinateSeparator );
+      if ( partEnd > partBegin )
+      {
+        parts[nParts][0] = partBegin;
+        parts[nParts][1] = partEnd;
+        ++nParts;
+      }
+      partBegin = partEnd + mCoordinateSeparator.size();
     }
-    y = tuples_coordinates.at( 1 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+
+    double x, y;
+    if ( nParts == 2 &&
+         parseDouble( parts[0][0], parts[0][1], x ) &&
+         parseDouble( parts[1][0], parts[1][1], y ) )
     {
-      continue;
+      coordinates << ( mInvertAxisOrientation ? y : x ) << ( mInvertAxisOrientation ? x : y );
     }
-    points.push_back(( mInvertAxisOrientation ) ? QgsPoint( y, x ) : QgsPoint( x, y ) );
+
+    p = tupleEnd + mTupleSeparator.size();
   }
   return 0;
 }
 
-int QgsGmlStreamingParser::pointsFromPosListString( QList<QgsPoint>& points, const QString& coordString, int dimension ) const
+int QgsGmlStreamingParser::pointsFromPosListString( QVector<double>& coordinates, const QByteArray& coordString, int dimension ) const
 {
   // coordinates separated by spaces
-  QStringList coordinates = coordString.split( ' ', QString::SkipEmptyParts );
-
-  if ( coordinates.size() % dimension != 0 )
-  {
-    QgsDebugMsg( "Wrong number of coordinates" );
-  }
+  const char* p = coordString.constData();
+  const char* end = p + coordString.size();
+  int index = 0;
+  double x = 0;
+  double y = 0;
+  bool ok = false;
+  while ( true )
+  {
+    while ( p < end && isXmlSpace( *p ) )
+      ++p;
+    if ( p == end )
+      break;
+    const char* coordinateEnd = p;
+    while ( coordinateEnd < end && !isXmlSpace( *coordinateEnd ) )
+      ++coordinateEnd;
 
-  int ncoor = coordinates.size() / dimension;
-  for ( int i = 0; i < ncoor; i++ )
-  {
-    bool conversionSuccess;
-    double x = coordinates.value( i * dimension ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+    int coordinate = index % dimension;
+    if ( coordinate == 0 )
     {
-      continue;
+      ok = parseDouble( p, coordinateEnd, x );
     }
-    double y = coordinates.value( i * dimension + 1 ).toDouble( &conversionSuccess );
-    if ( !conversionSuccess )
+    else if ( coordinate == 1 )
     {
-      continue;
+      ok = parseDouble( p, coordinateEnd, y ) && ok;
+    }
+    if ( coordinate == dimension - 1 && ok )
+    {
+      coordinates << ( mInvertAxisOrientation ? y : x ) << ( mInvertAxisOrientation ? x : y );
     }
-    points.append(( mInvertAxisOrientation ) ? QgsPoint( y, x ) : QgsPoint( x, y ) );
+
+    ++index;
+    p = coordinateEnd;
+  }
+
+  if ( index % dimension != 0 )
+  {
+    QgsDebugMsg( "Wrong number of coordinates" );
   }
   return 0;
 }
 
-int QgsGmlStreamingParser::pointsFromString( QList<QgsPoint>& points, const QString& coordString ) const
+int QgsGmlStreamingParser::pointsFromString( QVector<double>& coordinates, const QByteArray& coordString ) const
 {
   if ( mCoorMode == QgsGmlStreamingParser::coordinate )
   {
-    return pointsFromCoordinateString( points, coordString );
+    return pointsFromCoordinateString( coordinates, coordString );
   }
   else if ( mCoorMode == QgsGmlStreamingParser::posList )
   {
-    return pointsFromPosListString( points, coordString, mDimension ? mDimension : 2 );
+    return pointsFromPosListString( coordinates, coordString, mDimension >= 2 ? mDimension : 2 );
   }
   return 1;
 }
 
-int QgsGmlStreamingParser::getPointWKB( QgsWkbPtr &wkbPtr, const QgsPoint& point ) const
+int QgsGmlStreamingParser::getPointWKB( QgsWkbPtr &wkbPtr, double x, double y ) const
 {
   int wkbSize = 1 + sizeof( int ) + 2 * sizeof( double );
   wkbPtr = QgsWkbPtr( new unsigned char[wkbSize], wkbSize );
 
   QgsWkbPtr fillPtr( wkbPtr );
-  fillPtr << mEndian << Qgis::WKBPoint << point.x() << point.y();
+  fillPtr << mEndian << Qgis::WKBPoint << x << y;
 
   return 0;
 }
 
-int QgsGmlStreamingParser::getLineWKB( QgsWkbPtr &wkbPtr, const QList<QgsPoint>& lineCoordinates ) const
+int QgsGmlStreamingParser::getLineWKB( QgsWkbPtr &wkbPtr, const QVector<double>& lineCoordinates ) const
 {
-  int wkbSize = 1 + 2 * sizeof( int ) + lineCoordinates.size() * 2 * sizeof( double );
+  int nPoints = lineCoordinates.size() / 2;
+  int wkbSize = 1 + 2 * sizeof( int ) + nPoints * 2 * sizeof( double );
   wkbPtr = QgsWkbPtr( new unsigned char[wkbSize], wkbSize );
 
   QgsWkbPtr fillPtr( wkbPtr );
 
-  fillPtr << mEndian << Qgis::WKBLineString << lineCoordinates.size();
+  fillPtr << mEndian << Qgis::WKBLineString << nPoints;
 
-  QList<QgsPoint>::const_iterator iter;
-  for ( iter = lineCoordinates.constBegin(); iter != lineCoordinates.constEnd(); ++iter )
-  {
-    fillPtr << iter->x() << iter->y();
-  }
+  // the coordinates are already in the WKB order of a point sequence
+  memcpy( fillPtr, lineCoordinates.constData(), nPoints * 2 * sizeof( double ) );
 
   return 0;
 }
 
-int QgsGmlStreamingParser::getRingWKB( QgsWkbPtr &wkbPtr, const QList<QgsPoint>& ringCoordinates ) const
+int QgsGmlStreamingParser::getRingWKB( QgsWkbPtr &wkbPtr, const QVector<double>& ringCoordinates ) const
 {
-  int wkbSize = sizeof( int ) + ringCoordinates.size() * 2 * sizeof( double );
+  int nPoints = ringCoordinates.size() / 2;
+  int wkbSize = sizeof( int ) + nPoints * 2 * sizeof( double );
   wkbPtr = QgsWkbPtr( new unsigned char[wkbSize], wkbSize );
 
   QgsWkbPtr fillPtr( wkbPtr );
 
-  fillPtr << ringCoordinates.size();
+  fillPtr << nPoints;
 
-  QList<QgsPoint>::const_iterator iter;
-  for ( iter = ringCoordinates.constBegin(); iter != ringCoordinates.constEnd(); ++iter )
-  {
-    fillPtr << iter->x() << iter->y();
-  }
+  memcpy( fillPtr, ringCoordinates.constData(), nPoints * 2 * sizeof( double ) );
 
   return 0;
 }
@@ -129,8 +129,67 @@ class CORE_EXPORT QgsGmlStreamingParser
     /** Return whether a "truncatedResponse" element is found */
     bool isTruncatedResponse() const { return mTruncatedResponse; }
 
+    /** Sets the maximum number of threads used to parse the features, 1 (the default) to
+     * parse the data in the thread calling processData(). With more threads, the complete top level
+     * elements of the document (e.g. gml:featureMember or wfs:member) following the first feature are
+     * gathered in batches parsed in parallel while processData() keeps receiving data. The features are
+     * still returned in the order of the document. Must be called before the first call to processData().
+     * @note added in QGIS 2.99
+     */
+    void setMaxThreads( int maxThreads ) { mMaxThreads = maxThreads; }
+
+    /** Returns the maximum number of threads used to parse the features
+     * @see setMaxThreads()
+     * @note added in QGIS 2.99
+     */
+    int maxThreads() const { return mMaxThreads; }
+
   private:
 
+    //! Top level elements of the document parsed by another parser
+    struct Batch;
+
+    //! Progress of the splitting of the document in batches
+    enum SplitState
+    {
+      SplitHeader,     //!< looking for the start tag of the root element
+      SplitSequential, //!< top level elements are parsed by this parser, until it finds a feature
+      SplitBatches,    //!< top level elements are parsed in batches
+      SplitDisabled    //!< the document cannot be split, it is parsed by this parser
+    };
+
+    /** Constructor for the parser of a batch, with the settings and document properties of
+     * the parser of the whole document */
+    explicit QgsGmlStreamingParser( const QgsGmlStreamingParser* documentParser );
+
+    //! Feeds data to the expat parser
+    bool parse( const char* data, int len, bool atEnd, QString& errorMsg );
+
+    //! Implementation of processData() splitting the document in batches
+    bool processDataInBatches( const QByteArray& data, bool atEnd, QString& errorMsg );
+
+    /** Finds the prolog and the start tag of the root element in mPendingData
+     * @param atEnd whether mPendingData holds the whole document
+     * @param rootName receives the qualified name of the root element
+     * @returns the size of the header, 0 if more data is needed, -1 if the document cannot be split
+     */
+    int scanHeader( bool atEnd, QByteArray& rootName ) const;
+
+    /** Scans mPendingData from mScanPos for the end of top level elements
+     * @returns positions following the top level elements completed in the scanned data
+     */
+    QVector<int> scanTopLevelElements();
+
+    //! Starts parsing a batch of top level elements
+    void startBatch( const QByteArray& elements );
+
+    //! Moves the features of the parsed batches to mFeatureList, waiting for all the batches if wait is true
+    bool collectBatches( bool wait, QString& errorMsg );
+
+    //! Parses a batch in a worker thread
+    static void parseBatch( Batch* batch );
+
+
     enum ParseMode
     {
       none,
@@ -189,26 +248,26 @@ class CORE_EXPORT QgsGmlStreamingParser
       */
     QString readAttribute( const QString& attributeName, const XML_Char** attr ) const;
     /** Creates a rectangle from a coordinate string. */
-    bool createBBoxFromCoordinateString( QgsRectangle &bb, const QString& coordString ) const;
-    /** Creates a set of points from a coordinate string.
-       @param points list that will contain the created points
-       @param coordString the text containing the coordinates
+    bool createBBoxFromCoordinateString( QgsRectangle &bb, const QByteArray& coordString ) const;
+    /** Reads the points of a gml:coordinates string.
+       @param coordinates receives the x and y coordinates of the points, one after the other
+       @param coordString the UTF-8 text containing the coordinates
        @return 0 in case of success
       */
-    int pointsFromCoordinateString( QList<QgsPoint>& points, const QString& coordString ) const;
+    int pointsFromCoordinateString( QVector<double>& coordinates, const QByteArray& coordString ) const;
 
-    /** Creates a set of points from a gml:posList or gml:pos coordinate string.
-       @param points list that will contain the created points
-       @param coordString the text containing the coordinates
+    /** Reads the points of a gml:posList or gml:pos coordinate string.
+       @param coordinates receives the x and y coordinates of the points, one after the other
+       @param coordString the UTF-8 text containing the coordinates
        @param dimension number of dimensions
        @return 0 in case of success
       */
-    int pointsFromPosListString( QList<QgsPoint>& points, const QString& coordString, int dimension ) const;
+    int pointsFromPosListString( QVector<double>& coordinates, const QByteArray& coordString, int dimension ) const;
 
-    int pointsFromString( QList<QgsPoint>& points, const QString& coordString ) const;
-    int getPointWKB( QgsWkbPtr &wkbPtr, const QgsPoint& ) const;
-    int getLineWKB( QgsWkbPtr &wkbPtr, const QList<QgsPoint>& lineCoordinates ) const;
-    int getRingWKB( QgsWkbPtr &wkbPtr, const QList<QgsPoint>& ringCoordinates ) const;
+    int pointsFromString( QVector<double>& coordinates, const QByteArray& coordString ) const;
+    int getPointWKB( QgsWkbPtr &wkbPtr, double x, double y ) const;
+    int getLineWKB( QgsWkbPtr &wkbPtr, const QVector<double>& lineCoordinates ) const;
+    int getRingWKB( QgsWkbPtr &wkbPtr, const QVector<double>& ringCoordinates ) const;
     /** Creates a multiline from the information in mCurrentWKBFragments and
      * mCurrentWKBFragmentSizes. Assign the result. The multiline is in
      * mCurrentWKB. The function deletes the memory in
@@ -265,6 +324,8 @@ class CORE_EXPORT QgsGmlStreamingParser
     QStack<ParseMode> mParseModeStack;
     /** This contains the character data if an important element has been encountered*/
     QString mStringCash;
+    /** Character data of coordinate elements, kept as UTF-8 */
+    QByteArray mCoordinateCash;
     QgsFeature* mCurrentFeature;
     QVector<QVariant> mCurrentAttributes; //attributes of current feature
     QString mCurrentFeatureId;
@@ -280,10 +341,10 @@ class CORE_EXPORT QgsGmlStreamingParser
     QList< QList<QgsWkbPtr> > mCurrentWKBFragments;
     QString mAttributeName;
     char mEndian;
-    /** Coordinate separator for coordinate strings. Usually "," */
-    QString mCoordinateSeparator;
-    /** Tuple separator for coordinate strings. Usually " " */
-    QString mTupleSeparator;
+    /** Coordinate separator for coordinate strings, in UTF-8. Usually "," */
+    QByteArray mCoordinateSeparator;
+    /** Tuple separator for coordinate strings, in UTF-8. Usually " " */
+    QByteArray mTupleSeparator;
     /** Number of dimensions in pos or posList */
     int mDimension;
     /** Coordinates mode, coordinate or posList */
@@ -311,6 +372,21 @@ class CORE_EXPORT QgsGmlStreamingParser
     std::string mGeometryString;
     /** Whether we found a unhandled geometry element */
     bool mFoundUnhandledGeometryElement;
+
+    /** Maximum number of threads used to parse the features */
+    int mMaxThreads;
+    SplitState mSplitState;
+    /** Received data which has not been given to the expat parser or to a batch yet */
+    QByteArray mPendingData;
+    /** Position in mPendingData up to which the top level elements have been scanned */
+    int mScanPos;
+    /** Depth of the scanned data, 0 between top level elements */
+    int mScanDepth;
+    /** Prolog and start tag of the root element, and end tag of the root element */
+    QByteArray mDocumentHeader;
+    QByteArray mDocumentFooter;
+    /** Batches being parsed, in the order of the document */
+    QList<Batch*> mBatches;
 };
 
 
@@ -15,6 +15,7 @@
 
 #include "qgslabelingenginev2.h"
 
+#include "qgslabelplacementcache.h"
 #include "qgslogger.h"
 #include "qgsproject.h"
 
@@ -32,6 +33,37 @@ static bool _palIsCancelled( void* ctx )
   return ( reinterpret_cast< QgsRenderContext* >( ctx ) )->renderingStopped();
 }
 
+//! Label placements of the previous run, by label provider
+typedef QHash< QgsAbstractLabelProvider*, QgsLabelPlacementCache::FeaturePlacements > QgsProviderPlacements;
+
+// helper function fixing the candidates which are at the position of the previous run
+static bool _palIsFixedCandidate( pal::LabelPosition* lp, void* ctx )
+{
+  const QgsProviderPlacements* providerPlacements = reinterpret_cast< const QgsProviderPlacements* >( ctx );
+  QgsLabelFeature* lf = lp->getFeaturePart()->feature();
+  if ( !lf )
+    return false;
+
+  QgsProviderPlacements::const_iterator it = providerPlacements->constFind( lf->provider() );
+  if ( it == providerPlacements->constEnd() )
+    return false;
+
+  // candidates of an unchanged feature are computed the same way, only rounding errors are tolerated
+  double tolerance = 1e-6 * qMax( lp->getWidth(), lp->getHeight() );
+  QgsLabelPlacementCache::FeaturePlacements::const_iterator pit = it->constFind( lf->id() );
+  for ( ; pit != it->constEnd() && pit.key() == lf->id(); ++pit )
+  {
+    const QgsLabelPlacementCache::Placement& placement = pit.value();
+    if ( qgsDoubleNear( placement.x, lp->getX(), tolerance ) &&
+         qgsDoubleNear( placement.y, lp->getY(), tolerance ) &&
+         qgsDoubleNear( placement.width, lp->getWidth(), tolerance ) &&
+         qgsDoubleNear( placement.height, lp->getHeight(), tolerance ) &&
+         qgsDoubleNear( placement.angle, lp->getAlpha(), 1e-6 ) )
+      return true;
+  }
+  return false;
+}
+
 /** \ingroup core
  * \class QgsLabelSorter
  * Helper class for sorting labels into correct draw order
@@ -75,6 +107,7 @@ QgsLabelingEngineV2::QgsLabelingEngineV2()
     , mCandLine( 8 )
     , mCandPolygon( 8 )
     , mResults( nullptr )
+    , mPlacementCache( nullptr )
 {
   mResults = new QgsLabelingResults;
 }
@@ -210,6 +243,8 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
 
   p.setShowPartial( mFlags.testFlag( UsePartialCandidates ) );
 
+  p.setParallel( !mFlags.testFlag( SequentialPlacement ) );
+
 
   // for each provider: get labels and register them in PAL
   Q_FOREACH ( QgsAbstractLabelProvider* provider, mProviders )
@@ -217,6 +252,25 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
     processProvider( provider, context, p );
   }
 
+  // features keep the position of the previous run if it is still one of their candidates
+  QHash<QgsAbstractLabelProvider*, QString> cacheKeys;
+  QgsProviderPlacements previousPlacements;
+  if ( mPlacementCache )
+  {
+    cacheKeys = placementCacheKeys();
+    if ( mPlacementCache->init( mMapSettings.scale(), mMapSettings.rotation(), placementSettingsHash() ) )
+    {
+      for ( QHash<QgsAbstractLabelProvider*, QString>::const_iterator it = cacheKeys.constBegin(); it != cacheKeys.constEnd(); ++it )
+      {
+        QgsLabelPlacementCache::FeaturePlacements placements = mPlacementCache->placements( it.key()->layerId(), it.value() );
+        if ( !placements.isEmpty() )
+          previousPlacements.insert( it.key(), placements );
+      }
+    }
+    if ( !previousPlacements.isEmpty() )
+      p.registerFixedCandidateCallback( &_palIsFixedCandidate, reinterpret_cast< void* >( &previousPlacements ) );
+  }
+
 
   // NOW DO THE LAYOUT (from QgsPalLabeling::drawLabeling)
 
@@ -301,6 +355,32 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
     delete labels;
     return;
   }
+
+  // keep the solution for the next run, features without label are solved again
+  if ( mPlacementCache )
+  {
+    QHash<QgsAbstractLabelProvider*, QgsLabelPlacementCache::FeaturePlacements> placements;
+    Q_FOREACH ( pal::LabelPosition* lp, *labels )
+    {
+      QgsLabelFeature* lf = lp->getFeaturePart()->feature();
+      if ( !lf )
+        continue;
+
+      QgsLabelPlacementCache::Placement placement;
+      placement.x = lp->getX();
+      placement.y = lp->getY();
+      placement.width = lp->getWidth();
+      placement.height = lp->getHeight();
+      placement.angle = lp->getAlpha();
+      placements[ lf->provider() ].insert( lf->id(), placement );
+    }
+
+    for ( QHash<QgsAbstractLabelProvider*, QString>::const_iterator it = cacheKeys.constBegin(); it != cacheKeys.constEnd(); ++it )
+    {
+      mPlacementCache->setPlacements( it.key()->layerId(), it.value(), placements.value( it.key() ) );
+    }
+  }
+
   painter->setRenderHint( QPainter::Antialiasing );
 
   // sort labels
@@ -333,6 +413,33 @@ void QgsLabelingEngineV2::run( QgsRenderContext& context )
 
 }
 
+uint QgsLabelingEngineV2::placementSettingsHash() const
+{
+  // labels of features are placed the same way if the engine and output settings are the same
+  QString settings = QString( "%1|%2|%3|%4|%5|%6|%7x%8|%9" ).arg( static_cast< int >( mSearchMethod ) )
+                     .arg( mCandPoint ).arg( mCandLine ).arg( mCandPolygon )
+                     .arg( static_cast< int >( mFlags & ( UseAllLabels | UsePartialCandidates ) ) )
+                     .arg( mMapSettings.outputDpi() )
+                     .arg( mMapSettings.outputSize().width() ).arg( mMapSettings.outputSize().height() )
+                     .arg( mMapSettings.hasCrsTransformEnabled() ? mMapSettings.destinationCrs().authid() : QString() );
+  return qHash( settings );
+}
+
+QHash<QgsAbstractLabelProvider*, QString> QgsLabelingEngineV2::placementCacheKeys() const
+{
+  // providers are identified by their layer, their ID within the layer and their rank among
+  // the providers with the same IDs (e.g. labels and diagrams of a layer)
+  QHash<QgsAbstractLabelProvider*, QString> keys;
+  QHash<QString, int> keyCounts;
+  Q_FOREACH ( QgsAbstractLabelProvider* provider, mProviders + mSubProviders )
+  {
+    QString key = provider->providerId();
+    int& count = keyCounts[ provider->layerId() + '|' + key ];
+    keys.insert( provider, QString( "%1|%2" ).arg( key ).arg( count++ ) );
+  }
+  return keys;
+}
+
 QgsLabelingResults* QgsLabelingEngineV2::takeResults()
 {
   QgsLabelingResults* res = mResults;
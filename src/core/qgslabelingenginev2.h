@@ -24,6 +24,7 @@
 
 
 class QgsLabelingEngineV2;
+class QgsLabelPlacementCache;
 
 
 /** \ingroup core
@@ -174,6 +175,7 @@ class CORE_EXPORT QgsLabelingEngineV2
       DrawLabelRectOnly     = 1 << 4,  //!< Whether to only draw the label rect and not the actual label text (used for unit tests)
       DrawCandidates        = 1 << 5,  //!< Whether to draw rectangles of generated candidates (good for debugging)
       DrawShadowRects       = 1 << 6,  //!< Whether to show debugging rectangles for drop shadows
+      SequentialPlacement   = 1 << 7,  //!< Whether to place the labels in the rendering thread only instead of in parallel threads (added in QGIS 2.99)
     };
     Q_DECLARE_FLAGS( Flags, Flag )
 
@@ -216,6 +218,20 @@ class CORE_EXPORT QgsLabelingEngineV2
     //! Which search method to use for removal collisions between labels
     QgsPalLabeling::Search searchMethod() const { return mSearchMethod; }
 
+    /** Sets the cache of label placements kept between runs, the cache is not owned by the engine.
+     * Features which keep the position they had in the previous run with the same scale and
+     * settings get no other candidate, so that only new or changed features are actually solved.
+     * @see placementCache()
+     * @note added in QGIS 2.99
+     */
+    void setPlacementCache( QgsLabelPlacementCache* cache ) { mPlacementCache = cache; }
+
+    /** Returns the cache of label placements kept between runs, or null if not set.
+     * @see setPlacementCache()
+     * @note added in QGIS 2.99
+     */
+    QgsLabelPlacementCache* placementCache() const { return mPlacementCache; }
+
     //! Read configuration of the labeling engine from the current project file
     void readSettingsFromProject();
     //! Write configuration of the labeling engine to the current project file
@@ -224,6 +240,12 @@ class CORE_EXPORT QgsLabelingEngineV2
   protected:
     void processProvider( QgsAbstractLabelProvider* provider, QgsRenderContext& context, pal::Pal& p );
 
+    //! Returns a hash of the settings the label placements depend on, besides scale and rotation
+    uint placementSettingsHash() const;
+
+    //! Returns the keys identifying the label providers in the placement cache, they stay the same between runs
+    QHash<QgsAbstractLabelProvider*, QString> placementCacheKeys() const;
+
   protected:
     //! Associated map settings instance
     QgsMapSettings mMapSettings;
@@ -240,6 +262,9 @@ class CORE_EXPORT QgsLabelingEngineV2
     //! Resulting labeling layout
     QgsLabelingResults* mResults;
 
+    //! Label placements kept between runs (not owned)
+    QgsLabelPlacementCache* mPlacementCache;
+
   private:
 
     QgsLabelingEngineV2( const QgsLabelingEngineV2& rh );
@@ -0,0 +1,81 @@
+/***************************************************************************
+  qgslabelplacementcache.cpp
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgslabelplacementcache.h"
+
+#include "qgis.h"
+
+QgsLabelPlacementCache::QgsLabelPlacementCache()
+    : mScale( 0 )
+    , mRotation( 0 )
+    , mSettingsHash( 0 )
+{
+}
+
+void QgsLabelPlacementCache::clear()
+{
+  QMutexLocker lock( &mMutex );
+  mPlacements.clear();
+}
+
+bool QgsLabelPlacementCache::init( double scale, double rotation, uint settingsHash )
+{
+  QMutexLocker lock( &mMutex );
+
+  if ( qgsDoubleNear( scale, mScale ) && qgsDoubleNear( rotation, mRotation ) && settingsHash == mSettingsHash )
+    return true;
+
+  mScale = scale;
+  mRotation = rotation;
+  mSettingsHash = settingsHash;
+  mPlacements.clear();
+  return false;
+}
+
+void QgsLabelPlacementCache::setPlacements( const QString& layerId, const QString& providerKey, const FeaturePlacements& placements )
+{
+  QMutexLocker lock( &mMutex );
+  if ( placements.isEmpty() )
+  {
+    QHash< QString, QHash< QString, FeaturePlacements > >::iterator it = mPlacements.find( layerId );
+    if ( it != mPlacements.end() )
+    {
+      it->remove( providerKey );
+      if ( it->isEmpty() )
+        mPlacements.erase( it );
+    }
+  }
+  else
+  {
+    mPlacements[ layerId ].insert( providerKey, placements );
+  }
+}
+
+QgsLabelPlacementCache::FeaturePlacements QgsLabelPlacementCache::placements( const QString& layerId, const QString& providerKey ) const
+{
+  QMutexLocker lock( &mMutex );
+  return mPlacements.value( layerId ).value( providerKey );
+}
+
+void QgsLabelPlacementCache::clearLayer( const QString& layerId )
+{
+  QMutexLocker lock( &mMutex );
+  mPlacements.remove( layerId );
+}
+
+bool QgsLabelPlacementCache::isEmpty() const
+{
+  QMutexLocker lock( &mMutex );
+  return mPlacements.isEmpty();
+}
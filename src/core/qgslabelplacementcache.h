@@ -0,0 +1,105 @@
+/***************************************************************************
+  qgslabelplacementcache.h
+  --------------------------------------
+  Date                 : October 2016
+  Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSLABELPLACEMENTCACHE_H
+#define QGSLABELPLACEMENTCACHE_H
+
+#include <QHash>
+#include <QMultiHash>
+#include <QMutex>
+#include <QString>
+
+#include "qgsfeature.h"
+
+/** \ingroup core
+ * @class QgsLabelPlacementCache
+ * @brief Keeps the label placements computed by the labeling engine between consecutive renders.
+ *
+ * After solving, QgsLabelingEngineV2 stores the position of every placed label, per label provider
+ * and feature. On the next run with the same scale, rotation and engine settings, a feature whose
+ * stored position is still one of its candidates keeps that position as its only candidate, so
+ * that the labels are stable while panning and only new or changed features are actually solved.
+ *
+ * Placements of the features outside of the last rendered extent are dropped. The cache is cleared
+ * when the parameters given to init() change, and the placements of a layer should be removed with
+ * clearLayer() when the layer's data or style change.
+ *
+ * The class is thread-safe.
+ *
+ * @note this class is not a part of public API yet. See notes in QgsLabelingEngineV2
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsLabelPlacementCache
+{
+  public:
+
+    //! Position of a placed label, in map units (unrotated, as in pal)
+    struct Placement
+    {
+      //! X coordinate of the first corner of the label
+      double x;
+      //! Y coordinate of the first corner of the label
+      double y;
+      double width;
+      double height;
+      //! Angle of the label, in radians
+      double angle;
+    };
+
+    //! Placed labels of a label provider, by feature id (several labels if labeling each feature part)
+    typedef QMultiHash<QgsFeatureId, Placement> FeaturePlacements;
+
+    QgsLabelPlacementCache();
+
+    //! Removes all the placements
+    void clear();
+
+    /** Sets the parameters of the placements stored and retrieved from now on, the placements
+     * computed with other parameters are removed.
+     * @param scale map scale
+     * @param rotation map rotation, in degrees
+     * @param settingsHash hash of the other settings the placements depend on (labeling engine, output)
+     * @returns true if the parameters are the same as last time
+     */
+    bool init( double scale, double rotation, uint settingsHash );
+
+    /** Replaces the placements of a label provider
+     * @param layerId ID of the provider's layer
+     * @param providerKey key identifying the provider within the layer
+     * @param placements placed labels of the provider
+     */
+    void setPlacements( const QString& layerId, const QString& providerKey, const FeaturePlacements& placements );
+
+    //! Returns the placements of a label provider, see setPlacements()
+    FeaturePlacements placements( const QString& layerId, const QString& providerKey ) const;
+
+    //! Removes the placements of all the label providers of a layer
+    void clearLayer( const QString& layerId );
+
+    //! Returns true if there is no placement stored
+    bool isEmpty() const;
+
+  private:
+
+    mutable QMutex mMutex;
+    double mScale;
+    double mRotation;
+    uint mSettingsHash;
+
+    //! placements by layer ID and provider key
+    QHash< QString, QHash< QString, FeaturePlacements > > mPlacements;
+};
+
+#endif // QGSLABELPLACEMENTCACHE_H
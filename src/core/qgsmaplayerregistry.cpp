@@ -19,15 +19,28 @@
 #include "qgsmaplayer.h"
 #include "qgslogger.h"
 
+#include <QThreadStorage>
+
+static QThreadStorage< QgsMapLayerRegistry* > sThreadInstances;
+
 //
 // Static calls to enforce singleton behaviour
 //
 QgsMapLayerRegistry *QgsMapLayerRegistry::instance()
 {
+  if ( sThreadInstances.hasLocalData() )
+    return sThreadInstances.localData();
+
   static QgsMapLayerRegistry sInstance;
   return &sInstance;
 }
 
+void QgsMapLayerRegistry::createThreadInstance()
+{
+  if ( !sThreadInstances.hasLocalData() )
+    sThreadInstances.setLocalData( new QgsMapLayerRegistry() );
+}
+
 QgsMapLayerRegistry::QgsMapLayerRegistry( QObject *parent )
     : QObject( parent )
 {}
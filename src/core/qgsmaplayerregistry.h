@@ -40,6 +40,13 @@ class CORE_EXPORT QgsMapLayerRegistry : public QObject
     //! Returns the instance pointer, creating the object on the first call
     static QgsMapLayerRegistry * instance();
 
+    /** Creates a registry for the calling thread, returned by instance() on this thread from
+     * now on and deleted when the thread exits. Used by servers which process requests in
+     * parallel, each thread loading its own layers.
+     * @note added in QGIS 2.99
+     */
+    static void createThreadInstance();
+
     ~QgsMapLayerRegistry();
 
     //! Returns the number of registered layers.
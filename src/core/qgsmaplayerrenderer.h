@@ -55,8 +55,15 @@ class CORE_EXPORT QgsMapLayerRenderer
     //! Get access to the ID of the layer rendered by this class
     QString layerId() const { return mLayerID; }
 
+    /** Return details about where the rendering time was spent, logged by the rendering job
+     * with the rendering time of the layer
+     * @note added in QGIS 2.99
+     */
+    QStringList timingDetails() const { return mTimingDetails; }
+
   protected:
     QStringList mErrors;
+    QStringList mTimingDetails;
     QString mLayerID;
 };
 
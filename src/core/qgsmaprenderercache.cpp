@@ -18,7 +18,18 @@
 #include "qgsmaplayerregistry.h"
 #include "qgsmaplayer.h"
 
+#include <QSet>
+
+//! default maximum size of the cached images, in bytes
+static const qint64 DEFAULT_MAXIMUM_CACHE_SIZE = 256 * 1024 * 1024;
+//! largest distance in pixels of the offset of a panned image to a whole number of pixels
+static const double PAN_OFFSET_TOLERANCE = 0.01;
+
 QgsMapRendererCache::QgsMapRendererCache()
+    : mScale( 0 )
+    , mOutputDpi( 0 )
+    , mSize( 0 )
+    , mMaximumSize( DEFAULT_MAXIMUM_CACHE_SIZE )
 {
   clear();
 }
@@ -33,69 +44,208 @@ void QgsMapRendererCache::clearInternal()
 {
   mExtent.setMinimal();
   mScale = 0;
+  mOutputSize = QSize();
+  mOutputDpi = 0;
 
   // make sure we are disconnected from all layers
-  QMap<QString, QImage>::const_iterator it = mCachedImages.constBegin();
-  for ( ; it != mCachedImages.constEnd(); ++it )
+  QSet<QString> layerIds;
+  Q_FOREACH ( const CacheEntry& entry, mEntries )
+    layerIds << entry.layerId;
+
+  Q_FOREACH ( const QString& layerId, layerIds )
   {
-    QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( it.key() );
+    QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
     if ( layer )
     {
       disconnect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerRequestedRepaint() ) );
     }
   }
-  mCachedImages.clear();
+  mEntries.clear();
+  mSize = 0;
+  mLabelPlacementCache.clear();
 }
 
-bool QgsMapRendererCache::init( const QgsRectangle& extent, double scale )
+bool QgsMapRendererCache::init( const QgsRectangle& extent, double scale, const QSize& outputSize, double outputDpi )
 {
   QMutexLocker lock( &mMutex );
 
   // check whether the params are the same
   if ( extent == mExtent &&
-       qgsDoubleNear( scale, mScale ) )
+       qgsDoubleNear( scale, mScale ) &&
+       outputSize == mOutputSize &&
+       qgsDoubleNear( outputDpi, mOutputDpi ) )
     return true;
 
-  clearInternal();
-
-  // set new params
+  // set new params, images of the previous ones are kept for reuse
   mExtent = extent;
   mScale = scale;
+  mOutputSize = outputSize;
+  mOutputDpi = outputDpi;
 
   return false;
 }
 
-void QgsMapRendererCache::setCacheImage( const QString& layerId, const QImage& img )
+bool QgsMapRendererCache::sameOutput( const CacheEntry& entry ) const
+{
+  return qgsDoubleNear( entry.scale, mScale ) && entry.outputSize == mOutputSize && qgsDoubleNear( entry.outputDpi, mOutputDpi );
+}
+
+void QgsMapRendererCache::setCacheImage( const QString& layerId, const QImage& img, const QString& style )
 {
   QMutexLocker lock( &mMutex );
-  mCachedImages[layerId] = img;
+
+  CacheEntry entry;
+  entry.layerId = layerId;
+  entry.styleHash = qHash( style );
+  entry.extent = mExtent;
+  entry.scale = mScale;
+  entry.outputSize = mOutputSize;
+  entry.outputDpi = mOutputDpi;
+  entry.image = img;
+
+  // replace the image rendered with the same params
+  for ( QList<CacheEntry>::iterator it = mEntries.begin(); it != mEntries.end(); ++it )
+  {
+    if ( it->layerId == layerId && it->styleHash == entry.styleHash && it->extent == mExtent && sameOutput( *it ) )
+    {
+      mSize -= it->image.byteCount();
+      mEntries.erase( it );
+      break;
+    }
+  }
+
+  mEntries.prepend( entry );
+  mSize += img.byteCount();
 
   // connect to the layer to listen to layer's repaintRequested() signals
   QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
   if ( layer )
   {
-    connect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerRequestedRepaint() ) );
+    connect( layer, SIGNAL( repaintRequested() ), this, SLOT( layerRequestedRepaint() ), Qt::UniqueConnection );
   }
+
+  trimInternal();
+}
+
+QImage QgsMapRendererCache::cacheImage( const QString& layerId, const QString& style )
+{
+  QMutexLocker lock( &mMutex );
+
+  uint styleHash = qHash( style );
+  for ( int i = 0; i < mEntries.count(); ++i )
+  {
+    const CacheEntry& entry = mEntries.at( i );
+    if ( entry.layerId == layerId && entry.styleHash == styleHash && entry.extent == mExtent && sameOutput( entry ) )
+    {
+      QImage image = entry.image;
+      mEntries.move( i, 0 );
+      return image;
+    }
+  }
+  return QImage();
 }
 
-QImage QgsMapRendererCache::cacheImage( const QString& layerId )
+QImage QgsMapRendererCache::pannedCacheImage( const QString& layerId, QPoint& offset, const QString& style )
 {
   QMutexLocker lock( &mMutex );
-  return mCachedImages.value( layerId );
+
+  if ( mExtent.isEmpty() )
+    return QImage();
+
+  uint styleHash = qHash( style );
+  for ( int i = 0; i < mEntries.count(); ++i )
+  {
+    const CacheEntry& entry = mEntries.at( i );
+    if ( entry.layerId != layerId || entry.styleHash != styleHash || entry.image.isNull() || !sameOutput( entry ) )
+      continue;
+
+    // the image must cover an extent of the same size...
+    double mupp = entry.extent.width() / entry.image.width();
+    if ( !qgsDoubleNear( entry.extent.width(), mExtent.width(), mupp * PAN_OFFSET_TOLERANCE ) ||
+         !qgsDoubleNear( entry.extent.height(), mExtent.height(), mupp * PAN_OFFSET_TOLERANCE ) )
+      continue;
+
+    // ... shifted by a whole number of pixels, so that it can be copied without resampling
+    double dx = ( entry.extent.xMinimum() - mExtent.xMinimum() ) / mupp;
+    double dy = ( mExtent.yMaximum() - entry.extent.yMaximum() ) / mupp;
+    int x = qRound( dx );
+    int y = qRound( dy );
+    if ( !qgsDoubleNear( dx, x, PAN_OFFSET_TOLERANCE ) || !qgsDoubleNear( dy, y, PAN_OFFSET_TOLERANCE ) )
+      continue;
+
+    // exact matches are returned by cacheImage(), images outside of the map are useless
+    if ( ( x == 0 && y == 0 ) || qAbs( x ) >= entry.image.width() || qAbs( y ) >= entry.image.height() )
+      continue;
+
+    offset = QPoint( x, y );
+    QImage image = entry.image;
+    mEntries.move( i, 0 );
+    return image;
+  }
+  return QImage();
 }
 
 void QgsMapRendererCache::layerRequestedRepaint()
 {
   QgsMapLayer* layer = qobject_cast<QgsMapLayer*>( sender() );
   if ( layer )
+  {
     clearCacheImage( layer->id() );
+    mLabelPlacementCache.clearLayer( layer->id() );
+  }
 }
 
 void QgsMapRendererCache::clearCacheImage( const QString& layerId )
 {
   QMutexLocker lock( &mMutex );
 
-  mCachedImages.remove( layerId );
+  QList<CacheEntry>::iterator it = mEntries.begin();
+  while ( it != mEntries.end() )
+  {
+    if ( it->layerId == layerId )
+    {
+      mSize -= it->image.byteCount();
+      it = mEntries.erase( it );
+    }
+    else
+    {
+      ++it;
+    }
+  }
+
+  releaseLayerInternal( layerId );
+}
+
+void QgsMapRendererCache::setMaximumCacheSize( qint64 bytes )
+{
+  QMutexLocker lock( &mMutex );
+  mMaximumSize = bytes;
+  trimInternal();
+}
+
+qint64 QgsMapRendererCache::cacheSize()
+{
+  QMutexLocker lock( &mMutex );
+  return mSize;
+}
+
+void QgsMapRendererCache::trimInternal()
+{
+  while ( mSize > mMaximumSize && !mEntries.isEmpty() )
+  {
+    CacheEntry entry = mEntries.takeLast();
+    mSize -= entry.image.byteCount();
+    releaseLayerInternal( entry.layerId );
+  }
+}
+
+void QgsMapRendererCache::releaseLayerInternal( const QString& layerId )
+{
+  Q_FOREACH ( const CacheEntry& entry, mEntries )
+  {
+    if ( entry.layerId == layerId )
+      return;
+  }
 
   QgsMapLayer* layer = QgsMapLayerRegistry::instance()->mapLayer( layerId );
   if ( layer )
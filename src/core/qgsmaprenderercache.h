@@ -16,10 +16,13 @@
 #ifndef QGSMAPRENDERERCACHE_H
 #define QGSMAPRENDERERCACHE_H
 
-#include <QMap>
+#include <QList>
 #include <QImage>
 #include <QMutex>
+#include <QPoint>
+#include <QSize>
 
+#include "qgslabelplacementcache.h"
 #include "qgsrectangle.h"
 
 
@@ -28,7 +31,16 @@
  *
  * Once a layer has rendered image stored in the cache (using setCacheImage(...)),
  * the cache listens to repaintRequested() signals from layer. If triggered, the cache
- * removes the rendered image (and disconnects from the layer).
+ * removes the rendered images (and disconnects from the layer).
+ *
+ * Images are stored for the map extent, scale, output size and DPI the cache has been initialized
+ * with (see init()) and the style they have been rendered with. Images of previous extents are
+ * kept until the total size of the cached images exceeds maximumCacheSize(), least recently
+ * used images are discarded first. An image rendered at the same scale for a panned extent
+ * may be retrieved with pannedCacheImage() so that only the newly exposed part of the map
+ * needs to be rendered.
+ *
+ * The cache also keeps the label placements of the last render, see labelPlacementCache().
  *
  * The class is thread-safe (multiple classes can access the same instance safely).
  *
@@ -44,19 +56,62 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     //! invalidate the cache contents
     void clear();
 
-    //! initialize cache: set new parameters and erase cache if parameters have changed
+    //! initialize cache: set new parameters for the images stored and retrieved from now on
+    //! @param extent map extent
+    //! @param scale map scale
+    //! @param outputSize size of the rendered images, in pixels (added in QGIS 2.99)
+    //! @param outputDpi DPI of the rendered images (added in QGIS 2.99)
     //! @return flag whether the parameters are the same as last time
-    bool init( const QgsRectangle& extent, double scale );
+    bool init( const QgsRectangle& extent, double scale, const QSize& outputSize = QSize(), double outputDpi = 0 );
 
     //! set cached image for the specified layer ID
-    void setCacheImage( const QString& layerId, const QImage& img );
+    //! @param layerId layer ID
+    //! @param img rendered image
+    //! @param style style override the layer was rendered with (added in QGIS 2.99)
+    void setCacheImage( const QString& layerId, const QImage& img, const QString& style = QString() );
 
     //! get cached image for the specified layer ID. Returns null image if it is not cached.
-    QImage cacheImage( const QString& layerId );
+    //! @param layerId layer ID
+    //! @param style style override the layer is rendered with (added in QGIS 2.99)
+    QImage cacheImage( const QString& layerId, const QString& style = QString() );
+
+    /** Returns an image of the layer rendered at the current scale, output size and DPI for a panned extent of the same size.
+     * @param layerId layer ID
+     * @param offset receives the position of the top left corner of the returned image in the current map image
+     * @param style style override the layer is rendered with
+     * @returns cached image, or a null image if there is no image overlapping the current extent
+     * @note added in QGIS 2.99
+     */
+    QImage pannedCacheImage( const QString& layerId, QPoint& offset, const QString& style = QString() );
 
     //! remove layer from the cache
     void clearCacheImage( const QString& layerId );
 
+    /** Sets the maximum size of the cached images, in bytes. Least recently used images are
+     * discarded when the size is exceeded.
+     * @see maximumCacheSize()
+     * @note added in QGIS 2.99
+     */
+    void setMaximumCacheSize( qint64 bytes );
+
+    /** Returns the maximum size of the cached images, in bytes.
+     * @see setMaximumCacheSize()
+     * @note added in QGIS 2.99
+     */
+    qint64 maximumCacheSize() const { return mMaximumSize; }
+
+    /** Returns the total size of the cached images, in bytes.
+     * @note added in QGIS 2.99
+     */
+    qint64 cacheSize();
+
+    /** Returns the cache of label placements used by the labeling engine of the render jobs.
+     * The placements of a layer are removed when the layer requests a repaint.
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    QgsLabelPlacementCache* labelPlacementCache() { return &mLabelPlacementCache; }
+
   protected slots:
     //! remove layer (that emitted the signal) from the cache
     void layerRequestedRepaint();
@@ -65,11 +120,39 @@ class CORE_EXPORT QgsMapRendererCache : public QObject
     //! invalidate cache contents (without locking)
     void clearInternal();
 
+    //! discard least recently used images until the cache fits in its maximum size (without locking)
+    void trimInternal();
+
+    //! disconnect from a layer which does not have any cached image anymore (without locking)
+    void releaseLayerInternal( const QString& layerId );
+
   protected:
+
+    //! A cached image and the parameters it has been rendered with
+    struct CacheEntry
+    {
+      QString layerId;
+      uint styleHash;
+      QgsRectangle extent;
+      double scale;
+      QSize outputSize;
+      double outputDpi;
+      QImage image;
+    };
+
+    //! returns true if the image of the entry has been rendered at the current scale, output size and DPI
+    bool sameOutput( const CacheEntry& entry ) const;
+
     QMutex mMutex;
     QgsRectangle mExtent;
     double mScale;
-    QMap<QString, QImage> mCachedImages;
+    QSize mOutputSize;
+    double mOutputDpi;
+    //! cached images, most recently used first
+    QList<CacheEntry> mEntries;
+    qint64 mSize;
+    qint64 mMaximumSize;
+    QgsLabelPlacementCache mLabelPlacementCache;
 };
 
 
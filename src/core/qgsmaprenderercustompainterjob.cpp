@@ -257,7 +257,7 @@ void QgsMapRendererCustomPainterJob::doRender()
     if ( job.img )
     {
       // If we flattened this layer for alternate blend modes, composite it now
-      mPainter->drawImage( 0, 0, *job.img );
+      mPainter->drawImage( job.tileRect.topLeft(), *job.img );
     }
 
   }
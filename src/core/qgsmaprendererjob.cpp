@@ -16,11 +16,14 @@
 #include "qgsmaprendererjob.h"
 
 #include <QPainter>
+#include <QRegion>
+#include <QSet>
 #include <QTime>
 #include <QTimer>
 #include <QtConcurrentMap>
 #include <QSettings>
 
+#include "qgslabelingenginev2.h"
 #include "qgslogger.h"
 #include "qgsrendercontext.h"
 #include "qgsmaplayer.h"
@@ -30,10 +33,71 @@
 #include "qgsmaprenderercache.h"
 #include "qgsmessagelog.h"
 #include "qgspallabeling.h"
+#include "qgsmarkersymbollayerv2.h"
+#include "qgspainteffect.h"
+#include "qgsrendererv2.h"
+#include "qgssymbollayerv2utils.h"
 #include "qgsvectorlayerrenderer.h"
 #include "qgsvectorlayer.h"
 #include "qgscsexception.h"
 
+#include <qmath.h>
+
+//! margin of a tile in pixels where features outside of the tile are still requested, when the extent of the symbols is not known
+static const int TILE_REQUEST_MARGIN = 64;
+//! pixels added to the estimated extent of the symbols, for antialiasing
+static const int TILE_ANTIALIASING_MARGIN = 2;
+
+///@cond PRIVATE
+
+//! converts a distance in symbol units to pixels, mixed units are handled as millimeters
+static double symbolDistanceToPixels( const QgsRenderContext& context, double distance, QgsSymbolV2::OutputUnit unit, const QgsMapUnitScale& scale )
+{
+  if ( unit == QgsSymbolV2::Mixed )
+    unit = QgsSymbolV2::MM;
+  return QgsSymbolLayerV2Utils::convertToPainterUnits( context, distance, unit, scale );
+}
+
+/** Returns the estimated distance in pixels which the symbols of a layer may reach outside of
+ * the features, that is the margin of the map parts where features outside of the part are still requested.
+ */
+static int tileRequestMargin( QgsMapLayer* ml, QgsRenderContext& context )
+{
+  QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( ml );
+  if ( !vl || !vl->rendererV2() )
+    return TILE_REQUEST_MARGIN;
+
+  double margin = 0;
+  Q_FOREACH ( QgsSymbolV2* symbol, vl->rendererV2()->symbols( context ) )
+  {
+    for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+    {
+      QgsSymbolLayerV2* layer = symbol->symbolLayer( i );
+
+      // data defined sizes and offsets or effects such as shadows are only known while drawing
+      if ( layer->hasDataDefinedProperties() || ( layer->paintEffect() && layer->paintEffect()->enabled() ) )
+        return TILE_REQUEST_MARGIN;
+
+      double layerMargin = symbolDistanceToPixels( context, layer->estimateMaxBleed(), layer->outputUnit(), layer->mapUnitScale() );
+      if ( symbol->type() == QgsSymbolV2::Marker )
+      {
+        // half of the diagonal of the marker, whatever its rotation, plus its offset
+        QgsMarkerSymbolLayerV2* marker = static_cast<QgsMarkerSymbolLayerV2*>( layer );
+        const QPointF offset = marker->offset();
+        double markerMargin = symbolDistanceToPixels( context, marker->size(), marker->sizeUnit(), marker->sizeMapUnitScale() ) * sqrt( 2.0 ) / 2.0
+                              + symbolDistanceToPixels( context, sqrt( offset.x() * offset.x() + offset.y() * offset.y() ), marker->offsetUnit(), marker->offsetMapUnitScale() );
+        if ( QgsSimpleMarkerSymbolLayerV2* simpleMarker = dynamic_cast<QgsSimpleMarkerSymbolLayerV2*>( marker ) )
+          markerMargin += symbolDistanceToPixels( context, simpleMarker->outlineWidth() / 2.0, simpleMarker->outlineWidthUnit(), simpleMarker->outlineWidthMapUnitScale() );
+        layerMargin = qMax( layerMargin, markerMargin );
+      }
+      margin = qMax( margin, layerMargin );
+    }
+  }
+  return qCeil( margin ) + TILE_ANTIALIASING_MARGIN;
+}
+
+///@endcond
+
 QgsMapRendererJob::QgsMapRendererJob( const QgsMapSettings& settings )
     : mSettings( settings )
     , mCache( nullptr )
@@ -178,9 +242,13 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsLabelingEn
 
   if ( mCache )
   {
-    bool cacheValid = mCache->init( mSettings.visibleExtent(), mSettings.scale() );
+    bool cacheValid = mCache->init( mSettings.visibleExtent(), mSettings.scale(), mSettings.outputSize(), mSettings.outputDpi() );
     QgsDebugMsg( QString( "CACHE VALID: %1" ).arg( cacheValid ) );
     Q_UNUSED( cacheValid );
+
+    // labels keep their positions across renders of the same cache
+    if ( labelingEngine2 )
+      labelingEngine2->setPlacementCache( mCache->labelPlacementCache() );
   }
 
   mGeometryCaches.clear();
@@ -255,15 +323,27 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsLabelingEn
     job.context.setExtent( r1 );
 
     // if we can use the cache, let's do it and avoid rendering!
-    if ( mCache && !mCache->cacheImage( ml->id() ).isNull() )
+    if ( mCache )
     {
-      job.cached = true;
-      job.img = new QImage( mCache->cacheImage( ml->id() ) );
-      job.renderer = nullptr;
-      job.context.setPainter( nullptr );
-      continue;
+      QImage cachedImage = mCache->cacheImage( ml->id(), mSettings.layerStyleOverrides().value( ml->id() ) );
+      if ( !cachedImage.isNull() )
+      {
+        job.cached = true;
+        job.img = new QImage( cachedImage );
+        job.renderer = nullptr;
+        job.context.setPainter( nullptr );
+        continue;
+      }
+
+      // reuse the image rendered for a panned extent, only the exposed parts are rendered
+      if ( preparePannedJobs( layerJobs, ml ) )
+        continue;
     }
 
+    // split expensive layers into tiles rendered by separate jobs
+    if ( prepareTileJobs( layerJobs, ml, labelingEngine2 ) )
+      continue;
+
     // If we are drawing with an alternative blending mode then we need to render to a separate image
     // before compositing this on the map. This effectively flattens the layer and prevents
     // blending occurring between objects on the layer
@@ -312,8 +392,150 @@ LayerRenderJobs QgsMapRendererJob::prepareJobs( QPainter* painter, QgsLabelingEn
 }
 
 
+int QgsMapRendererJob::layerTileCount( QgsMapLayer* ml, QgsLabelingEngineV2* labelingEngine2 ) const
+{
+  Q_UNUSED( ml );
+  Q_UNUSED( labelingEngine2 );
+  return 1;
+}
+
+
+bool QgsMapRendererJob::prepareTileJobs( LayerRenderJobs& layerJobs, QgsMapLayer* ml, QgsLabelingEngineV2* labelingEngine2 )
+{
+  bool hasStyleOverride = mSettings.layerStyleOverrides().contains( ml->id() );
+  if ( hasStyleOverride )
+    ml->styleManager()->setOverrideStyle( mSettings.layerStyleOverrides().value( ml->id() ) );
+
+  int tileCount = layerTileCount( ml, labelingEngine2 );
+
+  if ( hasStyleOverride )
+    ml->styleManager()->restoreOverrideStyle();
+
+  if ( tileCount <= 1 )
+    return false;
+
+  const QSize size = mSettings.outputSize();
+  const int columns = qCeil( sqrt( static_cast< double >( tileCount ) ) );
+  const int rows = qCeil( static_cast< double >( tileCount ) / columns );
+
+  QgsDebugMsgLevel( QString( "Rendering layer %1 in %2x%3 tiles" ).arg( ml->id() ).arg( columns ).arg( rows ), 2 );
+
+  QVector<QRect> tiles;
+  for ( int row = 0; row < rows; ++row )
+  {
+    for ( int column = 0; column < columns; ++column )
+    {
+      QRect rect( QPoint( size.width() * column / columns, size.height() * row / rows ),
+                  QPoint( size.width() * ( column + 1 ) / columns - 1, size.height() * ( row + 1 ) / rows - 1 ) );
+      if ( !rect.isEmpty() )
+        tiles << rect;
+    }
+  }
+
+  LayerRenderJob layerJob = layerJobs.takeLast();
+  prepareRegionJobs( layerJobs, layerJob, ml, tiles );
+  return true;
+}
+
+
+bool QgsMapRendererJob::preparePannedJobs( LayerRenderJobs& layerJobs, QgsMapLayer* ml )
+{
+  // strips of raster layers would not be resampled on the grid of the cached image
+  if ( ml->type() != QgsMapLayer::VectorLayer || !qgsDoubleNear( mSettings.rotation(), 0.0 ) )
+    return false;
+
+  QPoint offset;
+  QImage cachedImage = mCache->pannedCacheImage( ml->id(), offset, mSettings.layerStyleOverrides().value( ml->id() ) );
+  if ( cachedImage.isNull() )
+    return false;
+
+  const QRect mapRect( QPoint( 0, 0 ), mSettings.outputSize() );
+  const QRect reusedRect = mapRect & QRect( offset, cachedImage.size() );
+  if ( reusedRect.isEmpty() )
+    return false;
+
+  QgsDebugMsgLevel( QString( "Reusing cached image of layer %1 panned by %2,%3" ).arg( ml->id() ).arg( offset.x() ).arg( offset.y() ), 2 );
+
+  LayerRenderJob layerJob = layerJobs.last();
+
+  LayerRenderJob& job = layerJobs.last();
+  job.cached = true;
+  job.img = new QImage( cachedImage.copy( reusedRect.translated( -offset ) ) );
+  job.tileRect = reusedRect;
+  job.renderer = nullptr;
+  job.context.setPainter( nullptr );
+
+  prepareRegionJobs( layerJobs, layerJob, ml, QRegion( mapRect ).subtracted( reusedRect ).rects() );
+  return true;
+}
+
+
+void QgsMapRendererJob::prepareRegionJobs( LayerRenderJobs& layerJobs, const LayerRenderJob& layerJob, QgsMapLayer* ml, const QVector<QRect>& rects )
+{
+  bool hasStyleOverride = mSettings.layerStyleOverrides().contains( ml->id() );
+  if ( hasStyleOverride )
+    ml->styleManager()->setOverrideStyle( mSettings.layerStyleOverrides().value( ml->id() ) );
+
+  QgsCoordinateTransform ct = layerJob.context.coordinateTransform();
+  const QgsMapToPixel& mtp = mSettings.mapToPixel();
+  const double mupp = mtp.mapUnitsPerPixel();
+
+  QgsRenderContext symbolContext = layerJob.context;
+  const int margin = tileRequestMargin( ml, symbolContext );
+  QgsDebugMsgLevel( QString( "Requesting features %1 pixels around the parts of layer %2" ).arg( margin ).arg( ml->id() ), 2 );
+
+  Q_FOREACH ( const QRect& rect, rects )
+  {
+    QgsPoint topLeft = mtp.toMapCoordinates( rect.left(), rect.top() );
+    QgsPoint bottomRight = mtp.toMapCoordinates( rect.right() + 1, rect.bottom() + 1 );
+    QgsRectangle tileExtent( topLeft.x(), bottomRight.y(), bottomRight.x(), topLeft.y() );
+
+    // features straddling the tile border are requested by every tile they touch, each
+    // tile only keeps the part of the symbols which falls inside of its image
+    QgsRectangle r1 = tileExtent.buffer( margin * mupp ), r2;
+    if ( ct.isValid() )
+    {
+      reprojectToLayerExtent( ml, ct, r1, r2 );
+      if ( !r1.isFinite() || !r2.isFinite() )
+        r1 = layerJob.context.extent();
+    }
+
+    QImage* img = new QImage( rect.size(), mSettings.outputImageFormat() );
+    if ( img->isNull() )
+    {
+      mErrors.append( Error( ml->id(), tr( "Insufficient memory for image %1x%2" ).arg( rect.width() ).arg( rect.height() ) ) );
+      delete img;
+      continue;
+    }
+    img->fill( 0 );
+
+    layerJobs.append( layerJob );
+    LayerRenderJob& job = layerJobs.last();
+    job.img = img;
+    job.tileRect = rect;
+    job.context.setMapToPixel( QgsMapToPixel( mupp, tileExtent.center().x(), tileExtent.center().y(), rect.width(), rect.height(), 0.0 ) );
+    job.context.setExtent( r1 );
+    // no clipping to the tile extent, keeps fill patterns aligned between tiles
+    job.context.setFlag( QgsRenderContext::RenderMapTile, true );
+
+    QPainter* painter = new QPainter( job.img );
+    painter->setRenderHint( QPainter::Antialiasing, mSettings.testFlag( QgsMapSettings::Antialiasing ) );
+    job.context.setPainter( painter );
+
+    job.renderer = ml->createMapRenderer( job.context );
+  }
+
+  if ( hasStyleOverride )
+    ml->styleManager()->restoreOverrideStyle();
+}
+
+
 void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
 {
+  // tiles of a layer are assembled before being cached
+  QMap<QString, QImage> tiledImages;
+  QSet<QString> incompleteLayers;
+
   for ( LayerRenderJobs::iterator it = jobs.begin(); it != jobs.end(); ++it )
   {
     LayerRenderJob& job = *it;
@@ -322,10 +544,31 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
       delete job.context.painter();
       job.context.setPainter( nullptr );
 
-      if ( mCache && !job.cached && !job.context.renderingStopped() )
+      if ( mCache )
       {
-        QgsDebugMsg( "caching image for " + job.layerId );
-        mCache->setCacheImage( job.layerId, *job.img );
+        if ( job.tileRect.isNull() )
+        {
+          if ( !job.cached && !job.context.renderingStopped() )
+          {
+            QgsDebugMsg( "caching image for " + job.layerId );
+            mCache->setCacheImage( job.layerId, *job.img, mSettings.layerStyleOverrides().value( job.layerId ) );
+          }
+        }
+        else if ( job.context.renderingStopped() )
+        {
+          incompleteLayers << job.layerId;
+        }
+        else
+        {
+          QImage& image = tiledImages[ job.layerId ];
+          if ( image.isNull() )
+          {
+            image = QImage( mSettings.outputSize(), mSettings.outputImageFormat() );
+            image.fill( 0 );
+          }
+          QPainter painter( &image );
+          painter.drawImage( job.tileRect.topLeft(), *job.img );
+        }
       }
 
       delete job.img;
@@ -344,6 +587,15 @@ void QgsMapRendererJob::cleanupJobs( LayerRenderJobs& jobs )
 
   jobs.clear();
 
+  for ( QMap<QString, QImage>::const_iterator it = tiledImages.constBegin(); it != tiledImages.constEnd(); ++it )
+  {
+    if ( incompleteLayers.contains( it.key() ) )
+      continue;
+
+    QgsDebugMsg( "caching tiled image for " + it.key() );
+    mCache->setCacheImage( it.key(), it.value(), mSettings.layerStyleOverrides().value( it.key() ) );
+  }
+
   updateLayerGeometryCaches();
 }
 
@@ -362,7 +614,7 @@ QImage QgsMapRendererJob::composeImage( const QgsMapSettings& settings, const La
     painter.setCompositionMode( job.blendMode );
 
     Q_ASSERT( job.img );
-    painter.drawImage( 0, 0, *job.img );
+    painter.drawImage( job.tileRect.topLeft(), *job.img );
   }
 
   painter.end();
@@ -371,13 +623,26 @@ QImage QgsMapRendererJob::composeImage( const QgsMapSettings& settings, const La
 
 void QgsMapRendererJob::logRenderingTime( const LayerRenderJobs& jobs )
 {
+  // the times of the tiles and parts of a layer add up, layers taken from the cache stay at -1
+  mPerLayerRenderingTime.clear();
+  Q_FOREACH ( const LayerRenderJob& job, jobs )
+  {
+    if ( !mPerLayerRenderingTime.contains( job.layerId ) )
+      mPerLayerRenderingTime.insert( job.layerId, -1 );
+    if ( job.renderingTime >= 0 )
+    {
+      int& time = mPerLayerRenderingTime[ job.layerId ];
+      time = qMax( time, 0 ) + job.renderingTime;
+    }
+  }
+
   QSettings settings;
   if ( !settings.value( "/Map/logCanvasRefreshEvent", false ).toBool() )
     return;
 
   QMultiMap<int, QString> elapsed;
-  Q_FOREACH ( const LayerRenderJob& job, jobs )
-    elapsed.insert( job.renderingTime, job.layerId );
+  for ( QMap<QString, int>::const_iterator it = mPerLayerRenderingTime.constBegin(); it != mPerLayerRenderingTime.constEnd(); ++it )
+    elapsed.insert( it.value(), it.key() );
 
   QList<int> tt( elapsed.uniqueKeys() );
   qSort( tt.begin(), tt.end(), qGreater<int>() );
@@ -385,5 +650,13 @@ void QgsMapRendererJob::logRenderingTime( const LayerRenderJobs& jobs )
   {
     QgsMessageLog::logMessage( tr( "%1 ms: %2" ).arg( t ).arg( QStringList( elapsed.values( t ) ).join( ", " ) ), tr( "Rendering" ) );
   }
+  Q_FOREACH ( const LayerRenderJob& job, jobs )
+  {
+    if ( !job.renderer )
+      continue;
+
+    Q_FOREACH ( const QString& details, job.renderer->timingDetails() )
+      QgsMessageLog::logMessage( tr( "%1: %2" ).arg( job.layerId, details ), tr( "Rendering" ) );
+  }
   QgsMessageLog::logMessage( "---", tr( "Rendering" ) );
 }
@@ -22,6 +22,7 @@
 #include <QPainter>
 #include <QObject>
 #include <QTime>
+#include <QVector>
 
 #include "qgsrendercontext.h"
 
@@ -49,6 +50,7 @@ struct LayerRenderJob
   bool cached; // if true, img already contains cached image from previous rendering
   QString layerId;
   int renderingTime; //!< time it took to render the layer in ms (it is -1 if not rendered or still rendering)
+  QRect tileRect; //!< area of the map image covered by img when the layer is split into tiles or partially cached, null if img covers the whole map
 };
 
 typedef QList<LayerRenderJob> LayerRenderJobs;
@@ -132,6 +134,13 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! Find out how log it took to finish the job (in miliseconds)
     int renderingTime() const { return mRenderingTime; }
 
+    /** Returns the time it took to render each layer (in milliseconds), by layer ID. The times of
+     * the tiles or parts of a layer rendered by separate jobs are summed, the time is -1 for
+     * layers taken from the cache. Available when the rendering has been finished.
+     * @note added in QGIS 2.99
+     */
+    QMap<QString, int> perLayerRenderingTime() const { return mPerLayerRenderingTime; }
+
     /**
      * Return map settings with which this job was started.
      * @return A QgsMapSettings instance with render settings
@@ -157,9 +166,20 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! @note not available in python bindings
     LayerRenderJobs prepareJobs( QPainter* painter, QgsLabelingEngineV2* labelingEngine2 );
 
+    /** Returns the number of tiles a layer should be split into. Each tile is rendered
+     * by a separate job with its own image, which allows a single expensive layer to be
+     * rendered in parallel. The default implementation renders every layer as a whole.
+     * @param ml layer to render
+     * @param labelingEngine2 labeling engine used by the jobs, may be null
+     * @note added in QGIS 2.99
+     * @note not available in python bindings
+     */
+    virtual int layerTileCount( QgsMapLayer* ml, QgsLabelingEngineV2* labelingEngine2 ) const;
+
     //! @note not available in python bindings
     void cleanupJobs( LayerRenderJobs& jobs );
 
+    //! Sums the rendering time of the jobs of each layer, see perLayerRenderingTime(), and logs it if enabled
     //! @note not available in python bindings
     void logRenderingTime( const LayerRenderJobs& jobs );
 
@@ -173,6 +193,28 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
     //! called when rendering has finished to update all layers' geometry caches
     void updateLayerGeometryCaches();
 
+    /** Replaces the last job of the list by one job per tile if layerTileCount() asks for it.
+     * @returns true if the layer has been split into tiles
+     * @note not available in python bindings
+     */
+    bool prepareTileJobs( LayerRenderJobs& layerJobs, QgsMapLayer* ml, QgsLabelingEngineV2* labelingEngine2 );
+
+    /** Replaces the last job of the list by a cached image of the layer rendered for a panned extent
+     * and one job per part of the map which is not covered by that image.
+     * @returns true if a cached image has been reused
+     * @note not available in python bindings
+     */
+    bool preparePannedJobs( LayerRenderJobs& layerJobs, QgsMapLayer* ml );
+
+    /** Appends one job rendering the layer for each area of the map image.
+     * @param layerJobs list of jobs to append to
+     * @param layerJob job of the layer for the whole map, used as a template
+     * @param ml layer to render
+     * @param rects areas of the map image
+     * @note not available in python bindings
+     */
+    void prepareRegionJobs( LayerRenderJobs& layerJobs, const LayerRenderJob& layerJob, QgsMapLayer* ml, const QVector<QRect>& rects );
+
     QgsMapSettings mSettings;
     Errors mErrors;
 
@@ -185,6 +227,8 @@ class CORE_EXPORT QgsMapRendererJob : public QObject
 
     QTime mRenderingStart;
     int mRenderingTime;
+    //! rendering time of each layer, see perLayerRenderingTime()
+    QMap<QString, int> mPerLayerRenderingTime;
 };
 
 
@@ -19,8 +19,12 @@
 #include "qgslogger.h"
 #include "qgsmaplayerrenderer.h"
 #include "qgspallabeling.h"
+#include "qgspainteffect.h"
+#include "qgsrendererv2.h"
+#include "qgsvectorlayer.h"
 
 #include <QtConcurrentMap>
+#include <QSettings>
 
 
 QgsMapRendererParallelJob::QgsMapRendererParallelJob( const QgsMapSettings& settings )
@@ -211,6 +215,41 @@ void QgsMapRendererParallelJob::renderingFinished()
   emit finished();
 }
 
+int QgsMapRendererParallelJob::layerTileCount( QgsMapLayer* ml, QgsLabelingEngineV2* labelingEngine2 ) const
+{
+  QSettings settings;
+  int threshold = settings.value( "/qgis/parallel_rendering_tile_threshold", 0 ).toInt();
+  int threads = QThreadPool::globalInstance()->maxThreadCount();
+  if ( threshold <= 0 || threads < 2 || !qgsDoubleNear( mSettings.rotation(), 0.0 ) )
+    return 1;
+
+  QgsVectorLayer* vl = qobject_cast<QgsVectorLayer*>( ml );
+  if ( !vl || !vl->rendererV2() )
+    return 1;
+
+  // edited layers share their geometry cache between the jobs
+  if ( vl->isEditable() || mRequestedGeomCacheForLayers.contains( vl->id() ) )
+    return 1;
+
+  // labels and diagrams would be registered once per tile
+  if ( labelingEngine2 && ( QgsPalLabeling::staticWillUseLayer( vl ) || vl->diagramsEnabled() ) )
+    return 1;
+
+  // renderers combining several features (point displacement, heatmap, inverted polygons...)
+  // and layer wide effects need to see the whole map at once
+  QString rendererType = vl->rendererV2()->type();
+  if ( rendererType != "singleSymbol" && rendererType != "categorizedSymbol"
+       && rendererType != "graduatedSymbol" && rendererType != "RuleRenderer" )
+    return 1;
+  if ( vl->rendererV2()->paintEffect() && vl->rendererV2()->paintEffect()->enabled() )
+    return 1;
+
+  if ( vl->featureCount() < threshold )
+    return 1;
+
+  return threads;
+}
+
 void QgsMapRendererParallelJob::renderLayerStatic( LayerRenderJob& job )
 {
   if ( job.context.renderingStopped() )
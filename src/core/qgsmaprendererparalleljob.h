@@ -21,6 +21,10 @@
 /** \ingroup core
  * Job implementation that renders all layers in parallel.
  *
+ * Vector layers with more features than the "/qgis/parallel_rendering_tile_threshold"
+ * setting (disabled if 0) are additionally split into one tile per rendering thread,
+ * so that a single expensive layer does not render on one core.
+ *
  * The resulting map image can be retrieved with renderedImage() function.
  * It is safe to call that function while rendering is active to see preview of the map.
  *
@@ -54,6 +58,9 @@ class CORE_EXPORT QgsMapRendererParallelJob : public QgsMapRendererQImageJob
     static void renderLayerStatic( LayerRenderJob& job );
     static void renderLabelsStatic( QgsMapRendererParallelJob* self );
 
+    //! @note not available in python bindings
+    virtual int layerTileCount( QgsMapLayer* ml, QgsLabelingEngineV2* labelingEngine2 ) const override;
+
   protected:
 
     QImage mFinalImage;
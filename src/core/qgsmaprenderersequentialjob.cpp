@@ -129,6 +129,8 @@ void QgsMapRendererSequentialJob::internalFinished()
 
   mErrors = mInternalJob->errors();
 
+  mPerLayerRenderingTime = mInternalJob->perLayerRenderingTime();
+
   // now we are in a slot called from mInternalJob - do not delete it immediately
   // so the class is still valid when the execution returns to the class
   mInternalJob->deleteLater();
@@ -50,6 +50,7 @@
 #include <QDir>
 #include <QUrl>
 #include <QSettings>
+#include <QThreadStorage>
 
 #ifdef Q_OS_UNIX
 #include <utime.h>
@@ -379,8 +380,13 @@ QgsProject::~QgsProject()
 }
 
 
+static QThreadStorage< QgsProject* > sThreadProjects;
+
 QgsProject *QgsProject::instance()
 {
+  if ( sThreadProjects.hasLocalData() )
+    return sThreadProjects.localData();
+
   if ( !theProject_ )
   {
     theProject_ = new QgsProject;
@@ -388,6 +394,12 @@ QgsProject *QgsProject::instance()
   return theProject_;
 }
 
+void QgsProject::createThreadInstance()
+{
+  if ( !sThreadProjects.hasLocalData() )
+    sThreadProjects.setLocalData( new QgsProject );
+}
+
 void QgsProject::setTitle( const QString &title )
 {
   imp_->title = title;
@@ -82,6 +82,13 @@ class CORE_EXPORT QgsProject : public QObject
     //! Returns the QgsProject singleton instance
     static QgsProject * instance();
 
+    /** Creates a project for the calling thread, returned by instance() on this thread from
+     * now on and deleted when the thread exits. Used by servers which process requests in
+     * parallel. The map layer registry of the thread must be created first.
+     * @note added in QGIS 2.99
+     */
+    static void createThreadInstance();
+
     /**
      * Every project has an associated title string
      *
@@ -271,6 +271,16 @@ bool QgsSpatialIndex::insertFeature( const QgsFeature& f )
   if ( !featureInfo( f, r, id ) )
     return false;
 
+  return insertData( id, r );
+}
+
+bool QgsSpatialIndex::insertFeature( QgsFeatureId id, const QgsRectangle& rect )
+{
+  return insertData( id, rectToRegion( rect ) );
+}
+
+bool QgsSpatialIndex::insertData( QgsFeatureId id, const SpatialIndex::Region& r )
+{
   // TODO: handle possible exceptions correctly
   try
   {
@@ -306,6 +316,12 @@ bool QgsSpatialIndex::deleteFeature( const QgsFeature& f )
   return d->mRTree->deleteData( r, FID_TO_NUMBER( id ) );
 }
 
+bool QgsSpatialIndex::deleteFeature( QgsFeatureId id, const QgsRectangle& rect )
+{
+  // TODO: handle exceptions
+  return d->mRTree->deleteData( rectToRegion( rect ), FID_TO_NUMBER( id ) );
+}
+
 QList<QgsFeatureId> QgsSpatialIndex::intersects( const QgsRectangle& rect ) const
 {
   QList<QgsFeatureId> list;
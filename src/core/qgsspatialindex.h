@@ -79,6 +79,20 @@ class CORE_EXPORT QgsSpatialIndex
     /** Remove feature from index */
     bool deleteFeature( const QgsFeature& f );
 
+    /** Add an item to the index, for callers which already know the bounding box of the feature's geometry
+     * @param id feature id
+     * @param rect bounding box of the feature's geometry
+     * @note added in QGIS 2.99
+     */
+    bool insertFeature( QgsFeatureId id, const QgsRectangle& rect );
+
+    /** Remove an item added with the bounding box of the feature's geometry
+     * @param id feature id
+     * @param rect bounding box given when the item was added
+     * @note added in QGIS 2.99
+     */
+    bool deleteFeature( QgsFeatureId id, const QgsRectangle& rect );
+
 
     /* queries */
 
@@ -99,6 +113,10 @@ class CORE_EXPORT QgsSpatialIndex
     //! @note not available in python bindings
     static bool featureInfo( const QgsFeature& f, SpatialIndex::Region& r, QgsFeatureId &id );
 
+    //! Inserts an item in the tree
+    //! @note not available in python bindings
+    bool insertData( QgsFeatureId id, const SpatialIndex::Region& r );
+
     friend class QgsFeatureIteratorDataStream; // for access to featureInfo()
 
   private:
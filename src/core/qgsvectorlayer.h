@@ -171,6 +171,12 @@ protected:
  * - index=yes
  *   Specifies that the layer will be constructed with a spatial index
  *
+ * - storage=columnar
+ *   Stores the features in typed columns and a packed WKB array instead of a map of
+ *   QgsFeature, which uses much less memory for large layers. Values are converted to
+ *   the type of their field, and only the requested attributes and geometries are read
+ *   when iterating. (added in QGIS 2.99)
+ *
  * - field=name:type(length,precision)
  *   Defines an attribute of the layer.  Multiple field parameters can be added
  *   to the data provider definition.  type is one of "integer", "double", "string".
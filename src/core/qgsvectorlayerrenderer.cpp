@@ -23,6 +23,7 @@
 #include "qgspallabeling.h"
 #include "qgsrendererv2.h"
 #include "qgsrendercontext.h"
+#include "qgsrulebasedrendererv2.h"
 #include "qgssinglesymbolrendererv2.h"
 #include "qgssymbollayerv2.h"
 #include "qgssymbolv2.h"
@@ -34,13 +35,32 @@
 #include "qgspainteffect.h"
 #include "qgsfeaturefilterprovider.h"
 #include "qgscsexception.h"
+#include "qgsmaptopixelgeometrysimplifier.h"
 
 #include <QSettings>
 #include <QPicture>
+#include <QElapsedTimer>
 
 // TODO:
 // - passing of cache to QgsVectorLayer
 
+//! number of features whose rule filters are evaluated together by drawRendererV2()
+static const int FILTER_BLOCK_SIZE = 256;
+
+//! Returns true if a symbol layer of the symbol draws geometries computed from the feature geometry
+static bool drawsGeneratedGeometries( QgsSymbolV2* symbol )
+{
+  for ( int i = 0; i < symbol->symbolLayerCount(); ++i )
+  {
+    QgsSymbolLayerV2* layer = symbol->symbolLayer( i );
+    if ( layer->layerType() == "GeometryGenerator" )
+      return true;
+    if ( layer->subSymbol() && drawsGeneratedGeometries( layer->subSymbol() ) )
+      return true;
+  }
+  return false;
+}
+
 
 QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRenderContext& context )
     : QgsMapLayerRenderer( layer->id() )
@@ -55,6 +75,7 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
     , mLabelProvider( nullptr )
     , mDiagramProvider( nullptr )
     , mLayerTransparency( 0 )
+    , mFetchQueueSize( 0 )
 {
   mSource = new QgsVectorLayerFeatureSource( layer );
 
@@ -90,6 +111,9 @@ QgsVectorLayerRenderer::QgsVectorLayerRenderer( QgsVectorLayer* layer, QgsRender
 
   mVertexMarkerSize = settings.value( "/qgis/digitizing/marker_size", 3 ).toInt();
 
+  // fetch features on a separate thread, so that slow providers do not stall drawing
+  mFetchQueueSize = qMax( 0, settings.value( "/qgis/rendering/fetch_queue_size", 1000 ).toInt() );
+
   if ( !mRendererV2 )
     return;
 
@@ -253,10 +277,50 @@ bool QgsVectorLayerRenderer::render()
   // in drawRendererV2()
   fit.setInterruptionChecker( &mInterruptionChecker );
 
-  if (( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && mRendererV2->usingSymbolLevels() )
-    drawRendererV2Levels( fit );
+  QgsVectorLayerFeatureFetcher fetcher( fit, mFetchQueueSize );
+
+  bool symbolLevels = ( mRendererV2->capabilities() & QgsFeatureRendererV2::SymbolLevels ) && mRendererV2->usingSymbolLevels();
+  if ( mFetchQueueSize > 0 && !symbolLevels && canDrawRenderGeometries() )
+  {
+    // transform and simplify the geometries on the fetch thread as well
+    QgsCoordinateTransform ct = mContext.coordinateTransform();
+    bool validTransform = true;
+    mMapExtent = mContext.extent();
+    if ( ct.isValid() && !ct.isShortCircuited() )
+    {
+      try
+      {
+        mMapExtent = ct.transformBoundingBox( mContext.extent() );
+      }
+      catch ( QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        validTransform = false;
+      }
+    }
+
+    if ( validTransform )
+    {
+      QgsVectorSimplifyMethod simplifyMethod = mContext.vectorSimplifyMethod();
+      simplifyMethod.setTolerance( mSimplifyMethod.threshold() * mContext.mapToPixel().mapUnitsPerPixel() );
+      fetcher.setRenderGeometry( ct, simplifyMethod );
+    }
+  }
+
+  fetcher.startFetching();
+
+  if ( symbolLevels )
+    drawRendererV2Levels( fetcher );
   else
-    drawRendererV2( fit );
+    drawRendererV2( fetcher );
+
+  fetcher.stopFetching();
+  if ( mFetchQueueSize > 0 )
+  {
+    mTimingDetails.append( QObject::tr( "drawing waited %1 times for features (%2 ms), fetching waited %3 times for drawing (%4 ms)" )
+                           .arg( fetcher.fetchStalls() ).arg( fetcher.fetchStallTime() )
+                           .arg( fetcher.drawStalls() ).arg( fetcher.drawStallTime() ) );
+  }
 
   if ( usingEffect )
   {
@@ -291,94 +355,169 @@ void QgsVectorLayerRenderer::setGeometryCachePointer( QgsGeometryCache* cache )
 
 
 
-void QgsVectorLayerRenderer::drawRendererV2( QgsFeatureIterator& fit )
+void QgsVectorLayerRenderer::drawRendererV2( QgsVectorLayerFeatureFetcher& fetcher )
 {
   QgsExpressionContextScope* symbolScope = QgsExpressionContextUtils::updateSymbolScope( nullptr, new QgsExpressionContextScope() );
   mContext.expressionContext().appendScope( symbolScope );
 
+  // the rule filters are evaluated for blocks of features, the other renderers draw the features as they come
+  QgsRuleBasedRendererV2* ruleRenderer = nullptr;
+  if ( mRendererV2->type() == "RuleRenderer" )
+    ruleRenderer = static_cast<QgsRuleBasedRendererV2*>( mRendererV2 );
+  const int blockSize = ruleRenderer ? FILTER_BLOCK_SIZE : 1;
+
+  QgsFeatureList block;
+  QList<QgsGeometry> blockRenderGeometries;
   QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  QgsGeometry renderGeometry;
+  bool cancelled = false;
+  while ( !cancelled )
   {
-    try
+    block.clear();
+    blockRenderGeometries.clear();
+    while ( block.count() < blockSize && fetcher.nextFeature( fet, renderGeometry ) )
     {
-      if ( mContext.renderingStopped() )
-      {
-        QgsDebugMsg( QString( "Drawing of vector layer %1 cancelled." ).arg( layerId() ) );
-        break;
-      }
-
       if ( !fet.constGeometry() )
         continue; // skip features without geometry
 
-      mContext.expressionContext().setFeature( fet );
+      block << fet;
+      blockRenderGeometries << renderGeometry;
+    }
+    if ( block.isEmpty() )
+      break;
 
-      bool sel = mContext.showSelection() && mSelectedFeatureIds.contains( fet.id() );
-      bool drawMarker = ( mDrawVertexMarkers && mContext.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
+    if ( ruleRenderer )
+      ruleRenderer->prepareFeatureBlock( block, mContext );
 
-      if ( mCache )
+    for ( int i = 0; i < block.count(); ++i )
+    {
+      fet = block.at( i );
+      renderGeometry = blockRenderGeometries.at( i );
+      try
       {
-        // Cache this for the use of (e.g.) modifying the feature's uncommitted geometry.
-        mCache->cacheGeometry( fet.id(), *fet.constGeometry() );
-      }
+        if ( mContext.renderingStopped() )
+        {
+          QgsDebugMsg( QString( "Drawing of vector layer %1 cancelled." ).arg( layerId() ) );
+          cancelled = true;
+          break;
+        }
 
-      // render feature
-      bool rendered = mRendererV2->renderFeature( fet, mContext, -1, sel, drawMarker );
+        mContext.expressionContext().setFeature( fet );
 
-      // labeling - register feature
-      if ( rendered )
-      {
-        if ( mContext.labelingEngine() )
+        bool sel = mContext.showSelection() && mSelectedFeatureIds.contains( fet.id() );
+        bool drawMarker = ( mDrawVertexMarkers && mContext.drawEditingInformation() && ( !mVertexMarkerOnlyForSelection || sel ) );
+
+        if ( mCache )
         {
-          if ( mLabeling )
-          {
-            mContext.labelingEngine()->registerFeature( mLayerID, fet, mContext );
-          }
-          if ( mDiagrams )
-          {
-            mContext.labelingEngine()->registerDiagramFeature( mLayerID, fet, mContext );
-          }
+          // Cache this for the use of (e.g.) modifying the feature's uncommitted geometry.
+          mCache->cacheGeometry( fet.id(), *fet.constGeometry() );
         }
-        // new labeling engine
-        if ( mContext.labelingEngineV2() )
-        {
-          QScopedPointer<QgsGeometry> obstacleGeometry;
-          QgsSymbolV2List symbols = mRendererV2->originalSymbolsForFeature( fet, mContext );
 
-          if ( !symbols.isEmpty() && fet.constGeometry()->type() == Qgis::Point )
-          {
-            obstacleGeometry.reset( QgsVectorLayerLabelProvider::getPointObstacleGeometry( fet, mContext, symbols ) );
-          }
+        // render feature
+        bool rendered;
+        if ( !renderGeometry.isEmpty() )
+          rendered = renderFeatureWithGeometry( fet, renderGeometry, sel, drawMarker );
+        else
+          rendered = mRendererV2->renderFeature( fet, mContext, -1, sel, drawMarker );
 
-          if ( !symbols.isEmpty() )
-          {
-            QgsExpressionContextUtils::updateSymbolScope( symbols.at( 0 ), symbolScope );
-          }
-
-          if ( mLabelProvider )
+        // labeling - register feature
+        if ( rendered )
+        {
+          if ( mContext.labelingEngine() )
           {
-            mLabelProvider->registerFeature( fet, mContext, obstacleGeometry.data() );
+            if ( mLabeling )
+            {
+              mContext.labelingEngine()->registerFeature( mLayerID, fet, mContext );
+            }
+            if ( mDiagrams )
+            {
+              mContext.labelingEngine()->registerDiagramFeature( mLayerID, fet, mContext );
+            }
           }
-          if ( mDiagramProvider )
+          // new labeling engine
+          if ( mContext.labelingEngineV2() )
           {
-            mDiagramProvider->registerFeature( fet, mContext, obstacleGeometry.data() );
+            QScopedPointer<QgsGeometry> obstacleGeometry;
+            QgsSymbolV2List symbols = mRendererV2->originalSymbolsForFeature( fet, mContext );
+
+            if ( !symbols.isEmpty() && fet.constGeometry()->type() == Qgis::Point )
+            {
+              obstacleGeometry.reset( QgsVectorLayerLabelProvider::getPointObstacleGeometry( fet, mContext, symbols ) );
+            }
+
+            if ( !symbols.isEmpty() )
+            {
+              QgsExpressionContextUtils::updateSymbolScope( symbols.at( 0 ), symbolScope );
+            }
+
+            if ( mLabelProvider )
+            {
+              mLabelProvider->registerFeature( fet, mContext, obstacleGeometry.data() );
+            }
+            if ( mDiagramProvider )
+            {
+              mDiagramProvider->registerFeature( fet, mContext, obstacleGeometry.data() );
+            }
           }
         }
       }
-    }
-    catch ( const QgsCsException &cse )
-    {
-      Q_UNUSED( cse );
-      QgsDebugMsg( QString( "Failed to transform a point while drawing a feature with ID '%1'. Ignoring this feature. %2" )
-                   .arg( fet.id() ).arg( cse.what() ) );
+      catch ( const QgsCsException &cse )
+      {
+        Q_UNUSED( cse );
+        QgsDebugMsg( QString( "Failed to transform a point while drawing a feature with ID '%1'. Ignoring this feature. %2" )
+                     .arg( fet.id() ).arg( cse.what() ) );
+      }
     }
   }
 
+  if ( ruleRenderer )
+    ruleRenderer->clearFeatureBlock();
+
   delete mContext.expressionContext().popScope();
 
   stopRendererV2( nullptr );
 }
 
-void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
+bool QgsVectorLayerRenderer::canDrawRenderGeometries() const
+{
+  // the other renderers evaluate expressions on the feature they draw or draw it with other renderers
+  QString type = mRendererV2->type();
+  if ( type != "singleSymbol" && type != "categorizedSymbol" && type != "graduatedSymbol" )
+    return false;
+
+  Q_FOREACH ( QgsSymbolV2* symbol, mRendererV2->symbols( mContext ) )
+  {
+    if ( drawsGeneratedGeometries( symbol ) )
+      return false;
+  }
+  return true;
+}
+
+bool QgsVectorLayerRenderer::renderFeatureWithGeometry( const QgsFeature& feature, const QgsGeometry& renderGeometry, bool selected, bool drawMarker )
+{
+  QgsFeature drawnFeature( feature );
+  drawnFeature.setGeometry( renderGeometry );
+
+  // the geometry is already in map coordinates and simplified, the labeling still needs the layer coordinates
+  QgsCoordinateTransform ct = mContext.coordinateTransform();
+  QgsRectangle extent = mContext.extent();
+  QgsVectorSimplifyMethod simplifyMethod = mContext.vectorSimplifyMethod();
+
+  QgsVectorSimplifyMethod noSimplification;
+  noSimplification.setSimplifyHints( QgsVectorSimplifyMethod::NoSimplification );
+  mContext.setCoordinateTransform( QgsCoordinateTransform() );
+  mContext.setExtent( mMapExtent );
+  mContext.setVectorSimplifyMethod( noSimplification );
+
+  bool rendered = mRendererV2->renderFeature( drawnFeature, mContext, -1, selected, drawMarker );
+
+  mContext.setCoordinateTransform( ct );
+  mContext.setExtent( extent );
+  mContext.setVectorSimplifyMethod( simplifyMethod );
+  return rendered;
+}
+
+void QgsVectorLayerRenderer::drawRendererV2Levels( QgsVectorLayerFeatureFetcher& fetcher )
 {
   QHash< QgsSymbolV2*, QList<QgsFeature> > features; // key = symbol, value = array of features
 
@@ -396,7 +535,7 @@ void QgsVectorLayerRenderer::drawRendererV2Levels( QgsFeatureIterator& fit )
 
   // 1. fetch features
   QgsFeature fet;
-  while ( fit.nextFeature( fet ) )
+  while ( fetcher.nextFeature( fet ) )
   {
     if ( mContext.renderingStopped() )
     {
@@ -648,3 +787,182 @@ bool QgsVectorLayerRendererInterruptionChecker::mustStop() const
 {
   return mContext.renderingStopped();
 }
+
+
+QgsVectorLayerFeatureFetcher::QgsVectorLayerFeatureFetcher( QgsFeatureIterator& iterator, int capacity )
+    : mIterator( iterator )
+    , mCapacity( capacity )
+    , mPrepareGeometries( false )
+    , mFinished( false )
+    , mStopped( false )
+    , mFetchStalls( 0 )
+    , mFetchStallTime( 0 )
+    , mDrawStalls( 0 )
+    , mDrawStallTime( 0 )
+{
+}
+
+QgsVectorLayerFeatureFetcher::~QgsVectorLayerFeatureFetcher()
+{
+  stopFetching();
+}
+
+void QgsVectorLayerFeatureFetcher::setRenderGeometry( const QgsCoordinateTransform& transform, const QgsVectorSimplifyMethod& simplifyMethod )
+{
+  mPrepareGeometries = true;
+  mTransform = transform;
+  mSimplifyMethod = simplifyMethod;
+
+  // the drawing thread keeps using its transform: the fetch thread needs its own projections
+  if ( mTransform.isValid() )
+    mTransform.initialise();
+}
+
+void QgsVectorLayerFeatureFetcher::startFetching()
+{
+  if ( mCapacity > 0 )
+    start();
+}
+
+void QgsVectorLayerFeatureFetcher::stopFetching()
+{
+  {
+    QMutexLocker locker( &mMutex );
+    mStopped = true;
+    mQueueNotFull.wakeAll();
+  }
+  wait();
+
+  mQueue.clear();
+  mReadQueue.clear();
+}
+
+bool QgsVectorLayerFeatureFetcher::nextFeature( QgsFeature& feature )
+{
+  QgsGeometry renderGeometry;
+  return nextFeature( feature, renderGeometry );
+}
+
+bool QgsVectorLayerFeatureFetcher::nextFeature( QgsFeature& feature, QgsGeometry& renderGeometry )
+{
+  if ( mCapacity <= 0 )
+  {
+    if ( mStopped || !mIterator.nextFeature( feature ) )
+      return false;
+
+    renderGeometry = prepareRenderGeometry( feature );
+    return true;
+  }
+
+  if ( mReadQueue.isEmpty() )
+  {
+    QMutexLocker locker( &mMutex );
+    if ( mQueue.isEmpty() && !mFinished && !mStopped )
+    {
+      ++mFetchStalls;
+      QElapsedTimer timer;
+      timer.start();
+      while ( mQueue.isEmpty() && !mFinished && !mStopped )
+        mQueueNotEmpty.wait( &mMutex );
+      mFetchStallTime += timer.elapsed();
+    }
+
+    // take everything fetched so far, so that the lock is taken once per batch
+    mReadQueue.swap( mQueue );
+    mQueueNotFull.wakeAll();
+  }
+
+  if ( mReadQueue.isEmpty() )
+    return false;
+
+  FetchedFeature fetched = mReadQueue.dequeue();
+  feature = fetched.feature;
+  renderGeometry = fetched.renderGeometry;
+  return true;
+}
+
+QgsGeometry QgsVectorLayerFeatureFetcher::prepareRenderGeometry( const QgsFeature& feature ) const
+{
+  if ( !mPrepareGeometries || !feature.constGeometry() )
+    return QgsGeometry();
+
+  QgsGeometry geometry( *feature.constGeometry() );
+  if ( mTransform.isValid() && !mTransform.isShortCircuited() )
+  {
+    try
+    {
+      if ( geometry.transform( mTransform ) != 0 )
+        return QgsGeometry();
+    }
+    catch ( QgsCsException &cse )
+    {
+      // drawn from the layer geometry, which reports the error
+      Q_UNUSED( cse );
+      return QgsGeometry();
+    }
+  }
+
+  // the same local simplification as while drawing the layer geometry
+  if ( mSimplifyMethod.simplifyHints() != QgsVectorSimplifyMethod::NoSimplification && mSimplifyMethod.forceLocalOptimization() )
+  {
+    int simplifyHints = mSimplifyMethod.simplifyHints() | QgsMapToPixelSimplifier::SimplifyEnvelope;
+    QgsMapToPixelSimplifier::SimplifyAlgorithm simplifyAlgorithm = static_cast< QgsMapToPixelSimplifier::SimplifyAlgorithm >( mSimplifyMethod.simplifyAlgorithm() );
+    QgsMapToPixelSimplifier::simplifyGeometry( &geometry, simplifyHints, mSimplifyMethod.tolerance(), simplifyAlgorithm );
+  }
+  return geometry;
+}
+
+void QgsVectorLayerFeatureFetcher::run()
+{
+  FetchedFeature fetched;
+  while ( mIterator.nextFeature( fetched.feature ) )
+  {
+    fetched.renderGeometry = prepareRenderGeometry( fetched.feature );
+
+    QMutexLocker locker( &mMutex );
+    if ( mQueue.count() >= mCapacity && !mStopped )
+    {
+      ++mDrawStalls;
+      QElapsedTimer timer;
+      timer.start();
+      while ( mQueue.count() >= mCapacity && !mStopped )
+        mQueueNotFull.wait( &mMutex );
+      mDrawStallTime += timer.elapsed();
+    }
+
+    if ( mStopped )
+      break;
+
+    mQueue.enqueue( fetched );
+    if ( mQueue.count() == 1 )
+      mQueueNotEmpty.wakeAll();
+  }
+
+  QMutexLocker locker( &mMutex );
+  mFinished = true;
+  mQueueNotEmpty.wakeAll();
+}
+
+int QgsVectorLayerFeatureFetcher::fetchStalls() const
+{
+  QMutexLocker locker( &mMutex );
+  return mFetchStalls;
+}
+
+qint64 QgsVectorLayerFeatureFetcher::fetchStallTime() const
+{
+  QMutexLocker locker( &mMutex );
+  return mFetchStallTime;
+}
+
+int QgsVectorLayerFeatureFetcher::drawStalls() const
+{
+  QMutexLocker locker( &mMutex );
+  return mDrawStalls;
+}
+
+qint64 QgsVectorLayerFeatureFetcher::drawStallTime() const
+{
+  QMutexLocker locker( &mMutex );
+  return mDrawStallTime;
+}
@@ -29,14 +29,20 @@ class QgsFeatureIterator;
 class QgsSingleSymbolRendererV2;
 
 #include <QList>
+#include <QMutex>
 #include <QPainter>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
 
 typedef QList<int> QgsAttributeList;
 
 #include "qgis.h"
+#include "qgscoordinatetransform.h"
 #include "qgsfield.h"  // QgsFields
 #include "qgsfeature.h"  // QgsFeatureIds
 #include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
 #include "qgsvectorsimplifymethod.h"
 
 #include "qgsmaplayerrenderer.h"
@@ -58,6 +64,111 @@ class QgsVectorLayerRendererInterruptionChecker: public QgsInterruptionChecker
     const QgsRenderContext& mContext;
 };
 
+/** \ingroup core
+ * Reads the features of an iterator on a separate thread while QgsVectorLayerRenderer
+ * draws them. Fetched features (already simplified by the iterator if a simplification
+ * method was requested) are handed over through a bounded queue, so the provider latency
+ * is hidden behind drawing. Features are returned in the iterator order.
+ *
+ * The fetch thread can also transform and simplify the geometries to draw, see setRenderGeometry().
+ *
+ * With a zero capacity no thread is started and nextFeature() reads the iterator directly.
+ *
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class CORE_EXPORT QgsVectorLayerFeatureFetcher : public QThread
+{
+  public:
+
+    /** Constructor
+     * @param iterator iterator to read from, must outlive the fetcher. Only the fetch
+     * thread accesses the iterator while fetching is running.
+     * @param capacity maximum number of fetched features waiting to be drawn, 0 to read
+     * the iterator on the calling thread
+     */
+    QgsVectorLayerFeatureFetcher( QgsFeatureIterator& iterator, int capacity );
+
+    //! Stops fetching and waits for the fetch thread to finish
+    ~QgsVectorLayerFeatureFetcher();
+
+    /** Prepares the geometries to draw on the fetch thread: the geometry of each fetched feature
+     * is transformed to the map CRS and simplified, and returned by nextFeature() next to the
+     * feature, which keeps its layer CRS geometry. Must be called before startFetching().
+     * @param transform transform from the layer CRS to the map CRS, invalid if the CRS are the same
+     * @param simplifyMethod local simplification of the transformed geometries, with a tolerance in map units
+     */
+    void setRenderGeometry( const QgsCoordinateTransform& transform, const QgsVectorSimplifyMethod& simplifyMethod );
+
+    //! Starts the fetch thread, does nothing if the fetcher has no queue
+    void startFetching();
+
+    //! Stops the fetch thread and waits for it, features still queued are discarded
+    void stopFetching();
+
+    /** Fetches the next feature, waiting for the fetch thread if none is queued yet.
+     * @returns false once the iterator is exhausted or fetching has been stopped
+     */
+    bool nextFeature( QgsFeature& feature );
+
+    /** Fetches the next feature and the geometry prepared to draw it.
+     * @param feature receives the feature
+     * @param renderGeometry receives the geometry in map CRS, an empty geometry if geometries are not
+     * prepared or the transform failed
+     * @see setRenderGeometry()
+     */
+    bool nextFeature( QgsFeature& feature, QgsGeometry& renderGeometry );
+
+    //! Returns the number of times drawing had to wait for features to be fetched
+    int fetchStalls() const;
+    //! Returns the total time in milliseconds drawing waited for features to be fetched
+    qint64 fetchStallTime() const;
+    //! Returns the number of times fetching had to wait because the queue was full
+    int drawStalls() const;
+    //! Returns the total time in milliseconds fetching waited because the queue was full
+    qint64 drawStallTime() const;
+
+  protected:
+
+    virtual void run() override;
+
+  private:
+
+    struct FetchedFeature
+    {
+      QgsFeature feature;
+      //! geometry transformed and simplified for drawing, empty if not prepared
+      QgsGeometry renderGeometry;
+    };
+
+    //! Returns the geometry of a feature transformed and simplified for drawing
+    QgsGeometry prepareRenderGeometry( const QgsFeature& feature ) const;
+
+    QgsFeatureIterator& mIterator;
+    int mCapacity;
+
+    bool mPrepareGeometries;
+    //! the fetch thread own copy of the transform
+    QgsCoordinateTransform mTransform;
+    QgsVectorSimplifyMethod mSimplifyMethod;
+
+    //! features fetched and not yet taken by the drawing thread, protected by mMutex
+    QQueue<FetchedFeature> mQueue;
+    //! features taken from mQueue in one go, only accessed by the drawing thread
+    QQueue<FetchedFeature> mReadQueue;
+
+    mutable QMutex mMutex;
+    QWaitCondition mQueueNotEmpty;
+    QWaitCondition mQueueNotFull;
+    bool mFinished;
+    bool mStopped;
+
+    int mFetchStalls;
+    qint64 mFetchStallTime;
+    int mDrawStalls;
+    qint64 mDrawStallTime;
+};
+
 /** \ingroup core
  * Implementation of threaded rendering for vector layers.
  *
@@ -87,11 +198,20 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     /** Draw layer with renderer V2. QgsFeatureRenderer::startRender() needs to be called before using this method
      */
-    void drawRendererV2( QgsFeatureIterator& fit );
+    void drawRendererV2( QgsVectorLayerFeatureFetcher& fetcher );
+
+    /** Returns true if the renderer draws the features with geometries transformed to the map CRS
+     * and simplified beforehand, that is if it does not evaluate expressions on the drawn geometry
+     */
+    bool canDrawRenderGeometries() const;
+
+    /** Draws a feature with its geometry transformed to the map CRS and simplified by the fetcher
+     */
+    bool renderFeatureWithGeometry( const QgsFeature& feature, const QgsGeometry& renderGeometry, bool selected, bool drawMarker );
 
     /** Draw layer with renderer V2 using symbol levels. QgsFeatureRenderer::startRender() needs to be called before using this method
      */
-    void drawRendererV2Levels( QgsFeatureIterator& fit );
+    void drawRendererV2Levels( QgsVectorLayerFeatureFetcher& fetcher );
 
     /** Stop version 2 renderer and selected renderer (if required) */
     void stopRendererV2( QgsSingleSymbolRendererV2* selRenderer );
@@ -141,6 +261,12 @@ class QgsVectorLayerRenderer : public QgsMapLayerRenderer
 
     QgsVectorSimplifyMethod mSimplifyMethod;
     bool mSimplifyGeometry;
+
+    //! number of features fetched ahead of drawing on a separate thread (1000 by default), 0 if disabled
+    int mFetchQueueSize;
+
+    //! rendered extent in map CRS, used while drawing geometries prepared by the fetcher
+    QgsRectangle mMapExtent;
 };
 
 
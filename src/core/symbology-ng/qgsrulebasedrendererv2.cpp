@@ -274,11 +274,53 @@ bool QgsRuleBasedRendererV2::Rule::isFilterOK( QgsFeature& f, QgsRenderContext*
   if ( ! mFilter || mElseRule )
     return true;
 
+  QHash<QgsFeatureId, bool>::const_iterator blockResult = mBlockFilterResults.constFind( f.id() );
+  if ( blockResult != mBlockFilterResults.constEnd() )
+    return blockResult.value();
+
   context->expressionContext().setFeature( f );
   QVariant res = mFilter->evaluate( &context->expressionContext() );
   return res.toInt() != 0;
 }
 
+QVector<bool> QgsRuleBasedRendererV2::Rule::isFilterOK( const QgsFeatureList& features, QgsRenderContext* context ) const
+{
+  if ( ! mFilter || mElseRule )
+    return QVector<bool>( features.count(), true );
+
+  QVector<QVariant> res = mFilter->evaluateBatch( features, context ? &context->expressionContext() : nullptr );
+  QVector<bool> ok( res.count() );
+  for ( int i = 0; i < res.count(); ++i )
+    ok[i] = res.at( i ).toInt() != 0;
+  return ok;
+}
+
+void QgsRuleBasedRendererV2::Rule::prepareFilterBlock( const QgsFeatureList& features, QgsRenderContext& context )
+{
+  mBlockFilterResults.clear();
+  if ( mFilter && !mElseRule )
+  {
+    QVector<bool> ok = isFilterOK( features, &context );
+    for ( int i = 0; i < features.count(); ++i )
+      mBlockFilterResults.insert( features.at( i ).id(), ok.at( i ) );
+  }
+
+  // the inactive children have no prepared filter, they keep evaluating it feature by feature
+  Q_FOREACH ( Rule* rule, mActiveChildren )
+  {
+    rule->prepareFilterBlock( features, context );
+  }
+}
+
+void QgsRuleBasedRendererV2::Rule::clearFilterBlock()
+{
+  mBlockFilterResults.clear();
+  Q_FOREACH ( Rule* rule, mActiveChildren )
+  {
+    rule->clearFilterBlock();
+  }
+}
+
 bool QgsRuleBasedRendererV2::Rule::isScaleOK( double scale ) const
 {
   if ( qgsDoubleNear( scale, 0.0 ) ) // so that we can count features in classes without scale context
@@ -661,6 +703,8 @@ void QgsRuleBasedRendererV2::Rule::stopRender( QgsRenderContext& context )
   if ( mSymbol )
     mSymbol->stopRender( context );
 
+  mBlockFilterResults.clear();
+
   Q_FOREACH ( Rule* rule, mActiveChildren )
   {
     rule->stopRender( context );
@@ -899,6 +943,16 @@ void QgsRuleBasedRendererV2::startRender( QgsRenderContext& context, const QgsFi
   mRootRule->setNormZLevels( zLevelsToNormLevels );
 }
 
+void QgsRuleBasedRendererV2::prepareFeatureBlock( const QgsFeatureList& features, QgsRenderContext& context )
+{
+  mRootRule->prepareFilterBlock( features, context );
+}
+
+void QgsRuleBasedRendererV2::clearFeatureBlock()
+{
+  mRootRule->clearFilterBlock();
+}
+
 void QgsRuleBasedRendererV2::stopRender( QgsRenderContext& context )
 {
   //
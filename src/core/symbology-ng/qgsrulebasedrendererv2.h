@@ -159,6 +159,37 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
          */
         bool isFilterOK( QgsFeature& f, QgsRenderContext *context = nullptr ) const;
 
+        /**
+         * Check which features of a block shall be rendered by this rule. The filter
+         * expression is evaluated for the whole block at once.
+         *
+         * @param features  The features to test
+         * @param context   The context in which the rendering happens
+         * @return          One flag per feature, true if the feature shall be rendered
+         * @note added in QGIS 2.99
+         * @note not available in Python bindings
+         */
+        QVector<bool> isFilterOK( const QgsFeatureList& features, QgsRenderContext *context ) const;
+
+        /**
+         * Evaluates the filters of this rule and its active children for a block of features.
+         * Until clearFilterBlock() is called, isFilterOK() returns the stored result for the
+         * features of the block instead of evaluating the filter again.
+         *
+         * @param features  The features which are going to be rendered
+         * @param context   The context in which the rendering happens
+         * @note added in QGIS 2.99
+         * @note not available in Python bindings
+         */
+        void prepareFilterBlock( const QgsFeatureList& features, QgsRenderContext& context );
+
+        /**
+         * Drops the filter results stored by prepareFilterBlock()
+         * @note added in QGIS 2.99
+         * @note not available in Python bindings
+         */
+        void clearFilterBlock();
+
         /**
          * Check if this rule applies for a given scale
          * @param scale The scale to check. If set to 0, it will always return true.
@@ -402,6 +433,8 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
         // temporary while rendering
         QSet<int> mSymbolNormZLevels;
         RuleList mActiveChildren;
+        //! filter results of the features of the current block, see prepareFilterBlock()
+        QHash<QgsFeatureId, bool> mBlockFilterResults;
 
       private:
 
@@ -429,6 +462,23 @@ class CORE_EXPORT QgsRuleBasedRendererV2 : public QgsFeatureRendererV2
 
     virtual void stopRender( QgsRenderContext& context ) override;
 
+    /** Evaluates the rule filters for a block of features before they are rendered one by one
+     * with renderFeature(), so that each filter expression is evaluated once for the whole block.
+     * Must be called between startRender() and stopRender(), the results are kept until
+     * clearFeatureBlock() or stopRender() is called.
+     * @param features features which are going to be rendered
+     * @param context render context
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    void prepareFeatureBlock( const QgsFeatureList& features, QgsRenderContext& context );
+
+    /** Drops the filter results stored by prepareFeatureBlock()
+     * @note added in QGIS 2.99
+     * @note not available in Python bindings
+     */
+    void clearFeatureBlock();
+
     virtual QString filter( const QgsFields& fields = QgsFields() ) override;
 
     virtual QList<QString> usedAttributes() override;
@@ -702,21 +702,25 @@ bool QgsSymbolV2::hasDataDefinedProperties() const
 void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker, int currentVertexMarkerType, int currentVertexMarkerSize )
 {
   const QgsGeometry* geom = feature.constGeometry();
-  if ( !geom || !geom->geometry() )
+  if ( !geom || geom->wkbSize() < 5 )
   {
     return;
   }
 
+  // linear geometries are rendered from their WKB, which avoids decoding the WKB read by
+  // the provider: the geometry object is only created if a symbol layer or expression needs it
+  QgsWKBTypes::Type geomType = QgsConstWkbPtr( geom->asWkb(), geom->wkbSize() ).readHeader();
+  bool curved = QgsWKBTypes::isCurvedType( geomType );
+
   const QgsGeometry *segmentizedGeometry = geom;
   bool deleteSegmentizedGeometry = false;
-  context.setGeometry( geom->geometry() );
-
-  bool tileMapRendering = context.testFlag( QgsRenderContext::RenderMapTile );
+  // the original geometry is only used by symbol layers for curved geometries
+  context.setGeometry( curved ? geom->geometry() : nullptr );
 
   //convert curve types to normal point/line/polygon ones
-  if ( QgsWKBTypes::isCurvedType( geom->geometry()->wkbType() ) )
+  if ( curved )
   {
-    QgsAbstractGeometryV2 *g = geom->geometry()->segmentize( context.segmentationTolerance(), context.segmentationToleranceType() );
+    QgsAbstractGeometryV2 *g = geom->geometry() ? geom->geometry()->segmentize( context.segmentationTolerance(), context.segmentationToleranceType() ) : nullptr;
     if ( !g )
     {
       return;
@@ -725,7 +729,15 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
     deleteSegmentizedGeometry = true;
   }
 
-  mSymbolRenderContext->setGeometryPartCount( segmentizedGeometry->geometry()->partCount() );
+  QgsConstWkbPtr partsPtr( segmentizedGeometry->asWkb(), segmentizedGeometry->wkbSize() );
+  QgsWKBTypes::Type segmentizedType = partsPtr.readHeader();
+  int partCount = 1;
+  if ( QgsWKBTypes::isMultiType( segmentizedType ) && partsPtr.remaining() >= static_cast< int >( sizeof( int ) ) )
+  {
+    partsPtr >> partCount;
+  }
+
+  mSymbolRenderContext->setGeometryPartCount( partCount );
   mSymbolRenderContext->setGeometryPartNum( 1 );
 
   if ( mSymbolRenderContext->expressionContextScope() )
@@ -739,7 +751,71 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
   // Collection of markers to paint, only used for no curve types.
   QPolygonF markers;
 
-  switch ( QgsWKBTypes::flatType( segmentizedGeometry->geometry()->wkbType() ) )
+  try
+  {
+    renderFeatureParts( feature, segmentizedGeometry, segmentizedType, context, layer, selected, drawVertexMarker, markers );
+  }
+  catch ( const QgsWkbException &e )
+  {
+    Q_UNUSED( e );
+    QgsDebugMsg( QString( "feature %1: invalid wkb for rendering: %2" ).arg( feature.id() ).arg( e.what() ) );
+  }
+
+  if ( drawVertexMarker )
+  {
+    if ( markers.size() > 0 )
+    {
+      Q_FOREACH ( QPointF marker, markers )
+      {
+        renderVertexMarker( marker, context, currentVertexMarkerType, currentVertexMarkerSize );
+      }
+    }
+    else
+    {
+      QgsCoordinateTransform ct = context.coordinateTransform();
+      const QgsMapToPixel& mtp = context.mapToPixel();
+
+      QgsPointV2 vertexPoint;
+      QgsVertexId vertexId;
+      double x, y, z;
+      QPointF mapPoint;
+      while ( geom->geometry() && geom->geometry()->nextVertex( vertexId, vertexPoint ) )
+      {
+        //transform
+        x = vertexPoint.x();
+        y = vertexPoint.y();
+        z = 0.0;
+        if ( ct.isValid() )
+        {
+          ct.transformInPlace( x, y, z );
+        }
+        mapPoint.setX( x );
+        mapPoint.setY( y );
+        mtp.transformInPlace( mapPoint.rx(), mapPoint.ry() );
+        renderVertexMarker( mapPoint, context, currentVertexMarkerType, currentVertexMarkerSize );
+      }
+    }
+  }
+
+  if ( deleteSegmentizedGeometry )
+  {
+    delete segmentizedGeometry;
+  }
+
+  if ( mSymbolRenderContext->expressionContextScope() )
+    context.expressionContext().popScope();
+}
+
+void QgsSymbolV2::renderFeatureParts( const QgsFeature& feature, const QgsGeometry* segmentizedGeometry, QgsWKBTypes::Type segmentizedType, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker, QPolygonF& markers )
+{
+  const QgsGeometry* geom = feature.constGeometry();
+  // curved geometries are segmentized, their parts are set on the render context
+  bool deleteSegmentizedGeometry = segmentizedGeometry != geom;
+  bool curved = deleteSegmentizedGeometry;
+  QgsWKBTypes::Type geomType = QgsConstWkbPtr( geom->asWkb(), geom->wkbSize() ).readHeader();
+  bool tileMapRendering = context.testFlag( QgsRenderContext::RenderMapTile );
+
+  switch ( QgsWKBTypes::flatType( segmentizedType ) )
   {
     case QgsWKBTypes::Point:
     {
@@ -750,8 +826,12 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
         break;
       }
 
-      const QgsPointV2* point = static_cast< const QgsPointV2* >( segmentizedGeometry->geometry() );
-      _getPoint( pt, context, point );
+      QgsConstWkbPtr wkbPtr( segmentizedGeometry->asWkb(), segmentizedGeometry->wkbSize() );
+      if ( wkbPtr.remaining() < 5 + 2 * static_cast< int >( sizeof( double ) ) )
+      {
+        break;
+      }
+      _getPoint( pt, context, wkbPtr );
       static_cast<QgsMarkerSymbolV2*>( this )->renderPoint( pt, &feature, context, layer, selected );
 
       if ( context.testFlag( QgsRenderContext::DrawSymbolBounds ) )
@@ -821,20 +901,34 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
         break;
       }
 
-      QgsMultiPointV2* mp = static_cast< QgsMultiPointV2* >( segmentizedGeometry->geometry() );
+      QgsConstWkbPtr wkbPtr( segmentizedGeometry->asWkb(), segmentizedGeometry->wkbSize() );
+      QgsWKBTypes::Type pointType = QgsWKBTypes::singleType( wkbPtr.readHeader() );
+
+      int num = 0;
+      if ( wkbPtr.remaining() >= static_cast< int >( sizeof( int ) ) )
+      {
+        wkbPtr >> num;
+      }
+
+      // each point has its header
+      int pointSize = 5 + QgsWKBTypes::coordDimensions( pointType ) * sizeof( double );
+      if ( num < 0 || num > wkbPtr.remaining() / pointSize )
+      {
+        QgsDebugMsg( QString( "%1 points exceed wkb length (%2)" ).arg( num ).arg( wkbPtr.remaining() ) );
+        break;
+      }
 
       if ( drawVertexMarker && !deleteSegmentizedGeometry )
       {
-        markers.reserve( mp->numGeometries() );
+        markers.reserve( num );
       }
 
-      for ( int i = 0; i < mp->numGeometries(); ++i )
+      for ( int i = 0; i < num; ++i )
       {
         mSymbolRenderContext->setGeometryPartNum( i + 1 );
         mSymbolRenderContext->expressionContextScope()->setVariable( QgsExpressionContext::EXPR_GEOMETRY_PART_NUM, i + 1 );
 
-        const QgsPointV2* point = static_cast< const QgsPointV2* >( mp->geometryN( i ) );
-        _getPoint( pt, context, point );
+        _getPoint( pt, context, wkbPtr );
         static_cast<QgsMarkerSymbolV2*>( this )->renderPoint( pt, &feature, context, layer, selected );
 
         if ( drawVertexMarker && !deleteSegmentizedGeometry )
@@ -862,7 +956,7 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
       unsigned int num;
       wkbPtr >> num;
 
-      const QgsGeometryCollectionV2* geomCollection = dynamic_cast<const QgsGeometryCollectionV2*>( geom->geometry() );
+      const QgsGeometryCollectionV2* geomCollection = curved ? dynamic_cast<const QgsGeometryCollectionV2*>( geom->geometry() ) : nullptr;
 
       for ( unsigned int i = 0; i < num && wkbPtr; ++i )
       {
@@ -912,7 +1006,7 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
       QPolygonF pts;
       QList<QPolygonF> holes;
 
-      const QgsGeometryCollectionV2* geomCollection = dynamic_cast<const QgsGeometryCollectionV2*>( geom->geometry() );
+      const QgsGeometryCollectionV2* geomCollection = curved ? dynamic_cast<const QgsGeometryCollectionV2*>( geom->geometry() ) : nullptr;
 
       for ( unsigned int i = 0; i < num && wkbPtr; ++i )
       {
@@ -967,53 +1061,9 @@ void QgsSymbolV2::renderFeature( const QgsFeature& feature, QgsRenderContext& co
     default:
       QgsDebugMsg( QString( "feature %1: unsupported wkb type %2/%3 for rendering" )
                    .arg( feature.id() )
-                   .arg( QgsWKBTypes::displayString( geom->geometry()->wkbType() ) )
+                   .arg( QgsWKBTypes::displayString( geomType ) )
                    .arg( geom->wkbType(), 0, 16 ) );
   }
-
-  if ( drawVertexMarker )
-  {
-    if ( markers.size() > 0 )
-    {
-      Q_FOREACH ( QPointF marker, markers )
-      {
-        renderVertexMarker( marker, context, currentVertexMarkerType, currentVertexMarkerSize );
-      }
-    }
-    else
-    {
-      QgsCoordinateTransform ct = context.coordinateTransform();
-      const QgsMapToPixel& mtp = context.mapToPixel();
-
-      QgsPointV2 vertexPoint;
-      QgsVertexId vertexId;
-      double x, y, z;
-      QPointF mapPoint;
-      while ( geom->geometry()->nextVertex( vertexId, vertexPoint ) )
-      {
-        //transform
-        x = vertexPoint.x();
-        y = vertexPoint.y();
-        z = 0.0;
-        if ( ct.isValid() )
-        {
-          ct.transformInPlace( x, y, z );
-        }
-        mapPoint.setX( x );
-        mapPoint.setY( y );
-        mtp.transformInPlace( mapPoint.rx(), mapPoint.ry() );
-        renderVertexMarker( mapPoint, context, currentVertexMarkerType, currentVertexMarkerSize );
-      }
-    }
-  }
-
-  if ( deleteSegmentizedGeometry )
-  {
-    delete segmentizedGeometry;
-  }
-
-  if ( mSymbolRenderContext->expressionContextScope() )
-    context.expressionContext().popScope();
 }
 
 QgsSymbolV2RenderContext* QgsSymbolV2::symbolRenderContext()
@@ -333,6 +333,12 @@ class CORE_EXPORT QgsSymbolV2
     const QgsVectorLayer* mLayer; //current vectorlayer
 
   private:
+    /** Renders the parts of a feature geometry, or of its segmentized geometry, from their WKB
+     * and collects the vertex markers of the parts
+     * @throws QgsWkbException if the WKB is not valid
+     */
+    void renderFeatureParts( const QgsFeature& feature, const QgsGeometry* segmentizedGeometry, QgsWKBTypes::Type segmentizedType, QgsRenderContext& context, int layer, bool selected, bool drawVertexMarker, QPolygonF& markers );
+
     //! Initialized in startRender, destroyed in stopRender
     QgsSymbolV2RenderContext* mSymbolRenderContext;
 
@@ -418,6 +418,9 @@ void QgsMapCanvas::setCrsTransformEnabled( bool enabled )
 
   updateDatumTransformEntries();
 
+  // cached images are only valid for the map settings they have been rendered with
+  clearCache();
+
   refresh();
 
   emit hasCrsTransformEnabledChanged( enabled );
@@ -453,6 +456,8 @@ void QgsMapCanvas::setDestinationCrs( const QgsCoordinateReferenceSystem &crs )
     setExtent( rect );
   }
 
+  clearCache();
+
   QgsDebugMsg( "refreshing after destination CRS changed" );
   refresh();
 
@@ -890,6 +895,8 @@ void QgsMapCanvas::setRotation( double degrees )
     return;
 
   mSettings.setRotation( degrees );
+  // the visible extent of the map rotated by 180 degrees is the same
+  clearCache();
   emit rotationChanged( degrees );
   emit extentsChanged(); // visible extent changes with rotation
 
@@ -199,6 +199,10 @@ void QgsInterpolationDialog::on_buttonBox_accepted()
   //create grid file writer
   QgsGridFileWriter theWriter( theInterpolator, fileName, outputBBox, mNumberOfColumnsSpinBox->value(),
                                mNumberOfRowsSpinBox->value(), mCellsizeXSpinBox->value(), mCellSizeYSpinBox->value() );
+  if ( suffix.compare( "tif", Qt::CaseInsensitive ) == 0 || suffix.compare( "tiff", Qt::CaseInsensitive ) == 0 )
+  {
+    theWriter.setOutputFormat( "GTiff" );
+  }
   if ( theWriter.writeFile( true ) == 0 )
   {
     if ( mAddResultToProjectCheckBox->isChecked() )
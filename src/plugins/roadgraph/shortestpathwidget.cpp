@@ -42,6 +42,7 @@
 #include <qgsgraphdirector.h>
 #include <qgsgraphbuilder.h>
 #include <qgsgraph.h>
+#include <qgscompactgraph.h>
 #include <qgsgraphanalyzer.h>
 
 // roadgraph plugin includes
@@ -315,16 +316,30 @@ QgsGraph* RgShortestPathWidget::getPath( QgsPoint& p1, QgsPoint& p2 )
   }
 
 
-  QgsGraph* shortestpathTree = QgsGraphAnalyzer::shortestTree( graph, startVertexIdx, criterionNum );
-  delete graph;
+  int stopVertexIdx = graph->findVertex( p2 );
+  QgsCompactGraph compactGraph( graph, criterionNum );
+  QgsGraphArcIdList arcs = QgsGraphAnalyzer::shortestPath( &compactGraph, startVertexIdx, stopVertexIdx, QgsGraphAnalyzer::AStar );
 
-  if ( shortestpathTree->findVertex( p2 ) == -1 )
+  if ( stopVertexIdx < 0 || ( arcs.isEmpty() && stopVertexIdx != startVertexIdx ) )
   {
-    delete shortestpathTree;
+    delete graph;
     QMessageBox::critical( this, tr( "Path not found" ), tr( "Path not found" ) );
     return nullptr;
   }
-  return shortestpathTree;
+
+  // the path as a graph, each vertex has the path arc leading to it as incoming arc
+  QgsGraph* path = new QgsGraph();
+  int pathVertexIdx = path->addVertex( graph->vertex( startVertexIdx ).point() );
+  Q_FOREACH ( int arcIdx, arcs )
+  {
+    const QgsGraphArc& arc = graph->arc( arcIdx );
+    int nextVertexIdx = path->addVertex( graph->vertex( arc.inVertex() ).point() );
+    path->addArc( pathVertexIdx, nextVertexIdx, arc.properties() );
+    pathVertexIdx = nextVertexIdx;
+  }
+  delete graph;
+
+  return path;
 }
 
 void RgShortestPathWidget::findingPath()
@@ -0,0 +1,393 @@
+/***************************************************************************
+    qgsmemorycolumnstore.cpp
+    ---------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsmemorycolumnstore.h"
+
+#include "qgsgeometry.h"
+
+#include <algorithm>
+#include <string.h>
+
+/** Removes the values of the rows flagged in removed, keeping the order of the other values.
+ * Arrays of the unused types of a column are empty and left as they are. */
+template <typename T> static void removeValues( QVector<T>& values, const QBitArray& removed )
+{
+  if ( values.isEmpty() )
+    return;
+
+  int kept = 0;
+  for ( int i = 0; i < values.size(); ++i )
+  {
+    if ( removed.testBit( i ) )
+      continue;
+    if ( kept != i )
+      values[kept] = values.at( i );
+    ++kept;
+  }
+  values.resize( kept );
+}
+
+static void removeBits( QBitArray& bits, const QBitArray& removed )
+{
+  int kept = 0;
+  for ( int i = 0; i < bits.size(); ++i )
+  {
+    if ( removed.testBit( i ) )
+      continue;
+    if ( kept != i )
+      bits.setBit( kept, bits.testBit( i ) );
+    ++kept;
+  }
+  bits.resize( kept );
+}
+
+
+QgsMemoryColumnStore::QgsMemoryColumnStore()
+    : mWkbSize( 0 )
+    , mWkbUnused( 0 )
+{
+}
+
+int QgsMemoryColumnStore::row( QgsFeatureId id ) const
+{
+  QVector<QgsFeatureId>::const_iterator it = std::lower_bound( mIds.constBegin(), mIds.constEnd(), id );
+  if ( it == mIds.constEnd() || *it != id )
+    return -1;
+  return it - mIds.constBegin();
+}
+
+void QgsMemoryColumnStore::append( QgsFeatureId id, const QgsFeature& feature )
+{
+  Q_ASSERT( mIds.isEmpty() || id > mIds.last() );
+
+  mIds.append( id );
+
+  const QgsAttributes attributes = feature.attributes();
+  for ( int i = 0; i < mColumns.size(); ++i )
+  {
+    appendValue( mColumns[i], i < attributes.size() ? attributes.at( i ) : QVariant() );
+  }
+
+  mWkbOffsets.append( mWkbSize );
+  mWkbSizes.append( 0 );
+  mBoxes.append( QgsRectangle() );
+  setGeometry( mIds.size() - 1, feature.constGeometry() );
+}
+
+void QgsMemoryColumnStore::removeRows( const QVector<int>& rows )
+{
+  if ( rows.isEmpty() )
+    return;
+
+  QBitArray removed( mIds.size() );
+  Q_FOREACH ( int row, rows )
+  {
+    if ( removed.testBit( row ) )
+      continue;
+    removed.setBit( row );
+    mWkbUnused += mWkbSizes.at( row );
+  }
+
+  removeValues( mIds, removed );
+  for ( int i = 0; i < mColumns.size(); ++i )
+  {
+    Column& column = mColumns[i];
+    removeBits( column.nulls, removed );
+    removeValues( column.ints, removed );
+    removeValues( column.longs, removed );
+    removeValues( column.doubles, removed );
+    removeValues( column.strings, removed );
+    removeValues( column.dates, removed );
+    removeValues( column.times, removed );
+    removeValues( column.dateTimes, removed );
+  }
+  removeValues( mWkbOffsets, removed );
+  removeValues( mWkbSizes, removed );
+  removeValues( mBoxes, removed );
+
+  if ( mWkbUnused > mWkbSize / 2 )
+    compactWkb();
+}
+
+void QgsMemoryColumnStore::addColumn( QVariant::Type type )
+{
+  Column column;
+  column.type = type;
+  column.nulls.fill( true, mIds.size() );
+  switch ( type )
+  {
+    case QVariant::Int:
+      column.ints.resize( mIds.size() );
+      break;
+    case QVariant::LongLong:
+      column.longs.resize( mIds.size() );
+      break;
+    case QVariant::Double:
+      column.doubles.resize( mIds.size() );
+      break;
+    case QVariant::Date:
+      column.dates.resize( mIds.size() );
+      break;
+    case QVariant::Time:
+      column.times.resize( mIds.size() );
+      break;
+    case QVariant::DateTime:
+      column.dateTimes.resize( mIds.size() );
+      break;
+    default:
+      column.type = QVariant::String;
+      column.strings.resize( mIds.size() );
+      break;
+  }
+  mColumns.append( column );
+}
+
+void QgsMemoryColumnStore::removeColumn( int column )
+{
+  mColumns.remove( column );
+}
+
+QVariant QgsMemoryColumnStore::attribute( int row, int column ) const
+{
+  const Column& c = mColumns.at( column );
+  if ( c.nulls.testBit( row ) )
+    return QVariant( c.type );
+
+  switch ( c.type )
+  {
+    case QVariant::Int:
+      return QVariant( c.ints.at( row ) );
+    case QVariant::LongLong:
+      return QVariant( c.longs.at( row ) );
+    case QVariant::Double:
+      return QVariant( c.doubles.at( row ) );
+    case QVariant::Date:
+      return QVariant( c.dates.at( row ) );
+    case QVariant::Time:
+      return QVariant( c.times.at( row ) );
+    case QVariant::DateTime:
+      return QVariant( c.dateTimes.at( row ) );
+    default:
+      return QVariant( c.strings.at( row ) );
+  }
+}
+
+void QgsMemoryColumnStore::setAttribute( int row, int column, const QVariant& value )
+{
+  setValue( mColumns[column], row, value );
+}
+
+void QgsMemoryColumnStore::appendValue( Column& column, const QVariant& value )
+{
+  int row = column.nulls.size();
+  column.nulls.resize( row + 1 );
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      column.ints.append( 0 );
+      break;
+    case QVariant::LongLong:
+      column.longs.append( 0 );
+      break;
+    case QVariant::Double:
+      column.doubles.append( 0 );
+      break;
+    case QVariant::Date:
+      column.dates.append( QDate() );
+      break;
+    case QVariant::Time:
+      column.times.append( QTime() );
+      break;
+    case QVariant::DateTime:
+      column.dateTimes.append( QDateTime() );
+      break;
+    default:
+      column.strings.append( QString() );
+      break;
+  }
+  setValue( column, row, value );
+}
+
+void QgsMemoryColumnStore::setValue( Column& column, int row, const QVariant& value )
+{
+  QVariant converted( value );
+  bool isNull = value.isNull() || !converted.convert( column.type );
+  column.nulls.setBit( row, isNull );
+
+  switch ( column.type )
+  {
+    case QVariant::Int:
+      column.ints[row] = isNull ? 0 : converted.toInt();
+      break;
+    case QVariant::LongLong:
+      column.longs[row] = isNull ? 0 : converted.toLongLong();
+      break;
+    case QVariant::Double:
+      column.doubles[row] = isNull ? 0 : converted.toDouble();
+      break;
+    case QVariant::Date:
+      column.dates[row] = isNull ? QDate() : converted.toDate();
+      break;
+    case QVariant::Time:
+      column.times[row] = isNull ? QTime() : converted.toTime();
+      break;
+    case QVariant::DateTime:
+      column.dateTimes[row] = isNull ? QDateTime() : converted.toDateTime();
+      break;
+    default:
+      column.strings[row] = isNull ? QString() : converted.toString();
+      break;
+  }
+}
+
+QgsGeometry* QgsMemoryColumnStore::geometry( int row ) const
+{
+  int size = mWkbSizes.at( row );
+  if ( size <= 0 )
+    return nullptr;
+
+  // QgsGeometry takes ownership of the buffer
+  unsigned char* wkb = new unsigned char[size];
+  readWkb( mWkbChunks, mWkbOffsets.at( row ), reinterpret_cast< char* >( wkb ), size );
+  QgsGeometry* g = new QgsGeometry();
+  g->fromWkb( wkb, size );
+  return g;
+}
+
+void QgsMemoryColumnStore::setGeometry( int row, const QgsGeometry* geometry )
+{
+  const unsigned char* wkb = geometry ? geometry->asWkb() : nullptr;
+  int size = wkb ? geometry->wkbSize() : 0;
+  int oldSize = mWkbSizes.at( row );
+
+  if ( size > oldSize )
+  {
+    mWkbOffsets[row] = mWkbSize;
+    writeWkb( mWkbSize, reinterpret_cast< const char* >( wkb ), size );
+    mWkbSize += size;
+    mWkbUnused += oldSize;
+  }
+  else
+  {
+    // reuse the space of the previous geometry
+    if ( size > 0 )
+      writeWkb( mWkbOffsets.at( row ), reinterpret_cast< const char* >( wkb ), size );
+    mWkbUnused += oldSize - size;
+  }
+  mWkbSizes[row] = size;
+  mBoxes[row] = size > 0 ? geometry->boundingBox() : QgsRectangle();
+
+  if ( mWkbUnused > mWkbSize / 2 )
+    compactWkb();
+}
+
+void QgsMemoryColumnStore::readFeature( int row, QgsFeature& feature, const QgsAttributeList* attributes, bool fetchGeometry ) const
+{
+  feature.setFeatureId( mIds.at( row ) );
+
+  QgsAttributes values( mColumns.size() );
+  if ( attributes )
+  {
+    Q_FOREACH ( int column, *attributes )
+    {
+      if ( column >= 0 && column < mColumns.size() )
+        values[column] = attribute( row, column );
+    }
+  }
+  else
+  {
+    for ( int column = 0; column < mColumns.size(); ++column )
+      values[column] = attribute( row, column );
+  }
+  feature.setAttributes( values );
+
+  feature.setGeometry( fetchGeometry ? geometry( row ) : nullptr );
+  feature.setValid( true );
+}
+
+QgsRectangle QgsMemoryColumnStore::extent() const
+{
+  QgsRectangle extent;
+  bool first = true;
+  for ( int row = 0; row < mIds.size(); ++row )
+  {
+    if ( mWkbSizes.at( row ) <= 0 )
+      continue;
+
+    if ( first )
+      extent = mBoxes.at( row );
+    else
+      extent.unionRect( mBoxes.at( row ) );
+    first = false;
+  }
+  return extent;
+}
+
+void QgsMemoryColumnStore::writeWkb( qint64 offset, const char* data, int size )
+{
+  while ( size > 0 )
+  {
+    int chunk = static_cast< int >( offset / WKB_CHUNK_SIZE );
+    int position = static_cast< int >( offset % WKB_CHUNK_SIZE );
+    int count = qMin( size, WKB_CHUNK_SIZE - position );
+    if ( chunk == mWkbChunks.size() )
+      mWkbChunks.append( QByteArray() );
+
+    // only the written chunk is detached from the copies of the store
+    QByteArray& bytes = mWkbChunks[chunk];
+    if ( bytes.size() < position + count )
+      bytes.resize( position + count );
+    memcpy( bytes.data() + position, data, count );
+
+    offset += count;
+    data += count;
+    size -= count;
+  }
+}
+
+void QgsMemoryColumnStore::readWkb( const QVector<QByteArray>& chunks, qint64 offset, char* data, int size )
+{
+  while ( size > 0 )
+  {
+    int chunk = static_cast< int >( offset / WKB_CHUNK_SIZE );
+    int position = static_cast< int >( offset % WKB_CHUNK_SIZE );
+    int count = qMin( size, WKB_CHUNK_SIZE - position );
+    memcpy( data, chunks.at( chunk ).constData() + position, count );
+
+    offset += count;
+    data += count;
+    size -= count;
+  }
+}
+
+void QgsMemoryColumnStore::compactWkb()
+{
+  QVector<QByteArray> chunks = mWkbChunks;
+  mWkbChunks.clear();
+  mWkbSize = 0;
+
+  QByteArray wkb;
+  for ( int row = 0; row < mIds.size(); ++row )
+  {
+    int size = mWkbSizes.at( row );
+    if ( size > 0 )
+    {
+      wkb.resize( size );
+      readWkb( chunks, mWkbOffsets.at( row ), wkb.data(), size );
+      writeWkb( mWkbSize, wkb.constData(), size );
+    }
+    mWkbOffsets[row] = mWkbSize;
+    mWkbSize += size;
+  }
+  mWkbUnused = 0;
+}
@@ -0,0 +1,155 @@
+/***************************************************************************
+    qgsmemorycolumnstore.h
+    ---------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSMEMORYCOLUMNSTORE_H
+#define QGSMEMORYCOLUMNSTORE_H
+
+#include <QBitArray>
+#include <QByteArray>
+#include <QDate>
+#include <QDateTime>
+#include <QTime>
+#include <QVariant>
+#include <QVector>
+
+#include "qgsfeature.h"
+#include "qgsfield.h"
+#include "qgsrectangle.h"
+
+class QgsGeometry;
+
+/**
+ * Columnar feature storage of the memory provider, used with the "storage=columnar" uri option.
+ *
+ * Each feature is a row: attributes are kept in one typed array per field and geometries as WKB
+ * packed in a sequence of fixed size byte arrays, with the offset, size and bounding box of each
+ * row. Offsets are 64 bit, so the WKB of a layer is not limited to the size of a byte array. Feature ids
+ * are assigned in increasing order, so the id column is sorted and finding the row of a feature
+ * is a binary search. A row costs a few tens of bytes besides its values, instead of the feature,
+ * attribute vector, variants and geometry allocated for each entry of a QgsFeatureMap.
+ *
+ * Values are converted to the type of their field when they are stored, values which cannot be
+ * converted are stored as null.
+ *
+ * All the arrays are implicitly shared: copying the store for a feature source is cheap and the
+ * copy is detached array by array, and WKB chunk by chunk, when the provider is edited.
+ */
+class QgsMemoryColumnStore
+{
+  public:
+    QgsMemoryColumnStore();
+
+    //! Returns the number of features
+    int rowCount() const { return mIds.size(); }
+
+    //! Returns the row of a feature, -1 if there is no such feature
+    int row( QgsFeatureId id ) const;
+
+    //! Returns the id of the feature of a row
+    QgsFeatureId id( int row ) const { return mIds.at( row ); }
+
+    //! Appends a feature, its id must be greater than the ids already stored
+    void append( QgsFeatureId id, const QgsFeature& feature );
+
+    //! Removes the features of a set of rows
+    void removeRows( const QVector<int>& rows );
+
+    //! Appends an attribute column of a field type, with null values
+    void addColumn( QVariant::Type type );
+
+    //! Removes an attribute column
+    void removeColumn( int column );
+
+    //! Returns an attribute of a row
+    QVariant attribute( int row, int column ) const;
+
+    //! Changes an attribute of a row
+    void setAttribute( int row, int column, const QVariant& value );
+
+    //! Returns true if the feature of a row has a geometry
+    bool hasGeometry( int row ) const { return mWkbSizes.at( row ) > 0; }
+
+    //! Returns the bounding box of the geometry of a row, a null rectangle if it has no geometry
+    QgsRectangle boundingBox( int row ) const { return mBoxes.at( row ); }
+
+    //! Returns a new geometry read from the WKB of a row, nullptr if it has no geometry
+    QgsGeometry* geometry( int row ) const;
+
+    //! Changes the geometry of a row, which has no geometry if geometry is nullptr or empty
+    void setGeometry( int row, const QgsGeometry* geometry );
+
+    /**
+     * Reads the feature of a row
+     * @param row row of the feature
+     * @param feature receives the id, attributes and geometry
+     * @param attributes indexes of the attributes to read or nullptr to read all of them, the
+     * other attributes of the feature are null
+     * @param fetchGeometry whether to read the geometry, the feature has no geometry otherwise
+     */
+    void readFeature( int row, QgsFeature& feature, const QgsAttributeList* attributes, bool fetchGeometry ) const;
+
+    //! Returns the union of the bounding boxes of the geometries
+    QgsRectangle extent() const;
+
+  private:
+
+    //! Values of an attribute, only the array matching the field type is used
+    struct Column
+    {
+      QVariant::Type type;
+      QBitArray nulls;
+      QVector<int> ints;
+      QVector<qlonglong> longs;
+      QVector<double> doubles;
+      QVector<QString> strings;
+      QVector<QDate> dates;
+      QVector<QTime> times;
+      QVector<QDateTime> dateTimes;
+    };
+
+    //! Appends a value to a column
+    static void appendValue( Column& column, const QVariant& value );
+
+    //! Stores a value in an existing row of a column
+    static void setValue( Column& column, int row, const QVariant& value );
+
+    //! Size of the byte arrays holding the WKB
+    static const int WKB_CHUNK_SIZE = 16 * 1024 * 1024;
+
+    //! Copies WKB at an offset of the chunks, which are extended when writing past their end
+    void writeWkb( qint64 offset, const char* data, int size );
+
+    //! Copies the WKB stored at an offset of chunks
+    static void readWkb( const QVector<QByteArray>& chunks, qint64 offset, char* data, int size );
+
+    //! Rewrites the chunks without the WKB which is not referenced any more
+    void compactWkb();
+
+    //! Ids of the features, sorted
+    QVector<QgsFeatureId> mIds;
+
+    QVector<Column> mColumns;
+
+    //! WKB of all the geometries, in chunks of WKB_CHUNK_SIZE bytes, the WKB of a row may span chunks
+    QVector<QByteArray> mWkbChunks;
+    //! Number of bytes written in the chunks
+    qint64 mWkbSize;
+    QVector<qint64> mWkbOffsets;
+    //! Size of the WKB of each row, 0 for rows without geometry
+    QVector<int> mWkbSizes;
+    QVector<QgsRectangle> mBoxes;
+    //! Number of bytes of the chunks which are not used by any row
+    qint64 mWkbUnused;
+};
+
+#endif // QGSMEMORYCOLUMNSTORE_H
@@ -26,6 +26,9 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource* sour
     : QgsAbstractFeatureIteratorFromSource<QgsMemoryFeatureSource>( source, ownSource, request )
     , mSelectRectGeom( nullptr )
     , mSubsetExpression( nullptr )
+    , mRow( 0 )
+    , mFetchGeometry( true )
+    , mFetchAllAttributes( true )
 {
   if ( !mSource->mSubsetString.isEmpty() )
   {
@@ -49,15 +52,46 @@ QgsMemoryFeatureIterator::QgsMemoryFeatureIterator( QgsMemoryFeatureSource* sour
   else if ( mRequest.filterType() == QgsFeatureRequest::FilterFid )
   {
     mUsingFeatureIdList = true;
-    QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( mRequest.filterFid() );
-    if ( it != mSource->mFeatures.constEnd() )
-      mFeatureIdList.append( mRequest.filterFid() );
+    if ( mSource->mColumnar )
+    {
+      if ( mSource->mColumnStore.row( mRequest.filterFid() ) >= 0 )
+        mFeatureIdList.append( mRequest.filterFid() );
+    }
+    else
+    {
+      QgsFeatureMap::const_iterator it = mSource->mFeatures.constFind( mRequest.filterFid() );
+      if ( it != mSource->mFeatures.constEnd() )
+        mFeatureIdList.append( mRequest.filterFid() );
+    }
   }
   else
   {
     mUsingFeatureIdList = false;
   }
 
+  if ( mSource->mColumnar && !mSubsetExpression )
+  {
+    // only the columns and geometries which are requested are read from the columnar storage
+    mFetchGeometry = !mRequest.filterRect().isNull() || !( mRequest.flags() & QgsFeatureRequest::NoGeometry );
+    mFetchAllAttributes = !( mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes );
+    mAttributes = mRequest.subsetOfAttributes();
+
+    // ensure that all attributes required for expression filter are being fetched
+    if ( !mFetchAllAttributes && mRequest.filterType() == QgsFeatureRequest::FilterExpression )
+    {
+      Q_FOREACH ( const QString& field, mRequest.filterExpression()->referencedColumns() )
+      {
+        int attrIdx = mSource->mFields.fieldNameIndex( field );
+        if ( !mAttributes.contains( attrIdx ) )
+          mAttributes << attrIdx;
+      }
+    }
+    if ( mRequest.filterType() == QgsFeatureRequest::FilterExpression && mRequest.filterExpression()->needsGeometry() )
+    {
+      mFetchGeometry = true;
+    }
+  }
+
   rewind();
 }
 
@@ -76,7 +110,9 @@ bool QgsMemoryFeatureIterator::fetchFeature( QgsFeature& feature )
   if ( mClosed )
     return false;
 
-  if ( mUsingFeatureIdList )
+  if ( mSource->mColumnar )
+    return nextFeatureFromColumns( feature );
+  else if ( mUsingFeatureIdList )
     return nextFeatureUsingList( feature );
   else
     return nextFeatureTraverseAll( feature );
@@ -183,6 +219,55 @@ bool QgsMemoryFeatureIterator::nextFeatureTraverseAll( QgsFeature& feature )
   return hasFeature;
 }
 
+bool QgsMemoryFeatureIterator::nextFeatureFromColumns( QgsFeature& feature )
+{
+  const QgsMemoryColumnStore& store = mSource->mColumnStore;
+
+  for ( ;; )
+  {
+    int row;
+    if ( mUsingFeatureIdList )
+    {
+      if ( mFeatureIdListIterator == mFeatureIdList.constEnd() )
+        break;
+      row = store.row( *mFeatureIdListIterator );
+      ++mFeatureIdListIterator;
+      if ( row < 0 )
+        continue;
+    }
+    else
+    {
+      if ( mRow >= store.rowCount() )
+        break;
+      row = mRow++;
+    }
+
+    // the bounding boxes are stored, so the rectangle is checked before reading anything
+    if ( !mRequest.filterRect().isNull() && ( !store.hasGeometry( row ) || !store.boundingBox( row ).intersects( mRequest.filterRect() ) ) )
+      continue;
+
+    store.readFeature( row, feature, mFetchAllAttributes ? nullptr : &mAttributes, mFetchGeometry );
+
+    // do exact check in case we're doing intersection
+    if ( mSelectRectGeom && !( feature.constGeometry() && feature.constGeometry()->intersects( mSelectRectGeom ) ) )
+      continue;
+
+    if ( mSubsetExpression )
+    {
+      mSource->mExpressionContext.setFeature( feature );
+      if ( !mSubsetExpression->evaluate( &mSource->mExpressionContext ).toBool() )
+        continue;
+    }
+
+    feature.setFields( mSource->mFields ); // allow name-based attribute lookups
+    return true;
+  }
+
+  close();
+  feature.setValid( false );
+  return false;
+}
+
 bool QgsMemoryFeatureIterator::rewind()
 {
   if ( mClosed )
@@ -190,6 +275,8 @@ bool QgsMemoryFeatureIterator::rewind()
 
   if ( mUsingFeatureIdList )
     mFeatureIdListIterator = mFeatureIdList.constBegin();
+  else if ( mSource->mColumnar )
+    mRow = 0;
   else
     mSelectIterator = mSource->mFeatures.constBegin();
 
@@ -215,6 +302,8 @@ bool QgsMemoryFeatureIterator::close()
 QgsMemoryFeatureSource::QgsMemoryFeatureSource( const QgsMemoryProvider* p )
     : mFields( p->mFields )
     , mFeatures( p->mFeatures )
+    , mColumnar( p->mColumnar )
+    , mColumnStore( p->mColumnStore )
     , mSpatialIndex( p->mSpatialIndex ? new QgsSpatialIndex( *p->mSpatialIndex ) : nullptr )  // just shallow copy
     , mSubsetString( p->mSubsetString )
 {
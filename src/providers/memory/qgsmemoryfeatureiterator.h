@@ -18,6 +18,7 @@
 #include "qgsfeatureiterator.h"
 #include "qgsexpressioncontext.h"
 #include "qgsfield.h"
+#include "qgsmemorycolumnstore.h"
 
 class QgsMemoryProvider;
 
@@ -37,6 +38,8 @@ class QgsMemoryFeatureSource : public QgsAbstractFeatureSource
   protected:
     QgsFields mFields;
     QgsFeatureMap mFeatures;
+    bool mColumnar;
+    QgsMemoryColumnStore mColumnStore;
     QgsSpatialIndex* mSpatialIndex;
     QString mSubsetString;
     QgsExpressionContext mExpressionContext;
@@ -65,6 +68,8 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
 
     bool nextFeatureUsingList( QgsFeature& feature );
     bool nextFeatureTraverseAll( QgsFeature& feature );
+    //! fetch next feature from the columnar storage, with the list of features or traversing all rows
+    bool nextFeatureFromColumns( QgsFeature& feature );
 
     QgsGeometry* mSelectRectGeom;
     QgsFeatureMap::const_iterator mSelectIterator;
@@ -73,6 +78,12 @@ class QgsMemoryFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Qgs
     QList<QgsFeatureId>::const_iterator mFeatureIdListIterator;
     QgsExpression* mSubsetExpression;
 
+    // columnar storage
+    int mRow;
+    bool mFetchGeometry;
+    bool mFetchAllAttributes;
+    QgsAttributeList mAttributes;
+
 };
 
 #endif // QGSMEMORYFEATUREITERATOR_H
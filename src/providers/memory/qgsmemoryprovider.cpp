@@ -32,6 +32,7 @@ static const QString TEXT_PROVIDER_DESCRIPTION = "Memory provider";
 
 QgsMemoryProvider::QgsMemoryProvider( const QString& uri )
     : QgsVectorDataProvider( uri )
+    , mColumnar( false )
     , mSpatialIndex( nullptr )
 {
   // Initialize the geometry with the uri to support old style uri's
@@ -73,6 +74,11 @@ QgsMemoryProvider::QgsMemoryProvider( const QString& uri )
 
   mNextFeatureId = 1;
 
+  if ( url.hasQueryItem( "storage" ) && url.queryItemValue( "storage" ) == "columnar" )
+  {
+    mColumnar = true;
+  }
+
   mNativeTypes
   << QgsVectorDataProvider::NativeType( tr( "Whole number (integer)" ), "integer", QVariant::Int, 0, 10 )
   // Decimal number from OGR/Shapefile/dbf may come with length up to 32 and
@@ -258,6 +264,10 @@ QString QgsMemoryProvider::dataSourceUri( bool expandAuthConfig ) const
   {
     uri.addQueryItem( "index", "yes" );
   }
+  if ( mColumnar )
+  {
+    uri.addQueryItem( "storage", "columnar" );
+  }
 
   QgsAttributeList attrs = const_cast<QgsMemoryProvider *>( this )->attributeIndexes();
   for ( int i = 0; i < attrs.size(); i++ )
@@ -296,7 +306,7 @@ Qgis::WkbType QgsMemoryProvider::geometryType() const
 long QgsMemoryProvider::featureCount() const
 {
   if ( mSubsetString.isEmpty() )
-    return mFeatures.count();
+    return mColumnar ? mColumnStore.rowCount() : mFeatures.count();
 
   // subset string set, no alternative but testing each feature
   QgsFeatureIterator fit = QgsFeatureIterator( new QgsMemoryFeatureIterator( new QgsMemoryFeatureSource( this ), true,  QgsFeatureRequest().setSubsetOfAttributes( QgsAttributeList() ) ) );
@@ -329,6 +339,26 @@ QgsCoordinateReferenceSystem QgsMemoryProvider::crs() const
 bool QgsMemoryProvider::addFeatures( QgsFeatureList & flist )
 {
   // TODO: sanity checks of fields and geometries
+  if ( mColumnar )
+  {
+    for ( QgsFeatureList::iterator it = flist.begin(); it != flist.end(); ++it )
+    {
+      mColumnStore.append( mNextFeatureId, *it );
+      it->setFeatureId( mNextFeatureId );
+
+      // update spatial index
+      int row = mColumnStore.rowCount() - 1;
+      if ( mSpatialIndex && mColumnStore.hasGeometry( row ) )
+        mSpatialIndex->insertFeature( mNextFeatureId, mColumnStore.boundingBox( row ) );
+
+      mNextFeatureId++;
+    }
+
+    updateExtent();
+
+    return true;
+  }
+
   for ( QgsFeatureList::iterator it = flist.begin(); it != flist.end(); ++it )
   {
     mFeatures[mNextFeatureId] = *it;
@@ -351,6 +381,30 @@ bool QgsMemoryProvider::addFeatures( QgsFeatureList & flist )
 
 bool QgsMemoryProvider::deleteFeatures( const QgsFeatureIds & id )
 {
+  if ( mColumnar )
+  {
+    QVector<int> rows;
+    for ( QgsFeatureIds::const_iterator it = id.begin(); it != id.end(); ++it )
+    {
+      int row = mColumnStore.row( *it );
+
+      // check whether such feature exists
+      if ( row < 0 )
+        continue;
+
+      // update spatial index
+      if ( mSpatialIndex && mColumnStore.hasGeometry( row ) )
+        mSpatialIndex->deleteFeature( *it, mColumnStore.boundingBox( row ) );
+
+      rows << row;
+    }
+    mColumnStore.removeRows( rows );
+
+    updateExtent();
+
+    return true;
+  }
+
   for ( QgsFeatureIds::const_iterator it = id.begin(); it != id.end(); ++it )
   {
     QgsFeatureMap::iterator fit = mFeatures.find( *it );
@@ -392,6 +446,12 @@ bool QgsMemoryProvider::addAttributes( const QList<QgsField> &attributes )
     // add new field as a last one
     mFields.append( *it );
 
+    if ( mColumnar )
+    {
+      mColumnStore.addColumn( it->type() );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature& f = fit.value();
@@ -438,6 +498,12 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds& attributes )
     int idx = *it;
     mFields.remove( idx );
 
+    if ( mColumnar )
+    {
+      mColumnStore.removeColumn( idx );
+      continue;
+    }
+
     for ( QgsFeatureMap::iterator fit = mFeatures.begin(); fit != mFeatures.end(); ++fit )
     {
       QgsFeature& f = fit.value();
@@ -451,6 +517,25 @@ bool QgsMemoryProvider::deleteAttributes( const QgsAttributeIds& attributes )
 
 bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &attr_map )
 {
+  if ( mColumnar )
+  {
+    for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
+    {
+      int row = mColumnStore.row( it.key() );
+      if ( row < 0 )
+        continue;
+
+      const QgsAttributeMap& attrs = it.value();
+      for ( QgsAttributeMap::const_iterator it2 = attrs.constBegin(); it2 != attrs.constEnd(); ++it2 )
+      {
+        if ( it2.key() >= 0 && it2.key() < mFields.count() )
+          mColumnStore.setAttribute( row, it2.key(), it2.value() );
+      }
+    }
+
+    return true;
+  }
+
   for ( QgsChangedAttributesMap::const_iterator it = attr_map.begin(); it != attr_map.end(); ++it )
   {
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
@@ -466,6 +551,30 @@ bool QgsMemoryProvider::changeAttributeValues( const QgsChangedAttributesMap &at
 
 bool QgsMemoryProvider::changeGeometryValues( const QgsGeometryMap &geometry_map )
 {
+  if ( mColumnar )
+  {
+    for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
+    {
+      int row = mColumnStore.row( it.key() );
+      if ( row < 0 )
+        continue;
+
+      // update spatial index
+      if ( mSpatialIndex && mColumnStore.hasGeometry( row ) )
+        mSpatialIndex->deleteFeature( it.key(), mColumnStore.boundingBox( row ) );
+
+      mColumnStore.setGeometry( row, &it.value() );
+
+      // update spatial index
+      if ( mSpatialIndex && mColumnStore.hasGeometry( row ) )
+        mSpatialIndex->insertFeature( it.key(), mColumnStore.boundingBox( row ) );
+    }
+
+    updateExtent();
+
+    return true;
+  }
+
   for ( QgsGeometryMap::const_iterator it = geometry_map.begin(); it != geometry_map.end(); ++it )
   {
     QgsFeatureMap::iterator fit = mFeatures.find( it.key() );
@@ -518,6 +627,11 @@ bool QgsMemoryProvider::createSpatialIndex()
     mSpatialIndex = new QgsSpatialIndex();
 
     // add existing features to index
+    for ( int row = 0; row < mColumnStore.rowCount(); ++row )
+    {
+      if ( mColumnStore.hasGeometry( row ) )
+        mSpatialIndex->insertFeature( mColumnStore.id( row ), mColumnStore.boundingBox( row ) );
+    }
     for ( QgsFeatureMap::const_iterator it = mFeatures.constBegin(); it != mFeatures.constEnd(); ++it )
     {
       mSpatialIndex->insertFeature( *it );
@@ -536,7 +650,11 @@ int QgsMemoryProvider::capabilities() const
 
 void QgsMemoryProvider::updateExtent()
 {
-  if ( mFeatures.isEmpty() )
+  if ( mColumnar )
+  {
+    mExtent = mColumnStore.extent();
+  }
+  else if ( mFeatures.isEmpty() )
   {
     mExtent = QgsRectangle();
   }
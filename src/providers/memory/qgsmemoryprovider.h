@@ -16,6 +16,7 @@
 #include "qgsvectordataprovider.h"
 #include "qgscoordinatereferencesystem.h"
 #include "qgsfield.h"
+#include "qgsmemorycolumnstore.h"
 
 typedef QMap<QgsFeatureId, QgsFeature> QgsFeatureMap;
 
@@ -163,6 +164,10 @@ class QgsMemoryProvider : public QgsVectorDataProvider
     QgsFeatureMap mFeatures;
     QgsFeatureId mNextFeatureId;
 
+    // features in columnar storage, used instead of mFeatures with "storage=columnar"
+    bool mColumnar;
+    QgsMemoryColumnStore mColumnStore;
+
     // indexing
     QgsSpatialIndex* mSpatialIndex;
 
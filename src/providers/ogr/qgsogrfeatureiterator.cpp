@@ -16,6 +16,7 @@
 
 #include "qgsogrprovider.h"
 #include "qgsogrexpressioncompiler.h"
+#include "qgsogrspatialindex.h"
 #include "qgssqliteexpressioncompiler.h"
 
 #include "qgsogrutils.h"
@@ -42,6 +43,8 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
     , ogrLayer( nullptr )
     , mSubsetStringSet( false )
     , mFetchGeometry( false )
+    , mUseSpatialIndex( false )
+    , mIndexFidPos( 0 )
     , mExpressionCompiled( false )
 {
   mConn = QgsOgrConnPool::instance()->acquireConnection( mSource->mProvider->dataSourceUri() );
@@ -101,8 +104,23 @@ QgsOgrFeatureIterator::QgsOgrFeatureIterator( QgsOgrFeatureSource* source, bool
     QgsOgrProviderUtils::setRelevantFields( ogrLayer, mSource->mFields.count(), mFetchGeometry, attrs, mSource->mFirstFieldIsFid );
   }
 
+  // the features found in the spatial index file are read by id, which ignores the filters of the layer
+  mUseSpatialIndex = !mRequest.filterRect().isNull() && mSource->mSpatialIndex && !mSubsetStringSet
+                     && mRequest.filterType() == QgsFeatureRequest::FilterNone;
+
+  // the data source may have been written since the index was opened
+  if ( mUseSpatialIndex )
+  {
+    OGR_L_SetSpatialFilter( ogrLayer, nullptr );
+    mUseSpatialIndex = mSource->mSpatialIndex->isUpToDate( OGR_L_GetFeatureCount( ogrLayer, false ) );
+  }
+
   // spatial query to select features
-  if ( !mRequest.filterRect().isNull() )
+  if ( mUseSpatialIndex )
+  {
+    mIndexFids = mSource->mSpatialIndex->intersects( mRequest.filterRect() );
+  }
+  else if ( !mRequest.filterRect().isNull() )
   {
     const QgsRectangle& rect = mRequest.filterRect();
 
@@ -192,6 +210,27 @@ bool QgsOgrFeatureIterator::fetchFeature( QgsFeature& feature )
 
   OGRFeatureH fet;
 
+  if ( mUseSpatialIndex )
+  {
+    while ( mIndexFidPos < mIndexFids.size() )
+    {
+      fet = OGR_L_GetFeature( ogrLayer, FID_TO_NUMBER( mIndexFids.at( mIndexFidPos++ ) ) );
+      if ( !fet || !readFeature( fet, feature ) )
+        continue;
+      else
+        OGR_F_Destroy( fet );
+
+      if ( !feature.constGeometry() )
+        continue;
+
+      feature.setValid( true );
+      return true;
+    }
+
+    close();
+    return false;
+  }
+
   while (( fet = OGR_L_GetNextFeature( ogrLayer ) ) )
   {
     if ( !readFeature( fet, feature ) )
@@ -219,6 +258,7 @@ bool QgsOgrFeatureIterator::rewind()
     return false;
 
   OGR_L_ResetReading( ogrLayer );
+  mIndexFidPos = 0;
 
   return true;
 }
@@ -332,6 +372,7 @@ QgsOgrFeatureSource::QgsOgrFeatureSource( const QgsOgrProvider* p )
   mDriverName = p->ogrDriverName;
   mFirstFieldIsFid = p->mFirstFieldIsFid;
   mOgrGeometryTypeFilter = wkbFlatten( p->mOgrGeometryTypeFilter );
+  mSpatialIndex = p->mSpatialIndex;
   QgsOgrConnPool::instance()->ref( mDataSource );
 }
 
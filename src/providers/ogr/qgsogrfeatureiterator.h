@@ -19,10 +19,13 @@
 #include "qgsogrconnpool.h"
 #include "qgsfield.h"
 
+#include <QSharedPointer>
+
 #include <ogr_api.h>
 
 class QgsOgrFeatureIterator;
 class QgsOgrProvider;
+class QgsOgrSpatialIndex;
 
 class QgsOgrFeatureSource : public QgsAbstractFeatureSource
 {
@@ -44,6 +47,7 @@ class QgsOgrFeatureSource : public QgsAbstractFeatureSource
     QgsFields mFieldsWithoutFid;
     OGRwkbGeometryType mOgrGeometryTypeFilter;
     QString mDriverName;
+    QSharedPointer<QgsOgrSpatialIndex> mSpatialIndex;
 
     friend class QgsOgrFeatureIterator;
     friend class QgsOgrExpressionCompiler;
@@ -84,6 +88,11 @@ class QgsOgrFeatureIterator : public QgsAbstractFeatureIteratorFromSource<QgsOgr
     //! Set to true, if geometry is in the requested columns
     bool mFetchGeometry;
 
+    //! Features of the filter rectangle found in the spatial index file, read by id instead of using the OGR spatial filter
+    bool mUseSpatialIndex;
+    QVector<QgsFeatureId> mIndexFids;
+    int mIndexFidPos;
+
   private:
     bool mExpressionCompiled;
 };
@@ -278,6 +278,7 @@ QgsOgrProvider::QgsOgrProvider( QString const & uri )
     , mLayerIndex( 0 )
     , mIsSubLayer( false )
     , mOgrGeometryTypeFilter( wkbUnknown )
+    , mSpatialIndexStale( false )
     , ogrDriver( nullptr )
     , mValid( false )
     , mOGRGeomType( wkbUnknown )
@@ -382,6 +383,10 @@ QgsOgrProvider::QgsOgrProvider( QString const & uri )
 
 QgsOgrProvider::~QgsOgrProvider()
 {
+  // keep the index file of the edited layer usable the next time it is opened
+  if ( mSpatialIndexStale )
+    createSpatialIndexFile();
+
   close();
   QgsOgrConnPool::instance()->unref( dataSourceUri() );
   // We must also make sure to flush unusef cached connections so that
@@ -391,6 +396,10 @@ QgsOgrProvider::~QgsOgrProvider()
 
 QgsAbstractFeatureSource* QgsOgrProvider::featureSource() const
 {
+  // the index is written once after a commit, not by each of the edit methods called by the commit
+  if ( mSpatialIndexStale )
+    const_cast< QgsOgrProvider* >( this )->createSpatialIndexFile();
+
   return new QgsOgrFeatureSource( this );
 }
 
@@ -1635,10 +1644,10 @@ bool QgsOgrProvider::changeGeometryValues( const QgsGeometryMap &geometry_map )
 
 bool QgsOgrProvider::createSpatialIndex()
 {
-  if ( !doInitialActionsForEdition() )
-    return false;
-
   if ( ogrDriverName != "ESRI Shapefile" )
+    return createSpatialIndexFile();
+
+  if ( !doInitialActionsForEdition() )
     return false;
 
   QByteArray layerName = OGR_FD_GetName( OGR_L_GetLayerDefn( ogrOrigLayer ) );
@@ -1656,6 +1665,95 @@ bool QgsOgrProvider::createSpatialIndex()
   return indexfile.exists();
 }
 
+QString QgsOgrProvider::spatialIndexPath() const
+{
+  if ( !ogrOrigLayer || ogrDriverName == "ESRI Shapefile" )
+    return QString();
+
+  // also excludes the /vsi paths and database connection strings
+  if ( !QFileInfo( mFilePath ).isFile() )
+    return QString();
+
+  // the index is used to fetch features by id, which OGR must do without reading the whole layer
+  if ( !OGR_L_TestCapability( ogrOrigLayer, "RandomRead" ) || OGR_L_TestCapability( ogrOrigLayer, "FastSpatialFilter" ) )
+    return QString();
+
+  return QgsOgrSpatialIndex::indexPath( mFilePath, mLayerName.isNull() ? QString::number( mLayerIndex ) : mLayerName );
+}
+
+bool QgsOgrProvider::createSpatialIndexFile()
+{
+  mSpatialIndexStale = false;
+  QString indexPath = spatialIndexPath();
+  if ( indexPath.isEmpty() )
+    return false;
+
+  QVector<QgsOgrSpatialIndex::Entry> entries;
+  qint64 featureCount = 0;
+
+  OGRGeometryH filter = OGR_L_GetSpatialFilter( ogrOrigLayer );
+  if ( filter )
+  {
+    filter = OGR_G_Clone( filter );
+    OGR_L_SetSpatialFilter( ogrOrigLayer, nullptr );
+  }
+
+  OGR_L_ResetReading( ogrOrigLayer );
+  setRelevantFields( ogrOrigLayer, true, QgsAttributeList() );
+  OGR_L_ResetReading( ogrOrigLayer );
+  OGRFeatureH fet;
+  while (( fet = OGR_L_GetNextFeature( ogrOrigLayer ) ) )
+  {
+    ++featureCount;
+    OGRGeometryH geom = OGR_F_GetGeometryRef( fet );
+    if ( geom && !OGR_G_IsEmpty( geom ) )
+    {
+      OGREnvelope env;
+      OGR_G_GetEnvelope( geom, &env );
+      QgsOgrSpatialIndex::Entry entry;
+      entry.fid = OGR_F_GetFID( fet );
+      entry.xMin = env.MinX;
+      entry.yMin = env.MinY;
+      entry.xMax = env.MaxX;
+      entry.yMax = env.MaxY;
+      entries << entry;
+    }
+    OGR_F_Destroy( fet );
+  }
+  OGR_L_ResetReading( ogrOrigLayer );
+
+  if ( filter )
+  {
+    OGR_L_SetSpatialFilter( ogrOrigLayer, filter );
+    OGR_G_DestroyGeometry( filter );
+  }
+
+  // the iterators keep the index they use, a new one is used by the next iterators
+  mSpatialIndex.clear();
+  if ( !QgsOgrSpatialIndex::write( indexPath, mFilePath, entries, featureCount ) )
+  {
+    pushError( tr( "Could not write spatial index %1" ).arg( indexPath ) );
+    return false;
+  }
+  loadSpatialIndex();
+  return true;
+}
+
+void QgsOgrProvider::loadSpatialIndex()
+{
+  QString indexPath = spatialIndexPath();
+  mSpatialIndex = QSharedPointer<QgsOgrSpatialIndex>( indexPath.isEmpty() ? nullptr : QgsOgrSpatialIndex::open( indexPath, mFilePath, fastFeatureCount() ) );
+}
+
+qint64 QgsOgrProvider::fastFeatureCount() const
+{
+  // the count is within the spatial filter of the layer
+  if ( !ogrOrigLayer || OGR_L_GetSpatialFilter( ogrOrigLayer ) )
+    return -1;
+
+  return OGR_L_GetFeatureCount( ogrOrigLayer, false );
+}
+
 bool QgsOgrProvider::createAttributeIndex( int field )
 {
   if ( !doInitialActionsForEdition() )
@@ -1850,6 +1948,11 @@ void QgsOgrProvider::computeCapabilities()
     ability |= SelectEncoding;
 #endif
 
+    if ( !spatialIndexPath().isEmpty() )
+    {
+      ability |= CreateSpatialIndex;
+    }
+
     // OGR doesn't handle shapefiles without attributes, ie. missing DBFs well, fixes #803
     if ( ogrDriverName == "ESRI Shapefile" )
     {
@@ -2969,6 +3072,14 @@ bool QgsOgrProvider::syncToDisc()
     return createSpatialIndex();
   }
 
+  // the edits made the spatial index file out of date, it is written again before the next query
+  QString indexPath = spatialIndexPath();
+  if ( !indexPath.isEmpty() && ( mSpatialIndex || QFile::exists( indexPath ) ) )
+  {
+    mSpatialIndex.clear();
+    mSpatialIndexStale = true;
+  }
+
   return true;
 }
 
@@ -3229,6 +3340,9 @@ void QgsOgrProvider::open( OpenMode mode )
     }
   }
 
+  if ( mValid )
+    loadSpatialIndex();
+
   // For debug/testing purposes
   if ( !mValid )
     setProperty( "_debug_open_mode", "invalid" );
@@ -3252,6 +3366,7 @@ void QgsOgrProvider::close()
   ogrDataSource = nullptr;
   ogrLayer = nullptr;
   ogrOrigLayer = nullptr;
+  mSpatialIndex.clear();
   mValid = false;
   setProperty( "_debug_open_mode", "invalid" );
 
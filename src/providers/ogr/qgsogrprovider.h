@@ -16,7 +16,9 @@ email                : sherman at mrcc.com
  ***************************************************************************/
 
 #include "QTextCodec"
+#include <QSharedPointer>
 
+#include "qgsogrspatialindex.h"
 #include "qgsrectangle.h"
 #include "qgsvectordataprovider.h"
 #include "qgsvectorfilewriter.h"
@@ -141,7 +143,9 @@ class QgsOgrProvider : public QgsVectorDataProvider
     /** Changes existing geometries*/
     virtual bool changeGeometryValues( const QgsGeometryMap &geometry_map ) override;
 
-    /** Tries to create a .qix index file for faster access if only a subset of the features is required
+    /** Tries to create a .qix index file for faster access if only a subset of the features is required.
+     * For the other drivers which cannot filter features by bounding box efficiently, a .qsi spatial index
+     * file is created next to the data source.
      @return true in case of success*/
     virtual bool createSpatialIndex() override;
 
@@ -290,6 +294,20 @@ class QgsOgrProvider : public QgsVectorDataProvider
 
   private:
     unsigned char *getGeometryPointer( OGRFeatureH fet );
+
+    /** Returns the path of the .qsi spatial index file of the layer, an empty string if the
+     * layer is not a file or if OGR can filter its features by bounding box efficiently */
+    QString spatialIndexPath() const;
+
+    //! Reads the bounding boxes of the features and writes the .qsi spatial index file
+    bool createSpatialIndexFile();
+
+    //! Opens the .qsi spatial index file of the layer, if it exists and is up to date
+    void loadSpatialIndex();
+
+    //! Returns the number of features of the layer if OGR can count them without reading them, -1 otherwise
+    qint64 fastFeatureCount() const;
+
     QString ogrWkbGeometryTypeName( OGRwkbGeometryType type ) const;
     OGRwkbGeometryType ogrWkbGeometryTypeFromName( const QString& typeName ) const;
     QgsFields mAttributeFields;
@@ -326,6 +344,12 @@ class QgsOgrProvider : public QgsVectorDataProvider
     //! String used to define a subset of the layer
     QString mSubsetString;
 
+    //! Spatial index of drivers without efficient spatial filter, shared with the feature sources
+    QSharedPointer<QgsOgrSpatialIndex> mSpatialIndex;
+
+    //! Set when edits made the spatial index file out of date, it is written again before the next query
+    bool mSpatialIndexStale;
+
     // OGR Driver that was actually used to open the layer
     OGRSFDriverH ogrDriver;
 
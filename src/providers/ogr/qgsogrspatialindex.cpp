@@ -0,0 +1,455 @@
+/***************************************************************************
+    qgsogrspatialindex.cpp
+    ---------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#include "qgsogrspatialindex.h"
+
+#include "qgslogger.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QUrl>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+#include <vector>
+
+const int QgsOgrSpatialIndex::NODE_SIZE;
+
+///@cond PRIVATE
+
+static const char INDEX_MAGIC[8] = { 'Q', 'G', 'S', 'H', 'R', 'T', '0', '2' };
+static const quint32 INDEX_BYTE_ORDER = 0x01020304;
+
+//! Header of an index file, followed by the level bounds, the boxes and the indices of the nodes
+struct QgsOgrSpatialIndexHeader
+{
+  char magic[8];
+  //! written in native byte order, the file is not used on a machine of another byte order
+  quint32 byteOrder;
+  quint32 nodeSize;
+  quint64 numItems;
+  quint64 numNodes;
+  qint64 sourceSize;
+  qint64 sourceModified;
+  quint32 numLevels;
+  quint32 reserved;
+  qint64 sourceFeatureCount;
+};
+
+//! Hilbert value of a position on a 2^16 x 2^16 grid
+static quint32 hilbertValue( quint32 x, quint32 y )
+{
+  quint32 a = x ^ y;
+  quint32 b = 0xFFFF ^ a;
+  quint32 c = 0xFFFF ^ ( x | y );
+  quint32 d = x & ( y ^ 0xFFFF );
+
+  quint32 A = a | ( b >> 1 );
+  quint32 B = ( a >> 1 ) ^ a;
+  quint32 C = (( c >> 1 ) ^ ( b & ( d >> 1 ) ) ) ^ c;
+  quint32 D = (( a & ( c >> 1 ) ) ^ ( d >> 1 ) ) ^ d;
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = (( a & ( a >> 2 ) ) ^ ( b & ( b >> 2 ) ) );
+  B = (( a & ( b >> 2 ) ) ^ ( b & (( a ^ b ) >> 2 ) ) );
+  C ^= (( a & ( c >> 2 ) ) ^ ( b & ( d >> 2 ) ) );
+  D ^= (( b & ( c >> 2 ) ) ^ (( a ^ b ) & ( d >> 2 ) ) );
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  A = (( a & ( a >> 4 ) ) ^ ( b & ( b >> 4 ) ) );
+  B = (( a & ( b >> 4 ) ) ^ ( b & (( a ^ b ) >> 4 ) ) );
+  C ^= (( a & ( c >> 4 ) ) ^ ( b & ( d >> 4 ) ) );
+  D ^= (( b & ( c >> 4 ) ) ^ (( a ^ b ) & ( d >> 4 ) ) );
+
+  a = A;
+  b = B;
+  c = C;
+  d = D;
+  C ^= (( a & ( c >> 8 ) ) ^ ( b & ( d >> 8 ) ) );
+  D ^= (( b & ( c >> 8 ) ) ^ (( a ^ b ) & ( d >> 8 ) ) );
+
+  a = C ^ ( C >> 1 );
+  b = D ^ ( D >> 1 );
+
+  quint32 i0 = x ^ y;
+  quint32 i1 = b | ( 0xFFFF ^ ( i0 | a ) );
+
+  i0 = ( i0 | ( i0 << 8 ) ) & 0x00FF00FF;
+  i0 = ( i0 | ( i0 << 4 ) ) & 0x0F0F0F0F;
+  i0 = ( i0 | ( i0 << 2 ) ) & 0x33333333;
+  i0 = ( i0 | ( i0 << 1 ) ) & 0x55555555;
+
+  i1 = ( i1 | ( i1 << 8 ) ) & 0x00FF00FF;
+  i1 = ( i1 | ( i1 << 4 ) ) & 0x0F0F0F0F;
+  i1 = ( i1 | ( i1 << 2 ) ) & 0x33333333;
+  i1 = ( i1 | ( i1 << 1 ) ) & 0x55555555;
+
+  return ( i1 << 1 ) | i0;
+}
+
+//! Entry with its Hilbert value, to sort the entries
+struct QgsOgrSpatialIndexItem
+{
+  quint32 hilbert;
+  QgsOgrSpatialIndex::Entry entry;
+
+  bool operator<( const QgsOgrSpatialIndexItem& other ) const { return hilbert < other.hilbert; }
+};
+
+static bool writeData( QFile& file, const void* data, qint64 size )
+{
+  return file.write( reinterpret_cast< const char* >( data ), size ) == size;
+}
+
+///@endcond
+
+
+QgsOgrSpatialIndex::QgsOgrSpatialIndex()
+    : mSourceSize( 0 )
+    , mSourceModified( 0 )
+    , mSourceFeatureCount( -1 )
+    , mData( nullptr )
+    , mNumItems( 0 )
+    , mNumNodes( 0 )
+    , mBoxes( nullptr )
+    , mIndices( nullptr )
+{
+}
+
+QgsOgrSpatialIndex::~QgsOgrSpatialIndex()
+{
+  if ( mData )
+  {
+    mFile.unmap( mData );
+  }
+}
+
+QString QgsOgrSpatialIndex::indexPath( const QString& sourcePath, const QString& layerKey )
+{
+  // layer names may contain characters which are not allowed in file names
+  return sourcePath + '.' + QString::fromLatin1( QUrl::toPercentEncoding( layerKey ) ) + ".qsi";
+}
+
+bool QgsOgrSpatialIndex::write( const QString& indexPath, const QString& sourcePath, QVector<Entry>& entries, qint64 featureCount )
+{
+  QFileInfo sourceInfo( sourcePath );
+  if ( !sourceInfo.isFile() )
+  {
+    return false;
+  }
+
+  const quint64 numItems = entries.size();
+  if ( numItems == 0 )
+  {
+    // an empty index is not useful, remove an older one
+    QFile::remove( indexPath );
+    return true;
+  }
+
+  // sort the entries by the Hilbert value of their centers in the extent of the layer
+  double xMin = std::numeric_limits<double>::max();
+  double yMin = std::numeric_limits<double>::max();
+  double xMax = -std::numeric_limits<double>::max();
+  double yMax = -std::numeric_limits<double>::max();
+  Q_FOREACH ( const Entry& entry, entries )
+  {
+    xMin = qMin( xMin, entry.xMin );
+    yMin = qMin( yMin, entry.yMin );
+    xMax = qMax( xMax, entry.xMax );
+    yMax = qMax( yMax, entry.yMax );
+  }
+  const double width = xMax > xMin ? xMax - xMin : 1.0;
+  const double height = yMax > yMin ? yMax - yMin : 1.0;
+
+  QVector<QgsOgrSpatialIndexItem> items( entries.size() );
+  for ( int i = 0; i < entries.size(); ++i )
+  {
+    const Entry& entry = entries.at( i );
+    quint32 x = static_cast< quint32 >( 0xFFFF * (( entry.xMin + entry.xMax ) / 2.0 - xMin ) / width );
+    quint32 y = static_cast< quint32 >( 0xFFFF * (( entry.yMin + entry.yMax ) / 2.0 - yMin ) / height );
+    items[i].hilbert = hilbertValue( x, y );
+    items[i].entry = entry;
+  }
+  std::sort( items.begin(), items.end() );
+  for ( int i = 0; i < items.size(); ++i )
+  {
+    entries[i] = items.at( i ).entry;
+  }
+  items.clear();
+
+  // the leaves, then the levels of nodes up to a single root
+  QVector<quint64> levelBounds;
+  quint64 numNodes = numItems;
+  quint64 levelSize = numItems;
+  levelBounds << numNodes;
+  while ( levelSize > 1 )
+  {
+    levelSize = ( levelSize + NODE_SIZE - 1 ) / NODE_SIZE;
+    numNodes += levelSize;
+    levelBounds << numNodes;
+  }
+
+  // the number of nodes and values may not fit in an int for large layers
+  std::vector<double> boxes( numNodes * 4 );
+  std::vector<qint64> indices( numNodes );
+  for ( quint64 i = 0; i < numItems; ++i )
+  {
+    const Entry& entry = entries.at( static_cast< int >( i ) );
+    boxes[4 * i] = entry.xMin;
+    boxes[4 * i + 1] = entry.yMin;
+    boxes[4 * i + 2] = entry.xMax;
+    boxes[4 * i + 3] = entry.yMax;
+    indices[i] = entry.fid;
+  }
+
+  quint64 pos = 0;
+  quint64 node = numItems;
+  for ( int level = 0; level < levelBounds.size() - 1; ++level )
+  {
+    const quint64 levelEnd = levelBounds.at( level );
+    while ( pos < levelEnd )
+    {
+      double nodeXMin = std::numeric_limits<double>::max();
+      double nodeYMin = std::numeric_limits<double>::max();
+      double nodeXMax = -std::numeric_limits<double>::max();
+      double nodeYMax = -std::numeric_limits<double>::max();
+      indices[node] = static_cast< qint64 >( pos );
+      for ( int i = 0; i < NODE_SIZE && pos < levelEnd; ++i, ++pos )
+      {
+        nodeXMin = qMin( nodeXMin, boxes[4 * pos] );
+        nodeYMin = qMin( nodeYMin, boxes[4 * pos + 1] );
+        nodeXMax = qMax( nodeXMax, boxes[4 * pos + 2] );
+        nodeYMax = qMax( nodeYMax, boxes[4 * pos + 3] );
+      }
+      boxes[4 * node] = nodeXMin;
+      boxes[4 * node + 1] = nodeYMin;
+      boxes[4 * node + 2] = nodeXMax;
+      boxes[4 * node + 3] = nodeYMax;
+      ++node;
+    }
+  }
+
+  QgsOgrSpatialIndexHeader header;
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, INDEX_MAGIC, sizeof( header.magic ) );
+  header.byteOrder = INDEX_BYTE_ORDER;
+  header.nodeSize = NODE_SIZE;
+  header.numItems = numItems;
+  header.numNodes = numNodes;
+  header.sourceSize = sourceInfo.size();
+  header.sourceModified = sourceInfo.lastModified().toMSecsSinceEpoch();
+  header.numLevels = levelBounds.size();
+  header.sourceFeatureCount = featureCount;
+
+  // write a temporary file, so that an index being written is never opened
+  QString tmpPath = indexPath + ".tmp";
+  QFile file( tmpPath );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+  {
+    QgsDebugMsg( QString( "Could not open %1 for writing" ).arg( tmpPath ) );
+    return false;
+  }
+
+  bool ok = writeData( file, &header, sizeof( header ) )
+            && writeData( file, levelBounds.constData(), static_cast< qint64 >( levelBounds.size() * sizeof( quint64 ) ) )
+            && writeData( file, &boxes[0], static_cast< qint64 >( boxes.size() * sizeof( double ) ) )
+            && writeData( file, &indices[0], static_cast< qint64 >( indices.size() * sizeof( qint64 ) ) );
+  file.close();
+
+  if ( !ok || ( QFile::exists( indexPath ) && !QFile::remove( indexPath ) ) || !QFile::rename( tmpPath, indexPath ) )
+  {
+    QgsDebugMsg( QString( "Could not write %1" ).arg( indexPath ) );
+    QFile::remove( tmpPath );
+    return false;
+  }
+  return true;
+}
+
+QgsOgrSpatialIndex* QgsOgrSpatialIndex::open( const QString& indexPath, const QString& sourcePath, qint64 featureCount )
+{
+  QFileInfo sourceInfo( sourcePath );
+  if ( !sourceInfo.isFile() || !QFile::exists( indexPath ) )
+  {
+    return nullptr;
+  }
+
+  QgsOgrSpatialIndex* index = new QgsOgrSpatialIndex();
+  index->mFile.setFileName( indexPath );
+  if ( !index->mFile.open( QIODevice::ReadOnly ) || index->mFile.size() < static_cast< qint64 >( sizeof( QgsOgrSpatialIndexHeader ) ) )
+  {
+    delete index;
+    return nullptr;
+  }
+
+  const qint64 fileSize = index->mFile.size();
+  index->mData = index->mFile.map( 0, fileSize );
+  if ( !index->mData )
+  {
+    delete index;
+    return nullptr;
+  }
+
+  QgsOgrSpatialIndexHeader header;
+  memcpy( &header, index->mData, sizeof( header ) );
+  // the counts are checked against the file size before computing the expected size, which could overflow
+  const quint64 nodeBytes = 4 * sizeof( double ) + sizeof( qint64 );
+  const quint64 dataSize = static_cast< quint64 >( fileSize ) - sizeof( header );
+  if ( memcmp( header.magic, INDEX_MAGIC, sizeof( header.magic ) ) != 0
+       || header.byteOrder != INDEX_BYTE_ORDER
+       || header.nodeSize != static_cast< quint32 >( NODE_SIZE )
+       || header.numItems == 0
+       || header.numLevels == 0
+       || header.numLevels > 64
+       || header.numNodes > dataSize / nodeBytes
+       || header.numItems > header.numNodes
+       || dataSize != header.numLevels * sizeof( quint64 ) + header.numNodes * nodeBytes )
+  {
+    QgsDebugMsg( QString( "Invalid spatial index %1" ).arg( indexPath ) );
+    delete index;
+    return nullptr;
+  }
+
+  index->mSourcePath = sourcePath;
+  index->mSourceSize = header.sourceSize;
+  index->mSourceModified = header.sourceModified;
+  index->mSourceFeatureCount = header.sourceFeatureCount;
+  if ( !index->isUpToDate( featureCount ) )
+  {
+    QgsDebugMsg( QString( "Spatial index %1 is out of date" ).arg( indexPath ) );
+    delete index;
+    return nullptr;
+  }
+
+  index->mNumItems = header.numItems;
+  index->mNumNodes = header.numNodes;
+  const quint64* levelBounds = reinterpret_cast< const quint64* >( index->mData + sizeof( header ) );
+  for ( quint32 i = 0; i < header.numLevels; ++i )
+  {
+    index->mLevelBounds << levelBounds[i];
+  }
+  index->mBoxes = reinterpret_cast< const double* >( levelBounds + header.numLevels );
+  index->mIndices = reinterpret_cast< const qint64* >( index->mBoxes + 4 * header.numNodes );
+
+  if ( !index->isValidTree() )
+  {
+    QgsDebugMsg( QString( "Invalid spatial index %1" ).arg( indexPath ) );
+    delete index;
+    return nullptr;
+  }
+  return index;
+}
+
+bool QgsOgrSpatialIndex::isUpToDate( qint64 featureCount ) const
+{
+  // the data source was modified after the index was written
+  QFileInfo sourceInfo( mSourcePath );
+  if ( !sourceInfo.isFile() || sourceInfo.size() != mSourceSize || sourceInfo.lastModified().toMSecsSinceEpoch() != mSourceModified )
+  {
+    return false;
+  }
+
+  // catches the changes which keep the size and modification time of the file
+  return featureCount < 0 || featureCount == mSourceFeatureCount;
+}
+
+bool QgsOgrSpatialIndex::isValidTree() const
+{
+  // the leaves come first, each level ends after the previous one and the root level ends with the nodes
+  if ( mLevelBounds.first() != mNumItems || mLevelBounds.last() != mNumNodes )
+  {
+    return false;
+  }
+  for ( int level = 1; level < mLevelBounds.size(); ++level )
+  {
+    if ( mLevelBounds.at( level ) <= mLevelBounds.at( level - 1 ) )
+    {
+      return false;
+    }
+  }
+
+  // the first child of each node must be a node of the level below
+  for ( int level = 1; level < mLevelBounds.size(); ++level )
+  {
+    const quint64 childBegin = level > 1 ? mLevelBounds.at( level - 2 ) : 0;
+    const quint64 childEnd = mLevelBounds.at( level - 1 );
+    for ( quint64 node = mLevelBounds.at( level - 1 ); node < mLevelBounds.at( level ); ++node )
+    {
+      const qint64 child = mIndices[node];
+      if ( child < 0 || static_cast< quint64 >( child ) < childBegin || static_cast< quint64 >( child ) >= childEnd )
+      {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+QVector<QgsFeatureId> QgsOgrSpatialIndex::intersects( const QgsRectangle& rect ) const
+{
+  QVector<QgsFeatureId> ids;
+  if ( mNumNodes == 0 )
+  {
+    return ids;
+  }
+
+  const double xMin = rect.xMinimum();
+  const double yMin = rect.yMinimum();
+  const double xMax = rect.xMaximum();
+  const double yMax = rect.yMaximum();
+
+  // nodes to visit, as pairs of position of the first entry and level
+  QVector<quint64> stack;
+  quint64 node = mNumNodes - 1;
+  int level = mLevelBounds.size() - 1;
+  while ( true )
+  {
+    const quint64 end = qMin( node + NODE_SIZE, mLevelBounds.at( level ) );
+    for ( quint64 pos = node; pos < end; ++pos )
+    {
+      const double* box = mBoxes + 4 * pos;
+      if ( box[2] < xMin || box[3] < yMin || box[0] > xMax || box[1] > yMax )
+      {
+        continue;
+      }
+
+      if ( level == 0 )
+      {
+        ids << mIndices[pos];
+      }
+      else
+      {
+        stack << static_cast< quint64 >( mIndices[pos] ) << static_cast< quint64 >( level - 1 );
+      }
+    }
+
+    if ( stack.isEmpty() )
+    {
+      break;
+    }
+    level = static_cast< int >( stack.last() );
+    stack.pop_back();
+    node = stack.last();
+    stack.pop_back();
+  }
+
+  // reading the features in the order of the data source is faster for most drivers
+  std::sort( ids.begin(), ids.end() );
+  return ids;
+}
@@ -0,0 +1,116 @@
+/***************************************************************************
+    qgsogrspatialindex.h
+    ---------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+#ifndef QGSOGRSPATIALINDEX_H
+#define QGSOGRSPATIALINDEX_H
+
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+#include "qgsfeature.h"
+#include "qgsrectangle.h"
+
+/**
+ * Spatial index of an OGR layer stored in a file next to its data source, for the drivers
+ * which cannot filter features by bounding box without reading the whole layer.
+ *
+ * The index is a packed R-tree: the bounding boxes of the features are sorted by the Hilbert
+ * value of their centers and grouped in nodes of NODE_SIZE entries, level by level up to the
+ * root. The file is memory mapped, so opening an index does not read it and a query only reads
+ * the nodes it visits. It is immutable: the size, modification time and number of features of
+ * the data source are stored in the file and an index which does not match its data source is
+ * not used, it is built again after the layer is edited.
+ */
+class QgsOgrSpatialIndex
+{
+  public:
+
+    //! Bounding box of a feature
+    struct Entry
+    {
+      QgsFeatureId fid;
+      double xMin;
+      double yMin;
+      double xMax;
+      double yMax;
+    };
+
+    //! Number of entries of a node
+    static const int NODE_SIZE = 16;
+
+    ~QgsOgrSpatialIndex();
+
+    /** Returns the path of the index file of a layer
+     * @param sourcePath path of the data source file
+     * @param layerKey name or index of the layer in the data source
+     */
+    static QString indexPath( const QString& sourcePath, const QString& layerKey );
+
+    /** Builds an index and writes it
+     * @param indexPath path of the index file, replaced if it exists
+     * @param sourcePath path of the data source file, whose size and modification time are stored
+     * @param entries bounding boxes of the features, reordered by the method
+     * @param featureCount number of features of the layer, including the ones without geometry
+     * @returns true in case of success
+     */
+    static bool write( const QString& indexPath, const QString& sourcePath, QVector<Entry>& entries, qint64 featureCount );
+
+    /** Opens an index
+     * @param indexPath path of the index file
+     * @param sourcePath path of the data source file
+     * @param featureCount number of features of the layer, -1 if it is not known
+     * @returns the index, nullptr if the file does not exist, is not valid or does not match the data source
+     */
+    static QgsOgrSpatialIndex* open( const QString& indexPath, const QString& sourcePath, qint64 featureCount );
+
+    /** Returns true if the data source has not been modified since the index was written. The size and
+     * modification time of the file are read again, which is cheap enough to be done before each query.
+     * @param featureCount number of features of the layer, -1 if it is not known
+     */
+    bool isUpToDate( qint64 featureCount ) const;
+
+    //! Returns the number of features in the index
+    int featureCount() const { return static_cast< int >( mNumItems ); }
+
+    //! Returns the sorted ids of the features whose bounding box intersects a rectangle
+    QVector<QgsFeatureId> intersects( const QgsRectangle& rect ) const;
+
+  private:
+
+    QgsOgrSpatialIndex();
+
+    /** Checks that the levels of the tree are ordered and that the children of its nodes are
+     * in the level below, so that a corrupted file cannot make a query read outside of the file */
+    bool isValidTree() const;
+
+    QFile mFile;
+    QString mSourcePath;
+    qint64 mSourceSize;
+    qint64 mSourceModified;
+    qint64 mSourceFeatureCount;
+    uchar* mData;
+    quint64 mNumItems;
+    quint64 mNumNodes;
+
+    //! End of the nodes of each level in the boxes, starting with the leaves
+    QVector<quint64> mLevelBounds;
+
+    //! Bounding boxes of the nodes, four values per node
+    const double* mBoxes;
+
+    //! Feature id of the leaves, position of the first child of the other nodes
+    const qint64* mIndices;
+};
+
+#endif // QGSOGRSPATIALINDEX_H
@@ -28,10 +28,12 @@
 #include "qgswkbtypes.h"
 
 #include <QApplication>
+#include <QDateTime>
 #include <QSettings>
 #include <QThread>
 
 #include <climits>
+#include <limits>
 
 // for htonl
 #ifdef Q_OS_WIN
@@ -200,6 +202,7 @@ QgsPostgresConn::QgsPostgresConn( const QString& conninfo, bool readOnly, bool s
     , mUseWkbHex( false )
     , mReadOnly( readOnly )
     , mSwapEndian( false )
+    , mIntegerDatetimes( false )
     , mNextCursorId( 0 )
     , mShared( shared )
     , mTransaction( transaction )
@@ -289,6 +292,9 @@ QgsPostgresConn::QgsPostgresConn( const QString& conninfo, bool readOnly, bool s
 
   deduceEndian();
 
+  // float timestamps were a compile time option of the server until PostgreSQL 10
+  mIntegerDatetimes = qstrcmp( ::PQparameterStatus( mConn, "integer_datetimes" ), "on" ) == 0;
+
   /* Check to see if we have working PostGIS support */
   if ( !postgisVersion().isNull() )
   {
@@ -1277,6 +1283,146 @@ qint64 QgsPostgresConn::getBinaryInt( QgsPostgresResult &queryResult, int row, i
   return oid;
 }
 
+double QgsPostgresConn::getBinaryDouble( QgsPostgresResult &queryResult, int row, int col )
+{
+  const char *p = ::PQgetvalue( queryResult.result(), row, col );
+
+  if ( ::PQgetlength( queryResult.result(), row, col ) == 4 )
+  {
+    quint32 bits;
+    memcpy( &bits, p, sizeof( bits ) );
+    if ( mSwapEndian )
+      bits = ntohl( bits );
+
+    float value;
+    memcpy( &value, &bits, sizeof( value ) );
+    if ( qIsNaN( value ) || qIsInf( value ) )
+      return value;
+
+    // go through the shortest representation which gives the float back, like the text form
+    // of float4: 1.1 and not the widened 1.10000002384186, but all the digits of 123456.7
+    for ( int precision = 6; precision < 9; ++precision )
+    {
+      QString text = QString::number( value, 'g', precision );
+      if ( text.toFloat() == value )
+        return text.toDouble();
+    }
+    return QString::number( value, 'g', 9 ).toDouble();
+  }
+
+  quint32 high, low;
+  memcpy( &high, p, sizeof( high ) );
+  memcpy( &low, p + sizeof( high ), sizeof( low ) );
+  if ( mSwapEndian )
+  {
+    high = ntohl( high );
+    low = ntohl( low );
+  }
+
+  quint64 bits = ( quint64( high ) << 32 ) | low;
+  double value;
+  memcpy( &value, &bits, sizeof( value ) );
+  return value;
+}
+
+QgsPostgresValueFormat QgsPostgresConn::binaryValueFormat( const QgsField &fld ) const
+{
+  const QString &type = fld.typeName();
+  if ( type == "int2" || type == "int4" || type == "int8" )
+  {
+    return pvfInt;
+  }
+  else if ( type == "float4" || type == "float8" )
+  {
+    return pvfFloat;
+  }
+  else if ( type == "bool" )
+  {
+    return pvfBool;
+  }
+  else if ( type == "text" || type == "varchar" )
+  {
+    return pvfString;
+  }
+  else if ( type == "date" )
+  {
+    return pvfDate;
+  }
+  else if ( type == "time" && mIntegerDatetimes )
+  {
+    return pvfTime;
+  }
+  else if ( type == "timestamp" && mIntegerDatetimes )
+  {
+    return pvfTimestamp;
+  }
+
+  return pvfText;
+}
+
+QVariant QgsPostgresConn::getBinaryValue( QgsPostgresResult &queryResult, int row, int col, QgsPostgresValueFormat format, QVariant::Type type )
+{
+  if ( queryResult.PQgetisnull( row, col ) )
+    return QVariant( type );
+
+  const qint64 usecsPerDay = Q_INT64_C( 86400000000 );
+
+  switch ( format )
+  {
+    case pvfInt:
+      if ( type == QVariant::LongLong )
+        return QVariant( getBinaryInt( queryResult, row, col ) );
+      return QVariant( static_cast< int >( getBinaryInt( queryResult, row, col ) ) );
+
+    case pvfFloat:
+      return QVariant( getBinaryDouble( queryResult, row, col ) );
+
+    case pvfBool:
+      return QVariant( QString( *::PQgetvalue( queryResult.result(), row, col ) ? "t" : "f" ) );
+
+    case pvfString:
+      return QVariant( QString::fromUtf8( ::PQgetvalue( queryResult.result(), row, col ),
+                                          ::PQgetlength( queryResult.result(), row, col ) ) );
+
+    case pvfDate:
+    {
+      qint64 days = getBinaryInt( queryResult, row, col );
+      // infinity and -infinity, which have no QDate
+      if ( days == INT_MAX || days == INT_MIN )
+        return QVariant( type );
+
+      return QVariant( QDate( 2000, 1, 1 ).addDays( days ) );
+    }
+
+    case pvfTime:
+      return QVariant( QTime( 0, 0 ).addMSecs( static_cast< int >( getBinaryInt( queryResult, row, col ) / 1000 ) ) );
+
+    case pvfTimestamp:
+    {
+      qint64 usecs = getBinaryInt( queryResult, row, col );
+      if ( usecs == std::numeric_limits<qint64>::max() || usecs == std::numeric_limits<qint64>::min() )
+        return QVariant( type );
+
+      // split in date and time of day, like the text form which has no time zone
+      qint64 days = usecs / usecsPerDay;
+      qint64 usecsOfDay = usecs % usecsPerDay;
+      if ( usecsOfDay < 0 )
+      {
+        usecsOfDay += usecsPerDay;
+        --days;
+      }
+
+      return QVariant( QDateTime( QDate( 2000, 1, 1 ).addDays( days ),
+                                  QTime( 0, 0 ).addMSecs( static_cast< int >( usecsOfDay / 1000 ) ) ) );
+    }
+
+    case pvfText:
+      break;
+  }
+
+  return QgsVectorDataProvider::convertValue( type, queryResult.PQgetvalue( row, col ) );
+}
+
 QString QgsPostgresConn::fieldExpression( const QgsField &fld, QString expr )
 {
   const QString &type = fld.typeName();
@@ -55,6 +55,19 @@ enum QgsPostgresPrimaryKeyType
   pktFidMap
 };
 
+/** Formats in which field values are read from binary cursors */
+enum QgsPostgresValueFormat
+{
+  pvfText,      //!< converted to text by the server
+  pvfInt,       //!< int2, int4 or int8
+  pvfFloat,     //!< float4 or float8
+  pvfBool,      //!< bool, read as "t" or "f" like its text form
+  pvfString,    //!< text or varchar, read as UTF-8 bytes
+  pvfDate,      //!< days since 2000-01-01
+  pvfTime,      //!< microseconds since midnight
+  pvfTimestamp  //!< microseconds since 2000-01-01 00:00:00
+};
+
 /** Schema properties structure */
 struct QgsPostgresSchemaProperty
 {
@@ -306,6 +319,17 @@ class QgsPostgresConn : public QObject
 
     qint64 getBinaryInt( QgsPostgresResult &queryResult, int row, int col );
 
+    double getBinaryDouble( QgsPostgresResult &queryResult, int row, int col );
+
+    /**
+     * Returns the format of the values of a field selected without conversion in a binary cursor,
+     * or pvfText if the field has to be selected with fieldExpression()
+     */
+    QgsPostgresValueFormat binaryValueFormat( const QgsField &fld ) const;
+
+    //! Converts a value selected in a binary cursor to a variant of the given type
+    QVariant getBinaryValue( QgsPostgresResult &queryResult, int row, int col, QgsPostgresValueFormat format, QVariant::Type type );
+
     QString fieldExpression( const QgsField &fld, QString expr = "%1" );
 
     QString connInfo() const { return mConnInfo; }
@@ -405,6 +429,9 @@ class QgsPostgresConn : public QObject
     bool mSwapEndian;
     void deduceEndian();
 
+    //! Are time and timestamp values sent as 64 bit integers in binary cursors
+    bool mIntegerDatetimes;
+
     int mNextCursorId;
 
     bool mShared; //! < whether the connection is shared by more providers (must not be if going to be used in worker threads)
@@ -22,11 +22,59 @@
 #include "qgslogger.h"
 #include "qgsmessagelog.h"
 
+#include <QElapsedTimer>
+#include <QFutureInterface>
 #include <QObject>
+#include <QRunnable>
 #include <QSettings>
+#include <QThreadPool>
 
 
 const int QgsPostgresFeatureIterator::sFeatureQueueSize = 2000;
+const int QgsPostgresFeatureIterator::sMinFeatureQueueSize = 100;
+const int QgsPostgresFeatureIterator::sMaxFeatureQueueSize = 50000;
+const int QgsPostgresFeatureIterator::sMaxFeatureQueueBytes = 8 * 1024 * 1024;
+
+///@cond PRIVATE
+
+/**
+ * Threads of the fetch tasks. The global thread pool is not used as the map renderer
+ * jobs running there wait for the fetch tasks, which could then never start.
+ */
+static QThreadPool* fetchThreadPool()
+{
+  static QThreadPool sPool;
+  return &sPool;
+}
+
+//! Fetches and decodes the next batch of an iterator in a helper thread
+class QgsPostgresFetchTask : public QFutureInterface<void>, public QRunnable
+{
+  public:
+    explicit QgsPostgresFetchTask( QgsPostgresFeatureIterator* iterator )
+        : mIterator( iterator )
+    {}
+
+    //! Queues the task, which is deleted once finished
+    QFuture<void> start()
+    {
+      reportStarted();
+      QFuture<void> result = future();
+      fetchThreadPool()->start( this );
+      return result;
+    }
+
+    virtual void run() override
+    {
+      mIterator->fetchBatch( mIterator->mPrefetchQueue );
+      reportFinished();
+    }
+
+  private:
+    QgsPostgresFeatureIterator* mIterator;
+};
+
+///@endcond
 
 
 QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource* source, bool ownSource, const QgsFeatureRequest& request )
@@ -38,6 +86,9 @@ QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource
     , mOrderByCompiled( false )
     , mLastFetch( false )
     , mFilterRequiresGeometry( false )
+    , mPrefetch( false )
+    , mFetchInFlight( 0 )
+    , mPrefetching( false )
 {
   if ( !source->mTransactionConnection )
   {
@@ -50,6 +101,10 @@ QgsPostgresFeatureIterator::QgsPostgresFeatureIterator( QgsPostgresFeatureSource
     mIsTransactionConnection = true;
   }
 
+  // a transaction connection is shared with the provider and other iterators,
+  // it cannot have a FETCH in flight between two batches
+  mPrefetch = !mIsTransactionConnection;
+
   if ( !mConn )
   {
     mClosed = true;
@@ -225,43 +280,26 @@ bool QgsPostgresFeatureIterator::fetchFeature( QgsFeature& feature )
   if ( mClosed )
     return false;
 
-  if ( mFeatureQueue.empty() && !mLastFetch )
+  if ( mFeatureQueue.empty() )
   {
-    QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
-    QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
-
-    lock();
-    if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+    if ( mPrefetching )
     {
-      QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+      // batch fetched while the previous one was consumed
+      mPrefetchFuture.waitForFinished();
+      mPrefetching = false;
+      mFeatureQueue.swap( mPrefetchQueue );
     }
-
-    QgsPostgresResult queryResult;
-    for ( ;; )
+    else if ( !mLastFetch )
     {
-      queryResult = mConn->PQgetResult();
-      if ( !queryResult.result() )
-        break;
-
-      if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
-      {
-        QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
-        break;
-      }
-
-      int rows = queryResult.PQntuples();
-      if ( rows == 0 )
-        continue;
-
-      mLastFetch = rows < mFeatureQueueSize;
+      fetchBatch( mFeatureQueue );
+    }
 
-      for ( int row = 0; row < rows; row++ )
-      {
-        mFeatureQueue.enqueue( QgsFeature() );
-        getFeature( queryResult, row, mFeatureQueue.back() );
-      } // for each row in queue
+    // fetch the following batch in the background while this one is consumed
+    if ( mPrefetch && !mLastFetch && !mFeatureQueue.empty() )
+    {
+      mPrefetchFuture = ( new QgsPostgresFetchTask( this ) )->start();
+      mPrefetching = true;
     }
-    unlock();
   }
 
   if ( mFeatureQueue.empty() )
@@ -336,11 +374,138 @@ void QgsPostgresFeatureIterator::unlock()
     mConn->unlock();
 }
 
+bool QgsPostgresFeatureIterator::sendFetch()
+{
+  QString fetch = QString( "FETCH FORWARD %1 FROM %2" ).arg( mFeatureQueueSize ).arg( mCursorName );
+  QgsDebugMsgLevel( QString( "fetching %1 features." ).arg( mFeatureQueueSize ), 4 );
+
+  if ( mConn->PQsendQuery( fetch ) == 0 ) // fetch features asynchronously
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+    return false;
+  }
+
+  mFetchInFlight = mFeatureQueueSize;
+  return true;
+}
+
+void QgsPostgresFeatureIterator::fetchBatch( QQueue<QgsFeature>& queue )
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  lock();
+  if ( mFetchInFlight == 0 && !sendFetch() )
+  {
+    unlock();
+    mLastFetch = true;
+    return;
+  }
+
+  int requested = mFetchInFlight;
+  mFetchInFlight = 0;
+
+  // a FETCH returns a single result, but the connection only accepts
+  // another query once all of them have been read
+  QgsPostgresResult queryResult( mConn->PQgetResult() );
+  for ( ;; )
+  {
+    PGresult *result = mConn->PQgetResult();
+    if ( !result )
+      break;
+    ::PQclear( result );
+  }
+
+  qint64 waitTime = timer.nsecsElapsed();
+
+  int rows = 0;
+  if ( !queryResult.result() )
+  {
+    mLastFetch = true;
+  }
+  else if ( queryResult.PQresultStatus() != PGRES_TUPLES_OK )
+  {
+    QgsMessageLog::logMessage( QObject::tr( "Fetching from cursor %1 failed\nDatabase error: %2" ).arg( mCursorName, mConn->PQerrorMessage() ), QObject::tr( "PostGIS" ) );
+    mLastFetch = true;
+  }
+  else
+  {
+    rows = queryResult.PQntuples();
+    mLastFetch = rows < requested;
+  }
+
+  if ( mPrefetch && !mLastFetch )
+  {
+    sendFetch();
+  }
+  unlock();
+
+  timer.restart();
+
+  qint64 bytes = 0;
+  int fields = rows > 0 ? queryResult.PQnfields() : 0;
+  for ( int row = 0; row < rows; row++ )
+  {
+    for ( int col = 0; col < fields; col++ )
+      bytes += ::PQgetlength( queryResult.result(), row, col );
+
+    queue.enqueue( QgsFeature() );
+    getFeature( queryResult, row, queue.back() );
+  } // for each row in queue
+
+  if ( rows == requested )
+  {
+    adaptFeatureQueueSize( rows, bytes, waitTime, timer.nsecsElapsed() );
+  }
+}
+
+void QgsPostgresFeatureIterator::adaptFeatureQueueSize( int rows, qint64 bytes, qint64 waitTime, qint64 decodeTime )
+{
+  int size = mFeatureQueueSize;
+
+  // waiting for the server longer than decoding: less round trips with larger batches
+  if ( waitTime > decodeTime )
+    size *= 2;
+
+  // bound the memory used by the queues for large rows
+  qint64 rowBytes = qMax( bytes / rows, qint64( 1 ) );
+  size = static_cast< int >( qMin( qint64( size ), sMaxFeatureQueueBytes / rowBytes ) );
+
+  mFeatureQueueSize = qBound( sMinFeatureQueueSize, size, sMaxFeatureQueueSize );
+}
+
+void QgsPostgresFeatureIterator::finishPrefetch()
+{
+  if ( mPrefetching )
+  {
+    mPrefetchFuture.waitForFinished();
+    mPrefetching = false;
+    mPrefetchQueue.clear();
+  }
+
+  // the connection does not accept another query before the batch in flight is read
+  if ( mFetchInFlight > 0 )
+  {
+    lock();
+    for ( ;; )
+    {
+      PGresult *result = mConn->PQgetResult();
+      if ( !result )
+        break;
+      ::PQclear( result );
+    }
+    unlock();
+    mFetchInFlight = 0;
+  }
+}
+
 bool QgsPostgresFeatureIterator::rewind()
 {
   if ( mClosed )
     return false;
 
+  finishPrefetch();
+
   // move cursor to first record
 
   lock();
@@ -358,6 +523,8 @@ bool QgsPostgresFeatureIterator::close()
   if ( !mConn )
     return false;
 
+  finishPrefetch();
+
   lock();
   mConn->closeCursor( mCursorName );
   unlock();
@@ -599,13 +766,21 @@ bool QgsPostgresFeatureIterator::declareCursor( const QString& whereClause, long
       return false;
   }
 
+  // values of common types are decoded from the binary cursor format, the others are converted to text
+  mAttributeFormats.fill( pvfText, mSource->mFields.count() );
+
   bool subsetOfAttributes = mRequest.flags() & QgsFeatureRequest::SubsetOfAttributes;
   Q_FOREACH ( int idx, subsetOfAttributes ? mRequest.subsetOfAttributes() : mSource->mFields.allAttributesList() )
   {
     if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
       continue;
 
-    query += delim + mConn->fieldExpression( mSource->mFields.at( idx ) );
+    const QgsField &fld = mSource->mFields.at( idx );
+    mAttributeFormats[ idx ] = mConn->binaryValueFormat( fld );
+    if ( mAttributeFormats.at( idx ) == pvfText )
+      query += delim + mConn->fieldExpression( fld );
+    else
+      query += delim + QgsPostgresConn::quotedIdentifier( fld.name() );
   }
 
   query += " FROM " + mSource->mQuery;
@@ -781,7 +956,7 @@ void QgsPostgresFeatureIterator::getFeatureAttribute( int idx, QgsPostgresResult
   if ( mSource->mPrimaryKeyAttrs.contains( idx ) )
     return;
 
-  QVariant v = QgsPostgresProvider::convertValue( mSource->mFields.at( idx ).type(), queryResult.PQgetvalue( row, col ) );
+  QVariant v = mConn->getBinaryValue( queryResult, row, col, mAttributeFormats.at( idx ), mSource->mFields.at( idx ).type() );
   feature.setAttribute( idx, v );
 
   col++;
@@ -17,6 +17,7 @@
 
 #include "qgsfeatureiterator.h"
 
+#include <QFuture>
 #include <QQueue>
 #include <QSharedPointer>
 
@@ -25,6 +26,7 @@
 class QgsPostgresProvider;
 class QgsPostgresResult;
 class QgsPostgresTransaction;
+class QgsPostgresFetchTask;
 
 
 class QgsPostgresFeatureSource : public QgsAbstractFeatureSource
@@ -108,7 +110,7 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
      */
     QQueue<QgsFeature> mFeatureQueue;
 
-    //! Maximal size of the feature queue
+    //! Maximal size of the feature queue, adapted to the row size and the fetch latency
     int mFeatureQueueSize;
 
     //! Number of retrieved features
@@ -117,6 +119,9 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
     //! Set to true, if geometry is in the requested columns
     bool mFetchGeometry;
 
+    //! Format in which each attribute is selected, by field index
+    QVector<QgsPostgresValueFormat> mAttributeFormats;
+
     bool mIsTransactionConnection;
 
     static const int sFeatureQueueSize;
@@ -130,10 +135,43 @@ class QgsPostgresFeatureIterator : public QgsAbstractFeatureIteratorFromSource<Q
     inline void lock();
     inline void unlock();
 
+    //! Sends the FETCH of the next batch, returns false on failure
+    bool sendFetch();
+
+    /**
+     * Receives the batch of the FETCH in flight, sending it first if needed, and decodes its
+     * features into queue. The FETCH of the following batch is sent before decoding, so that
+     * the server and the network work while this batch is decoded.
+     */
+    void fetchBatch( QQueue<QgsFeature>& queue );
+
+    //! Grows or shrinks the feature queue size after a batch of rows was fetched and decoded
+    void adaptFeatureQueueSize( int rows, qint64 bytes, qint64 waitTime, qint64 decodeTime );
+
+    //! Waits for the batch fetched in the background and drops the FETCH in flight, if any
+    void finishPrefetch();
+
     bool mExpressionCompiled;
     bool mOrderByCompiled;
     bool mLastFetch;
     bool mFilterRequiresGeometry;
+
+    //! Set to true if batches are fetched ahead in a helper thread (not on shared transaction connections)
+    bool mPrefetch;
+
+    //! Number of rows requested by the FETCH sent but not received yet, 0 if none
+    int mFetchInFlight;
+
+    //! Next batch, fetched and decoded in a helper thread while mFeatureQueue is consumed
+    QQueue<QgsFeature> mPrefetchQueue;
+    QFuture<void> mPrefetchFuture;
+    bool mPrefetching;
+
+    static const int sMinFeatureQueueSize;
+    static const int sMaxFeatureQueueSize;
+    static const int sMaxFeatureQueueBytes;
+
+    friend class QgsPostgresFetchTask;
 };
 
 #endif // QGSPOSTGRESFEATUREITERATOR_H
@@ -30,6 +30,7 @@
 #include <QTimer>
 #include <QSettings>
 #include <QStyle>
+#include <QThreadPool>
 
 QgsWFSFeatureHitsAsyncRequest::QgsWFSFeatureHitsAsyncRequest( QgsWFSDataSourceURI& uri )
     : QgsWfsRequest( uri.uri() )
@@ -406,6 +407,8 @@ void QgsWFSFeatureDownloader::run( bool serializeFeatures, int maxFeatures )
   {
     success = true;
     QgsGmlStreamingParser* parser = mShared->createParser();
+    // large responses are parsed by several threads while they are downloaded
+    parser->setMaxThreads( QThreadPool::globalInstance()->maxThreadCount() );
 
     QUrl url( buildURL( mTotalDownloadedFeatureCount,
                         maxFeatures ? maxFeatures : mShared->mMaxFeatures, false ) );
@@ -19,6 +19,7 @@
 //for CMAKE_INSTALL_PREFIX
 #include "qgsconfig.h"
 #include "qgsserver.h"
+#include "qgsserverworkerpool.h"
 
 #include <fcgi_stdio.h>
 
@@ -37,6 +38,16 @@ int fcgi_accept()
 int main( int argc, char * argv[] )
 {
   QgsServer server( argc, argv );
+
+  int threadCount = QgsServerWorkerPool::threadCountFromEnvironment();
+  if ( threadCount > 1 && !FCGX_IsCGI() )
+  {
+    // FastCGI requests processed by worker threads
+    QgsServerWorkerPool pool( &server, threadCount );
+    pool.exec();
+    return 0;
+  }
+
   // Starts FCGI loop
   while ( fcgi_accept() >= 0 )
   {
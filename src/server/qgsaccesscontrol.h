@@ -120,6 +120,11 @@ class SERVER_EXPORT QgsAccessControl : public QgsFeatureFilterProvider
      */
     void registerAccessControl( QgsAccessControlFilter* accessControl, int priority = 0 );
 
+    /** Returns true if no access control filter has been registered
+     * @note added in QGIS 2.99
+     */
+    bool isEmpty() const { return mPluginsAccessControls->isEmpty(); }
+
   private:
     /** The AccessControl plugins registry */
     QgsAccessControlFilterMap* mPluginsAccessControls;
@@ -19,7 +19,8 @@
 #include "qgslogger.h"
 #include <QCoreApplication>
 
-QgsCapabilitiesCache::QgsCapabilitiesCache()
+QgsCapabilitiesCache::QgsCapabilitiesCache( bool watchFiles )
+    : mWatchFiles( watchFiles )
 {
   QObject::connect( &mFileSystemWatcher, SIGNAL( fileChanged( const QString& ) ), this, SLOT( removeChangedEntry( const QString& ) ) );
 }
@@ -30,7 +31,8 @@ QgsCapabilitiesCache::~QgsCapabilitiesCache()
 
 const QDomDocument* QgsCapabilitiesCache::searchCapabilitiesDocument( const QString& configFilePath, const QString& key )
 {
-  QCoreApplication::processEvents(); //get updates from file system watcher
+  if ( mWatchFiles )
+    QCoreApplication::processEvents(); //get updates from file system watcher
 
   if ( mCachedCapabilities.contains( configFilePath ) && mCachedCapabilities[ configFilePath ].contains( key ) )
   {
@@ -54,7 +56,8 @@ void QgsCapabilitiesCache::insertCapabilitiesDocument( const QString& configFile
 
   if ( !mCachedCapabilities.contains( configFilePath ) )
   {
-    mFileSystemWatcher.addPath( configFilePath );
+    if ( mWatchFiles )
+      mFileSystemWatcher.addPath( configFilePath );
     mCachedCapabilities.insert( configFilePath, QHash<QString, QDomDocument>() );
   }
 
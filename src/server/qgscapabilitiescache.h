@@ -29,7 +29,11 @@ class SERVER_EXPORT QgsCapabilitiesCache : public QObject
 {
     Q_OBJECT
   public:
-    QgsCapabilitiesCache();
+    /** Constructor
+     * @param watchFiles true to remove the documents of a project file when it changes, false if
+     * the changes are reported with removeCapabilitiesDocument() (added in QGIS 2.99)
+     */
+    explicit QgsCapabilitiesCache( bool watchFiles = true );
     ~QgsCapabilitiesCache();
 
     /** Returns cached capabilities document (or 0 if document for configuration file not in cache)
@@ -54,6 +58,7 @@ class SERVER_EXPORT QgsCapabilitiesCache : public QObject
   private:
     QHash< QString, QHash< QString, QDomDocument > > mCachedCapabilities;
     QFileSystemWatcher mFileSystemWatcher;
+    bool mWatchFiles;
 
   private slots:
     /** Removes changed entry from this cache*/
@@ -26,8 +26,34 @@
 #include "qgsproject.h"
 
 #include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadStorage>
+
+static QThreadStorage< QgsConfigCache* > sThreadInstances;
+
+// number of changes of each watched file, read by the caches of the request threads
+static QMutex sFileChangesMutex;
+static QHash<QString, int> sFileChanges;
+
+// snapshots of the xml documents, shared by the caches of all the threads
+static QgsProjectSnapshot* sharedSnapshot()
+{
+  static QgsProjectSnapshot snapshot;
+  return &snapshot;
+}
 
 QgsConfigCache* QgsConfigCache::instance()
+{
+  if ( sThreadInstances.hasLocalData() )
+    return sThreadInstances.localData();
+
+  return sharedInstance();
+}
+
+QgsConfigCache* QgsConfigCache::sharedInstance()
 {
   static QgsConfigCache *instance = nullptr;
 
@@ -37,6 +63,20 @@ QgsConfigCache* QgsConfigCache::instance()
   return instance;
 }
 
+void QgsConfigCache::createThreadInstance()
+{
+  if ( sThreadInstances.hasLocalData() )
+    return;
+
+  QgsConfigCache* cache = new QgsConfigCache();
+  {
+    // the changes made before the thread started do not concern it
+    QMutexLocker locker( &sFileChangesMutex );
+    cache->mFileChanges = sFileChanges;
+  }
+  sThreadInstances.setLocalData( cache );
+}
+
 QgsConfigCache::QgsConfigCache()
 {
   QObject::connect( &mFileSystemWatcher, SIGNAL( fileChanged( const QString& ) ), this, SLOT( removeChangedEntry( const QString& ) ) );
@@ -201,38 +241,105 @@ QDomDocument* QgsConfigCache::xmlDocument( const QString& filePath )
   }
 
   // first get cache
-  QDomDocument* xmlDoc = mXmlDocumentCache.object( filePath );
+  QgsProjectSnapshotDocument* xmlDoc = mXmlDocumentCache.object( filePath );
   if ( !xmlDoc )
   {
-    //then create xml document
-    xmlDoc = new QDomDocument();
-    QString errorMsg;
-    int line, column;
-    if ( !xmlDoc->setContent( &configFile, true, &errorMsg, &line, &column ) )
+    //then try the snapshot shared with the other threads and server processes
+    QFileInfo fileInfo( configFile );
+    QByteArray content = configFile.readAll();
+    QgsProjectSnapshot* snapshot = sharedSnapshot();
+    xmlDoc = snapshot->load( fileInfo, content );
+    if ( !xmlDoc )
     {
-      QgsMessageLog::logMessage( "Error parsing file '" + filePath +
-                                 QString( "': parse error %1 at row %2, column %3" ).arg( errorMsg ).arg( line ).arg( column ), "Server", QgsMessageLog::CRITICAL );
-      delete xmlDoc;
-      return nullptr;
+      //then create xml document
+      QDomDocument* parsedDoc = new QDomDocument();
+      QString errorMsg;
+      int line, column;
+      if ( !parsedDoc->setContent( content, true, &errorMsg, &line, &column ) )
+      {
+        QgsMessageLog::logMessage( "Error parsing file '" + filePath +
+                                   QString( "': parse error %1 at row %2, column %3" ).arg( errorMsg ).arg( line ).arg( column ), "Server", QgsMessageLog::CRITICAL );
+        delete parsedDoc;
+        return nullptr;
+      }
+      //the cached document shares the strings of the snapshot if it could be written
+      if ( snapshot->save( fileInfo, *parsedDoc, content ) )
+        xmlDoc = snapshot->load( fileInfo, content );
+      if ( xmlDoc )
+        delete parsedDoc;
+      else
+        xmlDoc = new QgsProjectSnapshotDocument( parsedDoc );
     }
     mXmlDocumentCache.insert( filePath, xmlDoc );
-    mFileSystemWatcher.addPath( filePath );
+    watchFile( filePath );
     xmlDoc = mXmlDocumentCache.object( filePath );
     Q_ASSERT( xmlDoc );
   }
-  return xmlDoc;
+  return xmlDoc->document();
 }
 
-void QgsConfigCache::removeChangedEntry( const QString& path )
+void QgsConfigCache::removeCachedEntries( const QString& path )
 {
   mWMSConfigCache.remove( path );
   mWFSConfigCache.remove( path );
   mWCSConfigCache.remove( path );
 
   //xml document must be removed last, as other config cache destructors may require it
+  //the snapshot mapping it references is released with it
   mXmlDocumentCache.remove( path );
+}
+
+void QgsConfigCache::removeChangedEntry( const QString& path )
+{
+  removeCachedEntries( path );
 
-  mFileSystemWatcher.removePath( path );
+  if ( this == sharedInstance() )
+    mFileSystemWatcher.removePath( path );
+  sharedSnapshot()->remove( QFileInfo( path ) );
+
+  //the caches of the request threads remove their entries before their next request
+  QMutexLocker locker( &sFileChangesMutex );
+  ++sFileChanges[path];
+  mFileChanges[path] = sFileChanges[path];
+}
+
+void QgsConfigCache::watchFile( const QString& path )
+{
+  QgsConfigCache* shared = sharedInstance();
+  if ( shared->thread() == QThread::currentThread() )
+  {
+    shared->mFileSystemWatcher.addPath( path );
+  }
+  else
+  {
+    //the watcher of the main thread reports the changes even if the request thread has no event loop
+    QMetaObject::invokeMethod( shared, "watchFile", Qt::QueuedConnection, Q_ARG( QString, path ) );
+  }
+}
+
+QStringList QgsConfigCache::removeOutdatedEntries()
+{
+  QStringList changedFiles;
+  {
+    QMutexLocker locker( &sFileChangesMutex );
+    if ( mFileChanges == sFileChanges )
+      return changedFiles;
+
+    QHash<QString, int>::const_iterator it = sFileChanges.constBegin();
+    for ( ; it != sFileChanges.constEnd(); ++it )
+    {
+      if ( mFileChanges.value( it.key() ) != it.value() )
+        changedFiles << it.key();
+    }
+    mFileChanges = sFileChanges;
+  }
+
+  Q_FOREACH ( const QString& path, changedFiles )
+  {
+    removeCachedEntries( path );
+    QgsMSLayerCache::instance()->removeProjectLayers( path );
+  }
+  return changedFiles;
 }
 
 
@@ -240,4 +347,3 @@ void QgsConfigCache::removeEntry( const QString& path )
 {
   removeChangedEntry( path );
 }
-
@@ -19,11 +19,14 @@
 #define QGSCONFIGCACHE_H
 
 #include "qgsconfig.h"
+#include "qgsprojectsnapshot.h"
 
 #include <QCache>
 #include <QFileSystemWatcher>
+#include <QHash>
 #include <QMap>
 #include <QObject>
+#include <QStringList>
 
 class QgsServerProjectParser;
 class QgsWCSProjectParser;
@@ -40,6 +43,12 @@ class SERVER_EXPORT QgsConfigCache : public QObject
     static QgsConfigCache* instance();
     ~QgsConfigCache();
 
+    /** Creates a cache for the calling thread, returned by instance() on this thread from
+     * now on and deleted when the thread exits
+     * @note added in QGIS 2.99
+     */
+    static void createThreadInstance();
+
     QgsServerProjectParser* serverConfiguration( const QString& filePath );
     QgsWCSProjectParser* wcsConfiguration(
       const QString& filePath
@@ -63,23 +72,43 @@ class SERVER_EXPORT QgsConfigCache : public QObject
 
     void removeEntry( const QString& path );
 
+    /** Removes the entries of the files which have changed since the last call, together with
+     * the layers of the thread's layer cache. The files are watched by the cache of the main
+     * thread, the caches of the request threads call this before each request.
+     * @returns the paths of the changed files
+     * @note added in QGIS 2.99
+     */
+    QStringList removeOutdatedEntries();
+
   private:
     QgsConfigCache();
 
+    /** Returns the cache of the main thread, which watches the files for all the threads*/
+    static QgsConfigCache* sharedInstance();
+
     /** Check for configuration file updates (remove entry from cache if file changes)*/
     QFileSystemWatcher mFileSystemWatcher;
 
     /** Returns xml document for project file / sld or 0 in case of errors*/
     QDomDocument* xmlDocument( const QString& filePath );
 
-    QCache<QString, QDomDocument> mXmlDocumentCache;
+    /** Removes the parsers and xml document of a file*/
+    void removeCachedEntries( const QString& path );
+
+    QCache<QString, QgsProjectSnapshotDocument> mXmlDocumentCache;
     QCache<QString, QgsWmsConfigParser> mWMSConfigCache;
     QCache<QString, QgsWfsProjectParser> mWFSConfigCache;
     QCache<QString, QgsWCSProjectParser> mWCSConfigCache;
 
+    /** Number of changes of each file when the entries were last checked by removeOutdatedEntries()*/
+    QHash<QString, int> mFileChanges;
+
   private slots:
     /** Removes changed entry from this cache*/
     void removeChangedEntry( const QString& path );
+
+    /** Adds a file to the watcher of the main thread's cache*/
+    void watchFile( const QString& path );
 };
 
 #endif // QGSCONFIGCACHE_H
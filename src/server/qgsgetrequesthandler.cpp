@@ -13,6 +13,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgsgetrequesthandler.h"
+#include "qgsserverrequestenvironment.h"
 #include "qgslogger.h"
 #include "qgsremotedatasourcebuilder.h"
 #include <QStringList>
@@ -28,7 +29,7 @@ void QgsGetRequestHandler::parseInput()
 {
   QString queryString;
 
-  const char* qs = getenv( "QUERY_STRING" );
+  const char* qs = QgsServerRequestEnvironment::variable( "QUERY_STRING" );
   if ( qs )
   {
     queryString = QString( qs );
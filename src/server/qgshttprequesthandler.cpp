@@ -19,6 +19,7 @@
 
 #include "qgis.h"
 #include "qgshttprequesthandler.h"
+#include "qgsserverrequestenvironment.h"
 #if QT_VERSION < 0x050000
 #include "qgsftptransaction.h"
 #include "qgshttptransaction.h"
@@ -655,13 +656,20 @@ void QgsHttpRequestHandler::requestStringToParameterMap( const QString& request,
 QString QgsHttpRequestHandler::readPostBody() const
 {
   QgsMessageLog::logMessage( "QgsHttpRequestHandler::readPostBody" );
-  char* lengthString = nullptr;
+
+  // The body of the requests of the FastCGI worker threads has already been read
+  if ( QgsServerRequestEnvironment::hasRequest() )
+  {
+    return QString::fromLocal8Bit( QgsServerRequestEnvironment::body() );
+  }
+
+  const char* lengthString = nullptr;
   int length = 0;
   char* input = nullptr;
   QString inputString;
   QString lengthQString;
 
-  lengthString = getenv( "CONTENT_LENGTH" );
+  lengthString = QgsServerRequestEnvironment::variable( "CONTENT_LENGTH" );
   if ( lengthString )
   {
     bool conversionSuccess = false;
@@ -693,9 +701,9 @@ QString QgsHttpRequestHandler::readPostBody() const
     }
   }
   // Used by the tests
-  else if ( getenv( "REQUEST_BODY" ) )
+  else if ( QgsServerRequestEnvironment::variable( "REQUEST_BODY" ) )
   {
-    inputString = getenv( "REQUEST_BODY" );
+    inputString = QgsServerRequestEnvironment::variable( "REQUEST_BODY" );
   }
   return inputString;
 }
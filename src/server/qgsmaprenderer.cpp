@@ -1134,5 +1134,3 @@ void QgsMapRenderer::readDefaultDatumTransformations()
     }
   }
 }
-
-bool QgsMapRenderer::mDrawing = false;
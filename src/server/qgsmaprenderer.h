@@ -312,7 +312,7 @@ class SERVER_EXPORT QgsMapRenderer : public QObject
     void adjustExtentToSize();
 
     //! indicates drawing in progress
-    static bool mDrawing;
+    bool mDrawing;
 
     //! map units per pixel
     double mMapUnitsPerPixel;
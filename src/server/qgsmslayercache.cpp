@@ -22,17 +22,34 @@
 #include "qgsvectorlayer.h"
 #include "qgslogger.h"
 #include <QFile>
+#include <QThreadStorage>
+
+static QThreadStorage< QgsMSLayerCache* > sThreadInstances;
 
 QgsMSLayerCache* QgsMSLayerCache::instance()
 {
+  if ( sThreadInstances.hasLocalData() )
+    return sThreadInstances.localData();
+
   static QgsMSLayerCache *mInstance = 0;
   if ( !mInstance )
     mInstance = new QgsMSLayerCache();
   return mInstance;
 }
 
+void QgsMSLayerCache::createThreadInstance()
+{
+  if ( sThreadInstances.hasLocalData() )
+    return;
+
+  QgsMSLayerCache* cache = new QgsMSLayerCache();
+  cache->mWatchConfigFiles = false;
+  sThreadInstances.setLocalData( cache );
+}
+
 QgsMSLayerCache::QgsMSLayerCache()
     : mProjectMaxLayers( 0 )
+    , mWatchConfigFiles( true )
 {
   mDefaultMaxLayers = 100;
   //max layer from environment variable overrides default
@@ -86,7 +103,8 @@ void QgsMSLayerCache::insertLayer( const QString& url, const QString& layerName,
     if ( configIt == mConfigFiles.constEnd() )
     {
       mConfigFiles.insert( configFile, 1 );
-      mFileSystemWatcher.addPath( configFile );
+      if ( mWatchConfigFiles )
+        mFileSystemWatcher.addPath( configFile );
     }
     else
     {
@@ -214,7 +232,8 @@ void QgsMSLayerCache::freeEntryRessources( QgsMSLayerCacheEntry& entry )
     if ( configFileCount < 2 )
     {
       mConfigFiles.remove( entry.configFile );
-      mFileSystemWatcher.removePath( entry.configFile );
+      if ( mWatchConfigFiles )
+        mFileSystemWatcher.removePath( entry.configFile );
     }
     else
     {
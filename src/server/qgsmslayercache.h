@@ -56,6 +56,12 @@ class QgsMSLayerCache: public QObject
     static QgsMSLayerCache* instance();
     ~QgsMSLayerCache();
 
+    /** Creates a cache for the calling thread, returned by instance() on this thread from
+     * now on and deleted when the thread exits
+     * @note added in QGIS 2.99
+     */
+    static void createThreadInstance();
+
     /** Inserts a new layer into the cash
     @param url the layer datasource
     @param layerName the layer name (to distinguish between different layers in a request using the same datasource
@@ -106,6 +112,9 @@ class QgsMSLayerCache: public QObject
     /** Maximum number of layers in the cache, overrides DEFAULT_MAX_N_LAYERS if larger*/
     int mProjectMaxLayers;
 
+    /** False for the caches of the request threads, whose layers are removed by QgsConfigCache::removeOutdatedEntries()*/
+    bool mWatchConfigFiles;
+
   private slots:
 
     /** Removes entries from a project (e.g. if a project file has changed)*/
@@ -16,6 +16,7 @@
  ***************************************************************************/
 #include <stdlib.h>
 #include "qgspostrequesthandler.h"
+#include "qgsserverrequestenvironment.h"
 #include "qgsmessagelog.h"
 #include <QDomDocument>
 
@@ -36,7 +37,7 @@ void QgsPostRequestHandler::parseInput()
   QgsMessageLog::logMessage( inputString );
 
   //Map parameter in QUERY_STRING?
-  const char* qs = getenv( "QUERY_STRING" );
+  const char* qs = QgsServerRequestEnvironment::variable( "QUERY_STRING" );
   QMap<QString, QString> getParameters;
   QString queryString;
   QString mapParameter;
@@ -53,7 +54,7 @@ void QgsPostRequestHandler::parseInput()
   int column;
   if ( !doc.setContent( inputString, true, &errorMsg, &line, &column ) )
   {
-    char* requestMethod = getenv( "REQUEST_METHOD" );
+    const char* requestMethod = QgsServerRequestEnvironment::variable( "REQUEST_METHOD" );
     if ( requestMethod && strcmp( requestMethod, "POST" ) == 0 )
     {
       QgsMessageLog::logMessage( QString( "Error at line %1, column %2: %3." ).arg( line ).arg( column ).arg( errorMsg ) );
@@ -63,7 +64,7 @@ void QgsPostRequestHandler::parseInput()
   else
   {
     QString queryString;
-    const char* qs = getenv( "QUERY_STRING" );
+    const char* qs = QgsServerRequestEnvironment::variable( "QUERY_STRING" );
     if ( qs )
     {
       queryString = QString( qs );
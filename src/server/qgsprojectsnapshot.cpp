@@ -0,0 +1,619 @@
+/***************************************************************************
+                              qgsprojectsnapshot.cpp
+                              ----------------------
+  begin                : October 2016
+  copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsprojectsnapshot.h"
+#include "qgsmessagelog.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+///@cond PRIVATE
+
+namespace
+{
+  const char SNAPSHOT_MAGIC[8] = { 'Q', 'G', 'S', 'S', 'N', 'A', 'P', '\0' };
+  const quint32 SNAPSHOT_VERSION = 2;
+  const quint32 SNAPSHOT_BYTE_ORDER = 0x01020304;
+  const quint32 NULL_STRING = 0xffffffff;
+  const int MAX_DEPTH = 1024;
+
+  // node records
+  const quint32 RECORD_ELEMENT = 0;
+  const quint32 RECORD_ELEMENT_NS = 1;
+  const quint32 RECORD_TEXT = 2;
+  const quint32 RECORD_CDATA = 3;
+  const quint32 RECORD_COMMENT = 4;
+  const quint32 RECORD_PROCESSING_INSTRUCTION = 5;
+
+  /* Layout of a snapshot file:
+   * - header
+   * - string table: for each string its length in UTF-16 units and its data, padded to 4 bytes
+   * - node stream: 32 bit words, strings are referenced by their index in the string table
+   *   - document type name, public id and system id
+   *   - number of top level nodes followed by the nodes
+   *   - element: record, namespace, tag name, attribute count, for each attribute
+   *     (namespace flag, namespace, name, value), child count followed by the children
+   *   - text, CDATA section, comment: record, data
+   *   - processing instruction: record, target, data
+   */
+  struct SnapshotHeader
+  {
+    char magic[8];
+    quint32 version;
+    quint32 byteOrder;
+    qint64 sourceModified;
+    qint64 sourceSize;
+    quint32 stringCount;
+    quint32 stringBytes;
+    quint32 nodeWords;
+    quint32 reserved;
+    char sourceHash[16];
+  };
+
+  class SnapshotWriter
+  {
+    public:
+      SnapshotWriter()
+          : mStringCount( 0 )
+      {}
+
+      void writeDocument( const QDomDocument& document )
+      {
+        QDomDocumentType docType = document.doctype();
+        mNodes << string( docType.name() ) << string( docType.publicId() ) << string( docType.systemId() );
+        writeChildren( document );
+      }
+
+      const QByteArray& strings() const { return mStrings; }
+      quint32 stringCount() const { return mStringCount; }
+      const QVector<quint32>& nodes() const { return mNodes; }
+
+    private:
+      quint32 string( const QString& value )
+      {
+        if ( value.isNull() )
+          return NULL_STRING;
+
+        QHash<QString, quint32>::const_iterator it = mIndex.constFind( value );
+        if ( it != mIndex.constEnd() )
+          return it.value();
+
+        quint32 index = mStringCount++;
+        mIndex.insert( value, index );
+
+        quint32 length = value.length();
+        mStrings.append( reinterpret_cast<const char*>( &length ), sizeof( length ) );
+        mStrings.append( reinterpret_cast<const char*>( value.utf16() ), length * sizeof( ushort ) );
+        if ( length % 2 )
+          mStrings.append( QByteArray( sizeof( ushort ), '\0' ) );
+        return index;
+      }
+
+      void writeChildren( const QDomNode& node )
+      {
+        int countPos = mNodes.count();
+        mNodes << 0;
+
+        quint32 count = 0;
+        for ( QDomNode child = node.firstChild(); !child.isNull(); child = child.nextSibling() )
+        {
+          if ( writeNode( child ) )
+            ++count;
+        }
+        mNodes[countPos] = count;
+      }
+
+      bool writeNode( const QDomNode& node )
+      {
+        switch ( node.nodeType() )
+        {
+          case QDomNode::ElementNode:
+          {
+            QDomElement element = node.toElement();
+            mNodes << ( element.localName().isNull() ? RECORD_ELEMENT : RECORD_ELEMENT_NS )
+            << string( element.namespaceURI() ) << string( element.tagName() );
+
+            QDomNamedNodeMap attributes = element.attributes();
+            mNodes << attributes.count();
+            for ( int i = 0; i < attributes.count(); ++i )
+            {
+              QDomAttr attribute = attributes.item( i ).toAttr();
+              mNodes << ( attribute.localName().isNull() ? 0 : 1 )
+              << string( attribute.namespaceURI() ) << string( attribute.name() ) << string( attribute.value() );
+            }
+            writeChildren( element );
+            return true;
+          }
+
+          case QDomNode::TextNode:
+            mNodes << RECORD_TEXT << string( node.toText().data() );
+            return true;
+
+          case QDomNode::CDATASectionNode:
+            mNodes << RECORD_CDATA << string( node.toCDATASection().data() );
+            return true;
+
+          case QDomNode::CommentNode:
+            mNodes << RECORD_COMMENT << string( node.toComment().data() );
+            return true;
+
+          case QDomNode::ProcessingInstructionNode:
+          {
+            QDomProcessingInstruction pi = node.toProcessingInstruction();
+            mNodes << RECORD_PROCESSING_INSTRUCTION << string( pi.target() ) << string( pi.data() );
+            return true;
+          }
+
+          default:
+            // the document type is stored separately, other nodes are not created by the parser
+            return false;
+        }
+      }
+
+      QHash<QString, quint32> mIndex;
+      quint32 mStringCount;
+      QByteArray mStrings;
+      QVector<quint32> mNodes;
+  };
+
+  class SnapshotReader
+  {
+    public:
+      SnapshotReader( const quint32* nodes, quint32 count, const QVector<QString>& strings )
+          : mNodes( nodes )
+          , mCount( count )
+          , mPos( 0 )
+          , mStrings( strings )
+      {}
+
+      QDomDocument* readDocument()
+      {
+        QString name, publicId, systemId;
+        if ( !nextString( name ) || !nextString( publicId ) || !nextString( systemId ) )
+          return nullptr;
+
+        QDomDocument* document;
+        if ( name.isNull() )
+        {
+          document = new QDomDocument();
+        }
+        else
+        {
+          QDomImplementation implementation;
+          document = new QDomDocument( implementation.createDocumentType( name, publicId, systemId ) );
+        }
+
+        if ( !readChildren( *document, *document, 0 ) || mPos != mCount )
+        {
+          delete document;
+          return nullptr;
+        }
+        return document;
+      }
+
+    private:
+      bool next( quint32& value )
+      {
+        if ( mPos >= mCount )
+          return false;
+        value = mNodes[mPos++];
+        return true;
+      }
+
+      bool nextString( QString& value )
+      {
+        quint32 index;
+        if ( !next( index ) )
+          return false;
+
+        if ( index == NULL_STRING )
+        {
+          value = QString();
+          return true;
+        }
+        if ( index >= static_cast< quint32 >( mStrings.count() ) )
+          return false;
+
+        value = mStrings.at( index );
+        return true;
+      }
+
+      bool readChildren( QDomDocument& document, QDomNode parent, int depth )
+      {
+        quint32 count;
+        if ( depth > MAX_DEPTH || !next( count ) )
+          return false;
+
+        for ( quint32 i = 0; i < count; ++i )
+        {
+          quint32 record;
+          if ( !next( record ) )
+            return false;
+
+          switch ( record )
+          {
+            case RECORD_ELEMENT:
+            case RECORD_ELEMENT_NS:
+            {
+              QString ns, name;
+              quint32 attributeCount;
+              if ( !nextString( ns ) || !nextString( name ) || !next( attributeCount ) )
+                return false;
+
+              QDomElement element = record == RECORD_ELEMENT_NS ? document.createElementNS( ns, name ) : document.createElement( name );
+              for ( quint32 j = 0; j < attributeCount; ++j )
+              {
+                quint32 isNS;
+                QString attributeNS, attributeName, attributeValue;
+                if ( !next( isNS ) || !nextString( attributeNS ) || !nextString( attributeName ) || !nextString( attributeValue ) )
+                  return false;
+
+                if ( isNS )
+                  element.setAttributeNS( attributeNS, attributeName, attributeValue );
+                else
+                  element.setAttribute( attributeName, attributeValue );
+              }
+              parent.appendChild( element );
+
+              if ( !readChildren( document, element, depth + 1 ) )
+                return false;
+              break;
+            }
+
+            case RECORD_TEXT:
+            case RECORD_CDATA:
+            case RECORD_COMMENT:
+            {
+              QString data;
+              if ( !nextString( data ) )
+                return false;
+
+              if ( record == RECORD_TEXT )
+                parent.appendChild( document.createTextNode( data ) );
+              else if ( record == RECORD_CDATA )
+                parent.appendChild( document.createCDATASection( data ) );
+              else
+                parent.appendChild( document.createComment( data ) );
+              break;
+            }
+
+            case RECORD_PROCESSING_INSTRUCTION:
+            {
+              QString target, data;
+              if ( !nextString( target ) || !nextString( data ) )
+                return false;
+
+              parent.appendChild( document.createProcessingInstruction( target, data ) );
+              break;
+            }
+
+            default:
+              return false;
+          }
+        }
+        return true;
+      }
+
+      const quint32* mNodes;
+      quint32 mCount;
+      quint32 mPos;
+      const QVector<QString>& mStrings;
+  };
+
+  //! Returns the MD5 hash of the project content, empty if the file cannot be read
+  QByteArray sourceHash( const QFileInfo& source, const QByteArray& sourceContent )
+  {
+    if ( !sourceContent.isEmpty() )
+      return QCryptographicHash::hash( sourceContent, QCryptographicHash::Md5 );
+
+    QFile file( source.absoluteFilePath() );
+    if ( !file.open( QIODevice::ReadOnly ) )
+      return QByteArray();
+    return QCryptographicHash::hash( file.readAll(), QCryptographicHash::Md5 );
+  }
+
+  SnapshotHeader readHeader( const uchar* data )
+  {
+    SnapshotHeader header;
+    memcpy( &header, data, sizeof( header ) );
+    return header;
+  }
+
+  bool isUpToDate( const SnapshotHeader& header, const QFileInfo& source, const QByteArray& hash )
+  {
+    // modification time and size are checked first, the hash catches the changes which keep them
+    return memcmp( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) ) == 0
+           && header.version == SNAPSHOT_VERSION
+           && header.byteOrder == SNAPSHOT_BYTE_ORDER
+           && header.sourceModified == source.lastModified().toMSecsSinceEpoch()
+           && header.sourceSize == source.size()
+           && hash.size() == sizeof( header.sourceHash )
+           && memcmp( header.sourceHash, hash.constData(), sizeof( header.sourceHash ) ) == 0;
+  }
+
+  QDomDocument* readSnapshot( const uchar* data, qint64 size, const SnapshotHeader& header )
+  {
+    const uchar* p = data + sizeof( SnapshotHeader );
+    const uchar* end = data + size;
+    if ( end - p < static_cast< qint64 >( header.stringBytes ) )
+      return nullptr;
+
+    const uchar* stringsEnd = p + header.stringBytes;
+    QVector<QString> strings;
+    strings.reserve( header.stringCount );
+    for ( quint32 i = 0; i < header.stringCount; ++i )
+    {
+      quint32 length;
+      if ( stringsEnd - p < static_cast< qint64 >( sizeof( length ) ) )
+        return nullptr;
+      memcpy( &length, p, sizeof( length ) );
+      p += sizeof( length );
+
+      qint64 bytes = ( static_cast< qint64 >( length ) + length % 2 ) * sizeof( ushort );
+      if ( stringsEnd - p < bytes )
+        return nullptr;
+      // the string data is not copied, the document references the mapping
+      strings << QString::fromRawData( reinterpret_cast<const QChar*>( p ), length );
+      p += bytes;
+    }
+
+    if ( p != stringsEnd || ( end - p ) / static_cast< qint64 >( sizeof( quint32 ) ) < static_cast< qint64 >( header.nodeWords ) )
+      return nullptr;
+
+    // mappings are page aligned, in-memory snapshots are heap aligned, and all sections are padded to 4 bytes
+    SnapshotReader reader( reinterpret_cast<const quint32*>( p ), header.nodeWords, strings );
+    return reader.readDocument();
+  }
+}
+
+/** \ingroup server
+ * Mapped snapshot file, unmapped when the last document referencing it is deleted
+ */
+class QgsProjectSnapshotMapping
+{
+  public:
+    QgsProjectSnapshotMapping( QFile* file, uchar* data, qint64 size )
+        : mFile( file )
+        , mData( data )
+        , mSize( size )
+    {}
+
+    //! Constructor for a snapshot kept in memory
+    explicit QgsProjectSnapshotMapping( const QByteArray& snapshot )
+        : mFile( nullptr )
+        , mSnapshot( snapshot )
+    {
+      // the data is only read, it is not detached from the writer's copy
+      mData = reinterpret_cast<uchar*>( const_cast<char*>( mSnapshot.constData() ) );
+      mSize = mSnapshot.size();
+    }
+
+    ~QgsProjectSnapshotMapping()
+    {
+      if ( mFile )
+      {
+        mFile->unmap( mData );
+        delete mFile;
+      }
+    }
+
+    const uchar* data() const { return mData; }
+    qint64 size() const { return mSize; }
+
+  private:
+    Q_DISABLE_COPY( QgsProjectSnapshotMapping )
+
+    QFile* mFile;
+    QByteArray mSnapshot;
+    uchar* mData;
+    qint64 mSize;
+};
+
+///@endcond
+
+
+QgsProjectSnapshotDocument::QgsProjectSnapshotDocument( QDomDocument* document )
+    : mDocument( document )
+{
+}
+
+QgsProjectSnapshotDocument::QgsProjectSnapshotDocument( QDomDocument* document, const QSharedPointer<QgsProjectSnapshotMapping>& mapping )
+    : mDocument( document )
+    , mMapping( mapping )
+{
+}
+
+QgsProjectSnapshotDocument::~QgsProjectSnapshotDocument()
+{
+  // the document references the mapping, which is released afterwards
+  delete mDocument;
+}
+
+
+QgsProjectSnapshot::QgsProjectSnapshot( const QString& directory )
+    : mDirectory( directory )
+{
+}
+
+QgsProjectSnapshot::~QgsProjectSnapshot()
+{
+}
+
+QString QgsProjectSnapshot::directoryFromEnvironment()
+{
+  return QString::fromLocal8Bit( getenv( "QGIS_SERVER_PROJECT_SNAPSHOT_DIR" ) );
+}
+
+QString QgsProjectSnapshot::snapshotPath( const QFileInfo& source ) const
+{
+  QByteArray hash = QCryptographicHash::hash( source.absoluteFilePath().toUtf8(), QCryptographicHash::Md5 ).toHex();
+  return QString( "%1/%2_%3.qgssnapshot" ).arg( mDirectory, source.completeBaseName(), QString::fromLatin1( hash ) );
+}
+
+QgsProjectSnapshotDocument* QgsProjectSnapshot::load( const QFileInfo& source, const QByteArray& sourceContent )
+{
+  QByteArray hash = sourceHash( source, sourceContent );
+  QString path = snapshotPath( source );
+
+  QSharedPointer<QgsProjectSnapshotMapping> mapping;
+  {
+    QMutexLocker locker( &mMutex );
+
+    // a document read again from an unchanged snapshot shares the mapping of the previous ones
+    mapping = mMappings.value( path ).toStrongRef();
+    if ( mapping && !isUpToDate( readHeader( mapping->data() ), source, hash ) )
+    {
+      mMappings.remove( path );
+      mMemorySnapshots.remove( path );
+      mapping.clear();
+    }
+
+    if ( !mapping )
+    {
+      if ( !isPersistent() )
+        return nullptr;
+
+      QFile* file = new QFile( path );
+      if ( file->exists() && file->open( QIODevice::ReadOnly ) )
+      {
+        qint64 size = file->size();
+        uchar* data = size >= static_cast< qint64 >( sizeof( SnapshotHeader ) ) ? file->map( 0, size ) : nullptr;
+        if ( data )
+        {
+          // the snapshot is replaced by renaming a new file, the mapped one never changes
+          mapping = QSharedPointer<QgsProjectSnapshotMapping>( new QgsProjectSnapshotMapping( file, data, size ) );
+        }
+      }
+      if ( !mapping )
+      {
+        delete file;
+        return nullptr;
+      }
+      if ( !isUpToDate( readHeader( mapping->data() ), source, hash ) )
+        return nullptr;
+      mMappings.insert( path, mapping );
+    }
+  }
+
+  // the mapping is only read, the documents are built without holding the lock
+  QDomDocument* document = readSnapshot( mapping->data(), mapping->size(), readHeader( mapping->data() ) );
+  if ( !document )
+  {
+    QgsMessageLog::logMessage( "Ignoring corrupted snapshot '" + path + "'", "Server", QgsMessageLog::WARNING );
+    remove( source );
+    return nullptr;
+  }
+  return new QgsProjectSnapshotDocument( document, mapping );
+}
+
+void QgsProjectSnapshot::remove( const QFileInfo& source )
+{
+  QString path = snapshotPath( source );
+  QMutexLocker locker( &mMutex );
+  mMappings.remove( path );
+  mMemorySnapshots.remove( path );
+}
+
+bool QgsProjectSnapshot::save( const QFileInfo& source, const QDomDocument& document, const QByteArray& sourceContent )
+{
+  QByteArray hash = sourceHash( source, sourceContent );
+  if ( hash.isEmpty() )
+    return false;
+
+  SnapshotWriter writer;
+  writer.writeDocument( document );
+
+  SnapshotHeader header;
+  memset( &header, 0, sizeof( header ) );
+  memcpy( header.magic, SNAPSHOT_MAGIC, sizeof( SNAPSHOT_MAGIC ) );
+  header.version = SNAPSHOT_VERSION;
+  header.byteOrder = SNAPSHOT_BYTE_ORDER;
+  header.sourceModified = source.lastModified().toMSecsSinceEpoch();
+  header.sourceSize = source.size();
+  memcpy( header.sourceHash, hash.constData(), sizeof( header.sourceHash ) );
+  header.stringCount = writer.stringCount();
+  header.stringBytes = writer.strings().size();
+  header.nodeWords = writer.nodes().size();
+
+  QByteArray snapshot;
+  snapshot.reserve( sizeof( header ) + writer.strings().size() + writer.nodes().size() * sizeof( quint32 ) );
+  snapshot.append( reinterpret_cast<const char*>( &header ), sizeof( header ) );
+  snapshot.append( writer.strings() );
+  snapshot.append( reinterpret_cast<const char*>( writer.nodes().constData() ), writer.nodes().size() * sizeof( quint32 ) );
+
+  QString path = snapshotPath( source );
+  if ( !isPersistent() )
+  {
+    // the snapshot is kept until it is removed, the threads load their documents from it
+    QSharedPointer<QgsProjectSnapshotMapping> mapping( new QgsProjectSnapshotMapping( snapshot ) );
+    QMutexLocker locker( &mMutex );
+    mMemorySnapshots.insert( path, mapping );
+    mMappings.insert( path, mapping );
+    return true;
+  }
+
+  if ( !QDir().mkpath( mDirectory ) )
+  {
+    QgsMessageLog::logMessage( "Cannot create snapshot directory '" + mDirectory + "'", "Server", QgsMessageLog::WARNING );
+    return false;
+  }
+
+  // write to a process and thread specific file first: others may be reading the current snapshot
+  QString tempPath = QString( "%1.%2.%3" ).arg( path ).arg( QCoreApplication::applicationPid() )
+                     .arg( reinterpret_cast< quintptr >( QThread::currentThreadId() ) );
+  QFile file( tempPath );
+  if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+  {
+    QgsMessageLog::logMessage( "Cannot write snapshot '" + tempPath + "'", "Server", QgsMessageLog::WARNING );
+    return false;
+  }
+
+  bool written = file.write( snapshot ) == snapshot.size();
+  file.close();
+
+  if ( written )
+  {
+#ifdef Q_OS_WIN
+    QFile::remove( path );
+    written = QFile::rename( tempPath, path );
+#else
+    written = ::rename( QFile::encodeName( tempPath ).constData(), QFile::encodeName( path ).constData() ) == 0;
+#endif
+  }
+
+  if ( !written )
+  {
+    QgsMessageLog::logMessage( "Cannot write snapshot '" + path + "'", "Server", QgsMessageLog::WARNING );
+    QFile::remove( tempPath );
+    return false;
+  }
+
+  QgsMessageLog::logMessage( "Project snapshot written to '" + path + "'", "Server", QgsMessageLog::INFO );
+  return true;
+}
@@ -0,0 +1,145 @@
+/***************************************************************************
+                              qgsprojectsnapshot.h
+                              --------------------
+  begin                : October 2016
+  copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************/
+
+/***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSPROJECTSNAPSHOT_H
+#define QGSPROJECTSNAPSHOT_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+#include <QWeakPointer>
+
+class QDomDocument;
+class QFileInfo;
+class QgsProjectSnapshotMapping;
+
+/** \ingroup server
+ * A project or SLD document, which may have been loaded from a snapshot.
+ *
+ * The strings of a document loaded from a snapshot point to the mapped snapshot file,
+ * which stays mapped until the last document loaded from it is deleted.
+ *
+ * @note added in QGIS 2.99
+ */
+class SERVER_EXPORT QgsProjectSnapshotDocument
+{
+  public:
+
+    /** Constructor for a document which does not reference a snapshot, e.g. a parsed one
+     * @param document document, ownership is transferred
+     */
+    explicit QgsProjectSnapshotDocument( QDomDocument* document );
+
+    ~QgsProjectSnapshotDocument();
+
+    //! Returns the document, owned by this object
+    QDomDocument* document() const { return mDocument; }
+
+  private:
+
+    Q_DISABLE_COPY( QgsProjectSnapshotDocument )
+
+    QgsProjectSnapshotDocument( QDomDocument* document, const QSharedPointer<QgsProjectSnapshotMapping>& mapping );
+
+    QDomDocument* mDocument;
+
+    //! Mapping referenced by the strings of the document, released after the document is deleted
+    QSharedPointer<QgsProjectSnapshotMapping> mMapping;
+
+    friend class QgsProjectSnapshot;
+};
+
+/** \ingroup server
+ * Precompiled binary snapshots of project and SLD documents.
+ *
+ * A snapshot holds the parsed document tree (layer definitions, styles, CRS definitions...)
+ * as an interned string table followed by a flat node stream. It is written once next to
+ * the other snapshots of the cache directory and memory-mapped read-only by every server
+ * process, which rebuilds the document without going through the XML parser.
+ * The nodes of the document are created by each process, but its strings are not copied:
+ * they point to the string table of the mapping, whose pages are shared by all the processes.
+ * A mapping is therefore kept as long as a document loaded from it exists.
+ * A snapshot is only used while the modification time, size and content hash of the project
+ * file match the ones it was created from.
+ *
+ * Snapshot files are written when the QGIS_SERVER_PROJECT_SNAPSHOT_DIR environment variable
+ * is set to a directory writable by the server processes. Otherwise the snapshots are kept
+ * in memory until they are removed, and the documents loaded by the request threads of the
+ * process share their strings.
+ *
+ * The methods may be called from several threads.
+ *
+ * @note added in QGIS 2.99
+ */
+class SERVER_EXPORT QgsProjectSnapshot
+{
+  public:
+
+    /** Constructor
+     * @param directory directory holding the snapshots, an empty path keeps them in memory
+     */
+    explicit QgsProjectSnapshot( const QString& directory = directoryFromEnvironment() );
+
+    ~QgsProjectSnapshot();
+
+    //! Returns true if the snapshots are written to files shared with the other processes, false if they are kept in memory
+    bool isPersistent() const { return !mDirectory.isEmpty(); }
+
+    /** Loads the snapshot of a project file
+     * @param source project file
+     * @param sourceContent content of the project file, read from the file if empty
+     * @returns new document, or nullptr if there is no up to date snapshot of the file
+     */
+    QgsProjectSnapshotDocument* load( const QFileInfo& source, const QByteArray& sourceContent = QByteArray() );
+
+    /** Writes the snapshot of a project file, to the snapshot directory or in memory
+     * @param source project file
+     * @param document parsed project document
+     * @param sourceContent content the document was parsed from, read from the file if empty
+     * @returns true in case of success
+     */
+    bool save( const QFileInfo& source, const QDomDocument& document, const QByteArray& sourceContent = QByteArray() );
+
+    /** Releases the mapping or in-memory snapshot kept for a project file, e.g. when the file
+     * has changed. The documents already loaded from it keep it until they are deleted.
+     */
+    void remove( const QFileInfo& source );
+
+    //! Returns the snapshot directory set by QGIS_SERVER_PROJECT_SNAPSHOT_DIR, empty if not set
+    static QString directoryFromEnvironment();
+
+  private:
+
+    Q_DISABLE_COPY( QgsProjectSnapshot )
+
+    //! Returns the path of the snapshot of a project file
+    QString snapshotPath( const QFileInfo& source ) const;
+
+    QString mDirectory;
+
+    //! Protects the mappings
+    QMutex mMutex;
+
+    //! Last mapping of each snapshot, shared by the documents loaded again while it is up to date
+    QHash<QString, QWeakPointer<QgsProjectSnapshotMapping> > mMappings;
+
+    //! Snapshots kept in memory when there is no snapshot directory
+    QHash<QString, QSharedPointer<QgsProjectSnapshotMapping> > mMemorySnapshots;
+};
+
+#endif // QGSPROJECTSNAPSHOT_H
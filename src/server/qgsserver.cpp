@@ -21,6 +21,7 @@
 //for CMAKE_INSTALL_PREFIX
 #include "qgsconfig.h"
 #include "qgsserver.h"
+#include "qgsserverrequestenvironment.h"
 
 #include "qgsauthmanager.h"
 #include "qgscapabilitiescache.h"
@@ -37,6 +38,8 @@
 #include "qgspallabeling.h"
 #include "qgsnetworkaccessmanager.h"
 #include "qgsmaplayerregistry.h"
+#include "qgsmslayercache.h"
+#include "qgsproject.h"
 #include "qgsserverlogger.h"
 #include "qgseditorwidgetregistry.h"
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
@@ -49,6 +52,8 @@
 #include <QSettings>
 #include <QDateTime>
 #include <QScopedPointer>
+#include <QMutex>
+#include <QThreadStorage>
 // TODO: remove, it's only needed by a single debug message
 #include <fcgi_stdio.h>
 #include <stdlib.h>
@@ -73,6 +78,35 @@ int QgsServer::sArgc;
 QgsApplication* QgsServer::sQgsApplication = nullptr;
 bool QgsServer::sCaptureOutput = false;
 
+///@cond PRIVATE
+
+//! Map renderer and capabilities cache of a thread processing requests in parallel
+struct QgsServerThreadContext
+{
+  QgsServerThreadContext()
+      : mapRenderer( new QgsMapRenderer )
+      , capabilitiesCache( new QgsCapabilitiesCache( false ) )
+  {
+    mapRenderer->setLabelingEngine( new QgsPalLabeling() );
+  }
+
+  ~QgsServerThreadContext()
+  {
+    delete mapRenderer;
+    delete capabilitiesCache;
+  }
+
+  QgsMapRenderer* mapRenderer;
+  QgsCapabilitiesCache* capabilitiesCache;
+};
+
+static QThreadStorage< QgsServerThreadContext* > sThreadContexts;
+
+// Serializes the requests when they cannot be processed in parallel
+static QMutex sRequestMutex;
+
+///@endcond
+
 
 
 QgsServer::QgsServer( int &argc, char **argv )
@@ -134,7 +168,7 @@ void QgsServer::setupNetworkAccessManager()
 QgsRequestHandler* QgsServer::createRequestHandler( const bool captureOutput )
 {
   QgsRequestHandler* requestHandler = nullptr;
-  char* requestMethod = getenv( "REQUEST_METHOD" );
+  const char* requestMethod = QgsServerRequestEnvironment::variable( "REQUEST_METHOD" );
   if ( requestMethod )
   {
     if ( strcmp( requestMethod, "POST" ) == 0 )
@@ -201,45 +235,45 @@ void QgsServer::printRequestParameters( const QMap< QString, QString>& parameter
 void QgsServer::printRequestInfos()
 {
   QgsMessageLog::logMessage( "********************new request***************", "Server", QgsMessageLog::INFO );
-  if ( getenv( "REMOTE_ADDR" ) )
+  if ( QgsServerRequestEnvironment::variable( "REMOTE_ADDR" ) )
   {
-    QgsMessageLog::logMessage( "remote ip: " + QString( getenv( "REMOTE_ADDR" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "remote ip: " + QString( QgsServerRequestEnvironment::variable( "REMOTE_ADDR" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "REMOTE_HOST" ) )
+  if ( QgsServerRequestEnvironment::variable( "REMOTE_HOST" ) )
   {
-    QgsMessageLog::logMessage( "remote ip: " + QString( getenv( "REMOTE_HOST" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "remote ip: " + QString( QgsServerRequestEnvironment::variable( "REMOTE_HOST" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "REMOTE_USER" ) )
+  if ( QgsServerRequestEnvironment::variable( "REMOTE_USER" ) )
   {
-    QgsMessageLog::logMessage( "remote user: " + QString( getenv( "REMOTE_USER" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "remote user: " + QString( QgsServerRequestEnvironment::variable( "REMOTE_USER" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "REMOTE_IDENT" ) )
+  if ( QgsServerRequestEnvironment::variable( "REMOTE_IDENT" ) )
   {
-    QgsMessageLog::logMessage( "REMOTE_IDENT: " + QString( getenv( "REMOTE_IDENT" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "REMOTE_IDENT: " + QString( QgsServerRequestEnvironment::variable( "REMOTE_IDENT" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "CONTENT_TYPE" ) )
+  if ( QgsServerRequestEnvironment::variable( "CONTENT_TYPE" ) )
   {
-    QgsMessageLog::logMessage( "CONTENT_TYPE: " + QString( getenv( "CONTENT_TYPE" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "CONTENT_TYPE: " + QString( QgsServerRequestEnvironment::variable( "CONTENT_TYPE" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "AUTH_TYPE" ) )
+  if ( QgsServerRequestEnvironment::variable( "AUTH_TYPE" ) )
   {
-    QgsMessageLog::logMessage( "AUTH_TYPE: " + QString( getenv( "AUTH_TYPE" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "AUTH_TYPE: " + QString( QgsServerRequestEnvironment::variable( "AUTH_TYPE" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "HTTP_USER_AGENT" ) )
+  if ( QgsServerRequestEnvironment::variable( "HTTP_USER_AGENT" ) )
   {
-    QgsMessageLog::logMessage( "HTTP_USER_AGENT: " + QString( getenv( "HTTP_USER_AGENT" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "HTTP_USER_AGENT: " + QString( QgsServerRequestEnvironment::variable( "HTTP_USER_AGENT" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "HTTP_PROXY" ) )
+  if ( QgsServerRequestEnvironment::variable( "HTTP_PROXY" ) )
   {
-    QgsMessageLog::logMessage( "HTTP_PROXY: " + QString( getenv( "HTTP_PROXY" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "HTTP_PROXY: " + QString( QgsServerRequestEnvironment::variable( "HTTP_PROXY" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "HTTPS_PROXY" ) )
+  if ( QgsServerRequestEnvironment::variable( "HTTPS_PROXY" ) )
   {
-    QgsMessageLog::logMessage( "HTTPS_PROXY: " + QString( getenv( "HTTPS_PROXY" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "HTTPS_PROXY: " + QString( QgsServerRequestEnvironment::variable( "HTTPS_PROXY" ) ), "Server", QgsMessageLog::INFO );
   }
-  if ( getenv( "NO_PROXY" ) )
+  if ( QgsServerRequestEnvironment::variable( "NO_PROXY" ) )
   {
-    QgsMessageLog::logMessage( "NO_PROXY: " + QString( getenv( "NO_PROXY" ) ), "Server", QgsMessageLog::INFO );
+    QgsMessageLog::logMessage( "NO_PROXY: " + QString( QgsServerRequestEnvironment::variable( "NO_PROXY" ) ), "Server", QgsMessageLog::INFO );
   }
 }
 
@@ -284,7 +318,7 @@ void QgsServer::dummyMessageHandler( QtMsgType type, const char *msg )
 QString QgsServer::configPath( const QString& defaultConfigPath, const QMap<QString, QString>& parameters )
 {
   QString cfPath( defaultConfigPath );
-  QString projectFile = getenv( "QGIS_PROJECT_FILE" );
+  QString projectFile = QgsServerRequestEnvironment::variable( "QGIS_PROJECT_FILE" );
   if ( !projectFile.isEmpty() )
   {
     cfPath = projectFile;
@@ -409,6 +443,9 @@ bool QgsServer::init( int & argc, char ** argv )
   sConfigFilePath = new QString( defaultConfigFilePath );
 
 
+  //create the configuration cache on the main thread, its watcher reports the file changes to the request threads
+  QgsConfigCache::instance();
+
   //create cache for capabilities XML
   sCapabilitiesCache = new QgsCapabilitiesCache();
   sMapRenderer =  new QgsMapRenderer;
@@ -449,6 +486,44 @@ void QgsServer::putenv( const QString &var, const QString &val )
 #endif
 }
 
+void QgsServer::initRequestThread()
+{
+  if ( !supportsParallelRequests() || sThreadContexts.hasLocalData() )
+  {
+    return;
+  }
+
+  // the project connects to the registry of its thread
+  QgsMapLayerRegistry::createThreadInstance();
+  QgsProject::createThreadInstance();
+  QgsConfigCache::createThreadInstance();
+  QgsMSLayerCache::createThreadInstance();
+  sThreadContexts.setLocalData( new QgsServerThreadContext() );
+}
+
+bool QgsServer::supportsParallelRequests()
+{
+#ifdef HAVE_SERVER_PYTHON_PLUGINS
+  // Python plugins and filters are called through the shared server interface
+  if ( !QgsServerPlugins::serverPlugins().isEmpty() || !sServerInterface->filters().isEmpty()
+       || !sServerInterface->accessControls()->isEmpty() )
+  {
+    return false;
+  }
+#endif
+  return true;
+}
+
+QgsMapRenderer* QgsServer::mapRenderer()
+{
+  return sThreadContexts.hasLocalData() ? sThreadContexts.localData()->mapRenderer : sMapRenderer;
+}
+
+QgsCapabilitiesCache* QgsServer::capabilitiesCache()
+{
+  return sThreadContexts.hasLocalData() ? sThreadContexts.localData()->capabilitiesCache : sCapabilitiesCache;
+}
+
 /**
  * @brief Handles the request
  * @param queryString
@@ -470,15 +545,27 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString& queryStri
   if ( ! queryString.isEmpty() )
     putenv( "QUERY_STRING", queryString );
 
+  return processRequest( sCaptureOutput );
+}
+
+QPair<QByteArray, QByteArray> QgsServer::processRequest( bool captureOutput )
+{
   int logLevel = QgsServerLogger::instance()->logLevel();
   QTime time; //used for measuring request time if loglevel < 1
   QgsMapLayerRegistry::instance()->removeAllMapLayers();
 
+  // Drop what the thread cached from the files changed since its last request
+  Q_FOREACH ( const QString& path, QgsConfigCache::instance()->removeOutdatedEntries() )
+  {
+    capabilitiesCache()->removeCapabilitiesDocument( path );
+  }
+
   // Clean up  Expression Context
   // because each call to QgsMapLayer::draw add items to QgsExpressionContext scope
   // list. This prevent the scope list to grow indefinitely and seriously deteriorate
   // performances and memory in the long run
-  sMapRenderer->rendererContext()->setExpressionContext( QgsExpressionContext() );
+  QgsMapRenderer* renderer = mapRenderer();
+  renderer->rendererContext()->setExpressionContext( QgsExpressionContext() );
 
   sQgsApplication->processEvents();
   if ( logLevel < 1 )
@@ -488,7 +575,7 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString& queryStri
   }
 
   //Request handler
-  QScopedPointer<QgsRequestHandler> theRequestHandler( createRequestHandler( sCaptureOutput ) );
+  QScopedPointer<QgsRequestHandler> theRequestHandler( createRequestHandler( captureOutput ) );
 
   try
   {
@@ -627,8 +714,8 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString& queryStri
           , parameterMap
           , p
           , theRequestHandler.data()
-          , sMapRenderer
-          , sCapabilitiesCache
+          , renderer
+          , capabilitiesCache()
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
           , accessControl
 #endif
@@ -664,6 +751,18 @@ QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QString& queryStri
   return theRequestHandler->getResponse();
 }
 
+QPair<QByteArray, QByteArray> QgsServer::handleRequest( const QMap<QString, QString>& environment, const QByteArray& requestBody )
+{
+  QMutexLocker locker( supportsParallelRequests() ? nullptr : &sRequestMutex );
+
+  // the request is read from the variables of the thread, the process environment is left untouched
+  QgsServerRequestEnvironment::setRequest( environment, requestBody );
+  QPair<QByteArray, QByteArray> response = processRequest( true );
+  QgsServerRequestEnvironment::clearRequest();
+
+  return response;
+}
+
 #if 0
 // The following code was used to test type conversion in python bindings
 QPair<QByteArray, QByteArray> QgsServer::testQPair( QPair<QByteArray, QByteArray> pair )
@@ -82,6 +82,35 @@ class SERVER_EXPORT QgsServer
      * @return the response headers and body QPair of QByteArray if called from python bindings, empty otherwise
      */
     QPair<QByteArray, QByteArray> handleRequest( const QString& queryString = QString() );
+
+    /** Handles a request which has been read by a FastCGI worker thread or passed from
+     * Python. The request variables and body are only visible to the calling thread, the
+     * process environment is not changed, and the output is captured instead of being printed.
+     *
+     * Threads which have called initRequestThread() process their requests in parallel,
+     * the requests are processed one at a time when Python plugins are loaded.
+     * @param environment CGI variables of the request
+     * @param requestBody body of POST requests
+     * @return the response headers and body
+     * @note added in QGIS 2.99
+     */
+    QPair<QByteArray, QByteArray> handleRequest( const QMap<QString, QString>& environment, const QByteArray& requestBody );
+
+    /** Prepares the calling thread to process requests in parallel with the other threads:
+     * creates the map layer registry, project, configuration and layer caches, map renderer
+     * and capabilities cache used by the requests of the thread, deleted when it exits.
+     * Does nothing if the requests cannot be processed in parallel.
+     * @see supportsParallelRequests()
+     * @note added in QGIS 2.99
+     */
+    static void initRequestThread();
+
+    /** Returns true if requests can be processed in parallel, that is if no Python plugin,
+     * filter or access control is loaded
+     * @note added in QGIS 2.99
+     */
+    static bool supportsParallelRequests();
+
 #if 0
     // The following code was used to test type conversion in python bindings
     QPair<QByteArray, QByteArray> testQPair( QPair<QByteArray, QByteArray> pair );
@@ -94,6 +123,15 @@ class SERVER_EXPORT QgsServer
 
   private:
 
+    //! Processes the request read from the environment of the calling thread
+    QPair<QByteArray, QByteArray> processRequest( bool captureOutput );
+
+    //! Returns the map renderer of the calling thread
+    static QgsMapRenderer* mapRenderer();
+
+    //! Returns the capabilities cache of the calling thread
+    static QgsCapabilitiesCache* capabilitiesCache();
+
     void saveEnvVars();
 
     /** Saves environment variable into mEnvironmentVariables if defined*/
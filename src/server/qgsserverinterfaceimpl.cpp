@@ -18,6 +18,7 @@
 
 
 #include "qgsserverinterfaceimpl.h"
+#include "qgsserverrequestenvironment.h"
 #include "qgsconfigcache.h"
 #include "qgsmslayercache.h"
 
@@ -32,7 +33,7 @@ QgsServerInterfaceImpl::QgsServerInterfaceImpl( QgsCapabilitiesCache* capCache )
 
 QString QgsServerInterfaceImpl::getEnv( const QString& name ) const
 {
-  return getenv( name.toLocal8Bit() );
+  return QgsServerRequestEnvironment::variable( name.toLocal8Bit() );
 }
 
 
@@ -56,7 +56,7 @@ QgsServerLogger::QgsServerLogger(): mLogFile( nullptr )
   }
 
   connect( QgsMessageLog::instance(), SIGNAL( messageReceived( QString, QString, QgsMessageLog::MessageLevel ) ), this,
-           SLOT( logMessage( QString, QString, QgsMessageLog::MessageLevel ) ) );
+           SLOT( logMessage( QString, QString, QgsMessageLog::MessageLevel ) ), Qt::DirectConnection );
 }
 
 void QgsServerLogger::logMessage( const QString& message, const QString& tag, QgsMessageLog::MessageLevel level )
@@ -67,6 +67,7 @@ void QgsServerLogger::logMessage( const QString& message, const QString& tag, Qg
     return;
   }
 
+  QMutexLocker locker( &mMutex );
   mTextStream << ( "[" + QString::number( qlonglong( QCoreApplication::applicationPid() ) ) + "]["
                    + QTime::currentTime().toString() + "] " + message + "\n" );
   mTextStream.flush();
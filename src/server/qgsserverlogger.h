@@ -21,6 +21,7 @@
 #include "qgsmessagelog.h"
 
 #include <QFile>
+#include <QMutex>
 #include <QObject>
 #include <QString>
 #include <QTextStream>
@@ -47,6 +48,8 @@ class QgsServerLogger: public QObject
     QFile mLogFile;
     QTextStream mTextStream;
     int mLogLevel;
+    //! Messages are logged from the FastCGI worker threads
+    QMutex mMutex;
 };
 
 #endif // QGSSERVERLOGGER_H
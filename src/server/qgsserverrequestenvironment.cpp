@@ -0,0 +1,72 @@
+/***************************************************************************
+                        qgsserverrequestenvironment.cpp
+  -------------------------------------------------------------------
+Date                 : October 2016
+Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsserverrequestenvironment.h"
+
+#include <QHash>
+#include <QThreadStorage>
+
+#include <stdlib.h>
+
+///@cond PRIVATE
+
+struct QgsServerRequest
+{
+  QHash<QByteArray, QByteArray> variables;
+  QByteArray body;
+};
+
+static QThreadStorage< QgsServerRequest* > sRequests;
+
+///@endcond
+
+const char* QgsServerRequestEnvironment::variable( const char* name )
+{
+  if ( !sRequests.hasLocalData() || !sRequests.localData() )
+    return getenv( name );
+
+  // the settings of the server, like QGIS_PROJECT_FILE, may be set in the process environment
+  const QHash<QByteArray, QByteArray>& variables = sRequests.localData()->variables;
+  QHash<QByteArray, QByteArray>::const_iterator it = variables.constFind( QByteArray( name ) );
+  return it == variables.constEnd() ? getenv( name ) : it.value().constData();
+}
+
+void QgsServerRequestEnvironment::setRequest( const QMap<QString, QString>& variables, const QByteArray& body )
+{
+  QgsServerRequest* request = new QgsServerRequest;
+  QMap<QString, QString>::const_iterator it = variables.constBegin();
+  for ( ; it != variables.constEnd(); ++it )
+  {
+    request->variables.insert( it.key().toLocal8Bit(), it.value().toLocal8Bit() );
+  }
+  request->body = body;
+
+  // deletes the previous request
+  sRequests.setLocalData( request );
+}
+
+void QgsServerRequestEnvironment::clearRequest()
+{
+  sRequests.setLocalData( nullptr );
+}
+
+bool QgsServerRequestEnvironment::hasRequest()
+{
+  return sRequests.hasLocalData() && sRequests.localData();
+}
+
+QByteArray QgsServerRequestEnvironment::body()
+{
+  return hasRequest() ? sRequests.localData()->body : QByteArray();
+}
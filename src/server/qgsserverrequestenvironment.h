@@ -0,0 +1,59 @@
+/***************************************************************************
+                        qgsserverrequestenvironment.h
+  -------------------------------------------------------------------
+Date                 : October 2016
+Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSERVERREQUESTENVIRONMENT_H
+#define QGSSERVERREQUESTENVIRONMENT_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+/** \ingroup server
+ * CGI variables and body of the request processed by the calling thread.
+ *
+ * A FastCGI worker thread sets the variables of its request instead of changing the process
+ * environment, which is shared by all the threads. Threads without a request read the
+ * variables from the process environment, as in CGI and single threaded FastCGI mode, and
+ * so do the other threads for the variables missing from their request.
+ *
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class SERVER_EXPORT QgsServerRequestEnvironment
+{
+  public:
+
+    /** Returns the value of a request variable, like getenv(). Variables which are not
+     * set by the request of the thread are read from the process environment.
+     * @returns the value, valid until the request of the thread changes, or nullptr if the variable is not set
+     */
+    static const char* variable( const char* name );
+
+    /** Sets the request processed by the calling thread
+     * @param variables CGI variables of the request
+     * @param body body of the request, read by the worker
+     */
+    static void setRequest( const QMap<QString, QString>& variables, const QByteArray& body );
+
+    //! Clears the request of the calling thread, variables are read from the process environment again
+    static void clearRequest();
+
+    //! Returns true if a request has been set for the calling thread
+    static bool hasRequest();
+
+    //! Returns the body of the request of the calling thread
+    static QByteArray body();
+};
+
+#endif // QGSSERVERREQUESTENVIRONMENT_H
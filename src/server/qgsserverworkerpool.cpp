@@ -0,0 +1,143 @@
+/***************************************************************************
+                        qgsserverworkerpool.cpp
+  -------------------------------------------------------------------
+Date                 : October 2016
+Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include "qgsserverworkerpool.h"
+#include "qgsserver.h"
+#include "qgsmaplayerregistry.h"
+#include "qgsmessagelog.h"
+
+#include <QCoreApplication>
+#include <QMap>
+#include <QMutex>
+#include <QThread>
+
+#include <fcgiapp.h>
+#include <stdlib.h>
+
+///@cond PRIVATE
+
+// FCGX_Accept_r() may not be called concurrently on every platform
+static QMutex sAcceptMutex;
+
+/** \ingroup server
+ * FastCGI worker thread of QgsServerWorkerPool
+ */
+class QgsServerWorker : public QThread
+{
+  public:
+    explicit QgsServerWorker( QgsServer* server )
+        : mServer( server )
+    {}
+
+  protected:
+    virtual void run() override;
+
+  private:
+    QgsServer* mServer;
+};
+
+void QgsServerWorker::run()
+{
+  QgsServer::initRequestThread();
+
+  FCGX_Request request;
+  FCGX_InitRequest( &request, 0, 0 );
+
+  Q_FOREVER
+  {
+    int rc;
+    {
+      QMutexLocker locker( &sAcceptMutex );
+      rc = FCGX_Accept_r( &request );
+    }
+    if ( rc < 0 )
+      break;
+
+    QMap<QString, QString> environment;
+    for ( char** env = request.envp; env && *env; ++env )
+    {
+      QString variable = QString::fromLocal8Bit( *env );
+      int pos = variable.indexOf( '=' );
+      if ( pos > 0 )
+        environment.insert( variable.left( pos ), variable.mid( pos + 1 ) );
+    }
+
+    QByteArray body;
+    bool ok;
+    int length = environment.value( "CONTENT_LENGTH" ).toInt( &ok );
+    if ( ok && length > 0 )
+    {
+      body.resize( length );
+      int read = FCGX_GetStr( body.data(), length, request.in );
+      body.resize( qMax( read, 0 ) );
+    }
+
+    QPair<QByteArray, QByteArray> response = mServer->handleRequest( environment, body );
+
+    FCGX_PutStr( response.first.constData(), response.first.size(), request.out );
+    FCGX_PutStr( response.second.constData(), response.second.size(), request.out );
+    FCGX_Finish_r( &request );
+  }
+
+  FCGX_Free( &request, 1 );
+
+  // the layers of the thread must not outlive its registry
+  if ( QgsServer::supportsParallelRequests() )
+    QgsMapLayerRegistry::instance()->removeAllMapLayers();
+}
+
+///@endcond
+
+
+QgsServerWorkerPool::QgsServerWorkerPool( QgsServer* server, int threadCount )
+    : mServer( server )
+    , mThreadCount( qMax( 1, threadCount ) )
+{
+}
+
+QgsServerWorkerPool::~QgsServerWorkerPool()
+{
+  Q_FOREACH ( QgsServerWorker* worker, mWorkers )
+  {
+    worker->wait();
+    delete worker;
+  }
+}
+
+void QgsServerWorkerPool::exec()
+{
+  FCGX_Init();
+
+  QgsMessageLog::logMessage( QString( "Starting %1 FastCGI worker threads" ).arg( mThreadCount ), "Server", QgsMessageLog::INFO );
+
+  for ( int i = 0; i < mThreadCount; ++i )
+  {
+    QgsServerWorker* worker = new QgsServerWorker( mServer );
+    mWorkers << worker;
+    worker->start();
+  }
+
+  // the main thread processes the events of the configuration cache's file system watcher until the workers exit
+  Q_FOREACH ( QgsServerWorker* worker, mWorkers )
+  {
+    while ( !worker->wait( 100 ) )
+      QCoreApplication::processEvents();
+  }
+}
+
+int QgsServerWorkerPool::threadCountFromEnvironment()
+{
+  int threads = QString( getenv( "QGIS_SERVER_THREADS" ) ).toInt();
+  return qMax( 1, threads );
+}
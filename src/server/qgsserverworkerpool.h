@@ -0,0 +1,67 @@
+/***************************************************************************
+                        qgsserverworkerpool.h
+  -------------------------------------------------------------------
+Date                 : October 2016
+Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#ifndef QGSSERVERWORKERPOOL_H
+#define QGSSERVERWORKERPOOL_H
+
+#include <QList>
+
+class QgsServer;
+class QgsServerWorker;
+
+/** \ingroup server
+ * Multithreaded FastCGI front end.
+ *
+ * Each worker thread accepts FastCGI connections with its own request (FCGX_Accept_r),
+ * reads the request environment and body, processes the request with
+ * QgsServer::handleRequest() and writes the response. The workers have their own map
+ * layer registry, project, configuration and layer caches (see QgsServer::initRequestThread()),
+ * so the requests are processed in parallel. When Python plugins are loaded the workers
+ * share these objects and the requests are processed one at a time.
+ *
+ * The project files are watched from the main thread, which processes the file system
+ * events while the workers run; the workers drop what they cached from a changed file
+ * before their next request.
+ *
+ * The number of workers is read from the QGIS_SERVER_THREADS environment variable.
+ *
+ * @note added in QGIS 2.99
+ * @note not available in Python bindings
+ */
+class SERVER_EXPORT QgsServerWorkerPool
+{
+  public:
+
+    /** Constructor
+     * @param server server handling the requests
+     * @param threadCount number of FastCGI worker threads
+     */
+    QgsServerWorkerPool( QgsServer* server, int threadCount );
+    ~QgsServerWorkerPool();
+
+    /** Starts the workers and processes the events of the main thread until the FastCGI socket is closed
+     */
+    void exec();
+
+    //! Returns the number of worker threads requested by the QGIS_SERVER_THREADS environment variable, 1 if not set
+    static int threadCountFromEnvironment();
+
+  private:
+
+    QgsServer* mServer;
+    int mThreadCount;
+    QList<QgsServerWorker*> mWorkers;
+};
+
+#endif // QGSSERVERWORKERPOOL_H
@@ -15,6 +15,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgswcsserver.h"
+#include "qgsserverrequestenvironment.h"
 #include "qgswcsprojectparser.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterlayer.h"
@@ -448,11 +449,11 @@ QByteArray* QgsWCSServer::getCoverage()
 
 QString QgsWCSServer::serviceUrl() const
 {
-  QUrl mapUrl( getenv( "REQUEST_URI" ) );
-  mapUrl.setHost( getenv( "SERVER_NAME" ) );
+  QUrl mapUrl( QgsServerRequestEnvironment::variable( "REQUEST_URI" ) );
+  mapUrl.setHost( QgsServerRequestEnvironment::variable( "SERVER_NAME" ) );
 
   //Add non-default ports to url
-  QString portString = getenv( "SERVER_PORT" );
+  QString portString = QgsServerRequestEnvironment::variable( "SERVER_PORT" );
   if ( !portString.isEmpty() )
   {
     bool portOk;
@@ -466,7 +467,7 @@ QString QgsWCSServer::serviceUrl() const
     }
   }
 
-  if ( QString( getenv( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
+  if ( QString( QgsServerRequestEnvironment::variable( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
   {
     mapUrl.setScheme( "https" );
   }
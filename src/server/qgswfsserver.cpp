@@ -15,6 +15,7 @@
  *                                                                         *
  ***************************************************************************/
 #include "qgswfsserver.h"
+#include "qgsserverrequestenvironment.h"
 #include "qgsfield.h"
 #include "qgsexpression.h"
 #include "qgsfeatureiterator.h"
@@ -2077,11 +2078,11 @@ QDomElement QgsWfsServer::createFeatureGML3( QgsFeature* feat, QDomDocument& doc
 
 QString QgsWfsServer::serviceUrl() const
 {
-  QUrl mapUrl( getenv( "REQUEST_URI" ) );
-  mapUrl.setHost( getenv( "SERVER_NAME" ) );
+  QUrl mapUrl( QgsServerRequestEnvironment::variable( "REQUEST_URI" ) );
+  mapUrl.setHost( QgsServerRequestEnvironment::variable( "SERVER_NAME" ) );
 
   //Add non-default ports to url
-  QString portString = getenv( "SERVER_PORT" );
+  QString portString = QgsServerRequestEnvironment::variable( "SERVER_PORT" );
   if ( !portString.isEmpty() )
   {
     bool portOk;
@@ -2095,7 +2096,7 @@ QString QgsWfsServer::serviceUrl() const
     }
   }
 
-  if ( QString( getenv( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
+  if ( QString( QgsServerRequestEnvironment::variable( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
   {
     mapUrl.setScheme( "https" );
   }
@@ -16,6 +16,7 @@
  ***************************************************************************/
 
 #include "qgswmsserver.h"
+#include "qgsserverrequestenvironment.h"
 #include "qgscapabilitiescache.h"
 #include "qgscsexception.h"
 #include "qgsdxfexport.h"
@@ -161,7 +162,7 @@ void QgsWmsServer::executeRequest()
   {
     QStringList cacheKeyList;
     cacheKeyList << ( getProjectSettings ? "projectSettings" : version );
-    cacheKeyList << getenv( "SERVER_NAME" );
+    cacheKeyList << QgsServerRequestEnvironment::variable( "SERVER_NAME" );
     bool cache = true;
 #ifdef HAVE_SERVER_PYTHON_PLUGINS
     cache = mAccessControl->fillCacheKey( cacheKeyList );
@@ -513,7 +514,7 @@ QDomDocument QgsWmsServer::getCapabilities( QString version, bool fullProjectInf
   QDomElement postResourceElement = doc.createElement( "OnlineResource"/*wms:OnlineResource*/ );
   postResourceElement.setAttribute( "xmlns:xlink", "http://www.w3.org/1999/xlink" );
   postResourceElement.setAttribute( "xlink:type", "simple" );
-  postResourceElement.setAttribute( "xlink:href", "http://" + QString( getenv( "SERVER_NAME" ) ) + QString( getenv( "REQUEST_URI" ) ) );
+  postResourceElement.setAttribute( "xlink:href", "http://" + QString( QgsServerRequestEnvironment::variable( "SERVER_NAME" ) ) + QString( QgsServerRequestEnvironment::variable( "REQUEST_URI" ) ) );
   postElement.appendChild( postResourceElement );
   dcpTypeElement.appendChild( postElement );
 #endif
@@ -2990,18 +2991,18 @@ bool QgsWmsServer::checkMaximumWidthHeight() const
 
 QString QgsWmsServer::serviceUrl() const
 {
-  QString requestUri = getenv( "REQUEST_URI" );
+  QString requestUri = QgsServerRequestEnvironment::variable( "REQUEST_URI" );
   if ( requestUri.isEmpty() )
   {
     // in some cases (e.g. when running through python's CGIHTTPServer) the REQUEST_URI is not defined
-    requestUri = QString( getenv( "SCRIPT_NAME" ) ) + "?" + QString( getenv( "QUERY_STRING" ) );
+    requestUri = QString( QgsServerRequestEnvironment::variable( "SCRIPT_NAME" ) ) + "?" + QString( QgsServerRequestEnvironment::variable( "QUERY_STRING" ) );
   }
 
   QUrl mapUrl( requestUri );
-  mapUrl.setHost( getenv( "SERVER_NAME" ) );
+  mapUrl.setHost( QgsServerRequestEnvironment::variable( "SERVER_NAME" ) );
 
   //Add non-default ports to url
-  QString portString = getenv( "SERVER_PORT" );
+  QString portString = QgsServerRequestEnvironment::variable( "SERVER_PORT" );
   if ( !portString.isEmpty() )
   {
     bool portOk;
@@ -3015,7 +3016,7 @@ QString QgsWmsServer::serviceUrl() const
     }
   }
 
-  if ( QString( getenv( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
+  if ( QString( QgsServerRequestEnvironment::variable( "HTTPS" ) ).compare( "on", Qt::CaseInsensitive ) == 0 )
   {
     mapUrl.setScheme( "https" );
   }
@@ -0,0 +1,277 @@
+/***************************************************************************
+     testqgsinterpolator.cpp
+     --------------------------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QtTest/QtTest>
+
+#include <algorithm>
+#include <cmath>
+
+#include "qgsapplication.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+#include "qgsgridfilewriter.h"
+#include "qgsidwinterpolator.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+/** \ingroup UnitTests
+ * This is a unit test for the IDW interpolator and the grid file writer
+ */
+class TestQgsInterpolator : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsInterpolator();
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init() {}
+    void cleanup() {}
+
+    void idwMaxPoints();
+    void idwSearchRadius();
+    void idwMaxPointsAndSearchRadius();
+    void idwPrepare();
+    void gridFileWriter();
+    void gridFileWriterWithoutColumns();
+
+  private:
+
+    /** Interpolates with a brute force search of the nearest points
+     * @returns false if there is no point in the search radius
+     */
+    bool bruteForceIdw( double x, double y, int maxPoints, double searchRadius, double& result ) const;
+
+    /** Compares the interpolator with the brute force result on a grid of locations
+     * @param prepare true to prepare the interpolator before the first interpolated location
+     */
+    void compareIdw( int maxPoints, double searchRadius, bool prepare = false );
+
+    QgsVectorLayer* mPointLayer;
+    QList<QgsPoint> mPoints;
+    QList<double> mValues;
+};
+
+TestQgsInterpolator::TestQgsInterpolator()
+    : mPointLayer( nullptr )
+{
+
+}
+
+void TestQgsInterpolator::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  QgsApplication::showSettings();
+
+  mPointLayer = new QgsVectorLayer( "Point?field=value:double", "points", "memory" );
+  QVERIFY( mPointLayer->isValid() );
+
+  // scattered points with distinct distances to the tested locations
+  qsrand( 1 );
+  QgsFeatureList features;
+  for ( int i = 0; i < 500; ++i )
+  {
+    QgsPoint point( 100.0 * qrand() / RAND_MAX, 100.0 * qrand() / RAND_MAX );
+    double value = 1000.0 * qrand() / RAND_MAX;
+    mPoints << point;
+    mValues << value;
+
+    QgsFeature feature( mPointLayer->fields() );
+    feature.setGeometry( QgsGeometry::fromPoint( point ) );
+    feature.setAttribute( 0, value );
+    features << feature;
+  }
+  QVERIFY( mPointLayer->dataProvider()->addFeatures( features ) );
+}
+
+void TestQgsInterpolator::cleanupTestCase()
+{
+  delete mPointLayer;
+  QgsApplication::exitQgis();
+}
+
+bool TestQgsInterpolator::bruteForceIdw( double x, double y, int maxPoints, double searchRadius, double& result ) const
+{
+  QList< QPair<double, double> > neighbors;
+  for ( int i = 0; i < mPoints.size(); ++i )
+  {
+    double sqrDist = mPoints.at( i ).sqrDist( x, y );
+    if ( searchRadius <= 0 || sqrDist <= searchRadius * searchRadius )
+      neighbors << qMakePair( sqrDist, mValues.at( i ) );
+  }
+  std::sort( neighbors.begin(), neighbors.end() );
+  if ( maxPoints > 0 && neighbors.size() > maxPoints )
+    neighbors = neighbors.mid( 0, maxPoints );
+  if ( neighbors.isEmpty() )
+    return false;
+
+  double sumCounter = 0;
+  double sumDenominator = 0;
+  for ( int i = 0; i < neighbors.size(); ++i )
+  {
+    double weight = 1.0 / neighbors.at( i ).first;
+    sumCounter += weight * neighbors.at( i ).second;
+    sumDenominator += weight;
+  }
+  result = sumCounter / sumDenominator;
+  return true;
+}
+
+void TestQgsInterpolator::compareIdw( int maxPoints, double searchRadius, bool prepare )
+{
+  QgsInterpolator::LayerData layerData;
+  layerData.vectorLayer = mPointLayer;
+  layerData.zCoordInterpolation = false;
+  layerData.interpolationAttribute = 0;
+  layerData.mInputType = QgsInterpolator::POINTS;
+
+  QgsIDWInterpolator interpolator( QList<QgsInterpolator::LayerData>() << layerData );
+  interpolator.setMaxPoints( maxPoints );
+  interpolator.setSearchRadius( searchRadius );
+  if ( prepare )
+    QCOMPARE( interpolator.prepare(), 0 );
+
+  int withoutValue = 0;
+  for ( double y = -10.25; y < 110; y += 2.5 )
+  {
+    for ( double x = -10.25; x < 110; x += 2.5 )
+    {
+      double expected = 0;
+      bool hasValue = bruteForceIdw( x, y, maxPoints, searchRadius, expected );
+      double result = 0;
+      QCOMPARE( interpolator.interpolatePoint( x, y, result ) == 0, hasValue );
+      if ( hasValue )
+        QVERIFY( qAbs( result - expected ) <= 1e-9 * qMax( 1.0, qAbs( expected ) ) );
+      else
+        ++withoutValue;
+    }
+  }
+
+  // the locations outside of the points have no value with a search radius
+  QCOMPARE( withoutValue > 0, searchRadius > 0 );
+}
+
+void TestQgsInterpolator::idwMaxPoints()
+{
+  compareIdw( 1, 0 );
+  compareIdw( 12, 0 );
+}
+
+void TestQgsInterpolator::idwSearchRadius()
+{
+  compareIdw( 0, 5 );
+}
+
+void TestQgsInterpolator::idwMaxPointsAndSearchRadius()
+{
+  compareIdw( 8, 7.5 );
+}
+
+void TestQgsInterpolator::idwPrepare()
+{
+  // nothing can be cached without layers
+  QgsIDWInterpolator empty( QList<QgsInterpolator::LayerData>() );
+  QVERIFY( empty.prepare() != 0 );
+
+  compareIdw( 0, 0, true );
+  compareIdw( 8, 7.5, true );
+}
+
+void TestQgsInterpolator::gridFileWriter()
+{
+  QgsInterpolator::LayerData layerData;
+  layerData.vectorLayer = mPointLayer;
+  layerData.zCoordInterpolation = false;
+  layerData.interpolationAttribute = 0;
+  layerData.mInputType = QgsInterpolator::POINTS;
+
+  QgsIDWInterpolator interpolator( QList<QgsInterpolator::LayerData>() << layerData );
+  interpolator.setMaxPoints( 10 );
+  interpolator.setSearchRadius( 10 );
+  QVERIFY( interpolator.isThreadSafe() );
+
+  const int nCols = 40;
+  const int nRows = 50;
+  const double cellSize = 3;
+  QgsRectangle extent( -10, -20, -10 + nCols * cellSize, -20 + nRows * cellSize );
+
+  // the rows are interpolated in parallel, the grid must match the values interpolated one by one
+  QString fileName = QDir::tempPath() + "/idw_grid.asc";
+  QgsGridFileWriter writer( &interpolator, fileName, extent, nCols, nRows, cellSize, cellSize );
+  QCOMPARE( writer.writeFile(), 0 );
+
+  QFile file( fileName );
+  QVERIFY( file.open( QIODevice::ReadOnly | QIODevice::Text ) );
+  QTextStream stream( &file );
+  QStringList header;
+  for ( int i = 0; i < 6; ++i )
+    header << stream.readLine();
+  QCOMPARE( header.at( 0 ), QString( "NCOLS 40" ) );
+  QCOMPARE( header.at( 1 ), QString( "NROWS 50" ) );
+  QCOMPARE( header.at( 5 ), QString( "NODATA_VALUE -9999" ) );
+
+  int noData = 0;
+  for ( int row = 0; row < nRows; ++row )
+  {
+    QStringList values = stream.readLine().split( ' ', QString::SkipEmptyParts );
+    QCOMPARE( values.size(), nCols );
+    double y = extent.yMaximum() - cellSize / 2.0 - row * cellSize;
+    for ( int col = 0; col < nCols; ++col )
+    {
+      double x = extent.xMinimum() + cellSize / 2.0 + col * cellSize;
+      double expected = 0;
+      if ( interpolator.interpolatePoint( x, y, expected ) != 0 )
+      {
+        QCOMPARE( values.at( col ), QString( "-9999" ) );
+        ++noData;
+      }
+      else
+      {
+        QVERIFY( qAbs( values.at( col ).toDouble() - expected ) <= 1e-5 * qMax( 1.0, qAbs( expected ) ) );
+      }
+    }
+  }
+  QVERIFY( noData > 0 );
+}
+
+void TestQgsInterpolator::gridFileWriterWithoutColumns()
+{
+  QgsInterpolator::LayerData layerData;
+  layerData.vectorLayer = mPointLayer;
+  layerData.zCoordInterpolation = false;
+  layerData.interpolationAttribute = 0;
+  layerData.mInputType = QgsInterpolator::POINTS;
+
+  QgsIDWInterpolator interpolator( QList<QgsInterpolator::LayerData>() << layerData );
+  interpolator.setMaxPoints( 10 );
+
+  QString fileName = QDir::tempPath() + "/idw_grid_empty.asc";
+  QgsGridFileWriter writer( &interpolator, fileName, QgsRectangle( 0, 0, 0, 15 ), 0, 5, 3, 3 );
+  QCOMPARE( writer.writeFile(), 0 );
+
+  QFile file( fileName );
+  QVERIFY( file.open( QIODevice::ReadOnly | QIODevice::Text ) );
+  QTextStream stream( &file );
+  QCOMPARE( stream.readLine(), QString( "NCOLS 0" ) );
+  QCOMPARE( stream.readLine(), QString( "NROWS 5" ) );
+}
+
+QTEST_MAIN( TestQgsInterpolator )
+#include "testqgsinterpolator.moc"
@@ -0,0 +1,292 @@
+/***************************************************************************
+     testqgsnetworkanalysis.cpp
+     --------------------------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by the QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QtTest/QtTest>
+
+#include <cmath>
+#include <limits>
+
+#include "qgsapplication.h"
+#include "qgscontractionhierarchy.h"
+#include "qgsdistancearcproperter.h"
+#include "qgsfeature.h"
+#include "qgsgeometry.h"
+#include "qgsgraph.h"
+#include "qgsgraphanalyzer.h"
+#include "qgsgraphbuilder.h"
+#include "qgslinevectorlayerdirector.h"
+#include "qgsvectordataprovider.h"
+#include "qgsvectorlayer.h"
+
+/** \ingroup UnitTests
+ * This is a unit test for the network analysis library
+ */
+class TestQgsNetworkAnalysis : public QObject
+{
+    Q_OBJECT
+
+  public:
+    TestQgsNetworkAnalysis();
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void init() {}
+    void cleanup() {}
+
+    void tiePointsOnSegmentsWithSameStart();
+    void contractionHierarchyMatchesDijkstra();
+    void contractionHierarchyFile();
+
+  private:
+
+    //! Creates a layer with a line feature for each polyline
+    QgsVectorLayer* createLineLayer( const QList<QgsPolyline>& lines ) const;
+
+    //! Builds the graph of a layer, with the distance as the first arc property
+    QgsGraph* buildGraph( QgsVectorLayer* layer, const QVector<QgsPoint>& additionalPoints, QVector<QgsPoint>& tiedPoints ) const;
+
+    //! Creates a grid graph with random arc costs, some arcs only go one way
+    QgsGraph* createGridGraph( int size ) const;
+
+    //! Compares the hierarchy with Dijkstra for paths from a few start vertices
+    void compareWithDijkstra( const QgsGraph* graph, const QgsContractionHierarchy& hierarchy ) const;
+};
+
+TestQgsNetworkAnalysis::TestQgsNetworkAnalysis()
+{
+
+}
+
+void TestQgsNetworkAnalysis::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  QgsApplication::showSettings();
+}
+
+void TestQgsNetworkAnalysis::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+QgsVectorLayer* TestQgsNetworkAnalysis::createLineLayer( const QList<QgsPolyline>& lines ) const
+{
+  QgsVectorLayer* layer = new QgsVectorLayer( "LineString?crs=epsg:3857", "lines", "memory" );
+  QgsFeatureList features;
+  Q_FOREACH ( const QgsPolyline& line, lines )
+  {
+    QgsFeature feature( layer->fields() );
+    feature.setGeometry( QgsGeometry::fromPolyline( line ) );
+    features << feature;
+  }
+  layer->dataProvider()->addFeatures( features );
+  return layer;
+}
+
+QgsGraph* TestQgsNetworkAnalysis::buildGraph( QgsVectorLayer* layer, const QVector<QgsPoint>& additionalPoints, QVector<QgsPoint>& tiedPoints ) const
+{
+  // arcs in both directions
+  QgsLineVectorLayerDirector director( layer, -1, QString(), QString(), QString(), 3 );
+  director.addProperter( new QgsDistanceArcProperter() );
+  QgsGraphBuilder builder( layer->crs(), false );
+  director.makeGraph( &builder, additionalPoints, tiedPoints );
+  return builder.graph();
+}
+
+void TestQgsNetworkAnalysis::tiePointsOnSegmentsWithSameStart()
+{
+  // two segments starting at the origin, a point is tied to each of them
+  QList<QgsPolyline> lines;
+  lines << ( QgsPolyline() << QgsPoint( 0, 0 ) << QgsPoint( 10, 0 ) );
+  lines << ( QgsPolyline() << QgsPoint( 0, 0 ) << QgsPoint( 0, 10 ) );
+  QScopedPointer<QgsVectorLayer> layer( createLineLayer( lines ) );
+  QVERIFY( layer->isValid() );
+
+  QVector<QgsPoint> additionalPoints;
+  additionalPoints << QgsPoint( 5, 1 ) << QgsPoint( 1, 6 );
+  QVector<QgsPoint> tiedPoints;
+  QScopedPointer<QgsGraph> graph( buildGraph( layer.data(), additionalPoints, tiedPoints ) );
+  QVERIFY( !graph.isNull() );
+
+  QCOMPARE( tiedPoints.size(), 2 );
+  QVERIFY( tiedPoints.at( 0 ) == QgsPoint( 5, 0 ) );
+  QVERIFY( tiedPoints.at( 1 ) == QgsPoint( 0, 6 ) );
+
+  // each segment is split at its own tied point only
+  QCOMPARE( graph->vertexCount(), 5 );
+  QCOMPARE( graph->arcCount(), 8 );
+  for ( int i = 0; i < graph->arcCount(); ++i )
+  {
+    const QgsGraphArc& arc = graph->arc( i );
+    QgsPoint out = graph->vertex( arc.outVertex() ).point();
+    QgsPoint in = graph->vertex( arc.inVertex() ).point();
+    QVERIFY(( out.x() == 0 && in.x() == 0 ) || ( out.y() == 0 && in.y() == 0 ) );
+    QCOMPARE( arc.property( 0 ).toDouble(), sqrt( out.sqrDist( in ) ) );
+  }
+
+  int tied = graph->findVertex( QgsPoint( 5, 0 ) );
+  QVERIFY( tied != -1 );
+  QCOMPARE( graph->vertex( tied ).outArc().size(), 2 );
+  tied = graph->findVertex( QgsPoint( 0, 6 ) );
+  QVERIFY( tied != -1 );
+  QCOMPARE( graph->vertex( tied ).outArc().size(), 2 );
+}
+
+QgsGraph* TestQgsNetworkAnalysis::createGridGraph( int size ) const
+{
+  QgsGraph* graph = new QgsGraph();
+  for ( int y = 0; y < size; ++y )
+  {
+    for ( int x = 0; x < size; ++x )
+      graph->addVertex( QgsPoint( x, y ) );
+  }
+
+  qsrand( 1 );
+  for ( int y = 0; y < size; ++y )
+  {
+    for ( int x = 0; x < size; ++x )
+    {
+      int vertex = y * size + x;
+      QList<int> neighbours;
+      if ( x + 1 < size )
+        neighbours << vertex + 1;
+      if ( y + 1 < size )
+        neighbours << vertex + size;
+      Q_FOREACH ( int neighbour, neighbours )
+      {
+        double cost = 1.0 + 9.0 * qrand() / RAND_MAX;
+        graph->addArc( vertex, neighbour, QVector<QVariant>() << cost );
+        if ( qrand() % 5 != 0 )
+          graph->addArc( neighbour, vertex, QVector<QVariant>() << 1.0 + 9.0 * qrand() / RAND_MAX );
+      }
+    }
+  }
+  return graph;
+}
+
+void TestQgsNetworkAnalysis::compareWithDijkstra( const QgsGraph* graph, const QgsContractionHierarchy& hierarchy ) const
+{
+  QVector<int> allVertices;
+  for ( int i = 0; i < graph->vertexCount(); ++i )
+    allVertices << i;
+
+  for ( int start = 0; start < graph->vertexCount(); start += 37 )
+  {
+    QVector<double> dijkstraCost;
+    QgsGraphAnalyzer::dijkstra( graph, start, 0, nullptr, &dijkstraCost );
+
+    QVector<double> costs = hierarchy.costs( start, allVertices );
+    QCOMPARE( costs.size(), graph->vertexCount() );
+
+    for ( int end = 0; end < graph->vertexCount(); ++end )
+    {
+      double cost = 0;
+      QgsGraphArcIdList path = hierarchy.shortestPath( start, end, &cost );
+      if ( dijkstraCost.at( end ) == std::numeric_limits<double>::infinity() )
+      {
+        QVERIFY( path.isEmpty() );
+        QCOMPARE( cost, std::numeric_limits<double>::infinity() );
+        QCOMPARE( costs.at( end ), std::numeric_limits<double>::infinity() );
+        continue;
+      }
+
+      QVERIFY( qAbs( cost - dijkstraCost.at( end ) ) < 1e-9 );
+      QVERIFY( qAbs( costs.at( end ) - dijkstraCost.at( end ) ) < 1e-9 );
+
+      // the path follows arcs of the graph from start to end and costs as much as Dijkstra's
+      int vertex = start;
+      double pathCost = 0;
+      Q_FOREACH ( int arcIdx, path )
+      {
+        const QgsGraphArc& arc = graph->arc( arcIdx );
+        QCOMPARE( arc.outVertex(), vertex );
+        pathCost += arc.property( 0 ).toDouble();
+        vertex = arc.inVertex();
+      }
+      QCOMPARE( vertex, end );
+      QVERIFY( qAbs( pathCost - dijkstraCost.at( end ) ) < 1e-9 );
+    }
+  }
+}
+
+void TestQgsNetworkAnalysis::contractionHierarchyMatchesDijkstra()
+{
+  QScopedPointer<QgsGraph> graph( createGridGraph( 15 ) );
+  QgsContractionHierarchy hierarchy( graph.data(), 0 );
+  QVERIFY( hierarchy.isValid() );
+  QCOMPARE( hierarchy.vertexCount(), graph->vertexCount() );
+  QCOMPARE( hierarchy.sourceArcCount(), graph->arcCount() );
+
+  compareWithDijkstra( graph.data(), hierarchy );
+}
+
+void TestQgsNetworkAnalysis::contractionHierarchyFile()
+{
+  QScopedPointer<QgsGraph> graph( createGridGraph( 10 ) );
+  QgsContractionHierarchy hierarchy( graph.data(), 0 );
+  QVERIFY( hierarchy.isValid() );
+
+  QString fileName = QDir::tempPath() + "/network.ch";
+  QVERIFY( hierarchy.writeToFile( fileName ) );
+
+  QgsContractionHierarchy readHierarchy;
+  QVERIFY( !readHierarchy.isValid() );
+  QVERIFY( readHierarchy.readFromFile( fileName ) );
+  QCOMPARE( readHierarchy.vertexCount(), graph->vertexCount() );
+  QCOMPARE( readHierarchy.sourceArcCount(), graph->arcCount() );
+  compareWithDijkstra( graph.data(), readHierarchy );
+
+  // a file whose arrays have the right sizes but point to missing arcs is rejected
+  QFile file( fileName );
+  QVERIFY( file.open( QIODevice::ReadOnly ) );
+  QDataStream in( &file );
+  in.setVersion( QDataStream::Qt_4_8 );
+  quint32 magic, version;
+  qint32 sourceArcCount;
+  QVector<int> rank, arcTail, arcHead, arcSourceId, arcFirst, arcSecond, upOffsets, upArcs, downOffsets, downArcs;
+  QVector<double> arcCost;
+  in >> magic >> version >> sourceArcCount;
+  in >> rank >> arcTail >> arcHead >> arcCost >> arcSourceId >> arcFirst >> arcSecond;
+  in >> upOffsets >> upArcs >> downOffsets >> downArcs;
+  QCOMPARE( in.status(), QDataStream::Ok );
+  file.close();
+
+  QVERIFY( !upArcs.isEmpty() );
+  upArcs[ upArcs.size() / 2 ] = arcTail.size();
+
+  QVERIFY( file.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+  QDataStream out( &file );
+  out.setVersion( QDataStream::Qt_4_8 );
+  out << magic << version << sourceArcCount;
+  out << rank << arcTail << arcHead << arcCost << arcSourceId << arcFirst << arcSecond;
+  out << upOffsets << upArcs << downOffsets << downArcs;
+  file.close();
+
+  QVERIFY( !readHierarchy.readFromFile( fileName ) );
+  QVERIFY( !readHierarchy.isValid() );
+
+  // as well as a truncated file
+  QVERIFY( hierarchy.writeToFile( fileName ) );
+  QVERIFY( file.open( QIODevice::ReadWrite ) );
+  QVERIFY( file.resize( file.size() / 2 ) );
+  file.close();
+  QVERIFY( !readHierarchy.readFromFile( fileName ) );
+}
+
+QTEST_MAIN( TestQgsNetworkAnalysis )
+#include "testqgsnetworkanalysis.moc"
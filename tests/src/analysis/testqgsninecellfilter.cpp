@@ -0,0 +1,168 @@
+/***************************************************************************
+     testqgsninecellfilter.cpp
+     --------------------------------------
+    Date                 : October 2016
+    Copyright            : (C) 2016 by QGIS Development Team
+ ***************************************************************************
+ *                                                                         *
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ ***************************************************************************/
+
+#include <QDir>
+#include <QVector>
+#include <QtTest/QtTest>
+
+#include "qgis.h"
+#include "qgsapplication.h"
+#include "qgsaspectfilter.h"
+#include "qgshillshadefilter.h"
+#include "qgsruggednessfilter.h"
+#include "qgsslopefilter.h"
+#include "qgstotalcurvaturefilter.h"
+
+#include <gdal.h>
+
+static const float NODATA = -9999;
+
+/** \ingroup UnitTests
+ * This is a unit test for the nine cell filters
+ */
+class TestQgsNineCellFilter : public QObject
+{
+    Q_OBJECT
+
+  private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testRowMatchesWindow();
+    void testSlope();
+    void testAspect();
+
+  private:
+    QString mDataPath;
+
+    void checkRow( QgsNineCellFilter& filter, const QString& name );
+    bool readRaster( const QString& fileName, QVector<float>& values, int& xSize, int& ySize );
+    void checkRaster( QgsNineCellFilter& filter, const QString& outputFile, const QString& referenceFile );
+};
+
+void TestQgsNineCellFilter::initTestCase()
+{
+  QgsApplication::init();
+  QgsApplication::initQgis();
+  GDALAllRegister();
+
+  mDataPath = QString( TEST_DATA_DIR ) + "/ninecellfilter/"; //defined in CmakeLists.txt
+}
+
+void TestQgsNineCellFilter::cleanupTestCase()
+{
+  QgsApplication::exitQgis();
+}
+
+void TestQgsNineCellFilter::checkRow( QgsNineCellFilter& filter, const QString& name )
+{
+  filter.setCellSizeX( 10 );
+  filter.setCellSizeY( 10 );
+  filter.setInputNodataValue( NODATA );
+  filter.setOutputNodataValue( NODATA );
+
+  // the rows hold one value on each side of the cells, the first row is the one above the raster
+  const int count = 6;
+  float values[4][count + 2] =
+  {
+    { NODATA, NODATA, NODATA, NODATA, NODATA, NODATA, NODATA, NODATA },
+    { NODATA, 102.5, 104.0, 107.5, 111.0, 113.5, 114.0, NODATA },
+    { NODATA, 101.0, NODATA, 108.0, 112.5, 116.0, 117.5, NODATA },
+    { NODATA, 99.5, 102.0, 106.5, NODATA, NODATA, 119.5, NODATA },
+  };
+
+  for ( int i = 0; i < 2; ++i )
+  {
+    float* x1 = values[i];
+    float* x2 = values[i + 1];
+    float* x3 = values[i + 2];
+
+    float result[count];
+    filter.processNineCellRow( x1, x2, x3, result, count );
+
+    for ( int j = 0; j < count; ++j )
+    {
+      float expected = filter.processNineCellWindow( &x1[j], &x1[j+1], &x1[j+2], &x2[j], &x2[j+1], &x2[j+2], &x3[j], &x3[j+1], &x3[j+2] );
+      QVERIFY2( qgsDoubleNear( result[j], expected, 1e-4 ),
+                QString( "%1 row %2 cell %3: %4 instead of %5" ).arg( name ).arg( i ).arg( j ).arg( result[j] ).arg( expected ).toLocal8Bit().constData() );
+    }
+  }
+}
+
+void TestQgsNineCellFilter::testRowMatchesWindow()
+{
+  QgsSlopeFilter slope( QString(), QString(), QString() );
+  checkRow( slope, "slope" );
+  QgsAspectFilter aspect( QString(), QString(), QString() );
+  checkRow( aspect, "aspect" );
+  QgsHillshadeFilter hillshade( QString(), QString(), QString() );
+  checkRow( hillshade, "hillshade" );
+  QgsRuggednessFilter ruggedness( QString(), QString(), QString() );
+  checkRow( ruggedness, "ruggedness" );
+  QgsTotalCurvatureFilter curvature( QString(), QString(), QString() );
+  checkRow( curvature, "total curvature" );
+}
+
+bool TestQgsNineCellFilter::readRaster( const QString& fileName, QVector<float>& values, int& xSize, int& ySize )
+{
+  GDALDatasetH dataset = GDALOpen( fileName.toUtf8().constData(), GA_ReadOnly );
+  if ( !dataset )
+    return false;
+
+  xSize = GDALGetRasterXSize( dataset );
+  ySize = GDALGetRasterYSize( dataset );
+  values.resize( xSize * ySize );
+  bool ok = GDALRasterIO( GDALGetRasterBand( dataset, 1 ), GF_Read, 0, 0, xSize, ySize, values.data(), xSize, ySize, GDT_Float32, 0, 0 ) == CE_None;
+  GDALClose( dataset );
+  return ok;
+}
+
+void TestQgsNineCellFilter::checkRaster( QgsNineCellFilter& filter, const QString& outputFile, const QString& referenceFile )
+{
+  QCOMPARE( filter.processRaster( nullptr ), 0 );
+
+  QVector<float> output;
+  QVector<float> reference;
+  int xSize, ySize, refXSize, refYSize;
+  QVERIFY( readRaster( outputFile, output, xSize, ySize ) );
+  QVERIFY( readRaster( mDataPath + referenceFile, reference, refXSize, refYSize ) );
+  QCOMPARE( xSize, refXSize );
+  QCOMPARE( ySize, refYSize );
+
+  // the borders and the cells next to the nodata cell are computed from fewer neighbours
+  for ( int i = 0; i < output.size(); ++i )
+  {
+    QVERIFY2( qgsDoubleNear( output.at( i ), reference.at( i ), 1e-3 ),
+              QString( "cell %1, %2: %3 instead of %4" ).arg( i % xSize ).arg( i / xSize ).arg( output.at( i ) ).arg( reference.at( i ) ).toLocal8Bit().constData() );
+  }
+
+  QFile::remove( outputFile );
+}
+
+void TestQgsNineCellFilter::testSlope()
+{
+  QString outputFile = QDir::tempPath() + "/ninecellfilter_slope.tif";
+  QgsSlopeFilter slope( mDataPath + "dem.asc", outputFile, "GTiff" );
+  checkRaster( slope, outputFile, "slope.asc" );
+}
+
+void TestQgsNineCellFilter::testAspect()
+{
+  QString outputFile = QDir::tempPath() + "/ninecellfilter_aspect.tif";
+  QgsAspectFilter aspect( mDataPath + "dem.asc", outputFile, "GTiff" );
+  checkRaster( aspect, outputFile, "aspect.asc" );
+}
+
+QTEST_MAIN( TestQgsNineCellFilter )
+#include "testqgsninecellfilter.moc"
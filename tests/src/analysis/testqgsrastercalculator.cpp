@@ -15,6 +15,7 @@ Email                : nyall dot dawson at gmail dot com
 #include <QtTest/QtTest>
 
 #include "qgsrastercalculator.h"
+#include "qgsrastercalckernel.h"
 #include "qgsrastercalcnode.h"
 #include "qgsrasterdataprovider.h"
 #include "qgsrasterlayer.h"
@@ -54,6 +55,7 @@ class TestQgsRasterCalculator : public QObject
 
     void rasterRefOp();
     void dualOpRasterRaster(); //test dual op on raster ref and raster ref
+    void compiledKernel(); //test evaluation of a compiled expression
 
     void calcWithLayers();
     void calcWithReprojectedLayers();
@@ -418,6 +420,31 @@ void TestQgsRasterCalculator::dualOpRasterRaster()
   QCOMPARE( result.data()[5], -9999.0 );
 }
 
+void TestQgsRasterCalculator::compiledKernel()
+{
+  QString error;
+  QgsRasterCalcNode* node = QgsRasterCalcNode::parseRasterCalcString( QString( "\"a@1\" * 2 + sqrt( \"b@1\" ) - ( \"a@1\" / \"b@1\" )" ), error );
+  QVERIFY( node );
+
+  QgsRasterCalcKernel kernel( node, QStringList() << "a@1" << "b@1", -9999.0 );
+  QVERIFY( kernel.isValid() );
+
+  double a[] = { 1.0, 4.0, -9999.0, 9.0 };
+  double b[] = { 4.0, 0.0, 1.0, -1.0 };
+  const double* inputs[] = { a, b };
+  QVector<double> scratch( kernel.scratchSize() );
+  const double* result = kernel.evaluate( inputs, 4, scratch.data() );
+  QCOMPARE( result[0], 3.75 );
+  QCOMPARE( result[1], -9999.0 ); //division by zero
+  QCOMPARE( result[2], -9999.0 ); //nodata input
+  QCOMPARE( result[3], -9999.0 ); //square root of negative number
+
+  //unknown raster
+  QgsRasterCalcKernel invalidKernel( node, QStringList() << "a@1", -9999.0 );
+  QVERIFY( !invalidKernel.isValid() );
+  delete node;
+}
+
 void TestQgsRasterCalculator::calcWithLayers()
 {
   QgsRasterCalculatorEntry entry1;
@@ -16,8 +16,12 @@ Email                : sherman at mrcc dot com
 
 //header for class being tested
 #include <qgsgeometryanalyzer.h>
+#include <qgsoverlayanalyzer.h>
 #include <qgsapplication.h>
 #include <qgsproviderregistry.h>
+#include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
+#include "qgsvectordataprovider.h"
 #include "qgsvectorlayer.h"
 
 class TestQgsVectorAnalyzer : public QObject
@@ -45,6 +49,9 @@ class TestQgsVectorAnalyzer : public QObject
     void simplifyGeometry();
     void polygonCentroids();
     void layerExtent();
+    void dissolve();
+    void bufferDissolve();
+    void intersection();
   private:
     QgsGeometryAnalyzer mAnalyzer;
     QgsVectorLayer * mpLineLayer;
@@ -141,5 +148,94 @@ void TestQgsVectorAnalyzer::layerExtent()
   QVERIFY( mAnalyzer.extent( mpPointLayer, myFileName ) );
 }
 
+void TestQgsVectorAnalyzer::dissolve()
+{
+  QString myTmpDir = QDir::tempPath() + '/';
+  QString myFileName = myTmpDir +  "dissolve_layer.shp";
+  QVERIFY( mAnalyzer.dissolve( mpPolyLayer, myFileName, false, mpPolyLayer->fields().indexFromName( "Name" ) ) );
+
+  //one feature for the lakes, one for the dams
+  QgsVectorLayer dissolveLayer( myFileName, "dissolve", "ogr" );
+  QVERIFY( dissolveLayer.isValid() );
+  QCOMPARE( dissolveLayer.featureCount(), 2L );
+  QgsFeature feature;
+  QgsFeatureIterator fit = dissolveLayer.getFeatures();
+  while ( fit.nextFeature( feature ) )
+  {
+    QVERIFY( feature.constGeometry() && !feature.constGeometry()->isEmpty() );
+  }
+}
+
+void TestQgsVectorAnalyzer::bufferDissolve()
+{
+  QString myTmpDir = QDir::tempPath() + '/';
+  QString myFileName = myTmpDir +  "buffer_dissolve_layer.shp";
+  QVERIFY( mAnalyzer.buffer( mpPointLayer, myFileName, 1.0, false, true ) );
+
+  QgsVectorLayer bufferLayer( myFileName, "buffer", "ogr" );
+  QVERIFY( bufferLayer.isValid() );
+  QCOMPARE( bufferLayer.featureCount(), 1L );
+}
+
+void TestQgsVectorAnalyzer::intersection()
+{
+  //a grid of unit squares, more than a batch of features of the analyzer
+  QgsVectorLayer gridLayer( "Polygon?crs=epsg:3857&field=col:integer&field=row:integer", "grid", "memory" );
+  QgsFeatureList squares;
+  for ( int row = 0; row < 50; ++row )
+  {
+    for ( int col = 0; col < 50; ++col )
+    {
+      QgsFeature square( gridLayer.fields() );
+      square.setGeometry( QgsGeometry::fromRect( QgsRectangle( col, row, col + 1, row + 1 ) ) );
+      square.setAttribute( 0, col );
+      square.setAttribute( 1, row );
+      squares << square;
+    }
+  }
+  QVERIFY( gridLayer.dataProvider()->addFeatures( squares ) );
+
+  //two overlapping rectangles crossing the squares at their middle
+  QgsVectorLayer zoneLayer( "Polygon?crs=epsg:3857&field=name:string", "zones", "memory" );
+  QgsFeatureList zones;
+  QgsFeature zone( zoneLayer.fields() );
+  zone.setGeometry( QgsGeometry::fromRect( QgsRectangle( 10.5, 10.5, 20.5, 20.5 ) ) );
+  zone.setAttribute( 0, "a" );
+  zones << zone;
+  zone.setGeometry( QgsGeometry::fromRect( QgsRectangle( 15.5, 30.5, 40.5, 32.5 ) ) );
+  zone.setAttribute( 0, "b" );
+  zones << zone;
+  QVERIFY( zoneLayer.dataProvider()->addFeatures( zones ) );
+
+  QString myTmpDir = QDir::tempPath() + '/';
+  QString myFileName = myTmpDir +  "intersection_layer.shp";
+  QgsOverlayAnalyzer analyzer;
+  QVERIFY( analyzer.intersection( &gridLayer, &zoneLayer, myFileName ) );
+
+  QgsVectorLayer intersectionLayer( myFileName, "intersection", "ogr" );
+  QVERIFY( intersectionLayer.isValid() );
+  QCOMPARE( intersectionLayer.fields().count(), 3 );
+  //11 x 11 squares for a, 26 x 3 for b
+  QCOMPARE( intersectionLayer.featureCount(), 199L );
+
+  QMap<QString, double> areas;
+  QgsFeature feature;
+  QgsFeatureIterator fit = intersectionLayer.getFeatures();
+  while ( fit.nextFeature( feature ) )
+  {
+    int col = feature.attribute( 0 ).toInt();
+    int row = feature.attribute( 1 ).toInt();
+    QString name = feature.attribute( 2 ).toString();
+    QgsRectangle zoneRect = name == "a" ? QgsRectangle( 10.5, 10.5, 20.5, 20.5 ) : QgsRectangle( 15.5, 30.5, 40.5, 32.5 );
+    QgsRectangle expected = QgsRectangle( col, row, col + 1, row + 1 ).intersect( &zoneRect );
+    QVERIFY( feature.constGeometry() );
+    QVERIFY( qgsDoubleNear( feature.constGeometry()->area(), expected.width() * expected.height(), 1e-9 ) );
+    QVERIFY( feature.constGeometry()->boundingBox() == expected );
+    areas[ name ] += feature.constGeometry()->area();
+  }
+  QVERIFY( qgsDoubleNear( areas.value( "a" ), 100.0, 1e-9 ) );
+  QVERIFY( qgsDoubleNear( areas.value( "b" ), 50.0, 1e-9 ) );
+}
+
 QTEST_MAIN( TestQgsVectorAnalyzer )
 #include "testqgsvectoranalyzer.moc"
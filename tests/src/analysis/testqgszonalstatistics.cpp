@@ -18,10 +18,27 @@
 
 #include "qgsapplication.h"
 #include "qgsfeatureiterator.h"
+#include "qgsgeometry.h"
 #include "qgsvectorlayer.h"
 #include "qgszonalstatistics.h"
 #include "qgsmaplayerregistry.h"
 
+#include <gdal.h>
+
+static const float NODATA = -9999;
+
+//! Value of the cells of the rasters written by the tests, some of them are nodata
+static float cellValue( int row, int col )
+{
+  return ( row + col ) % 17 == 0 ? NODATA : ( row * 3 + col * 7 ) % 13;
+}
+
+//! Value of the cells of the large raster, without nodata
+static float bandCellValue( int row, int col )
+{
+  return row % 7 + col % 5;
+}
+
 /** \ingroup UnitTests
  * This is a unit test for the zonal statistics class
  */
@@ -39,10 +56,16 @@ class TestQgsZonalStatistics : public QObject
     void cleanup() {}
 
     void testStatistics();
+    void testPreciseCoverage();
+    void testCellCenters();
+    void testRowBands();
 
   private:
     QgsVectorLayer* mVectorLayer;
     QString mRasterPath;
+
+    //! Writes a GeoTIFF with square cells of size 1 and its upper left corner at (0, nRows)
+    bool writeRaster( const QString& path, int nCols, int nRows, float ( *value )( int, int ) );
 };
 
 TestQgsZonalStatistics::TestQgsZonalStatistics()
@@ -56,6 +79,7 @@ void TestQgsZonalStatistics::initTestCase()
   QgsApplication::init();
   QgsApplication::initQgis();
   QgsApplication::showSettings();
+  GDALAllRegister();
 
   QString myDataPath( TEST_DATA_DIR ); //defined in CmakeLists.txt
   QString myTestDataPath = myDataPath + "/zonalstatistics/";
@@ -136,5 +160,175 @@ void TestQgsZonalStatistics::testStatistics()
   QCOMPARE( f.attribute( "myqgis2_me" ).toDouble(), 0.833333333333333 );
 }
 
+void TestQgsZonalStatistics::testPreciseCoverage()
+{
+  // polygons smaller than a cell use the exact cell coverage
+  QgsVectorLayer* layer = new QgsVectorLayer( "Polygon?crs=epsg:4326", "small", "memory" );
+  QVERIFY( layer->isValid() );
+
+  // corner of the upper left cell (value 1) of the raster, away from the cell center
+  QgsFeature corner( layer->fields() );
+  corner.setGeometry( QgsGeometry::fromRect( QgsRectangle( 100.379357, -0.960473, 100.379377, -0.960453 ) ) );
+  // strip over the border of the second (value 1) and third (value 0) cells of the first row
+  QgsFeature strip( layer->fields() );
+  strip.setGeometry( QgsGeometry::fromRect( QgsRectangle( 100.379437, -0.960498, 100.379457, -0.960453 ) ) );
+  QVERIFY( layer->dataProvider()->addFeatures( QgsFeatureList() << corner << strip ) );
+
+  QgsZonalStatistics zs( layer, mRasterPath, "", 1 );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  QgsFeatureIterator it = layer->getFeatures();
+  QgsFeature f;
+  QVERIFY( it.nextFeature( f ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "count" ).toDouble(), 0.197531, 0.0001 ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "sum" ).toDouble(), 0.197531, 0.0001 ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "mean" ).toDouble(), 1.0, 0.0001 ) );
+
+  QVERIFY( it.nextFeature( f ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "count" ).toDouble(), 0.444444, 0.0001 ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "sum" ).toDouble(), 0.222222, 0.0001 ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "mean" ).toDouble(), 0.5, 0.0001 ) );
+
+  delete layer;
+}
+
+bool TestQgsZonalStatistics::writeRaster( const QString& path, int nCols, int nRows, float ( *value )( int, int ) )
+{
+  GDALDriverH driver = GDALGetDriverByName( "GTiff" );
+  if ( !driver )
+    return false;
+
+  GDALDatasetH dataset = GDALCreate( driver, path.toUtf8().constData(), nCols, nRows, 1, GDT_Float32, nullptr );
+  if ( !dataset )
+    return false;
+
+  double geoTransform[6] = { 0, 1, 0, static_cast< double >( nRows ), 0, -1 };
+  GDALSetGeoTransform( dataset, geoTransform );
+  GDALRasterBandH band = GDALGetRasterBand( dataset, 1 );
+  GDALSetRasterNoDataValue( band, NODATA );
+
+  QVector<float> row( nCols );
+  bool ok = true;
+  for ( int i = 0; i < nRows && ok; ++i )
+  {
+    for ( int j = 0; j < nCols; ++j )
+      row[j] = value( i, j );
+    ok = GDALRasterIO( band, GF_Write, 0, i, nCols, 1, row.data(), nCols, 1, GDT_Float32, 0, 0 ) == CE_None;
+  }
+  GDALClose( dataset );
+  return ok;
+}
+
+void TestQgsZonalStatistics::testCellCenters()
+{
+  // the cells whose center is in the polygon, as found before with a GEOS test of each cell center
+  const int nCols = 60;
+  const int nRows = 40;
+  QString rasterPath = QDir::tempPath() + "/zonal_cell_centers.tif";
+  QVERIFY( writeRaster( rasterPath, nCols, nRows, cellValue ) );
+
+  QStringList wkts;
+  // multipart polygon
+  wkts << "MultiPolygon (((2.2 3.1, 15.7 3.3, 14.9 17.6, 3.1 16.2, 2.2 3.1)),((30.3 20.2, 44.6 21.1, 37.7 35.4, 30.3 20.2)))";
+  // polygon with holes
+  wkts << "Polygon ((5.1 20.3, 28.7 19.4, 27.2 38.6, 4.3 37.9, 5.1 20.3),(8.3 24.1, 14.6 23.7, 13.2 30.8, 8.3 24.1),(18.4 31.2, 24.7 32.3, 21.3 36.1, 18.4 31.2))";
+  // concave polygon, partly outside of the raster
+  wkts << "Polygon ((40.2 2.3, 63.6 2.9, 57.4 15.3, 49.1 7.7, 41.6 16.8, 40.2 2.3))";
+
+  QgsVectorLayer* layer = new QgsVectorLayer( "Polygon?crs=epsg:4326", "zones", "memory" );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  Q_FOREACH ( const QString& wkt, wkts )
+  {
+    QgsFeature f( layer->fields() );
+    f.setGeometry( QgsGeometry::fromWkt( wkt ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  QgsZonalStatistics zs( layer, rasterPath, "", 1 );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  QgsFeatureIterator it = layer->getFeatures();
+  QgsFeature f;
+  int i = 0;
+  while ( it.nextFeature( f ) )
+  {
+    double count = 0;
+    double sum = 0;
+    for ( int row = 0; row < nRows; ++row )
+    {
+      for ( int col = 0; col < nCols; ++col )
+      {
+        QgsPoint center( col + 0.5, nRows - row - 0.5 );
+        float value = cellValue( row, col );
+        if ( value != NODATA && f.constGeometry()->contains( &center ) )
+        {
+          ++count;
+          sum += value;
+        }
+      }
+    }
+    QVERIFY( count > 1 );
+
+    QCOMPARE( f.attribute( "count" ).toDouble(), count );
+    QVERIFY2( qgsDoubleNear( f.attribute( "sum" ).toDouble(), sum, 1e-6 ),
+              QString( "%1: sum %2 instead of %3" ).arg( wkts.at( i ) ).arg( f.attribute( "sum" ).toDouble() ).arg( sum ).toLocal8Bit().constData() );
+    QVERIFY( qgsDoubleNear( f.attribute( "mean" ).toDouble(), sum / count, 1e-6 ) );
+    ++i;
+  }
+  QCOMPARE( i, wkts.count() );
+
+  delete layer;
+  QFile::remove( rasterPath );
+}
+
+void TestQgsZonalStatistics::testRowBands()
+{
+  // the cells of a zone larger than a batch are read and processed by bands of rows
+  const int size = 2100;
+  QString rasterPath = QDir::tempPath() + "/zonal_row_bands.tif";
+  QVERIFY( writeRaster( rasterPath, size, size, bandCellValue ) );
+
+  // the hole spans the border of the two bands, near the bottom of the raster
+  QgsRectangle outer( 10.25, 10.25, 2090.75, 2090.75 );
+  QgsRectangle hole( 500.25, 20.25, 1500.75, 200.75 );
+  QgsVectorLayer* layer = new QgsVectorLayer( "Polygon?crs=epsg:4326", "zones", "memory" );
+  QVERIFY( layer->isValid() );
+  QgsFeature zone( layer->fields() );
+  zone.setGeometry( QgsGeometry::fromWkt( QString( "Polygon ((%1 %2, %3 %2, %3 %4, %1 %4, %1 %2),(%5 %6, %7 %6, %7 %8, %5 %8, %5 %6))" )
+                                          .arg( outer.xMinimum() ).arg( outer.yMinimum() ).arg( outer.xMaximum() ).arg( outer.yMaximum() )
+                                          .arg( hole.xMinimum() ).arg( hole.yMinimum() ).arg( hole.xMaximum() ).arg( hole.yMaximum() ) ) );
+  QVERIFY( layer->dataProvider()->addFeatures( QgsFeatureList() << zone ) );
+
+  QgsZonalStatistics zs( layer, rasterPath, "", 1 );
+  QCOMPARE( zs.calculateStatistics( nullptr ), 0 );
+
+  double count = 0;
+  double sum = 0;
+  for ( int row = 0; row < size; ++row )
+  {
+    double y = size - row - 0.5;
+    for ( int col = 0; col < size; ++col )
+    {
+      double x = col + 0.5;
+      if ( outer.contains( QgsPoint( x, y ) ) && !hole.contains( QgsPoint( x, y ) ) )
+      {
+        ++count;
+        sum += bandCellValue( row, col );
+      }
+    }
+  }
+
+  QgsFeature f;
+  QVERIFY( layer->getFeatures().nextFeature( f ) );
+  QCOMPARE( f.attribute( "count" ).toDouble(), count );
+  QVERIFY( qgsDoubleNear( f.attribute( "sum" ).toDouble(), sum, 1e-3 ) );
+  QVERIFY( qgsDoubleNear( f.attribute( "mean" ).toDouble(), sum / count, 1e-9 ) );
+
+  delete layer;
+  QFile::remove( rasterPath );
+}
+
 QTEST_MAIN( TestQgsZonalStatistics )
 #include "testqgszonalstatistics.moc"
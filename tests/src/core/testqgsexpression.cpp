@@ -347,6 +347,14 @@ class TestQgsExpression: public QObject
       QgsExpressionContext context;
       Q_ASSERT( exp.prepare( &context ) );
 
+      // the compiled form must give the same result as walking the node tree
+      QgsExpression compiled( exp.expression() );
+      QVERIFY( compiled.prepare( &context ) );
+      QVariant compiledResult = compiled.evaluate( &context );
+      QCOMPARE( compiled.hasEvalError(), evalError );
+      QCOMPARE( compiledResult.type(), result.type() );
+      QCOMPARE( compiledResult.toString(), result.toString() );
+
       QVariant res = exp.evaluate();
       if ( exp.hasEvalError() )
         qDebug() << exp.evalErrorString();
@@ -1074,6 +1082,190 @@ class TestQgsExpression: public QObject
       QCOMPARE( res2.type(), QVariant::Invalid );
     }
 
+    void eval_compiled_data()
+    {
+      QTest::addColumn<QString>( "string" );
+      QTest::addColumn<bool>( "compiled" );
+      QTest::addColumn<QVariant>( "result" );
+
+      // feature used: intcol = 7, dblcol = 2.5, strcol = 'abc', nullcol = NULL
+      QTest::newRow( "int field" ) << "intcol + 1" << true << QVariant( 8 );
+      QTest::newRow( "double field" ) << "dblcol * 2" << true << QVariant( 5.0 );
+      QTest::newRow( "mixed" ) << "intcol / 2 + dblcol" << true << QVariant( 6.0 );
+      QTest::newRow( "int division" ) << "intcol // 2" << true << QVariant( 3 );
+      QTest::newRow( "modulo zero" ) << "intcol % 0" << true << QVariant();
+      QTest::newRow( "comparison" ) << "intcol > 5 AND dblcol < 3" << true << QVariant( 1 );
+      QTest::newRow( "null comparison" ) << "nullcol > 5" << true << QVariant();
+      QTest::newRow( "null or true" ) << "nullcol > 5 OR intcol = 7" << true << QVariant( 1 );
+      QTest::newRow( "string equality" ) << "strcol = 'abc'" << true << QVariant( 1 );
+      QTest::newRow( "string concat" ) << "strcol || 'def'" << true << QVariant( "abcdef" );
+      QTest::newRow( "string numeric" ) << "'5' + intcol" << true << QVariant( 12 );
+      QTest::newRow( "in list" ) << "intcol IN (1, 7, 9)" << true << QVariant( 1 );
+      QTest::newRow( "not in list" ) << "strcol NOT IN ('abc', 'def')" << true << QVariant( 0 );
+      QTest::newRow( "in list null" ) << "intcol IN (1, NULL)" << true << QVariant();
+      QTest::newRow( "case" ) << "CASE WHEN intcol < 5 THEN 'low' WHEN intcol < 10 THEN 'mid' ELSE 'high' END" << true << QVariant( "mid" );
+      QTest::newRow( "case no else" ) << "CASE WHEN intcol > 10 THEN 1 END" << true << QVariant();
+      QTest::newRow( "typed function" ) << "sqrt(intcol + 2)" << true << QVariant( 3.0 );
+      QTest::newRow( "typed function null" ) << "sqrt(nullcol)" << true << QVariant();
+      QTest::newRow( "typed function null result" ) << "ln(intcol - 7)" << true << QVariant();
+      QTest::newRow( "folded constant" ) << "intcol * (3 - 1)" << true << QVariant( 14 );
+      QTest::newRow( "tree fallback" ) << "upper(strcol) || intcol" << true << QVariant( "ABC7" );
+      QTest::newRow( "tree only" ) << "upper(strcol)" << false << QVariant( "ABC" );
+    }
+
+    void eval_compiled()
+    {
+      QFETCH( QString, string );
+      QFETCH( bool, compiled );
+      QFETCH( QVariant, result );
+
+      QgsFields fields;
+      fields.append( QgsField( "intcol", QVariant::Int ) );
+      fields.append( QgsField( "dblcol", QVariant::Double ) );
+      fields.append( QgsField( "strcol", QVariant::String ) );
+      fields.append( QgsField( "nullcol", QVariant::Int ) );
+
+      QgsFeature f( fields, 1 );
+      f.setAttributes( QgsAttributes() << 7 << 2.5 << "abc" << QVariant( QVariant::Int ) );
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+
+      QgsExpression exp( string );
+      QVariant treeResult = exp.evaluate( &context );
+      QVERIFY( !exp.isCompiled() );
+
+      QVERIFY( exp.prepare( &context ) );
+      QCOMPARE( exp.isCompiled(), compiled );
+      QVariant res = exp.evaluate( &context );
+      QVERIFY( !exp.hasEvalError() );
+      QCOMPARE( res.type(), result.type() );
+      QCOMPARE( res, result );
+      QCOMPARE( res.type(), treeResult.type() );
+      QCOMPARE( res, treeResult );
+
+      // a copy shares the compiled form until it is prepared again
+      QgsExpression copy( exp );
+      QCOMPARE( copy.isCompiled(), compiled );
+      QCOMPARE( copy.evaluate( &context ), result );
+    }
+
+    void eval_compiled_integer_types_data()
+    {
+      QTest::addColumn<QString>( "string" );
+
+      // feature used: ucol = 5 and bigucol = 2^63 + 1 as unsigned long long, longcol = 2^40 as long long
+      QTest::newRow( "unsigned arithmetic" ) << "ucol * 2 + 1";
+      QTest::newRow( "unsigned division" ) << "ucol / 2";
+      QTest::newRow( "unsigned minus" ) << "-ucol";
+      QTest::newRow( "unsigned comparison" ) << "ucol = 5";
+      QTest::newRow( "unsigned in" ) << "ucol IN (4, 5)";
+      QTest::newRow( "large unsigned comparison" ) << "bigucol > 0";
+      QTest::newRow( "large unsigned arithmetic" ) << "bigucol + 1";
+      QTest::newRow( "large unsigned division" ) << "bigucol / 2";
+      QTest::newRow( "large unsigned minus" ) << "-bigucol";
+      QTest::newRow( "large long comparison" ) << "longcol > ucol";
+      QTest::newRow( "large long arithmetic" ) << "longcol * 2";
+      QTest::newRow( "typed function" ) << "sqrt(ucol + 4)";
+    }
+
+    void eval_compiled_integer_types()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( "ucol", QVariant::ULongLong ) );
+      fields.append( QgsField( "bigucol", QVariant::ULongLong ) );
+      fields.append( QgsField( "longcol", QVariant::LongLong ) );
+
+      QgsFeature f( fields, 1 );
+      f.setAttributes( QgsAttributes() << QVariant( Q_UINT64_C( 5 ) ) << QVariant( Q_UINT64_C( 9223372036854775809 ) ) << QVariant( Q_INT64_C( 1099511627776 ) ) );
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( f, fields );
+
+      // the compiled form gives the same result, or the same error, as walking the node tree
+      QgsExpression exp( string );
+      QVariant treeResult = exp.evaluate( &context );
+      bool treeError = exp.hasEvalError();
+
+      QVERIFY( exp.prepare( &context ) );
+      QVERIFY( exp.isCompiled() );
+      QVariant res = exp.evaluate( &context );
+      QCOMPARE( exp.hasEvalError(), treeError );
+      QCOMPARE( res.type(), treeResult.type() );
+      QCOMPARE( res, treeResult );
+    }
+
+    void eval_batch_data()
+    {
+      eval_compiled_data();
+    }
+
+    void eval_batch()
+    {
+      QFETCH( QString, string );
+
+      QgsFields fields;
+      fields.append( QgsField( "intcol", QVariant::Int ) );
+      fields.append( QgsField( "dblcol", QVariant::Double ) );
+      fields.append( QgsField( "strcol", QVariant::String ) );
+      fields.append( QgsField( "nullcol", QVariant::Int ) );
+
+      // a block mixing numbers, NULLs and strings so rows take different paths
+      QgsFeatureList features;
+      for ( int i = 0; i < 20; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttributes( QgsAttributes() << ( i % 5 == 4 ? QVariant( QVariant::Int ) : QVariant( i ) )
+                         << i * 0.5 - 2
+                         << ( i % 3 == 0 ? QString( "abc" ) : QString::number( i ) )
+                         << ( i % 2 ? QVariant( i ) : QVariant( QVariant::Int ) ) );
+        features << f;
+      }
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( QgsFeature(), fields );
+      QgsExpression exp( string );
+      QVERIFY( exp.prepare( &context ) );
+
+      QVector<QVariant> results = exp.evaluateBatch( features, &context );
+      QVERIFY( !exp.hasEvalError() );
+      QCOMPARE( results.count(), features.count() );
+      for ( int i = 0; i < features.count(); ++i )
+      {
+        context.setFeature( features.at( i ) );
+        QVariant expected = exp.evaluate( &context );
+        QCOMPARE( results.at( i ).type(), expected.type() );
+        QCOMPARE( results.at( i ), expected );
+      }
+
+      QVERIFY( exp.evaluateBatch( QgsFeatureList(), &context ).isEmpty() );
+    }
+
+    void eval_batch_error()
+    {
+      QgsFields fields;
+      fields.append( QgsField( "intcol", QVariant::Int ) );
+      fields.append( QgsField( "strcol", QVariant::String ) );
+
+      QgsFeatureList features;
+      for ( int i = 0; i < 4; ++i )
+      {
+        QgsFeature f( fields, i );
+        f.setAttributes( QgsAttributes() << i << QString( i < 2 ? "1" : "abc" ) );
+        features << f;
+      }
+
+      QgsExpressionContext context = QgsExpressionContextUtils::createFeatureBasedContext( QgsFeature(), fields );
+      QgsExpression exp( "intcol + 1 > 0 AND strcol" );
+      QVERIFY( exp.prepare( &context ) );
+
+      // failed rows are NULL, the other rows are still evaluated
+      QVector<QVariant> results = exp.evaluateBatch( features, &context );
+      QVERIFY( exp.hasEvalError() );
+      QCOMPARE( results.count(), 4 );
+      QCOMPARE( results.at( 0 ), QVariant( 1 ) );
+      QCOMPARE( results.at( 1 ), QVariant( 1 ) );
+      QVERIFY( !results.at( 2 ).isValid() );
+      QVERIFY( !results.at( 3 ).isValid() );
+    }
+
     void eval_rownum()
     {
       QgsExpression exp( "$rownum + 1" );
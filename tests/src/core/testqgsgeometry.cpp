@@ -36,6 +36,7 @@
 #include "qgscircularstringv2.h"
 #include "qgsgeometrycollectionv2.h"
 #include "qgsgeometryfactory.h"
+#include "qgscoordinatearray.h"
 #include "qgstestutils.h"
 
 //qgs unit test utility class
@@ -97,6 +98,8 @@ class TestQgsGeometry : public QObject
     void exportToGeoJSON();
 
     void wkbInOut();
+    void coordinateArena();
+    void deferredWkbDecoding();
 
     void segmentizeCircularString();
 
@@ -3451,6 +3454,157 @@ void TestQgsGeometry::wkbInOut()
   QCOMPARE( badHeader.wkbType(), Qgis::WKBUnknown );
 }
 
+void TestQgsGeometry::coordinateArena()
+{
+  QString wkt( "MultiPolygonZ (((0 0 1, 10 0 2, 10 10 3, 0 10 4, 0 0 1),(2 2 5, 4 2 6, 4 4 7, 2 2 5)),((20 20 8, 30 20 9, 30 30 10, 20 20 8)))" );
+  QScopedPointer< QgsAbstractGeometryV2 > source( QgsGeometryFactory::geomFromWkt( wkt ) );
+  QVERIFY( source );
+  int size = 0;
+  unsigned char* wkb = source->asWkb( size );
+
+  // rings read from WKB share the coordinates of the whole geometry
+  QScopedPointer< QgsAbstractGeometryV2 > geom( QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr( wkb, size ) ) );
+  delete[] wkb;
+  QVERIFY( geom );
+  QgsGeometryCollectionV2* collection = dynamic_cast< QgsGeometryCollectionV2* >( geom.data() );
+  QVERIFY( collection );
+  QCOMPARE( collection->numGeometries(), 2 );
+  QgsPolygonV2* polygon = dynamic_cast< QgsPolygonV2* >( collection->geometryN( 0 ) );
+  QVERIFY( polygon );
+  const QgsLineStringV2* exterior = dynamic_cast< const QgsLineStringV2* >( polygon->exteriorRing() );
+  QVERIFY( exterior );
+  QVERIFY( exterior->isArenaBacked() );
+  QVERIFY( dynamic_cast< const QgsLineStringV2* >( polygon->interiorRing( 0 ) )->isArenaBacked() );
+  QCOMPARE( exterior->pointN( 2 ), QgsPointV2( QgsWKBTypes::PointZ, 10, 10, 3 ) );
+  QCOMPARE( geom->asWkt(), source->asWkt() );
+
+  int size2 = 0;
+  unsigned char* wkb2 = geom->asWkb( size2 );
+  QCOMPARE( size2, size );
+  delete[] wkb2;
+
+  // modifying a geometry detaches the modified ring only, clones are not affected
+  QScopedPointer< QgsAbstractGeometryV2 > cloned( geom->clone() );
+  QVERIFY( geom->moveVertex( QgsVertexId( 0, 0, 2 ), QgsPointV2( QgsWKBTypes::PointZ, 11, 11, 13 ) ) );
+  QVERIFY( !exterior->isArenaBacked() );
+  QCOMPARE( exterior->pointN( 2 ), QgsPointV2( QgsWKBTypes::PointZ, 11, 11, 13 ) );
+  QVERIFY( dynamic_cast< const QgsLineStringV2* >( polygon->interiorRing( 0 ) )->isArenaBacked() );
+  QCOMPARE( cloned->asWkt(), source->asWkt() );
+
+  // explicit detach keeps the coordinates
+  polygon = dynamic_cast< QgsPolygonV2* >( collection->geometryN( 1 ) );
+  QgsLineStringV2 ring( *dynamic_cast< const QgsLineStringV2* >( polygon->exteriorRing() ) );
+  QVERIFY( ring.isArenaBacked() );
+  ring.detach();
+  QVERIFY( !ring.isArenaBacked() );
+  QCOMPARE( ring.asWkt(), polygon->exteriorRing()->asWkt() );
+
+  // an arena too small for the geometry stores the remaining rings in their own arrays
+  source.reset( QgsGeometryFactory::geomFromWkt( "Polygon ((0 0, 1 0, 1 1, 0 0),(0.1 0.1, 0.2 0.1, 0.2 0.2, 0.1 0.1))" ) );
+  wkb = source->asWkb( size );
+  QgsCoordinateArena arena( 8 );
+  QgsPolygonV2 small;
+  QVERIFY( small.fromWkb( QgsConstWkbPtr( wkb, size ), &arena ) );
+  delete[] wkb;
+  QCOMPARE( arena.used(), 8 );
+  QVERIFY( dynamic_cast< const QgsLineStringV2* >( small.exteriorRing() )->isArenaBacked() );
+  QVERIFY( !dynamic_cast< const QgsLineStringV2* >( small.interiorRing( 0 ) )->isArenaBacked() );
+  QCOMPARE( small.asWkt(), source->asWkt() );
+
+  // the parts of a geometry collection share one arena sized from their point counts, rather
+  // than one arena per part sized from the rest of the WKB
+  QStringList parts;
+  parts << "Point (1 2)" << "CircularString (0 0, 1 1, 2 0)";
+  for ( int i = 0; i < 10000; ++i )
+  {
+    parts << QString( "LineString (%1 0, %1 1)" ).arg( i );
+  }
+  parts << "Polygon ((0 0, 1 0, 1 1, 0 0))";
+  source.reset( QgsGeometryFactory::geomFromWkt( QString( "GeometryCollection (%1)" ).arg( parts.join( ", " ) ) ) );
+  QVERIFY( source );
+  wkb = source->asWkb( size );
+  geom.reset( QgsGeometryFactory::geomFromWkb( QgsConstWkbPtr( wkb, size ) ) );
+  QVERIFY( geom );
+  collection = dynamic_cast< QgsGeometryCollectionV2* >( geom.data() );
+  QVERIFY( collection );
+  QCOMPARE( collection->numGeometries(), 10003 );
+  for ( int i = 2; i < 10002; ++i )
+  {
+    QVERIFY( dynamic_cast< const QgsLineStringV2* >( collection->geometryN( i ) )->isArenaBacked() );
+  }
+  QCOMPARE( geom->asWkt(), source->asWkt() );
+
+  QgsCoordinateArena collectionArena( 40008 );
+  QgsGeometryCollectionV2 arenaCollection;
+  QVERIFY( arenaCollection.fromWkb( QgsConstWkbPtr( wkb, size ), &collectionArena ) );
+  delete[] wkb;
+  QCOMPARE( collectionArena.used(), 40008 );
+  polygon = dynamic_cast< QgsPolygonV2* >( arenaCollection.geometryN( 10002 ) );
+  QVERIFY( polygon );
+  QVERIFY( dynamic_cast< const QgsLineStringV2* >( polygon->exteriorRing() )->isArenaBacked() );
+  QCOMPARE( arenaCollection.asWkt(), source->asWkt() );
+}
+
+void TestQgsGeometry::deferredWkbDecoding()
+{
+  QScopedPointer< QgsAbstractGeometryV2 > source( QgsGeometryFactory::geomFromWkt( "LineString (1 2, 3 4, 5 6)" ) );
+  int size = 0;
+  unsigned char* wkb = source->asWkb( size );
+
+  // the WKB is returned as is until the geometry is used
+  QgsGeometry g;
+  g.fromWkb( wkb, size );
+  QCOMPARE( g.asWkb(), const_cast< const unsigned char* >( wkb ) );
+  QCOMPARE( g.wkbSize(), size );
+
+  // copies share the WKB and its geometry until they are modified
+  QgsGeometry copy( g );
+  QVERIFY( copy.translate( 1, 1 ) == 0 );
+  QCOMPARE( copy.exportToWkt(), QString( "LineString (2 3, 4 5, 6 7)" ) );
+  QCOMPARE( g.asWkb(), const_cast< const unsigned char* >( wkb ) );
+
+  QVERIFY( g.geometry() );
+  QCOMPARE( g.exportToWkt(), source->asWkt() );
+  QCOMPARE( g.asWkb(), const_cast< const unsigned char* >( wkb ) );
+
+  // replacing the geometry discards the WKB
+  g.setGeometry( nullptr );
+  QVERIFY( g.isEmpty() );
+  QVERIFY( !g.asWkb() );
+
+  // invalid WKB results in an empty geometry once decoded
+  const char *hexwkb = "0102000000EF0000000000000000000000000000000000000000000000000000000000000000000000";
+  wkb = hex2bytes( hexwkb, &size );
+  QgsGeometry invalid;
+  invalid.fromWkb( wkb, size );
+  const unsigned char* invalidWkb = invalid.asWkb();
+  QCOMPARE( invalidWkb, const_cast< const unsigned char* >( wkb ) );
+  QVERIFY( invalid.isEmpty() );
+  QVERIFY( !invalid.asWkb() );
+  QCOMPARE( invalid.wkbSize(), 0 );
+  // the buffer returned before decoding is still valid
+  QCOMPARE( invalidWkb[0], static_cast< unsigned char >( 1 ) );
+
+  // editing decodes the WKB before changing the geometry
+  QScopedPointer< QgsAbstractGeometryV2 > polygon( QgsGeometryFactory::geomFromWkt( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0))" ) );
+  wkb = polygon->asWkb( size );
+  QgsGeometry withRing;
+  withRing.fromWkb( wkb, size );
+  QList<QgsPoint> ring;
+  ring << QgsPoint( 2, 2 ) << QgsPoint( 4, 2 ) << QgsPoint( 4, 4 ) << QgsPoint( 2, 4 ) << QgsPoint( 2, 2 );
+  QCOMPARE( withRing.addRing( ring ), 0 );
+  QCOMPARE( withRing.exportToWkt(), QString( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0),(2 2, 4 2, 4 4, 2 4, 2 2))" ) );
+
+  // as well as for shared data
+  wkb = polygon->asWkb( size );
+  QgsGeometry shared;
+  shared.fromWkb( wkb, size );
+  QgsGeometry sharedCopy( shared );
+  QCOMPARE( sharedCopy.addRing( ring ), 0 );
+  QCOMPARE( sharedCopy.exportToWkt(), QString( "Polygon ((0 0, 10 0, 10 10, 0 10, 0 0),(2 2, 4 2, 4 4, 2 4, 2 2))" ) );
+  QCOMPARE( shared.exportToWkt(), polygon->asWkt() );
+}
+
 void TestQgsGeometry::segmentizeCircularString()
 {
   QString wkt( "CIRCULARSTRING( 0 0, 0.5 0.5, 2 0 )" );
@@ -75,6 +75,8 @@ class TestQgsGML : public QObject
     void testPartialFeature();
     void testThroughOGRGeometry();
     void testThroughOGRGeometry_urn_EPSG_4326();
+    void testCoordinateParsing();
+    void testParallelParsing();
 };
 
 const QString data1( "<myns:FeatureCollection "
@@ -1102,5 +1104,111 @@ void TestQgsGML::testThroughOGRGeometry_urn_EPSG_4326()
   delete features[0].first;
 }
 
+void TestQgsGML::testCoordinateParsing()
+{
+  QgsFields fields;
+  QgsGmlStreamingParser gmlParser( "mytypename", "mygeom", fields );
+  QCOMPARE( gmlParser.processData( QByteArray( "<myns:FeatureCollection "
+                                   "xmlns:myns='http://myns' "
+                                   "xmlns:gml='http://www.opengis.net/gml'>"
+                                   "<gml:featureMember>"
+                                   "<myns:mytypename fid='mytypename.1'>"
+                                   "<myns:mygeom>"
+                                   "<gml:LineString srsName='EPSG:27700'>"
+                                   "<gml:coordinates cs=';' ts='|'> 1.5e2;-0.25 |12345678901234567890;+7|x;1|3;4;5 </gml:coordinates>"
+                                   "</gml:LineString>"
+                                   "</myns:mygeom>"
+                                   "</myns:mytypename>"
+                                   "</gml:featureMember>"
+                                   "<gml:featureMember>"
+                                   "<myns:mytypename fid='mytypename.2'>"
+                                   "<myns:mygeom>"
+                                   "<gml:LineString srsName='EPSG:27700'>"
+                                   "<gml:posList>\n  0.1 1E-3\n\t-4.000000000000000001  1e300 </gml:posList>"
+                                   "</gml:LineString>"
+                                   "</myns:mygeom>"
+                                   "</myns:mytypename>"
+                                   "</gml:featureMember>"
+                                   "</myns:FeatureCollection>" ), true ), true );
+  QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features = gmlParser.getAndStealReadyFeatures();
+  QCOMPARE( features.size(), 2 );
+  QgsPolyline line = features[0].first->constGeometry()->asPolyline();
+  QCOMPARE( line.size(), 3 );
+  QCOMPARE( line[0], QgsPoint( 150, -0.25 ) );
+  QCOMPARE( line[1], QgsPoint( 12345678901234567890.0, 7 ) );
+  QCOMPARE( line[2], QgsPoint( 3, 4 ) );
+  line = features[1].first->constGeometry()->asPolyline();
+  QCOMPARE( line.size(), 2 );
+  QCOMPARE( line[0].x(), 0.1 );
+  QCOMPARE( line[0].y(), 0.001 );
+  QCOMPARE( line[1].x(), -4.000000000000000001 );
+  QCOMPARE( line[1].y(), 1e300 );
+  delete features[0].first;
+  delete features[1].first;
+}
+
+void TestQgsGML::testParallelParsing()
+{
+  QByteArray data( "<?xml version='1.0' encoding='UTF-8'?>\n"
+                   "<!-- a comment with a <tag> -->\n"
+                   "<myns:FeatureCollection "
+                   "xmlns:myns='http://myns' "
+                   "xmlns:gml='http://www.opengis.net/gml' numberOfFeatures='5000'>"
+                   "<gml:boundedBy><gml:Envelope><gml:lowerCorner>0 0</gml:lowerCorner>"
+                   "<gml:upperCorner>5000 10000</gml:upperCorner></gml:Envelope></gml:boundedBy>" );
+  for ( int i = 0; i < 5000; ++i )
+  {
+    data += QString( "<gml:featureMember>"
+                     "<myns:mytypename gml:id='mytypename.%1' note='a > b'>"
+                     "<myns:intfield>%1</myns:intfield>"
+                     "<myns:strfield><![CDATA[</gml:featureMember> %1]]></myns:strfield>"
+                     "<!-- </myns:mytypename> -->"
+                     "<myns:mygeom>"
+                     "<gml:LineString srsName='urn:ogc:def:crs:EPSG::27700'>"
+                     "<gml:posList>%1 %2 %3 %4.5</gml:posList>"
+                     "</gml:LineString>"
+                     "</myns:mygeom>"
+                     "</myns:mytypename>"
+                     "</gml:featureMember>\n" )
+            .arg( i ).arg( 2 * i ).arg( i + 1 ).arg( 2 * i ).toUtf8();
+  }
+  data += "</myns:FeatureCollection>";
+
+  QgsFields fields;
+  fields.append( QgsField( "intfield", QVariant::Int, "int" ) );
+  fields.append( QgsField( "strfield", QVariant::String, "string" ) );
+
+  QgsGmlStreamingParser sequentialParser( "mytypename", "mygeom", fields );
+  QCOMPARE( sequentialParser.processData( data, true ), true );
+  QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> expected = sequentialParser.getAndStealReadyFeatures();
+  QCOMPARE( expected.size(), 5000 );
+
+  QgsGmlStreamingParser gmlParser( "mytypename", "mygeom", fields );
+  gmlParser.setMaxThreads( 4 );
+  QVector<QgsGmlStreamingParser::QgsGmlFeaturePtrGmlIdPair> features;
+  const int chunkSize = 4000;
+  for ( int pos = 0; pos < data.size(); pos += chunkSize )
+  {
+    QCOMPARE( gmlParser.processData( data.mid( pos, chunkSize ), pos + chunkSize >= data.size() ), true );
+    features += gmlParser.getAndStealReadyFeatures();
+  }
+  features += gmlParser.getAndStealReadyFeatures();
+
+  QCOMPARE( gmlParser.getEPSGCode(), 27700 );
+  QCOMPARE( gmlParser.wkbType(), Qgis::WKBLineString );
+  QCOMPARE( gmlParser.numberReturned(), 5000 );
+  QCOMPARE( gmlParser.layerExtent(), QgsRectangle( 0, 0, 5000, 10000 ) );
+  QCOMPARE( features.size(), expected.size() );
+  for ( int i = 0; i < features.size(); ++i )
+  {
+    QCOMPARE( features[i].second, expected[i].second );
+    QCOMPARE( features[i].first->id(), expected[i].first->id() );
+    QCOMPARE( features[i].first->attributes(), expected[i].first->attributes() );
+    QCOMPARE( features[i].first->constGeometry()->exportToWkt(), expected[i].first->constGeometry()->exportToWkt() );
+    delete features[i].first;
+    delete expected[i].first;
+  }
+}
+
 QTEST_MAIN( TestQgsGML )
 #include "testqgsgml.moc"
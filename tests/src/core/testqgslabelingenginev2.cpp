@@ -17,6 +17,7 @@
 
 #include <qgsapplication.h>
 #include <qgslabelingenginev2.h>
+#include <qgslabelplacementcache.h>
 #include <qgsmaplayerregistry.h>
 #include <qgsmaprenderersequentialjob.h>
 #include <qgsrulebasedlabeling.h>
@@ -42,6 +43,9 @@ class TestQgsLabelingEngineV2 : public QObject
     void testDiagrams();
     void testRuleBased();
     void zOrder(); //test that labels are stacked correctly
+    void testPlacementCache();
+    void testPlacementRepeatable();
+    void testParallelPlacement();
     void testEncodeDecodePositionOrder();
 
   private:
@@ -51,6 +55,7 @@ class TestQgsLabelingEngineV2 : public QObject
 
     void setDefaultLabelParams( QgsVectorLayer* layer );
     bool imageCheck( const QString& testName, QImage &image, int mismatchCount );
+    QMap<int, QgsRectangle> placeLabels( const QgsMapSettings& mapSettings, QgsLabelingEngineV2::Flags flags );
 };
 
 void TestQgsLabelingEngineV2::initTestCase()
@@ -386,6 +391,159 @@ void TestQgsLabelingEngineV2::zOrder()
   QgsMapLayerRegistry::instance()->removeMapLayer( vl2 );
 }
 
+void TestQgsLabelingEngineV2::testPlacementCache()
+{
+  QSize size( 640, 480 );
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( size );
+  mapSettings.setExtent( vl->extent() );
+  mapSettings.setLayers( QStringList() << vl->id() );
+  mapSettings.setOutputDpi( 96 );
+
+  vl->setCustomProperty( "labeling", "pal" );
+  vl->setCustomProperty( "labeling/enabled", true );
+  vl->setCustomProperty( "labeling/fieldName", "Class" );
+  setDefaultLabelParams( vl );
+
+  QgsLabelPlacementCache cache;
+  QImage img( size, QImage::Format_ARGB32_Premultiplied );
+
+  // first run fills the cache
+  QPainter p( &img );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+  context.setPainter( &p );
+
+  QgsLabelingEngineV2 engine;
+  engine.setMapSettings( mapSettings );
+  engine.setPlacementCache( &cache );
+  engine.addProvider( new QgsVectorLayerLabelProvider( vl, QString() ) );
+  engine.run( context );
+  p.end();
+
+  QVERIFY( !cache.isEmpty() );
+  QMap<int, QgsRectangle> firstRects;
+  Q_FOREACH ( const QgsLabelPosition& pos, engine.results()->labelsWithinRect( mapSettings.extent() ) )
+    firstRects.insert( pos.featureId, pos.labelRect );
+  QVERIFY( !firstRects.isEmpty() );
+
+  // panned map at the same scale: labels of the features still visible keep their positions
+  QgsRectangle extent = mapSettings.visibleExtent();
+  double dx = extent.width() / 10.0;
+  mapSettings.setExtent( QgsRectangle( extent.xMinimum() + dx, extent.yMinimum(), extent.xMaximum() + dx, extent.yMaximum() ) );
+  QVERIFY( qgsDoubleNear( mapSettings.scale(), engine.mapSettings().scale(), 1e-6 * mapSettings.scale() ) );
+
+  QPainter p2( &img );
+  QgsRenderContext context2 = QgsRenderContext::fromMapSettings( mapSettings );
+  context2.setPainter( &p2 );
+
+  QgsLabelingEngineV2 engine2;
+  engine2.setMapSettings( mapSettings );
+  engine2.setPlacementCache( &cache );
+  engine2.addProvider( new QgsVectorLayerLabelProvider( vl, QString() ) );
+  engine2.run( context2 );
+  p2.end();
+
+  int kept = 0;
+  Q_FOREACH ( const QgsLabelPosition& pos, engine2.results()->labelsWithinRect( mapSettings.extent() ) )
+  {
+    if ( !firstRects.contains( pos.featureId ) )
+      continue;
+
+    QgsRectangle rect = firstRects.value( pos.featureId );
+    QVERIFY( qgsDoubleNear( rect.xMinimum(), pos.labelRect.xMinimum(), 1e-6 * rect.width() ) );
+    QVERIFY( qgsDoubleNear( rect.yMinimum(), pos.labelRect.yMinimum(), 1e-6 * rect.height() ) );
+    ++kept;
+  }
+  QVERIFY( kept > 0 );
+
+  // placements are dropped for another scale or with the layer
+  QgsLabelPlacementCache::FeaturePlacements placements;
+  placements.insert( 1, QgsLabelPlacementCache::Placement() );
+  cache.setPlacements( "other", QString(), placements );
+  QVERIFY( !cache.init( mapSettings.scale() * 2, mapSettings.rotation(), 0 ) );
+  QVERIFY( cache.isEmpty() );
+
+  cache.setPlacements( vl->id(), QString(), placements );
+  QCOMPARE( cache.placements( vl->id(), QString() ).count(), 1 );
+  cache.clearLayer( vl->id() );
+  QVERIFY( cache.isEmpty() );
+}
+
+QMap<int, QgsRectangle> TestQgsLabelingEngineV2::placeLabels( const QgsMapSettings& mapSettings, QgsLabelingEngineV2::Flags flags )
+{
+  QImage img( mapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  QPainter p( &img );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+  context.setPainter( &p );
+
+  QgsLabelingEngineV2 engine;
+  engine.setMapSettings( mapSettings );
+  engine.setFlags( flags );
+  engine.addProvider( new QgsVectorLayerLabelProvider( vl, QString() ) );
+  engine.run( context );
+  p.end();
+
+  QMap<int, QgsRectangle> rects;
+  Q_FOREACH ( const QgsLabelPosition& pos, engine.results()->labelsWithinRect( mapSettings.extent() ) )
+    rects.insert( pos.featureId, pos.labelRect );
+  return rects;
+}
+
+void TestQgsLabelingEngineV2::testPlacementRepeatable()
+{
+  // small map: the labels conflict and several components are solved in parallel
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 200, 150 ) );
+  mapSettings.setExtent( vl->extent() );
+  mapSettings.setLayers( QStringList() << vl->id() );
+  mapSettings.setOutputDpi( 96 );
+
+  vl->setCustomProperty( "labeling", "pal" );
+  vl->setCustomProperty( "labeling/enabled", true );
+  vl->setCustomProperty( "labeling/fieldName", "Class" );
+  setDefaultLabelParams( vl );
+
+  QgsLabelingEngineV2::Flags flags( QgsLabelingEngineV2::UsePartialCandidates | QgsLabelingEngineV2::RenderOutlineLabels );
+  QMap<int, QgsRectangle> first = placeLabels( mapSettings, flags );
+  QVERIFY( !first.isEmpty() );
+
+  for ( int i = 0; i < 5; ++i )
+  {
+    QMap<int, QgsRectangle> rects = placeLabels( mapSettings, flags );
+    QCOMPARE( rects.keys(), first.keys() );
+    Q_FOREACH ( int fid, first.keys() )
+      QCOMPARE( rects.value( fid ).toString( 6 ), first.value( fid ).toString( 6 ) );
+  }
+
+  vl->setCustomProperty( "labeling/enabled", false );
+}
+
+void TestQgsLabelingEngineV2::testParallelPlacement()
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setOutputSize( QSize( 200, 150 ) );
+  mapSettings.setExtent( vl->extent() );
+  mapSettings.setLayers( QStringList() << vl->id() );
+  mapSettings.setOutputDpi( 96 );
+
+  vl->setCustomProperty( "labeling", "pal" );
+  vl->setCustomProperty( "labeling/enabled", true );
+  vl->setCustomProperty( "labeling/fieldName", "Class" );
+  setDefaultLabelParams( vl );
+
+  QgsLabelingEngineV2::Flags flags( QgsLabelingEngineV2::UsePartialCandidates | QgsLabelingEngineV2::RenderOutlineLabels );
+  QMap<int, QgsRectangle> parallel = placeLabels( mapSettings, flags );
+  QMap<int, QgsRectangle> sequential = placeLabels( mapSettings, flags | QgsLabelingEngineV2::SequentialPlacement );
+  QVERIFY( !sequential.isEmpty() );
+
+  // the labels are placed at the same positions by the parallel threads
+  QCOMPARE( parallel.keys(), sequential.keys() );
+  Q_FOREACH ( int fid, sequential.keys() )
+    QCOMPARE( parallel.value( fid ).toString( 6 ), sequential.value( fid ).toString( 6 ) );
+
+  vl->setCustomProperty( "labeling/enabled", false );
+}
+
 void TestQgsLabelingEngineV2::testEncodeDecodePositionOrder()
 {
   //create an ordered position list
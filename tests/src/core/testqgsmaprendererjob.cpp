@@ -20,9 +20,13 @@
 #include <QTime>
 #include <QApplication>
 #include <QDesktopServices>
+#include <QSemaphore>
+#include <QSettings>
+#include <QThreadPool>
 
 //qgis includes...
 #include <qgsvectorlayer.h> //defines QgsFieldMap
+#include <qgsvectordataprovider.h>
 #include <qgsvectorfilewriter.h> //logic for writing shpfiles
 #include <qgsfeature.h> //we will need to pass a bunch of these for each rec
 #include <qgsgeometry.h> //each feature needs a geometry
@@ -32,6 +36,10 @@
 #include <qgsfield.h>
 #include <qgis.h> //defines GEOWkt
 #include "qgsmaprenderersequentialjob.h"
+#include "qgsmaprendererparalleljob.h"
+#include "qgsmaprenderercache.h"
+#include "qgsvectorlayerrenderer.h"
+#include "qgsexpression.h"
 #include <qgsmaplayer.h>
 #include <qgsvectorlayer.h>
 #include <qgsapplication.h>
@@ -40,6 +48,8 @@
 
 //qgs unit test utility class
 #include "qgsrenderchecker.h"
+#include "qgssinglesymbolrendererv2.h"
+#include "qgssymbolv2.h"
 
 /** \ingroup UnitTests
  * This is a unit test for the QgsMapRendererJob class.
@@ -78,6 +88,33 @@ class TestQgsMapRendererJob : public QObject
     void testFourAdjacentTiles_data();
     void testFourAdjacentTiles();
 
+    /** Checks that a layer split into tiles by the parallel renderer renders the same as a whole */
+    void testTiledLayer();
+
+    /** Checks that markers of features outside of a tile are drawn in the tile when they reach into it */
+    void testTiledLargeMarkers();
+
+    /** Checks that the image cached for a panned extent is reused and completed */
+    void testPannedCache();
+
+    /** Checks that least recently used images are discarded from the cache */
+    void testCacheSize();
+
+    /** Checks that fetching features on a separate thread renders the same as fetching them while drawing */
+    void testFetchQueue();
+
+    /** Checks that a fetcher stopped before the end of its iterator stops its thread */
+    void testFetchQueueStop();
+
+    /** Checks that the geometries transformed to the map CRS on the fetch thread are drawn at the same place */
+    void testFetchQueueReprojected();
+
+    /** Checks that the layer renderer reports how long drawing and fetching waited for each other */
+    void testFetchQueueTiming();
+
+    /** Checks that a render fetching features on a separate thread can be canceled */
+    void testFetchQueueCancel();
+
   private:
     QString mEncoding;
     QgsVectorFileWriter::WriterError mError;
@@ -86,8 +123,58 @@ class TestQgsMapRendererJob : public QObject
     QgsMapSettings *mMapSettings;
     QgsMapLayer * mpPolysLayer;
     QString mReport;
+
+    //! Renders the map with the parallel renderer, splitting the layers into tiles
+    QImage renderTiled( const QgsMapSettings& mapSettings, QMap<QString, int>& perLayerRenderingTime );
+};
+
+
+//! Blocks the fetch threads evaluating it while closed, so that a render can be caught while it fetches features
+class FetchGateFunction : public QgsExpression::Function
+{
+  public:
+    FetchGateFunction()
+        : QgsExpression::Function( "_test_fetch_gate", 0, "Testing" )
+    {}
+
+    virtual QVariant func( const QVariantList&, const QgsExpressionContext*, QgsExpression* ) override
+    {
+      if ( sClosed && dynamic_cast< QgsVectorLayerFeatureFetcher* >( QThread::currentThread() ) )
+      {
+        sEntered.release();
+        sGate.acquire();
+      }
+      return true;
+    }
+
+    //! written before the render starts and before the gate is opened
+    static bool sClosed;
+    //! released each time a fetch thread is blocked
+    static QSemaphore sEntered;
+    static QSemaphore sGate;
 };
 
+bool FetchGateFunction::sClosed = false;
+QSemaphore FetchGateFunction::sEntered;
+QSemaphore FetchGateFunction::sGate;
+
+//! Returns the number of pixels which differ by more than antialiasing noise
+static int imageMismatches( const QImage& expected, const QImage& actual )
+{
+  int mismatches = 0;
+  for ( int y = 0; y < expected.height(); ++y )
+  {
+    for ( int x = 0; x < expected.width(); ++x )
+    {
+      QRgb a = expected.pixel( x, y );
+      QRgb b = actual.pixel( x, y );
+      if ( qAbs( qRed( a ) - qRed( b ) ) > 5 || qAbs( qGreen( a ) - qGreen( b ) ) > 5
+           || qAbs( qBlue( a ) - qBlue( b ) ) > 5 || qAbs( qAlpha( a ) - qAlpha( b ) ) > 5 )
+        ++mismatches;
+    }
+  }
+  return mismatches;
+}
 
 void TestQgsMapRendererJob::initTestCase()
 {
@@ -331,8 +418,356 @@ void TestQgsMapRendererJob::testFourAdjacentTiles()
   QVERIFY( result );
 }
 
+void TestQgsMapRendererJob::testTiledLayer()
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << mpPolysLayer->id() );
+  mapSettings.setExtent( QgsRectangle( -20, -10, 20, 10 ) );
+  mapSettings.setOutputSize( QSize( 400, 200 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
 
-QTEST_MAIN( TestQgsMapRendererJob )
-#include "testqgsmaprendererjob.moc"
+  QgsMapRendererSequentialJob sequentialJob( mapSettings );
+  sequentialJob.start();
+  sequentialJob.waitForFinished();
+  QImage expected = sequentialJob.renderedImage();
+
+  QMap<QString, int> times;
+  QImage tiled = renderTiled( mapSettings, times );
+
+  QCOMPARE( tiled.size(), expected.size() );
 
+  // features crossing the tile borders must not leave seams, only tolerate antialiasing noise
+  QVERIFY( imageMismatches( expected, tiled ) < expected.width() * expected.height() / 1000 );
 
+  // the rendering times of the tiles add up to one time for the layer
+  QCOMPARE( times.keys(), QStringList() << mpPolysLayer->id() );
+  QVERIFY( times.value( mpPolysLayer->id() ) >= 0 );
+  QCOMPARE( sequentialJob.perLayerRenderingTime().keys(), QStringList() << mpPolysLayer->id() );
+}
+
+QImage TestQgsMapRendererJob::renderTiled( const QgsMapSettings& mapSettings, QMap<QString, int>& perLayerRenderingTime )
+{
+  QSettings settings;
+  settings.setValue( "/qgis/parallel_rendering_tile_threshold", 1 );
+  int maxThreads = QThreadPool::globalInstance()->maxThreadCount();
+  QThreadPool::globalInstance()->setMaxThreadCount( 4 );
+
+  QgsMapRendererParallelJob parallelJob( mapSettings );
+  parallelJob.start();
+  parallelJob.waitForFinished();
+  perLayerRenderingTime = parallelJob.perLayerRenderingTime();
+
+  QThreadPool::globalInstance()->setMaxThreadCount( maxThreads );
+  settings.remove( "/qgis/parallel_rendering_tile_threshold" );
+
+  return parallelJob.renderedImage();
+}
+
+void TestQgsMapRendererJob::testTiledLargeMarkers()
+{
+  // the 40 mm markers reach about 75 pixels around the points, the tile borders are at x = 0 and y = 0
+  QgsVectorLayer* layer = new QgsVectorLayer( "Point", "markers", "memory" );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  QList<QgsPoint> points;
+  points << QgsPoint( 7, 3 ) << QgsPoint( -7, -3 ) << QgsPoint( 3, 7 ) << QgsPoint( -12, -7 );
+  Q_FOREACH ( const QgsPoint& point, points )
+  {
+    QgsFeature f( layer->fields() );
+    f.setGeometry( QgsGeometry::fromPoint( point ) );
+    features << f;
+  }
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+
+  QgsStringMap props;
+  props.insert( "size", "40" );
+  props.insert( "color", "255,0,0" );
+  layer->setRendererV2( new QgsSingleSymbolRendererV2( QgsMarkerSymbolV2::createSimple( props ) ) );
+  QgsMapLayerRegistry::instance()->addMapLayers( QList<QgsMapLayer*>() << layer );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << layer->id() );
+  mapSettings.setExtent( QgsRectangle( -20, -10, 20, 10 ) );
+  mapSettings.setOutputSize( QSize( 400, 200 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  QgsMapRendererSequentialJob sequentialJob( mapSettings );
+  sequentialJob.start();
+  sequentialJob.waitForFinished();
+  QImage expected = sequentialJob.renderedImage();
+
+  QMap<QString, int> times;
+  QImage tiled = renderTiled( mapSettings, times );
+
+  QgsMapLayerRegistry::instance()->removeMapLayers( QStringList() << layer->id() );
+
+  QCOMPARE( tiled.size(), expected.size() );
+  QVERIFY( imageMismatches( expected, tiled ) < expected.width() * expected.height() / 1000 );
+}
+
+void TestQgsMapRendererJob::testPannedCache()
+{
+  QgsMapRendererCache cache;
+
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << mpPolysLayer->id() );
+  mapSettings.setExtent( QgsRectangle( -20, -10, 20, 10 ) );
+  mapSettings.setOutputSize( QSize( 400, 200 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  QgsMapRendererSequentialJob job( mapSettings );
+  job.setCache( &cache );
+  job.start();
+  job.waitForFinished();
+  QVERIFY( !cache.cacheImage( mpPolysLayer->id() ).isNull() );
+
+  // pan by 50 x 30 pixels
+  mapSettings.setExtent( QgsRectangle( -15, -7, 25, 13 ) );
+
+  QgsMapRendererSequentialJob expectedJob( mapSettings );
+  expectedJob.start();
+  expectedJob.waitForFinished();
+  QImage expected = expectedJob.renderedImage();
+
+  cache.init( mapSettings.visibleExtent(), mapSettings.scale(), mapSettings.outputSize(), mapSettings.outputDpi() );
+  QPoint offset;
+  QVERIFY( !cache.pannedCacheImage( mpPolysLayer->id(), offset ).isNull() );
+  QCOMPARE( offset, QPoint( -50, 30 ) );
+
+  QgsMapRendererSequentialJob pannedJob( mapSettings );
+  pannedJob.setCache( &cache );
+  pannedJob.start();
+  pannedJob.waitForFinished();
+  QImage panned = pannedJob.renderedImage();
+
+  QCOMPARE( panned.size(), expected.size() );
+  QVERIFY( imageMismatches( expected, panned ) < expected.width() * expected.height() / 1000 );
+
+  // the completed image is cached for the new extent, the previous one is kept
+  QVERIFY( !cache.cacheImage( mpPolysLayer->id() ).isNull() );
+  cache.init( QgsRectangle( -20, -10, 20, 10 ), mapSettings.scale(), mapSettings.outputSize(), mapSettings.outputDpi() );
+  QVERIFY( !cache.cacheImage( mpPolysLayer->id() ).isNull() );
+
+  // images of another output size or DPI are not reused, even for the same extent and scale
+  cache.init( QgsRectangle( -20, -10, 20, 10 ), mapSettings.scale(), mapSettings.outputSize() * 2, mapSettings.outputDpi() );
+  QVERIFY( cache.cacheImage( mpPolysLayer->id() ).isNull() );
+  cache.init( QgsRectangle( -15, -7, 25, 13 ), mapSettings.scale(), mapSettings.outputSize() * 2, mapSettings.outputDpi() );
+  QVERIFY( cache.pannedCacheImage( mpPolysLayer->id(), offset ).isNull() );
+  cache.init( QgsRectangle( -20, -10, 20, 10 ), mapSettings.scale(), mapSettings.outputSize(), mapSettings.outputDpi() * 2 );
+  QVERIFY( cache.cacheImage( mpPolysLayer->id() ).isNull() );
+  cache.init( QgsRectangle( -15, -7, 25, 13 ), mapSettings.scale(), mapSettings.outputSize(), mapSettings.outputDpi() * 2 );
+  QVERIFY( cache.pannedCacheImage( mpPolysLayer->id(), offset ).isNull() );
+  cache.init( QgsRectangle( -20, -10, 20, 10 ), mapSettings.scale(), mapSettings.outputSize(), mapSettings.outputDpi() );
+
+  // a different style override is not reused
+  QVERIFY( cache.cacheImage( mpPolysLayer->id(), "<style/>" ).isNull() );
+  QVERIFY( cache.pannedCacheImage( mpPolysLayer->id(), offset, "<style/>" ).isNull() );
+
+  // nor an image at another scale
+  cache.init( QgsRectangle( -10, -5, 10, 5 ), mapSettings.scale() / 2, mapSettings.outputSize(), mapSettings.outputDpi() );
+  QVERIFY( cache.pannedCacheImage( mpPolysLayer->id(), offset ).isNull() );
+}
+
+void TestQgsMapRendererJob::testCacheSize()
+{
+  QImage image( 100, 100, QImage::Format_ARGB32_Premultiplied );
+  image.fill( 0 );
+
+  QgsMapRendererCache cache;
+  cache.setMaximumCacheSize( image.byteCount() * 2 );
+
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  cache.setCacheImage( "a", image );
+  cache.init( QgsRectangle( 100, 0, 200, 100 ), 1000 );
+  cache.setCacheImage( "a", image );
+  QCOMPARE( cache.cacheSize(), static_cast< qint64 >( image.byteCount() * 2 ) );
+
+  // replacing an image does not grow the cache
+  cache.setCacheImage( "a", image );
+  QCOMPARE( cache.cacheSize(), static_cast< qint64 >( image.byteCount() * 2 ) );
+
+  // touch the first image, the second one is now the least recently used
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  QVERIFY( !cache.cacheImage( "a" ).isNull() );
+
+  cache.init( QgsRectangle( 0, 100, 100, 200 ), 1000 );
+  cache.setCacheImage( "a", image );
+  QCOMPARE( cache.cacheSize(), static_cast< qint64 >( image.byteCount() * 2 ) );
+
+  cache.init( QgsRectangle( 0, 0, 100, 100 ), 1000 );
+  QVERIFY( !cache.cacheImage( "a" ).isNull() );
+  cache.init( QgsRectangle( 100, 0, 200, 100 ), 1000 );
+  QVERIFY( cache.cacheImage( "a" ).isNull() );
+
+  cache.clearCacheImage( "a" );
+  QCOMPARE( cache.cacheSize(), static_cast< qint64 >( 0 ) );
+}
+
+void TestQgsMapRendererJob::testFetchQueue()
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << mpPolysLayer->id() );
+  mapSettings.setExtent( QgsRectangle( -60, -30, 60, 30 ) );
+  mapSettings.setOutputSize( QSize( 600, 300 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  // features read while drawing
+  QSettings settings;
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 0 );
+  QgsMapRendererSequentialJob singleThreadedJob( mapSettings );
+  singleThreadedJob.start();
+  singleThreadedJob.waitForFinished();
+  QImage expected = singleThreadedJob.renderedImage();
+
+  // a queue smaller than the number of features, so that fetching waits for drawing
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 50 );
+
+  QgsMapRendererSequentialJob fetchJob( mapSettings );
+  fetchJob.start();
+  fetchJob.waitForFinished();
+  QImage fetched = fetchJob.renderedImage();
+
+  settings.remove( "/qgis/rendering/fetch_queue_size" );
+
+  // the features are drawn in the same order, with the geometries simplified by the fetch thread
+  QCOMPARE( imageMismatches( expected, fetched ), 0 );
+}
+
+void TestQgsMapRendererJob::testFetchQueueReprojected()
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << mpPolysLayer->id() );
+  mapSettings.setCrsTransformEnabled( true );
+  mapSettings.setDestinationCrs( QgsCoordinateReferenceSystem( "EPSG:3857" ) );
+  mapSettings.setExtent( QgsRectangle( -6679169, -3503549, 6679169, 3503549 ) );
+  mapSettings.setOutputSize( QSize( 600, 300 ) );
+  mapSettings.setFlag( QgsMapSettings::Antialiasing );
+
+  QSettings settings;
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 0 );
+  QgsMapRendererSequentialJob singleThreadedJob( mapSettings );
+  singleThreadedJob.start();
+  singleThreadedJob.waitForFinished();
+  QImage expected = singleThreadedJob.renderedImage();
+
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 50 );
+
+  QgsMapRendererSequentialJob fetchJob( mapSettings );
+  fetchJob.start();
+  fetchJob.waitForFinished();
+  QImage fetched = fetchJob.renderedImage();
+
+  settings.remove( "/qgis/rendering/fetch_queue_size" );
+
+  // only the clipping of the polygons outside of the map differs
+  QVERIFY( imageMismatches( expected, fetched ) < 50 );
+}
+
+void TestQgsMapRendererJob::testFetchQueueTiming()
+{
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << mpPolysLayer->id() );
+  mapSettings.setExtent( QgsRectangle( -20, -10, 20, 10 ) );
+  mapSettings.setOutputSize( QSize( 200, 100 ) );
+
+  QImage image( mapSettings.outputSize(), QImage::Format_ARGB32_Premultiplied );
+  QPainter painter( &image );
+  QgsRenderContext context = QgsRenderContext::fromMapSettings( mapSettings );
+  context.setPainter( &painter );
+
+  QSettings settings;
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 50 );
+  QScopedPointer< QgsMapLayerRenderer > renderer( mpPolysLayer->createMapRenderer( context ) );
+
+  QVERIFY( renderer->render() );
+  QCOMPARE( renderer->timingDetails().count(), 1 );
+
+  // without a fetch thread there is nothing to report
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 0 );
+  QScopedPointer< QgsMapLayerRenderer > directRenderer( mpPolysLayer->createMapRenderer( context ) );
+  settings.remove( "/qgis/rendering/fetch_queue_size" );
+  QVERIFY( directRenderer->render() );
+  QVERIFY( directRenderer->timingDetails().isEmpty() );
+  painter.end();
+}
+
+void TestQgsMapRendererJob::testFetchQueueStop()
+{
+  QgsVectorLayer* layer = qobject_cast< QgsVectorLayer* >( mpPolysLayer );
+  QgsFeatureIterator expectedIt = layer->getFeatures();
+  QgsFeatureIterator fit = layer->getFeatures();
+
+  QgsVectorLayerFeatureFetcher fetcher( fit, 16 );
+  fetcher.startFetching();
+
+  QgsFeature expected;
+  QgsFeature feature;
+  for ( int i = 0; i < 100; ++i )
+  {
+    QVERIFY( expectedIt.nextFeature( expected ) );
+    QVERIFY( fetcher.nextFeature( feature ) );
+    QCOMPARE( feature.id(), expected.id() );
+  }
+
+  // the fetch thread waits for room in the queue, stopping wakes it and ends it
+  fetcher.stopFetching();
+  QVERIFY( fetcher.isFinished() );
+  QVERIFY( !fetcher.nextFeature( feature ) );
+}
+
+void TestQgsMapRendererJob::testFetchQueueCancel()
+{
+  // a memory layer whose features pass through the gate while they are fetched
+  QgsVectorLayer* layer = new QgsVectorLayer( "Polygon?crs=epsg:4326&field=Value:integer", "gated", "memory" );
+  QVERIFY( layer->isValid() );
+  QgsFeatureList features;
+  QgsFeature feature;
+  QgsFeatureIterator fit = qobject_cast< QgsVectorLayer* >( mpPolysLayer )->getFeatures( QgsFeatureRequest().setFilterRect( QgsRectangle( -20, -10, 20, 10 ) ) );
+  while ( fit.nextFeature( feature ) )
+    features << feature;
+  QVERIFY( layer->dataProvider()->addFeatures( features ) );
+  layer->updateExtents();
+  QgsExpression::registerFunction( new FetchGateFunction(), true );
+  QVERIFY( layer->setSubsetString( "_test_fetch_gate()" ) );
+  QgsMapLayerRegistry::instance()->addMapLayer( layer );
+
+  QgsMapSettings mapSettings;
+  mapSettings.setLayers( QStringList() << layer->id() );
+  mapSettings.setExtent( QgsRectangle( -20, -10, 20, 10 ) );
+  mapSettings.setOutputSize( QSize( 400, 200 ) );
+
+  QSettings settings;
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 10 );
+
+  // the job cannot finish while its fetch thread waits at the gate
+  FetchGateFunction::sClosed = true;
+  QgsMapRendererParallelJob job( mapSettings );
+  job.start();
+  FetchGateFunction::sEntered.acquire();
+  QVERIFY( job.isActive() );
+
+  // open the gate, the blocked fetch thread finds the render canceled
+  FetchGateFunction::sClosed = false;
+  FetchGateFunction::sGate.release();
+  job.cancel();
+  QVERIFY( !job.isActive() );
+
+  // the layer can be rendered again
+  QgsMapRendererParallelJob renderJob( mapSettings );
+  renderJob.start();
+  renderJob.waitForFinished();
+  QVERIFY( !renderJob.isActive() );
+
+  settings.setValue( "/qgis/rendering/fetch_queue_size", 0 );
+  QgsMapRendererSequentialJob expectedJob( mapSettings );
+  expectedJob.start();
+  expectedJob.waitForFinished();
+  settings.remove( "/qgis/rendering/fetch_queue_size" );
+  QCOMPARE( imageMismatches( expectedJob.renderedImage(), renderJob.renderedImage() ), 0 );
+
+  QgsMapLayerRegistry::instance()->removeMapLayer( layer->id() );
+  QgsExpression::unregisterFunction( "_test_fetch_gate" );
+}
+
+QTEST_MAIN( TestQgsMapRendererJob )
+#include "testqgsmaprendererjob.moc"
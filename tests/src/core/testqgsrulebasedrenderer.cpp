@@ -117,6 +117,70 @@ class TestQgsRuleBasedRenderer: public QObject
       delete layer;
     }
 
+    void test_prepareFeatureBlock()
+    {
+      QgsVectorLayer* layer = new QgsVectorLayer( "point?field=fld:int", "x", "memory" );
+      int idx = layer->fieldNameIndex( "fld" );
+      QgsFeatureList features;
+      for ( int i = 0; i < 20; ++i )
+      {
+        QgsFeature f( layer->fields(), i + 1 );
+        f.setAttribute( idx, i == 7 ? QVariant() : QVariant( i ) );
+        features << f;
+      }
+
+      QgsSymbolV2* s1 = QgsSymbolV2::defaultSymbol( Qgis::Point );
+      QgsSymbolV2* s2 = QgsSymbolV2::defaultSymbol( Qgis::Point );
+      RRule* rootRule = new RRule( nullptr );
+      RRule* rule1 = new RRule( s1, 0, 0, "fld >= 5 and fld <= 12" );
+      RRule* rule2 = new RRule( s2, 0, 0, "fld % 3 = 0" );
+      rootRule->appendChild( rule1 );
+      rootRule->appendChild( rule2 );
+      QgsRuleBasedRendererV2 r( rootRule );
+
+      QgsRenderContext ctx;
+      ctx.expressionContext().setFields( layer->fields() );
+      r.startRender( ctx, layer->fields() );
+
+      // the block evaluation gives the same results as the evaluation of each feature
+      QList<bool> expected1, expected2;
+      for ( int i = 0; i < features.count(); ++i )
+      {
+        expected1 << rule1->isFilterOK( features[i], &ctx );
+        expected2 << rule2->isFilterOK( features[i], &ctx );
+      }
+      QVector<bool> ok = rule1->isFilterOK( features, nullptr );
+      QCOMPARE( ok.count(), features.count() );
+      for ( int i = 0; i < features.count(); ++i )
+        QCOMPARE( ok.at( i ), expected1.at( i ) );
+
+      r.prepareFeatureBlock( features, ctx );
+      for ( int i = 0; i < features.count(); ++i )
+      {
+        QgsFeature changed( features.at( i ) );
+        changed.setAttribute( idx, 6 );
+        // the results of the block are returned for its features
+        QCOMPARE( rule1->isFilterOK( changed, &ctx ), expected1.at( i ) );
+        QCOMPARE( rule2->isFilterOK( changed, &ctx ), expected2.at( i ) );
+        ctx.expressionContext().setFeature( features[i] );
+        QCOMPARE( r.willRenderFeature( features[i], ctx ), expected1.at( i ) || expected2.at( i ) );
+      }
+
+      // features outside of the block are evaluated on their own
+      QgsFeature other( layer->fields(), 100 );
+      other.setAttribute( idx, 6 );
+      QVERIFY( rule1->isFilterOK( other, &ctx ) );
+
+      r.clearFeatureBlock();
+      QgsFeature changed( features.at( 0 ) );
+      changed.setAttribute( idx, 6 );
+      QVERIFY( !expected1.at( 0 ) );
+      QVERIFY( rule1->isFilterOK( changed, &ctx ) );
+
+      r.stopRender( ctx );
+      delete layer;
+    }
+
     void test_clone_ruleKey()
     {
       RRule* rootRule = new RRule( 0 );
@@ -17,6 +17,7 @@ from qgis.core import (
     Qgis,
     QgsField,
     QgsPoint,
+    QgsRectangle,
     QgsMapLayer,
     QgsVectorLayer,
     QgsFeatureRequest,
@@ -374,5 +375,147 @@ class TestPyQgsMemoryProviderIndexed(unittest.TestCase, ProviderTestCase):
         """
         pass
 
+class TestPyQgsMemoryProviderColumnar(unittest.TestCase, ProviderTestCase):
+
+    """Runs the provider test suite against an indexed memory layer using columnar storage"""
+
+    @classmethod
+    def setUpClass(cls):
+        """Run before all tests"""
+        # Create test layer
+        cls.vl = QgsVectorLayer(u'Point?crs=epsg:4326&storage=columnar&index=yes&field=pk:integer&field=cnt:int8&field=name:string(0)&field=name2:string(0)&field=num_char:string&key=pk',
+                                u'test', u'memory')
+        assert (cls.vl.isValid())
+        cls.provider = cls.vl.dataProvider()
+
+        f1 = QgsFeature()
+        f1.setAttributes([5, -200, NULL, 'NuLl', '5'])
+        f1.setGeometry(QgsGeometry.fromWkt('Point (-71.123 78.23)'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([3, 300, 'Pear', 'PEaR', '3'])
+
+        f3 = QgsFeature()
+        f3.setAttributes([1, 100, 'Orange', 'oranGe', '1'])
+        f3.setGeometry(QgsGeometry.fromWkt('Point (-70.332 66.33)'))
+
+        f4 = QgsFeature()
+        f4.setAttributes([2, 200, 'Apple', 'Apple', '2'])
+        f4.setGeometry(QgsGeometry.fromWkt('Point (-68.2 70.8)'))
+
+        f5 = QgsFeature()
+        f5.setAttributes([4, 400, 'Honey', 'Honey', '4'])
+        f5.setGeometry(QgsGeometry.fromWkt('Point (-65.32 78.3)'))
+
+        cls.provider.addFeatures([f1, f2, f3, f4, f5])
+
+        # poly layer
+        cls.poly_vl = QgsVectorLayer(u'Polygon?crs=epsg:4326&storage=columnar&index=yes&field=pk:integer&key=pk',
+                                     u'test', u'memory')
+        assert (cls.poly_vl.isValid())
+        cls.poly_provider = cls.poly_vl.dataProvider()
+
+        f1 = QgsFeature()
+        f1.setAttributes([1])
+        f1.setGeometry(QgsGeometry.fromWkt('Polygon ((-69.0 81.4, -69.0 80.2, -73.7 80.2, -73.7 76.3, -74.9 76.3, -74.9 81.4, -69.0 81.4))'))
+
+        f2 = QgsFeature()
+        f2.setAttributes([2])
+        f2.setGeometry(QgsGeometry.fromWkt('Polygon ((-67.6 81.2, -66.3 81.2, -66.3 76.9, -67.6 76.9, -67.6 81.2))'))
+
+        f3 = QgsFeature()
+        f3.setAttributes([3])
+        f3.setGeometry(QgsGeometry.fromWkt('Polygon ((-68.4 75.8, -67.5 72.6, -68.6 73.7, -70.2 72.9, -68.4 75.8))'))
+
+        f4 = QgsFeature()
+        f4.setAttributes([4])
+
+        cls.poly_provider.addFeatures([f1, f2, f3, f4])
+
+    @classmethod
+    def tearDownClass(cls):
+        """Run after all tests"""
+
+    def testUri(self):
+        self.assertTrue('storage=columnar' in self.provider.dataSourceUri())
+
+    def testEdit(self):
+        """ Test editing features stored in columns """
+        layer = QgsVectorLayer(u'Point?storage=columnar&index=yes&field=pk:integer&field=name:string', u'test', u'memory')
+        assert layer.isValid()
+        provider = layer.dataProvider()
+
+        features = []
+        for i in range(10):
+            f = QgsFeature()
+            f.setAttributes([i, 'name{}'.format(i)])
+            f.setGeometry(QgsGeometry.fromPoint(QgsPoint(i, i)))
+            features.append(f)
+        res, features = provider.addFeatures(features)
+        self.assertTrue(res)
+        self.assertEqual(provider.featureCount(), 10)
+
+        ids = [f.id() for f in features]
+        self.assertTrue(provider.deleteFeatures([ids[0], ids[5]]))
+        self.assertEqual(provider.featureCount(), 8)
+        self.assertEqual(set([f['pk'] for f in provider.getFeatures()]), set([1, 2, 3, 4, 6, 7, 8, 9]))
+
+        self.assertTrue(provider.changeAttributeValues({ids[6]: {1: 'changed', 0: 'not a number'}}))
+        f = next(provider.getFeatures(QgsFeatureRequest().setFilterFid(ids[6])))
+        self.assertEqual(f['name'], 'changed')
+        self.assertEqual(f['pk'], NULL)
+
+        # a bigger geometry is appended to the WKB, a smaller one replaces the old one
+        self.assertTrue(provider.changeGeometryValues({ids[7]: QgsGeometry.fromWkt('LineString (20 20, 21 21)'),
+                                                       ids[8]: QgsGeometry()}))
+        f = next(provider.getFeatures(QgsFeatureRequest().setFilterFid(ids[7])))
+        self.assertTrue(compareWkt(f.constGeometry().exportToWkt(), 'LineString (20 20, 21 21)'))
+        f = next(provider.getFeatures(QgsFeatureRequest().setFilterFid(ids[8])))
+        self.assertFalse(f.constGeometry())
+
+        self.assertEqual(provider.extent().toString(0), '1,1 : 21,21')
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(19, 19, 22, 22))
+        self.assertEqual([f['pk'] for f in provider.getFeatures(request)], [7])
+
+        self.assertTrue(provider.deleteAttributes([0]))
+        f = next(provider.getFeatures(QgsFeatureRequest().setFilterFid(ids[9])))
+        self.assertEqual(f.attributes(), ['name9'])
+
+    def testLargeGeometries(self):
+        """ Test geometries whose WKB spans several chunks """
+        layer = QgsVectorLayer(u'LineString?storage=columnar&field=pk:integer', u'test', u'memory')
+        assert layer.isValid()
+        provider = layer.dataProvider()
+
+        # about 6.4 MB of WKB each, some lines are split between two chunks
+        def line(i, size):
+            return QgsGeometry.fromPolyline([QgsPoint(i + x * 1e-6, x) for x in range(size)])
+
+        features = []
+        for i in range(6):
+            f = QgsFeature()
+            f.setAttributes([i])
+            f.setGeometry(line(i, 400000))
+            features.append(f)
+        res, features = provider.addFeatures(features)
+        self.assertTrue(res)
+        ids = [f.id() for f in features]
+
+        def check(expected):
+            for f in provider.getFeatures():
+                size = expected[f['pk']]
+                polyline = f.constGeometry().asPolyline()
+                self.assertEqual(len(polyline), size)
+                for x in (0, size // 2, size - 1):
+                    self.assertEqual(polyline[x], QgsPoint(f['pk'] + x * 1e-6, x))
+
+        check({i: 400000 for i in range(6)})
+
+        # a bigger geometry is appended, deleting features then compacts the WKB
+        self.assertTrue(provider.changeGeometryValues({ids[1]: line(1, 500000)}))
+        self.assertTrue(provider.deleteFeatures([ids[0], ids[2], ids[4]]))
+        check({1: 500000, 3: 400000, 5: 400000})
+
+
 if __name__ == '__main__':
     unittest.main()
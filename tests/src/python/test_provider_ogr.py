@@ -17,7 +17,7 @@ import shutil
 import sys
 import tempfile
 
-from qgis.core import QgsVectorLayer, QgsVectorDataProvider, QgsWKBTypes
+from qgis.core import QgsVectorLayer, QgsVectorDataProvider, QgsWKBTypes, QgsFeature, QgsFeatureRequest, QgsRectangle, QgsGeometry, QgsPoint
 from qgis.testing import (
     start_app,
     unittest
@@ -221,5 +221,84 @@ class PyQgsOGRProvider(unittest.TestCase):
         os.unlink(datasource)
         self.assertFalse(os.path.exists(datasource))
 
+    def testSpatialIndexFile(self):
+        datasource = os.path.join(self.basetestpath, 'testSpatialIndexFile.geojson')
+        with open(datasource, 'wt') as f:
+            f.write('{"type": "FeatureCollection", "features": [')
+            f.write(','.join('{"type": "Feature", "properties": {"id": %d}, "geometry": {"type": "Point", "coordinates": [%d, %d]}}' % (i, i % 10, i // 10) for i in range(100)))
+            f.write(']}')
+
+        vl = QgsVectorLayer(u'{}'.format(datasource), u'test', u'ogr')
+        self.assertTrue(vl.isValid())
+        self.assertTrue(vl.dataProvider().capabilities() & QgsVectorDataProvider.CreateSpatialIndex)
+
+        request = QgsFeatureRequest().setFilterRect(QgsRectangle(1.5, 2.5, 3.5, 4.5))
+        expected = sorted([f['id'] for f in vl.getFeatures(request)])
+        self.assertEqual(expected, [32, 33, 42, 43])
+
+        self.assertTrue(vl.dataProvider().createSpatialIndex())
+        self.assertTrue(os.path.exists(datasource + '.0.qsi'))
+        self.assertEqual(sorted([f['id'] for f in vl.getFeatures(request)]), expected)
+        self.assertEqual(len([f for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(20, 20, 30, 30)))]), 0)
+
+        # the index is used again when the layer is opened, as long as the data source is not modified
+        vl = None
+        vl = QgsVectorLayer(u'{}'.format(datasource), u'test', u'ogr')
+        self.assertEqual(sorted([f['id'] for f in vl.getFeatures(request)]), expected)
+
+        # committed edits write the index again once, before the next query
+        farRequest = QgsFeatureRequest().setFilterRect(QgsRectangle(20, 20, 30, 30))
+        fid = [f.id() for f in vl.getFeatures() if f['id'] == 32][0]
+        with open(datasource + '.0.qsi', 'rb') as f:
+            index = f.read()
+        self.assertTrue(vl.startEditing())
+        self.assertTrue(vl.changeGeometry(fid, QgsGeometry.fromPoint(QgsPoint(25, 25))))
+        feature = QgsFeature(vl.fields())
+        feature.setAttributes([100])
+        feature.setGeometry(QgsGeometry.fromPoint(QgsPoint(50, 50)))
+        self.assertTrue(vl.addFeature(feature))
+        self.assertTrue(vl.commitChanges())
+        with open(datasource + '.0.qsi', 'rb') as f:
+            self.assertEqual(f.read(), index)
+        self.assertEqual(sorted([f['id'] for f in vl.getFeatures(request)]), [33, 42, 43])
+        with open(datasource + '.0.qsi', 'rb') as f:
+            self.assertNotEqual(f.read(), index)
+        self.assertEqual([f['id'] for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(49, 49, 51, 51)))], [100])
+        self.assertEqual([f['id'] for f in vl.getFeatures(farRequest)], [32])
+        vl = None
+        vl = QgsVectorLayer(u'{}'.format(datasource), u'test', u'ogr')
+        self.assertEqual(sorted([f['id'] for f in vl.getFeatures(request)]), [33, 42, 43])
+        self.assertEqual([f['id'] for f in vl.getFeatures(farRequest)], [32])
+
+        # an index older than its data source is not used
+        vl = None
+        with open(datasource, 'wt') as f:
+            f.write('{"type": "FeatureCollection", "features": [')
+            f.write(','.join('{"type": "Feature", "properties": {"id": %d}, "geometry": {"type": "Point", "coordinates": [%d, %d]}}' % (i, i % 10 + 100, i // 10) for i in range(100)))
+            f.write(']}')
+        vl = QgsVectorLayer(u'{}'.format(datasource), u'test', u'ogr')
+        self.assertEqual([f for f in vl.getFeatures(request)], [])
+        self.assertEqual(len([f for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(101.5, 2.5, 103.5, 4.5)))]), 4)
+
+        # nor an index of a data source with another number of features, even with the same size and modification time
+        self.assertTrue(vl.dataProvider().createSpatialIndex())
+        vl = None
+        stat = os.stat(datasource)
+        with open(datasource, 'rt') as f:
+            content = f.read()
+        # remove the first feature, the ids of the other ones are shifted
+        start = content.index('{"type": "Feature"')
+        end = content.index('{"type": "Feature"', start + 1)
+        shortened = content[:start] + ' ' * (end - start) + content[end:]
+        with open(datasource, 'wt') as f:
+            f.write(shortened)
+        os.utime(datasource, (stat.st_atime, stat.st_mtime))
+        self.assertEqual(os.stat(datasource).st_size, stat.st_size)
+        vl = QgsVectorLayer(u'{}'.format(datasource), u'test', u'ogr')
+        self.assertEqual(vl.featureCount(), 99)
+        self.assertEqual([f['id'] for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(99.5, -0.5, 100.5, 0.5)))], [])
+        self.assertEqual([f['id'] for f in vl.getFeatures(QgsFeatureRequest().setFilterRect(QgsRectangle(100.5, -0.5, 101.5, 0.5)))], [1])
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -16,6 +16,7 @@ __revision__ = '$Format:%H$'
 import qgis  # NOQA
 
 import os
+import re
 
 from qgis.core import (
     QgsVectorLayer,
@@ -92,6 +93,40 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         self.assertTrue(isinstance(f.attributes()[datetime_idx], QDateTime))
         self.assertEqual(f.attributes()[datetime_idx], QDateTime(QDate(2004, 3, 4), QTime(13, 41, 52)))
 
+    def testBinaryValues(self):
+        """Attributes decoded from the binary cursor match their text form"""
+        def features(query):
+            vl = QgsVectorLayer('%s srid=4326 table="%s" (g) key=\'pk\' sql=' % (self.dbconn, query.replace('"', '\\"')), "t", "postgres")
+            self.assertTrue(vl.isValid(), query)
+            return [f for f in vl.getFeatures()]
+
+        # float4 and int2
+        for f in features('(SELECT pk, v, v::text t, NULL::geometry(Point, 4326) g FROM (VALUES '
+                          '(1, 1.1::float4), (2, -0.5::float4), (3, 3.14159::float4), (4, 1e-7::float4)) AS v(pk, v))'):
+            self.assertEqual(f['v'], float(f['t']), f['t'])
+        for f in features('(SELECT pk, v, v::text t, NULL::geometry(Point, 4326) g FROM (VALUES '
+                          '(1, 0::int2), (2, -12::int2), (3, 32767::int2), (4, (-32768)::int2)) AS v(pk, v))'):
+            self.assertEqual(f['v'], int(f['t']), f['t'])
+
+        # the digits of a float4 are kept, even if its text form is rounded to 6 significant digits by older servers
+        f = features('(SELECT 1 pk, 123456.7::float4 v, NULL::geometry(Point, 4326) g)')[0]
+        self.assertEqual(f['v'], 123456.7)
+
+        # dates and timestamps before 2000 and before 1970, and infinite ones which have no QDate
+        for f in features('(SELECT pk, d, d::text t, NULL::geometry(Point, 4326) g FROM (VALUES '
+                          '(1, \'1999-12-31\'::date), (2, \'1960-02-03\'::date), (3, \'infinity\'::date), (4, \'-infinity\'::date)) AS v(pk, d))'):
+            if 'infinity' in f['t']:
+                self.assertEqual(f['d'], NULL, f['t'])
+            else:
+                self.assertEqual(f['d'], QDate.fromString(f['t'], 'yyyy-MM-dd'), f['t'])
+        for f in features('(SELECT pk, d, to_char(d, \'YYYY-MM-DD HH24:MI:SS.MS\') t, NULL::geometry(Point, 4326) g FROM (VALUES '
+                          '(1, \'1999-12-31 23:59:59.999\'::timestamp), (2, \'1960-02-03 04:05:06.789\'::timestamp), '
+                          '(3, \'1969-12-31 23:59:59\'::timestamp), (4, \'infinity\'::timestamp), (5, \'-infinity\'::timestamp)) AS v(pk, d))'):
+            if f['pk'] > 3:
+                self.assertEqual(f['d'], NULL, f['pk'])
+            else:
+                self.assertEqual(f['d'], QDateTime.fromString(f['t'], 'yyyy-MM-dd hh:mm:ss.zzz'), f['t'])
+
     def testQueryLayers(self):
         def test_query(dbconn, query, key):
             ql = QgsVectorLayer('%s srid=4326 table="%s" (geom) key=\'%s\' sql=' % (dbconn, query.replace('"', '\\"'), key), "testgeom", "postgres")
@@ -312,5 +347,84 @@ class TestPyQgsPostgresProvider(unittest.TestCase, ProviderTestCase):
         self.assertEqual(fet.fields()[1].name(), 'newname2')
         self.assertEqual(fet.fields()[2].name(), 'another')
 
+    def bigQueryLayer(self, rows, width):
+        """Returns a query layer of rows features with a text attribute of width characters"""
+        query = '(SELECT i AS pk, ST_SetSRID(ST_MakePoint(i, i), 4326)::geometry(Point, 4326) AS geom, repeat(\'x\', %d) AS txt FROM generate_series(1, %d) AS i)' % (width, rows)
+        vl = QgsVectorLayer('%s sslmode=disable srid=4326 key=\'pk\' table="%s" (geom) sql=' % (self.dbconn, query), 'big', 'postgres')
+        self.assertTrue(vl.isValid())
+        return vl
+
+    def fetchStatements(self):
+        """Returns the last FETCH statement of the other connections to the test database"""
+        query = '(SELECT pid, query, query_start::text AS started FROM pg_stat_activity WHERE datname = current_database() AND pid <> pg_backend_pid() AND query LIKE \'FETCH FORWARD %\')'
+        vl = QgsVectorLayer('%s sslmode=disable key=\'pid\' table="%s" sql=' % (self.dbconn, query), 'fetches', 'postgres')
+        self.assertTrue(vl.isValid())
+        return set((f['pid'], f['query'], f['started']) for f in vl.getFeatures())
+
+    def testRewindAndCloseWhileFetching(self):
+        vl = self.bigQueryLayer(5000, 10)
+        f = QgsFeature()
+
+        # the first batch is decoded while the next one is fetched
+        it = vl.getFeatures()
+        for i in range(10):
+            self.assertTrue(it.nextFeature(f))
+        self.assertTrue(it.rewind())
+        self.assertEqual(sorted(f['pk'] for f in it), list(range(1, 5001)))
+
+        it = vl.getFeatures()
+        for i in range(10):
+            self.assertTrue(it.nextFeature(f))
+        self.assertTrue(it.close())
+        self.assertFalse(it.nextFeature(f))
+        del it
+
+        # the connection given back to the pool accepts other queries
+        self.assertEqual(len([f for f in vl.getFeatures()]), 5000)
+        self.assertEqual(next(vl.getFeatures(QgsFeatureRequest(42)))['pk'], 42)
+
+    def testIteratePastEnd(self):
+        def check(vl, request, count):
+            it = vl.getFeatures(request)
+            f = QgsFeature()
+            fetched = 0
+            while it.nextFeature(f):
+                fetched += 1
+            self.assertEqual(fetched, count)
+            for i in range(3):
+                self.assertFalse(it.nextFeature(f))
+                self.assertFalse(f.isValid())
+
+        # less than, exactly and more than one batch
+        check(self.bigQueryLayer(10, 10), QgsFeatureRequest(), 10)
+        check(self.bigQueryLayer(2000, 10), QgsFeatureRequest(), 2000)
+        check(self.bigQueryLayer(4500, 10), QgsFeatureRequest(), 4500)
+        check(self.bigQueryLayer(4500, 10), QgsFeatureRequest().setLimit(2100), 2100)
+
+    def testFeatureQueueSizeBounds(self):
+        before = self.fetchStatements()
+
+        # rows of about 10 KB, the batches are kept under 8 MB of row data
+        vl = self.bigQueryLayer(4200, 10000)
+        it = vl.getFeatures()
+        f = QgsFeature()
+        statements = set()
+        count = 0
+        while it.nextFeature(f):
+            count += 1
+            if count % 200 == 0:
+                statements |= self.fetchStatements()
+        statements |= self.fetchStatements()
+        self.assertEqual(count, 4200)
+        del it
+
+        sizes = [int(re.match(r'FETCH FORWARD (\d+)', query).group(1)) for pid, query, started in statements - before]
+        self.assertTrue(sizes)
+        for size in sizes:
+            self.assertGreaterEqual(size, 100)
+            self.assertLessEqual(size, 50000)
+        self.assertLessEqual(min(sizes), 8 * 1024 * 1024 // 10000)
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -0,0 +1,148 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsProjectSnapshot.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+"""
+__author__ = 'QGIS Development Team'
+__date__ = '18/10/2016'
+__copyright__ = 'Copyright 2016, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import shutil
+import tempfile
+
+from qgis.PyQt.QtCore import QFileInfo
+from qgis.PyQt.QtXml import QDomDocument
+from qgis.server import QgsProjectSnapshot
+from qgis.testing import unittest
+from utilities import unitTestDataPath
+
+
+class TestQgsProjectSnapshot(unittest.TestCase):
+
+    def setUp(self):
+        self.tmp_dir = tempfile.mkdtemp()
+        self.snapshot_dir = os.path.join(self.tmp_dir, 'snapshots')
+        self.project_path = os.path.join(self.tmp_dir, 'project.qgs')
+        shutil.copy(os.path.join(unitTestDataPath('qgis_server'), 'test+project.qgs'), self.project_path)
+
+        with open(self.project_path, 'rb') as f:
+            self.document = QDomDocument()
+            self.assertTrue(self.document.setContent(f.read(), True)[0])
+
+    def tearDown(self):
+        shutil.rmtree(self.tmp_dir, True)
+
+    def testInMemory(self):
+        snapshot = QgsProjectSnapshot('')
+        self.assertFalse(snapshot.isPersistent())
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+        self.assertFalse(os.path.exists(self.snapshot_dir))
+        loaded = snapshot.load(QFileInfo(self.project_path))
+        self.assertEqual(loaded.document().toString(), self.document.toString())
+
+        # removed snapshots stay in memory until their documents are deleted
+        snapshot.remove(QFileInfo(self.project_path))
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+        self.assertEqual(loaded.document().toString(), self.document.toString())
+
+        # a modified project is not loaded from the previous snapshot
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+        stat = os.stat(self.project_path)
+        os.utime(self.project_path, (stat.st_atime, stat.st_mtime + 10))
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+
+    def testRoundTrip(self):
+        snapshot = QgsProjectSnapshot(self.snapshot_dir)
+        self.assertTrue(snapshot.isPersistent())
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+        loaded = snapshot.load(QFileInfo(self.project_path))
+        self.assertIsNotNone(loaded)
+        self.assertEqual(loaded.document().toString(), self.document.toString())
+
+        # another process, and a second load sharing the mapping of the first one
+        other = QgsProjectSnapshot(self.snapshot_dir)
+        other_loaded = other.load(QFileInfo(self.project_path))
+        self.assertEqual(other_loaded.document().toString(), self.document.toString())
+        other_loaded_again = other.load(QFileInfo(self.project_path))
+        self.assertEqual(other_loaded_again.document().toString(), self.document.toString())
+
+        # the documents keep their mapping after the snapshot object is deleted
+        del other
+        del other_loaded
+        self.assertEqual(other_loaded_again.document().toString(), self.document.toString())
+
+    def testReleasedMapping(self):
+        snapshot = QgsProjectSnapshot(self.snapshot_dir)
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+
+        # the file is mapped again once the documents using the previous mapping are deleted
+        for i in range(3):
+            loaded = snapshot.load(QFileInfo(self.project_path))
+            self.assertEqual(loaded.document().toString(), self.document.toString())
+            del loaded
+
+        loaded = snapshot.load(QFileInfo(self.project_path))
+        snapshot.remove(QFileInfo(self.project_path))
+        self.assertEqual(loaded.document().toString(), self.document.toString())
+        loaded_again = snapshot.load(QFileInfo(self.project_path))
+        self.assertEqual(loaded_again.document().toString(), self.document.toString())
+
+    def testModifiedProject(self):
+        snapshot = QgsProjectSnapshot(self.snapshot_dir)
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+
+        stat = os.stat(self.project_path)
+        os.utime(self.project_path, (stat.st_atime, stat.st_mtime + 10))
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+
+        # a new snapshot replaces the outdated one
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+        loaded = snapshot.load(QFileInfo(self.project_path))
+        self.assertEqual(loaded.document().toString(), self.document.toString())
+
+    def testModifiedContent(self):
+        snapshot = QgsProjectSnapshot(self.snapshot_dir)
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+
+        # same size and modification time, different content
+        stat = os.stat(self.project_path)
+        with open(self.project_path, 'rb') as f:
+            content = f.read()
+        index = content.index(b'<qgis ') + 1
+        with open(self.project_path, 'wb') as f:
+            f.write(content[:index] + b'Q' + content[index + 1:])
+        os.utime(self.project_path, (stat.st_atime, stat.st_mtime))
+        self.assertEqual(os.stat(self.project_path).st_size, stat.st_size)
+
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+
+        # the content passed by the caller is checked as well
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path), content[:index] + b'Q' + content[index + 1:]))
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document, content))
+        self.assertIsNotNone(snapshot.load(QFileInfo(self.project_path), content))
+
+    def testCorruptedSnapshot(self):
+        snapshot = QgsProjectSnapshot(self.snapshot_dir)
+        self.assertTrue(snapshot.save(QFileInfo(self.project_path), self.document))
+
+        snapshot_files = os.listdir(self.snapshot_dir)
+        self.assertEqual(len(snapshot_files), 1)
+        snapshot_path = os.path.join(self.snapshot_dir, snapshot_files[0])
+        with open(snapshot_path, 'r+b') as f:
+            f.truncate(os.path.getsize(snapshot_path) // 2)
+
+        self.assertIsNone(snapshot.load(QFileInfo(self.project_path)))
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,192 @@
+# -*- coding: utf-8 -*-
+"""QGIS Unit tests for QgsServer requests processed in parallel threads.
+
+.. note:: This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+"""
+__author__ = 'QGIS Development Team'
+__date__ = '18/10/2016'
+__copyright__ = 'Copyright 2016, The QGIS Project'
+# This will get replaced with a git SHA1 when you do a git archive
+__revision__ = '$Format:%H$'
+
+import os
+import re
+import shutil
+import tempfile
+import threading
+import time
+import urllib
+from qgis.PyQt.QtCore import QCoreApplication
+from qgis.server import QgsServer
+from qgis.testing import unittest
+from utilities import unitTestDataPath
+
+# Strip path and content length because path may vary
+RE_STRIP_PATH = r'MAP=[^&]+|Content-Length: \d+'
+
+THREAD_COUNT = 4
+REPEAT_COUNT = 5
+
+WFS_POST_BODY = """<?xml version="1.0" encoding="UTF-8"?>
+<wfs:GetFeature service="WFS" version="1.0.0" xmlns:wfs="http://www.opengis.net/wfs" xmlns:xsi="http://www.w3.org/2001/XMLSchema-instance" xsi:schemaLocation="http://www.opengis.net/wfs http://schemas.opengis.net/wfs/1.1.0/wfs.xsd">
+  <wfs:Query typeName="testlayer" xmlns:feature="http://www.qgis.org/gml">
+    <ogc:Filter xmlns:ogc="http://www.opengis.net/ogc">
+      <ogc:BBOX>
+        <ogc:PropertyName>geometry</ogc:PropertyName>
+        <gml:Envelope xmlns:gml="http://www.opengis.net/gml">
+          <gml:lowerCorner>8 44</gml:lowerCorner>
+          <gml:upperCorner>9 45</gml:upperCorner>
+        </gml:Envelope>
+      </ogc:BBOX>
+    </ogc:Filter>
+  </wfs:Query>
+</wfs:GetFeature>
+"""
+
+
+class TestQgsServerThreads(unittest.TestCase):
+
+    @classmethod
+    def setUpClass(cls):
+        """Create the server instance"""
+        cls.testdata_path = unitTestDataPath('qgis_server') + '/'
+        for ev in ('QUERY_STRING', 'QGIS_PROJECT_FILE', 'REQUEST_METHOD', 'REQUEST_BODY'):
+            try:
+                del os.environ[ev]
+            except KeyError:
+                pass
+        cls.server = QgsServer()
+
+    def requests(self):
+        """Returns the tested requests: name, CGI variables and body"""
+        wms_project = urllib.quote(self.testdata_path + 'test+project.qgs')
+        wfs_project = urllib.quote(self.testdata_path + 'test+project_wfs.qgs')
+        wms = 'MAP=%s&SERVICE=WMS&VERSION=1.3.0&' % wms_project
+        bbox = 'BBOX=913190.6389747962%2C5606005.488876367%2C913235.426296057%2C5606035.347090538&'
+
+        def get(query_string):
+            return {'REQUEST_METHOD': 'GET', 'QUERY_STRING': query_string}
+
+        return [
+            ('GetCapabilities', get(wms + 'REQUEST=GetCapabilities'), ''),
+            ('GetMap', get(wms + 'REQUEST=GetMap&LAYERS=testlayer%20%C3%A8%C3%A9&STYLES=&FORMAT=image%2Fpng&' +
+                           'CRS=EPSG%3A3857&' + bbox + 'WIDTH=600&HEIGHT=400'), ''),
+            ('GetFeatureInfo', get(wms + 'REQUEST=GetFeatureInfo&LAYERS=testlayer%20%C3%A8%C3%A9&STYLES=&' +
+                                   'INFO_FORMAT=text%2Fhtml&TRANSPARENT=true&WIDTH=600&HEIGHT=400&SRS=EPSG%3A3857&' +
+                                   bbox + 'QUERY_LAYERS=testlayer%20%C3%A8%C3%A9&X=190&Y=320'), ''),
+            ('GetFeature', get('MAP=%s&SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=testlayer' % wfs_project), ''),
+            ('GetFeature POST', {'REQUEST_METHOD': 'POST', 'QUERY_STRING': 'MAP=%s' % wfs_project}, WFS_POST_BODY),
+        ]
+
+    def handle(self, environment, body):
+        header, response = self.server.handleRequest(environment, body)
+        return str(header), str(response)
+
+    def test_sequential(self):
+        """The requests passed with their variables give the same responses as through the environment"""
+        requests = dict((name, (environment, body)) for name, environment, body in self.requests())
+
+        for name in ('GetFeature', 'GetFeature POST'):
+            header, body = self.handle(*requests[name])
+            with open(self.testdata_path + 'wfs_getfeature_nobbox.txt') as f:
+                expected = f.read()
+            self.assertEqual(re.sub(RE_STRIP_PATH, '', header + body), re.sub(RE_STRIP_PATH, '', expected), name)
+
+        header, body = self.handle(*requests['GetMap'])
+        self.assertNotEqual(-1, header.find('Content-Type: image/png'), header + body)
+
+        # the request variables did not leak into the process environment
+        self.assertNotIn('QUERY_STRING', os.environ)
+        self.assertNotIn('REQUEST_METHOD', os.environ)
+
+    def test_process_environment(self):
+        """The variables missing from a request are read from the process environment"""
+        os.environ['QGIS_PROJECT_FILE'] = self.testdata_path + 'test+project_wfs.qgs'
+        try:
+            header, body = self.handle({'REQUEST_METHOD': 'GET',
+                                        'QUERY_STRING': 'SERVICE=WFS&VERSION=1.0.0&REQUEST=GetFeature&TYPENAME=testlayer'}, '')
+        finally:
+            del os.environ['QGIS_PROJECT_FILE']
+        self.assertEqual(-1, body.find('ServiceException'), body)
+        self.assertNotEqual(-1, body.find('featureMember'), body)
+
+    def test_threads(self):
+        """Requests processed in parallel give the same responses as processed one at a time"""
+        self.assertTrue(QgsServer.supportsParallelRequests())
+
+        requests = self.requests()
+        expected = dict((name, self.handle(environment, body)) for name, environment, body in requests)
+        errors = []
+
+        def worker(index):
+            QgsServer.initRequestThread()
+            for i in range(REPEAT_COUNT):
+                # each thread processes the requests in a different order
+                for j in range(len(requests)):
+                    name, environment, body = requests[(index + i + j) % len(requests)]
+                    try:
+                        response = self.handle(environment, body)
+                    except Exception as e:
+                        errors.append('%s: %s' % (name, e))
+                        continue
+                    if response != expected[name]:
+                        errors.append('%s: unexpected response in thread %d:\n%s' % (name, index, response[0]))
+
+        threads = [threading.Thread(target=worker, args=(i,)) for i in range(THREAD_COUNT)]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+
+        self.assertEqual(errors, [])
+
+    def test_changed_project(self):
+        """The request threads drop what they cached from a project changed since their last request"""
+        tmp_dir = tempfile.mkdtemp()
+        try:
+            for name in os.listdir(self.testdata_path):
+                if name == 'test+project.qgs' or name.startswith('testlayer.'):
+                    shutil.copy(self.testdata_path + name, tmp_dir)
+            project = os.path.join(tmp_dir, 'test+project.qgs')
+            environment = {'REQUEST_METHOD': 'GET',
+                           'QUERY_STRING': 'MAP=%s&SERVICE=WMS&VERSION=1.3.0&REQUEST=GetCapabilities' % urllib.quote(project)}
+
+            responses = []
+            first_done = threading.Event()
+            changed = threading.Event()
+
+            def worker():
+                QgsServer.initRequestThread()
+                responses.append(self.handle(environment, '')[1])
+                first_done.set()
+                changed.wait()
+                responses.append(self.handle(environment, '')[1])
+
+            thread = threading.Thread(target=worker)
+            thread.start()
+            first_done.wait()
+
+            with open(project) as f:
+                content = f.read()
+            with open(project, 'w') as f:
+                f.write(content.replace('QGIS TestProject', 'QGIS Changed Project'))
+
+            # the file system watcher of the main thread reports the change
+            for i in range(20):
+                QCoreApplication.processEvents()
+                time.sleep(0.05)
+            changed.set()
+            thread.join()
+
+            self.assertNotEqual(-1, responses[0].find('QGIS TestProject'))
+            self.assertNotEqual(-1, responses[1].find('QGIS Changed Project'), responses[1])
+        finally:
+            shutil.rmtree(tmp_dir, True)
+
+
+if __name__ == '__main__':
+    unittest.main()